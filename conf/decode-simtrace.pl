@@ -0,0 +1,95 @@
+#!/usr/bin/perl -w
+
+# decode-simtrace.pl -- prints ToSimBinaryTrace files as ToSimTrace lines
+#
+# Usage: decode-simtrace.pl FILE...
+#
+# The records of all files are merged by time.  The analysis bytes are
+# printed by the analyzer that wrote them, as named by their first byte:
+# 'O' for OLSRPacketAnalyzer; others are printed in hex.
+
+use strict;
+
+my $MAGIC = 0x43535452;
+my $VERSION = 1;
+
+my %olsr_types = (1 => "HELLO", 2 => "TC", 3 => "MID", 4 => "HNA",
+		  201 => "LQ_HELLO", 202 => "LQ_TC");
+
+sub usage {
+    print STDERR "Usage: decode-simtrace.pl FILE...\n";
+    exit 1;
+}
+
+sub analysis ($) {
+    my($bytes) = @_;
+    return "" if $bytes eq "";
+    my($tag, $rest) = (substr($bytes, 0, 1), substr($bytes, 1));
+    if ($tag eq 'O' && length($rest) >= 12) {
+	my($type, $vtime, $size, @f) = unpack("C C n C4 C C n", $rest);
+	my($ttl, $hops, $seq) = @f[4..6];
+	my $name = $olsr_types{$type} || "UNKNOWN PACKET TYPE";
+	return sprintf("[%s %d.%d.%d.%d seq %d ttl %d hops %d size %d]",
+		       $name, @f[0..3], $seq, $ttl, $hops, $size);
+    }
+    return unpack("H*", $bytes);
+}
+
+# [handle, name, record size, next record, its time], sorted by time
+my @files;
+
+sub advance ($) {
+    my($f) = @_;
+    my $record;
+    if (read($f->[0], $record, $f->[2]) == $f->[2]) {
+	my($sec, $usec) = unpack("N N", $record);
+	$f->[3] = $record;
+	$f->[4] = $sec * 1000000 + $usec;
+    } else {
+	$f->[3] = undef;
+    }
+}
+
+# after the ones with the same time, to keep the order of the records
+sub insert ($) {
+    my($f) = @_;
+    my($lo, $hi) = (0, scalar(@files));
+    while ($lo < $hi) {
+	my $mid = int(($lo + $hi) / 2);
+	if ($files[$mid]->[4] <= $f->[4]) {
+	    $lo = $mid + 1;
+	} else {
+	    $hi = $mid;
+	}
+    }
+    splice(@files, $lo, 0, $f);
+}
+
+usage() if !@ARGV || $ARGV[0] =~ /^-/;
+foreach my $name (@ARGV) {
+    my $fh;
+    open($fh, "<", $name) or die "$name: $!\n";
+    binmode($fh);
+    my $header;
+    read($fh, $header, 12) == 12 or die "$name: too short\n";
+    my($magic, $version, $record_size, $node) = unpack("N n n N", $header);
+    die "$name: not a ToSimBinaryTrace file\n" if $magic != $MAGIC;
+    die "$name: version $version not supported\n" if $version != $VERSION;
+    seek($fh, $record_size, 0);
+    my $f = [$fh, $name, $record_size, undef, 0];
+    advance($f);
+    insert($f) if defined $f->[3];
+}
+
+while (@files) {
+    my $f = shift @files;
+    my($sec, $usec, $node, $id, $length, $event, $alen, $reserved, $bytes)
+	= unpack("N N N N N a C n a16", $f->[3]);
+    $node -= 4294967296 if $node >= 2147483648;
+    $id -= 4294967296 if $id >= 2147483648;
+    printf("%s %f _%i_ RTR --- %i raw %i [ %s]\n", $event,
+	   $sec + $usec / 1000000, $node, $id, $length,
+	   analysis(substr($bytes, 0, $alen)));
+    advance($f);
+    insert($f) if defined $f->[3];
+}
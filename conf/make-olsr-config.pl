@@ -19,6 +19,8 @@ Options:
    -k, --kernel                 Run in kernel.  Only works on Linux. (default)
    -u, --userlevel              Run in userlevel.
    -s, --simulator              Run in ns-click simulator.
+   --sim-arp                    Simulator: resolve next hops with ARP as on real devices, instead of
+                                the table OLSRSimEtherEncap shares between the simulated nodes
    
    -n  --number N               Use n interfaces defaults to 1
    -i, --interface IF1..IFn     Use interface IF.  Required option.
@@ -44,6 +46,59 @@ Options:
    --additional-hello-msgs      Send more than just necessary messages to react faster to link failures
    --additional-tc-msgs         Send more than just necessary messages to react faster to topology changes
    --Jitter-all	T (sec)		old way: all packets are jittered before output on interface x default: 0
+   --aggregate T (msec)         Combine the messages sent within T on an interface into one packet [default: off]
+   --adaptive-intervals         Lengthen the HELLO and TC intervals while links and topology are stable
+   --fisheye 'TTL1 .. TTLn'     Give successive TC messages these TTLs, e.g. '2 8 2 16 2 255' [default: always 255]
+   --control-thread N           Process OLSR messages and compute MPRs and routes on thread N only [default: off]
+   --control-deadline T (msec)  Schedule the OLSR control Tasks and timers ahead of the data path, and count
+                                how often they wait longer than T to run [default: off]
+   --interface-threads N        With --control-thread: receive and send on interface i on thread N+i; the
+                                OLSR packets go to the control thread, and all threads send through
+                                thread-safe device queues [default: off]
+   --link-quality               Measure link qualities and route by ETX instead of hop count [default: off]
+   --compact-addresses          Send HELLO and TC messages with their addresses in address blocks, the bytes
+                                they share sent once; all nodes need the option [default: off]
+   --auth-key HEX               Sign every OLSR message with an HMAC of this key, given in hex, and drop
+                                the messages received without a valid one; all nodes need the key [default: off]
+   --hysteresis                 Use a link only once the hysteresis of RFC 3626 section 14 accepts it [default: off]
+   --route-cache N              Cache the route lookups of the data path in N entries [default: off]
+   --forward-combo N            Decrement the TTL, look up the route and add the Ethernet header of the
+                                forwarded data in one element caching N destinations, in place of
+                                --route-cache; needs ARP [default: off]
+   --data-flood                 Flood IP broadcast and multicast data through the MPRs, as SMF does,
+                                dropping duplicates; needs ARP [default: off, not forwarded]
+   --multipath K                Spread the flows to a destination over up to K equal-cost next hops,
+                                in place of --route-cache [default: 1, one next hop]
+   --aggregate-routes           Merge the routes with the same next hop into as few prefixes as forward
+                                the same way before installing them [default: off, one per host]
+   --lazy-routes                Install the host routes only for the destinations the traffic goes to,
+                                asked for by the lookup on a miss [default: off, all routes]
+   --gateway-balance            Share the networks advertised by several HNA gateways among them by the
+                                capacity they have left, in place of --route-cache [default: off]
+   --gateway-capacity C         With --hna-gen: advertise an uplink capacity of C kbit/s; write the load
+                                to the hna_generator.load handler [default: off]
+   --gateway-tunnel             Tunnel the traffic for the default route to the nearest HNA gateway, one
+                                gateway per flow, and take apart what is tunnelled to this node; all
+                                nodes need the option [default: off, routed hop by hop]
+   --prio-sched R               Send the node's own control messages and ARP before the forwarded
+                                floods, and those before the data, limiting the floods to R packets
+                                per second per interface, 0 for no limit [default: off, one queue]
+   --residence-time             Stamp the packets as they come in and keep histograms, by class, of the
+                                time they spend in the node before they go out, in residence<i> [default: off]
+   --aggregate-data T (msec)    Send the small data packets routed to the same next hop within T in one frame;
+                                all nodes need the option, to take the frames apart [default: off]
+   --neighbor-queues            Queue the data for each next hop apart and send the queues round-robin,
+                                so a neighbor over a bad link does not hold up the others [default: off]
+   --replay FILE                Userlevel: replay the tcpdump file FILE into the first interface instead of
+                                reading the devices, and discard the output and the local traffic [default: off]
+   --replay-speedup S           Replay at S times the speed of the capture, 0 for as fast as possible [default: 0]
+   --snapshot FILE              Userlevel: save the topology, MID and HNA tuples to FILE every TC interval
+                                and load them back at startup, for a warm restart [default: off]
+   --flatten                    Expand the OLSRnode compound here with click-flatten, so the driver
+                                does not have to at every start
+   --precompile                 Flatten, then compile the classifiers and the element calls of the
+                                fixed pipeline into a package with click-fastclassifier and
+                                click-devirtualize; the output is an archive for click or click-install
    ";
 }
 
@@ -77,6 +132,7 @@ my @ifname = "";
 my $in_kernel = 0;
 my $in_userlevel = 0;
 my $in_simulator = 0;
+my $sim_arp = 0;
 my $n=1;
 my @addr = "";
 my @eth = "";
@@ -88,6 +144,36 @@ my $hello_interval = 1500;
 my $hello_jitter=-1;
 my $Jitter=-1;
 my $Jitter_all=-1;
+my $aggregate=-1;
+my $adaptive_intervals=0;
+my $fisheye="";
+my $control_thread=-1;
+my $interface_threads=-1;
+my $control_deadline=0;
+my $defer_mpr="";
+my $link_quality="";
+my $tc_link_quality="";
+my $compact="";
+my $auth_key="";
+my $hysteresis="";
+my $route_cache=0;
+my $forward_combo=0;
+my $multipath=1;
+my $gateway_balance=0;
+my $aggregate_routes=0;
+my $lazy_routes=0;
+my $gateway_capacity=0;
+my $gateway_tunnel=0;
+my $prio_sched="";
+my $neighbor_queues=0;
+my $data_flood=0;
+my $residence_time=0;
+my $aggregate_data=-1;
+my $replay="";
+my $replay_speedup=0;
+my $snapshot="";
+my $flatten=0;
+my $precompile=0;
 my $additional_hello_msgs = "false";
 my $additional_tc_msgs = "false";
 my $neighb_hold_time=0;
@@ -147,6 +233,9 @@ while (scalar(@ARGV) > 0) {
 	elsif ($arg eq "--simulator" || $arg eq "-s") {
 		$in_simulator = 1;
 	}
+	elsif ($arg eq "--sim-arp") {
+		$sim_arp = 1;
+	}
 	elsif ($arg eq "--HELLO-Interval") {
 		$hello_interval = get_arg();
 	}
@@ -168,6 +257,93 @@ while (scalar(@ARGV) > 0) {
 	elsif ($arg eq "--Jitter-all") {
 		$Jitter_all = get_arg();
 	}
+	elsif ($arg eq "--aggregate") {
+		$aggregate = get_arg();
+	}
+	elsif ($arg eq "--adaptive-intervals") {
+		$adaptive_intervals = 1;
+	}
+	elsif ($arg eq "--fisheye") {
+		$fisheye = ", TTL_SCHEDULE \"" . get_arg() . "\"";
+	}
+	elsif ($arg eq "--control-thread") {
+		$control_thread = get_arg();
+		$defer_mpr = ", DEFER_MPR true";
+	}
+	elsif ($arg eq "--control-deadline") {
+		$control_deadline = get_arg();
+	}
+	elsif ($arg eq "--interface-threads") {
+		$interface_threads = get_arg();
+	}
+	elsif ($arg eq "--link-quality") {
+		$link_quality = ", LINK_QUALITY true";
+		$tc_link_quality = ", LINK_QUALITY true, LINK_INFO link_info";
+	}
+	elsif ($arg eq "--auth-key") {
+		$auth_key = get_arg();
+		die "--auth-key takes 1 to 16 bytes in hex" unless $auth_key =~ /^([0-9a-fA-F]{2}){1,16}$/;
+	}
+	elsif ($arg eq "--compact-addresses") {
+		$compact = ", COMPACT true";
+	}
+	elsif ($arg eq "--hysteresis") {
+		$hysteresis = ", HYSTERESIS true";
+	}
+	elsif ($arg eq "--route-cache") {
+		$route_cache = get_arg();
+	}
+	elsif ($arg eq "--data-flood") {
+		$data_flood = 1;
+	}
+	elsif ($arg eq "--forward-combo") {
+		$forward_combo = get_arg();
+	}
+	elsif ($arg eq "--multipath") {
+		$multipath = get_arg();
+	}
+	elsif ($arg eq "--aggregate-routes") {
+		$aggregate_routes = 1;
+	}
+	elsif ($arg eq "--lazy-routes") {
+		$lazy_routes = 1;
+	}
+	elsif ($arg eq "--gateway-balance") {
+		$gateway_balance = 1;
+	}
+	elsif ($arg eq "--gateway-capacity") {
+		$gateway_capacity = get_arg();
+	}
+	elsif ($arg eq "--gateway-tunnel") {
+		$gateway_tunnel = 1;
+	}
+	elsif ($arg eq "--prio-sched") {
+		$prio_sched = get_arg();
+	}
+	elsif ($arg eq "--neighbor-queues") {
+		$neighbor_queues = 1;
+	}
+	elsif ($arg eq "--residence-time") {
+		$residence_time = 1;
+	}
+	elsif ($arg eq "--aggregate-data") {
+		$aggregate_data = get_arg();
+	}
+	elsif ($arg eq "--replay") {
+		$replay = get_arg();
+	}
+	elsif ($arg eq "--replay-speedup") {
+		$replay_speedup = get_arg();
+	}
+	elsif ($arg eq "--snapshot") {
+		$snapshot = get_arg();
+	}
+	elsif ($arg eq "--flatten") {
+		$flatten = 1;
+	}
+	elsif ($arg eq "--precompile") {
+		$precompile = 1;
+	}
 	elsif ($arg eq "--neighb-hold-time") {
 		$neighb_hold_time = get_arg();
 	}
@@ -224,6 +400,40 @@ for(@ifname) {
 	}
  }
 
+if ($replay ne "" && $in_userlevel != 1) {
+	bail("--replay needs --userlevel");
+}
+
+if ($snapshot ne "" && $in_userlevel != 1) {
+	bail("--snapshot needs --userlevel");
+}
+
+if ($interface_threads >= 0) {
+	bail("--interface-threads needs --control-thread") if $control_thread < 0;
+	bail("--interface-threads needs --userlevel or --kernel, and no --replay")
+		if ($in_userlevel != 1 && $in_kernel != 1) || $replay ne "";
+	# these keep unlocked state that every receiving thread would change
+	bail("--interface-threads cannot be combined with --route-cache, --forward-combo, --neighbor-queues, --aggregate-data, --data-flood or --gateway-tunnel")
+		if $route_cache > 0 || $forward_combo > 0 || $neighbor_queues || $aggregate_data >= 0 || $data_flood || $gateway_tunnel;
+}
+
+if ($sim_arp && $in_simulator != 1) {
+	bail("--sim-arp needs --simulator");
+}
+
+# simulated nodes share one process, and so a table of their addresses
+my $use_arp = ($in_simulator != 1 || $sim_arp);
+
+# the combined forwarding element hands unresolved next hops to the ARP
+# queriers and looks up routes itself, one next hop per destination
+$forward_combo = 0 if (!$use_arp || $hna < 1 || $multipath > 1 || $gateway_balance || $aggregate_data >= 0);
+
+# the flooding element finds the previous hops in the ARP tables
+bail("--data-flood needs ARP") if $data_flood && !$use_arp;
+# inputs of joindevice$i: control, ARP responses, ARP queries, and the
+# data the forwarding element resolved and the data flooded if in use
+my $njoindevice = ($use_arp ? ($forward_combo > 0 ? 4 : 3) : 2) + ($data_flood ? 1 : 0);
+
  if ($in_simulator != 1) {
  	for(@addr) {
  		if ($_ eq "") {
@@ -268,6 +478,48 @@ sub check_param($$$) {
 	}
 }
 
+check_param("prio-sched", $prio_sched, 0) if $prio_sched ne "";
+
+# the tools need the whole configuration, so they read it from a pipe
+if ($flatten || $precompile) {
+	my $driver = ($in_kernel eq 1 ? "-k" : "-u");
+	my $cmd = "click-flatten";
+	if ($precompile) {
+		# the device elements gain nothing and drag system headers into
+		# the package
+		my $keep = join(" ", map { "-n $_" } qw(FromDevice ToDevice FromHost ToHost FromSimDevice ToSimDevice FromDump));
+		$cmd .= " | click-fastclassifier $driver | click-devirtualize $driver $keep";
+	}
+	open(STDOUT, "| $cmd") or bail("cannot run `$cmd': $!");
+}
+
+# the device output queue of interface $i, ending in todevice$i
+sub output_queue($$) {
+	my($i, $capacity) = @_;
+	# with interface threads, every thread may push to every device
+	my $queue = ($interface_threads >= 0 ? "ThreadSafeQueue" : "Queue");
+	my $data_queue = ($neighbor_queues ? "OLSRNeighborQueue" : $queue);
+	my $residence = ($residence_time ? "residence$i\::OLSRResidenceTime\n\t\t-> " : "");
+	if ($prio_sched eq "") {
+		return "out$i\::$data_queue($capacity)
+		-> ${residence}todevice$i;";
+	}
+	# a message with hop count 0 is the node's own, the hop count of a
+	# forwarded one is at least 1; aggregated packets go by their first
+	# message
+	return "out$i\::SetTimestamp
+		-> outc$i\::Classifier(12/0806, 12/0800 23/11 36/02ba 55/00, 12/0800 23/11 36/02ba, -);
+	outc$i\[0] -> outctl$i\::$queue($capacity);
+	outc$i\[1] -> outctl$i;
+	outc$i\[2] -> outfwd$i\::$queue($capacity);
+	outc$i\[3] -> outdata$i\::$data_queue($capacity);
+	outsched$i\::OLSRPrioSched(0, $prio_sched)
+		-> ${residence}todevice$i;
+	outctl$i -> [0]outsched$i;
+	outfwd$i -> [1]outsched$i;
+	outdata$i -> [2]outsched$i;";
+}
+
 my $suffix="";
 
 print "elementclass OLSRnode {
@@ -293,6 +545,18 @@ if ($in_simulator eq 1) {
 	";
 	$suffix="simnet";
 }
+elsif (($in_userlevel eq 1) && ($replay ne "")) {
+	print "
+	fromlocal::Idle
+		-> fromhost_cl::Classifier(12/0806, 12/0800);
+
+	fromhost_cl[0]
+		-> tolocal::Discard;
+		
+	";
+
+	$suffix="eth";
+}
 elsif ($in_userlevel eq 1) {
 	print "
 	fromlocal::FromHost(fake0, \$my_ip0/24)
@@ -328,9 +592,11 @@ if ($in_kernel eq 1) {
 
 print "
 	joinInput::Join($n);
+	joinOLSR::Join($n);
 
 	forward::OLSRForward(\$d_hold, duplicate_set, neighbor_info, interface_info, interfaces, \$my_ip0)
-	interface_info::OLSRInterfaceInfoBase(routing_table, interfaces);
+	expiry_queue::OLSRExpiryQueue
+	interface_info::OLSRInterfaceInfoBase(routing_table, interfaces, EXPIRY_QUEUE expiry_queue);
 	interfaces::OLSRLocalIfInfoBase(";
 
 for(my $i = 0; $i < $n - 1; $i++) {
@@ -338,10 +604,14 @@ for(my $i = 0; $i < $n - 1; $i++) {
 }
 
 print "\$my_ip", $n-1, ")
+";
 
+if ($use_arp) {
+	print "
 	// in kernel ARP responses are copied to each ARPQuerier and the host.
 
 	arpt::Tee(",$arpn,");";
+}
 
 
 for(my $i = 0; $i < $n; $i++) {
@@ -349,29 +619,45 @@ for(my $i = 0; $i < $n; $i++) {
 		print "
 	in$i\::FromSimDevice(",$ifname[$i],",4096)
 	todevice$i\::ToSimDevice(",$ifname[$i],");
-	out$i\::Queue(20)
-		-> todevice$i;
+	", output_queue($i, 20), "
+		";
+	}
+	elsif (($in_userlevel eq 1) && ($replay ne "")) {
+		if ($i eq 0) {
+			print "
+	FromDump($replay, TIMING false, STOP true)
+		-> replay::OLSRReplay(SPEEDUP $replay_speedup)
+		-> in$i\::Null;";
+		}
+		else {
+			print "
+	in$i\::Idle;";
+		}
+		print "
+	out$i\::Discard;
 		";
 	}
 	elsif (($in_userlevel eq 1) || ($in_kernel eq 1)) {
 		print "
 	in$i\::FromDevice(",$ifname[$i],")
 	todevice$i\::ToDevice(",$ifname[$i],");
-	out$i\::Queue(100)
-		-> todevice$i;
+	", output_queue($i, 100), "
 		";
 	}
 	
 	print "
 	// Input and output paths for ",$ifname[$i],"
-	c$i\::Classifier(12/0806 20/0001, 12/0806 20/0002, 12/0800, -);
-	in$i	-> SetTimestamp
+	c$i\::Classifier(12/0806 20/0001, 12/0806 20/0002, 12/0800 14/45 23/11 36/02ba, 12/0800, -);
+	in$i	-> SetTimestamp",($residence_time ? "
+		-> SetTimestamp(FIRST true)" : ""),"
 		-> HostEtherFilter(\$my_ether$i, DROP_OWN false, DROP_OTHER true)
 		-> c$i;
 
-	joindevice$i\::Join(3)
+	joindevice$i\::Join($njoindevice)
 		-> out$i;
-		
+		";
+	if ($use_arp) {
+		print "
 	c$i\[0]	-> ar$i\::OLSRARPResponder(\$my_ip$i \$my_ether$i)
 		-> [1]joindevice$i;
 		
@@ -380,16 +666,41 @@ for(my $i = 0; $i < $n; $i++) {
 		
 	c$i\[1]	-> arpt;
 	arpt[$i]	-> [1]arpq$i;
+";
+	}
+	else {
+		print "
+	c$i\[0]	-> Discard;
+	c$i\[1]	-> Discard;
+	arpq$i\::OLSRSimEtherEncap(\$my_ip$i, \$my_ether$i)
+		-> [1]joindevice$i;
+";
+	}
+	print "
 
 	c$i\[2]	-> Paint($i)
+		-> [$i]joinOLSR;
+
+	c$i\[3]	-> Paint($i)
 		-> [$i]joinInput;
 
-	c$i\[3]	-> Discard;
+	c$i\[4]	-> Discard;
 
 	output$i\::Join(2)
-		-> OLSRAddPacketSeq(\$my_ip$i)
-		-> UDPIPEncap(\$my_ip$i , 698, 255.255.255.255, 698)
-		-> EtherEncap(0x0800, \$my_ether$i , ff:ff:ff:ff:ff:ff)
+		-> ";
+
+	if ($auth_key ne "") {
+		print "OLSRAuthenticate(false, duplicate_set, \$my_ip0, KEY \\<$auth_key>)
+		-> ";
+	}
+
+	if ($aggregate >= 0) {
+		print "OLSRAggregator(DELAY $aggregate)
+		-> ";
+	}
+
+	# packet header, IP, UDP and Ethernet headers from one template
+	print "OLSRPacketOutput(\$my_ip$i, \$my_ether$i)
 		-> ";
 
  	if ($Jitter_all > 0) {
@@ -399,8 +710,18 @@ for(my $i = 0; $i < $n; $i++) {
  	}
 
 	print "[0]joindevice$i;
+";
 
-	hello_generator$i\::OLSRHelloGenerator(\$hello_period, \$n_hold, link_info, neighbor_info, interface_info, forward, \$my_ip$i, \$my_ip0)
+	if ($data_flood) {
+		print "
+	data_flood_out[$i]
+		-> EtherEncap(0x0800, \$my_ether$i, ff:ff:ff:ff:ff:ff)
+		-> [", $njoindevice - 1, "]joindevice$i;
+";
+	}
+
+	print "
+	hello_generator$i\::OLSRHelloGenerator(\$hello_period, \$n_hold, link_info, neighbor_info, interface_info, forward, \$my_ip$i, \$my_ip0$link_quality$compact)
 		-> [1]output$i
 
 	";
@@ -413,15 +734,15 @@ if ($in_kernel eq 1) {
 }
 
 print "
-	duplicate_set::OLSRDuplicateSet
+	duplicate_set::OLSRDuplicateSet(EXPIRY_QUEUE expiry_queue)
 	olsrclassifier::OLSRClassifier(duplicate_set, interfaces, \$my_ip0)
 	check_header::OLSRCheckPacketHeader(duplicate_set)
 
 	// Input
 	
 	ip_classifier::IPClassifier(udp port 698,-)
-	get_src_addr::GetIPAddress(12)
-	get_dst_addr::GetIPAddress(16)
+	get_src_addr::GetIPAddress(12)", ($forward_combo > 0 ? "" : "
+	get_dst_addr::GetIPAddress(16)"), "
 
 	joinInput
 		-> MarkEtherHeader
@@ -429,11 +750,37 @@ print "
 		-> CheckIPHeader
 		-> ip_classifier
 
+	// OLSR packets without IP options, which the interface classifiers
+	// already told apart, skip ip_classifier
+	joinOLSR
+		-> MarkEtherHeader
+		-> Strip(14)
+		-> CheckIPHeader
+		-> ", ($control_thread >= 0 ? "control_queue" : "get_src_addr"), "
+
 	ip_classifier[0]
-		-> get_src_addr
+		-> ";
+
+if ($control_thread >= 0) {
+	# the control plane Tasks all run on one thread: the infobases are not
+	# locked, the data path only reads the route table, which is switched
+	# atomically
+	print "control_queue::ThreadSafeQueue(1000)
+		-> control_unqueue::Unqueue
+		-> ";
+}
+
+print "get_src_addr
 		-> Strip(28)
 		-> check_header
-		-> olsrclassifier
+		-> ";
+
+if ($auth_key ne "") {
+	print "OLSRAuthenticate(true, duplicate_set, \$my_ip0, KEY \\<$auth_key>)
+		-> ";
+}
+
+print "olsrclassifier
 
 	check_header[1]
 		-> Discard
@@ -442,22 +789,22 @@ print "
 
 	// olsr control message handling
 	
-	neighbor_info::OLSRNeighborInfoBase(routing_table, tc_generator, hello_generator0, link_info, interface_info, \$my_ip0, ADDITIONAL_HELLO $additional_hello_msgs);
-	topology_info::OLSRTopologyInfoBase(routing_table);
-	link_info::OLSRLinkInfoBase(neighbor_info, interface_info, duplicate_set, routing_table,tc_generator)
+	neighbor_info::OLSRNeighborInfoBase(routing_table, tc_generator, hello_generator0, link_info, interface_info, \$my_ip0, ADDITIONAL_HELLO $additional_hello_msgs, EXPIRY_QUEUE expiry_queue$defer_mpr$link_quality);
+	topology_info::OLSRTopologyInfoBase(routing_table, EXPIRY_QUEUE expiry_queue);
+	link_info::OLSRLinkInfoBase(neighbor_info, interface_info, duplicate_set, routing_table,tc_generator, EXPIRY_QUEUE expiry_queue)
 ";
 
 if ($hna < 1) {
 	print "
-	routing_table::OLSRRoutingTable(neighbor_info, link_info, topology_info, interface_info,\$my_ip0);
+	routing_table::OLSRRoutingTable(neighbor_info, link_info, topology_info, interface_info,\$my_ip0$link_quality);
 	olsrclassifier[4]
 		-> [2]join_fw
 	";
 }
 else {
 	print "
-	association_info::OLSRAssociationInfoBase(routing_table);
-	routing_table::OLSRRoutingTable(neighbor_info, link_info, topology_info, interface_info, interfaces, association_info, linear_ip_lookup, \$my_ip0);
+	association_info::OLSRAssociationInfoBase(routing_table, EXPIRY_QUEUE expiry_queue);
+	routing_table::OLSRRoutingTable(neighbor_info, link_info, topology_info, interface_info, interfaces, association_info, linear_ip_lookup, \$my_ip0$link_quality", ($multipath > 1 ? ", MULTIPATH $multipath" : ""), ($gateway_balance ? ", GATEWAY_BALANCE true" : ""), ($aggregate_routes ? ", AGGREGATE true" : ""), ($lazy_routes ? ", LAZY true" : ""), ");
 	process_hna::OLSRProcessHNA(association_info, neighbor_info, routing_table, \$my_ip0);
 	olsrclassifier[4]
 		-> process_hna
@@ -471,15 +818,15 @@ else {
 }
 
 print "
-	process_hello::OLSRProcessHello(\$n_hold, link_info, neighbor_info, interface_info, routing_table, tc_generator, interfaces, \$my_ip0);
-	process_tc::OLSRProcessTC(topology_info, neighbor_info, interface_info, routing_table, \$my_ip0);
+	process_hello::OLSRProcessHello(\$n_hold, link_info, neighbor_info, interface_info, routing_table, tc_generator, interfaces, \$my_ip0$link_quality$hysteresis);
+	process_tc::OLSRProcessTC(topology_info, neighbor_info, interface_info, routing_table, \$my_ip0, LOCAL_IFACES interfaces);
 	process_mid::OLSRProcessMID(interface_info, routing_table);
 
 	olsrclassifier[0]
 		-> Discard
 	olsrclassifier[1]
-		-> AddARPEntry(arpq0)
-		-> process_hello
+		-> ", ($use_arp ? "AddARPEntry(arpq0)
+		-> " : ""), "process_hello
 		-> Discard
 
 	olsrclassifier[2]
@@ -540,37 +887,96 @@ print "
 
 	dst_classifier::IPClassifier(dst \$my_ip0, -);";
 
+$route_cache = 0 if ($hna < 1);
+$multipath = 1 if ($hna < 1);
+$gateway_balance = 0 if ($hna < 1);
+$gateway_tunnel = 0 if ($hna < 1);
+my $multipath_lookup = ($multipath > 1 || $gateway_balance);
+$route_cache = 0 if ($multipath_lookup || $forward_combo > 0);
+my $route_lookup = ($multipath_lookup ? "multipath_lookup" : $route_cache > 0 ? "route_cache" : "linear_ip_lookup");
+
 if ($hna < 1) {
 	print "
 	get_next_hop::OLSRGetNextHop(routing_table,interfaces) ";
 }
 else {
 	print "
-	linear_ip_lookup::OLSRLinearIPLookup()
+	linear_ip_lookup::OLSRRadixIPLookup()
+	";
+}
+
+if ($route_cache > 0) {
+	print "
+	route_cache::OLSRRouteCache(routing_table, linear_ip_lookup, SIZE $route_cache)
+	Idle -> linear_ip_lookup;
+	";
+}
+
+if ($multipath_lookup) {
+	print "
+	multipath_lookup::OLSRMultipathLookup(routing_table, linear_ip_lookup)
+	Idle -> linear_ip_lookup;
 	";
 }
 
 print "
-	join_cl::Join(2);
-	ttl::DecIPTTL
+	join_cl::Join(2);", ($forward_combo > 0 ? "" : "
+	ttl::DecIPTTL"), "
 	fromhost_cl[1]
 		-> Strip(14)
 		-> MarkIPHeader
-		-> [0]join_cl;
+		-> ", ($data_flood ? "host_flood_cl::IPClassifier(dst net 224.0.0.0/4 or dst host 255.255.255.255, -);
+	host_flood_cl[1]
+		-> " : ""), ($gateway_tunnel ? "gateway_tunnel::OLSRGatewayTunnel(association_info, routing_table, \$my_ip0)
+		-> " : ""), "[0]join_cl;
 
 	join_cl	-> dst_classifier
 	
 	ip_classifier[1]
-		-> [1]join_cl
+		-> ", ($aggregate_data >= 0 ? "OLSRDataDeaggregator
+		-> " : ""), ($data_flood ? "flood_cl::IPClassifier(dst net 224.0.0.0/4 or dst host 255.255.255.255, -);
+	flood_cl[1]
+		-> " : ""), ($gateway_tunnel ? "gateway_decap::OLSRGatewayDecap(\$my_ip0)
+		-> " : ""), "[1]join_cl
 
 	dst_classifier[0]
 		-> EtherEncap(0x0800, 1:1:1:1:1:1, 0:1:2:3:4:5)
 		-> tolocal
 
 	dst_classifier[1]
-		-> ttl";
+		-> ", ($forward_combo > 0 ? "forward_combo" : "ttl");
+
+if ($data_flood) {
+	my @arp_queriers = map { "arpq$_" } (0 .. $n - 1);
+	print "
+	data_flood::OLSRDataFlood(neighbor_info, interface_info, @arp_queriers)
+	flood_cl[0]
+		-> [0]data_flood;
+	host_flood_cl[0]
+		-> [1]data_flood;
+	data_flood[0]
+		-> EtherEncap(0x0800, 1:1:1:1:1:1, 0:1:2:3:4:5)
+		-> tolocal;
+	data_flood[1]
+		-> data_flood_out::Tee($n);
+";
+}
 		
-if ($hna < 1) {
+if ($forward_combo > 0) {
+	my @arp_queriers = map { "arpq$_" } (0 .. $n - 1);
+	print "
+	forward_combo::OLSRForwardCombo(routing_table, linear_ip_lookup, @arp_queriers, SIZE $forward_combo)
+	Idle -> linear_ip_lookup;
+	";
+	for (my $i = 0; $i < $n; $i++) {
+		print "
+	forward_combo[$i]
+		-> [3]joindevice$i
+	forward_combo[", $n + $i, "]
+		-> [0]arpq$i\n";
+	}
+}
+elsif ($hna < 1) {
 	print "
 	ttl[0]	-> get_next_hop
 	ttl[1]	-> Discard
@@ -584,24 +990,67 @@ if ($hna < 1) {
 else {
 	print "
 	ttl[0]	-> get_dst_addr
-		-> linear_ip_lookup
+		-> $route_lookup
 
 	ttl[1]	-> Discard
 
 	";
 }
 
-for(my $i = 0; $i < $n; $i++) {
+for(my $i = 0; $i < $n && $forward_combo == 0; $i++) {
 	print "
-	linear_ip_lookup[$i]
-		-> [0]arpq$i\n";
+	$route_lookup\[$i]
+		-> ", ($aggregate_data >= 0 ? "data_aggregator$i\::OLSRDataAggregator(\$my_ip$i, DELAY $aggregate_data)
+		-> " : ""), "[0]arpq$i\n";
 }
 
 print "
 	mid_generator::OLSRMIDGenerator(\$mid_period, \$m_hold,interfaces)
-	tc_generator::OLSRTCGenerator(\$tc_period, \$t_hold, neighbor_info, \$my_ip0, ADDITIONAL_TC $additional_tc_msgs)
+	tc_generator::OLSRTCGenerator(\$tc_period, \$t_hold, neighbor_info, \$my_ip0, ADDITIONAL_TC $additional_tc_msgs$fisheye$tc_link_quality$compact)
 ";
 
+if ($adaptive_intervals) {
+	my @hello_generators = map { "hello_generator$_" } (0 .. $n - 1);
+	print "	adaptive_intervals::OLSRAdaptiveIntervals(link_info, topology_info, tc_generator, @hello_generators, PROCESS_HELLO process_hello)
+";
+}
+
+if ($snapshot ne "") {
+	print "	snapshot::OLSRSnapshot($snapshot, topology_info, interface_info, routing_table", ($hna < 1 ? "" : ", ASSOCIATION_INFO association_info"), ", INTERVAL \$tc_period, HOLD \$t_hold)
+";
+}
+
+if ($control_deadline > 0) {
+	# the control plane ahead of the data path: HELLOs that wait behind
+	# busy Unqueues miss neighbor hold times and break links
+	my @deadline = ("routing_table", "neighbor_info", "forward", "expiry_queue",
+			"tc_generator", "mid_generator", map { "hello_generator$_" } (0 .. $n - 1));
+	push @deadline, "control_unqueue" if $control_thread >= 0;
+	push @deadline, "adaptive_intervals" if $adaptive_intervals;
+	push @deadline, "hna_generator" if $hna_gen >= 1;
+	print "	ScheduleInfo(", join(", ", map { "$_ 1 ${control_deadline}ms" } @deadline), ")
+";
+}
+
+if ($control_thread >= 0) {
+	# the timers of the expiry queue and the generators hand over to
+	# Tasks of their elements, which run on the control thread too
+	my @control = ("control_unqueue", "routing_table", "neighbor_info", "expiry_queue",
+		       "tc_generator", "mid_generator", map { "hello_generator$_" } (0 .. $n - 1));
+	push @control, "adaptive_intervals" if $adaptive_intervals;
+	push @control, "hna_generator" if $hna_gen >= 1;
+	my @sched = map { "$_ $control_thread" } @control;
+	# each interface's device elements on a thread of their own; the data
+	# path runs on the thread that received the packet, and reads the
+	# routes that the control thread publishes, without locks
+	for (my $i = 0; $interface_threads >= 0 && $i < $n; $i++) {
+		my $t = $interface_threads + $i;
+		push @sched, "in$i $t", "todevice$i $t";
+	}
+	print "	StaticThreadSched(", join(", ", @sched), ")
+";
+}
+
 if ($hna_gen <1 ) {
 	print "
 	joinforward::Join(2)
@@ -609,7 +1058,7 @@ if ($hna_gen <1 ) {
 }
 else {
 	print"
-	hna_generator::OLSRHNAGenerator(\$tc_period, \$t_hold, \$my_ip0)
+	hna_generator::OLSRHNAGenerator(\$tc_period, \$t_hold, \$my_ip0", ($gateway_capacity > 0 ? ", CAPACITY $gateway_capacity" : ""), ")
 	joinforward::Join(3)
 	hna_generator
 		-> [2]joinforward
@@ -640,8 +1089,9 @@ if ($in_simulator != 1) {
 	}
 }
 
+# a replay is read through handlers, e.g. olsr/replay.results
 print "
-OLSRnode(";
+", ($replay ne "" ? "olsr::" : ""), "OLSRnode(";
 
 if ($in_simulator) {
 	for(my $i = 0; $i < $n; $i++) {
@@ -655,3 +1105,7 @@ else {
 }
 
 print "$hello_interval, $tc_interval, $mid_interval, $Jitter, $neighb_hold_time, $top_hold_time, $mid_hold_time, $dup_hold_time);\n";
+
+if ($flatten || $precompile) {
+	close(STDOUT) or bail("click tools failed, the configuration is incomplete");
+}
@@ -0,0 +1,28 @@
+#!/bin/bash
+
+# Replays a trace of OLSR traffic through the receive pipeline of one node,
+# once as configured and once compiled with click-fastclassifier and
+# click-devirtualize (make-olsr-config.pl --precompile), and prints the
+# messages per second of both runs, as OLSRReplay measures them.
+
+if (( $# < 1 ))
+then
+	echo "Usage: olsr-devirtualize-bench.sh TRACE [RUNS]"
+	exit 1;
+fi
+
+TRACE=$1
+RUNS=${2:-3}
+ARGS="-u -i eth0 -a 10.0.0.1 --ether 00:01:02:03:04:05 --replay $TRACE --replay-speedup 0"
+
+perl make-olsr-config.pl $ARGS --flatten > bench-plain.click || exit 2
+perl make-olsr-config.pl $ARGS --precompile > bench-devirt.click || exit 2
+
+for config in bench-plain bench-devirt
+do
+	for (( run = 0; run < RUNS; run++ ))
+	do
+		echo -n "$config: "
+		click -h olsr/replay.results $config.click 2>&1 | grep "messages_per_sec"
+	done
+done
@@ -303,9 +303,13 @@ void
 FromIPSummaryDump::bang_binary(const String &line, ErrorHandler *errh)
 {
     Vector<String> words;
+    int version = 1;
     cp_spacevec(line, words);
-    if (words.size() != 1)
+    if (words.size() > 2
+	|| (words.size() == 2 && !cp_integer(words[1], &version)))
 	_ff.error(errh, "bad !binary specification");
+    else if (version < 1 || version > IPSummaryDump::BINARY_VERSION)
+	_ff.error(errh, "unknown binary record version %d", version);
     _binary = true;
     _ff.set_landmark_pattern("%f:record %l");
     _ff.set_lineno(1);
@@ -32,6 +32,11 @@ FromIPSummaryDump reads from the file named FILENAME unless FILENAME is a
 single dash 'C<->', in which case it reads from the standard input. It will
 not uncompress the standard input, however.
 
+Uncompressed files are mapped into memory, and the records of a binary dump
+(see ToIPSummaryDump's BINARY keyword) are parsed where they lie in the
+mapping, without copying them. Binary dumps are therefore the fastest to
+read back; the MMAP keyword, true by default, turns the mapping off.
+
 Keyword arguments are:
 
 =over 8
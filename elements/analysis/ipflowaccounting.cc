@@ -0,0 +1,342 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ipflowaccounting.{cc,hh} -- counts packets and bytes per IP flow and per
+ * next hop in fixed memory
+ */
+
+#include <click/config.h>
+#include "ipflowaccounting.hh"
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+CLICK_DECLS
+
+IPFlowAccounting::IPFlowAccounting()
+    : _flows(0), _hops(0), _f(0), _timer(this)
+{
+}
+
+IPFlowAccounting::~IPFlowAccounting()
+{
+}
+
+int
+IPFlowAccounting::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _nflows = 4096;
+    _nhops = 64;
+    _interval = Timestamp(60, 0);
+    if (cp_va_kparse(conf, this, errh,
+		     "FLOWS", 0, cpInteger, &_nflows,
+		     "NEXT_HOPS", 0, cpInteger, &_nhops,
+		     "FILENAME", 0, cpFilename, &_filename,
+		     "INTERVAL", 0, cpTimestamp, &_interval,
+		     cpEnd) < 0)
+	return -1;
+    if (_nflows < PROBES || _nflows > (1 << 24))
+	return errh->error("FLOWS must be between %d and %d", PROBES, 1 << 24);
+    if (_nhops < PROBES || _nhops > (1 << 16))
+	return errh->error("NEXT_HOPS must be between %d and %d", PROBES, 1 << 16);
+    return 0;
+}
+
+int
+IPFlowAccounting::initialize(ErrorHandler *errh)
+{
+    int n = PROBES;
+    while (n < _nflows)
+	n <<= 1;
+    _nflows = n;
+    _flow_mask = n - 1;
+    for (n = PROBES; n < _nhops; n <<= 1)
+	/* nada */;
+    _nhops = n;
+    _hop_mask = n - 1;
+    if (!(_flows = new Flow[_nflows]) || !(_hops = new NextHop[_nhops]))
+	return errh->error("out of memory!");
+    clear();
+
+    if (_filename) {
+	if (!(_f = fopen(_filename.c_str(), "wb")))
+	    return errh->error("%s: %s", _filename.c_str(), strerror(errno));
+	fputs("!IPFlowAccounting 1\n", _f);
+	_timer.initialize(this);
+	if (_interval)
+	    _timer.schedule_after(_interval);
+    }
+    return 0;
+}
+
+void
+IPFlowAccounting::cleanup(CleanupStage)
+{
+    if (_f) {
+	export_counts(Timestamp::now());
+	fclose(_f);
+	_f = 0;
+    }
+    delete[] _flows;
+    delete[] _hops;
+    _flows = 0;
+    _hops = 0;
+}
+
+void
+IPFlowAccounting::clear()
+{
+    for (int i = 0; i < _nflows; i++)
+	_flows[i].last_used = 0;
+    for (int i = 0; i < _nhops; i++)
+	_hops[i].used = false;
+    memset(&_other_hop, 0, sizeof(_other_hop));
+    _ticks = _count = _evictions = 0;
+    _interval_start = Timestamp::now();
+}
+
+/**
+ * returns the slot of flow, taking a free slot or evicting the least
+ * recently used of its PROBES slots for a new flow
+ */
+IPFlowAccounting::Flow *
+IPFlowAccounting::lookup(const IPFlowID &flow, uint8_t proto, const Timestamp &now)
+{
+    uint32_t h = flow.hashcode() ^ proto;
+    h ^= h >> 16;
+    Flow *victim = 0;
+    for (int i = 0; i < PROBES; i++) {
+	Flow *f = &_flows[(h + i) & _flow_mask];
+	if (!f->last_used) {
+	    victim = f;
+	    break;
+	} else if (f->flow == flow && f->proto == proto)
+	    return f;
+	else if (!victim || (int32_t) (f->last_used - victim->last_used) < 0)
+	    victim = f;
+    }
+
+    if (victim->last_used) {
+	if (_f)
+	    write_flow_record(*victim);
+	_evictions++;
+    } else
+	_count++;
+    victim->flow = flow;
+    victim->proto = proto;
+    victim->packets = 0;
+    victim->bytes = 0;
+    victim->first = now;
+    victim->last_used = 0;
+    return victim;
+}
+
+IPFlowAccounting::NextHop *
+IPFlowAccounting::lookup_hop(uint32_t addr)
+{
+    uint32_t h = ntohl(addr);
+    h ^= h >> 12;
+    for (int i = 0; i < PROBES; i++) {
+	NextHop *nh = &_hops[(h + i) & _hop_mask];
+	if (!nh->used) {
+	    nh->addr = addr;
+	    nh->used = true;
+	    nh->flows = nh->packets = 0;
+	    nh->bytes = 0;
+	    return nh;
+	} else if (nh->addr == addr)
+	    return nh;
+    }
+    return &_other_hop;
+}
+
+Packet *
+IPFlowAccounting::simple_action(Packet *p)
+{
+    const click_ip *iph = p->ip_header();
+    if (!iph)
+	return p;
+
+    IPFlowID flow(iph->ip_src.s_addr, 0, iph->ip_dst.s_addr, 0);
+    if ((iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP)
+	&& IP_FIRSTFRAG(iph) && p->transport_length() >= 4) {
+	const click_udp *udph = p->udp_header();
+	flow.assign(iph->ip_src.s_addr, udph->uh_sport,
+		    iph->ip_dst.s_addr, udph->uh_dport);
+    }
+    uint32_t next_hop = p->dst_ip_anno().addr();
+    if (!next_hop)
+	next_hop = iph->ip_dst.s_addr;
+
+    Timestamp now = p->timestamp_anno();
+    if (!now)
+	now = Timestamp::now();
+
+    Flow *f = lookup(flow, iph->ip_p, now);
+    NextHop *nh = lookup_hop(next_hop);
+    if (!f->last_used)
+	nh->flows++;
+    if (!++_ticks)
+	_ticks = 1;
+    f->last_used = _ticks;
+    f->next_hop = next_hop;
+    f->packets++;
+    f->bytes += p->length();
+    f->last = now;
+    nh->packets++;
+    nh->bytes += p->length();
+    return p;
+}
+
+static inline unsigned char *
+put4(unsigned char *s, uint32_t v)
+{
+    s[0] = v >> 24;
+    s[1] = v >> 16;
+    s[2] = v >> 8;
+    s[3] = v;
+    return s + 4;
+}
+
+void
+IPFlowAccounting::write_flow_record(const Flow &f)
+{
+    // ports and addresses are already in network byte order
+    uint16_t ports[2] = { f.flow.sport(), f.flow.dport() };
+    uint32_t addrs[3] = { f.flow.saddr().addr(), f.flow.daddr().addr(), f.next_hop };
+    unsigned char buf[RECORD_SIZE], *s = buf;
+    *s++ = REC_FLOW;
+    *s++ = f.proto;
+    memcpy(s, ports, 4);
+    s[4] = s[5] = 0;
+    memcpy(s + 6, addrs, 12);
+    s = put4(s + 18, f.packets);
+    s = put4(s, (uint32_t) (f.bytes >> 32));
+    s = put4(s, (uint32_t) f.bytes);
+    s = put4(s, f.first.sec());
+    put4(s, f.last.sec());
+    ignore_result(fwrite(buf, 1, RECORD_SIZE, _f));
+}
+
+void
+IPFlowAccounting::write_hop_record(const NextHop &nh, const Timestamp &now)
+{
+    unsigned char buf[RECORD_SIZE], *s = buf;
+    memset(buf, 0, 8);
+    buf[0] = REC_NEXT_HOP;
+    s = put4(s + 8, nh.flows);
+    s = put4(s, 0);
+    memcpy(s, &nh.addr, 4);
+    s = put4(s + 4, nh.packets);
+    s = put4(s, (uint32_t) (nh.bytes >> 32));
+    s = put4(s, (uint32_t) nh.bytes);
+    s = put4(s, _interval_start.sec());
+    put4(s, now.sec());
+    ignore_result(fwrite(buf, 1, RECORD_SIZE, _f));
+}
+
+/**
+ * writes the flows seen since the previous export, and the next hops, then
+ * restarts their counts; forgets the flows not seen
+ */
+void
+IPFlowAccounting::export_counts(const Timestamp &now)
+{
+    for (int i = 0; i < _nflows; i++) {
+	Flow &f = _flows[i];
+	if (!f.last_used)
+	    continue;
+	else if (!f.packets) {
+	    f.last_used = 0;
+	    _count--;
+	} else {
+	    write_flow_record(f);
+	    f.packets = 0;
+	    f.bytes = 0;
+	}
+    }
+    for (int i = 0; i < _nhops; i++)
+	if (_hops[i].used) {
+	    write_hop_record(_hops[i], now);
+	    _hops[i].used = false;
+	}
+    if (_other_hop.packets)
+	write_hop_record(_other_hop, now);
+    memset(&_other_hop, 0, sizeof(_other_hop));
+    fflush(_f);
+    _interval_start = now;
+}
+
+void
+IPFlowAccounting::run_timer(Timer *)
+{
+    export_counts(Timestamp::now());
+    _timer.reschedule_after(_interval);
+}
+
+enum { H_FLOWS, H_NEXT_HOPS, H_COUNT, H_EVICTIONS, H_EXPORT, H_CLEAR };
+
+String
+IPFlowAccounting::read_handler(Element *e, void *thunk)
+{
+    IPFlowAccounting *fa = static_cast<IPFlowAccounting *>(e);
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+      case H_FLOWS:
+	for (int i = 0; i < fa->_nflows; i++) {
+	    const Flow &f = fa->_flows[i];
+	    if (f.last_used)
+		sa << f.flow.saddr() << ' ' << ntohs(f.flow.sport()) << ' '
+		   << f.flow.daddr() << ' ' << ntohs(f.flow.dport()) << ' '
+		   << (int) f.proto << ' ' << IPAddress(f.next_hop) << ' '
+		   << f.packets << ' ' << f.bytes << ' '
+		   << f.first << ' ' << f.last << '\n';
+	}
+	return sa.take_string();
+      case H_NEXT_HOPS:
+	for (int i = 0; i < fa->_nhops; i++) {
+	    const NextHop &nh = fa->_hops[i];
+	    if (nh.used)
+		sa << IPAddress(nh.addr) << ' ' << nh.flows << ' '
+		   << nh.packets << ' ' << nh.bytes << '\n';
+	}
+	if (fa->_other_hop.packets)
+	    sa << IPAddress() << ' ' << fa->_other_hop.flows << ' '
+	       << fa->_other_hop.packets << ' ' << fa->_other_hop.bytes << '\n';
+	return sa.take_string();
+      case H_COUNT:
+	return String(fa->_count);
+      case H_EVICTIONS:
+	return String(fa->_evictions);
+      default:
+	return String();
+    }
+}
+
+int
+IPFlowAccounting::write_handler(const String &, Element *e, void *thunk, ErrorHandler *errh)
+{
+    IPFlowAccounting *fa = static_cast<IPFlowAccounting *>(e);
+    if ((intptr_t) thunk == H_EXPORT) {
+	if (!fa->_f)
+	    return errh->error("no FILENAME");
+	fa->export_counts(Timestamp::now());
+    } else
+	fa->clear();
+    return 0;
+}
+
+void
+IPFlowAccounting::add_handlers()
+{
+    add_read_handler("flows", read_handler, (void *) H_FLOWS);
+    add_read_handler("next_hops", read_handler, (void *) H_NEXT_HOPS);
+    add_read_handler("count", read_handler, (void *) H_COUNT);
+    add_read_handler("evictions", read_handler, (void *) H_EVICTIONS);
+    add_write_handler("export", write_handler, (void *) H_EXPORT, Handler::BUTTON);
+    add_write_handler("clear", write_handler, (void *) H_CLEAR, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel int64)
+EXPORT_ELEMENT(IPFlowAccounting)
@@ -0,0 +1,194 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_IPFLOWACCOUNTING_HH
+#define CLICK_IPFLOWACCOUNTING_HH
+#include <click/element.hh>
+#include <click/ipflowid.hh>
+#include <click/timer.hh>
+#include <stdio.h>
+CLICK_DECLS
+
+/*
+=c
+
+IPFlowAccounting([I<KEYWORDS>])
+
+=s ipmeasure
+
+counts packets and bytes per IP flow and per next hop in fixed memory
+
+=d
+
+Counts the packets and bytes of every flow that passes through it, and rolls
+them up per next hop, then lets them through unchanged. Meant to run on every
+node of a mesh: together the nodes' counts form the mesh's traffic matrix.
+
+A flow is a source address and port, destination address and port, and IP
+protocol; ports are 0 unless the packet is the first fragment of a TCP or UDP
+datagram. The next hop is the destination IP address annotation, which
+routing elements such as OLSRForwardCombo and LookupIPRoute set to the
+gateway, or the IP destination if the annotation is not set. Packets without
+an IP header are let through uncounted.
+
+Flows live in a table of FLOWS slots, allocated once. A flow can only live in
+one of the 8 slots its hash leads to; when they are all taken, the flow least
+recently seen among them is evicted to make room, and its counts are written
+to the export file first. Next hops live in a table of NEXT_HOPS slots;
+traffic through next hops that find no slot is counted under 0.0.0.0.
+
+With FILENAME, IPFlowAccounting exports its counters every INTERVAL. An
+export writes a record per flow seen in the interval and per next hop, then
+restarts the counts; flows not seen in the interval are dropped from the
+table. The export file is binary (see below) and is written anew at
+initialization.
+
+Keyword arguments are:
+
+=over 8
+
+=item FLOWS
+
+Integer. Number of flow slots, rounded up to a power of two. Default is 4096.
+
+=item NEXT_HOPS
+
+Integer. Number of next hop slots, rounded up to a power of two. Default is
+64.
+
+=item FILENAME
+
+Filename. Export file. Default is none, in which case counts are only
+available through handlers and never restart.
+
+=item INTERVAL
+
+Time in seconds. Export period. Default is 60. Zero means export only when
+the C<export> handler is called.
+
+=back
+
+=n
+
+The export file starts with the ASCII line `C<!IPFlowAccounting 1>', where 1
+is the version of the record layout. 40-byte records follow, with all numbers
+in network byte order:
+
+   Offset  Length  Description
+   0       1       record type: 1 for a flow, 2 for a next hop
+   1       1       IP protocol
+   2       2       source port
+   4       2       destination port
+   6       2       zero
+   8       4       source IP address
+   12      4       destination IP address
+   16      4       next hop IP address
+   20      4       packets
+   24      8       bytes
+   32      4       first seen, seconds
+   36      4       last seen, seconds
+
+Next hop records have zero protocol and ports, and the number of flows that
+started towards the next hop in the interval in place of the source address;
+their destination address is zero, and their times are the start and end of
+the interval. Packets and bytes count since the previous export.
+
+=h flows read-only
+
+Returns the flows in the table, one per line, as `C<SRC SPORT DST DPORT PROTO
+NEXTHOP PACKETS BYTES FIRST LAST>'.
+
+=h next_hops read-only
+
+Returns the next hops, one per line, as `C<NEXTHOP FLOWS PACKETS BYTES>'.
+
+=h count read-only
+
+Returns the number of flows in the table.
+
+=h evictions read-only
+
+Returns the number of flows evicted to make room for others.
+
+=h export write-only
+
+Exports the counters now. Fails without FILENAME.
+
+=h clear write-only
+
+Forgets all flows and next hops without exporting them.
+
+=a
+
+AggregateIPFlows, AggregateCounter, ToIPSummaryDump */
+
+class IPFlowAccounting : public Element { public:
+
+    IPFlowAccounting();
+    ~IPFlowAccounting();
+
+    const char *class_name() const	{ return "IPFlowAccounting"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+    const char *processing() const	{ return AGNOSTIC; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    Packet *simple_action(Packet *);
+    void run_timer(Timer *);
+
+  private:
+
+    enum { PROBES = 8, RECORD_SIZE = 40, REC_FLOW = 1, REC_NEXT_HOP = 2 };
+
+    struct Flow {
+	IPFlowID flow;
+	uint8_t proto;
+	uint32_t next_hop;
+	uint32_t last_used;		// 0 if free
+	uint32_t packets;
+	uint64_t bytes;
+	Timestamp first;
+	Timestamp last;
+    };
+
+    struct NextHop {
+	uint32_t addr;
+	bool used;
+	uint32_t flows;
+	uint32_t packets;
+	uint64_t bytes;
+    };
+
+    Flow *_flows;
+    int _nflows;
+    uint32_t _flow_mask;
+    NextHop *_hops;
+    int _nhops;
+    uint32_t _hop_mask;
+    NextHop _other_hop;			// next hops without a slot
+
+    uint32_t _ticks;
+    uint32_t _count;
+    uint32_t _evictions;
+
+    String _filename;
+    FILE *_f;
+    Timestamp _interval;
+    Timestamp _interval_start;
+    Timer _timer;
+
+    Flow *lookup(const IPFlowID &flow, uint8_t proto, const Timestamp &now);
+    NextHop *lookup_hop(uint32_t addr);
+    void write_flow_record(const Flow &f);
+    void write_hop_record(const NextHop &nh, const Timestamp &now);
+    void export_counts(const Timestamp &now);
+    void clear();
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
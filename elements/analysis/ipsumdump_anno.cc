@@ -26,7 +26,8 @@
 CLICK_DECLS
 
 enum { T_TIMESTAMP, T_TIMESTAMP_SEC, T_TIMESTAMP_USEC, T_TIMESTAMP_USEC1,
-       T_FIRST_TIMESTAMP, T_COUNT, T_LINK, T_DIRECTION, T_AGGREGATE };
+       T_FIRST_TIMESTAMP, T_COUNT, T_LINK, T_DIRECTION, T_AGGREGATE,
+       T_NEXT_HOP };
 
 namespace IPSummaryDump {
 
@@ -71,6 +72,9 @@ static bool anno_extract(PacketDesc& d, const FieldWriter *f)
       case T_AGGREGATE:
 	d.v = AGGREGATE_ANNO(p);
 	return true;
+      case T_NEXT_HOP:
+	d.v = p->dst_ip_anno().addr();
+	return true;
       default:
 	return false;
     }
@@ -113,6 +117,9 @@ static void anno_inject(PacketOdesc& d, const FieldReader *f)
     case T_AGGREGATE:
 	SET_AGGREGATE_ANNO(p, d.v);
 	break;
+    case T_NEXT_HOP:
+	p->set_dst_ip_anno(IPAddress(d.v));
+	break;
     }
 }
 
@@ -131,6 +138,9 @@ static void anno_outa(const PacketDesc& d, const FieldWriter *f)
 	else
 	    *d.sa << d.v;
 	break;
+      case T_NEXT_HOP:
+	*d.sa << IPAddress(d.v);
+	break;
     }
 }
 
@@ -157,6 +167,14 @@ static bool anno_ina(PacketOdesc& d, const String &s, const FieldReader *f)
 	    return true;
 	} else
 	    return cp_integer(s, &d.v);
+    case T_NEXT_HOP: {
+	IPAddress a;
+	if (cp_ip_address(s, &a, d.e)) {
+	    d.v = a.addr();
+	    return true;
+	}
+	break;
+    }
     }
     return false;
 }
@@ -207,7 +225,9 @@ static const IPSummaryDump::FieldWriter anno_writers[] = {
     { "direction", B_1, T_DIRECTION,
       0, anno_extract, anno_outa, outb },
     { "aggregate", B_4, T_AGGREGATE,
-      0, anno_extract, num_outa, outb }
+      0, anno_extract, num_outa, outb },
+    { "next_hop", B_4NET, T_NEXT_HOP,
+      0, anno_extract, anno_outa, outb }
 };
 
 static const IPSummaryDump::FieldReader anno_readers[] = {
@@ -232,7 +252,9 @@ static const IPSummaryDump::FieldReader anno_readers[] = {
     { "direction", B_1, T_DIRECTION, order_anno,
       anno_ina, inb, anno_inject },
     { "aggregate", B_4, T_AGGREGATE, order_anno,
-      num_ina, inb, anno_inject }
+      num_ina, inb, anno_inject },
+    { "next_hop", B_4NET, T_NEXT_HOP, order_anno,
+      anno_ina, inb, anno_inject }
 };
 
 static const IPSummaryDump::FieldSynonym anno_synonyms[] = {
@@ -245,7 +267,8 @@ static const IPSummaryDump::FieldSynonym anno_synonyms[] = {
     { "first_ts", "first_utimestamp" },
     { "pkt_count", "count" },
     { "packet_count", "count" },
-    { "agg", "aggregate" }
+    { "agg", "aggregate" },
+    { "gw", "next_hop" }
 };
 
 }
@@ -32,7 +32,7 @@ CLICK_DECLS
 
 enum { T_IP_SRC, T_IP_DST, T_IP_TOS, T_IP_TTL, T_IP_FRAG, T_IP_FRAGOFF,
        T_IP_ID, T_IP_SUM, T_IP_PROTO, T_IP_OPT, T_IP_LEN, T_IP_CAPTURE_LEN,
-       T_SPORT, T_DPORT, T_IP_HL };
+       T_SPORT, T_DPORT, T_IP_HL, T_IP_HOPS };
 
 namespace IPSummaryDump {
 
@@ -59,6 +59,19 @@ static bool ip_extract(PacketDesc& d, const FieldWriter *f)
 	CHECK(9);
 	d.v = d.iph->ip_ttl;
 	return true;
+      case T_IP_HOPS:
+	// hosts start from one of a few TTLs, and every mesh hop
+	// decrements it, so the distance is the way down to ip_ttl
+	CHECK(9);
+	if (d.iph->ip_ttl > 128)
+	    d.v = 255 - d.iph->ip_ttl;
+	else if (d.iph->ip_ttl > 64)
+	    d.v = 128 - d.iph->ip_ttl;
+	else if (d.iph->ip_ttl > 32)
+	    d.v = 64 - d.iph->ip_ttl;
+	else
+	    d.v = 32 - d.iph->ip_ttl;
+	return true;
       case T_IP_FRAG:
 	CHECK(8);
 	if (IP_ISFRAG(d.iph))
@@ -822,6 +835,8 @@ static const FieldWriter ip_writers[] = {
       ip_prepare, ip_extract, num_outa, outb },
     { "ip_ttl", B_1, T_IP_TTL,
       ip_prepare, ip_extract, num_outa, outb },
+    { "ip_hops", B_1, T_IP_HOPS,
+      ip_prepare, ip_extract, num_outa, outb },
     { "ip_frag", B_1, T_IP_FRAG,
       ip_prepare, ip_extract, ip_outa, outb },
     { "ip_fragoff", B_2, T_IP_FRAGOFF,
@@ -16,6 +16,9 @@ enum { MAJOR_VERSION = 1, MINOR_VERSION = 3 };
 // uses ':' in sack blocks.
 // MINOR_VERSION 2 can have incorrect payload MD5 checksums for some packets
 // (usually short packets with link headers).
+enum { BINARY_VERSION = 1 };
+// BINARY_VERSION is the record layout announced on the '!binary' line; a
+// bare '!binary' line, as older writers produced, means version 1.
 
 
 struct PacketDesc {
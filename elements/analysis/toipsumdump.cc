@@ -31,7 +31,7 @@
 CLICK_DECLS
 
 ToIPSummaryDump::ToIPSummaryDump()
-    : _f(0), _task(this)
+    : _f(0), _buffer(0), _task(this)
 {
 }
 
@@ -51,6 +51,7 @@ ToIPSummaryDump::configure(Vector<String> &conf, ErrorHandler *errh)
     bool binary = false;
     bool header = true;
     bool extra_length = true;
+    _buffer_size = 0;
 
     if (cp_va_kparse(conf, this, errh,
 		     "FILENAME", cpkP+cpkM, cpFilename, &_filename,
@@ -64,6 +65,7 @@ ToIPSummaryDump::configure(Vector<String> &conf, ErrorHandler *errh)
 		     "CAREFUL_TRUNC", 0, cpBool, &careful_trunc,
 		     "EXTRA_LENGTH", 0, cpBool, &extra_length,
 		     "BINARY", 0, cpBool, &binary,
+		     "BUFFER", 0, cpUnsigned, &_buffer_size,
 		     cpEnd) < 0)
 	return -1;
 
@@ -126,6 +128,15 @@ ToIPSummaryDump::initialize(ErrorHandler *errh)
 	_filename = "<stdout>";
     }
 
+    // binary records are small and many, so collect them in large writes
+    if (_buffer_size == 0 && _binary)
+	_buffer_size = 1 << 20;
+    if (_buffer_size && _f != stdout) {
+	if (!(_buffer = new char[_buffer_size]))
+	    return errh->error("out of memory!");
+	setvbuf(_f, _buffer, _IOFBF, _buffer_size);
+    }
+
     if (input_is_pull(0)) {
 	ScheduleInfo::join_scheduler(this, &_task, errh);
 	_signal = Notifier::upstream_empty_signal(this, 0, &_task);
@@ -163,7 +174,7 @@ ToIPSummaryDump::initialize(ErrorHandler *errh)
 
     // binary marker
     if (_binary)
-	sa << "!binary\n";
+	sa << "!binary " << IPSummaryDump::BINARY_VERSION << '\n';
 
     // print output
     if (_header)
@@ -178,6 +189,8 @@ ToIPSummaryDump::cleanup(CleanupStage)
     if (_f && _f != stdout)
 	fclose(_f);
     _f = 0;
+    delete[] _buffer;
+    _buffer = 0;
 }
 
 bool
@@ -57,6 +57,8 @@ contain those fields. Valid field names, with examples, are:
    ip_id        IP ID: '48759'
    ip_tos       IP type of service: '29'
    ip_ttl       IP time-to-live: '254'
+   ip_hops      Hops travelled, guessed from IP TTL as
+                the distance down from 32, 64, 128 or 255: '2'
    ip_sum       IP checksum: '43812'
    ip_opt       IP options (see below)
    sport        TCP/UDP source port: '22'
@@ -97,6 +99,8 @@ contain those fields. Valid field names, with examples, are:
                 for paint 0, '<'/'R'/'X' for paint 1
    link         Like 'direction', but always numeric
    aggregate    Aggregate number (AGGREGATE_ANNO): '973'
+   next_hop     Destination IP address annotation, the
+                next hop after routing: '10.0.0.7'
    first_timestamp   Packet "first timestamp" (FIRST_
                 TIMESTAMP_ANNO): '996033261.451094'
    eth_src      Ethernet source: '00-0A-95-A6-D9-BC'
@@ -131,6 +135,13 @@ of the dump. Ignored if HEADER is false.
 Boolean. If true, then output packet records in a binary format (explained
 below). Defaults to false.
 
+=item BUFFER
+
+Unsigned. Size in bytes of the buffer that collects output before it is
+written to the file. Binary records are a few dozen bytes each, so a large
+buffer turns them into few large writes. Defaults to 1 MB with BINARY, and to
+the stdio default otherwise. Ignored when writing to the standard output.
+
 =item MULTIPACKET
 
 Boolean. If true, and the CONTENTS option doesn't contain 'C<count>', then
@@ -270,9 +281,10 @@ with no options (except possibly EOL and NOP).
 =head1 BINARY FORMAT
 
 Binary IPSummaryDump files begin with several ASCII lines, just like regular
-files. The line 'C<!binary>' indicates that the rest of the file, starting
-immediately after the newline, consists of binary records. Each record looks
-like this:
+files. The line 'C<!binary 1>' indicates that the rest of the file, starting
+immediately after the newline, consists of binary records. The number is the
+version of the record layout described here; older files, whose line is just
+'C<!binary>', have the same layout. Each record looks like this:
 
    +---------------+------------...
    |X|record length|    data
@@ -303,6 +315,7 @@ the 'C<!data>' line, as follows:
    ip_id            2    IP ID
    ip_tos           1    IP TOS
    ip_ttl           1    IP TTL
+   ip_hops          1    hops travelled, from IP TTL
    ip_frag          1    fragment descriptor
                          ('F', 'f', or '.')
    ip_fragoff       2    IP fragment offset field
@@ -322,6 +335,7 @@ the 'C<!data>' line, as follows:
    first_timestamp  8    timestamp sec + usec
    eth_src          6    Ethernet source address
    eth_dst          6    Ethernet destination address
+   next_hop         4    destination IP address annotation
 
 Each field is Length bytes long. Variable-length fields have Length 'C<?>' in
 the table; in a packet record, these fields consist of a single length byte,
@@ -366,6 +380,8 @@ class ToIPSummaryDump : public Element, public IPSummaryDumpInfo { public:
 
     String _filename;
     FILE *_f;
+    char *_buffer;
+    uint32_t _buffer_size;
     Vector<const IPSummaryDump::FieldWriter *> _fields;
     Vector<const IPSummaryDump::FieldWriter *> _prepare_fields;
     bool _verbose : 1;
@@ -26,13 +26,15 @@
 CLICK_DECLS
 
 EtherSwitch::EtherSwitch()
-    : _table(AddrInfo(-1, Timestamp())), _timeout(300)
+    : _table(AddrInfo(-1, Timestamp())), _old_table(AddrInfo(-1, Timestamp())),
+      _timeout(300)
 {
 }
 
 EtherSwitch::~EtherSwitch()
 {
     _table.clear();
+    _old_table.clear();
 }
 
 int
@@ -59,28 +61,56 @@ EtherSwitch::broadcast(int source, Packet *p)
 }
 
 void
-EtherSwitch::push(int source, Packet *p)
+EtherSwitch::rotate(const Timestamp &now)
+{
+    Timestamp period(_timeout, 0);
+    if (now < _period_end + period)
+	_old_table.swap(_table);
+    else			// nothing seen for two periods is still valid
+	_old_table.clear();
+    _table.clear();
+    _period_end = now + period;
+}
+
+int
+EtherSwitch::learn(int source, Packet *p)
 {
-    click_ether* e = (click_ether*) p->data();
-    int outport = -1;		// Broadcast
+    const click_ether *e = (const click_ether *) p->data();
 
     // 0 timeout means dumb switch
-    if (_timeout != 0) {
-	_table.set(EtherAddress(e->ether_shost), AddrInfo(source, p->timestamp_anno()));
-
-	// Set outport if dst is unicast, we have info about it, and the
-	// info is still valid.
-	EtherAddress dst(e->ether_dhost);
-	if (!dst.is_group()) {
-	    if (Table::iterator dst_info = _table.find(dst)) {
-		if (p->timestamp_anno() < dst_info.value().stamp + Timestamp(_timeout, 0))
-		    outport = dst_info.value().port;
-		else
-		    _table.erase(dst_info);
-	    }
-	}
+    if (_timeout == 0)
+	return -1;
+
+    const Timestamp &now = p->timestamp_anno();
+    if (now > _period_end)	// never without timestamps, like timeouts
+	rotate(now);
+
+    EtherAddress src(e->ether_shost);
+    if (AddrInfo *src_info = _table.findp(src))
+	*src_info = AddrInfo(source, now);
+    else {
+	_old_table.erase(src);
+	_table.insert(src, AddrInfo(source, now));
     }
 
+    // Return the port if dst is unicast, we have info about it, and the
+    // info is still valid.
+    EtherAddress dst(e->ether_dhost);
+    if (dst.is_group())
+	return -1;
+    AddrInfo *dst_info = _table.findp(dst);
+    if (!dst_info)
+	dst_info = _old_table.findp(dst);
+    if (dst_info && now < dst_info->stamp + Timestamp(_timeout, 0))
+	return dst_info->port;
+    return -1;
+}
+
+void
+EtherSwitch::push(int source, Packet *p)
+{
+  int outport = learn(source, p);
+
   if (outport < 0)
     broadcast(source, p);
   else if (outport == source)	// Don't send back out on same interface
@@ -96,7 +126,9 @@ EtherSwitch::reader(Element* f, void *thunk)
     switch ((intptr_t) thunk) {
     case 0: {
 	StringAccum sa;
-	for (Table::iterator iter = sw->_table.begin(); iter.live(); iter++)
+	for (Table::const_iterator iter = sw->_table.begin(); iter.live(); iter++)
+	    sa << iter.key() << ' ' << iter.value().port << '\n';
+	for (Table::const_iterator iter = sw->_old_table.begin(); iter.live(); iter++)
 	    sa << iter.key() << ' ' << iter.value().port << '\n';
 	return sa.take_string();
     }
@@ -2,7 +2,7 @@
 #define CLICK_ETHERSWITCH_HH
 #include <click/element.hh>
 #include <click/etheraddress.hh>
-#include <click/hashtable.hh>
+#include <click/flathashmap.hh>
 CLICK_DECLS
 
 /*
@@ -43,8 +43,13 @@ of inactivity.  If 0, the element acts like a dumb hub.  Default is 300.
 
 =n
 
-The EtherSwitch element has no limit on the memory consumed by cached Ethernet
-addresses.
+Addresses are kept in two open-addressed tables, one per TIMEOUT period.
+Each period the older table is dropped whole and the newer one takes its
+place, so an address inactive for between one and two TIMEOUTs is forgotten
+without any scan of the table; an address seen again meanwhile moves to the
+newer table.  Periods are measured with the packets' timestamp annotations,
+as are timeouts.  Memory thus stays proportional to the addresses seen in the
+last two periods.
 
 =h table read-only
 
@@ -77,16 +82,25 @@ class EtherSwitch : public Element { public:
     struct AddrInfo {
 	int port;
 	Timestamp stamp;
+	AddrInfo() : port(-1) { }
 	inline AddrInfo(int p, const Timestamp &t);
     };
 
+  protected:
+
+    // learns p's source, returns the port for its destination or -1 to flood
+    int learn(int source, Packet *p);
+    void broadcast(int source, Packet*);
+
   private:
 
-    typedef HashTable<EtherAddress, AddrInfo> Table;
-    Table _table;
+    typedef FlatHashMap<EtherAddress, AddrInfo> Table;
+    Table _table;		// addresses seen this period
+    Table _old_table;		// in the last period, and not since
+    Timestamp _period_end;
     uint32_t _timeout;
 
-    void broadcast(int source, Packet*);
+    void rotate(const Timestamp &now);
 
     static String reader(Element *, void *);
     static int writer(const String &, Element *, void *, ErrorHandler *);
@@ -503,6 +503,7 @@ DSDVRouteTable::expire_hook(const IPAddress &ip)
 void
 DSDVRouteTable::schedule_triggered_update(const IPAddress &ip, unsigned int when)
 {
+  _ad_pending.insert(ip, 1);
   check_invariants();
 
   // get rid of outstanding triggered request (if any)
@@ -606,7 +607,7 @@ DSDVRouteTable::init_metric(RTEntry &r)
 #if SEQ_METRIC
   if (_use_seq_metric) {
     r.metric = metric_t(r.num_hops());
-    DEQueue<unsigned> *q = _seq_history.findp(r.dest_ip);
+    BcastHistory *q = _seq_history.findp(r.dest_ip);
     if (!q || q->size() < MAX_BCAST_HISTORY)
       r.metric = _bad_metric;
     else {
@@ -796,6 +797,16 @@ DSDVRouteTable::send_full_update()
   }
   build_and_tx_ad(ad_routes);
 
+  // forget the pending destinations whose flags the dump cleared
+  Vector<IPAddress> done;
+  for (AdSet::iterator i = _ad_pending.begin(); i.live(); i++) {
+    const RTEntry *r = _rtes.findp(i.key());
+    if (!r || (!r->need_seq_ad && !r->need_metric_ad))
+      done.push_back(i.key());
+  }
+  for (int i = 0; i < done.size(); i++)
+    _ad_pending.remove(done[i]);
+
   /*
    * Update the sequence number for periodic updates, but not for
    * triggered updates.  Originating sequence numbers are even,
@@ -823,14 +834,18 @@ DSDVRouteTable::send_triggered_update(const IPAddress &ip)
 
   unsigned int jiff = dsdv_jiffies();
 
+  // only the pending destinations can need an ad
   Vector<RTEntry> triggered_routes;
-  for (RTIter i = _rtes.begin(); i.live(); i++) {
-    const RTEntry &r = i.value();
-
-    if ((r.need_seq_ad || r.need_metric_ad) &&
-	r.advertise_ok_jiffies <= jiff)
-      triggered_routes.push_back(r);
+  Vector<IPAddress> done;
+  for (AdSet::iterator i = _ad_pending.begin(); i.live(); i++) {
+    const RTEntry *r = _rtes.findp(i.key());
+    if (!r || (!r->need_seq_ad && !r->need_metric_ad))
+      done.push_back(i.key());
+    else if (r->advertise_ok_jiffies <= jiff)
+      triggered_routes.push_back(*r);
   }
+  for (int i = 0; i < done.size(); i++)
+    _ad_pending.remove(done[i]);
 #if FULL_DUMP_ON_TRIG_UPDATE
   // ns implementation of dsdv has this ``heuristic'' to decide when
   // to just do a full update.  slightly bogus, i mean, why > 3?
@@ -1046,15 +1061,13 @@ DSDVRouteTable::simple_action(Packet *packet)
 
 #if SEQ_METRIC
   // track last few broadcast numbers we heard directly from this node
-  DEQueue<unsigned> *q = _seq_history.findp(ipaddr);
+  BcastHistory *q = _seq_history.findp(ipaddr);
   if (!q) {
-    _seq_history.insert(ipaddr, DEQueue<unsigned>());
+    _seq_history.insert(ipaddr, BcastHistory());
     q = _seq_history.findp(ipaddr);
   }
   unsigned bcast_num = ntohl(grid_hdr::get_pad_bytes(*gh));
   q->push_back(bcast_num);
-  while (q->size() > MAX_BCAST_HISTORY)
-    q->pop_front();
 #endif
 
   RTEntry new_r(ipaddr, ethaddr, gh, hlo, PAINT_ANNO(packet), jiff);
@@ -1610,6 +1623,7 @@ DSDVRouteTable::RTEntry::dump() const
 void
 DSDVRouteTable::check_invariants(const IPAddress *ignore) const
 {
+#if CHECK_INVARIANTS
   for (RTIter i = _rtes.begin(); i.live(); i++) {
     const RTEntry &r = i.value();
 
@@ -1653,7 +1667,13 @@ DSDVRouteTable::check_invariants(const IPAddress *ignore) const
     else {
       dsdv_assert(!hp);
     }
+
+    // a route that needs an ad is pending for the triggered updates
+    dsdv_assert(!(r.need_seq_ad || r.need_metric_ad) || _ad_pending.findp(r.dest_ip));
   }
+#else
+  (void) ignore;
+#endif
 }
 
 void
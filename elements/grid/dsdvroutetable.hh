@@ -8,7 +8,6 @@
 #include <elements/grid/gridgenericrt.hh>
 #include <click/timer.hh>
 #include <elements/grid/gridgenericlogger.hh>
-#include <click/dequeue.hh>
 #include <elements/grid/gridgenericmetric.hh>
 CLICK_DECLS
 
@@ -187,6 +186,11 @@ CLICK_DECLS
 // William, and Kermode 2002.
 #define ENABLE_SEEN 1
 
+// if 1, check the route table and timer invariants before and after
+// every operation.  Each check walks the whole table, which dominates
+// the cost of the element on large networks.
+#define CHECK_INVARIANTS 0
+
 class GridGatewayInfo;
 
 
@@ -221,7 +225,28 @@ private:
 
 #if SEQ_METRIC
   bool _use_seq_metric; // use the `dsdv_seqs' metric
-  HashMap<IPAddress, DEQueue<unsigned> > _seq_history;
+
+  // the last MAX_BCAST_HISTORY broadcast numbers heard directly from a
+  // node, in a fixed ring rather than a queue allocated per node
+  struct BcastHistory {
+    unsigned seq[MAX_BCAST_HISTORY];
+    unsigned head;  // index of the oldest
+    unsigned count;
+
+    BcastHistory() : head(0), count(0) { }
+    void push_back(unsigned s) {
+      if (count < MAX_BCAST_HISTORY)
+	seq[(head + count++) % MAX_BCAST_HISTORY] = s;
+      else {
+	seq[head] = s;
+	head = (head + 1) % MAX_BCAST_HISTORY;
+      }
+    }
+    unsigned size() const  { return count; }
+    unsigned front() const { return seq[head]; }
+    unsigned back() const  { return seq[(head + count - 1) % MAX_BCAST_HISTORY]; }
+  };
+  HashMap<IPAddress, BcastHistory> _seq_history;
 #endif
 
   typedef GridGenericMetric::metric_t metric_t;
@@ -392,6 +417,14 @@ private:
   TMap _trigger_timers;
   HMap _trigger_hooks;
 
+  // Destinations whose need_seq_ad or need_metric_ad flag may be set:
+  // every place that sets a flag also schedules a triggered update for
+  // the destination, which records it here.  Triggered updates look at
+  // these entries only, instead of the whole table, and drop those
+  // whose flags are clear.
+  typedef HashMap<IPAddress, int> AdSet;
+  AdSet _ad_pending;
+
   // check table, timer, and trigger hook invariants
   void check_invariants(const IPAddress *ignore = 0) const;
 
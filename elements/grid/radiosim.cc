@@ -19,13 +19,16 @@
 #include "radiosim.hh"
 #include <click/confparse.hh>
 #include <click/error.hh>
+#include <click/straccum.hh>
 #include <click/standard/scheduleinfo.hh>
 #include <math.h>
 #include "elements/grid/filterbyrange.hh"
 CLICK_DECLS
 
 RadioSim::RadioSim()
-  : _task(this), _use_xy(false)
+  : _task(this), _cell_lat(RANGE), _cell_lon(RANGE), _lon_cells(1),
+    _index_lat(0), _transmissions(0), _deliveries(0), _delivered_bytes(0),
+    _use_xy(false)
 {
 }
 
@@ -83,36 +86,153 @@ RadioSim::initialize(ErrorHandler *errh)
     _nodes.push_back(no);
   }
 
+  rebuild_index();
   ScheduleInfo::join_scheduler(this, &_task, errh);
 
   return 0;
 }
 
+double
+RadioSim::range(int i, int j) const
+{
+  if (_use_xy) {
+    double dx = _nodes[i]._lat - _nodes[j]._lat;
+    double dy = _nodes[i]._lon - _nodes[j]._lon;
+    return sqrt(dx*dx + dy*dy);
+  } else {
+    grid_location g1 = grid_location(_nodes[i]._lat, _nodes[i]._lon);
+    grid_location g2 = grid_location(_nodes[j]._lat, _nodes[j]._lon);
+    return grid_location::calc_range(g1, g2);
+  }
+}
+
+void
+RadioSim::cell_of(const Node &n, int &row, int &col) const
+{
+  if (_use_xy) {
+    row = (int) floor(n._lat / _cell_lat);
+    col = (int) floor(n._lon / _cell_lon);
+  } else {
+    // columns wrap around at 180 degrees
+    row = (int) floor((n._lat + 90) / _cell_lat);
+    col = ((int) floor((n._lon + 180) / _cell_lon)) % _lon_cells;
+    if (col < 0)
+      col += _lon_cells;
+  }
+}
+
+void
+RadioSim::index_node(int i)
+{
+  int row, col;
+  cell_of(_nodes[i], row, col);
+  Node &n = _nodes[i];
+  n._cell = cell_key(row, col);
+  Vector<int> &cell = _cells.find_force(n._cell);
+  n._slot = cell.size();
+  cell.push_back(i);
+}
+
+void
+RadioSim::unindex_node(int i)
+{
+  Node &n = _nodes[i];
+  Vector<int> *cell = _cells.findp(n._cell);
+  if (!cell || n._slot < 0)
+    return;
+  // move the cell's last node into the slot
+  int last = cell->back();
+  (*cell)[n._slot] = last;
+  _nodes[last]._slot = n._slot;
+  cell->pop_back();
+  if (cell->empty())
+    _cells.remove(n._cell);
+  n._slot = -1;
+}
+
+void
+RadioSim::rebuild_index()
+{
+  if (_use_xy)
+    _cell_lat = _cell_lon = RANGE;
+  else {
+    // a degree of latitude is never shorter than this; one of longitude
+    // is shorter by cos(lat); leave 10% for the flat-plane approximations
+    _cell_lat = 1.1 * RANGE / (GRID_EARTH_RADIUS * GRID_RAD_PER_DEG);
+    _index_lat = 0;
+    for (int i = 0; i < _nodes.size(); i++)
+      if (fabs(_nodes[i]._lat) > _index_lat)
+	_index_lat = fabs(_nodes[i]._lat);
+    double c = cos((_index_lat + _cell_lat) * GRID_RAD_PER_DEG);
+    if (_index_lat + _cell_lat >= 89 || c <= 0)
+      _lon_cells = 1;
+    else {
+      _lon_cells = (int) (360 * c / _cell_lat);
+      if (_lon_cells < 1)
+	_lon_cells = 1;
+    }
+    _cell_lon = 360.0 / _lon_cells;
+  }
+
+  _cells.clear();
+  for (int i = 0; i < _nodes.size(); i++)
+    index_node(i);
+}
+
+static int
+int_compar(const void *a, const void *b, void *)
+{
+  return *(const int *) a - *(const int *) b;
+}
+
+// Sets _receivers to the nodes within range of node i, in order.
+void
+RadioSim::find_receivers(int i)
+{
+  int row, col;
+  cell_of(_nodes[i], row, col);
+  _receivers.clear();
+  for (int dr = -1; dr <= 1; dr++)
+    for (int dc = -1; dc <= 1; dc++) {
+      int c = col + dc;
+      if (!_use_xy)
+	c = (c + _lon_cells) % _lon_cells;
+      if (Vector<int> *cell = _cells.findp(cell_key(row + dr, c)))
+	for (int *j = cell->begin(); j != cell->end(); j++)
+	  if (range(i, *j) < RANGE)
+	    _receivers.push_back(*j);
+    }
+
+  // with fewer than three columns a cell can be visited twice
+  click_qsort(_receivers.begin(), _receivers.size(), sizeof(int), int_compar);
+  if (_lon_cells < 3 && !_use_xy) {
+    int n = 0;
+    for (int k = 0; k < _receivers.size(); k++)
+      if (n == 0 || _receivers[n - 1] != _receivers[k])
+	_receivers[n++] = _receivers[k];
+    _receivers.resize(n);
+  }
+}
+
 bool
 RadioSim::run_task(Task *)
 {
-  int in, out;
+  int in;
 
   for(in = 0; in < ninputs(); in++){
     Packet *p = input(in).pull();
     if(p){
-      for(out = 0; out < noutputs(); out++){
-	double r;
-	if (_use_xy) {
-	  double dx = _nodes[in]._lat - _nodes[out]._lat;
-	  double dy = _nodes[in]._lon - _nodes[out]._lon;
-	  r = sqrt(dx*dx + dy*dy);
-	}
-	else {
-	  grid_location g1 = grid_location(_nodes[in]._lat, _nodes[in]._lon);
-	  grid_location g2 = grid_location(_nodes[out]._lat, _nodes[out]._lon);
-	  r = grid_location::calc_range(g1, g2);
-	}
-        if (r < 250){
-          output(out).push(p->clone());
-        }
-      }
-      p->kill();
+      find_receivers(in);
+      int n = _receivers.size();
+      _transmissions++;
+      _deliveries += n;
+      _delivered_bytes += (uint64_t) n * p->length();
+      for (int k = 0; k < n - 1; k++)
+	output(_receivers[k]).push(p->clone());
+      if (n)
+	output(_receivers[n - 1]).push(p);
+      else
+	p->kill();
     }
   }
 
@@ -133,8 +253,13 @@ void
 RadioSim::set_node_loc(int i, double lat, double lon)
 {
   if(i >= 0 && i < _nodes.size()){
+    unindex_node(i);
     _nodes[i]._lat = lat;
     _nodes[i]._lon = lon;
+    if (!_use_xy && fabs(lat) > _index_lat)
+      rebuild_index();
+    else
+      index_node(i);
   }
 }
 
@@ -181,11 +306,33 @@ RadioSim::rs_read_handler(Element *f, void *)
   return s;
 }
 
+String
+RadioSim::stats_read_handler(Element *f, void *)
+{
+  RadioSim *l = (RadioSim *) f;
+  StringAccum sa;
+  sa << l->_transmissions << " transmissions\n"
+     << l->_deliveries << " deliveries\n"
+     << l->_delivered_bytes << " bytes\n";
+  return sa.take_string();
+}
+
+int
+RadioSim::reset_write_handler(const String &, Element *f, void *, ErrorHandler *)
+{
+  RadioSim *l = (RadioSim *) f;
+  l->_transmissions = l->_deliveries = 0;
+  l->_delivered_bytes = 0;
+  return 0;
+}
+
 void
 RadioSim::add_handlers()
 {
   add_write_handler("loc", rs_write_handler, (void *) 0);
   add_read_handler("loc", rs_read_handler, (void *) 0);
+  add_read_handler("stats", stats_read_handler, (void *) 0);
+  add_write_handler("reset_stats", reset_write_handler, (void *) 0);
 }
 
 CLICK_ENDDECLS
@@ -21,6 +21,14 @@
  * Inputs are pull, outputs are push. Services inputs in round
  * robin order.
  *
+ * The nodes are kept in a grid of cells at least 250 meters wide, so
+ * that only the nodes in the sender's cell and the eight around it need
+ * their distance checked; the cost of a packet follows the number of
+ * nodes nearby rather than the number of nodes. Receivers still get their
+ * copies in output order, and the last of them gets the packet itself.
+ * With lat,lon, cells are wide enough in longitude for the node farthest
+ * from the equator, and the grid is rebuilt when a node moves farther.
+ *
  * Keyword:
  *
  * =over 8
@@ -34,10 +42,15 @@
  * =back
  *
  * The loc read/write handler format is
- *   node-index latitude longitude */
+ *   node-index latitude longitude
+ *
+ * The stats read handler returns the packets sent, the copies delivered
+ * and the bytes delivered, one per line; the reset_stats write handler
+ * clears them. */
 
 #include <click/element.hh>
 #include <click/vector.hh>
+#include <click/hashmap.hh>
 #include "grid.hh"
 #include <click/task.hh>
 CLICK_DECLS
@@ -62,23 +75,50 @@ class RadioSim : public Element {
 
 private:
 
+  enum { RANGE = 250 };		// metres
+
   struct Node {
     double _lat;
     double _lon;
-    Node(double la, double lo) : _lat(la), _lon(lo) { }
-    Node() : _lat(0), _lon(0) { }
+    uint64_t _cell;		// key of its cell in _cells
+    int _slot;			// its index in that cell
+    Node(double la, double lo) : _lat(la), _lon(lo), _cell(0), _slot(-1) { }
+    Node() : _lat(0), _lon(0), _cell(0), _slot(-1) { }
   };
 
   Node get_node_loc(int i);
   void set_node_loc(int i, double lat, double lon);
   int nnodes() { return(_nodes.size()); }
 
+  double range(int i, int j) const;
+  void cell_of(const Node &n, int &row, int &col) const;
+  static uint64_t cell_key(int row, int col) {
+    return ((uint64_t) (uint32_t) row << 32) | (uint32_t) col;
+  }
+  void index_node(int i);
+  void unindex_node(int i);
+  void rebuild_index();
+  void find_receivers(int i);
+
   static int rs_write_handler(const String &, Element *, void *, ErrorHandler *);
   static String rs_read_handler(Element *, void *);
+  static String stats_read_handler(Element *, void *);
+  static int reset_write_handler(const String &, Element *, void *, ErrorHandler *);
 
   Vector<Node> _nodes;
   Task _task;
 
+  HashMap<uint64_t, Vector<int> > _cells; // nodes by cell
+  double _cell_lat;		// cell size, in degrees or metres
+  double _cell_lon;
+  int _lon_cells;		// columns around the earth, with lat,lon
+  double _index_lat;		// largest |lat| the columns are wide enough for
+  Vector<int> _receivers;	// scratch for run_task
+
+  uint32_t _transmissions;
+  uint32_t _deliveries;
+  uint64_t _delivered_bytes;
+
   bool _use_xy;
 };
 
@@ -219,11 +219,11 @@ CheckIPHeader::simple_action(Packet *p)
     if (_aligned)
       val = ip_fast_csum((unsigned char *)ip, ip->ip_hl);
     else
-      val = click_in_cksum((const unsigned char *)ip, hlen);
+      val = click_in_cksum_iphdr(ip);
 #elif HAVE_FAST_CHECKSUM
     val = ip_fast_csum((unsigned char *)ip, ip->ip_hl);
 #else
-    val = click_in_cksum((const unsigned char *)ip, hlen);
+    val = click_in_cksum_iphdr(ip);
 #endif
     if (val != 0)
       return drop(BAD_CHECKSUM, p);
@@ -45,18 +45,9 @@ DecIPTTL::simple_action(Packet *p)
 	return 0;
 
     } else {
-	--ip->ip_ttl;
-
 	// 19.Aug.1999 - incrementally update IP checksum as suggested by SOSP
 	// reviewers, according to RFC1141, as updated by RFC1624.
-	// new_sum = ~(~old_sum + ~old_halfword + new_halfword)
-	//         = ~(~old_sum + ~old_halfword + (old_halfword - 0x0100))
-	//         = ~(~old_sum + ~old_halfword + old_halfword + ~0x0100)
-	//         = ~(~old_sum + ~0 + ~0x0100)
-	//         = ~(~old_sum + 0xFEFF)
-	unsigned long sum = (~ntohs(ip->ip_sum) & 0xFFFF) + 0xFEFF;
-	ip->ip_sum = ~htons(sum + (sum >> 16));
-
+	click_ip_decrement_ttl(ip);
 	return q;
     }
 }
@@ -155,6 +155,15 @@ DirectIPLookup::Table::vport_find(IPAddress gw, int16_t port)
     return _vport_empty_head;
 }
 
+int
+DirectIPLookup::Table::vport_lookup(IPAddress gw, int16_t port) const
+{
+    for (int vp = _vport_head; vp >= 0; vp = _vport[vp].ll_next)
+	if (_vport[vp].gw == gw && _vport[vp].port == port)
+	    return vp;
+    return -1;
+}
+
 void
 DirectIPLookup::Table::vport_unref(uint16_t vport_i)
 {
@@ -484,6 +493,73 @@ DirectIPLookup::Table::remove_route(const IPRoute& route, IPRoute* old_route, Er
     return 0;
 }
 
+int
+DirectIPLookup::Table::change_routes(const Vector<IPRoute>& removes, const Vector<IPRoute>& sets, ErrorHandler *errh)
+{
+    int r = 0, r1;
+
+    // Widest prefixes go first: a removed prefix skips the more-specific
+    // ones still to be removed instead of rewriting their slots.
+    Vector<int> plen;
+    for (int i = 0; i < removes.size(); i++)
+	plen.push_back(removes[i].prefix_len());
+    for (int len = 0; len <= 32; len++)
+	for (int i = 0; i < removes.size(); i++)
+	    if (plen[i] == len
+		&& (r1 = remove_route(removes[i], 0, errh)) < 0 && r == 0)
+		r = r1;
+
+    // Count, per vport, the existing routes that move elsewhere.  moved[vp]
+    // is -1 once those routes disagree on their new gateway.
+    Vector<int> moved(_vport_size, 0);
+    Vector<int> first(_vport_size, -1);
+    Vector<int> entry(sets.size(), -1);
+    Vector<int> done(sets.size(), 0);
+    for (int i = 0; i < sets.size(); i++) {
+	int rt_i = find_entry(ntohl(sets[i].addr.addr()), sets[i].prefix_len());
+	if (rt_i <= 0)		// new route, or the default route
+	    continue;
+	int vp = _rtable[rt_i].vport;
+	if (_vport[vp].gw == sets[i].gw && _vport[vp].port == sets[i].port) {
+	    done[i] = 1;	// unchanged
+	    continue;
+	}
+	entry[i] = rt_i;
+	if (first[vp] < 0)
+	    first[vp] = i;
+	else if (sets[first[vp]].gw != sets[i].gw
+		 || sets[first[vp]].port != sets[i].port)
+	    moved[vp] = -1;
+	if (moved[vp] >= 0)
+	    moved[vp]++;
+    }
+
+    // A vport all of whose routes move to the same unused gateway is simply
+    // retargeted; _vport[0] belongs to the default route and stays put.
+    for (uint32_t vp = 1; vp < _vport_size; vp++)
+	if (moved[vp] > 0 && moved[vp] == _vport[vp].refcount
+	    && vport_lookup(sets[first[vp]].gw, sets[first[vp]].port) < 0) {
+	    _vport[vp].gw = sets[first[vp]].gw;
+	    _vport[vp].port = sets[first[vp]].port;
+	    moved[vp] = -2;
+	}
+    for (int i = 0; i < sets.size(); i++)
+	if (entry[i] >= 0 && moved[_rtable[entry[i]].vport] == -2)
+	    done[i] = 1;
+
+    // Narrowest prefixes go first: a wider prefix then skips the slots
+    // already owned by the more-specific routes of this batch.
+    plen.clear();
+    for (int i = 0; i < sets.size(); i++)
+	plen.push_back(sets[i].prefix_len());
+    for (int len = 32; len >= 0; len--)
+	for (int i = 0; i < sets.size(); i++)
+	    if (plen[i] == len && !done[i]
+		&& (r1 = add_route(sets[i], true, 0, errh)) < 0 && r == 0)
+		r = r1;
+    return r;
+}
+
 
 // DIRECTIPLOOKUP
 
@@ -538,6 +614,38 @@ DirectIPLookup::lookup_route(IPAddress dest, IPAddress &gw) const
     return _t._vport[vport_i].port;
 }
 
+void
+DirectIPLookup::lookup_routes(const IPAddress* addrs, int n, int* ports, IPAddress* gws) const
+{
+    // the same walk as lookup_route(), one level at a time for a group of
+    // addresses: prefetch every address's entry of a level, then read them
+    uint32_t ip_addr[LOOKUP_BATCH];
+    uint16_t vport_i[LOOKUP_BATCH];
+    for (int j = 0; j < n; j += LOOKUP_BATCH) {
+	int m = (n - j < LOOKUP_BATCH ? n - j : LOOKUP_BATCH);
+	for (int i = 0; i < m; i++) {
+	    ip_addr[i] = ntohl(addrs[j + i].addr());
+	    CLICK_PREFETCH(&_t._tbl_0_23[ip_addr[i] >> 8]);
+	}
+	for (int i = 0; i < m; i++) {
+	    vport_i[i] = _t._tbl_0_23[ip_addr[i] >> 8];
+	    if (vport_i[i] & 0x8000)
+		CLICK_PREFETCH(&_t._tbl_24_31[((vport_i[i] & 0x7fff) << 8) | (ip_addr[i] & 0xff)]);
+	    else
+		CLICK_PREFETCH(&_t._vport[vport_i[i]]);
+	}
+	for (int i = 0; i < m; i++)
+	    if (vport_i[i] & 0x8000) {
+		vport_i[i] = _t._tbl_24_31[((vport_i[i] & 0x7fff) << 8) | (ip_addr[i] & 0xff)];
+		CLICK_PREFETCH(&_t._vport[vport_i[i]]);
+	    }
+	for (int i = 0; i < m; i++) {
+	    gws[j + i] = _t._vport[vport_i[i]].gw;
+	    ports[j + i] = _t._vport[vport_i[i]].port;
+	}
+    }
+}
+
 int
 DirectIPLookup::add_route(const IPRoute& route, bool allow_replace, IPRoute* old_route, ErrorHandler *errh)
 {
@@ -550,6 +658,12 @@ DirectIPLookup::remove_route(const IPRoute& route, IPRoute* old_route, ErrorHand
     return _t.remove_route(route, old_route, errh);
 }
 
+int
+DirectIPLookup::change_routes(const Vector<IPRoute>& removes, const Vector<IPRoute>& sets, ErrorHandler *errh)
+{
+    return _t.change_routes(removes, sets, errh);
+}
+
 int
 DirectIPLookup::flush_handler(const String &, Element *e, void *,
 				ErrorHandler *)
@@ -28,11 +28,20 @@ DirectIPLookup is optimized for lookup speed at the expense of extensive RAM
 usage. Each longest-prefix lookup is accomplished in one to maximum two DRAM
 accesses, regardless on the number of routing table entries. Individual
 entries can be dynamically added to or removed from the routing table with
-relatively low CPU overhead, allowing for high update rates.
+relatively low CPU overhead, allowing for high update rates.  The packets
+of a batch are looked up together, each level's DRAM accesses for all of
+them issued as prefetches before any is waited for.
 
 DirectIPLookup implements the I<DIR-24-8-BASIC> lookup scheme described by
 Gupta, Lin, and McKeown in the paper cited below.
 
+Batches of route changes, as passed to the IPRouteTable B<change_routes>
+interface, are applied with as few table writes as possible: removals go
+widest prefix first and additions narrowest prefix first, so that no lookup
+entry is rewritten twice for routes nested inside each other, and a next-hop
+change that moves every route of a gateway to a new one rewrites only that
+gateway's entry instead of the routes' address ranges.
+
 =h table read-only
 
 Outputs a human-readable version of the current routing table.
@@ -101,7 +110,9 @@ class DirectIPLookup : public IPRouteTable { public:
 
     int add_route(const IPRoute&, bool, IPRoute*, ErrorHandler *);
     int remove_route(const IPRoute&, IPRoute*, ErrorHandler *);
+    int change_routes(const Vector<IPRoute>&, const Vector<IPRoute>&, ErrorHandler *);
     int lookup_route(IPAddress, IPAddress&) const;
+    void lookup_routes(const IPAddress*, int, int*, IPAddress*) const;
     String dump_routes();
 
     static int flush_handler(const String &, Element *, void *, ErrorHandler *);
@@ -173,10 +184,12 @@ class DirectIPLookup : public IPRouteTable { public:
 	String dump() const;
 
 	int vport_find(IPAddress gw, int16_t port);
+	int vport_lookup(IPAddress gw, int16_t port) const;
 	void vport_unref(uint16_t);
 
 	int add_route(const IPRoute&, bool, IPRoute*, ErrorHandler *);
 	int remove_route(const IPRoute&, IPRoute*, ErrorHandler *);
+	int change_routes(const Vector<IPRoute>&, const Vector<IPRoute>&, ErrorHandler *);
 	void flush();
 
     };
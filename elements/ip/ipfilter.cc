@@ -1202,8 +1202,8 @@ IPFilter::add_handlers()
 // RUNNING
 //
 
-void
-IPFilter::length_checked_push(Packet *p)
+int
+IPFilter::length_checked_match(Packet *p) const
 {
   const unsigned char *neth_data = p->network_header();
   const unsigned char *transph_data = p->transport_header();
@@ -1247,10 +1247,8 @@ IPFilter::length_checked_push(Packet *p)
     failure:
       off = pr[1];
     gotit:
-      if (off <= 0) {
-	  checked_output_push(-off, p);
-	  return;
-      }
+      if (off <= 0)
+	  return -off;
       pr += off;
       continue;
 
@@ -1267,22 +1265,18 @@ IPFilter::length_checked_push(Packet *p)
   }
 }
 
-void
-IPFilter::push(int, Packet *p)
+inline int
+IPFilter::match(Packet *p) const
 {
   const unsigned char *neth_data = p->network_header();
   const unsigned char *transph_data = p->transport_header();
 
-  if (_output_everything >= 0) {
-    // must use checked_output_push because the output number might be
-    // out of range
-    checked_output_push(_output_everything, p);
-    return;
-  } else if (p->length() + TRANSP_FAKE_OFFSET - p->transport_header_offset() < _safe_length) {
+  if (_output_everything >= 0)
+    // the output number might be out of range; callers check
+    return _output_everything;
+  else if (p->length() + TRANSP_FAKE_OFFSET - p->transport_header_offset() < _safe_length)
     // common case never checks packet length
-    length_checked_push(p);
-    return;
-  }
+    return length_checked_match(p);
 
   const uint32_t *pr = _prog.begin();
   const uint32_t *pp;
@@ -1317,14 +1311,41 @@ IPFilter::push(int, Packet *p)
       }
       off = pr[1];
     gotit:
-      if (off <= 0) {
-	  checked_output_push(-off, p);
-	  return;
-      }
+      if (off <= 0)
+	  return -off;
       pr += off;
   }
 }
 
+void
+IPFilter::push(int, Packet *p)
+{
+  checked_output_push(match(p), p);
+}
+
+void
+IPFilter::push_batch(int, PacketBatch &batch)
+{
+  // collect runs of packets bound for the same output, as Classifier does
+  PacketBatch run;
+  int run_port = -1;
+  while (Packet *p = batch.pop_front()) {
+    int port = match(p);
+    if (port != run_port) {
+      if ((unsigned) run_port < (unsigned) noutputs())
+	output(run_port).push_batch(run);
+      else
+	run.kill();
+      run_port = port;
+    }
+    run.push_back(p);
+  }
+  if ((unsigned) run_port < (unsigned) noutputs())
+    output(run_port).push_batch(run);
+  else
+    run.kill();
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(Classifier)
 EXPORT_ELEMENT(IPFilter)
@@ -130,6 +130,7 @@ class IPFilter : public Classifier { public:
     void add_handlers();
 
     void push(int port, Packet *);
+    void push_batch(int port, PacketBatch &);
 
     static String compressed_program_string(Element *, void *);
 
@@ -254,7 +255,8 @@ class IPFilter : public Classifier { public:
   int parse_factor(const Vector<String> &, int, Vector<int> &, Primitive &,
 		 bool negated, ErrorHandler *);
 
-  void length_checked_push(Packet *);
+  int length_checked_match(Packet *) const;
+  inline int match(Packet *) const;
 
 };
 
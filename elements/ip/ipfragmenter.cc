@@ -118,8 +118,14 @@ IPFragmenter::fragment(Packet *p_in)
     output(0).push(first_fragment);
     _fragments++;
 
-    // output the remaining fragments
+    // output the remaining fragments. Every other one is a view into p's
+    // buffer: its header is written over the last bytes of the previous
+    // fragment, which is a copy and has already taken its data out. The
+    // views never overlap, so they share the buffer safely.
     int out_hlen = sizeof(click_ip) + optcopy(ip, 0);
+    int trailer = p->end_data() - (p->transport_header() + in_dlen);
+    bool prev_copied = false;
+    int prev_dlen = 0;
 
     for (int off = first_dlen; off < in_dlen; ) {
 	// prepare packet
@@ -127,14 +133,30 @@ IPFragmenter::fragment(Packet *p_in)
 	if (out_dlen + off > in_dlen)
 	    out_dlen = in_dlen - off;
 
-	WritablePacket *q = Packet::make(out_hlen + out_dlen);
-	if (q) {
-	    q->set_network_header(q->data(), out_hlen);
-	    click_ip *qip = q->ip_header();
+	Packet *q;
+	click_ip *qip;
+	if (prev_copied && prev_dlen >= out_hlen) {
+	    qip = reinterpret_cast<click_ip *>(p->transport_header() + off - out_hlen);
+	    if ((q = p->clone())) {
+		q->pull((unsigned char *) qip - q->data());
+		q->take(in_dlen - off - out_dlen + trailer);
+		q->set_network_header(q->data(), out_hlen);
+	    }
+	    prev_copied = false;
+	} else {
+	    WritablePacket *wq = Packet::make(out_hlen + out_dlen);
+	    if ((q = wq)) {
+		wq->set_network_header(wq->data(), out_hlen);
+		memcpy(wq->transport_header(), p->transport_header() + off, out_dlen);
+		wq->copy_annotations(p);
+		qip = wq->ip_header();
+	    }
+	    prev_copied = true;
+	}
 
+	if (q) {
 	    memcpy(qip, ip, sizeof(click_ip));
 	    optcopy(ip, qip);
-	    memcpy(q->transport_header(), p->transport_header() + off, out_dlen);
 
 	    qip->ip_hl = out_hlen >> 2;
 	    qip->ip_off = htons(ntohs(ip->ip_off) + (off >> 3));
@@ -144,12 +166,11 @@ IPFragmenter::fragment(Packet *p_in)
 	    qip->ip_sum = 0;
 	    qip->ip_sum = click_in_cksum((const unsigned char *)qip, out_hlen);
 
-	    q->copy_annotations(p);
-
 	    output(0).push(q);
 	    _fragments++;
 	}
 
+	prev_dlen = out_dlen;
 	off += out_dlen;
     }
 
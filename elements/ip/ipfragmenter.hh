@@ -24,6 +24,13 @@ CLICK_DECLS
  *
  * Sends the fragments in order, starting with the first.
  *
+ * The first fragment and every other later fragment are clones that share
+ * the original packet's data; only the remaining fragments are copied. A
+ * shared fragment's header is written into the original buffer over the end
+ * of the preceding fragment's data, after that fragment was copied. This
+ * halves the copying on links with a small MTU. Downstream elements that
+ * modify a fragment get their own copy, as with any shared packet.
+ *
  * It is best to Strip() the MAC header from a packet before sending it to
  * IPFragmenter, since any MAC header is not copied to second and subsequent
  * fragments.
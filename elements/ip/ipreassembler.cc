@@ -49,10 +49,16 @@ int
 IPReassembler::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     _mem_high_thresh = 256 * 1024;
+    _timeout = 30;
+    _max_datagrams = 0;
     if (cp_va_kparse(conf, this, errh,
 		     "HIMEM", 0, cpUnsigned, &_mem_high_thresh,
+		     "TIMEOUT", 0, cpSeconds, &_timeout,
+		     "MAX_DATAGRAMS", 0, cpUnsigned, &_max_datagrams,
 		     cpEnd) < 0)
 	return -1;
+    if (_timeout == 0)
+	return errh->error("TIMEOUT must be positive");
     _mem_low_thresh = (_mem_high_thresh >> 2) * 3;
     return 0;
 }
@@ -61,6 +67,7 @@ int
 IPReassembler::initialize(ErrorHandler *)
 {
     _mem_used = 0;
+    _ndatagrams = 0;
     _reap_time = 0;
     return 0;
 }
@@ -172,34 +179,50 @@ IPReassembler::emit_whole_packet(WritablePacket *q, WritablePacket **q_pprev,
 
     p_in->kill();
     _mem_used -= IPH_MEM_USED + q->transport_length();
+    _ndatagrams--;
     return q;
 }
 
-void
+bool
 IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
 {
     const click_ip *iph = p->ip_header();
     int p_off = IP_BYTE_OFF(iph);
     int p_lastoff = p_off + PACKET_DLEN(p);
 
-    int hl = (p_off == 0 ? iph->ip_hl << 2 : 20);
-    WritablePacket *q = Packet::make(60 - hl, 0, hl + p_lastoff, 0);
-    if (!q) {
-	click_chatter("out of memory");
-	return;
+    if (_max_datagrams && _ndatagrams >= _max_datagrams)
+	reap_oldest();
+
+    WritablePacket *q;
+    bool consumed;
+    if (p_off == 0) {
+	// the first fragment arrived first: its buffer becomes the queue,
+	// which saves a copy in the common case of in-order fragments
+	if (!(q = p->uniqueify())) {
+	    click_chatter("out of memory");
+	    return true;
+	}
+	q->pull(q->network_header_offset());
+	consumed = true;
+    } else {
+	int hl = 20;
+	if (!(q = Packet::make(60 - hl, 0, hl + p_lastoff, 0))) {
+	    click_chatter("out of memory");
+	    return false;
+	}
+
+	// copy IP header and data
+	q->set_ip_header((click_ip *)q->data(), hl);
+	memcpy(q->ip_header(), iph, hl);
+	memcpy(q->transport_header() + p_off, p->transport_header(), PACKET_DLEN(p));
+	q->set_timestamp_anno(p->timestamp_anno());
+	consumed = false;
     }
     _mem_used += IPH_MEM_USED + p_lastoff;
+    _ndatagrams++;
 
-    // copy IP header and annotations if appropriate
-    q->set_ip_header((click_ip *)q->data(), hl);
-    memcpy(q->ip_header(), iph, hl);
     click_ip *q_iph = q->ip_header();
-    q_iph->ip_off = (iph->ip_off & ~htons(IP_OFFMASK)); // leave MF, DF, RF
-    if (p_off == 0)
-	q->copy_annotations(p);
-
-    // copy data
-    memcpy(q->transport_header() + p_off, p->transport_header(), PACKET_DLEN(p));
+    q_iph->ip_off &= ~htons(IP_OFFMASK); // leave MF, DF, RF
     PACKET_CHUNK(q).off = p_off;
     PACKET_CHUNK(q).lastoff = p_lastoff;
 
@@ -207,7 +230,27 @@ IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
     q->set_next(*q_pprev);
     *q_pprev = q;
 
-    check();
+    //check();
+    return consumed;
+}
+
+void
+IPReassembler::reap_oldest()
+{
+    WritablePacket **oldest_pprev = 0;
+    for (int i = 0; i < NMAP; i++)
+	for (WritablePacket **pprev = &_map[i]; *pprev; pprev = (WritablePacket **)&(*pprev)->next())
+	    if (!oldest_pprev
+		|| (*pprev)->timestamp_anno() < (*oldest_pprev)->timestamp_anno())
+		oldest_pprev = pprev;
+    if (oldest_pprev) {
+	WritablePacket *q = *oldest_pprev;
+	*oldest_pprev = (WritablePacket *)q->next();
+	q->set_next(0);
+	_mem_used -= IPH_MEM_USED + q->transport_length();
+	_ndatagrams--;
+	checked_output_push(1, q);
+    }
 }
 
 IPReassembler::ChunkLink *
@@ -261,8 +304,8 @@ IPReassembler::simple_action(Packet *p)
     WritablePacket **q_pprev;
     WritablePacket *q = find_queue(p, &q_pprev);
     if (!q) {			// make a new queue
-	make_queue(p, q_pprev);
-	p->kill();
+	if (!make_queue(p, q_pprev))
+	    p->kill();
 	return 0;
     }
     WritablePacket *q_bucket_next = (WritablePacket *)(q->next());
@@ -288,6 +331,7 @@ IPReassembler::simple_action(Packet *p)
 	    click_chatter("out of memory");
 	    *q_pprev = q_bucket_next;
 	    _mem_used -= IPH_MEM_USED + old_transport_length;
+	    _ndatagrams--;
 	    p->kill();
 	    return 0;
 	}
@@ -367,6 +411,7 @@ IPReassembler::reap_overfull(int now)
 		if (q->timestamp_anno().sec() < now - delta) {
 		    *pprev = (WritablePacket *)q->next();
 		    _mem_used -= IPH_MEM_USED + q->transport_length();
+		    _ndatagrams--;
 		    q->set_next(0);
 		    checked_output_push(1, q);
 		    if (_mem_used <= _mem_low_thresh)
@@ -381,9 +426,9 @@ IPReassembler::reap_overfull(int now)
 void
 IPReassembler::reap(int now)
 {
-    // look at all queues. If no activity for 30 seconds, kill that queue
+    // look at all queues. If no activity for TIMEOUT seconds, kill that queue
 
-    int kill_time = now - REAP_TIMEOUT;
+    int kill_time = now - (int) _timeout;
 
     for (int i = 0; i < NMAP; i++) {
 	WritablePacket **q_pprev = &_map[i];
@@ -392,6 +437,7 @@ IPReassembler::reap(int now)
 		*q_pprev = (WritablePacket *)q->next();
 		q->set_next(0);
 		_mem_used -= IPH_MEM_USED + q->transport_length();
+		_ndatagrams--;
 		checked_output_push(1, q);
 	    } else
 		q_pprev = (WritablePacket **)&q->next();
@@ -21,14 +21,21 @@ Reassembles fragmented IP packets
 Expects IP packets as input to port 0. If input packets are fragments,
 IPReassembler holds them until it has enough fragments to recreate a complete
 packet. When a complete packet is constructed, it is emitted onto output 0. If
-a set of fragments making a single packet is incomplete and dormant for 30
-seconds, the fragments are generally dropped. If IPReassembler has two
+a set of fragments making a single packet is incomplete and dormant for
+TIMEOUT seconds, the fragments are generally dropped. If IPReassembler has two
 outputs, however, a single packet containing all the received fragments at
 their proper offsets is pushed onto output 1.
 
 IPReassembler's memory usage is bounded. When memory consumption rises above
 HIMEM bytes, IPReassembler throws away old fragments until memory consumption
-drops below 3/4*HIMEM bytes. Default HIMEM is 256K.
+drops below 3/4*HIMEM bytes. Default HIMEM is 256K. With MAX_DATAGRAMS, it
+also holds at most that many packets in the process of reassembly at once;
+a fragment of a new packet beyond that evicts the packet whose fragments
+are oldest, as if it had timed out.
+
+If the first fragment of a packet arrives before the others, as it does on
+most links, its buffer is reused for the reassembled packet rather than
+copied.
 
 Output packets have no MAC headers, and input MAC headers are ignored.
 
@@ -44,6 +51,17 @@ Keyword arguments are:
 
 The upper bound for memory consumption, in bytes. Default is 256K.
 
+=item TIMEOUT
+
+Time in seconds. Incomplete packets dormant for this long are dropped.
+Default is 30. Lower it on lossy links, where fragments of lost packets
+would otherwise hold memory for long.
+
+=item MAX_DATAGRAMS
+
+Unsigned. Maximum number of packets in the process of reassembly. Default
+is 0, which means no limit beyond HIMEM.
+
 =back
 
 =n
@@ -79,8 +97,7 @@ class IPReassembler : public Element { public:
 
   private:
 
-    enum { REAP_TIMEOUT = 30, // seconds
-	   REAP_INTERVAL = 10, // seconds
+    enum { REAP_INTERVAL = 10, // seconds
 	   IPH_MEM_USED = 40 };
 
     enum { NMAP = 256 };
@@ -91,16 +108,20 @@ class IPReassembler : public Element { public:
     uint32_t _mem_used;
     uint32_t _mem_high_thresh;	// defaults to 256K
     uint32_t _mem_low_thresh;	// defaults to 3/4 * _mem_high_thresh
+    uint32_t _timeout;		// seconds, defaults to 30
+    uint32_t _max_datagrams;	// 0 means no limit
+    uint32_t _ndatagrams;
 
     static inline int bucketno(const click_ip *);
     static inline bool same_segment(const click_ip *, const click_ip *);
 
     WritablePacket *find_queue(Packet *, WritablePacket ***);
-    void make_queue(Packet *, WritablePacket **);
+    bool make_queue(Packet *, WritablePacket **);
     static ChunkLink *next_chunk(WritablePacket *, ChunkLink *);
     Packet *emit_whole_packet(WritablePacket *, WritablePacket **, Packet *);
     void reap_overfull(int);
     void reap(int);
+    void reap_oldest();
     static void check_error(ErrorHandler *, int, const Packet *, const char *, ...);
 
 };
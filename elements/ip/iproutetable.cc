@@ -60,7 +60,8 @@ IPRoute::unparse(StringAccum& sa, bool tabs) const
 {
     int l = sa.length();
     char tab = (tabs ? '\t' : ' ');
-    sa << addr.unparse_with_mask(mask) << tab;
+    char buf[IPAddress::unparse_with_mask_buflen];
+    sa << unparse_addr(buf) << tab;
     if (sa.length() < l + 17 && tabs)
 	sa << '\t';
     l = sa.length();
@@ -133,12 +134,44 @@ IPRouteTable::remove_route(const IPRoute&, IPRoute*, ErrorHandler *errh)
     return errh->error("cannot delete routes from this routing table");
 }
 
+int
+IPRouteTable::change_routes(const Vector<IPRoute>& removes, const Vector<IPRoute>& sets, ErrorHandler *errh)
+{
+    // by default, apply the changes one at a time
+    int r = 0, r1;
+    for (int i = 0; i < removes.size(); i++)
+	if ((r1 = remove_route(removes[i], 0, errh)) < 0 && r == 0)
+	    r = r1;
+    for (int i = 0; i < sets.size(); i++)
+	if ((r1 = add_route(sets[i], true, 0, errh)) < 0 && r == 0)
+	    r = r1;
+    return r;
+}
+
+int
+IPRouteTable::page_routes(int, int, Vector<IPRoute>&, unsigned&)
+{
+    return -1;			// by default, tables cannot be paged
+}
+
 int
 IPRouteTable::lookup_route(IPAddress, IPAddress&) const
 {
     return -1;			// by default, route lookups fail
 }
 
+void
+IPRouteTable::lookup_routes(const IPAddress* addrs, int n, int* ports, IPAddress* gws) const
+{
+    // consecutive packets often share a destination: look it up once
+    for (int i = 0; i < n; i++)
+	if (i > 0 && addrs[i] == addrs[i - 1]) {
+	    ports[i] = ports[i - 1];
+	    gws[i] = gws[i - 1];
+	} else
+	    ports[i] = lookup_route(addrs[i], gws[i]);
+}
+
 String
 IPRouteTable::dump_routes()
 {
@@ -164,6 +197,48 @@ IPRouteTable::push(int, Packet *p)
     }
 }
 
+void
+IPRouteTable::push_batch(int, PacketBatch& batch)
+{
+    // Look the packets up LOOKUP_BATCH at a time, and pass each run of
+    // packets for the same output on in one batch.
+    PacketBatch run;
+    int run_port = -1;
+    Packet* packets[LOOKUP_BATCH];
+    IPAddress addrs[LOOKUP_BATCH], gws[LOOKUP_BATCH];
+    int ports[LOOKUP_BATCH];
+    while (!batch.empty()) {
+	int n = 0;
+	while (n < LOOKUP_BATCH && (packets[n] = batch.pop_front())) {
+	    addrs[n] = packets[n]->dst_ip_anno();
+	    n++;
+	}
+	lookup_routes(addrs, n, ports, gws);
+	for (int i = 0; i < n; i++) {
+	    Packet* p = packets[i];
+	    int port = ports[i];
+	    if (port < 0) {
+		static int complained = 0;
+		if (++complained <= 5)
+		    click_chatter("%s: no route for %s", class_name(), addrs[i].unparse().c_str());
+		p->kill();
+		continue;
+	    }
+	    assert(port < noutputs());
+	    if (port != run_port) {
+		if (run_port >= 0)
+		    output(run_port).push_batch(run);
+		run_port = port;
+	    }
+	    if (gws[i])
+		p->set_dst_ip_anno(gws[i]);
+	    run.push_back(p);
+	}
+    }
+    if (run_port >= 0)
+	output(run_port).push_batch(run);
+}
+
 
 int
 IPRouteTable::run_command(int command, const String &str, Vector<IPRoute>* old_routes, ErrorHandler *errh)
@@ -291,6 +366,54 @@ IPRouteTable::lookup_handler(int, String& s, Element* e, const Handler*, ErrorHa
 	return errh->error("expected IP address");
 }
 
+int
+IPRouteTable::table_page_handler(int, String& s, Element* e, const Handler* h, ErrorHandler* errh)
+{
+    IPRouteTable *table = static_cast<IPRouteTable*>(e);
+    Vector<String> words;
+    cp_spacevec(s, words);
+    int start, count = 256;
+    if (words.size() < 1 || words.size() > 2
+	|| !cp_integer(words[0], &start) || start < 0
+	|| (words.size() == 2 && (!cp_integer(words[1], &count) || count <= 0)))
+	return errh->error("expected 'START [COUNT]'");
+    if (count > 65536)
+	count = 65536;
+
+    Vector<IPRoute> routes;
+    unsigned version = 0;
+    int total = table->page_routes(start, count, routes, version);
+    if (total < 0)
+	return errh->error("this routing table cannot be paged");
+    int next = (start + count < total ? start + count : total);
+    if (next < start)
+	next = start;
+
+    StringAccum sa;
+    if (h->user_data1()) {
+	uint32_t header[4];
+	header[0] = htonl(version);
+	header[1] = htonl(start);
+	header[2] = htonl(next);
+	header[3] = htonl(total);
+	sa.append((const char *) header, sizeof(header));
+	for (int i = 0; i < routes.size(); i++) {
+	    uint32_t record[4];
+	    record[0] = routes[i].addr.addr();
+	    record[1] = routes[i].mask.addr();
+	    record[2] = routes[i].gw.addr();
+	    record[3] = htonl(routes[i].port);
+	    sa.append((const char *) record, sizeof(record));
+	}
+    } else {
+	sa << "version " << version << " next " << next << " total " << total << '\n';
+	for (int i = 0; i < routes.size(); i++)
+	    routes[i].unparse(sa, true) << '\n';
+    }
+    s = sa.take_string();
+    return 0;
+}
+
 void
 IPRouteTable::add_handlers()
 {
@@ -300,6 +423,8 @@ IPRouteTable::add_handlers()
     add_write_handler("ctrl", ctrl_handler, 0);
     add_read_handler("table", table_handler, 0, Handler::EXPENSIVE);
     set_handler("lookup", Handler::OP_READ | Handler::READ_PARAM, lookup_handler);
+    set_handler("table_page", Handler::OP_READ | Handler::READ_PARAM, table_page_handler);
+    set_handler("table_binary", Handler::OP_READ | Handler::READ_PARAM | Handler::RAW, table_page_handler, (void *) 1);
 }
 
 CLICK_ENDDECLS
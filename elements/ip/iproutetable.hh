@@ -74,8 +74,8 @@ http://www.read.cs.ucla.edu/click/routetabletest-167k.click.gz
 
 =head1 INTERFACE
 
-These four IPRouteTable virtual functions should generally be overridden by
-particular routing table elements.
+The first four of these IPRouteTable virtual functions should generally be
+overridden by particular routing table elements.
 
 =over 4
 
@@ -108,11 +108,42 @@ Looks up the route associated with address C<dst>. Should set C<gw_return> to
 the resulting gateway and return the relevant output port (or negative if
 there is no route). The default implementation returns -1.
 
+=item C<void B<lookup_routes>(const IPAddress* addrs, int n, int* ports, IPAddress* gws) const>
+
+Looks up the C<n> addresses in C<addrs> as B<lookup_route> would, storing
+the output port (or negative) of C<addrs[i]> in C<ports[i]> and its gateway
+in C<gws[i]>.  B<push_batch> looks up a batch's packets with it, in groups
+of at most C<LOOKUP_BATCH> (16).  The default implementation calls
+B<lookup_route> once per run of equal addresses.  Tables whose lookups walk
+memory, such as RadixIPLookup and DirectIPLookup, override it to overlap the
+cache misses of the walks, prefetching the next level of one address's walk
+while they process the others.
+
 =item C<String B<dump_routes>()>
 
 Returns a textual description of the current routing table. The default
 implementation returns an empty string.
 
+=item C<int B<change_routes>(const VectorE<lt>IPRouteE<gt>& removes, const VectorE<lt>IPRouteE<gt>& sets, ErrorHandler *errh)>
+
+Applies a batch of route changes: removes every route in C<removes>, then sets
+every route in C<sets> as if by B<add_route> with C<set> true.  Each prefix
+should occur at most once in the batch.  The batch is not atomic; a failed
+change does not stop the others.  Should return 0 on success and the first
+error otherwise.  The default implementation calls B<remove_route> and
+B<add_route> once per route.  Tables whose updates are expensive, such as
+DirectIPLookup, override it to share work across the batch.
+
+=item C<int B<page_routes>(int start, int count, VectorE<lt>IPRouteE<gt>& routes, unsigned& version)>
+
+Appends to C<routes> the routes in slots C<start> up to C<start + count> of
+the table, and returns the number of slots.  Slots are positions in the
+element's own storage; empty slots are skipped, so fewer than C<count>
+routes may be returned.  Sets C<version> to a number that changes whenever
+the slots do.  Backs the C<table_page> and C<table_binary> handlers, which
+cost time in proportion to C<count> rather than to the table.  The default
+implementation returns -1, meaning the element cannot page its routes.
+
 =back
 
 The following functions, overridden by IPRouteTable, are available for use by
@@ -155,6 +186,22 @@ up to the `C<ctrl>' handler.
 This read handler callback function returns the element's routing table via
 the B<dump_routes> function. Normally hooked up to the `C<table>' handler.
 
+=item C<static int B<table_page_handler>(int operation, String&, Element*, const Handler*, ErrorHandler*)>
+
+This read handler callback function parses its parameter as `C<START
+[COUNT]>' and returns a page of the table via B<page_routes>.  Normally
+hooked up to the `C<table_page>' handler, which returns text, and the
+`C<table_binary>' handler, which returns the same page in binary.
+
+The text page starts with the line `C<version V next N total T>', followed
+by one route per line as in the `C<table>' handler.  Read the next page from
+slot C<N>; the table is done once C<N> reaches C<T>.  Should C<V> change
+between pages, the table changed meanwhile; start over.
+
+The binary page starts with four 32-bit words, C<V>, C<START>, C<N> and
+C<T>, followed by 16 bytes per route: address, mask, gateway and output
+port.  All words are in network byte order.  COUNT defaults to 256.
+
 =back
 
 =a RadixIPLookup, DirectIPLookup, RangeIPLookup, StaticIPLookup,
@@ -183,6 +230,7 @@ struct IPRoute {
     StringAccum &unparse(StringAccum&, bool tabs) const;
     String unparse() const;
     String unparse_addr() const	{ return addr.unparse_with_mask(mask); }
+    char *unparse_addr(char *buf) const { return addr.unparse_with_mask(buf, mask); }
 };
 
 class IPRouteTable : public Element { public:
@@ -193,16 +241,23 @@ class IPRouteTable : public Element { public:
 
     virtual int add_route(const IPRoute& route, bool allow_replace, IPRoute* replaced_route, ErrorHandler* errh);
     virtual int remove_route(const IPRoute& route, IPRoute* removed_route, ErrorHandler* errh);
+    virtual int change_routes(const Vector<IPRoute>& removes, const Vector<IPRoute>& sets, ErrorHandler* errh);
     virtual int lookup_route(IPAddress addr, IPAddress& gw) const = 0;
+    virtual void lookup_routes(const IPAddress* addrs, int n, int* ports, IPAddress* gws) const;
     virtual String dump_routes();
+    virtual int page_routes(int start, int count, Vector<IPRoute>& routes, unsigned& version);
 
     void push(int port, Packet* p);
+    void push_batch(int port, PacketBatch& batch);
 
     static int add_route_handler(const String&, Element*, void*, ErrorHandler*);
     static int remove_route_handler(const String&, Element*, void*, ErrorHandler*);
     static int ctrl_handler(const String&, Element*, void*, ErrorHandler*);
     static int lookup_handler(int operation, String&, Element*, const Handler*, ErrorHandler*);
     static String table_handler(Element*, void*);
+    static int table_page_handler(int operation, String&, Element*, const Handler*, ErrorHandler*);
+
+    enum { LOOKUP_BATCH = 16 };	// addresses per lookup_routes() call of push_batch()
 
   private:
 
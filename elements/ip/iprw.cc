@@ -339,7 +339,7 @@ bool
 IPRw::Pattern::create_mapping(int ip_p, const IPFlowID& in,
 			      int fport, int rport,
 			      Mapping* fmap, Mapping* rmap,
-			      const Map& rev_map)
+			      const Map& rev_map, int nshards, int shard)
 {
     IPFlowID out(in);
     if (_saddr)
@@ -362,7 +362,10 @@ IPRw::Pattern::create_mapping(int ip_p, const IPFlowID& in,
 		    lookup.set_dport(htons(base + val));
 		else
 		    lookup.set_daddr(htonl(base + val));
-		if (!rev_map.find(lookup)) {
+		// with shards, only take flows whose reverse shares the
+		// forward flow's shard, so both mappings live in one table
+		if (!rev_map.find(lookup)
+		    && (nshards <= 1 || flow_shard(lookup, nshards) == shard)) {
 		    if (_is_napt)
 			out.set_sport(lookup.dport());
 		    else
@@ -49,6 +49,8 @@ class IPRw : public Element { public:
     virtual Mapping* apply_pattern(Pattern*, int ip_p, const IPFlowID&, int, int) = 0;
     virtual Mapping* get_mapping(int ip_p, const IPFlowID&) const = 0;
 
+    static inline int flow_shard(const IPFlowID&, int nshards);
+
   protected:
 
     Vector<Pattern*> _all_patterns;
@@ -165,7 +167,8 @@ class IPRw::Pattern { public:
 
     bool can_accept_from(const Pattern&) const;
 
-    bool create_mapping(int ip_p, const IPFlowID&, int fport, int rport, Mapping*, Mapping*, const Map&);
+    bool create_mapping(int ip_p, const IPFlowID&, int fport, int rport, Mapping*, Mapping*, const Map&,
+			int nshards = 1, int shard = 0);
     void accept_mapping(Mapping*);
     inline void mapping_freed(Mapping*);
 
@@ -209,6 +212,20 @@ class IPMapper { public:
 };
 
 
+/** @brief Return the shard of @a flow among @a nshards.
+ *
+ * A flow and its reverse are in the same shard. */
+inline int
+IPRw::flow_shard(const IPFlowID &flow, int nshards)
+{
+    uint32_t h = (flow.saddr().addr() ^ flow.daddr().addr())
+	^ ((uint32_t) (flow.sport() ^ flow.dport()) * 0x9E3779B1U);
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    return h % nshards;
+}
+
 inline void
 IPRw::Mapping::append_to_free(Mapping*& head, Mapping*& tail)
 {
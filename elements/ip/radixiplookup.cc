@@ -203,6 +203,45 @@ RadixIPLookup::remove_route(const IPRoute& route, IPRoute* old_route, ErrorHandl
     return r;
 }
 
+/**
+ * as lookup(), for n addresses at once, n at most LOOKUP_BATCH: the walks
+ * go down one level per round, the first pass over them prefetching the
+ * child entries the second pass reads, and the second the nodes the next
+ * round reads, so that the cache misses of the n walks overlap
+ */
+void
+RadixIPLookup::Radix::lookup_batch(const Radix* r, int cur, const uint32_t* addrs, int n, int* keys)
+{
+    const Radix* node[IPRouteTable::LOOKUP_BATCH];
+    const Child* child[IPRouteTable::LOOKUP_BATCH];
+    uint32_t rest[IPRouteTable::LOOKUP_BATCH];
+    assert(n <= IPRouteTable::LOOKUP_BATCH);
+    for (int i = 0; i < n; i++) {
+	keys[i] = cur;
+	node[i] = r;
+	rest[i] = addrs[i];
+    }
+    for (bool active = (r != 0); active; ) {
+	for (int i = 0; i < n; i++)
+	    if (const Radix* x = node[i]) {
+		int i1 = rest[i] >> x->_bitshift;
+		rest[i] &= (1 << x->_bitshift) - 1;
+		child[i] = &x->_children[i1];
+		CLICK_PREFETCH(child[i]);
+	    }
+	active = false;
+	for (int i = 0; i < n; i++)
+	    if (node[i]) {
+		if (child[i]->key >= 0)
+		    keys[i] = child[i]->key;
+		if ((node[i] = child[i]->child)) {
+		    CLICK_PREFETCH(node[i]);
+		    active = true;
+		}
+	    }
+    }
+}
+
 int
 RadixIPLookup::lookup_route(IPAddress addr, IPAddress &gw) const
 {
@@ -216,6 +255,32 @@ RadixIPLookup::lookup_route(IPAddress addr, IPAddress &gw) const
     }
 }
 
+void
+RadixIPLookup::lookup_routes(const IPAddress* addrs, int n, int* ports, IPAddress* gws) const
+{
+    uint32_t a[LOOKUP_BATCH];
+    int keys[LOOKUP_BATCH];
+    for (int j = 0; j < n; j += LOOKUP_BATCH) {
+	int m = (n - j < LOOKUP_BATCH ? n - j : LOOKUP_BATCH);
+	for (int i = 0; i < m; i++)
+	    a[i] = ntohl(addrs[j + i].addr());
+	Radix::lookup_batch(_radix, _default_key, a, m, keys);
+	for (int i = 0; i < m; i++)
+	    if (keys[i] >= 0)
+		CLICK_PREFETCH(&_v[keys[i]]);
+	for (int i = 0; i < m; i++) {
+	    int key = keys[i];
+	    if (key >= 0 && _v[key].contains(addrs[j + i])) {
+		gws[j + i] = _v[key].gw;
+		ports[j + i] = _v[key].port;
+	    } else {
+		gws[j + i] = 0;
+		ports[j + i] = -1;
+	    }
+	}
+    }
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(IPRouteTable)
 EXPORT_ELEMENT(RadixIPLookup)
@@ -24,7 +24,8 @@ be traversed is thus 7.
 Expects a destination IP address annotation with each packet. Looks up that
 address in its routing table, using longest-prefix-match, sets the destination
 annotation to the corresponding GW (if specified), and emits the packet on the
-indicated OUTput port.
+indicated OUTput port.  The packets of a batch are looked up together,
+so that the cache misses of their walks down the trie overlap.
 
 Each argument is a route, specifying a destination and mask, an optional
 gateway IP address, and an output port.
@@ -82,11 +83,12 @@ class RadixIPLookup : public IPRouteTable { public:
     int add_route(const IPRoute&, bool, IPRoute*, ErrorHandler *);
     int remove_route(const IPRoute&, IPRoute*, ErrorHandler *);
     int lookup_route(IPAddress, IPAddress&) const;
+    void lookup_routes(const IPAddress*, int, int*, IPAddress*) const;
     String dump_routes();
 
-  private:
+    class Radix;	// also used by OLSRRadixIPLookup
 
-    class Radix;
+  private:
 
     // Simple routing table
     Vector<IPRoute> _v;
@@ -106,6 +108,7 @@ class RadixIPLookup::Radix { public:
 
     Radix* change(uint32_t addr, uint32_t naddr, int key, uint32_t key_priority);
     static int lookup(const Radix*, int, uint32_t addr);
+    static void lookup_batch(const Radix*, int, const uint32_t* addrs, int n, int* keys);
 
   private:
 
@@ -47,7 +47,7 @@ SetIPChecksum::simple_action(Packet *p_in)
 	    goto bad;
 
 	ip->ip_sum = 0;
-	ip->ip_sum = click_in_cksum((unsigned char *)ip, hlen);
+	ip->ip_sum = click_in_cksum_iphdr(ip);
 	return p;
 
       bad:
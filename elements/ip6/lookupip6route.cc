@@ -134,8 +134,8 @@ LookupIP6Route::push(int, Packet *p)
     _last_addr = a;
     _last_gw = gw;
     _last_output = ifi;
-    if (gw != IP6Address("::0")) {
-	SET_DST_IP6_ANNO(p, IP6Address(gw));
+    if (gw) {
+	SET_DST_IP6_ANNO(p, gw);
     }
     output(ifi).push(p);
 
@@ -152,14 +152,16 @@ LookupIP6Route::add_route(IP6Address addr, IP6Address mask, IP6Address gw,
     return errh->error("port number out of range"); // Can't happen...
 
   _t.add(addr, mask, gw, output);
+  initialize(errh);		// the cached lookups may be stale
   return 0;
 }
 
 int
 LookupIP6Route::remove_route(IP6Address addr, IP6Address mask,
-			     ErrorHandler *)
+			     ErrorHandler *errh)
 {
   _t.del(addr, mask);
+  initialize(errh);		// the cached lookups may be stale
   return 0;
 }
 
@@ -21,6 +21,10 @@ CLICK_DECLS
  * a destination and mask, a gateway (zero means none),
  * and an output index.
  *
+ * The table is a path-compressed binary trie, so a lookup costs at most
+ * one step per bit of the longest prefix rather than one per route.
+ * Masks that are not prefixes are kept aside and checked one by one.
+ *
  * =e
  *
  *   ... -> GetIP6Address(24) -> rt;
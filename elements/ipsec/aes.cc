@@ -65,9 +65,25 @@ Aes::configure(Vector<String> &conf, ErrorHandler *errh)
 int
 Aes::initialize(ErrorHandler *)
 {
+ _have_key = false;
  return 0;
 }
 
+// The key schedule is kept until a packet of another SA comes along, as
+// expanding it costs about as much as de/encrypting a small packet.
+void
+Aes::set_key(const unsigned char *key)
+{
+  if (_have_key && memcmp(_key_bytes, key, sizeof(_key_bytes)) == 0)
+    return;
+  if (_op == AES_DECRYPT)
+    AES_set_decrypt_key(key, 128, &_key);
+  else
+    AES_set_encrypt_key(key, 128, &_key);
+  memcpy(_key_bytes, key, sizeof(_key_bytes));
+  _have_key = true;
+}
+
 Packet *
 Aes::simple_action(Packet *p_in)
 {
@@ -98,16 +114,14 @@ Aes::simple_action(Packet *p_in)
         p->kill();
         return 0;
     }
-    /*Set the Decrypt key*/
-    AES_set_decrypt_key((const unsigned char *)&sa_data->Encryption_key, 128, &_key);
   } else {
     if(sa_data==NULL) {
 	click_chatter("AES: No SADataTuple annotation. This module is not properly placed check man page\n");
         p->kill();
         return 0;
     }
-    AES_set_encrypt_key((const unsigned char *)&sa_data->Encryption_key, 128,&_key);
   }
+  set_key(sa_data->Encryption_key);
 
 #ifdef DEBUG
    click_chatter("Key: %x%x%x%x%x%x%x%x",sa_data->Encryption_key[0], sa_data->Encryption_key[1], sa_data->Encryption_key[2], sa_data->Encryption_key[3],sa_data->Encryption_key[4], sa_data->Encryption_key[5], sa_data->Encryption_key[6], sa_data->Encryption_key[7]);
@@ -59,9 +59,12 @@ class Aes : public Element {
    int AES_set_decrypt_key(const unsigned char *userKey, const int bits, AES_KEY *key);
    void AES_encrypt(const unsigned char *in, unsigned char *out,const AES_KEY *key);
    void AES_decrypt(const unsigned char *in, unsigned char *out,const AES_KEY *key);
+   void set_key(const unsigned char *key);
    unsigned _op;
    int _ignore;
    AES_KEY _key;
+   unsigned char _key_bytes[16];	/* the key _key was expanded from */
+   bool _have_key;
 };
 
 CLICK_ENDDECLS
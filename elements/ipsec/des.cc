@@ -67,6 +67,7 @@ Des::configure(Vector<String> &conf, ErrorHandler *errh)
 int
 Des::initialize(ErrorHandler *)
 {
+ _have_key = false;
  return 0;
 }
 
@@ -88,8 +89,12 @@ Des::simple_action(Packet *p_in)
   sa_data =(SADataTuple *)IPSEC_SA_DATA_REFERENCE_ANNO(p);
   /*sanity check*/
      if(sa_data==NULL) {click_chatter("DES: No SADataTuple annotation. Check man page\n"); p->kill(); return 0;}
-  /*Set the key*/
-  des_set_key((unsigned char (*)[8])&sa_data->Encryption_key, _ks);
+  /*Set the key, unless the last packet's SA had the same*/
+  if (!_have_key || memcmp(_key_bytes, sa_data->Encryption_key, sizeof(_key_bytes)) != 0) {
+    des_set_key((unsigned char (*)[8])&sa_data->Encryption_key, _ks);
+    memcpy(_key_bytes, sa_data->Encryption_key, sizeof(_key_bytes));
+    _have_key = true;
+  }
 
   // de/encrypt the payload
   while (plen > 0) {
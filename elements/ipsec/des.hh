@@ -59,6 +59,8 @@ private:
   unsigned _op;
   int _ignore;
   des_key_schedule _ks;
+  des_cblock _key_bytes;	/* the key _ks was set from */
+  bool _have_key;
 };
 
 CLICK_ENDDECLS
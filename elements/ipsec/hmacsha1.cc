@@ -57,21 +57,38 @@ int
 IPsecAuthHMACSHA1::initialize(ErrorHandler *)
 {
   _drops = 0;
+  _have_key = false;
   return 0;
 }
 
+void
+IPsecAuthHMACSHA1::digest(const SADataTuple *sa_data, const unsigned char *data, size_t len, unsigned char *md)
+{
+  HMAC_CTX c;
+  unsigned int md_len = SHA_DIGEST_LEN;
+  _lock.acquire();
+  if (!_have_key || memcmp(_key, sa_data->Authentication_key, KEY_SIZE) != 0) {
+    HMAC_Init(&_ctx, sa_data->Authentication_key, KEY_SIZE);
+    memcpy(_key, sa_data->Authentication_key, KEY_SIZE);
+    _have_key = true;
+  }
+  // HMAC_Final needs no more than these
+  memcpy(&c.md_ctx, &_ctx.i_ctx, sizeof(SHA1_ctx));
+  memcpy(&c.o_ctx, &_ctx.o_ctx, sizeof(SHA1_ctx));
+  _lock.release();
+  HMAC_Update(&c, (unsigned char *) data, len);
+  HMAC_Final(&c, md, &md_len);
+}
+
 
 Packet *
 IPsecAuthHMACSHA1::simple_action(Packet *p)
 {
   SADataTuple * sa_data=(SADataTuple *)IPSEC_SA_DATA_REFERENCE_ANNO(p);
-  unsigned int len;
-  // compute HMAC
-  len = SHA_DIGEST_LEN;
 
   if (_op == COMPUTE_AUTH) {
     unsigned char digest [SHA_DIGEST_LEN];
-    HMAC(sa_data->Authentication_key,KEY_SIZE,(u_char*) p->data(),p->length(),digest,&len);
+    this->digest(sa_data, p->data(), p->length(), digest);
     WritablePacket *q = p->put(12);
     u_char *ah = ((u_char*)q->data())+q->length()-12;
     memmove(ah, digest, 12);
@@ -81,7 +98,7 @@ IPsecAuthHMACSHA1::simple_action(Packet *p)
     const u_char *ah = p->data()+p->length()-12;
     unsigned char digest [SHA_DIGEST_LEN];
 
-    HMAC(sa_data->Authentication_key,KEY_SIZE,(u_char*) p->data(),p->length()-12,digest,&len);
+    this->digest(sa_data, p->data(), p->length() - 12, digest);
     if (memcmp(ah, digest, 12)) {
       if (_drops == 0)
 	click_chatter("Invalid SHA1 authentication digest");
@@ -2,8 +2,11 @@
 #define CLICK_IPSECAUTHHMACSHA1_HH
 #include <click/element.hh>
 #include <click/atomic.hh>
+#include <click/sync.hh>
 #include <click/glue.hh>
+#include "elements/ipsec/hmac.hh"
 CLICK_DECLS
+class SADataTuple;
 
 /*
  * =c
@@ -16,6 +19,9 @@ CLICK_DECLS
  * per RFC 2404, 2406. If first argument is 1, verify SHA1 digest and remove
  * authentication bits.
  *
+ * The inner and outer HMAC contexts of the last key used are kept, so
+ * packets of the same SA in a row only hash their own data.
+ *
  * =a IPsecESPEncap, IPsecDES
  */
 
@@ -42,6 +48,14 @@ private:
   int _op;
   atomic_uint32_t _drops;
 
+  // HMAC contexts set up for _key
+  HMAC_CTX _ctx;
+  unsigned char _key[16];
+  bool _have_key;
+  Spinlock _lock;
+
+  void digest(const SADataTuple *sa_data, const unsigned char *data, size_t len, unsigned char *md);
+
   enum { COMPUTE_AUTH = 0, VERIFY_AUTH = 1 };
 };
 
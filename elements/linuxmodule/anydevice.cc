@@ -26,6 +26,9 @@
 #include <click/error.hh>
 #include <click/handlercall.hh>
 #include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <click/straccum.hh>
+#include <click/master.hh>
 #include <click/cxxprotect.h>
 CLICK_CXX_PROTECT
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0)
@@ -221,6 +224,123 @@ AnyTaskDevice::AnyTaskDevice()
 }
 
 
+void
+AnyDeviceQueues::configure(Element *owner, int n)
+{
+    cleanup();
+    if (n > 1)
+	for (int q = 0; q < n; q++)
+	    _queues.push_back(new Queue(owner));
+}
+
+void
+AnyDeviceQueues::initialize(Element *owner, int first_thread)
+{
+    for (int q = 0; q < _queues.size(); q++) {
+	_queues[q]->task.initialize(owner, false);
+	_queues[q]->task.move_thread((first_thread + q) % owner->master()->nthreads());
+    }
+}
+
+void
+AnyDeviceQueues::cleanup()
+{
+    for (int q = 0; q < _queues.size(); q++) {
+	Queue *dq = _queues[q];
+	for (unsigned i = dq->head; i != dq->tail; i = (i == QSIZE ? 0 : i + 1))
+	    dq->packets[i]->kill();
+	delete dq;
+    }
+    _queues.clear();
+}
+
+/*
+ * Hashes the IPv4 addresses of an Ethernet frame, and the ports of an
+ * unfragmented TCP or UDP packet, symmetrically; 0 for other frames.
+ */
+uint32_t
+AnyDeviceQueues::flow_hash(const Packet *p)
+{
+    const unsigned char *data = p->data();
+    unsigned len = p->length();
+    if (len < sizeof(click_ether) + sizeof(click_ip)
+	|| ((const click_ether *) data)->ether_type != htons(ETHERTYPE_IP))
+	return 0;
+    const click_ip *iph = (const click_ip *) (data + sizeof(click_ether));
+    uint32_t h = iph->ip_src.s_addr ^ iph->ip_dst.s_addr;
+    unsigned hlen = iph->ip_hl << 2;
+    if ((iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP)
+	&& !IP_ISFRAG(iph)
+	&& len >= sizeof(click_ether) + hlen + 4) {
+	const uint16_t *ports = (const uint16_t *) ((const unsigned char *) iph + hlen);
+	h ^= ports[0] ^ ports[1];
+    }
+    return (h * 0x9E3779B1U) >> 16;
+}
+
+bool
+AnyDeviceQueues::run_task(Task *t, Element *owner, unsigned burst)
+{
+    int q = 0;
+    while (&_queues[q]->task != t)
+	q++;
+    Queue *dq = _queues[q];
+    unsigned tail = dq->tail, n = 0;
+    smp_rmb();			// the packets before the tail
+    while (n < burst && dq->head != tail) {
+	Packet *p = dq->packets[dq->head];
+	dq->head = (dq->head == QSIZE ? 0 : dq->head + 1);
+	owner->output(0).push(p);
+	n++;
+    }
+    dq->pushes += n;
+    if (dq->head != dq->tail)
+	t->fast_reschedule();
+    return n > 0;
+}
+
+uint32_t
+AnyDeviceQueues::drops() const
+{
+    uint32_t drops = 0;
+    for (int q = 0; q < _queues.size(); q++)
+	drops += _queues[q]->drops;
+    return drops;
+}
+
+void
+AnyDeviceQueues::reset_counts()
+{
+    for (int q = 0; q < _queues.size(); q++)
+	_queues[q]->pushes = _queues[q]->drops = 0;
+}
+
+String
+AnyDeviceQueues::read_queues(Element *, void *thunk)
+{
+    AnyDeviceQueues *dqs = static_cast<AnyDeviceQueues *>(thunk);
+    StringAccum sa;
+    for (int q = 0; q < dqs->_queues.size(); q++) {
+	Queue *dq = dqs->_queues[q];
+	unsigned length = (dq->tail + QSIZE + 1 - dq->head) % (QSIZE + 1);
+	sa << "queue " << q << " thread " << dq->task.home_thread_id()
+	   << " length " << length << " pushes " << dq->pushes
+	   << " drops " << dq->drops << '\n';
+    }
+    return sa.take_string();
+}
+
+void
+AnyDeviceQueues::add_handlers(Element *owner)
+{
+    if (!_queues.size())
+	return;
+    for (int q = 0; q < _queues.size(); q++)
+	owner->add_task_handlers(&_queues[q]->task, "queue" + String(q) + "_");
+    owner->add_read_handler("queues", read_queues, this);
+}
+
+
 void
 AnyDeviceMap::initialize()
 {
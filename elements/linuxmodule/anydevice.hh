@@ -3,6 +3,7 @@
 #define ANYDEVICE_HH
 #include <click/element.hh>
 #include <click/task.hh>
+#include <click/sync.hh>
 class HandlerCall;
 
 #include <click/cxxprotect.h>
@@ -173,6 +174,90 @@ AnyTaskDevice::adjust_tickets(int work)
 #endif
 }
 
+/* The receive queues of a FromDevice or PollDevice with QUEUES: received
+   packets are spread over the queues by flow, and each queue is emptied by
+   a Task of its own, whose home thread is the owner's plus the queue
+   number, modulo the number of threads.  A packet goes to the queue of the
+   hardware receive queue its driver recorded, if the kernel records them,
+   and otherwise to the queue its IPv4 addresses and TCP or UDP ports hash
+   to, the same for both directions of a flow; other packets go to queue 0. */
+class AnyDeviceQueues { public:
+
+    enum { MAX_QUEUES = 64 };
+
+    AnyDeviceQueues()			{ }
+    ~AnyDeviceQueues()			{ cleanup(); }
+
+    int size() const			{ return _queues.size(); }
+
+    // makes the queues and their Tasks; none if n is 1
+    void configure(Element *owner, int n);
+    void initialize(Element *owner, int first_thread);
+    void cleanup();
+
+    inline int queue_for(const Packet *p) const;
+    // adds p to queue q and schedules its Task; false, with p left to the
+    // caller, if the queue is full
+    inline bool enqueue(int q, Packet *p);
+    // pushes up to burst packets of the queue whose Task is t to output 0
+    // of owner
+    bool run_task(Task *t, Element *owner, unsigned burst);
+
+    uint32_t drops() const;
+    void reset_counts();
+    void add_handlers(Element *owner);
+
+  private:
+
+    enum { QSIZE = 511 };
+
+    struct Queue {
+	Task task;
+	Spinlock lock;		// of the receivers, which may run on several CPUs
+	unsigned head;
+	unsigned tail;
+	uint32_t pushes;
+	uint32_t drops;
+	Packet *packets[QSIZE + 1];
+	Queue(Element *owner) : task(owner), head(0), tail(0), pushes(0), drops(0) { }
+    };
+
+    Vector<Queue *> _queues;
+
+    static uint32_t flow_hash(const Packet *p);
+    static String read_queues(Element *, void *);
+
+};
+
+inline int
+AnyDeviceQueues::queue_for(const Packet *p) const
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 30)
+    if (skb_rx_queue_recorded(p->skb()))
+	return skb_get_rx_queue(p->skb()) % _queues.size();
+#endif
+    return flow_hash(p) % _queues.size();
+}
+
+inline bool
+AnyDeviceQueues::enqueue(int q, Packet *p)
+{
+    Queue *dq = _queues[q];
+    dq->lock.acquire();
+    unsigned next = (dq->tail == QSIZE ? 0 : dq->tail + 1);
+    if (next == dq->head) {
+	dq->drops++;
+	dq->lock.release();
+	return false;
+    }
+    dq->packets[dq->tail] = p;
+    smp_wmb();			// the packet before the new tail
+    dq->tail = next;
+    dq->lock.release();
+    dq->task.reschedule();
+    return true;
+}
+
 class AnyDeviceMap { public:
 
     void initialize();
@@ -95,13 +95,18 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     _burst = 8;
     _active = true;
+    unsigned nqueues = 1;
     if (AnyDevice::configure_keywords(conf, errh, true) < 0
 	|| cp_va_kparse(conf, this, errh,
 			"DEVNAME", cpkP+cpkM, cpString, &_devname,
 			"BURST", cpkP, cpUnsigned, &_burst,
 			"ACTIVE", 0, cpBool, &_active,
+			"QUEUES", 0, cpUnsigned, &nqueues,
 			cpEnd) < 0)
 	return -1;
+    if (nqueues < 1 || nqueues > AnyDeviceQueues::MAX_QUEUES)
+	return errh->error("QUEUES must be between 1 and %d", AnyDeviceQueues::MAX_QUEUES);
+    _queues.configure(this, nqueues);
 
     // make queue look full so packets sent to us are ignored
     _head = _tail = _capacity = 0;
@@ -145,6 +150,7 @@ FromDevice::initialize(ErrorHandler *errh)
     _max_tickets = _task.tickets();
     _task.set_tickets(Task::DEFAULT_TICKETS);
 #endif
+    _queues.initialize(this, _task.home_thread_id());
 
     // set true queue size (now we can start receiving packets)
     _capacity = QSIZE;
@@ -169,6 +175,7 @@ FromDevice::cleanup(CleanupStage stage)
 	for (unsigned i = _head; i != _tail; i = next_i(i))
 	    _queue[i]->kill();
     _head = _tail = 0;
+    _queues.cleanup();
 }
 
 void
@@ -251,6 +258,21 @@ FromDevice::got_skb(struct sk_buff *skb)
     if (!_active)
 	return 0;		// 0 means not handled
 
+    if (_queues.size()) {
+	if (_capacity == 0)	// not yet initialized
+	    return 0;
+	assert(skb_shared(skb) == 0);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24)
+	skb_push(skb, skb->data - skb_mac_header(skb));
+#else
+	skb_push(skb, skb->data - skb->mac.raw);
+#endif
+	Packet *p = Packet::make(skb);
+	if (!_queues.enqueue(_queues.queue_for(p), p))
+	    p->kill();		// counted as the queue's drop
+	return 1;
+    }
+
     unsigned next = next_i(_tail);
 
     if (next != _head) { /* ours */
@@ -320,8 +342,10 @@ FromDevice::emission_report(int idx)
 #endif
 
 bool
-FromDevice::run_task(Task *)
+FromDevice::run_task(Task *task)
 {
+    if (task != &_task)
+	return _queues.run_task(task, this, _burst);
     _runs++;
     int npq = 0;
     while (npq < _burst && _head != _tail) {
@@ -357,13 +381,13 @@ String FromDevice::read_handler(Element *e, void *thunk)
       case H_ACTIVE:
 	return cp_unparse_bool(fd->_dev && fd->_active);
       case H_DROPS:
-	return String(fd->_drops);
+	return String(fd->_drops + fd->_queues.drops());
       case H_CALLS: {
 	  StringAccum sa;
 	  sa << "calls to run_task(): " << fd->_runs << "\n"
 	     << "calls to push():     " << fd->_pushes << "\n"
 	     << "empty runs:          " << fd->_empty_runs << "\n"
-	     << "drops:               " << fd->_drops << "\n";
+	     << "drops:               " << fd->_drops + fd->_queues.drops() << "\n";
 	  return sa.take_string();
       }
       default:
@@ -396,6 +420,7 @@ FromDevice::add_handlers()
     add_read_handler("calls", read_handler, H_CALLS);
     add_write_handler("active", write_handler, H_ACTIVE);
     add_write_handler("reset_counts", write_handler, H_RESET_COUNTS, Handler::BUTTON);
+    _queues.add_handlers(this);
 }
 
 ELEMENT_REQUIRES(AnyDevice linuxmodule)
@@ -5,7 +5,7 @@
 /*
 =c
 
-FromDevice(DEVNAME [, I<keywords> PROMISC, BURST, TIMESTAMP...])
+FromDevice(DEVNAME [, I<keywords> PROMISC, BURST, QUEUES, TIMESTAMP...])
 
 =s netdevices
 
@@ -40,6 +40,19 @@ active.  Default is false.
 
 Unsigned integer.  Sets the BURST parameter.
 
+=item QUEUES
+
+Unsigned integer.  The number of internal queues, at most 64.  With more
+than one, the packets are spread over the queues by flow: a packet goes to
+the queue of the hardware receive queue the driver put it in, where the
+kernel (2.6.30 and later) records it, so that a multi-queue NIC's RSS
+decides, and otherwise to the queue its IPv4 addresses and TCP or UDP ports
+hash to, the same for both directions of a flow.  Each queue is emptied by
+a task of its own, whose home thread is FromDevice's plus the queue number,
+modulo the number of threads; FromDevice may therefore push to its output
+from several threads at once, and the packets of one flow stay in order.
+Default is 1.
+
 =item TIMESTAMP
 
 Boolean.  If true, then ensure that received packets have correctly-set
@@ -92,6 +105,13 @@ packet-type, and device annotations.
 The write handler sets the ACTIVE parameter.  The read handler returns the
 ACTIVE parameter if the device is up, or "false" if the device is down.
 
+=h queues read-only
+
+With QUEUES, one line per queue: its number, the home thread of its task,
+and the packets it holds, has pushed and has dropped as it was full.  The
+tasks of the queues have handlers queueI_scheduled, queueI_tickets and so
+forth.
+
 =a PollDevice, ToDevice, FromHost, ToHost, FromDevice.u */
 
 #include "elements/linuxmodule/anydevice.hh"
@@ -122,6 +142,7 @@ class FromDevice : public AnyTaskDevice, public Storage { public:
     bool run_task(Task *);
     void reset_counts() {
 	_runs = _empty_runs = _pushes = _drops = 0;
+	_queues.reset_counts();
     }
 
   private:
@@ -129,6 +150,7 @@ class FromDevice : public AnyTaskDevice, public Storage { public:
     bool _active;
     unsigned _burst;
     unsigned _drops;
+    AnyDeviceQueues _queues;	// with QUEUES
 
     unsigned _runs;
     unsigned _empty_runs;
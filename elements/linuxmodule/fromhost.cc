@@ -137,6 +137,7 @@ FromHost::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     String type;
     int mtu = 1500;
+    _burst = 8;
     _destaddr = IPAddress();
     _destmask = IPAddress();
     _clear_anno = true;
@@ -148,9 +149,12 @@ FromHost::configure(Vector<String> &conf, ErrorHandler *errh)
 		     "ETHER", 0, cpEthernetAddress, &_macaddr,
 		     "MTU", 0, cpUnsigned, &mtu,
 		     "CAPACITY", 0, cpUnsigned, &_capacity,
+		     "BURST", 0, cpUnsigned, &_burst,
 		     "CLEAR_ANNO", 0, cpBool, &_clear_anno,
 		     cpEnd) < 0)
 	return -1;
+    if (_burst == 0)
+	return errh->error("BURST must be positive");
 
     // check for duplicate element
     if (_devname.length() > IFNAMSIZ - 1)
@@ -373,6 +377,18 @@ FromHost::fl_tx(struct sk_buff *skb, net_device *dev)
          particularly with the task list. The solution is a queue in
          FromHost. fl_tx puts a packet onto the queue, a regular Click Task
          takes the packet off the queue. */
+
+    // Click expects complete checksums: finish those Linux left to the
+    // hardware, before taking the lock
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 19)
+    if (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb) < 0) {
+#else
+    if (skb->ip_summed == CHECKSUM_HW && skb_checksum_help(skb, 0) < 0) {
+#endif
+	dev_kfree_skb(skb);
+	return NETDEV_TX_OK;
+    }
+
     unsigned long lock_flags;
     fromlinux_map.lock(false, lock_flags);
     if (FromHost *fl = (FromHost *)fromlinux_map.lookup(dev, 0)) {
@@ -405,9 +421,12 @@ FromHost::run_task(Task *)
 {
     if (!_nonfull_signal)
 	return false;
+    if (unlikely(empty()))
+	return false;
 
-    if (likely(!empty())) {
-	Packet **q = (_capacity <= smq_size ? _q.smq : _q.lgq);
+    Packet **q = (_capacity <= smq_size ? _q.smq : _q.lgq);
+    PacketBatch batch;
+    for (unsigned n = 0; n < _burst && !empty(); n++) {
 	Packet *p = q[_head];
 	_head = next_i(_head);
 
@@ -431,18 +450,17 @@ FromHost::run_task(Task *)
 	      bad:
 	        _ninvalid++;
 		checked_output_push(1, p);
-		goto done;
+		continue;
 	    }
 	}
 
-	output(0).push(p);
+	batch.push_back(p);
+    }
 
-      done:
-	if (!empty())
-	    _task.fast_reschedule();
-	return true;
-    } else
-	return false;
+    output(0).push_batch(batch);
+    if (!empty())
+	_task.fast_reschedule();
+    return true;
 }
 
 String
@@ -65,6 +65,11 @@ Unsigned.  Maximum length of the internal queue that collects packets from
 Linux.  Defaults to 100.  If this queue overflows, packets will be silently
 dropped.
 
+=item BURST
+
+Unsigned.  The most packets FromHost emits each time it is scheduled, pushed
+on output 0 as one batch.  Defaults to 8.
+
 =item CLEAR_ANNO
 
 Boolean.  Sets whether or not to clear the user annotation area on packets
@@ -82,6 +87,11 @@ address annotations.  Packets with bad IP version or header length are dropped
 or emitted on output 1 if it exists.  Note that FromHost doesn't check IP
 checksums or full packet lengths.
 
+FromHost takes over Linux's buffers without copying them.  Checksums Linux
+left for the hardware to finish, as it may for packets forwarded from
+devices with checksum offload, are finished first, so that packets from
+FromHost always have complete checksums.
+
 If TYPE is ETHER, Linux will send ARP queries to the fake device. You must
 respond to these queries in order to receive any IP packets, but you can
 obviously respond with any Ethernet address you'd like. Here is one common
@@ -163,6 +173,7 @@ class FromHost : public AnyDevice, public Storage { public:
     NotifierSignal _nonfull_signal;
 
     int _mtu;
+    unsigned _burst;
     unsigned _drops;
     unsigned _ninvalid;
 
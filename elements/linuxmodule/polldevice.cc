@@ -63,6 +63,7 @@ PollDevice::static_cleanup()
 }
 
 PollDevice::PollDevice()
+    : _idle_timer(&_task)
 {
 }
 
@@ -76,13 +77,25 @@ PollDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     _burst = 8;
     _headroom = 64;
+    _adaptive = false;
+    _idle_sleep = Timestamp();
+    unsigned nqueues = 1;
     if (AnyDevice::configure_keywords(conf, errh, true) < 0
 	|| cp_va_kparse(conf, this, errh,
 			"DEVNAME", cpkP+cpkM, cpString, &_devname,
 			"BURST", cpkP, cpUnsigned, &_burst,
 			"HEADROOM", 0, cpUnsigned, &_headroom,
+			"ADAPTIVE", 0, cpBool, &_adaptive,
+			"IDLE_SLEEP", 0, cpTimestamp, &_idle_sleep,
+			"QUEUES", 0, cpUnsigned, &nqueues,
 			cpEnd) < 0)
 	return -1;
+    if (_burst == 0)
+	return errh->error("BURST must be positive");
+    if (nqueues < 1 || nqueues > AnyDeviceQueues::MAX_QUEUES)
+	return errh->error("QUEUES must be between 1 and %d", AnyDeviceQueues::MAX_QUEUES);
+    _cur_burst = _burst;
+    _queues.configure(this, nqueues);
 
 #if HAVE_LINUX_POLLING
     if (find_device(&poll_device_map, errh) < 0)
@@ -128,6 +141,9 @@ you include a ToDevice for the same device. Try adding\n\
     }
 
     ScheduleInfo::initialize_task(this, &_task, _dev != 0, errh);
+    _idle_timer.initialize(this);
+    _queues.initialize(this, _task.home_thread_id());
+    _empty_run = 0;
 #if HAVE_STRIDE_SCHED
     // user specifies max number of tickets; we start with default
     _max_tickets = _task.tickets();
@@ -147,6 +163,8 @@ void
 PollDevice::reset_counts()
 {
   _npackets = 0;
+  _npolls = 0;
+  _nempty_polls = 0;
 
 #if CLICK_DEVICE_STATS
   _activations = 0;
@@ -167,6 +185,7 @@ PollDevice::reset_counts()
   _push_cycles = 0;
 #endif
   _buffers_reused = 0;
+  _queues.reset_counts();
 }
 
 void
@@ -185,11 +204,14 @@ PollDevice::cleanup(CleanupStage)
 	had_dev->poll_off(had_dev);
     poll_device_map.unlock(false, lock_flags);
 #endif
+    _queues.cleanup();
 }
 
 bool
-PollDevice::run_task(Task *)
+PollDevice::run_task(Task *task)
 {
+    if (task != &_task)
+	return _queues.run_task(task, this, _burst);
 #if HAVE_LINUX_POLLING
   struct sk_buff *skb_list, *skb;
   int got=0;
@@ -200,8 +222,19 @@ PollDevice::run_task(Task *)
 
   SET_STATS(low00, low10, time_now);
 
-  got = _burst;
+  got = _cur_burst;
   skb_list = _dev->rx_poll(_dev, &got);
+  _npolls++;
+  if (got == 0)
+    _nempty_polls++;
+
+  // a full burst means more packets wait in the ring
+  if (_adaptive) {
+    if (got >= (int) _cur_burst)
+      _cur_burst = (_cur_burst * 2 < _burst ? _cur_burst * 2 : _burst);
+    else if (got < (int) (_cur_burst / 2))
+      _cur_burst = (_cur_burst > 1 ? _cur_burst / 2 : 1);
+  }
 
 # if CLICK_DEVICE_STATS
   if (got > 0 || _activations > 0) {
@@ -281,7 +314,10 @@ PollDevice::run_task(Task *)
 # if CLICK_DEVICE_THESIS_STATS && !CLICK_DEVICE_STATS
     click_cycles_t before_push_cycles = click_get_cycles();
 # endif
-    output(0).push(p);
+    if (!_queues.size())
+      output(0).push(p);
+    else if (!_queues.enqueue(_queues.queue_for(p), p))
+      p->kill();
 # if CLICK_DEVICE_THESIS_STATS && !CLICK_DEVICE_STATS
     _push_cycles += click_get_cycles() - before_push_cycles - CLICK_CYCLE_COMPENSATION;
 # endif
@@ -299,6 +335,14 @@ PollDevice::run_task(Task *)
 # endif
 
   adjust_tickets(got);
+  if (got > 0)
+    _empty_run = 0;
+  else if (_idle_sleep && ++_empty_run >= IDLE_POLLS) {
+    // nothing to do for a while: rest until the timer reschedules us
+    _empty_run = 0;
+    _idle_timer.schedule_after(_idle_sleep);
+    return false;
+  }
   _task.fast_reschedule();
   return got > 0;
 #else
@@ -314,6 +358,7 @@ PollDevice::change_device(net_device *dev)
 
     if (dev_change) {
 	_task.strong_unschedule();
+	_idle_timer.unschedule();
 
 	if (dev && (!dev->poll_on || dev->polling < 0)) {
 	    click_chatter("%s: device '%s' does not support polling", declaration().c_str(), _devname.c_str());
@@ -407,6 +452,12 @@ PollDevice_read_stats(Element *e, void *thunk)
 #endif
    case 4:
     return String(pd->_buffers_reused);
+   case 5:
+    return String(pd->_npolls);
+   case 6:
+    return String(pd->_nempty_polls);
+   case 7:
+    return String(pd->_cur_burst);
    default:
     return String();
   }
@@ -436,7 +487,11 @@ PollDevice::add_handlers()
 #endif
   add_write_handler("reset_counts", PollDevice_write_stats, 0, Handler::BUTTON);
   add_read_handler("buffers_reused", PollDevice_read_stats, (void *)4);
+  add_read_handler("polls", PollDevice_read_stats, (void *)5);
+  add_read_handler("empty_polls", PollDevice_read_stats, (void *)6);
+  add_read_handler("burst", PollDevice_read_stats, (void *)7);
   add_task_handlers(&_task);
+  _queues.add_handlers(this);
 }
 
 ELEMENT_REQUIRES(AnyDevice linuxmodule)
@@ -4,7 +4,7 @@
 /*
 =c
 
-PollDevice(DEVNAME [, I<keywords> PROMISC, BURST, TIMESTAMP...])
+PollDevice(DEVNAME [, I<keywords> PROMISC, BURST, ADAPTIVE, IDLE_SLEEP, QUEUES, TIMESTAMP...])
 
 =s netdevices
 
@@ -35,6 +35,36 @@ active.  Default is false.
 
 Unsigned integer.  Sets the BURST parameter.
 
+=item ADAPTIVE
+
+Boolean.  If true, then BURST is the largest burst, and PollDevice sizes its
+bursts by how full it finds the receive ring: a poll that fills the burst
+doubles the next one, a poll that fills less than half of it halves the next
+one.  Lightly loaded devices are then polled a few packets at a time, and
+loaded ones in long batches.  Default is false.
+
+=item IDLE_SLEEP
+
+Time.  If nonzero, then after 64 polls in a row find no packet, PollDevice
+stops polling for this long and lets other tasks, or the CPU, rest; packets
+arriving meanwhile wait in the receive ring, so this should be well below
+the time the ring takes to fill at line rate.  Default is 0, to poll
+continuously.
+
+=item QUEUES
+
+Unsigned integer.  The number of internal queues, at most 64.  With more
+than one, PollDevice still polls the device from its own task, but instead
+of pushing the packets it spreads them over the queues by flow, by the
+hardware receive queue the kernel recorded for them (2.6.30 and later) or
+else by a hash of their IPv4 addresses and TCP or UDP ports, the same for
+both directions of a flow.  Each queue is emptied by a task of its own,
+whose home thread is PollDevice's plus the queue number, modulo the number
+of threads, so that the processing downstream runs on several threads while
+the packets of one flow stay in order; PollDevice may therefore push to its
+output from several threads at once.  A packet that finds its queue full is
+dropped.  Default is 1.
+
 =item TIMESTAMP
 
 Boolean.  If true, then ensure that received packets have correctly-set
@@ -85,13 +115,33 @@ packet-type, and device annotations.
 
 Returns the number of packets PollDevice has received from the input card.
 
+=h polls read-only
+
+Returns the number of times PollDevice polled the device.
+
+=h empty_polls read-only
+
+Returns the number of polls that found no packet.
+
+=h burst read-only
+
+Returns the current burst size.
+
 =h reset_counts write-only
 
-Resets C<count> counter to zero when written.
+Resets C<count>, C<polls> and C<empty_polls> counters to zero when written.
+
+=h queues read-only
+
+With QUEUES, one line per queue: its number, the home thread of its task,
+and the packets it holds, has pushed and has dropped as it was full.  The
+tasks of the queues have handlers queueI_scheduled, queueI_tickets and so
+forth.
 
 =a FromDevice, ToDevice, FromHost, ToHost */
 
 #include "elements/linuxmodule/anydevice.hh"
+#include <click/timer.hh>
 
 class PollDevice : public AnyTaskDevice { public:
 
@@ -120,6 +170,8 @@ class PollDevice : public AnyTaskDevice { public:
   void reset_counts();
 
   uint32_t _npackets;
+  uint32_t _npolls;
+  uint32_t _nempty_polls;
 #if CLICK_DEVICE_STATS
   uint64_t _time_poll;
   uint64_t _time_allocskb;
@@ -147,6 +199,14 @@ class PollDevice : public AnyTaskDevice { public:
 
     unsigned _burst;
     unsigned _headroom;
+    bool _adaptive;
+    unsigned _cur_burst;	// with ADAPTIVE, at most _burst
+    Timestamp _idle_sleep;
+    int _empty_run;		// polls in a row that found nothing
+    Timer _idle_timer;		// reschedules _task after an idle sleep
+    AnyDeviceQueues _queues;	// with QUEUES
+
+    enum { IDLE_POLLS = 64 };
 
 };
 
@@ -131,8 +131,12 @@ device_notifier_hook(struct notifier_block *nb, unsigned long flags, void *v)
 }
 }
 
-void
-ToHost::push(int port, Packet *p)
+/*
+ * Readies a packet for the host stack: returns its skb, or null if it was
+ * dropped.  The packet's data is handed over as is, without a copy.
+ */
+struct sk_buff *
+ToHost::prepare(Packet *p)
 {
     p->clear_annotations(false);
 
@@ -147,7 +151,7 @@ ToHost::push(int port, Packet *p)
 	if (++_drops == 1)
 	    click_chatter("%{element}: dropped a packet with null skb->dev", this);
 	p->kill();
-	return;
+	return 0;
     }
 
     // remove PACKET_CLEAN bit -- packet is becoming dirty
@@ -189,22 +193,54 @@ ToHost::push(int port, Packet *p)
 	skb->dst = 0;
     }
 
+    // A device's full checksum covers the bytes as they were received,
+    // which Click may have changed since, so Linux must checksum the packet
+    // itself.  A checksum the device verified stays verified: elements that
+    // change a packet update its checksums.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 19)
+    if (skb->ip_summed == CHECKSUM_COMPLETE)
+#else
+    if (skb->ip_summed == CHECKSUM_HW)
+#endif
+	skb->ip_summed = CHECKSUM_NONE;
+
+    return skb;
+}
+
+#ifdef HAVE_NETIF_RECEIVE_SKB	// from Linux headers
+// call with bottom halves disabled
+inline void
+ToHost::deliver(struct sk_buff *skb)
+{
     // get protocol to pass to Linux
     int protocol = (_sniffers ? 0xFFFF : skb->protocol);
 
-    // pass packet to Linux
-#ifdef HAVE_NETIF_RECEIVE_SKB	// from Linux headers
     struct net_device *dev = skb->dev;
-    local_bh_disable();
     dev_hold(dev);
 # if HAVE___NETIF_RECEIVE_SKB
-    int ret = __netif_receive_skb(skb, protocol, -1);
+    (void) __netif_receive_skb(skb, protocol, -1);
 # else
     netif_receive_skb(skb, protocol, -1);
 # endif
     dev_put(dev);
+}
+#endif
+
+void
+ToHost::push(int, Packet *p)
+{
+    struct sk_buff *skb = prepare(p);
+    if (!skb)
+	return;
+
+    // pass packet to Linux
+#ifdef HAVE_NETIF_RECEIVE_SKB	// from Linux headers
+    local_bh_disable();
+    deliver(skb);
     local_bh_enable();
 #else
+    int protocol = (_sniffers ? 0xFFFF : skb->protocol);
+
     // be nice to libpcap
     if (skb->stamp.tv_sec == 0) {
 # if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 4, 18)
@@ -236,6 +272,22 @@ ToHost::push(int port, Packet *p)
 #endif
 }
 
+void
+ToHost::push_batch(int port, PacketBatch &batch)
+{
+#ifdef HAVE_NETIF_RECEIVE_SKB
+    // one bottom-half section for the whole batch, as NAPI delivers the
+    // packets of a poll
+    local_bh_disable();
+    while (Packet *p = batch.pop_front())
+	if (struct sk_buff *skb = prepare(p))
+	    deliver(skb);
+    local_bh_enable();
+#else
+    Element::push_batch(port, batch);
+#endif
+}
+
 void
 ToHost::add_handlers()
 {
@@ -87,6 +87,13 @@
  * to DEVNAME, and a routable source address. Otherwise Linux will silently
  * drop the packets.
  *
+ * ToHost hands the packets' buffers to Linux without copying them.  A batch
+ * of packets, from an element that pushes batches, is delivered within one
+ * bottom-half section, the way a NAPI driver delivers a poll's worth of
+ * packets.  Checksums a device verified stay verified; a device's full
+ * checksum, which Click may have invalidated, is dropped, so that Linux
+ * checksums such packets itself.
+ *
  * =h drops read-only
  *
  * Reports the number of packets ToHost has dropped because they had a null
@@ -117,6 +124,7 @@ class ToHost : public AnyDevice { public:
     void add_handlers();
 
     void push(int port, Packet *);
+    void push_batch(int port, PacketBatch &batch);
 
   private:
 
@@ -124,6 +132,9 @@ class ToHost : public AnyDevice { public:
     int _drops;
     int _type;
 
+    struct sk_buff *prepare(Packet *);
+    inline void deliver(struct sk_buff *);
+
     friend class ToHostSniffers;
 
 };
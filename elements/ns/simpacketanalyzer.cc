@@ -16,6 +16,13 @@ SimPacketAnalyzer::~SimPacketAnalyzer()
 }
 
 
+int
+SimPacketAnalyzer::analyze_binary(Packet *, int, uint8_t *, int)
+{
+  return 0;
+}
+
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(ns)
 ELEMENT_PROVIDES(SimPacketAnalyzer)
@@ -14,10 +14,13 @@ CLICK_DECLS
  * =d
  *
  * Implement this interface for specific protocols to allow analysis of
- * packets in ToSimTrace.
+ * packets in ToSimTrace. Analyzers that also implement analyze_binary()
+ * can be used with ToSimBinaryTrace, which stores their analysis as a few
+ * raw bytes instead of a formatted string. The first of these bytes tells
+ * decode-simtrace.pl, in conf/, how to print the others.
  *
  * =a
- * ToSimTrace
+ * ToSimTrace, ToSimBinaryTrace
  */
 
 
@@ -32,6 +35,10 @@ public:
 
   virtual String analyze(Packet*, int offset) = 0;
 
+  // Writes at most len bytes analyzing the packet to buf and returns their
+  // number. The default writes none.
+  virtual int analyze_binary(Packet*, int offset, uint8_t *buf, int len);
+
 private:
 
 };
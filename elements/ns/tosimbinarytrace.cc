@@ -0,0 +1,168 @@
+/*
+ * tosimbinarytrace.{cc,hh} -- writes fixed size binary trace records
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/packet_anno.hh>
+#include "tosimbinarytrace.hh"
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+CLICK_DECLS
+
+ToSimBinaryTrace::ToSimBinaryTrace()
+  : _packetAnalyzer(0), _offset(0), _fd(-1), _window(0),
+    _window_offset(0), _window_used(0), _count(0)
+{
+}
+
+
+ToSimBinaryTrace::~ToSimBinaryTrace()
+{
+}
+
+
+int
+ToSimBinaryTrace::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  if (cp_va_kparse(conf, this, errh,
+		   "FILENAME", cpkP+cpkM, cpFilename, &_filename,
+		   "EVENT", cpkP+cpkM, cpString, &_event,
+		   "ANALYZER", 0, cpElement, &_packetAnalyzer,
+		   "OFFSET", 0, cpInteger, &_offset,
+		   cpEnd) < 0)
+    return -1;
+  if (!_event.length())
+    return errh->error("EVENT must not be empty");
+  return 0;
+}
+
+
+int
+ToSimBinaryTrace::initialize(ErrorHandler *errh)
+{
+  int node = router()->sim_get_node_id();
+  String filename = _filename;
+  int pct = filename.find_left("%d");
+  if (pct >= 0)
+    filename = filename.substring(0, pct) + String(node) + filename.substring(pct + 2);
+
+  _fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (_fd < 0)
+    return errh->error("%s: %s", filename.c_str(), strerror(errno));
+  if (map_window(0, errh) < 0)
+    return -1;
+
+  Header *h = reinterpret_cast<Header *>(_window);
+  h->magic = htonl(MAGIC);
+  h->version = htons(VERSION);
+  h->record_size = htons(sizeof(Record));
+  h->node = htonl(node);
+  _window_used = sizeof(Header);
+  return 0;
+}
+
+
+/**
+ * grows the file to cover a window at offset and maps it
+ */
+int
+ToSimBinaryTrace::map_window(off_t offset, ErrorHandler *errh)
+{
+  if (ftruncate(_fd, offset + WINDOW_SIZE) < 0)
+    return errh->error("%s: %s", _filename.c_str(), strerror(errno));
+  void *p = mmap(0, WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, offset);
+  if (p == MAP_FAILED)
+    return errh->error("%s: mmap: %s", _filename.c_str(), strerror(errno));
+  _window = reinterpret_cast<uint8_t *>(p);
+  _window_offset = offset;
+  _window_used = 0;
+  return 0;
+}
+
+
+void
+ToSimBinaryTrace::unmap_window()
+{
+  if (_window)
+    munmap(_window, WINDOW_SIZE);
+  _window = 0;
+}
+
+
+void
+ToSimBinaryTrace::cleanup(CleanupStage)
+{
+  if (_fd < 0)
+    return;
+  // cut the file after the last record
+  off_t size = _window_offset + _window_used;
+  unmap_window();
+  (void) ftruncate(_fd, size);
+  close(_fd);
+  _fd = -1;
+}
+
+
+void
+ToSimBinaryTrace::push(int, Packet *packet)
+{
+  simclick_simpacketinfo* pinfo = packet->get_sim_packetinfo();
+  // as in ToSimTrace
+  if (pinfo->id < 0)
+    pinfo->id = router()->sim_get_next_pkt_id();
+
+  if (_window && _window_used == WINDOW_SIZE) {
+    off_t next = _window_offset + WINDOW_SIZE;
+    unmap_window();
+    if (map_window(next, ErrorHandler::default_handler()) < 0)
+      click_chatter("%s: tracing stopped", name().c_str());
+  }
+
+  if (_window) {
+    struct timeval now;
+    click_gettimeofday(&now);
+    Record *r = reinterpret_cast<Record *>(_window + _window_used);
+    r->sec = htonl(now.tv_sec);
+    r->usec = htonl(now.tv_usec);
+    r->node = htonl(router()->sim_get_node_id());
+    r->packet_id = htonl(pinfo->id);
+    r->length = htonl(packet->length() - _offset);
+    r->event = _event[0];
+    r->reserved = 0;
+    int n = 0;
+    if (_packetAnalyzer)
+      n = _packetAnalyzer->analyze_binary(packet, _offset, r->analysis, ANALYSIS_SIZE);
+    r->analysis_length = n;
+    memset(r->analysis + n, 0, ANALYSIS_SIZE - n);
+    _window_used += sizeof(Record);
+    _count++;
+  }
+
+  output(0).push(packet);
+}
+
+
+String
+ToSimBinaryTrace::read_count(Element *e, void *)
+{
+  ToSimBinaryTrace *t = static_cast<ToSimBinaryTrace *>(e);
+  return String(t->_count) + "\n";
+}
+
+
+void
+ToSimBinaryTrace::add_handlers()
+{
+  add_read_handler("count", read_count, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(ns)
+EXPORT_ELEMENT(ToSimBinaryTrace)
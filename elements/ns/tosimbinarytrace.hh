@@ -0,0 +1,122 @@
+#ifndef CLICK_TOSIMBINARYTRACE_HH
+#define CLICK_TOSIMBINARYTRACE_HH
+
+#include <click/element.hh>
+#include <click/router.hh>
+#include "simpacketanalyzer.hh"
+CLICK_DECLS
+
+/*
+=c
+ToSimBinaryTrace(FILENAME, EVENT [, I<KEYWORDS>])
+
+=s traces
+
+writes fixed size binary trace records
+
+=io
+One input, one output
+
+=d
+
+Like ToSimTrace, but writes each packet as a fixed size record to its own
+trace file instead of a line to the ns2 trace. A record holds the time, the
+node id, the ns2 packet id, the packet length less OFFSET, the first
+character of EVENT and up to 16 bytes of analysis from ANALYZER's
+analyze_binary(). No string is formatted while the simulation runs, and
+the records take a fraction of the room of the text lines.
+
+The file is memory mapped and grown in windows of 64k records, so a record
+is written with a plain copy. An occurrence of "%d" in FILENAME is replaced
+by the node id, which gives every node of a simulation its own file.
+
+The file starts with a header the size of a record: the magic number
+0x43535452 ("CSTR"), the version and record size and the node id. All
+fields are in network byte order. conf/decode-simtrace.pl prints one or
+more of these files, merged by time, in the format of ToSimTrace.
+
+Keyword arguments are:
+
+=over 8
+
+=item ANALYZER
+
+SimPacketAnalyzer element. Default is none.
+
+=item OFFSET
+
+Integer. Offset of the data ANALYZER looks at, and the number of bytes not
+counted in the length. Default is 0.
+
+=back
+
+=h count read-only
+Number of records written.
+
+=a
+ToSimTrace, SimPacketAnalyzer
+*/
+
+class ToSimBinaryTrace : public Element { public:
+
+  ToSimBinaryTrace();
+  ~ToSimBinaryTrace();
+
+  const char* class_name() const { return "ToSimBinaryTrace"; }
+  const char* processing() const { return PUSH; }
+  const char* port_count() const { return PORTS_1_1; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *errh);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void push(int, Packet *packet);
+
+  enum { MAGIC = 0x43535452, VERSION = 1, ANALYSIS_SIZE = 16 };
+
+  struct Record {
+    uint32_t sec;
+    uint32_t usec;
+    int32_t node;
+    int32_t packet_id;
+    uint32_t length;
+    uint8_t event;
+    uint8_t analysis_length;
+    uint16_t reserved;
+    uint8_t analysis[ANALYSIS_SIZE];
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    int32_t node;
+    uint8_t reserved[sizeof(Record) - 12];
+  };
+
+ private:
+
+  // a multiple of the page size, 64k records
+  enum { WINDOW_SIZE = sizeof(Record) << 16 };
+
+  String _filename;
+  String _event;
+  SimPacketAnalyzer *_packetAnalyzer;
+  int _offset;
+
+  int _fd;
+  uint8_t *_window;		// mapping of the file from _window_offset
+  off_t _window_offset;
+  size_t _window_used;		// bytes
+  uint32_t _count;
+
+  int map_window(off_t offset, ErrorHandler *errh);
+  void unmap_window();
+
+  static String read_count(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -9,8 +9,14 @@ Loosely based on click_aodv.hh from Colorado AODV Click implementation
 #include <click/ipaddress.hh>
 #include <click/glue.hh>
 #include <click/vector.hh>
+#include <click/smallvector.hh>
 #include <click/string.hh>
 #include <click/ipaddress.hh>
+#include <click/packet.hh>
+#include <click/timestamp.hh>
+#if CLICK_USERLEVEL
+# include <time.h>
+#endif
 //#include <netinet/in.h>
 
 //#define debug
@@ -20,9 +26,6 @@ Loosely based on click_aodv.hh from Colorado AODV Click implementation
 
 CLICK_DECLS
 
-//Number of allowed interfaces
-#define OLSR_NO_OF_INTERFACES 1
-
 //Scaling factor for validity time calculation
 //const float OLSR_C = 0.0625;
 const int OLSR_C_us = 62500;
@@ -38,6 +41,17 @@ const int OLSR_C_us = 62500;
 #define OLSR_TC_MESSAGE    2
 #define OLSR_MID_MESSAGE   3
 #define OLSR_HNA_MESSAGE   4
+//link quality extension, as in olsrd: HELLO and TC messages whose
+//advertised addresses are each followed by an olsr_lq_info
+#define OLSR_LQ_HELLO_MESSAGE 201
+#define OLSR_LQ_TC_MESSAGE    202
+//sent by HNA gateways next to their HNA messages, with one
+//olsr_gateway_load as body; flooded like HNA messages
+#define OLSR_GATEWAY_LOAD_MESSAGE 203
+//HELLO and TC messages (LQ or not) whose addresses are packed in
+//olsr_addr_blocks, see olsr_address_block.hh
+#define OLSR_COMPACT_HELLO_MESSAGE 204
+#define OLSR_COMPACT_TC_MESSAGE    205
 
 //Link Types
 #define OLSR_UNSPEC_LINK 0
@@ -50,10 +64,10 @@ const int OLSR_C_us = 62500;
 #define OLSR_SYM_NEIGH 1
 #define OLSR_MPR_NEIGH 2
 
-//Link Hysteresis
-#define OLSR_HYST_THRESHOLD_HIGH 0.8
-#define OLSR_HYST_THRESHOLD_LOW  0.3
-#define OLSR_HYST_SCALING        0.5
+//Link Hysteresis, in fixed point: link qualities run from 0 to 65535
+#define OLSR_HYST_THRESHOLD_HIGH 52428	// 0.8
+#define OLSR_HYST_THRESHOLD_LOW  19661	// 0.3
+#define OLSR_HYST_SCALING_SHIFT  1	// HYST_SCALING 0.5 == 1 >> 1
 
 //Willingness
 #define OLSR_WILL_NEVER   0
@@ -73,6 +87,37 @@ const uint16_t OLSR_MAX_SEQNUM = 65535;
 //IPv4
 #define OLSR_MINIMUM_PACKET_LENGTH 16 
 
+//Headroom of the packets the generators make: the UDP, IP and Ethernet
+//headers are pushed in front of the OLSR packet header without a copy, and
+//the two extra bytes put the IP header on a four-byte boundary. In the
+//kernel the whole control packet fits skbmgr's smallest recycled buffer.
+#define OLSR_HEADROOM (2 + 14 + 20 + 8)
+
+//Nodes with one radio can be built with -DOLSR_SINGLE_INTERFACE=1:
+//OLSRLocalIfInfoBase then takes exactly one address and its lookups fold
+//to a comparison with it, links all get interface index 0, and the MPR
+//computation skips the steps that only matter across interfaces
+#ifndef OLSR_SINGLE_INTERFACE
+# define OLSR_SINGLE_INTERFACE 0
+#endif
+
+//A private copy of a message template, in one buffer of the same layout;
+//clone()->uniqueify() would make the clone only to copy it at once
+inline WritablePacket *
+olsr_copy_packet(const Packet *p)
+{
+  WritablePacket *q = Packet::make(p->headroom(), p->data(), p->length(), p->tailroom());
+  if (q)
+    q->copy_annotations(p);
+  return q;
+}
+
+//OLSRClassifier passes what it found in the duplicate set for a message on
+//to OLSRForward: OLSR_DUPLICATE_ANNO is OLSR_DUP_LOOKED_UP if it looked
+//(0 otherwise), OLSR_DUPLICATE_TUPLE_ANNO holds the tuple found or null,
+//and OLSR_DUPLICATE_GEN_ANNO the duplicate set's generation at the time
+enum { OLSR_DUP_UNKNOWN = 0, OLSR_DUP_LOOKED_UP = 1 };
+
 /// == mvhaen ====================================================================================================
 #define MIN_MPR 2
 /// == !mvhaen ===================================================================================================
@@ -84,6 +129,16 @@ struct olsr_pkt_hdr{
   uint16_t pkt_seq;
 };
 
+//OLSRDataAggregator sends the data packets it combines for one next hop in
+//an IP packet of this protocol (RFC 3692 experimentation) to the next hop;
+//each packet follows an olsr_aggregate_record and is padded to four bytes
+#define OLSR_AGGREGATE_PROTO 253
+
+struct olsr_aggregate_record{
+  uint16_t length;			// of the packet, without the padding
+  uint16_t reserved;
+};
+
 //OLSR Message Header
 struct olsr_msg_hdr{
   uint8_t msg_type;
@@ -115,6 +170,167 @@ struct olsr_tc_hdr{
   uint16_t reserved;
 };
 
+//follows each address in LQ_HELLO and LQ_TC messages: the share of the
+//other node's HELLOs the advertising node received, and the reverse
+struct olsr_lq_info{
+  uint8_t lq;
+  uint8_t nlq;
+  uint16_t reserved;
+};
+
+//follows the HELLO or TC header of COMPACT_HELLO and COMPACT_TC messages,
+//as many as the message size leaves room for: the head_length bytes all
+//addresses of the block start with, then the remaining bytes of each
+//address, then, with OLSR_ADDR_BLOCK_LQ, the lq and nlq of each address;
+//the block is padded to four bytes
+struct olsr_addr_block_hdr{
+  uint8_t num_addr;
+  uint8_t flags;
+  uint8_t head_length;
+  uint8_t link_code;			// of all the addresses; 0 in TC messages
+};
+
+#define OLSR_ADDR_BLOCK_LQ 0x01
+
+//ends every message when OLSRAuthenticate is used, counted in its size: an
+//HMAC-SHA1 digest, truncated to 96 bits, of the message with its TTL and
+//hop count taken as 0 and this trailer with the digest left out
+#define OLSR_AUTH_DIGEST_SIZE 12
+
+struct olsr_auth_trailer{
+  uint8_t key_id;
+  uint8_t reserved[3];
+  uint8_t digest[OLSR_AUTH_DIGEST_SIZE];
+};
+
+//body of GATEWAY_LOAD messages: the uplink capacity of the originator and
+//the part of it in use, in kbit/s
+struct olsr_gateway_load{
+  uint32_t capacity;
+  uint32_t load;
+};
+
+//expected transmission count of a link with delivery ratios lq and nlq
+//(0-255) in its two directions, 256 for a perfect link
+#define OLSR_ETX_ONE      256
+#define OLSR_ETX_INFINITE (1 << 24)
+
+inline int
+olsr_etx(int lq, int nlq)
+{
+  if (lq <= 0 || nlq <= 0)
+    return OLSR_ETX_INFINITE;
+  return (255 * 255 * OLSR_ETX_ONE) / (lq * nlq);
+}
+
+//expected transmission time of a link with ETX etx used at a bit-rate of
+//rate (in 500 kbit/s units, as the wifi elements give it): the ETX scaled by
+//OLSR_ETT_RATE / rate, so that it equals the ETX at 54 Mbit/s; per-frame
+//overheads are ignored. A link without a known rate keeps its ETX
+#define OLSR_ETT_RATE     108
+
+inline int
+olsr_ett(int etx, int rate)
+{
+  if (rate <= 0 || etx >= OLSR_ETX_INFINITE)
+    return etx;
+  int64_t ett = (int64_t) etx * OLSR_ETT_RATE / rate;
+  return ett < OLSR_ETX_INFINITE ? (int) ett : OLSR_ETX_INFINITE - 1;
+}
+
+//a link the MAC reports as failing (see OLSRTXFeedback) costs this many
+//times its ETX, and advertises a quality this many times lower, so that
+//routes move to other links before it fails altogether
+#define OLSR_DEGRADED_PENALTY 4
+
+
+//Times
+
+//Tuple times count microseconds on a clock that only moves forward, so
+//that setting the wall clock neither expires every tuple at once nor keeps
+//them all forever: CLOCK_MONOTONIC at user level, Timestamp::now()
+//elsewhere (simulated time in ns). Zero means unset. Intervals use the same
+//type; as the clocks differ, only they may be converted to and from
+//Timestamps, to schedule Click timers.
+typedef int64_t olsr_time_t;
+
+inline olsr_time_t
+olsr_now()
+{
+#if CLICK_USERLEVEL && !CLICK_NS && defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (olsr_time_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return Timestamp::now().usecval();
+#endif
+}
+
+inline olsr_time_t
+olsr_msec(int64_t msec)
+{
+  return msec * 1000;
+}
+
+inline olsr_time_t
+olsr_interval(const Timestamp &interval)
+{
+  return interval.usecval();
+}
+
+inline Timestamp
+olsr_timestamp(olsr_time_t interval)
+{
+  return Timestamp::make_usec(interval);
+}
+
+//when a Click timer must fire to run at time when
+inline Timestamp
+olsr_timer_expiry(olsr_time_t when)
+{
+  return Timestamp::now() + olsr_timestamp(when - olsr_now());
+}
+
+//RFC 3626 section 18.3: a vtime or htime byte a*16+b stands for
+//C*(1+a/16)*2^b seconds. olsr_vtime_usec[v] is the interval of byte v, so
+//that decoding is one load; the table is a constant expression, kept only
+//by the files that use it
+#define OLSR_VTIME(a, b) ((((olsr_time_t) OLSR_C_us * (16 + (a))) << (b)) >> 4)
+#define OLSR_VTIME_ROW(a) \
+  OLSR_VTIME(a, 0), OLSR_VTIME(a, 1), OLSR_VTIME(a, 2), OLSR_VTIME(a, 3), \
+  OLSR_VTIME(a, 4), OLSR_VTIME(a, 5), OLSR_VTIME(a, 6), OLSR_VTIME(a, 7), \
+  OLSR_VTIME(a, 8), OLSR_VTIME(a, 9), OLSR_VTIME(a, 10), OLSR_VTIME(a, 11), \
+  OLSR_VTIME(a, 12), OLSR_VTIME(a, 13), OLSR_VTIME(a, 14), OLSR_VTIME(a, 15)
+
+static const olsr_time_t olsr_vtime_usec[256] = {
+  OLSR_VTIME_ROW(0), OLSR_VTIME_ROW(1), OLSR_VTIME_ROW(2), OLSR_VTIME_ROW(3),
+  OLSR_VTIME_ROW(4), OLSR_VTIME_ROW(5), OLSR_VTIME_ROW(6), OLSR_VTIME_ROW(7),
+  OLSR_VTIME_ROW(8), OLSR_VTIME_ROW(9), OLSR_VTIME_ROW(10), OLSR_VTIME_ROW(11),
+  OLSR_VTIME_ROW(12), OLSR_VTIME_ROW(13), OLSR_VTIME_ROW(14), OLSR_VTIME_ROW(15)
+};
+
+#undef OLSR_VTIME_ROW
+#undef OLSR_VTIME
+
+inline olsr_time_t
+olsr_vtime_decode(uint8_t vtime)
+{
+  return olsr_vtime_usec[vtime];
+}
+
+//the byte of the shortest interval not below interval, as validity times
+//must be rounded up: 0, for C, below that, and 0xFF above what it holds
+inline uint8_t
+olsr_vtime_encode(olsr_time_t interval)
+{
+  int b = 0;
+  while (b < 15 && olsr_vtime_usec[0xF0 | b] < interval)
+    b++;
+  for (int a = 0; a < 16; a++)
+    if (olsr_vtime_usec[(a << 4) | b] >= interval)
+      return (a << 4) | b;
+  return 0xFF;
+}
 
 //Wrappers
 struct pkt_hdr_info{
@@ -126,7 +342,7 @@ struct msg_hdr_info{
   int msg_type;
   int vtime_a;  //highest four bits in the vtime field
   int vtime_b;  //lowest four bits in the vitme field
-  struct timeval validity_time;
+  olsr_time_t validity_time;
   int msg_size;
   IPAddress originator_address;
   int ttl;
@@ -152,21 +368,40 @@ struct tc_hdr_info{
 
 
 //Data structure tuples
+
+//receiving interfaces of a duplicate tuple; the first
+//OLSR_DUPLICATE_IFACES are stored inline, more spill to the heap
+#define OLSR_DUPLICATE_IFACES 4
+
+typedef SmallVector<IPAddress, OLSR_DUPLICATE_IFACES> duplicate_iface_list;
+
 struct duplicate_data{
   IPAddress D_addr;
   int D_seq_num;
   int D_retransmitted;
-  Vector<IPAddress> D_iface_list;
-  struct timeval D_time;
+  duplicate_iface_list D_iface_list;
+  olsr_time_t D_time;
+  uint8_t D_digest[OLSR_AUTH_DIGEST_SIZE];	// see OLSRDuplicateSet::add_verified
 };
 
 struct link_data{
   IPAddress L_local_iface_addr;
+  int L_local_iface_index;		// dense, see OLSRLinkInfoBase::local_iface_index
   IPAddress L_neigh_iface_addr;
-  IPAddress _main_addr;
-  struct timeval L_SYM_time;
-  struct timeval L_ASYM_time;
-  struct timeval L_time;
+  IPAddress _main_addr;			// of the neighbor, see OLSRLinkInfoBase::neighbor_main_address
+  unsigned _main_addr_generation;
+  struct neighbor_data *_neighbor;	// its tuple, see OLSRLinkInfoBase::neighbor_tuple
+  unsigned _neighbor_generation;
+  olsr_time_t L_SYM_time;
+  olsr_time_t L_ASYM_time;
+  olsr_time_t L_time;
+  int L_lq;				// share of the neighbor's HELLOs received, 0-65535
+  uint8_t L_nlq;			// share of ours the neighbor received, 0-255
+  olsr_time_t L_last_hello;
+  int L_link_quality;			// hysteresis, RFC 3626 section 14, 0-65535
+  bool L_link_pending;
+  olsr_time_t L_LOST_LINK_time;
+  bool L_degraded;			// see OLSRLinkInfoBase::set_link_degraded
 };
 
 struct neighbor_data{
@@ -178,32 +413,34 @@ struct neighbor_data{
 struct twohop_data{
   IPAddress N_neigh_main_addr;
   IPAddress N_twohop_addr;
-  struct timeval N_time;
+  olsr_time_t N_time;
+  int N_cost;				// ETX of the link between the two, see olsr_etx
 };
 
 struct mpr_selector_data{
   IPAddress MS_main_addr;
-  struct timeval MS_time;
+  olsr_time_t MS_time;
 };
 
 struct topology_data{
   IPAddress T_dest_addr;
   IPAddress T_last_addr;
   int T_seq;
-  struct timeval T_time;
+  olsr_time_t T_time;
+  int T_cost;				// ETX of the link between the two, see olsr_etx
 };
 
 struct interface_data{
   IPAddress I_iface_addr;
   IPAddress I_main_addr;
-  struct timeval I_time;
+  olsr_time_t I_time;
 };
 
 struct association_data{
   IPAddress A_gateway_addr;
   IPAddress A_network_addr;
   IPAddress A_netmask;
-  struct timeval A_time;
+  olsr_time_t A_time;
 };
 
 //Routing table entry
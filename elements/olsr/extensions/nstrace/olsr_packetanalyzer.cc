@@ -58,6 +58,17 @@ OLSRPacketAnalyzer::analyze(Packet *packet, int offset)
 }
 
 
+int
+OLSRPacketAnalyzer::analyze_binary(Packet *packet, int offset, uint8_t *buf, int len)
+{
+	if (len < 1 + (int) sizeof(olsr_msg_hdr) || packet->length() < offset + sizeof(olsr_msg_hdr))
+		return 0;
+	buf[0] = 'O';
+	memcpy(buf + 1, packet->data() + offset, sizeof(olsr_msg_hdr));
+	return 1 + sizeof(olsr_msg_hdr);
+}
+
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(SimPacketAnalyzer)
 EXPORT_ELEMENT(OLSRPacketAnalyzer);
@@ -49,6 +49,8 @@ public:
   OLSRPacketAnalyzer *clone() const   { return new OLSRPacketAnalyzer; }
 
   virtual String analyze(Packet*, int offset);
+  // 'O' followed by the message header, for ToSimBinaryTrace
+  virtual int analyze_binary(Packet*, int offset, uint8_t *buf, int len);
 
 private:
 
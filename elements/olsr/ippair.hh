@@ -53,10 +53,30 @@ operator==(IPPair one, IPPair other)
   		other._from == one._from && other._from_netmask == one._from_netmask);
 }
 
+// folds x into h with a multiply-xorshift finalizer, as FlatHashMap mixes
+inline uint32_t
+olsr_hash_mix(uint32_t h, uint32_t x)
+{
+  h ^= x;
+  h ^= h >> 16;
+  h *= 0x85EBCA6BU;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35U;
+  h ^= h >> 16;
+  return h;
+}
+
+// The addresses go in one after the other, so (A, B) and (B, A) hash
+// apart, as do pairs of one subnet whose address sums agree; a sum put most
+// of a /24 mesh's two-hop and topology tuples on a few chains. The
+// netmasks, nearly always /32, share the last round.
 inline unsigned
-hashcode(IPPair p)
+hashcode(const IPPair &p)
 {
-  return hashcode(p._to) + hashcode(p._to_netmask) + hashcode(p._from) + hashcode(p._from_netmask);
+  uint32_t h = olsr_hash_mix(0, p._from.addr());
+  h = olsr_hash_mix(h, p._to.addr());
+  uint32_t masks = p._from_netmask.addr() ^ ((p._to_netmask.addr() << 16) | (p._to_netmask.addr() >> 16));
+  return olsr_hash_mix(h, masks);
 }
 
 
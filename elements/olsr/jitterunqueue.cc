@@ -40,8 +40,8 @@ JitterUnqueue::configure(Vector<String> &conf, ErrorHandler *errh)
 	                          cpOptional,
 	                          cpInteger, "mindelay", &mindelay,
 	                          0);
-	_maxdelay = make_timeval ((int) (maxdelay / 1000),(maxdelay % 1000));
-	_mindelay = make_timeval ((int) (mindelay / 1000),(mindelay % 1000));
+	_maxdelay = make_timeval ((int) (maxdelay / 1000),(maxdelay % 1000) * 1000);
+	_mindelay = make_timeval ((int) (mindelay / 1000),(mindelay % 1000) * 1000);
 	_minmaxdiff = _maxdelay - _mindelay;
 	_minmaxdiff_usec = _minmaxdiff.tv_usec + 1000000*_minmaxdiff.tv_sec;
 	return result;
@@ -57,29 +57,29 @@ JitterUnqueue::initialize(ErrorHandler *errh)
 }
 
 bool
-JitterUnqueue::run_task()
+JitterUnqueue::run_task(Task *)
 {
-	// listening for notifications
-	struct timeval now;
-	click_gettimeofday(&now);
+	struct timeval now = Timestamp::recent().timeval();
 
-	//timeradd(&now, &_delay, &expires);
-	bool worked = false;
-	if (timercmp(&_expire,&now,<) || timercmp(&_expire,&now,==))
+	// woken up by the notifier before the delay is over: sleep until then
+	if (timercmp(&now,&_expire,<))
 	{
-		while (Packet *p = input(0).pull())
-		{
-			output(0).push(p);
-			worked = true;
-
-		}
-		uint32_t delay_usec = (_minmaxdiff_usec) ? (random() % _minmaxdiff_usec) : 0;
-		_expire = now + _mindelay + mk_tval(0,delay_usec);
-
-		if ((!worked) && (!_signal)) // no Packet available
-			return false;		// without rescheduling
+		_task.reschedule_at(_expire);
+		return false;
 	}
-	_task.fast_reschedule();
+
+	// send everything that is ready as one burst
+	PacketBatch batch;
+	input(0).pull_batch(batch, 0xFFFFFFFFU);
+	bool worked = !batch.empty();
+	output(0).push_batch(batch);
+	uint32_t delay_usec = (_minmaxdiff_usec) ? (random() % _minmaxdiff_usec) : 0;
+	_expire = now + _mindelay + mk_tval(0,delay_usec);
+
+	// more packets may be waiting upstream, have a look after the delay;
+	// otherwise the upstream empty signal wakes the Task
+	if (_signal)
+		_task.reschedule_at(_expire);
 	return worked;
 }
 
@@ -88,7 +88,7 @@ void
 JitterUnqueue::set_maxdelay(int maxdelay)
 {
 
-	_maxdelay = make_timeval ((int) (maxdelay / 1000),(maxdelay % 1000));
+	_maxdelay = make_timeval ((int) (maxdelay / 1000),(maxdelay % 1000) * 1000);
 	_minmaxdiff = _maxdelay - _mindelay;
 	_minmaxdiff_usec = _minmaxdiff.tv_usec + 1000000*_minmaxdiff.tv_sec;
 }
@@ -96,7 +96,7 @@ JitterUnqueue::set_maxdelay(int maxdelay)
 void
 JitterUnqueue::set_mindelay(int mindelay)
 {
-	_mindelay = make_timeval ((int) (mindelay / 1000),(mindelay % 1000));
+	_mindelay = make_timeval ((int) (mindelay / 1000),(mindelay % 1000) * 1000);
 	_minmaxdiff = _maxdelay - _mindelay;
 	_minmaxdiff_usec = _minmaxdiff.tv_usec + 1000000*_minmaxdiff.tv_sec;
 }
@@ -3,10 +3,17 @@
 #include <click/element.hh>
 #include <click/gaprate.hh>
 #include <click/task.hh>
+#include <click/timer.hh>
 #include <click/notifier.hh>
 CLICK_DECLS
 
-
+/*
+ * Pulls packets from its input and pushes them to its output in bursts
+ * separated by a random delay between mindelay and maxdelay milliseconds.
+ * Between two bursts it sleeps: Task::reschedule_at runs the Task again once
+ * the delay is over, and the upstream empty signal wakes it when packets arrive at an
+ * idle element, so nothing spins while waiting.
+ */
 
 class JitterUnqueue : public Element
 {
@@ -22,7 +29,7 @@ public:
 	int configure(Vector<String> &, ErrorHandler *);
 	int initialize(ErrorHandler *);
 
-	bool run_task();
+	bool run_task(Task *);
 	
 	void add_handlers();
 
@@ -19,12 +19,31 @@ Join::~Join()
 }
 
 
+int
+Join::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  // the generated configurations give the number of inputs, which the
+  // connections already determine
+  unsigned n;
+  return cp_va_kparse(conf, this, errh,
+		      "N", cpkP, cpUnsigned, &n,
+		      cpEnd);
+}
+
+
 Packet *
 Join::simple_action(Packet *p)
 {
    return p;		
 }
 
+
+void
+Join::push_batch(int, PacketBatch &batch)
+{
+  output(0).push_batch(batch);
+}
+
 CLICK_ENDDECLS
 
 EXPORT_ELEMENT(Join)
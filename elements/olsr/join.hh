@@ -15,7 +15,9 @@ class Join : public Element {
   const char *processing() const		{ return AGNOSTIC; }
   const char *port_count() const  		{ return "1-/1"; }  
 
+  int configure(Vector<String> &, ErrorHandler *);
   Packet * simple_action(Packet *);
+  void push_batch(int, PacketBatch &);
   
 };
 
@@ -0,0 +1,192 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "olsr_adaptive_intervals.hh"
+#include "olsr_link_infobase.hh"
+#include "olsr_topology_infobase.hh"
+#include "olsr_hello_generator.hh"
+#include "olsr_tc_generator.hh"
+#include "olsr_process_hello.hh"
+
+CLICK_DECLS
+
+OLSRAdaptiveIntervals::OLSRAdaptiveIntervals()
+  : _timer(this)
+{
+}
+
+
+OLSRAdaptiveIntervals::~OLSRAdaptiveIntervals()
+{
+}
+
+
+int
+OLSRAdaptiveIntervals::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *link_info, *topology_info, *tc_generator, *process_hello = 0;
+  String hello_generators;
+  _hello_min = _hello_max = _tc_min = _tc_max = 0;
+  _window = 10000;
+  _threshold = 0;
+  _hold_factor = 3;
+  if ( cp_va_parse(conf, this, errh,
+		   cpElement, "LinkInfoBase element", &link_info,
+		   cpElement, "TopologyInfoBase element", &topology_info,
+		   cpElement, "TCGenerator element", &tc_generator,
+		   cpArgument, "HELLO generator elements", &hello_generators,
+		   cpKeywords,
+		   "HELLO_MIN", cpInteger, "shortest HELLO interval (msecs)", &_hello_min,
+		   "HELLO_MAX", cpInteger, "longest HELLO interval (msecs)", &_hello_max,
+		   "TC_MIN", cpInteger, "shortest TC interval (msecs)", &_tc_min,
+		   "TC_MAX", cpInteger, "longest TC interval (msecs)", &_tc_max,
+		   "WINDOW", cpInteger, "measurement window (msecs)", &_window,
+		   "THRESHOLD", cpInteger, "changes per window tolerated", &_threshold,
+		   "HOLD_FACTOR", cpInteger, "hold times per interval", &_hold_factor,
+		   "PROCESS_HELLO", cpElement, "ProcessHello element", &process_hello,
+		   0) < 0 )
+    return -1;
+
+  if (!(_linkInfo = (OLSRLinkInfoBase *) link_info->cast("OLSRLinkInfoBase")))
+    return errh->error("%s is not an OLSRLinkInfoBase", link_info->name().c_str());
+  if (!(_topologyInfo = (OLSRTopologyInfoBase *) topology_info->cast("OLSRTopologyInfoBase")))
+    return errh->error("%s is not an OLSRTopologyInfoBase", topology_info->name().c_str());
+  if (!(_tcGenerator = (OLSRTCGenerator *) tc_generator->cast("OLSRTCGenerator")))
+    return errh->error("%s is not an OLSRTCGenerator", tc_generator->name().c_str());
+  _processHello = 0;
+  if (process_hello && !(_processHello = (OLSRProcessHello *) process_hello->cast("OLSRProcessHello")))
+    return errh->error("%s is not an OLSRProcessHello", process_hello->name().c_str());
+
+  Vector<String> names;
+  cp_spacevec(hello_generators, names);
+  for (int i = 0; i < names.size(); i++) {
+    Element *e = cp_element(names[i], this, errh);
+    if (!e)
+      return -1;
+    OLSRHelloGenerator *hello = (OLSRHelloGenerator *) e->cast("OLSRHelloGenerator");
+    if (!hello)
+      return errh->error("%s is not an OLSRHelloGenerator", e->name().c_str());
+    _helloGenerators.push_back(hello);
+  }
+  if (_helloGenerators.empty())
+    return errh->error("no HELLO generator given");
+
+  if (_window <= 0)
+    return errh->error("WINDOW must be greater than 0");
+  if (_hold_factor <= 0)
+    return errh->error("HOLD_FACTOR must be greater than 0");
+  return 0;
+}
+
+
+int
+OLSRAdaptiveIntervals::initialize(ErrorHandler *errh)
+{
+  //the generators are configured by now, so their intervals are known
+  if (_hello_min <= 0)
+    _hello_min = _helloGenerators[0]->period();
+  if (_hello_max <= 0)
+    _hello_max = 4 * _hello_min;
+  if (_tc_min <= 0)
+    _tc_min = _tcGenerator->period();
+  if (_tc_max <= 0)
+    _tc_max = 4 * _tc_min;
+  //the generators jitter by a twentieth of the interval
+  if (_hello_min < 20 || _tc_min < 20)
+    return errh->error("intervals must be at least 20 msecs");
+  if (_hello_max < _hello_min || _tc_max < _tc_min)
+    return errh->error("upper bound below lower bound");
+
+  _last_link_changes = _linkInfo->changes();
+  _last_topology_changes = _topologyInfo->changes();
+  _window_link_changes = _window_topology_changes = 0;
+  _timer.initialize(this);
+  _timer.schedule_after_msec(_window);
+  return 0;
+}
+
+
+int
+OLSRAdaptiveIntervals::adapt(int period, uint32_t changes, int threshold, int min, int max)
+{
+  if (changes == 0)
+    period += period / 4;
+  else if (changes > (uint32_t) threshold)
+    period /= 2;
+  if (period < min)
+    period = min;
+  if (period > max)
+    period = max;
+  return period;
+}
+
+
+void
+OLSRAdaptiveIntervals::set_hello_period(int period)
+{
+  for (int i = 0; i < _helloGenerators.size(); i++) {
+    OLSRHelloGenerator *hello = _helloGenerators[i];
+    if (hello->period() == period)
+      continue;
+    hello->set_period(period);
+    hello->set_neighbor_hold_time(_hold_factor * period);
+  }
+  if (_processHello)
+    _processHello->set_neighbor_hold_time_tv(_hold_factor * period);
+}
+
+
+void
+OLSRAdaptiveIntervals::run_timer(Timer *)
+{
+  uint32_t link_changes = _linkInfo->changes();
+  uint32_t topology_changes = _topologyInfo->changes();
+  _window_link_changes = link_changes - _last_link_changes;
+  _window_topology_changes = topology_changes - _last_topology_changes;
+  _last_link_changes = link_changes;
+  _last_topology_changes = topology_changes;
+
+  int hello_period = _helloGenerators[0]->period();
+  int new_hello_period = adapt(hello_period, _window_link_changes, _threshold, _hello_min, _hello_max);
+  if (new_hello_period != hello_period)
+    set_hello_period(new_hello_period);
+
+  int tc_period = _tcGenerator->period();
+  int new_tc_period = adapt(tc_period, _window_topology_changes, _threshold, _tc_min, _tc_max);
+  if (new_tc_period != tc_period) {
+    _tcGenerator->set_period(new_tc_period);
+    _tcGenerator->set_top_hold_time(_hold_factor * new_tc_period);
+  }
+
+  _timer.reschedule_after_msec(_window);
+}
+
+
+String
+OLSRAdaptiveIntervals::read_handler(Element *e, void *)
+{
+  OLSRAdaptiveIntervals *ai = (OLSRAdaptiveIntervals *) e;
+  StringAccum sa;
+  sa << "hello_interval " << ai->_helloGenerators[0]->period() << "\n"
+     << "tc_interval " << ai->_tcGenerator->period() << "\n"
+     << "link_changes " << ai->_window_link_changes << "\n"
+     << "topology_changes " << ai->_window_topology_changes << "\n";
+  return sa.take_string();
+}
+
+
+void
+OLSRAdaptiveIntervals::add_handlers()
+{
+  add_read_handler("stats", read_handler, (void *) 0);
+  add_task_handlers(_timer.task(), "timer_");
+}
+
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<OLSRHelloGenerator *>;
+#endif
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRAdaptiveIntervals);
@@ -0,0 +1,105 @@
+/*
+  =c
+  OLSR specific element, adapts the HELLO and TC emission intervals to the observed churn
+
+  =s
+  OLSRAdaptiveIntervals(OLSRLinkInfoBase element, OLSRTopologyInfoBase element, OLSRTCGenerator element, HELLO_GENERATORS [, KEYWORDS])
+
+  =io
+  None
+
+  =d
+  Every WINDOW milliseconds, looks at how many links were added, removed or lost their symmetry in the OLSRLinkInfoBase, and how many tuples were added to or removed from the OLSRTopologyInfoBase, since the previous look. A window without change lengthens the interval of the corresponding generators by a quarter, up to the upper bound; more than THRESHOLD changes halve it, down to the lower bound. The hold times (and with them the vtime advertised in the messages) follow as HOLD_FACTOR times the interval, so neighbors keep the tuples long enough whatever the interval is.
+
+  HELLO_GENERATORS is a space-separated list of the node's OLSRHelloGenerator elements, one per interface; they all get the same interval.
+
+  Keyword arguments are:
+
+  =item HELLO_MIN, HELLO_MAX
+
+  Integers. Bounds of the HELLO interval in milliseconds. Default to the interval the first HELLO generator is configured with, and four times that.
+
+  =item TC_MIN, TC_MAX
+
+  Integers. Bounds of the TC interval in milliseconds. Default to the interval the TC generator is configured with, and four times that.
+
+  =item WINDOW
+
+  Integer. Length of a measurement window in milliseconds. Default is 10000.
+
+  =item THRESHOLD
+
+  Integer. Changes in one window above which the interval is shortened. Default is 0.
+
+  =item HOLD_FACTOR
+
+  Integer. Hold times are this many intervals. Default is 3, as in RFC 3626.
+
+  =item PROCESS_HELLO
+
+  OLSRProcessHello element whose neighbor hold time follows the HELLO interval.
+
+  =h stats read-only
+  Returns the current intervals and the changes seen in the last window.
+
+  =a
+  OLSRHelloGenerator, OLSRTCGenerator, OLSRLinkInfoBase, OLSRTopologyInfoBase
+*/
+#ifndef OLSR_ADAPTIVE_INTERVALS_HH
+#define OLSR_ADAPTIVE_INTERVALS_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+#include "olsr_control_timer.hh"
+
+CLICK_DECLS
+
+class OLSRLinkInfoBase;
+class OLSRTopologyInfoBase;
+class OLSRHelloGenerator;
+class OLSRTCGenerator;
+class OLSRProcessHello;
+
+class OLSRAdaptiveIntervals: public Element{
+public:
+
+  OLSRAdaptiveIntervals();
+  ~OLSRAdaptiveIntervals();
+
+  const char* class_name() const { return "OLSRAdaptiveIntervals"; }
+  OLSRAdaptiveIntervals *clone() const { return new OLSRAdaptiveIntervals(); }
+  const char *port_count() const  { return "0/0"; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  void run_timer(Timer *);
+
+private:
+  OLSRLinkInfoBase *_linkInfo;
+  OLSRTopologyInfoBase *_topologyInfo;
+  OLSRTCGenerator *_tcGenerator;
+  Vector<OLSRHelloGenerator *> _helloGenerators;
+  OLSRProcessHello *_processHello;
+
+  int _hello_min, _hello_max;
+  int _tc_min, _tc_max;
+  int _window;
+  int _threshold;
+  int _hold_factor;
+  OLSRControlTimer _timer;
+
+  uint32_t _last_link_changes;
+  uint32_t _last_topology_changes;
+  uint32_t _window_link_changes;
+  uint32_t _window_topology_changes;
+
+  static int adapt(int period, uint32_t changes, int threshold, int min, int max);
+  void set_hello_period(int period);
+  static String read_handler(Element *, void *);
+};
+
+CLICK_ENDDECLS
+#endif
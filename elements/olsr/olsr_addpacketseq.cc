@@ -1,6 +1,7 @@
 //TED 130504: Created
 #include <click/config.h>
 #include <click/confparse.hh>
+#include <click/router.hh>
 #include "olsr_packethandle.hh"
 #include "olsr_addpacketseq.hh"
 #include "click_olsr.hh"
@@ -36,6 +37,28 @@ OLSRAddPacketSeq::initialize(ErrorHandler *)
 }
 
 
+// these elements are usually anonymous, so find the old one by interface
+Element *
+OLSRAddPacketSeq::hotswap_element() const
+{
+  if (Router *r = router()->hotswap_router())
+    for (int i = 0; i < r->nelements(); i++)
+      if (OLSRAddPacketSeq *e = (OLSRAddPacketSeq *) r->element(i)->cast("OLSRAddPacketSeq"))
+	if (e->_interfaceAddress == _interfaceAddress)
+	  return e;
+  return 0;
+}
+
+
+void
+OLSRAddPacketSeq::take_state(Element *e, ErrorHandler *)
+{
+  // the neighbors' OLSRCheckPacketSeq drops packets not newer than the
+  // last one they saw from this interface
+  _seq_num = ((OLSRAddPacketSeq *) e)->_seq_num;
+}
+
+
 void 
 OLSRAddPacketSeq::push(int, Packet *packet)
 {
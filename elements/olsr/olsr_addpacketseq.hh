@@ -13,10 +13,10 @@
   PUSH
 
   =d
-  Gets OLSR packets on its input. Sets the packet sequence number in the OLSR packet header. One is needed for each network interface.
+  Gets OLSR packets on its input. Sets the packet sequence number in the OLSR packet header. One is needed for each network interface, unless OLSRPacketOutput, which also builds the IP, UDP and Ethernet headers, is used instead.
 
   =a
-  OLSRForward
+  OLSRForward, OLSRPacketOutput
 */
 #ifndef OLSR_ADDPACKETSEQ_HH
 #define OLSR_ADDPACKETSEQ_HH
@@ -38,6 +38,8 @@ public:
 
   int configure(Vector<String> &conf, ErrorHandler *errh);
   int initialize(ErrorHandler *);
+  Element *hotswap_element() const;
+  void take_state(Element *, ErrorHandler *);
 
   void push(int, Packet *packet);
 
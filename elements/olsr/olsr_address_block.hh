@@ -0,0 +1,155 @@
+#ifndef OLSR_ADDRESS_BLOCK_HH
+#define OLSR_ADDRESS_BLOCK_HH
+
+#include <click/packet.hh>
+#include <click/ipaddress.hh>
+#include "click_olsr.hh"
+#include "olsr_packethandle.hh"
+
+CLICK_DECLS
+
+// Address blocks of COMPACT_HELLO and COMPACT_TC messages, after RFC 5444:
+// the bytes that all addresses of a block share are sent once, and only
+// the rest of each address follows, so that in a network numbered from one
+// /16 an address takes two bytes instead of four. The generators write the
+// blocks with write(); the processors expand() a compact message into the
+// HELLO, LQ_HELLO, TC or LQ_TC message it stands for and read that as
+// usual. Addresses are IPv4 host addresses, so no prefix lengths are sent.
+class OLSRAddressBlock{
+public:
+
+  enum { MAX_ADDRESSES = 255, MAX_HEAD = 3 };
+
+  // bytes of the blocks holding the n addresses at a
+  static int size(const IPAddress *a, int n, bool lq) {
+    int bytes = 0;
+    for (int i = 0; i < n; i += MAX_ADDRESSES) {
+      int k = (n - i < MAX_ADDRESSES ? n - i : MAX_ADDRESSES);
+      bytes += block_size(k, head_length(a + i, k), lq);
+    }
+    return bytes;
+  }
+
+  // writes the n addresses at a, with the link qualities at lq unless it
+  // is null, in blocks from pos on; returns the end of the last block
+  static uint8_t *write(uint8_t *pos, const IPAddress *a, const olsr_lq_info *lq,
+			int n, uint8_t link_code) {
+    for (int i = 0; i < n; i += MAX_ADDRESSES) {
+      int k = (n - i < MAX_ADDRESSES ? n - i : MAX_ADDRESSES);
+      int head = head_length(a + i, k), tail = 4 - head;
+      int bytes = block_size(k, head, lq != 0);
+      memset(pos, 0, bytes);
+      olsr_addr_block_hdr *hdr = (olsr_addr_block_hdr *) pos;
+      hdr->num_addr = k;
+      hdr->flags = (lq ? OLSR_ADDR_BLOCK_LQ : 0);
+      hdr->head_length = head;
+      hdr->link_code = link_code;
+      uint8_t *out = (uint8_t *) (hdr + 1);
+      memcpy(out, a[i].data(), head);
+      out += head;
+      for (int j = i; j < i + k; j++, out += tail)
+	memcpy(out, a[j].data() + head, tail);
+      if (lq)
+	for (int j = i; j < i + k; j++) {
+	  *out++ = lq[j].lq;
+	  *out++ = lq[j].nlq;
+	}
+      pos += bytes;
+    }
+    return pos;
+  }
+
+  // a copy of the compact message p starts with, in the layout of the
+  // message type it stands for; null if p is malformed
+  static WritablePacket *expand(const Packet *p) {
+    OLSRMessageView msg(p, 0);
+    if (!msg.valid())
+      return 0;
+    bool hello = (msg.type() == OLSR_COMPACT_HELLO_MESSAGE);
+    int fixed = sizeof(olsr_msg_hdr) + (hello ? sizeof(olsr_hello_hdr) : sizeof(olsr_tc_hdr));
+    if (msg.size() < fixed)
+      return 0;
+
+    //check the blocks and count the addresses
+    const uint8_t *begin = p->data() + fixed, *end = p->data() + msg.size();
+    int nblocks = 0, naddresses = 0, flags = -1;
+    for (const uint8_t *pos = begin; pos < end; nblocks++) {
+      const olsr_addr_block_hdr *hdr = (const olsr_addr_block_hdr *) pos;
+      if (end - pos < (int) sizeof(olsr_addr_block_hdr) || hdr->num_addr == 0
+	  || hdr->head_length > 4 || (flags >= 0 && hdr->flags != flags))
+	return 0;
+      int bytes = block_size(hdr->num_addr, hdr->head_length, hdr->flags & OLSR_ADDR_BLOCK_LQ);
+      if (bytes > end - pos)
+	return 0;
+      flags = hdr->flags;
+      naddresses += hdr->num_addr;
+      pos += bytes;
+    }
+
+    bool lq = (flags > 0 && (flags & OLSR_ADDR_BLOCK_LQ));
+    int address_size = sizeof(in_addr) + (lq ? sizeof(olsr_lq_info) : 0);
+    int size = fixed + (hello ? nblocks * sizeof(olsr_link_hdr) : 0) + naddresses * address_size;
+    WritablePacket *q = Packet::make(p->headroom(), 0, size, 0);
+    if (!q)
+      return 0;
+    q->copy_annotations(p);
+    memset(q->data(), 0, size);
+    memcpy(q->data(), p->data(), fixed);
+    olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) q->data();
+    if (hello)
+      msg_hdr->msg_type = (lq ? OLSR_LQ_HELLO_MESSAGE : OLSR_HELLO_MESSAGE);
+    else
+      msg_hdr->msg_type = (lq ? OLSR_LQ_TC_MESSAGE : OLSR_TC_MESSAGE);
+    msg_hdr->msg_size = htons(size);
+
+    //a HELLO gets one link message per block
+    uint8_t *out = q->data() + fixed;
+    for (const uint8_t *pos = begin; pos < end; ) {
+      const olsr_addr_block_hdr *hdr = (const olsr_addr_block_hdr *) pos;
+      int n = hdr->num_addr, head = hdr->head_length, tail = 4 - head;
+      if (hello) {
+	olsr_link_hdr *link_hdr = (olsr_link_hdr *) out;
+	link_hdr->link_code = hdr->link_code;
+	link_hdr->link_msg_size = htons(sizeof(olsr_link_hdr) + n * address_size);
+	out = (uint8_t *) (link_hdr + 1);
+      }
+      const uint8_t *heads = (const uint8_t *) (hdr + 1);
+      const uint8_t *tails = heads + head;
+      const uint8_t *lqs = tails + n * tail;
+      for (int i = 0; i < n; i++, out += address_size) {
+	memcpy(out, heads, head);
+	memcpy(out + head, tails + i * tail, tail);
+	if (lq) {
+	  olsr_lq_info *lq_info = (olsr_lq_info *) (out + sizeof(in_addr));
+	  lq_info->lq = lqs[2 * i];
+	  lq_info->nlq = lqs[2 * i + 1];
+	}
+      }
+      pos += block_size(n, head, lq);
+    }
+    return q;
+  }
+
+private:
+
+  // the number of leading bytes the n addresses at a share, at most
+  // MAX_HEAD so that every address keeps a byte of its own
+  static int head_length(const IPAddress *a, int n) {
+    uint32_t first = ntohl(a[0].addr()), differ = 0;
+    for (int i = 1; i < n; i++)
+      differ |= ntohl(a[i].addr()) ^ first;
+    int head = 0;
+    while (head < MAX_HEAD && !(differ & (0xFF000000U >> (8 * head))))
+      head++;
+    return head;
+  }
+
+  static int block_size(int n, int head, bool lq) {
+    int bytes = sizeof(olsr_addr_block_hdr) + head + n * (4 - head) + (lq ? 2 * n : 0);
+    return (bytes + 3) & ~3;
+  }
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,86 @@
+#ifndef OLSR_ADDRESS_LIST_HH
+#define OLSR_ADDRESS_LIST_HH
+
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <click/ipaddress.hh>
+#if defined(__SSE2__) && CLICK_USERLEVEL
+# include <emmintrin.h>
+#endif
+
+CLICK_DECLS
+
+// The addresses of this node, main and interface ones, that the address
+// lists of received messages are checked against. scan() walks a list of
+// n addresses spaced stride bytes apart, as in TC (4 bytes) or LQ_TC (8
+// bytes) payloads, and appends the index of every address that is not
+// local to kept, so that the caller only looks up the remaining ones in
+// its information bases.
+//
+// Every address is compared against all local ones without branching.
+// With SSE2, plain address lists are compared four addresses at a time;
+// other strides, and builds without SSE2, use the scalar loop.
+class OLSRLocalAddressSet{
+public:
+
+  enum { MAX_ADDRESSES = 16 };
+
+  OLSRLocalAddressSet() : _n(0) { }
+
+  void clear()			{ _n = 0; }
+  int size() const		{ return _n; }
+
+  // false if the set is full; a full set still holds the main address
+  bool add(IPAddress a) {
+    for (int i = 0; i < _n; i++)
+      if (_addr[i] == a.addr())
+	return true;
+    if (_n == MAX_ADDRESSES)
+      return false;
+    _addr[_n++] = a.addr();
+    return true;
+  }
+
+  bool contains(uint32_t a) const {
+    uint32_t match = 0;
+    for (int i = 0; i < _n; i++)
+      match |= (_addr[i] == a);
+    return match;
+  }
+
+  // returns the number of indices appended
+  int scan(const uint8_t *data, int n, int stride, Vector<int> &kept) const {
+    int old_size = kept.size();
+    int i = 0;
+#if defined(__SSE2__) && CLICK_USERLEVEL
+    if (stride == 4 && _n > 0) {
+      for (; i + 4 <= n; i += 4) {
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 4));
+	__m128i match = _mm_setzero_si128();
+	for (int j = 0; j < _n; j++)
+	  match = _mm_or_si128(match, _mm_cmpeq_epi32(v, _mm_set1_epi32((int) _addr[j])));
+	int mask = _mm_movemask_ps(_mm_castsi128_ps(match));
+	for (int k = 0; k < 4; k++)
+	  if (!(mask & (1 << k)))
+	    kept.push_back(i + k);
+      }
+    }
+#endif
+    for (; i < n; i++) {
+      uint32_t a;
+      memcpy(&a, data + i * stride, 4);	// only 4 byte aligned at best
+      if (!contains(a))
+	kept.push_back(i);
+    }
+    return kept.size() - old_size;
+  }
+
+private:
+
+  uint32_t _addr[MAX_ADDRESSES];	// network byte order, as on the wire
+  int _n;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,118 @@
+#ifndef OLSR_ADMISSION_HH
+#define OLSR_ADMISSION_HH
+
+#include <click/glue.hh>
+#include <click/ipaddress.hh>
+#include <click/straccum.hh>
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+// Admission control of one OLSR information base, so that a node flooding
+// made-up originators can exhaust neither memory nor the route computation:
+// an optional capacity, which the base keeps by evicting the tuple soonest
+// to expire among the SAMPLE first of its expiry heap that matters no more
+// than the new one, and an optional limit on the rate at which one
+// originator may create tuples. The rate is kept with a token bucket per
+// originator in a fixed table; an originator without a slot takes the one
+// of its PROBES slots used longest ago, starting with a full bucket.
+class OLSRAdmission{
+public:
+
+  enum { BUCKETS = 256, PROBES = 4, SAMPLE = 8 };
+  // tuples about neighbors matter most, then 2-hop neighbors, then the rest
+  enum { NEIGHBOR, TWO_HOP, DISTANT };
+
+  OLSRAdmission() : _capacity(0), _rate(0), _burst(0)	{ clear(); }
+
+  // rate is tuples per second, 0 for no limit; capacity 0 for no limit
+  void set(int capacity, uint32_t rate, uint32_t burst) {
+    _capacity = capacity;
+    _rate = rate;
+    _burst = burst;
+  }
+
+  bool active() const			{ return _capacity > 0 || _rate; }
+  bool full(int size) const		{ return _capacity > 0 && size >= _capacity; }
+
+  // of a tuple about a node dist hops away, -1 if unknown
+  static int priority(int dist) {
+    if (dist == 1)
+      return NEIGHBOR;
+    else if (dist == 2)
+      return TWO_HOP;
+    return DISTANT;
+  }
+
+  // takes a token from originator's bucket, false if it has none left
+  bool rate_ok(const IPAddress &originator, olsr_time_t now) {
+    if (!_rate)
+      return true;
+    uint32_t h = ntohl(originator.addr());
+    h ^= h >> 16;
+    Bucket *b = 0;
+    for (int i = 0; i < PROBES; i++) {
+      Bucket *c = &_buckets[(h + i) % BUCKETS];
+      if (c->used && c->addr == originator) {
+	b = c;
+	break;
+      } else if (!b || (b->used && (!c->used || c->last < b->last)))
+	b = c;
+    }
+    if (b->addr != originator || !b->used) {
+      b->addr = originator;
+      b->used = true;
+      b->millitokens = _burst * 1000;
+    } else if (b->last < now) {
+      //tokens accrue at _rate per second, i.e. _rate millitokens per msec
+      olsr_time_t d = now - b->last;
+      uint32_t msec = (d > olsr_msec(3600000) ? 3600000 : d / 1000);
+      uint64_t tokens = b->millitokens + (uint64_t) msec * _rate;
+      b->millitokens = (tokens > _burst * 1000ULL ? _burst * 1000 : tokens);
+    }
+    b->last = now;
+    if (b->millitokens < 1000) {
+      _limited++;
+      return false;
+    }
+    b->millitokens -= 1000;
+    return true;
+  }
+
+  void evicted()			{ _evictions++; }
+  void refused()			{ _refused++; }
+
+  void clear() {
+    for (int i = 0; i < BUCKETS; i++)
+      _buckets[i].used = false;
+    _evictions = _refused = _limited = 0;
+  }
+
+  // the text of the admission handler of a base holding size tuples
+  void unparse(StringAccum &sa, int size) const {
+    sa << "size " << size << "\ncapacity " << _capacity
+       << "\nevictions " << _evictions << "\nrefused " << _refused
+       << "\nrate_limited " << _limited << '\n';
+  }
+
+private:
+
+  struct Bucket {
+    IPAddress addr;
+    bool used;
+    uint32_t millitokens;
+    olsr_time_t last;
+  };
+
+  int _capacity;
+  uint32_t _rate;
+  uint32_t _burst;
+  uint32_t _evictions;
+  uint32_t _refused;
+  uint32_t _limited;
+  Bucket _buckets[BUCKETS];
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,169 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "olsr_packethandle.hh"
+#include "olsr_aggregator.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+OLSRAggregator::OLSRAggregator()
+  : _pending(0), _timer(this)
+{
+}
+
+
+OLSRAggregator::~OLSRAggregator()
+{
+}
+
+
+int
+OLSRAggregator::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _delay = 0;
+  _mtu = 1472;
+  if ( cp_va_parse(conf, this, errh,
+		   cpKeywords,
+		   "DELAY", cpInteger, "holding time (msecs)", &_delay,
+		   "MTU", cpInteger, "largest OLSR packet", &_mtu,
+		   0) < 0 )
+    return -1;
+  if (_delay < 0)
+    return errh->error("DELAY must be positive");
+  if (_mtu < (int) (sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr)))
+    return errh->error("MTU too small");
+  return 0;
+}
+
+
+int
+OLSRAggregator::initialize(ErrorHandler *)
+{
+  _timer.initialize(this);
+  _pending_messages = 0;
+  _packets_in = _messages_in = _packets_out = _messages_out = 0;
+  return 0;
+}
+
+
+void
+OLSRAggregator::cleanup(CleanupStage)
+{
+  if (_pending)
+    _pending->kill();
+  _pending = 0;
+}
+
+
+void
+OLSRAggregator::push(int, Packet *packet)
+{
+  _packets_in++;
+
+  //walk the messages of the packet; anything not covered by a valid
+  //message header is dropped
+  int offset = sizeof(olsr_pkt_hdr);
+  int end = packet->length();
+  if (end >= offset){
+    int pkt_length = OLSRPacketHandle::get_pkt_hdr_info(packet).pkt_length;
+    if (pkt_length < end)
+      end = pkt_length;
+  }
+
+  while (end - offset >= (int) sizeof(olsr_msg_hdr)){
+    OLSRMessageView msg(packet, offset);
+    int msg_size = msg.size();
+    if (msg_size < (int) sizeof(olsr_msg_hdr) || msg_size > end - offset)
+      break;
+    _messages_in++;
+
+    if (_pending && (int) _pending->length() + msg_size > _mtu)
+      flush();
+
+    if (!_pending){
+      //room in front for the UDP, IP and Ethernet headers, and behind
+      //for the messages still to come
+      int length = sizeof(olsr_pkt_hdr) + msg_size;
+      WritablePacket *q = Packet::make(packet->headroom(), 0, length, length < _mtu ? _mtu - length : 0);
+      if (!q)
+	break;
+      q->copy_annotations(packet);
+      memcpy(q->data(), packet->data(), sizeof(olsr_pkt_hdr));
+      memcpy(q->data() + sizeof(olsr_pkt_hdr), msg.header(), msg_size);
+      _pending = q;
+      _timer.schedule_after_msec(_delay);
+    }
+    else{
+      WritablePacket *q = _pending->put(msg_size);
+      _pending = q;
+      if (!q){
+	_pending_messages = 0;
+	break;
+      }
+      memcpy(q->end_data() - msg_size, msg.header(), msg_size);
+    }
+    _pending_messages++;
+    offset += msg_size;
+  }
+
+  packet->kill();
+}
+
+
+void
+OLSRAggregator::run_timer(Timer *)
+{
+  flush();
+}
+
+
+void
+OLSRAggregator::flush()
+{
+  _timer.unschedule();
+  if (!_pending)
+    return;
+  WritablePacket *q = _pending;
+  _pending = 0;
+  olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) q->data();
+  pkt_hdr->pkt_length = htons(q->length());
+  _packets_out++;
+  _messages_out += _pending_messages;
+  _pending_messages = 0;
+  output(0).push(q);
+}
+
+
+String
+OLSRAggregator::read_handler(Element *e, void *thunk)
+{
+  OLSRAggregator *ag = (OLSRAggregator *) e;
+  StringAccum sa;
+  if (thunk){
+    //messages per packet with two decimals, without floating point
+    uint32_t r = ag->_packets_out ? (ag->_messages_out * 100) / ag->_packets_out : 0;
+    sa << (r / 100) << '.';
+    if (r % 100 < 10)
+      sa << '0';
+    sa << (r % 100) << "\n";
+    return sa.take_string();
+  }
+  sa << "packets_in " << ag->_packets_in << "\n"
+     << "messages_in " << ag->_messages_in << "\n"
+     << "packets_out " << ag->_packets_out << "\n"
+     << "messages_out " << ag->_messages_out << "\n";
+  return sa.take_string();
+}
+
+
+void
+OLSRAggregator::add_handlers()
+{
+  add_read_handler("stats", read_handler, (void *) 0);
+  add_read_handler("ratio", read_handler, (void *) 1);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRAggregator);
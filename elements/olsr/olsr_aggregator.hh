@@ -0,0 +1,80 @@
+/*
+  =c
+  OLSR specific element, combines the OLSR messages of several packets into one OLSR packet
+
+  =s
+  OLSRAggregator([KEYWORDS])
+
+  =io
+  One input, one output
+
+  =processing
+  PUSH
+
+  =d
+  Gets OLSR packets (packet header followed by one or more messages) on its input. The messages are copied behind the packet header of the first packet that arrives, and the combined packet is output once DELAY milliseconds have passed since then, or earlier if the next message would make it longer than MTU bytes. RFC 3626 section 3.4 allows a node to piggyback messages this way. One is needed for each network interface, placed in front of the interface's OLSRAddPacketSeq element, so the combined packets get the interface's packet sequence numbers.
+
+  Keyword arguments are:
+
+  =item DELAY
+
+  Integer. Time in milliseconds a packet is held for more messages to join it. Should be well below the jitter allowed for the generators. Default is 0, which still combines all messages handed over before the timers run next.
+
+  =item MTU
+
+  Integer. Largest OLSR packet (header and messages) built. Default is 1472, an Ethernet frame minus the IP and UDP headers.
+
+  =h stats read-only
+  Returns the numbers of packets and messages received and of packets sent.
+
+  =h ratio read-only
+  Returns the average number of messages per packet sent.
+
+  =a
+  OLSRAddPacketSeq, OLSRForward, JitterUnqueue
+*/
+#ifndef OLSR_AGGREGATOR_HH
+#define OLSR_AGGREGATOR_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+
+CLICK_DECLS
+
+class OLSRAggregator: public Element{
+public:
+
+  OLSRAggregator();
+  ~OLSRAggregator();
+
+  const char* class_name() const { return "OLSRAggregator"; }
+  const char* processing() const { return PUSH; }
+  OLSRAggregator *clone() const { return new OLSRAggregator(); }
+  const char *port_count() const  { return "1/1"; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void push(int, Packet *packet);
+  void run_timer(Timer *);
+
+private:
+  int _delay;
+  int _mtu;
+  WritablePacket *_pending;	// packet header and the messages collected so far
+  int _pending_messages;
+  Timer _timer;
+
+  uint32_t _packets_in;
+  uint32_t _messages_in;
+  uint32_t _packets_out;
+  uint32_t _messages_out;
+
+  void flush();
+  static String read_handler(Element *, void *);
+};
+
+CLICK_ENDDECLS
+#endif
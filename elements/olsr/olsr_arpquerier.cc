@@ -26,20 +26,23 @@
 #include <click/router.hh>
 #include <click/error.hh>
 #include <click/glue.hh>
+#include <click/packetbatch.hh>
+#include <click/straccum.hh>
 CLICK_DECLS
 
 OLSRARPQuerier::OLSRARPQuerier()
-    : _age_head(0), _age_tail(0), _expire_timer(expire_hook, this)
+    : _map(0), _nmap_shift(0), _nmap(0), _nentries(0),
+      _age_head(0), _age_tail(0), _expire_timer(expire_hook, this),
+      _generation(0)
 {
     // input 0: IP packets
     // input 1: ARP responses
     // output 0: ether/IP and ether/ARP queries
-  for (int i = 0; i < NMAP; i++)
-    _map[i] = 0;
 }
 
 OLSRARPQuerier::~OLSRARPQuerier()
 {
+  delete[] _map;
 }
 
 int
@@ -81,20 +84,22 @@ OLSRARPQuerier::live_reconfigure(Vector<String> &conf, ErrorHandler *errh)
     // if the new configuration succeeded then wipe out the old arp
     // table and reset the queries and pkts_killed counters
     clear_map();
-    _arp_queries = 0;
-    _drops = 0;
-    _arp_responses = 0;
+    _arp_queries.clear();
+    _drops.clear();
+    _arp_responses.clear();
     return 0;
 }
 
 int
-OLSRARPQuerier::initialize(ErrorHandler *)
+OLSRARPQuerier::initialize(ErrorHandler *errh)
 {
+  if (!resize_map(MIN_NMAP_SHIFT))
+    return errh->error("out of memory");
   _expire_timer.initialize(this);
   _expire_timer.schedule_after_msec(EXPIRE_TIMEOUT_MS);
-  _arp_queries = 0;
-  _drops = 0;
-  _arp_responses = 0;
+  _arp_queries.clear();
+  _drops.clear();
+  _arp_responses.clear();
   _cache_size = 0;
   return 0;
 }
@@ -110,7 +115,7 @@ OLSRARPQuerier::clear_map()
 {
   // Walk the arp cache table and free 
   // any stored packets and arp entries.
-  for (int i = 0; i < NMAP; i++) {
+  for (int i = 0; i < _nmap; i++) {
     for (ARPEntry *ae = _map[i]; ae; ) {
       ARPEntry *n = ae->next;
       while (Packet *p = ae->head) {
@@ -123,7 +128,43 @@ OLSRARPQuerier::clear_map()
     }
     _map[i] = 0;
   }
+  _mac_index.clear();
+  _nentries = 0;
   _cache_size = 0;
+  _generation++;
+}
+
+/**
+ * Move all entries into a table of 1 << shift buckets. Called with the
+ * write lock held, or before the router runs.
+ */
+bool
+OLSRARPQuerier::resize_map(int shift)
+{
+  int nmap = 1 << shift;
+  ARPEntry **map = new ARPEntry *[nmap];
+  if (!map)
+    return false;
+  for (int i = 0; i < nmap; i++)
+    map[i] = 0;
+
+  ARPEntry **old_map = _map;
+  int old_nmap = _nmap;
+  _map = map;
+  _nmap = nmap;
+  _nmap_shift = shift;
+  for (int i = 0; i < old_nmap; i++)
+    for (ARPEntry *ae = old_map[i]; ae; ) {
+      ARPEntry *n = ae->next;
+      int bucket = ip_bucket(ae->ip);
+      ae->pprev = &_map[bucket];
+      if ((ae->next = _map[bucket]))
+	ae->next->pprev = &ae->next;
+      _map[bucket] = ae;
+      ae = n;
+    }
+  delete[] old_map;
+  return true;
 }
 
 void
@@ -137,25 +178,35 @@ OLSRARPQuerier::take_state(Element *e, ErrorHandler *errh)
 	return;
     }
 
-    memcpy(_map, arpq->_map, sizeof(ARPEntry *) * NMAP);
-    memset(arpq->_map, 0, sizeof(ARPEntry *) * NMAP);
+    // the bucket arrays change hands, so the chains' pprev pointers stay valid
+    ARPEntry **map = _map;
+    int nmap_shift = _nmap_shift, nmap = _nmap;
+    _map = arpq->_map;
+    _nmap_shift = arpq->_nmap_shift;
+    _nmap = arpq->_nmap;
+    _nentries = arpq->_nentries;
+    arpq->_map = map;
+    arpq->_nmap_shift = nmap_shift;
+    arpq->_nmap = nmap;
+    arpq->_nentries = 0;
+    _mac_index.swap(arpq->_mac_index);
+    arpq->_mac_index.clear();
 
     _age_head = arpq->_age_head;
     _age_tail = arpq->_age_tail;
     _cache_size = arpq->_cache_size;
-    _arp_queries = arpq->_arp_queries;
-    _drops = arpq->_drops;
-    _arp_responses = arpq->_arp_responses;
+    _arp_queries.set(arpq->_arp_queries);
+    _drops.set(arpq->_drops);
+    _arp_responses.set(arpq->_arp_responses);
 
     // Need to change some pprev entries.
-    for (int i = 0; i < NMAP; i++)
-	if (_map[i])
-	    _map[i]->pprev = &_map[i];
     if (_age_head)
 	_age_head->age_pprev = &_age_head;
     
     arpq->_age_head = arpq->_age_tail = 0;
     arpq->_cache_size = 0;
+    _generation++;
+    arpq->_generation++;
 }
 
 
@@ -178,32 +229,28 @@ OLSRARPQuerier::expire_hook(Timer *timer, void *thunk)
 	    arpq->_age_head->age_pprev = &arpq->_age_head;
 	else
 	    arpq->_age_tail = 0;
+	arpq->unindex_mac(ae);
+	arpq->_nentries--;
+	if (ae->ok)
+	    arpq->_generation++;
 	
-	while (Packet *p = ae->head) {
-	    ae->head = p->next();
-	    p->kill();
-	    arpq->_cache_size--;
-	    arpq->_drops++;
-	}
-
+	arpq->drop_held(ae);
 	delete ae;
     }
 
-    // Mark entries for polling, and delete packets to make space.
+    // Mark entries for polling, and delete the packets of whole entries,
+    // oldest first, to make space.
     while (ae) {
 	// Only set polling on timer calls.
-	if (jiff - ae->last_response_jiffies > 60*CLICK_HZ && timer)
+	if (jiff - ae->last_response_jiffies > 60*CLICK_HZ && timer) {
+	    if (ae->ok && !ae->polling)
+		arpq->_generation++;
 	    ae->polling = 1;
+	}
 	else if (arpq->_cache_size < arpq->_capacity)
 	    break;
-	while (arpq->_cache_size >= arpq->_capacity && ae->head) {
-	    Packet *p = ae->head;
-	    if (!(ae->head = p->next()))
-		ae->tail = 0;
-	    p->kill();
-	    arpq->_cache_size--;
-	    arpq->_drops++;
-	}
+	if (arpq->_cache_size >= arpq->_capacity)
+	    arpq->drop_held(ae);
 	ae = ae->age_next;
     }
 
@@ -212,6 +259,25 @@ OLSRARPQuerier::expire_hook(Timer *timer, void *thunk)
     arpq->_lock.release_write();
 }
 
+/*
+ * Drops all the packets saved for ae; called with the write lock held.
+ */
+void
+OLSRARPQuerier::drop_held(ARPEntry *ae)
+{
+    int n = 0;
+    while (Packet *p = ae->head) {
+	ae->head = p->next();
+	p->kill();
+	n++;
+    }
+    ae->tail = 0;
+    if (n) {
+	_cache_size -= n;
+	_drops += n;
+    }
+}
+
 void
 OLSRARPQuerier::send_query_for(IPAddress want_ip)
 {
@@ -260,12 +326,13 @@ OLSRARPQuerier::handle_ip(Packet *p)
     }
 
     IPAddress ipa = p->dst_ip_anno();
-    int bucket = ip_bucket(ipa);
+    int bucket;
     ARPEntry *ae;
 
     // Easy case: requires only read lock
   retry_read_lock:
     _lock.acquire_read();
+    bucket = ip_bucket(ipa);	// the table may have grown meanwhile
     ae = _map[bucket];
     while (ae && ae->ip != ipa)
 	ae = ae->next;
@@ -318,6 +385,7 @@ OLSRARPQuerier::handle_ip(Packet *p)
 	expire_hook(0, this);
     
     _lock.acquire_write();
+    bucket = ip_bucket(ipa);
     ae = _map[bucket];
     while (ae && ae->ip != ipa)
 	ae = ae->next;
@@ -353,6 +421,8 @@ OLSRARPQuerier::handle_ip(Packet *p)
 	ae->age_next = 0;
 	
 	_cache_size++;
+	if (++_nentries > _nmap && _nmap_shift < MAX_NMAP_SHIFT)
+	    resize_map(_nmap_shift + 1);
     } else {
 	p->kill();
 	_drops++;
@@ -392,10 +462,8 @@ OLSRARPQuerier::handle_response(Packet *p)
       && ntohs(arph->ea_hdr.ar_pro) == ETHERTYPE_IP
       && ntohs(arph->ea_hdr.ar_op) == ARPOP_REPLY
       && !ena.is_group()) {
-    int bucket = ip_bucket(ipa);
-
     _lock.acquire_write();
-    ARPEntry *ae = _map[bucket];
+    ARPEntry *ae = _map[ip_bucket(ipa)];
     while (ae && ae->ip != ipa)
       ae = ae->next;
     if (!ae) {
@@ -404,10 +472,14 @@ OLSRARPQuerier::handle_response(Packet *p)
 	return;
     }
     
-    if (ae->ok && ae->en != ena)
+    if (ae->ok && ae->en != ena) {
 	click_chatter("OLSRARPQuerier overwriting an entry");
+	unindex_mac(ae);
+	_generation++;
+    }
     ae->en = ena;
     ae->ok = 1;
+    index_mac(ae);
     ae->polling = 0;
     ae->last_response_jiffies = click_jiffies();
     Packet *cached_packet = ae->head;
@@ -421,13 +493,26 @@ OLSRARPQuerier::handle_response(Packet *p)
     }
     _lock.release_write();
 
-    // Send out packets in the order in which they arrived
+    // Send out packets in the order in which they arrived, as one batch,
+    // copying the same Ethernet header onto each
+    click_ether header;
+    memcpy(header.ether_shost, _my_en.data(), 6);
+    memcpy(header.ether_dhost, ena.data(), 6);
+    header.ether_type = htons(ETHERTYPE_IP);
+    PacketBatch batch;
+    int n = 0;
     while (cached_packet) {
 	Packet *next = cached_packet->next();
-	handle_ip(cached_packet);
+	if (WritablePacket *q = cached_packet->push_mac_header(sizeof(click_ether))) {
+	    memcpy(q->ether_header(), &header, sizeof(click_ether));
+	    batch.push_back(q);
+	} else
+	    _drops++;
 	cached_packet = next;
-	_cache_size--;
+	n++;
     }
+    _cache_size -= n;
+    output(0).push_batch(batch);
   }
 }
 
@@ -446,12 +531,12 @@ String
 OLSRARPQuerier::read_table(Element *e, void *)
 {
   OLSRARPQuerier *q = (OLSRARPQuerier *)e;
-  String s;
-  for (int i = 0; i < NMAP; i++)
+  StringAccum sa;
+  for (int i = 0; i < q->_nmap; i++)
     for (ARPEntry *e = q->_map[i]; e; e = e->next) {
-      s += e->ip.s() + " " + (e->ok ? "1" : "0") + " " + e->en.s() + "\n";
+      sa << e->ip << ' ' << (e->ok ? '1' : '0') << ' ' << e->en << '\n';
     }
-  return s;
+  return sa.take_string();
 }
 
 String
@@ -470,6 +555,8 @@ OLSRARPQuerier::read_stats(Element *e, void *thunk)
       return String(q->_arp_responses.value());
     case 3:
       return String(q->_drops.value());
+    case 4:
+      return String(q->_generation);
     default:
       return String();
   }
@@ -483,6 +570,100 @@ OLSRARPQuerier::add_handlers()
     add_read_handler("queries", read_stats, (void *)1);
     add_read_handler("responses", read_stats, (void *)2);
     add_read_handler("drops", read_stats, (void *)3);
+    add_read_handler("mac_index", read_mac_index, (void *)0);
+    add_read_handler("hash_stats", read_hash_stats, (void *)0);
+    add_read_handler("generation", read_stats, (void *)4);
+    add_memory_handlers(this);
+}
+
+void *
+OLSRARPQuerier::cast(const char *n)
+{
+    if (strcmp(n, "OLSRMemoryClient") == 0)
+	return (OLSRMemoryReport::Client *) this;
+    return Element::cast(n);
+}
+
+void
+OLSRARPQuerier::memory_usage(Vector<OLSRMemoryReport::Usage> &usage)
+{
+    _lock.acquire_read();
+    size_t bytes = _nentries * sizeof(ARPEntry) + _nmap * sizeof(ARPEntry *)
+	+ OLSRMemoryReport::bytes(_mac_index);
+    usage.push_back(OLSRMemoryReport::Usage("arp_entries", _nentries, bytes));
+    _lock.release_read();
+}
+
+String
+OLSRARPQuerier::read_hash_stats(Element *e, void *)
+{
+  OLSRARPQuerier *q = (OLSRARPQuerier *)e;
+  q->_lock.acquire_read();
+  int empty = 0, longest = 0;
+  for (int i = 0; i < q->_nmap; i++) {
+    int length = 0;
+    for (ARPEntry *ae = q->_map[i]; ae; ae = ae->next)
+      length++;
+    if (length == 0)
+      empty++;
+    if (length > longest)
+      longest = length;
+  }
+  int entries = q->_nentries, buckets = q->_nmap;
+  q->_lock.release_read();
+
+  StringAccum sa;
+  // entries per bucket with two decimals, without floating point
+  int r = buckets ? (entries * 100) / buckets : 0;
+  sa << "entries " << entries << "\n"
+     << "buckets " << buckets << "\n"
+     << "load_factor " << (r / 100) << '.' << (r % 100 < 10 ? "0" : "") << (r % 100) << "\n"
+     << "empty_buckets " << empty << "\n"
+     << "longest_chain " << longest << "\n";
+  return sa.take_string();
+}
+
+String
+OLSRARPQuerier::read_mac_index(Element *e, void *)
+{
+  OLSRARPQuerier *q = (OLSRARPQuerier *)e;
+  StringAccum sa;
+  q->_lock.acquire_read();
+  for (HashMap<EtherAddress, ARPEntry *>::const_iterator it = q->_mac_index.begin(); it != q->_mac_index.end(); it++)
+    sa << it.key() << ' ' << it.value()->ip << '\n';
+  q->_lock.release_read();
+  return sa.take_string();
+}
+
+/**
+ * Make ae, an ok entry, the one lookup_mac() returns for its Ethernet
+ * address. Called with the write lock held.
+ */
+void
+OLSRARPQuerier::index_mac(ARPEntry *ae)
+{
+  _mac_index.insert(ae->en, ae);
+}
+
+/**
+ * Drop ae from the Ethernet address index before it is deleted or gets
+ * another address. Should some other ok entry share the address, that one
+ * takes its place; this is rare, so the scan is cheaper than keeping lists.
+ * Called with the write lock held.
+ */
+void
+OLSRARPQuerier::unindex_mac(ARPEntry *ae)
+{
+  ARPEntry **indexed = _mac_index.findp(ae->en);
+  if (!indexed || *indexed != ae)
+    return;
+  _mac_index.erase(ae->en);
+  for (int i = 0; i < _nmap; i++)
+    for (ARPEntry *other = _map[i]; other; other = other->next)
+      if (other != ae && other->ok && other->en == ae->en) {
+	index_mac(other);
+	return;
+      }
 }
 
 /**
@@ -494,83 +675,111 @@ OLSRARPQuerier::lookup_mac(const EtherAddress &ether)
 	_lock.acquire_read();
 
 	IPAddress ret_val("0.0.0.0");
+	if (ARPEntry **ae = _mac_index.findp(ether))
+		ret_val = (*ae)->ip;
 
-	ARPEntry *ae = 0;
-	for (int bucket=0; bucket < NMAP; bucket++)
-	{
-		ae = _map[bucket];
-		while (ae && ae->en != ether)
-		{
-			ae = ae->next;
-		}
-		if (ae && ae->en == ether)
-		{
-			break;
-		}
-	}
-
-	if (ae && ae->ok)
-	{
-		ret_val = ae->ip;
-	}
 	_lock.release_read();
 	return ret_val;
 }
 
+/**
+ * sets ether to the address ip resolves to and returns true, if the entry
+ * is ok and not due for a new query; packets to other addresses should go
+ * through input 0, which queries for them
+ */
+bool
+OLSRARPQuerier::lookup_ip(IPAddress ip, EtherAddress &ether)
+{
+	_lock.acquire_read();
+
+	ARPEntry *ae = _map[ip_bucket(ip)];
+	while (ae && ae->ip != ip)
+		ae = ae->next;
+	bool found = ae && ae->ok && !ae->polling;
+	if (found)
+		ether = ae->en;
+
+	_lock.release_read();
+	return found;
+}
+
 /**
  * mvhaen -- addition for adding mac address. OLSR uses this to add 
  * IP - mac address tuples gathered from HELLO messages.
  */
 void OLSRARPQuerier::insert_entry(const IPAddress &ip, const EtherAddress &ether)
 {
-	int bucket = ip_bucket(ip);
-		
 	_lock.acquire_read();
 
-	ARPEntry *ae = _map[bucket];
+	ARPEntry *ae = _map[ip_bucket(ip)];
 
 	while (ae && ae->ip != ip)
 		ae = ae->next;
 
-	if (ae)
+	if (ae && ae->ok && ae->en == ether)
 	{
-		if (ae->ok && ae->en != ether)
-			click_chatter("OLSRARPQuerier overwriting an entry");		
-		ae->en = ether;
+		// the common case: the tuple is known already
 		ae->last_response_jiffies = click_jiffies();
 		_lock.release_read();
+		return;
 	}
-	else
+	_lock.release_read();
+
+	// the address or the index changes, which requires the write lock;
+	// expire first, since expiring might delete the entry
+	if (!ae && _cache_size >= _capacity)
+		expire_hook(0, this);
+	_lock.acquire_write();
+
+	int bucket = ip_bucket(ip);
+	ae = _map[bucket];
+	while (ae && ae->ip != ip)
+		ae = ae->next;
+
+	if (ae)
 	{
-		_lock.release_read();
-		_lock.acquire_write();
-		if (_cache_size >= _capacity)
-			expire_hook(0, this);
-		if (ARPEntry *ae = new ARPEntry)
+		if (ae->ok && ae->en != ether)
 		{
-			ae->ip = ip;
-			ae->en = ether;
-			ae->ok = 1;				// the entry is automatically ok, since we are setting the mac address
-			ae->polling = 0;			// don't know what polling does ..
-			ae->head = ae->tail = 0;		// no buffered packets
-			ae->last_response_jiffies = click_jiffies();
-			ae->pprev = &_map[bucket];
-			if ((ae->next = _map[bucket]))
-				ae->next->pprev = &ae->next;
-			_map[bucket] = ae;
-
-			if (_age_tail)
-				ae->age_pprev = &_age_tail->age_next;
-			else
-				ae->age_pprev = &_age_head;
-			_age_tail = *ae->age_pprev = ae;
-			ae->age_next = 0;
+			click_chatter("OLSRARPQuerier overwriting an entry");
+			unindex_mac(ae);
+			_generation++;
 		}
-		_lock.release_write();
+		ae->en = ether;
+		ae->last_response_jiffies = click_jiffies();
+		if (ae->ok)
+			index_mac(ae);
+	}
+	else if ((ae = new ARPEntry))
+	{
+		ae->ip = ip;
+		ae->en = ether;
+		ae->ok = 1;				// the entry is automatically ok, since we are setting the mac address
+		ae->polling = 0;			// don't know what polling does ..
+		ae->head = ae->tail = 0;		// no buffered packets
+		ae->last_response_jiffies = click_jiffies();
+		ae->pprev = &_map[bucket];
+		if ((ae->next = _map[bucket]))
+			ae->next->pprev = &ae->next;
+		_map[bucket] = ae;
+
+		if (_age_tail)
+			ae->age_pprev = &_age_tail->age_next;
+		else
+			ae->age_pprev = &_age_head;
+		_age_tail = *ae->age_pprev = ae;
+		ae->age_next = 0;
+		index_mac(ae);
+		if (++_nentries > _nmap && _nmap_shift < MAX_NMAP_SHIFT)
+			resize_map(_nmap_shift + 1);
 	}
+	_lock.release_write();
 }
 
 
+#include <click/bighashmap.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class HashMap<EtherAddress, OLSRARPQuerier::ARPEntry *>;
+#endif
 CLICK_ENDDECLS
 EXPORT_ELEMENT(OLSRARPQuerier)
 ELEMENT_MT_SAFE(OLSRARPQuerier)
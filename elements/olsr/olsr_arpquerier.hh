@@ -4,7 +4,10 @@
 #include <click/etheraddress.hh>
 #include <click/ipaddress.hh>
 #include <click/sync.hh>
+#include <click/percpu.hh>
 #include <click/timer.hh>
+#include <click/bighashmap.hh>
+#include "olsr_memory_report.hh"
 CLICK_DECLS
 
 /*
@@ -53,6 +56,9 @@ Keyword arguments are:
 Unsigned integer.  The maximum number of saved IP packets the element will
 hold at a time.  Default is 2048.  Note that, unlike the number of packets,
 the total number of ARP entries the element will hold is currently unlimited.
+When it is full, the element makes room by dropping all the packets saved
+for the address that was answered least recently.  The packets saved for an
+address are sent together, in one batch, when its response arrives.
  
 =item BROADCAST
  
@@ -101,12 +107,34 @@ Returns the number of responses received.
  
 Returns the number of packets dropped.
  
+=h hash_stats read-only
+ 
+Returns the number of ARP entries, the number of hash buckets, the load
+factor, the number of empty buckets and the longest chain. The table starts
+with 256 buckets and doubles whenever there are more entries than buckets.
+ 
+=h mac_index read-only
+ 
+Returns the Ethernet to IP address index used by lookup_mac().
+ 
+=h generation read-only
+ 
+Returns the counter that lookup_ip() callers compare to tell whether their
+copies of resolved addresses are still good. It increases whenever an
+entry loses or changes its Ethernet address or is due for a new query.
+ 
+=h memory read-only
+ 
+Returns the number of ARP entries and the bytes they and the hash tables
+use, and the highest of both seen; see OLSRMemoryReport. Packets waiting
+for a response are not counted.
+ 
 =a
  
 ARPResponder, ARPFaker, AddressInfo
 */
 
-class OLSRARPQuerier : public Element
+class OLSRARPQuerier : public Element, public OLSRMemoryReport::Client
 {
 public:
 
@@ -119,6 +147,8 @@ public:
 	const char *flow_code() const	{ return "xy/x"; }
 
 	void add_handlers();
+	void *cast(const char *);
+	void memory_usage(Vector<OLSRMemoryReport::Usage> &);
 
 	int configure( Vector<String> &, ErrorHandler * );
 	int live_reconfigure( Vector<String> &, ErrorHandler * );
@@ -136,6 +166,10 @@ public:
 	                    unsigned char sha[ 6 ], unsigned char spa[ 4 ] );
 
 	IPAddress lookup_mac( const EtherAddress &ether );
+	bool lookup_ip( IPAddress ip, EtherAddress &ether );
+	unsigned generation() const	{ return _generation; }
+	const EtherAddress &ether_address() const	{ return _my_en; }
+	const IPAddress &ip_address() const	{ return _my_ip; }
 
 	void insert_entry( const IPAddress &ip, const EtherAddress &ether );
 
@@ -160,40 +194,55 @@ private:
 
 	ReadWriteLock _lock;
 
-	enum { NMAP = 256 };
-	ARPEntry *_map[ NMAP ];
+	enum { MIN_NMAP_SHIFT = 8, MAX_NMAP_SHIFT = 16 };
+	ARPEntry **_map;
+	int _nmap_shift;
+	int _nmap;		// 1 << _nmap_shift buckets
+	int _nentries;
+	HashMap<EtherAddress, ARPEntry *> _mac_index;	// ok entries by Ethernet address, for lookup_mac()
 	ARPEntry *_age_head;
 	ARPEntry *_age_tail;
 	EtherAddress _my_en;
 	IPAddress _my_ip;
 	Timer _expire_timer;
 	uint32_t _capacity;
+	unsigned _generation;	// bumped under the write lock, read without
 
 	IPAddress _bcast_addr;
 
 	// statistics
 	atomic_uint32_t _cache_size;
-	atomic_uint32_t _arp_queries;
-	atomic_uint32_t _drops;
-	atomic_uint32_t _arp_responses;
+	PerCPUCounter<uint32_t> _arp_queries;
+	PerCPUCounter<uint32_t> _drops;
+	PerCPUCounter<uint32_t> _arp_responses;
 
-	static inline int ip_bucket( IPAddress );
+	inline int ip_bucket( IPAddress ) const;
+	bool resize_map( int shift );
 	void send_query_for( IPAddress );
+	void index_mac( ARPEntry * );
+	void unindex_mac( ARPEntry * );
 
 	void handle_ip( Packet * );
 	void handle_response( Packet * );
+	void drop_held( ARPEntry * );
 
 	enum { EXPIRE_TIMEOUT_MS = 60 * 1000 };
 	static void expire_hook( Timer *, void * );
 	static String read_table( Element *, void * );
 	static String read_stats( Element *, void * );
+	static String read_mac_index( Element *, void * );
+	static String read_hash_stats( Element *, void * );
 
 };
 
+/**
+ * multiplicative hash of the whole address; the low order bits, where
+ * addresses on one network differ most, end up in the bits kept
+ */
 inline int
-OLSRARPQuerier::ip_bucket( IPAddress ipa )
+OLSRARPQuerier::ip_bucket( IPAddress ipa ) const
 {
-	return ( ipa.data() [ 0 ] + ipa.data() [ 3 ] ) % NMAP;
+	return ( ntohl( ipa.addr() ) * 2654435761U ) >> ( 32 - _nmap_shift );
 }
 
 CLICK_ENDDECLS
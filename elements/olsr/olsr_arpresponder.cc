@@ -197,8 +197,9 @@ OLSRARPResponder::read_handler(Element *e, void *thunk)
 
       case 0: {			// table
 	  StringAccum sa;
+	  char buf[IPAddress::unparse_with_mask_buflen];
 	  for (int i = 0; i < ar->_v.size(); i++)
-	      sa << ar->_v[i].dst.unparse_with_mask(ar->_v[i].mask) << ' ' << ar->_v[i].ena << '\n';
+	      sa << ar->_v[i].dst.unparse_with_mask(buf, ar->_v[i].mask) << ' ' << ar->_v[i].ena << '\n';
 	  return sa.take_string();
       }
 
@@ -6,11 +6,14 @@
 #include <click/vector.hh>
 #include "ippair.hh"
 #include "click_olsr.hh"
+#include "olsr_bulk_load.hh"
+#include <click/error.hh>
 
 CLICK_DECLS
 
 OLSRAssociationInfoBase::OLSRAssociationInfoBase()
-  : _timer(this), _useTimer(true), _redundancyCheck(false), _compact(false)
+  : _trie(0), _timer(this), _expiryQueue(0), _useTimer(true), _redundancyCheck(false), _compact(false),
+    _bulk(false), _bulk_changed(false), _version(0)
 {
 }
 
@@ -23,6 +26,8 @@ OLSRAssociationInfoBase::~OLSRAssociationInfoBase()
 int
 OLSRAssociationInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+  Element *expiry_queue = 0, *trace = 0;
+  uint32_t trace_mask = 0xFFFFFFFFU;
   if ( cp_va_parse( conf, this, errh,
 		    cpElement, "Routing Table Element", &_routingTable,
 		    cpKeywords,
@@ -31,8 +36,15 @@ OLSRAssociationInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
 			"HNA_COMPACTING", cpBool, "compact HNA messages", &_compact,
 			"HOME_NETWORK", cpIPAddress, "home network", &_home_network,
 			"HOME_NETWORK_NETMASK", cpIPAddress, "home network netmask", &_home_netmask,
+			"EXPIRY_QUEUE", cpElement, "shared expiry timer", &expiry_queue,
+			"TRACE", cpElement, "OLSRTrace element", &trace,
+			"TRACE_MASK", cpUnsigned, "events to trace", &trace_mask,
 		    0) < 0 )
     return -1;
+  if (set_trace(trace, trace_mask, this, errh) < 0)
+    return -1;
+  if (expiry_queue && !(_expiryQueue = (OLSRExpiryQueue *) expiry_queue->cast("OLSRExpiryQueue")))
+    return errh->error("EXPIRY_QUEUE element is not an OLSRExpiryQueue");
 	
 
 
@@ -65,10 +77,16 @@ OLSRAssociationInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
 int
 OLSRAssociationInfoBase::initialize(ErrorHandler *)
 {
-	if (_useTimer) _timer.initialize(this);
+	if (_useTimer) {
+		_timer.initialize(this);
+		set_expiry(_expiryQueue, &_timer);
+	}
 	_associationSet = new AssociationSet;
 	_associations = new Vector<IPPair>;
-	if (_redundancyCheck) _noRedundants = new Vector<IPPair>;
+	if (_redundancyCheck) {
+		_noRedundants = new Vector<IPPair>;
+		add_prefix(_home_network, _home_netmask);
+	}
 	if (_compact) {
 		_compactSet = new OLSRCompactAssociationInfoBase;
 		_compactSet2 = new OLSRCompactAssociationInfoBase;
@@ -80,32 +98,57 @@ void OLSRAssociationInfoBase::uninitialize()
 {
  delete _associationSet;
  if (_redundancyCheck) delete _noRedundants;
+ free_trie(_trie);
+ _trie = 0;
  if (_compact) {
  	delete _compactSet;
  	delete _compactSet2;
 }
 }
 
+void
+OLSRAssociationInfoBase::take_state(Element *e, ErrorHandler *)
+{
+  OLSRAssociationInfoBase *old = (OLSRAssociationInfoBase *) e->cast("OLSRAssociationInfoBase");
+  if (!old)
+    return;
+
+  // the prefix trie and the compact sets depend on this configuration's
+  // keywords, so add the tuples again rather than taking the structures
+  olsr_time_t now = olsr_now();
+  for (AssociationSet::iterator iter = old->_associationSet->begin(); iter != old->_associationSet->end(); iter++) {
+    const association_data &data = iter.value();
+    if (!_useTimer || data.A_time > now)
+      add_tuple(data.A_gateway_addr, data.A_network_addr, data.A_netmask, data.A_time);
+  }
+}
+
 association_data *
-OLSRAssociationInfoBase::add_tuple(IPAddress gateway_addr, IPAddress network_addr, IPAddress netmask, timeval time)
+OLSRAssociationInfoBase::add_tuple(IPAddress gateway_addr, IPAddress network_addr, IPAddress netmask, olsr_time_t time)
 {
   IPPair ippair= IPPair(gateway_addr, network_addr, netmask);
-  struct association_data *data;
-  data = new struct association_data;		//released in remove
+  struct association_data data;		//stored inline in the association set
 
-  data->A_gateway_addr = gateway_addr;
-  data->A_network_addr = network_addr;
-  data->A_netmask = netmask;
-  data->A_time = time;
+  data.A_gateway_addr = gateway_addr;
+  data.A_network_addr = network_addr;
+  data.A_netmask = netmask;
+  data.A_time = time;
   
-  if ( _associationSet->empty() ) {
-    if (_useTimer) _timer.schedule_at(time);
+  if (_useTimer && _bulk)
+    _expiry.append(time, ippair);
+  else if (_useTimer) {
+    _expiry.push(time, ippair);
+    expire_at(time);
   }
   if ( _associationSet->insert(ippair, data) ) {
+	_version++;
+	_bulk_changed = true;
   	if (_compact) {
 		_compactSet->add(network_addr, netmask);
 	}
-    return data;
+	if (_redundancyCheck)
+		add_prefix(network_addr, netmask);
+    return _associationSet->findp(ippair);
   }
   return 0;
 }
@@ -116,11 +159,9 @@ OLSRAssociationInfoBase::find_tuple(IPAddress gateway_addr, IPAddress network_ad
 {
   if (! _associationSet->empty() ) {
     IPPair ippair = IPPair(gateway_addr, network_addr, netmask);
-    struct HashMap<IPPair, void*>::Pair *pair;
-    pair = _associationSet->find_pair(ippair);
+    association_data *data = _associationSet->findp(ippair);
 
-    if (! pair == 0 ){
-      association_data *data = (association_data *)pair->value;
+    if (! data == 0 ){
       return data;
     }
   }
@@ -133,9 +174,12 @@ OLSRAssociationInfoBase::remove_tuple(IPAddress gateway_addr, IPAddress network_
 {
 
 	IPPair ippair = IPPair(gateway_addr, network_addr, netmask);
-	association_data *ptr=(association_data *)_associationSet->find(ippair);
-	_associationSet->remove(ippair);
-	delete ptr;
+	if (_associationSet->remove(ippair)) {
+		_version++;
+		_bulk_changed = true;
+		if (_redundancyCheck)
+			remove_prefix(network_addr, netmask);
+	}
 	
 	if (_compact) {
 		_compactSet->remove(network_addr, netmask);
@@ -143,7 +187,57 @@ OLSRAssociationInfoBase::remove_tuple(IPAddress gateway_addr, IPAddress network_
 }
 
 
-HashMap<IPPair, void*> *
+bool
+OLSRAssociationInfoBase::set_gateway_load(IPAddress gateway_addr, uint32_t capacity, uint32_t load, olsr_time_t time)
+{
+  GatewayLoad *old = _gatewayLoads.findp(gateway_addr);
+  bool changed = !old || old->capacity != capacity || old->load != load;
+  GatewayLoad &gl = _gatewayLoads.find_force(gateway_addr);
+  gl.capacity = capacity;
+  gl.load = load;
+  gl.time = time;
+  return changed;
+}
+
+
+int
+OLSRAssociationInfoBase::gateway_free_capacity(IPAddress gateway_addr, olsr_time_t now) const
+{
+  const GatewayLoad *gl = _gatewayLoads.findp(gateway_addr);
+  if (!gl || gl->time <= now)
+    return -1;
+  uint32_t left = (gl->load < gl->capacity ? gl->capacity - gl->load : 0);
+  if (left > 0x7FFFFFFFU)
+    left = 0x7FFFFFFFU;
+  return left ? (int) left : 1;
+}
+
+
+void
+OLSRAssociationInfoBase::begin_bulk()
+{
+  _bulk = true;
+  _bulk_changed = false;
+}
+
+
+void
+OLSRAssociationInfoBase::commit_bulk()
+{
+  if (!_bulk)
+    return;
+  _bulk = false;
+  if (_useTimer) {
+    _expiry.rebuild();
+    if (!_expiry.empty())
+      expire_at(_expiry.next());
+  }
+  if (_bulk_changed)
+    _routingTable->schedule_update_routing_table();
+}
+
+
+OLSRAssociationInfoBase::AssociationSet *
 OLSRAssociationInfoBase::get_association_set()
 {
   return _associationSet;
@@ -152,151 +246,355 @@ OLSRAssociationInfoBase::get_association_set()
 void
 OLSRAssociationInfoBase::clear()
 {
-	for ( AssociationSet::iterator iter = _associationSet->begin(); iter != _associationSet->end(); iter++){
-		IPPair *entry = (IPPair *) iter.value();
-		delete entry;			//free memory of entries
-	}
-	delete _associationSet;
-	_associationSet = new AssociationSet;
+	_associationSet->clear();
+	_gatewayLoads.clear();
+	_version++;
 	if (_compactSet) _compactSet->get_compact_set()->clear();
+	if (_redundancyCheck) {
+		free_trie(_trie);
+		_trie = 0;
+		_irregular.clear();
+		add_prefix(_home_network, _home_netmask);
+	}
 }
 
 void
 OLSRAssociationInfoBase::run_timer(Timer *)
 {
-  struct timeval now, next_timeout;
+  run_expiry_timer();
+}
+
+
+olsr_time_t
+OLSRAssociationInfoBase::run_expiry(olsr_time_t now)
+{
   bool association_tuple_removed = false;
-  click_gettimeofday(&now);
-  next_timeout = make_timeval(0, 0);
-
-  //find expired topology tuple and delete them
-  if (! _associationSet->empty()){
-    for (AssociationSet::iterator iter = _associationSet->begin(); iter != _associationSet->end(); iter++){
-      association_data *tuple = (association_data *) iter.value();
-      if (tuple->A_time <= now){
-	remove_tuple(tuple->A_gateway_addr, tuple->A_network_addr, tuple->A_netmask);
-	//click_chatter("Association tuple expired");
-	association_tuple_removed = true;
-      }
-    }
-  }
 
-  //find next topology tuple to expire
-  if (! _associationSet->empty()){
-    for (AssociationSet::iterator iter = _associationSet->begin(); iter != _associationSet->end(); iter++){
-      association_data *tuple = (association_data *) iter.value();
-      if (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0)
-	next_timeout = tuple->A_time;
-      if ( tuple->A_time < next_timeout )
-	next_timeout = tuple->A_time;
+  //expire the tuples at the top of the heap, put refreshed ones back
+  while (! _expiry.empty() && _expiry.next() <= now){
+    IPPair ippair = _expiry.pop();
+    association_data *tuple = _associationSet->findp(ippair);
+    if (! tuple)
+      continue;
+    if (tuple->A_time <= now){
+      remove_tuple(tuple->A_gateway_addr, tuple->A_network_addr, tuple->A_netmask);
+      //click_chatter("Association tuple expired");
+      association_tuple_removed = true;
     }
+    else
+      _expiry.push(tuple->A_time, ippair);
   }
 
-  if (! (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0) )
-    _timer.schedule_at(next_timeout);    //set timer
+  _expiry.compact_if_stale(*_associationSet, &association_data::A_time);
+
+  //gateway loads expire with the HNA tuples of their gateway
+  Vector<IPAddress> stale_loads;
+  for (GatewayLoadMap::iterator iter = _gatewayLoads.begin(); iter != _gatewayLoads.end(); iter++)
+    if (iter.value().time <= now)
+      stale_loads.push_back(iter.key());
+  for (int i = 0; i < stale_loads.size(); i++)
+    _gatewayLoads.remove(stale_loads[i]);
+
   if (association_tuple_removed){
     //click_chatter("recomputing routing table");
-    _routingTable->compute_routing_table();
+    _routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_HNA);
     //_routingTable->print_routing_table();
   }
+  if (_expiry.empty())
+    return 0;
+  return _expiry.next();
+}
+
+
+static inline uint32_t
+prefix_mask(int len)
+{
+	return len ? 0xFFFFFFFFU << (32 - len) : 0;
+}
+
+static inline int
+prefix_bit(uint32_t addr, int i)
+{
+	return (addr >> (31 - i)) & 1;
+}
+
+/**
+ * counts a prefix into the trie, splitting the node where it leaves the
+ * existing paths
+ */
+void
+OLSRAssociationInfoBase::add_prefix(IPAddress network_addr, IPAddress netmask)
+{
+	int len = netmask.mask_to_prefix_len();
+	if (len < 0) {
+		IPPair prefix(network_addr, netmask);
+		int *count = _irregular.findp(prefix);
+		if (count)
+			(*count)++;
+		else
+			_irregular.insert(prefix, 1);
+		return;
+	}
+	uint32_t addr = ntohl(network_addr.addr()) & prefix_mask(len);
+
+	TrieNode **link = &_trie;
+	while (*link) {
+		TrieNode *node = *link;
+		if (node->len <= len && ((addr ^ node->prefix) & prefix_mask(node->len)) == 0) {
+			if (node->len == len) {
+				node->count++;
+				return;
+			}
+			link = &node->child[prefix_bit(addr, node->len)];
+			continue;
+		}
+
+		//the paths part at the first differing bit, or the new prefix ends first
+		int common = 0;
+		int max = (node->len < len ? node->len : len);
+		while (common < max && !prefix_bit(addr ^ node->prefix, common))
+			common++;
+		TrieNode *split = new TrieNode;
+		split->prefix = addr & prefix_mask(common);
+		split->len = common;
+		split->count = 0;
+		split->child[0] = split->child[1] = 0;
+		split->child[prefix_bit(node->prefix, common)] = node;
+		*link = split;
+		if (common == len) {
+			split->count = 1;
+			return;
+		}
+		link = &split->child[prefix_bit(addr, common)];
+		break;
+	}
+
+	TrieNode *leaf = new TrieNode;
+	leaf->prefix = addr;
+	leaf->len = len;
+	leaf->count = 1;
+	leaf->child[0] = leaf->child[1] = 0;
+	*link = leaf;
+}
+
+/**
+ * uncounts a prefix, removing the nodes that no longer hold a prefix or
+ * join two paths
+ */
+void
+OLSRAssociationInfoBase::remove_prefix(IPAddress network_addr, IPAddress netmask)
+{
+	int len = netmask.mask_to_prefix_len();
+	if (len < 0) {
+		IPPair prefix(network_addr, netmask);
+		int *count = _irregular.findp(prefix);
+		if (count && --(*count) == 0)
+			_irregular.remove(prefix);
+		return;
+	}
+	uint32_t addr = ntohl(network_addr.addr()) & prefix_mask(len);
+
+	TrieNode **parent_link = 0;
+	TrieNode **link = &_trie;
+	while (*link && (*link)->len < len) {
+		if (((addr ^ (*link)->prefix) & prefix_mask((*link)->len)) != 0)
+			return;
+		parent_link = link;
+		link = &(*link)->child[prefix_bit(addr, (*link)->len)];
+	}
+	TrieNode *node = *link;
+	if (!node || node->len != len || node->prefix != addr || node->count == 0)
+		return;
+	if (--node->count > 0 || (node->child[0] && node->child[1]))
+		return;
+
+	*link = (node->child[0] ? node->child[0] : node->child[1]);
+	delete node;
+	//a parent without prefix of its own needs two children
+	if (parent_link && !*link) {
+		TrieNode *parent = *parent_link;
+		if (parent->count == 0) {
+			*parent_link = (parent->child[0] ? parent->child[0] : parent->child[1]);
+			delete parent;
+		}
+	}
+}
+
+/**
+ * appends the prefixes not covered by another one, in address order; the
+ * walk does not descend below a prefix, so covered prefixes cost nothing
+ */
+void
+OLSRAssociationInfoBase::collect_frontier(const TrieNode *node, Vector<IPPair> &frontier)
+{
+	if (!node)
+		return;
+	if (node->count > 0) {
+		frontier.push_back(IPPair(IPAddress(htonl(node->prefix)), IPAddress::make_prefix(node->len)));
+		return;
+	}
+	collect_frontier(node->child[0], frontier);
+	collect_frontier(node->child[1], frontier);
+}
+
+void
+OLSRAssociationInfoBase::free_trie(TrieNode *node)
+{
+	if (!node)
+		return;
+	free_trie(node->child[0]);
+	free_trie(node->child[1]);
+	delete node;
 }
 
 
 Vector<IPPair> *
 OLSRAssociationInfoBase::get_associations()
 {
-	print_association_set();
-	_associations->clear();
-	for ( AssociationSet::iterator iter = _associationSet->begin(); iter != _associationSet->end(); iter++){
-      association_data *entry = (association_data *) iter.value();
-	  _associations->push_back(IPPair(entry->A_network_addr, entry->A_netmask));
-    }	
-
+	Vector<IPPair> *associations;
  	if (_compact && _redundancyCheck) {
-		click_chatter("%s | returning associations with redundant entries removed\n", name().c_str());
-		_associations->push_back(IPPair(_home_network , _home_netmask));
 		redundancy_check();
 		_compactSet2->get_compact_set()->clear();		
 		for (Vector<IPPair>::iterator iter = _noRedundants->begin(); iter != _noRedundants->end(); iter++) {
 			_compactSet2->add(iter->_from, iter->_to);
 		}
-		return _compactSet2->get_compact_set();
+		associations = _compactSet2->get_compact_set();
 	} else if (_compact) {
-		_compactSet->print_compact_set();
-		click_chatter("%s | returning compacted association entries\n", name().c_str());
-		return _compactSet->get_compact_set();
+		associations = _compactSet->get_compact_set();
 	} else if (_redundancyCheck) {
-		click_chatter("%s | returning associations with redundant entries removed\n", name().c_str());
-		_associations->push_back(IPPair(_home_network , _home_netmask));
 		redundancy_check();
-		return _noRedundants;
+		associations = _noRedundants;
 	} else {
-		click_chatter("%s | returning associations\n", name().c_str());
-		return _associations;
+		_associations->clear();
+		for ( AssociationSet::iterator iter = _associationSet->begin(); iter != _associationSet->end(); iter++){
+			association_data *entry = &iter.value();
+			_associations->push_back(IPPair(entry->A_network_addr, entry->A_netmask));
+		}
+		associations = _associations;
 	}
+	trace(OLSR_TRACE_ASSOCIATIONS, IPAddress(), IPAddress(), IPAddress(), associations->size());
+	return associations;
 }
 
+/**
+ * fills _noRedundants with the home network and the associated prefixes
+ * that no other of them covers
+ */
 void
 OLSRAssociationInfoBase::redundancy_check()
 {
-	Vector<IPPair> bucket[2];
-	Vector<IPPair>::iterator previous;	
-	
 	_noRedundants->clear();
-	
-	// copy all IPPairs into a vector and perform a radix sort on the IPAddresses
-	
-	uint32_t bit = 0;
-	for (uint32_t i = 0; i < 32; i++) {
-		bit = 1 << i; 
-		for (Vector<IPPair>::iterator iter = _associations->begin(); iter != _associations->end(); iter++) {
-			uint32_t addr = htonl(iter->_from.addr());
-			uint32_t res = (addr & bit) >> i;
-			bucket[res].push_back(*iter);
-		}
-		_associations->clear();
-		for (Vector<IPPair>::iterator iter = bucket[0].begin(); iter != bucket[0].end(); iter++) {
-			_associations->push_back(*iter);
-		}		
-		bucket[0].clear();
-		for (Vector<IPPair>::iterator iter = bucket[1].begin(); iter != bucket[1].end(); iter++) {
-			_associations->push_back(*iter);
-		}
-		bucket[1].clear();
-	}
-	
-	previous = 0;
-	for (Vector<IPPair>::iterator iter = _associations->begin(); iter != _associations->end(); iter++) {
-		if (!previous) {
-			_noRedundants->push_back(*iter);
-			previous = iter;
-			continue;
-		}
-		if (iter->_from.matches_prefix(previous->_from, previous->_to)) continue;
-		else {
-			_noRedundants->push_back(*iter);
-			previous = iter;
-		}
-	}
+	collect_frontier(_trie, *_noRedundants);
+	for (HashMap<IPPair, int>::iterator iter = _irregular.begin(); iter != _irregular.end(); iter++)
+		_noRedundants->push_back(iter.key());
 }
 
 int
 OLSRAssociationInfoBase::set_home_network_write_handler(const String &conf, Element *e, void *, ErrorHandler * errh)
 {
   OLSRAssociationInfoBase* me = (OLSRAssociationInfoBase *) e;
+  IPAddress home_network, home_netmask;
   int res = cp_va_parse(conf, me, errh,
-			cpIPPrefix, "the network address that HNA should advertise", &me->_home_network, &me->_home_netmask,
+			cpIPPrefix, "the network address that HNA should advertise", &home_network, &home_netmask,
 			0);
   if ( res < 0 )
     return res;  
+  if (me->_redundancyCheck) {
+    me->remove_prefix(me->_home_network, me->_home_netmask);
+    me->add_prefix(home_network, home_netmask);
+  }
+  me->_home_network = home_network;
+  me->_home_netmask = home_netmask;
+  me->_version++;
   return 0;
 }
 
 
+/**
+ * adds the tuples of a text of lines GATEWAY NETWORK/MASK MSECS, valid for
+ * MSECS milliseconds from now; existing tuples are replaced
+ */
+int
+OLSRAssociationInfoBase::load_handler(const String &text, Element *e, void *, ErrorHandler *errh)
+{
+  OLSRAssociationInfoBase *aib = (OLSRAssociationInfoBase *) e;
+  OLSRBulkLoader loader(text);
+  Vector<String> words;
+  Vector<association_data> tuples;
+
+  //parse everything first, a bad line loads nothing
+  while (loader.next(words)) {
+    association_data data;
+    if (words.size() != 3
+	|| !cp_ip_address(words[0], &data.A_gateway_addr)
+	|| !cp_ip_prefix(words[1], &data.A_network_addr, &data.A_netmask)
+	|| !loader.parse_validity(words[2], data.A_time))
+      return errh->error("line %d: expected GATEWAY NETWORK/MASK MSECS", loader.line());
+    tuples.push_back(data);
+  }
+
+  aib->begin_bulk();
+  for (int i = 0; i < tuples.size(); i++) {
+    const association_data &t = tuples[i];
+    if (aib->find_tuple(t.A_gateway_addr, t.A_network_addr, t.A_netmask))
+      aib->remove_tuple(t.A_gateway_addr, t.A_network_addr, t.A_netmask);
+    aib->add_tuple(t.A_gateway_addr, t.A_network_addr, t.A_netmask, t.A_time);
+  }
+  aib->commit_bulk();
+  return 0;
+}
+
+
+void *
+OLSRAssociationInfoBase::cast(const char *n)
+{
+  if (strcmp(n, "OLSRMemoryClient") == 0)
+    return (OLSRMemoryReport::Client *) this;
+  return Element::cast(n);
+}
+
+
+int
+OLSRAssociationInfoBase::trie_size(const TrieNode *node)
+{
+  return node ? 1 + trie_size(node->child[0]) + trie_size(node->child[1]) : 0;
+}
+
+
+void
+OLSRAssociationInfoBase::memory_usage(Vector<OLSRMemoryReport::Usage> &usage)
+{
+  size_t bytes = OLSRMemoryReport::bytes(*_associationSet) + _expiry.bytes()
+    + OLSRMemoryReport::bytes(*_associations) + OLSRMemoryReport::bytes(_irregular)
+    + trie_size(_trie) * sizeof(TrieNode);
+  if (_redundancyCheck)
+    bytes += OLSRMemoryReport::bytes(*_noRedundants);
+  if (_compact)
+    bytes += OLSRMemoryReport::bytes(*_compactSet->get_compact_set())
+      + OLSRMemoryReport::bytes(*_compactSet2->get_compact_set());
+  usage.push_back(OLSRMemoryReport::Usage("associations", _associationSet->size(), bytes));
+  usage.push_back(OLSRMemoryReport::Usage("gateway_loads", _gatewayLoads.size(),
+					  OLSRMemoryReport::bytes(_gatewayLoads)));
+}
+
+
+void
+OLSRAssociationInfoBase::hash_stats(StringAccum &sa)
+{
+  OLSRMemoryReport::unparse_chains(sa, "associations", *_associationSet);
+  OLSRMemoryReport::unparse_chains(sa, "irregular", _irregular);
+  OLSRMemoryReport::unparse_chains(sa, "gateway_loads", _gatewayLoads);
+}
+
+
 void
 OLSRAssociationInfoBase::add_handlers()
 {
   this->add_write_handler("set_home_network", set_home_network_write_handler, (void *)0);
+  add_write_handler("load", load_handler, 0);
+  add_trace_handlers(this);
+  add_memory_handlers(this);
+  add_hash_stats_handler(this);
 }
 
 void
@@ -304,11 +602,12 @@ OLSRAssociationInfoBase::print_association_set()
 {
   if (! _associationSet->empty() ){
     click_chatter("Association Set:\n");
+    char buf[IPAddress::unparse_buflen];
     for ( AssociationSet::iterator iter = _associationSet->begin(); iter != _associationSet->end(); iter++){
-      association_data *entry = (association_data *) iter.value();
-      click_chatter("Gateway: %s\n", entry->A_gateway_addr.unparse().c_str());
-      click_chatter("\tNetwork: %s\n", entry->A_network_addr.unparse().c_str());
-      click_chatter("\tNetmask: %s\n", entry->A_netmask.unparse().c_str());
+      association_data *entry = &iter.value();
+      click_chatter("Gateway: %s\n", entry->A_gateway_addr.unparse(buf));
+      click_chatter("\tNetwork: %s\n", entry->A_network_addr.unparse(buf));
+      click_chatter("\tNetmask: %s\n", entry->A_netmask.unparse(buf));
     }
   }
   else
@@ -318,8 +617,11 @@ OLSRAssociationInfoBase::print_association_set()
 #include <click/vector.cc>
 #include <click/bighashmap.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
-template class HashMap<IPPair, void *>;
+template class HashMap<IPPair, association_data>;
+template class HashMap<IPPair, int>;
+template class HashMap<IPAddress, OLSRAssociationInfoBase::GatewayLoad>;
 template class Vector<IPPair>;
+template class Vector<association_data>;
 #endif
 
 CLICK_ENDDECLS
@@ -11,12 +11,15 @@
 #include "olsr_rtable.hh"
 #include "click_olsr.hh"
 #include "olsr_compact_association_info_base.hh"
+#include "olsr_expiry_queue.hh"
+#include "olsr_trace.hh"
+#include "olsr_memory_report.hh"
 
 CLICK_DECLS
 
 class OLSRRoutingTable;
 
-class OLSRAssociationInfoBase: public Element{
+class OLSRAssociationInfoBase: public Element, public OLSRExpiryQueue::Client, public OLSRTrace::Client, public OLSRMemoryReport::Client{
 public:
 
   OLSRAssociationInfoBase();
@@ -29,40 +32,92 @@ public:
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
   void uninitialize();
+  void take_state(Element *, ErrorHandler *);
 
-  struct association_data *add_tuple(IPAddress gateway_addr, IPAddress network_addr, IPAddress netmask, timeval time);
+  // add_tuple()s and remove_tuple()s in between do not arm the expiry
+  // timer; commit_bulk() does, and has the routes to the associated
+  // networks updated once. Commit before returning to the driver
+  void begin_bulk();
+  void commit_bulk();
+
+  struct association_data *add_tuple(IPAddress gateway_addr, IPAddress network_addr, IPAddress netmask, olsr_time_t time);
   struct association_data *find_tuple(IPAddress gateway_addr, IPAddress network_addr, IPAddress netmask);
   void remove_tuple(IPAddress gateway_addr, IPAddress network_addr, IPAddress netmask);
-  HashMap<IPPair, void*> *get_association_set();
+  typedef HashMap <IPPair, association_data> AssociationSet;
+  AssociationSet *get_association_set();
   Vector<IPPair> *get_associations();
   void redundancy_check();
   void print_association_set();
   void clear();
 
+  // uplink capacity and load a gateway advertised in its GATEWAY_LOAD
+  // messages, in kbit/s, valid until time
+  struct GatewayLoad {
+    uint32_t capacity;
+    uint32_t load;
+    olsr_time_t time;
+  };
+  // returns true if capacity or load differ from those recorded so far
+  bool set_gateway_load(IPAddress gateway_addr, uint32_t capacity, uint32_t load, olsr_time_t time);
+  // capacity the gateway has left (at least 1), or -1 without a valid
+  // advertisement
+  int gateway_free_capacity(IPAddress gateway_addr, olsr_time_t now) const;
+
+  //changes whenever get_associations() may return something different
+  uint32_t version() const { return _version + (_compact ? _compactSet->version() : 0); }
+
   
 private:
-  typedef HashMap <IPPair, void *> AssociationSet;
-
   AssociationSet *_associationSet;
   
   Vector<IPPair> *_associations; 
   Vector<IPPair> *_noRedundants; 
+
+  //path compressed binary trie of the advertised prefixes, with
+  //REDUNDANCY_CHECK; a prefix is redundant below a node with count > 0
+  struct TrieNode {
+    uint32_t prefix;	// host byte order, masked to len bits
+    int len;
+    int count;		// association tuples (and home network) with this prefix
+    TrieNode *child[2];
+  };
+  TrieNode *_trie;
+  HashMap<IPPair, int> _irregular;	// prefixes with non-contiguous netmasks
+
+  typedef HashMap<IPAddress, GatewayLoad> GatewayLoadMap;
+  GatewayLoadMap _gatewayLoads;
   
   OLSRCompactAssociationInfoBase *_compactSet;
   OLSRCompactAssociationInfoBase * _compactSet2;
    
+  OLSRExpiryHeap<IPPair> _expiry;
   Timer _timer;
   OLSRRoutingTable *_routingTable;
+  OLSRExpiryQueue *_expiryQueue;
   bool _useTimer;
   bool _redundancyCheck;
   bool _compact;
+  bool _bulk;
+  bool _bulk_changed;
   
   IPAddress _home_network;
   IPAddress _home_netmask;
+  uint32_t _version;
  
   void add_handlers();   
+  void *cast(const char *);
+  void memory_usage(Vector<OLSRMemoryReport::Usage> &);
+  void hash_stats(StringAccum &);
   static int set_home_network_write_handler(const String &conf, Element *e, void *, ErrorHandler * errh);
+  static int load_handler(const String &, Element *, void *, ErrorHandler *);
+
+  void add_prefix(IPAddress network_addr, IPAddress netmask);
+  void remove_prefix(IPAddress network_addr, IPAddress netmask);
+  static void collect_frontier(const TrieNode *node, Vector<IPPair> &frontier);
+  static void free_trie(TrieNode *node);
+  static int trie_size(const TrieNode *node);
 
+  olsr_time_t run_expiry(olsr_time_t now);
   void run_timer(Timer *);
 };
 
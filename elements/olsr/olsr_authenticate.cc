@@ -0,0 +1,255 @@
+/*
+ * olsr_authenticate.{cc,hh} -- signs OLSR messages, or verifies and strips
+ * their signatures, verifying each message once
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "click_olsr.hh"
+#include "olsr_packethandle.hh"
+#include "olsr_authenticate.hh"
+
+CLICK_DECLS
+
+OLSRAuthenticate::OLSRAuthenticate()
+  : _signed(0), _relayed(0), _unverified(0), _verified(0), _cached(0),
+    _failed(0), _bad_trailer(0), _own(0)
+{
+}
+
+
+OLSRAuthenticate::~OLSRAuthenticate()
+{
+}
+
+
+int
+OLSRAuthenticate::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *duplicate_set;
+  String key;
+  int key_id = 0;
+  int hold = 30000;
+  if (cp_va_parse(conf, this, errh,
+		  cpBool, "verify signatures?", &_verify,
+		  cpElement, "OLSRDuplicateSet element", &duplicate_set,
+		  cpIPAddress, "Nodes main IP address", &_myMainIP,
+		  cpKeywords,
+		  "KEY", cpString, "shared key", &key,
+		  "KEY_ID", cpInteger, "key identifier", &key_id,
+		  "HOLD", cpInteger, "verdict hold time (msec)", &hold,
+		  0) < 0)
+    return -1;
+
+  if (!(_duplicateSet = (OLSRDuplicateSet *) duplicate_set->cast("OLSRDuplicateSet")))
+    return errh->error("%s is not an OLSRDuplicateSet", duplicate_set->name().c_str());
+  //the HMAC of the ipsec package pads keys of up to 16 bytes
+  if (key.length() < 1 || key.length() > 16)
+    return errh->error("KEY must be 1 to 16 bytes long");
+  if (key_id < 0 || key_id > 255)
+    return errh->error("KEY_ID must be between 0 and 255");
+  if (hold <= 0)
+    return errh->error("HOLD must be greater than 0");
+  _key_id = key_id;
+  _hold = olsr_msec(hold);
+  HMAC_Init(&_ctx, key.data(), key.length());
+  return 0;
+}
+
+
+/**
+ * the digest of the message at msg, of size bytes with its trailer, into
+ * md, which takes SHA_DIGEST_LENGTH bytes. Only the contexts the key set
+ * up are copied, so a message costs the SHA1 blocks of its own bytes and
+ * one more for the outer hash
+ */
+void
+OLSRAuthenticate::digest(const uint8_t *msg, int size, uint8_t *md) const
+{
+  HMAC_CTX c;
+  unsigned int md_len = SHA_DIGEST_LENGTH;
+  memcpy(&c.md_ctx, &_ctx.i_ctx, sizeof(SHA1_ctx));
+  memcpy(&c.o_ctx, &_ctx.o_ctx, sizeof(SHA1_ctx));
+  olsr_msg_hdr hdr;
+  memcpy(&hdr, msg, sizeof(olsr_msg_hdr));
+  hdr.ttl = 0;
+  hdr.hop_count = 0;
+  HMAC_Update(&c, (unsigned char *) &hdr, sizeof(olsr_msg_hdr));
+  HMAC_Update(&c, (unsigned char *) msg + sizeof(olsr_msg_hdr),
+	      size - sizeof(olsr_msg_hdr) - OLSR_AUTH_DIGEST_SIZE);
+  HMAC_Final(&c, md, &md_len);
+}
+
+
+Packet *
+OLSRAuthenticate::sign(Packet *p)
+{
+  const olsr_pkt_hdr *pkt_hdr = (const olsr_pkt_hdr *) p->data();
+  int end = ntohs(pkt_hdr->pkt_length);
+  if (end > (int) p->length())
+    end = p->length();
+
+  //the signed packet has room for a trailer after every message
+  int length = sizeof(olsr_pkt_hdr);
+  for (int offset = length; end - offset >= (int) sizeof(olsr_msg_hdr); ){
+    int msg_size = OLSRMessageView(p, offset).size();
+    if (msg_size < (int) sizeof(olsr_msg_hdr) || msg_size > end - offset)
+      break;
+    offset += msg_size;
+    length += msg_size + sizeof(olsr_auth_trailer);
+  }
+  WritablePacket *q = Packet::make(p->headroom(), 0, length, 0);
+  if (!q){
+    p->kill();
+    return 0;
+  }
+  q->copy_annotations(p);
+
+  int out = sizeof(olsr_pkt_hdr);
+  memcpy(q->data(), p->data(), out);
+  for (int offset = out; out < length; ){
+    OLSRMessageView msg(p, offset);
+    int msg_size = msg.size();
+    uint8_t *m = q->data() + out;
+    memcpy(m, p->data() + offset, msg_size);
+    offset += msg_size;
+    msg_size += sizeof(olsr_auth_trailer);
+    ((olsr_msg_hdr *) m)->msg_size = htons(msg_size);
+    olsr_auth_trailer *trailer = (olsr_auth_trailer *) (m + msg_size - sizeof(olsr_auth_trailer));
+    trailer->key_id = _key_id;
+    memset(trailer->reserved, 0, sizeof(trailer->reserved));
+
+    if (msg.originator() == _myMainIP){
+      uint8_t md[SHA_DIGEST_LENGTH];
+      digest(m, msg_size, md);
+      memcpy(trailer->digest, md, OLSR_AUTH_DIGEST_SIZE);
+      _signed++;
+    }
+    else if (const uint8_t *verified = _duplicateSet->verified_digest(msg.originator(), msg.seq())){
+      memcpy(trailer->digest, verified, OLSR_AUTH_DIGEST_SIZE);
+      _relayed++;
+    }
+    else{
+      _unverified++;
+      length -= msg_size;	//leave it out
+      continue;
+    }
+    out += msg_size;
+  }
+  p->kill();
+
+  q->take(q->length() - out);
+  ((olsr_pkt_hdr *) q->data())->pkt_length = htons(out);
+  if (out == (int) sizeof(olsr_pkt_hdr)){
+    checked_output_push(1, q);
+    return 0;
+  }
+  return q;
+}
+
+
+Packet *
+OLSRAuthenticate::verify(Packet *p)
+{
+  WritablePacket *q = p->uniqueify();
+  if (!q)
+    return 0;
+  olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) q->data();
+  int end = ntohs(pkt_hdr->pkt_length);
+  if (end > (int) q->length())
+    end = q->length();
+  olsr_time_t now = olsr_now();
+
+  //each message that passes moves down to out without its trailer
+  int offset = sizeof(olsr_pkt_hdr), out = offset;
+  while (end - offset >= (int) sizeof(olsr_msg_hdr)){
+    OLSRMessageView msg(q, offset);
+    int msg_size = msg.size();
+    if (msg_size < (int) sizeof(olsr_msg_hdr) || msg_size > end - offset)
+      break;
+    uint8_t *m = q->data() + offset;
+    offset += msg_size;
+    if (msg_size < (int) (sizeof(olsr_msg_hdr) + sizeof(olsr_auth_trailer))){
+      _bad_trailer++;
+      continue;
+    }
+    const olsr_auth_trailer *trailer = (const olsr_auth_trailer *) (m + msg_size - sizeof(olsr_auth_trailer));
+    if (trailer->key_id != _key_id){
+      _bad_trailer++;
+      continue;
+    }
+
+    IPAddress originator = msg.originator();
+    int seq = msg.seq();
+    if (originator == _myMainIP)
+      _own++;
+    else if (_duplicateSet->verified(originator, seq, trailer->digest))
+      _cached++;
+    else{
+      uint8_t md[SHA_DIGEST_LENGTH];
+      digest(m, msg_size, md);
+      if (memcmp(md, trailer->digest, OLSR_AUTH_DIGEST_SIZE) != 0){
+	_failed++;
+	continue;
+      }
+      _verified++;
+      _duplicateSet->add_verified(originator, seq, trailer->digest, now + _hold);
+    }
+
+    msg_size -= sizeof(olsr_auth_trailer);
+    ((olsr_msg_hdr *) m)->msg_size = htons(msg_size);
+    if (m != q->data() + out)
+      memmove(q->data() + out, m, msg_size);
+    out += msg_size;
+  }
+
+  q->take(q->length() - out);
+  pkt_hdr->pkt_length = htons(out);
+  if (out == (int) sizeof(olsr_pkt_hdr)){
+    checked_output_push(1, q);
+    return 0;
+  }
+  return q;
+}
+
+
+Packet *
+OLSRAuthenticate::simple_action(Packet *p)
+{
+  if (p->length() < sizeof(olsr_pkt_hdr)){
+    checked_output_push(1, p);
+    return 0;
+  }
+  return _verify ? verify(p) : sign(p);
+}
+
+
+String
+OLSRAuthenticate::read_stats(Element *e, void *)
+{
+  OLSRAuthenticate *a = (OLSRAuthenticate *) e;
+  StringAccum sa;
+  sa << "signed " << a->_signed << '\n'
+     << "relayed " << a->_relayed << '\n'
+     << "unverified " << a->_unverified << '\n'
+     << "verified " << a->_verified << '\n'
+     << "cached " << a->_cached << '\n'
+     << "failed " << a->_failed << '\n'
+     << "bad_trailer " << a->_bad_trailer << '\n'
+     << "own " << a->_own << '\n';
+  return sa.take_string();
+}
+
+
+void
+OLSRAuthenticate::add_handlers()
+{
+  add_read_handler("stats", read_stats, 0);
+}
+
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(IPsecAuthHMACSHA1)
+EXPORT_ELEMENT(OLSRAuthenticate)
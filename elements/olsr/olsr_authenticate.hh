@@ -0,0 +1,138 @@
+/*
+  =c
+  OLSRAuthenticate(VERIFY, OLSRDuplicateSet element, ip_address, KEY key [, KEYWORDS])
+
+  =s
+  OLSR specific element, signs OLSR messages or verifies and strips their signatures
+
+  =io
+  One input, one or two outputs
+
+  =d
+  Authenticates the OLSR control messages of a network whose nodes share
+  KEY: every message carries an olsr_auth_trailer, counted in its size, with
+  an HMAC-SHA1 digest truncated to 96 bits, computed with the HMAC and SHA1
+  code of the ipsec package. The digest covers the whole message but its
+  TTL and hop count, which forwarding changes, so a message keeps the
+  digest its originator gave it all the way through the network. Takes and
+  emits OLSR packets, starting with the packet header, and handles all the
+  messages of a packet in one pass.
+
+  With VERIFY false the element signs: it sits in front of OLSRAddPacketSeq,
+  after the generators and OLSRForward, and appends a trailer to every
+  message. A message from ip_address, the node's main address, gets a new
+  digest. A forwarded message gets the digest it was verified with when it
+  was received, from the OLSRDuplicateSet, so that the node never signs
+  what another node sent: a message that was not verified is dropped.
+
+  With VERIFY true the element sits in front of OLSRClassifier, checks the
+  digest of every message and takes the trailer off, so that the rest of
+  the node sees the messages as they were made. Messages whose digest is
+  wrong or whose key identifier is not KEY_ID are dropped. A message is
+  verified once: the digest is recorded in the duplicate set, and a copy
+  that arrives through another MPR with the same digest, once the message
+  has a duplicate tuple, is let through without the HMAC, as
+  OLSRClassifier only considers such copies for forwarding. A copy with a
+  replayed digest and another body can therefore at worst be forwarded in
+  place of the message, and is then dropped by the next node that has not
+  seen it. Messages of the node itself are not verified, as OLSRClassifier
+  discards them anyway.
+
+  A packet left without messages is emitted on output 1, if there is one,
+  and dropped otherwise.
+
+  The trailers make each message 16 bytes longer: the MTU of OLSRForward
+  and the generators needs to leave room for them. The packet headers, with
+  their sequence numbers, are not covered, and nothing keeps a message from
+  being replayed once its duplicate tuple is gone.
+  Messages with IPv6 addresses are not handled.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item KEY
+
+  String. The key shared by all nodes, 1 to 16 bytes; use \<...> for a hex
+  key. Required.
+
+  =item KEY_ID
+
+  Integer between 0 and 255. Identifies the key in the trailers; messages
+  signed with another key are dropped. Default is 0.
+
+  =item HOLD
+
+  Integer. How long, in msecs, the verdict on a message is kept if it does
+  not get a duplicate tuple. Default is 30000, the RFC 3626 DUP_HOLD_TIME.
+
+  =back
+
+  =h stats read-only
+  Messages signed, forwarded with the digest they were verified with,
+  dropped unsigned as they were not verified, verified, let through on a
+  cached verdict, dropped with a wrong digest, dropped with another key or
+  too short for a trailer, and of the node itself, one per line.
+
+  =e
+  sign::OLSRAuthenticate(false, duplicate_set, $my_ip0, KEY \<00112233445566778899aabbccddeeff>);
+  verify::OLSRAuthenticate(true, duplicate_set, $my_ip0, KEY \<00112233445566778899aabbccddeeff>);
+  output0 -> sign -> OLSRAddPacketSeq($my_ip0) -> ...
+  ... -> check_header -> verify -> olsrclassifier;
+
+  =a
+  OLSRDuplicateSet, OLSRClassifier, OLSRForward, IPsecAuthHMACSHA1 */
+
+#ifndef OLSR_AUTHENTICATE_HH
+#define OLSR_AUTHENTICATE_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include "elements/ipsec/hmac.hh"
+#include "click_olsr.hh"
+#include "olsr_duplicate_set.hh"
+
+CLICK_DECLS
+
+class OLSRAuthenticate : public Element { public:
+
+  OLSRAuthenticate();
+  ~OLSRAuthenticate();
+
+  const char *class_name() const	{ return "OLSRAuthenticate"; }
+  const char *port_count() const	{ return "1/1-2"; }
+  const char *processing() const	{ return PROCESSING_A_AH; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+
+private:
+
+  bool _verify;
+  OLSRDuplicateSet *_duplicateSet;
+  IPAddress _myMainIP;
+  uint8_t _key_id;
+  olsr_time_t _hold;
+  HMAC_CTX _ctx;		// inner and outer contexts set up for the key
+
+  uint32_t _signed;
+  uint32_t _relayed;
+  uint32_t _unverified;
+  uint32_t _verified;
+  uint32_t _cached;
+  uint32_t _failed;
+  uint32_t _bad_trailer;
+  uint32_t _own;
+
+  void digest(const uint8_t *msg, int size, uint8_t *md) const;
+  Packet *sign(Packet *);
+  Packet *verify(Packet *);
+
+  static String read_stats(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,544 @@
+/*
+ * olsr_benchmark.{cc,hh} -- times and checks the OLSR route and MPR
+ * computations on synthetic topologies
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "olsr_benchmark.hh"
+
+CLICK_DECLS
+
+OLSRBenchmark::OLSRBenchmark()
+{
+}
+
+
+OLSRBenchmark::~OLSRBenchmark()
+{
+}
+
+
+int
+OLSRBenchmark::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *neighbor_info, *link_info, *topology_info, *interface_info, *routing_table;
+  String topology = "grid";
+  _nodes = 100;
+  _degree = 6;
+  _mid = 0;
+  _iterations = 10;
+  _lookups = 4096;
+  _seed = 1;
+  _net = IPAddress(htonl(0x0A800000U));
+  _run = true;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRNeighborInfoBase element", &neighbor_info,
+		  cpElement, "OLSRLinkInfoBase element", &link_info,
+		  cpElement, "OLSRTopologyInfoBase element", &topology_info,
+		  cpElement, "OLSRInterfaceInfoBase element", &interface_info,
+		  cpElement, "OLSRRoutingTable element", &routing_table,
+		  cpIPAddress, "main IP address", &_myMainIP,
+		  cpKeywords,
+		  "TOPOLOGY", cpWord, "grid, geometric or scalefree", &topology,
+		  "NODES", cpInteger, "number of nodes", &_nodes,
+		  "DEGREE", cpInteger, "average number of neighbors", &_degree,
+		  "MID", cpInteger, "interface aliases per node", &_mid,
+		  "ITERATIONS", cpInteger, "computations of each kind", &_iterations,
+		  "LOOKUPS", cpInteger, "addresses per lookup timing", &_lookups,
+		  "SEED", cpUnsigned, "random seed", &_seed,
+		  "NET", cpIPAddress, "first synthetic address", &_net,
+		  "RUN", cpBool, "run at initialization", &_run,
+		  0) < 0)
+    return -1;
+
+  if (!(_neighborInfo = (OLSRNeighborInfoBase *) neighbor_info->cast("OLSRNeighborInfoBase")))
+    return errh->error("%s is not an OLSRNeighborInfoBase", neighbor_info->name().c_str());
+  if (!(_linkInfo = (OLSRLinkInfoBase *) link_info->cast("OLSRLinkInfoBase")))
+    return errh->error("%s is not an OLSRLinkInfoBase", link_info->name().c_str());
+  if (!(_topologyInfo = (OLSRTopologyInfoBase *) topology_info->cast("OLSRTopologyInfoBase")))
+    return errh->error("%s is not an OLSRTopologyInfoBase", topology_info->name().c_str());
+  if (!(_interfaceInfo = (OLSRInterfaceInfoBase *) interface_info->cast("OLSRInterfaceInfoBase")))
+    return errh->error("%s is not an OLSRInterfaceInfoBase", interface_info->name().c_str());
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("%s is not an OLSRRoutingTable", routing_table->name().c_str());
+
+  if (topology == "grid")
+    _topology = TOPOLOGY_GRID;
+  else if (topology == "geometric")
+    _topology = TOPOLOGY_GEOMETRIC;
+  else if (topology == "scalefree")
+    _topology = TOPOLOGY_SCALEFREE;
+  else
+    return errh->error("TOPOLOGY must be \"grid\", \"geometric\" or \"scalefree\"");
+  if (_nodes < 2 || _nodes > 65536)
+    return errh->error("NODES must be between 2 and 65536");
+  if (_degree < 1 || _degree >= _nodes)
+    return errh->error("DEGREE must be between 1 and NODES - 1");
+  if (_mid < 0 || _mid > 16)
+    return errh->error("MID must be between 0 and 16");
+  if (_iterations < 1)
+    return errh->error("ITERATIONS must be positive");
+  if (_lookups < 1)
+    return errh->error("LOOKUPS must be positive");
+  uint32_t net = ntohl(_net.addr()), main = ntohl(_myMainIP.addr());
+  if (main >= net && main - net <= (uint32_t) _nodes * (_mid + 1))
+    return errh->error("NET must not hold the main address");
+  return 0;
+}
+
+
+int
+OLSRBenchmark::initialize(ErrorHandler *errh)
+{
+  return _run ? run(errh) : 0;
+}
+
+
+IPAddress
+OLSRBenchmark::address(int node) const
+{
+  if (node == _self)
+    return _myMainIP;
+  return IPAddress(htonl(ntohl(_net.addr()) + node + 1));
+}
+
+
+IPAddress
+OLSRBenchmark::alias(int node, int k) const
+{
+  return IPAddress(htonl(ntohl(_net.addr()) + (k + 1) * _nodes + node + 1));
+}
+
+
+void
+OLSRBenchmark::generate_grid()
+{
+  int side = 1;
+  while (side * side < _nodes)
+    side++;
+  for (int i = 0; i < _nodes; i++) {
+    if (i % side + 1 < side && i + 1 < _nodes) {
+      _eu.push_back(i);
+      _ev.push_back(i + 1);
+    }
+    if (i + side < _nodes) {
+      _eu.push_back(i);
+      _ev.push_back(i + side);
+    }
+  }
+  _self = (side / 2) * side + side / 2;
+  if (_self >= _nodes)
+    _self = _nodes - 1;
+}
+
+
+void
+OLSRBenchmark::generate_geometric()
+{
+  //positions in a 65536 x 65536 square; pi r^2 N = DEGREE, pi ~ 22/7
+  Vector<int> x, y;
+  for (int i = 0; i < _nodes; i++) {
+    x.push_back(click_random() & 0xFFFF);
+    y.push_back(click_random() & 0xFFFF);
+  }
+  int64_t r2 = (int64_t) _degree * 65536 * 65536 * 7 / (22 * (int64_t) _nodes);
+  int64_t best = -1;
+  for (int i = 0; i < _nodes; i++) {
+    for (int j = i + 1; j < _nodes; j++) {
+      int64_t dx = x[i] - x[j], dy = y[i] - y[j];
+      if (dx * dx + dy * dy <= r2) {
+	_eu.push_back(i);
+	_ev.push_back(j);
+      }
+    }
+    int64_t dx = x[i] - 32768, dy = y[i] - 32768;
+    if (best < 0 || dx * dx + dy * dy < best) {
+      best = dx * dx + dy * dy;
+      _self = i;
+    }
+  }
+}
+
+
+void
+OLSRBenchmark::generate_scalefree()
+{
+  int m = _degree / 2;
+  if (m < 1)
+    m = 1;
+  //ends holds both nodes of every link, so a uniform pick from it chooses
+  //a node in proportion to its number of links
+  Vector<int> ends;
+  for (int i = 0; i <= m; i++)
+    for (int j = i + 1; j <= m; j++) {
+      _eu.push_back(i);
+      _ev.push_back(j);
+      ends.push_back(i);
+      ends.push_back(j);
+    }
+  Vector<int> targets;
+  for (int v = m + 1; v < _nodes; v++) {
+    targets.clear();
+    while (targets.size() < m) {
+      int t = ends[click_random() % ends.size()];
+      int i = 0;
+      while (i < targets.size() && targets[i] != t)
+	i++;
+      if (i == targets.size())
+	targets.push_back(t);
+    }
+    for (int i = 0; i < targets.size(); i++) {
+      _eu.push_back(v);
+      _ev.push_back(targets[i]);
+      ends.push_back(v);
+      ends.push_back(targets[i]);
+    }
+  }
+  _self = 0;
+}
+
+
+void
+OLSRBenchmark::build_adjacency()
+{
+  _first.assign(_nodes + 1, 0);
+  for (int i = 0; i < _eu.size(); i++) {
+    _first[_eu[i] + 1]++;
+    _first[_ev[i] + 1]++;
+  }
+  for (int n = 0; n < _nodes; n++)
+    _first[n + 1] += _first[n];
+  Vector<int> next(_first);
+  _adj.assign(2 * _eu.size(), 0);
+  for (int i = 0; i < _eu.size(); i++) {
+    _adj[next[_eu[i]]++] = _ev[i];
+    _adj[next[_ev[i]]++] = _eu[i];
+  }
+  _is_neighbor.assign(_nodes, 0);
+  for (int i = _first[_self]; i < _first[_self + 1]; i++)
+    _is_neighbor[_adj[i]] = 1;
+}
+
+
+/**
+ * adds the topology tuples of the link u -- v that a TC message from
+ * either end would leave, and returns their number
+ */
+int
+OLSRBenchmark::add_topology_tuples(int u, int v, olsr_time_t expiry)
+{
+  int added = 0;
+  for (int i = 0; i < 2; i++) {
+    int last = (i ? v : u), dest = (i ? u : v);
+    if (last == _self || dest == _self || _is_neighbor[dest])
+      continue;
+    if (_topologyInfo->add_tuple(address(dest), address(last), expiry, 0))
+      added++;
+  }
+  return added;
+}
+
+
+void
+OLSRBenchmark::fill(olsr_time_t expiry)
+{
+  for (int n = 0; n < _nodes; n++)
+    if (n != _self)
+      for (int k = 0; k < _mid; k++)
+	_interfaceInfo->add_interface(alias(n, k), address(n), expiry);
+
+  for (int i = _first[_self]; i < _first[_self + 1]; i++) {
+    int j = _adj[i];
+    link_data *link = _linkInfo->add_link(_myMainIP, address(j), expiry);
+    link->L_SYM_time = link->L_ASYM_time = expiry;
+    neighbor_data *neighbor = _neighborInfo->add_neighbor(address(j));
+    if (!neighbor)
+      neighbor = _neighborInfo->find_neighbor(address(j));
+    neighbor->N_status = OLSR_SYM_NEIGH;
+    neighbor->N_willingness = OLSR_WILL_DEFAULT;
+  }
+
+  for (int i = _first[_self]; i < _first[_self + 1]; i++) {
+    int j = _adj[i];
+    for (int l = _first[j]; l < _first[j + 1]; l++) {
+      int k = _adj[l];
+      if (k == _self)
+	continue;
+      _neighborInfo->add_twohop_neighbor(address(j), address(k), expiry);
+      _twohop_tuples++;
+      if (!_is_neighbor[k]) {
+	_twohop.push_back(j);
+	_twohop.push_back(k);
+      }
+    }
+  }
+
+  for (int e = 0; e < _eu.size(); e++) {
+    int u = _eu[e], v = _ev[e];
+    _topology_tuples += add_topology_tuples(u, v, expiry);
+    if (u != _self && v != _self && !_is_neighbor[u] && !_is_neighbor[v])
+      _remote.push_back(e);
+  }
+}
+
+
+/**
+ * removes everything fill() added and recomputes, leaving the router as
+ * it was
+ */
+void
+OLSRBenchmark::empty()
+{
+  for (int e = 0; e < _eu.size(); e++) {
+    _topologyInfo->remove_tuple(address(_ev[e]), address(_eu[e]));
+    _topologyInfo->remove_tuple(address(_eu[e]), address(_ev[e]));
+  }
+  for (int n = 0; n < _nodes; n++)
+    if (n != _self)
+      for (int k = 0; k < _mid; k++)
+	_interfaceInfo->remove_interface(alias(n, k));
+  for (int i = _first[_self]; i < _first[_self + 1]; i++) {
+    _linkInfo->remove_link(_myMainIP, address(_adj[i]));
+    _neighborInfo->remove_neighbor(address(_adj[i]));
+  }
+  _routingTable->compute_routing_table();
+  _neighborInfo->compute_mprset();
+}
+
+
+/**
+ * compares the installed routes with a breadth-first search of the
+ * synthetic topology, without the link cut_u -- cut_v if cut_u >= 0
+ */
+int
+OLSRBenchmark::check_routes(int cut_u, int cut_v, ErrorHandler *errh)
+{
+  Vector<int> dist(_nodes, -1);
+  Vector<int> queue;
+  dist[_self] = 0;
+  queue.push_back(_self);
+  for (int q = 0; q < queue.size(); q++) {
+    int u = queue[q];
+    for (int i = _first[u]; i < _first[u + 1]; i++) {
+      int v = _adj[i];
+      if (dist[v] >= 0 || (u == cut_u && v == cut_v) || (u == cut_v && v == cut_u))
+	continue;
+      dist[v] = dist[u] + 1;
+      queue.push_back(v);
+    }
+  }
+
+  for (int n = 0; n < _nodes; n++) {
+    if (n == _self)
+      continue;
+    for (int k = -1; k < _mid; k++) {
+      IPAddress addr = (k < 0 ? address(n) : alias(n, k));
+      int d = _routingTable->route_distance(addr);
+      if (d != dist[n])
+	return errh->error("%s: route to %s has %d hops, expected %d", name().c_str(), addr.unparse().c_str(), d, dist[n]);
+    }
+  }
+  return 0;
+}
+
+
+/**
+ * checks that the MPRs cover every strict 2-hop neighbor in the 2-hop set
+ */
+int
+OLSRBenchmark::check_mprs(ErrorHandler *errh)
+{
+  OLSRNeighborInfoBase::TwoHopSet *twohop_set = _neighborInfo->get_twohop_set();
+  HashMap<IPAddress, IPAddress> covered;
+  for (OLSRNeighborInfoBase::TwoHopSet::iterator iter = twohop_set->begin(); iter != twohop_set->end(); iter++)
+    if (_neighborInfo->find_mpr(iter.value().N_neigh_main_addr))
+      covered.insert(iter.value().N_twohop_addr, iter.value().N_neigh_main_addr);
+  for (OLSRNeighborInfoBase::TwoHopSet::iterator iter = twohop_set->begin(); iter != twohop_set->end(); iter++) {
+    IPAddress twohop = iter.value().N_twohop_addr;
+    if (twohop != _myMainIP && !_neighborInfo->find_neighbor(twohop) && !covered.findp(twohop))
+      return errh->error("%s: 2-hop neighbor %s is not covered by an MPR", name().c_str(), twohop.unparse().c_str());
+  }
+  return 0;
+}
+
+
+int
+OLSRBenchmark::run(ErrorHandler *errh)
+{
+  if (!_linkInfo->get_link_set()->empty() || !_neighborInfo->get_neighbor_set()->empty()
+      || !_topologyInfo->get_topology_set()->empty())
+    return errh->error("%s: the information bases are not empty", name().c_str());
+
+  for (int i = 0; i < NPHASES; i++)
+    _profile[i].clear();
+  _lookup_time[0] = _lookup_time[1] = Timestamp();
+  _eu.clear();
+  _ev.clear();
+  _remote.clear();
+  _twohop.clear();
+  _twohop_tuples = _topology_tuples = 0;
+
+  click_srandom(_seed);
+  switch (_topology) {
+  case TOPOLOGY_GRID:
+    generate_grid();
+    break;
+  case TOPOLOGY_GEOMETRIC:
+    generate_geometric();
+    break;
+  default:
+    generate_scalefree();
+    break;
+  }
+  build_adjacency();
+
+  olsr_time_t expiry = olsr_now() + olsr_msec(86400000);
+  click_cycles_t start = click_get_cycles();
+  fill(expiry);
+  _profile[PHASE_FILL].add(click_get_cycles() - start);
+
+  for (int i = 0; i < _iterations; i++) {
+    start = click_get_cycles();
+    _routingTable->compute_routing_table();
+    _profile[PHASE_ROUTES_FULL].add(click_get_cycles() - start);
+    start = click_get_cycles();
+    _neighborInfo->compute_mprset();
+    _profile[PHASE_MPR_FULL].add(click_get_cycles() - start);
+  }
+  int r = check_routes(-1, -1, errh);
+  if (r >= 0)
+    r = check_mprs(errh);
+  if (r >= 0)
+    r = time_lookups(errh);
+
+  for (int i = 0; i < _iterations && r >= 0 && _remote.size(); i++) {
+    int e = _remote[click_random() % _remote.size()];
+    int u = _eu[e], v = _ev[e];
+    _topologyInfo->remove_tuple(address(v), address(u));
+    _topologyInfo->remove_tuple(address(u), address(v));
+    start = click_get_cycles();
+    _routingTable->update_routing_table();
+    _profile[PHASE_ROUTES_TC].add(click_get_cycles() - start);
+    if ((r = check_routes(u, v, errh)) < 0)
+      break;
+    add_topology_tuples(u, v, expiry);
+    start = click_get_cycles();
+    _routingTable->update_routing_table();
+    _profile[PHASE_ROUTES_TC].add(click_get_cycles() - start);
+    r = check_routes(-1, -1, errh);
+  }
+
+  for (int i = 0; i < _iterations && r >= 0 && _twohop.size(); i++) {
+    int p = click_random() % (_twohop.size() / 2);
+    IPAddress neighbor = address(_twohop[2 * p]), twohop = address(_twohop[2 * p + 1]);
+    _neighborInfo->remove_twohop_neighbor(neighbor, twohop);
+    start = click_get_cycles();
+    _neighborInfo->compute_mprset();
+    _profile[PHASE_MPR_TWOHOP].add(click_get_cycles() - start);
+    if ((r = check_mprs(errh)) < 0)
+      break;
+    _neighborInfo->add_twohop_neighbor(neighbor, twohop, expiry);
+    start = click_get_cycles();
+    _neighborInfo->compute_mprset();
+    _profile[PHASE_MPR_TWOHOP].add(click_get_cycles() - start);
+    r = check_mprs(errh);
+  }
+
+  static const char * const topologies[] = { "grid", "geometric", "scalefree" };
+  static const char * const phases[NPHASES] = {
+    "fill", "routes_full", "mpr_full", "routes_tc", "mpr_twohop",
+    "lookup", "lookup_batch"
+  };
+  StringAccum sa;
+  sa << "topology " << topologies[_topology] << " nodes " << _nodes
+     << " links " << _eu.size() << " neighbors " << (_first[_self + 1] - _first[_self])
+     << " twohop_tuples " << _twohop_tuples << " topology_tuples " << _topology_tuples
+     << " aliases " << (_nodes - 1) * _mid << "\n";
+  for (int i = 0; i < NPHASES; i++)
+    _profile[i].unparse(sa, phases[i]);
+  sa << "lookups_per_sec";
+  for (int i = 0; i < 2; i++) {
+    double t = _lookup_time[i].doubleval();
+    sa << ' ' << phases[PHASE_LOOKUP + i] << ' '
+       << (t > 0 ? (uint64_t) (_profile[PHASE_LOOKUP + i].count * (double) _lookups / t) : 0);
+  }
+  sa << '\n';
+  _results = sa.take_string();
+
+  empty();
+  if (r >= 0)
+    errh->message("%s: %d nodes, all checks pass", name().c_str(), _nodes);
+  return r;
+}
+
+
+/**
+ * times the lookups of LOOKUPS random node addresses in the routing table's
+ * lookup element, one at a time and batched, and checks that they agree
+ */
+int
+OLSRBenchmark::time_lookups(ErrorHandler *errh)
+{
+  IPRouteTable *table = _routingTable->route_table();
+  Vector<IPAddress> addrs, gws(_lookups, IPAddress()), batch_gws(_lookups, IPAddress());
+  Vector<int> ports(_lookups, -1), batch_ports(_lookups, -1);
+  for (int i = 0; i < _lookups; i++)
+    addrs.push_back(address(click_random() % _nodes));
+
+  for (int it = 0; it < _iterations; it++) {
+    Timestamp t0 = Timestamp::now();
+    click_cycles_t start = click_get_cycles();
+    for (int i = 0; i < _lookups; i++)
+      ports[i] = table->lookup_route(addrs[i], gws[i]);
+    _profile[PHASE_LOOKUP].add(click_get_cycles() - start);
+    Timestamp t1 = Timestamp::now();
+    start = click_get_cycles();
+    table->lookup_routes(addrs.begin(), _lookups, batch_ports.begin(), batch_gws.begin());
+    _profile[PHASE_LOOKUP_BATCH].add(click_get_cycles() - start);
+    _lookup_time[1] += Timestamp::now() - t1;
+    _lookup_time[0] += t1 - t0;
+  }
+
+  for (int i = 0; i < _lookups; i++)
+    if (batch_ports[i] != ports[i] || (ports[i] >= 0 && batch_gws[i] != gws[i]))
+      return errh->error("%s: batched lookup of %s gives port %d gateway %s, not port %d gateway %s",
+			 name().c_str(), addrs[i].unparse().c_str(), batch_ports[i],
+			 batch_gws[i].unparse().c_str(), ports[i], gws[i].unparse().c_str());
+  return 0;
+}
+
+
+String
+OLSRBenchmark::read_results(Element *e, void *)
+{
+  OLSRBenchmark *b = (OLSRBenchmark *) e;
+  return b->_results;
+}
+
+
+int
+OLSRBenchmark::run_handler(const String &, Element *e, void *, ErrorHandler *errh)
+{
+  OLSRBenchmark *b = (OLSRBenchmark *) e;
+  return b->run(errh);
+}
+
+
+void
+OLSRBenchmark::add_handlers()
+{
+  add_read_handler("results", read_results, (void *) 0);
+  add_write_handler("run", run_handler, (void *) 0);
+}
+
+#include <click/vector.cc>
+#include <click/bighashmap.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class HashMap<IPAddress, IPAddress>;
+#endif
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRBenchmark);
@@ -0,0 +1,237 @@
+/*
+  =c
+  OLSRBenchmark(OLSRNeighborInfoBase element, OLSRLinkInfoBase element, OLSRTopologyInfoBase element, OLSRInterfaceInfoBase element, OLSRRoutingTable element, IPAddress [, KEYWORDS])
+
+  =s
+  OLSR specific element, benchmarks and checks the route and MPR computations
+
+  =io
+  None
+
+  =d
+  Fills the information bases given as arguments with a synthetic topology
+  in which this node, whose main address is the IP address argument, is one
+  of NODES nodes, and times the computations of the OLSRRoutingTable and
+  OLSRNeighborInfoBase elements on it:
+
+  =over 8
+
+  =item fill
+
+  Entering the topology: links and neighbor tuples of this node's
+  neighbors, their 2-hop tuples, topology tuples for every link between two
+  other nodes (the ones reaching a neighbor left out, as OLSRProcessTC
+  does) and MID aliases.
+
+  =item routes_full, mpr_full
+
+  ITERATIONS full computations of the routes and of the MPR set.
+
+  =item routes_tc
+
+  Topology changes: ITERATIONS times, the tuples of a random link between
+  two nodes outside the 1-hop neighborhood are removed, the routing table
+  updated, the tuples added back and the routing table updated again.
+
+  =item mpr_twohop
+
+  2-hop changes: ITERATIONS times, a random 2-hop tuple is removed, the
+  MPR set recomputed, the tuple added back and the MPR set recomputed.
+
+  =item lookup, lookup_batch
+
+  Route lookups in the lookup element of the OLSRRoutingTable, with all
+  routes installed: ITERATIONS times, the addresses of LOOKUPS random nodes
+  are looked up one lookup_route() call each, then all in one
+  lookup_routes() call, the batched entry point of IPRouteTable that
+  push_batch() uses. Each timing is of the LOOKUPS lookups, and the
+  batched lookups must give the same routes.
+
+  =back
+
+  After each computation the results are checked against a reference: the
+  hop count of the installed route to every node and alias must be the one
+  a breadth-first search of the synthetic topology finds, nodes it cannot
+  reach must have no route, and the MPRs must cover every strict 2-hop
+  neighbor. A failed check is reported as an error, which at
+  initialization makes the router fail, so the element doubles as a
+  regression test for the incremental engines. The information bases are
+  emptied again afterwards and both computations rerun.
+
+  The information bases must be empty: use a configuration whose
+  interfaces receive nothing, such as one made by make-olsr-config.pl with
+  its input replaced by Idle. Synthetic addresses are taken from NET, which
+  must not hold the main address. The link and neighbor information bases
+  print a line for each neighbor added and removed.
+
+  The timings use OLSRPhaseProfile, and include the writes to the lookup
+  element and the listeners of the routing table. Compare them with the
+  C<profile> handler of OLSRRoutingTable and the C<mpr_profile> handler of
+  OLSRNeighborInfoBase, which break them down by phase.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item TOPOLOGY
+
+  Word. C<grid>: the nodes on a square grid, linked to the four nodes next
+  to them, this node in the middle. C<geometric>: the nodes at random
+  positions in a unit square, linked to those within the distance that
+  gives an average of DEGREE neighbors, this node the one closest to the
+  center. C<scalefree>: a Barabasi-Albert graph in which each new node
+  links to DEGREE/2 nodes chosen in proportion to their number of links,
+  this node the first one and so a hub. Default is C<grid>.
+
+  =item NODES
+
+  Integer. Number of nodes, from 2 to 65536. Default is 100.
+
+  =item DEGREE
+
+  Integer. Average number of neighbors of the C<geometric> and
+  C<scalefree> topologies. Default is 6.
+
+  =item MID
+
+  Integer. Number of additional interface addresses advertised for every
+  other node, from 0 to 16. Default is 0.
+
+  =item ITERATIONS
+
+  Integer. Number of computations or changes of each kind. Default is 10.
+
+  =item LOOKUPS
+
+  Integer. Number of addresses of each lookup timing. Default is 4096.
+
+  =item SEED
+
+  Unsigned. Seeds click_random() before the topology is generated, so a
+  benchmark can be repeated exactly. Default is 1.
+
+  =item NET
+
+  IP address. First of the synthetic addresses. Default is 10.128.0.0.
+
+  =item RUN
+
+  Boolean. Runs the benchmark at initialization. Default is true.
+
+  =back
+
+  =h results read-only
+  The topology of the last run (nodes, links, this node's neighbors, 2-hop
+  tuples, topology tuples and aliases entered), then one line per timing
+  above, formatted as in the C<profile> handler of OLSRRoutingTable, and a
+  last line with the lookups per second of the two lookup timings.
+
+  =h run write-only
+  Runs the benchmark again.
+
+  =e
+  Default OLSR configuration of one node, with
+
+    bench::OLSRBenchmark(neighbor_info, link_info, topology_info,
+                         interface_info, routing_table, $my_ip0,
+                         TOPOLOGY scalefree, NODES 2000, DEGREE 8);
+
+  added to the compound element.
+
+  =a
+  OLSRRoutingTable, OLSRNeighborInfoBase, OLSRTopologyInfoBase,
+  HeapTest, BigHashMapTest */
+
+#ifndef OLSR_BENCHMARK_HH
+#define OLSR_BENCHMARK_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+#include <click/timestamp.hh>
+#include "olsr_neighbor_infobase.hh"
+#include "olsr_link_infobase.hh"
+#include "olsr_topology_infobase.hh"
+#include "olsr_interface_infobase.hh"
+#include "olsr_rtable.hh"
+#include "olsr_profile.hh"
+
+CLICK_DECLS
+
+class OLSRBenchmark : public Element { public:
+
+  OLSRBenchmark();
+  ~OLSRBenchmark();
+
+  const char *class_name() const	{ return "OLSRBenchmark"; }
+  OLSRBenchmark *clone() const		{ return new OLSRBenchmark; }
+  const char *port_count() const	{ return "0/0"; }
+  int configure_phase() const		{ return CONFIGURE_PHASE_LAST; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  int run(ErrorHandler *errh);
+
+private:
+
+  enum { TOPOLOGY_GRID, TOPOLOGY_GEOMETRIC, TOPOLOGY_SCALEFREE };
+  enum { PHASE_FILL, PHASE_ROUTES_FULL, PHASE_MPR_FULL, PHASE_ROUTES_TC,
+	 PHASE_MPR_TWOHOP, PHASE_LOOKUP, PHASE_LOOKUP_BATCH, NPHASES };
+
+  OLSRNeighborInfoBase *_neighborInfo;
+  OLSRLinkInfoBase *_linkInfo;
+  OLSRTopologyInfoBase *_topologyInfo;
+  OLSRInterfaceInfoBase *_interfaceInfo;
+  OLSRRoutingTable *_routingTable;
+  IPAddress _myMainIP;
+
+  int _topology;
+  int _nodes;
+  int _degree;
+  int _mid;
+  int _iterations;
+  int _lookups;
+  uint32_t _seed;
+  IPAddress _net;
+  bool _run;
+
+  // the synthetic topology: links _eu[i] -- _ev[i], and the neighbors of
+  // node n in _adj[_first[n]] .. _adj[_first[n + 1] - 1]
+  Vector<int> _eu;
+  Vector<int> _ev;
+  Vector<int> _first;
+  Vector<int> _adj;
+  Vector<int> _is_neighbor;
+  int _self;
+
+  Vector<int> _remote;		// links between nodes outside the 1-hop neighborhood
+  Vector<int> _twohop;		// neighbor, strict 2-hop neighbor pairs
+  int _twohop_tuples;
+  int _topology_tuples;
+
+  OLSRPhaseProfile _profile[NPHASES];
+  Timestamp _lookup_time[2];	// of the lookup and lookup_batch timings
+  String _results;
+
+  IPAddress address(int node) const;
+  IPAddress alias(int node, int k) const;
+  void generate_grid();
+  void generate_geometric();
+  void generate_scalefree();
+  void build_adjacency();
+  void fill(olsr_time_t expiry);
+  void empty();
+  int add_topology_tuples(int u, int v, olsr_time_t expiry);
+  int check_routes(int cut_u, int cut_v, ErrorHandler *errh);
+  int check_mprs(ErrorHandler *errh);
+  int time_lookups(ErrorHandler *errh);
+
+  static String read_results(Element *, void *);
+  static int run_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
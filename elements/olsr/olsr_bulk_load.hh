@@ -0,0 +1,58 @@
+#ifndef OLSR_BULK_LOAD_HH
+#define OLSR_BULK_LOAD_HH
+
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/confparse.hh>
+#include <click/glue.hh>
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+// The "load" write handlers of the information bases take one tuple per
+// line, its fields separated by spaces. The tuples are added between
+// begin_bulk() and commit_bulk(), so the expiry heap is built and the
+// routes and MPR set are computed once for the whole text instead of once
+// per tuple. The text may be given as one quoted string, as from a Script.
+class OLSRBulkLoader { public:
+
+  OLSRBulkLoader(const String &text)
+    : _text(cp_unquote(text)), _pos(0), _line(0), _now(olsr_now()) {
+  }
+
+  // the words of the next line that has any; false at the end of the text
+  bool next(Vector<String> &words) {
+    words.clear();
+    while (words.empty() && _pos < _text.length()) {
+      int nl = _text.find_left('\n', _pos);
+      if (nl < 0)
+	nl = _text.length();
+      cp_spacevec(_text.substring(_pos, nl - _pos), words);
+      _pos = nl + 1;
+      _line++;
+    }
+    return !words.empty();
+  }
+
+  int line() const			{ return _line; }
+
+  // expiry time of a tuple valid for the number of milliseconds in word
+  bool parse_validity(const String &word, olsr_time_t &time) const {
+    uint32_t msecs;
+    if (!cp_unsigned(word, &msecs))
+      return false;
+    time = _now + olsr_msec(msecs);
+    return true;
+  }
+
+private:
+
+  String _text;
+  int _pos;
+  int _line;
+  olsr_time_t _now;
+
+};
+
+CLICK_ENDDECLS
+#endif
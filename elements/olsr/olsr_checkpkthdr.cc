@@ -10,6 +10,7 @@ CLICK_DECLS
 
 
 OLSRCheckPacketHeader::OLSRCheckPacketHeader()
+  : _length_drops(0), _seq_drops(0)
 {
 }
 
@@ -38,40 +39,18 @@ OLSRCheckPacketHeader::push(int, Packet *packet)
 
   if (pkt_length_too_short(pkt_info.pkt_length)) {
     //discard if packet length is less than a packet hdr + message hdr
-    click_chatter("Dropping packet, pkt_length too short");
+    _length_drops++;
     output(1).push(packet); 
     return;
   }
-  else if ( pkt_seq_old(source_addr, pkt_info.pkt_seq) ){ 
-    click_chatter("Dropping packet, pkt seq old");
+  else if ( _duplicateSet->packet_seq_old(source_addr, pkt_info.pkt_seq) ){ 
+    _seq_drops++;
     output(1).push(packet); //discard if packet sequence number is old
     return;
   }
   output(0).push(packet);
 }
 
-
-bool
-OLSRCheckPacketHeader::pkt_seq_old(IPAddress source_addr, int pkt_seq)
-{
-  int prev_pkt_seq = 0;
-  prev_pkt_seq = _duplicateSet->find_packet_seq(source_addr);
- 
-  if (prev_pkt_seq == 0){
-    _duplicateSet->add_packet_seq(source_addr, pkt_seq);
-    return false;
-  }
-  else{
-    // check if new pkt seq is bigger than that allready stored according to RFC ch 19
-    if (   ( pkt_seq > prev_pkt_seq && (pkt_seq - prev_pkt_seq) <= (OLSR_MAX_SEQNUM/2) )
-	   ||  ( prev_pkt_seq > pkt_seq && (prev_pkt_seq - pkt_seq) > (OLSR_MAX_SEQNUM/2) )   ){    
-      _duplicateSet->update_packet_seq(source_addr, pkt_seq);
-      return false;
-    }
-  }
-  return true;
-}
-
 bool 
 OLSRCheckPacketHeader::pkt_length_too_short(int pkt_length)
 {
@@ -82,6 +61,12 @@ OLSRCheckPacketHeader::pkt_length_too_short(int pkt_length)
 }
 
 
+void
+OLSRCheckPacketHeader::add_handlers()
+{
+  add_data_handlers("length_drops", Handler::OP_READ, &_length_drops);
+  add_data_handlers("seq_drops", Handler::OP_READ, &_seq_drops);
+}
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(OLSRCheckPacketHeader);
@@ -16,6 +16,12 @@
   =d
   Takes OLSR packet on its input. Packets must have their source address in the destination address annotation. Checks that the packets' length is greater than 15 (the size of an olsr packet header + an olsr message header) The packet's sequence number is then checked against the OLSRDuplicateSet given as argument.
 
+  =h length_drops read-only
+  Number of packets emitted on output 1 for being too short.
+
+  =h seq_drops read-only
+  Number of packets emitted on output 1 for being received out of order.
+
   =a
   OLSRClassifier
 
@@ -39,12 +45,14 @@ public:
   OLSRCheckPacketHeader *clone() const { return new OLSRCheckPacketHeader(); }
   const char *port_count() const  { return "1/2"; }
   int configure(Vector<String> &conf, ErrorHandler *errh);
+  void add_handlers();
   void push(int, Packet *packet);
 
 private:
   OLSRDuplicateSet *_duplicateSet;
+  unsigned _length_drops;
+  unsigned _seq_drops;
 
-  bool pkt_seq_old(IPAddress source_addr, int pkt_seq);
   bool pkt_length_too_short(int pkt_length);
 };
 
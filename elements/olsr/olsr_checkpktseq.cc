@@ -10,6 +10,7 @@ CLICK_DECLS
 
 
 OLSRCheckPacketSeq::OLSRCheckPacketSeq()
+  : _drops(0)
 {
 }
 
@@ -36,8 +37,8 @@ OLSRCheckPacketSeq::push(int, Packet *packet)
   pkt_hdr_info pkt_info = OLSRPacketHandle::get_pkt_hdr_info(packet);
   IPAddress source_addr = packet->dst_ip_anno();
 
-  if ( pkt_seq_old(source_addr, pkt_info.pkt_seq) ){ 
-    click_chatter("Dropping packet, pkt seq old");
+  if ( _duplicateSet->packet_seq_old(source_addr, pkt_info.pkt_seq) ){ 
+    _drops++;
     output(1).push(packet); //discard if packet sequence number is old
     return;
   }
@@ -45,25 +46,10 @@ OLSRCheckPacketSeq::push(int, Packet *packet)
 }
 
 
-bool
-OLSRCheckPacketSeq::pkt_seq_old(IPAddress source_addr, int pkt_seq)
+void
+OLSRCheckPacketSeq::add_handlers()
 {
-  int prev_pkt_seq = 0;
-  prev_pkt_seq = _duplicateSet->find_packet_seq(source_addr);
- 
-  if (prev_pkt_seq == 0){
-    _duplicateSet->add_packet_seq(source_addr, pkt_seq);
-    return false;
-  }
-  else{
-    // check if new pkt seq is bigger than that allready stored according to RFC ch 19
-    if (   ( pkt_seq > prev_pkt_seq && (pkt_seq - prev_pkt_seq) <= (OLSR_MAX_SEQNUM/2) )
-	   ||  ( prev_pkt_seq > pkt_seq && (prev_pkt_seq - pkt_seq) > (OLSR_MAX_SEQNUM/2) )   ){    
-      _duplicateSet->update_packet_seq(source_addr, pkt_seq);
-      return false;
-    }
-  }
-  return true;
+  add_data_handlers("drops", Handler::OP_READ, &_drops);
 }
 
 CLICK_ENDDECLS
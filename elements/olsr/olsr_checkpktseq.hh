@@ -16,6 +16,9 @@
   =d
   Takes OLSR packet on its input. Packets must have their source address in the destination address annotation. The packet's sequence number is then checked in the OLSRDuplicateSet given as argument.
 
+  =h drops read-only
+  Number of packets emitted on output 1.
+
   =a
   OLSRCheckPacketLength, OLSRClassifier
 */
@@ -39,12 +42,12 @@ public:
   const char *port_count() const  { return "1/2"; }
 
   int configure(Vector<String> &conf, ErrorHandler *errh);
+  void add_handlers();
   void push(int, Packet *packet);
 
 private:
   OLSRDuplicateSet *_duplicateSet;
-
-  bool pkt_seq_old(IPAddress source_addr, int pkt_seq);
+  unsigned _drops;
 };
 
 CLICK_ENDDECLS
@@ -49,88 +49,188 @@ OLSRClassifier::initialize(ErrorHandler *)
 // 5 - Other
 
 
+//messages are collected in runs for the same output and passed on with one
+//push_batch(). Processing or forwarding a message adds it to the duplicate
+//set, which decides where a later copy of it goes: a message whose
+//originator and sequence number are in the pending run waits until the run
+//has been pushed. Output 0 only discards, so its runs are not searched
+void
+OLSRClassifier::flush(PacketBatch &run, int run_port)
+{
+  if (!run.empty())
+    output(run_port).push_batch(run);
+}
+
+
+inline void
+OLSRClassifier::emit(int port, Packet *p, PacketBatch &run, int &run_port)
+{
+  if (port != run_port){
+    flush(run, run_port);
+    run_port = port;
+  }
+  run.push_back(p);
+}
+
+
+bool
+OLSRClassifier::in_run(const PacketBatch &run, IPAddress originator, int seq)
+{
+  for (Packet *p = run.front(); p; p = p->next()){
+    OLSRMessageView msg(p, 0);
+    if (msg.seq() == seq && msg.originator() == originator)
+      return true;
+  }
+  return false;
+}
+
+
 void
 OLSRClassifier::push(int, Packet *packet)
 {
-  pkt_hdr_info pkt_info = OLSRPacketHandle::get_pkt_hdr_info(packet);
-  msg_hdr_info msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, sizeof(olsr_pkt_hdr));
+  PacketBatch run;
+  int run_port = -1;
+  classify(packet, run, run_port);
+  flush(run, run_port);
+}
+
+
+void
+OLSRClassifier::push_batch(int, PacketBatch &batch)
+{
+  PacketBatch run;
+  int run_port = -1;
+  while (Packet *packet = batch.pop_front())
+    classify(packet, run, run_port);
+  flush(run, run_port);
+}
+
+
+void
+OLSRClassifier::classify(Packet *packet, PacketBatch &run, int &run_port)
+{
 #ifdef debug
   click_chatter ("\nsoy el node con IP %s \t OLSR_Classifier\n",_myMainIP.unparse().cc() );
 #endif
-  //  click_chatter("\nReceived message:\nmsg_type: %d, originator: %s, seq_num: %d \n", msg_info.msg_type, msg_info.originator_address.unparse().cc(), msg_info.msg_seq);
-  //click_chatter("pkt_length: %d, msg_size: %d\n", pkt_info.pkt_length, msg_info.msg_size); 
-  int extra_message = pkt_info.pkt_length - msg_info.msg_size - sizeof(olsr_pkt_hdr);
-  packet->pull(sizeof(olsr_pkt_hdr));
- 
-  do{
-    Packet *p = packet->clone();  
-
-    if (msg_info.ttl <= 0 ){
-//     click_chatter("Discarding message, ttl == 0");
-      output(0).push(p); //discard messages with ttl = 0
+  if (packet->length() < sizeof(olsr_pkt_hdr)){
+    emit(0, packet, run, run_port); //runt packet
+    return;
+  }
+  //cycles spent here, not counting the elements the messages are pushed to
+  click_cycles_t cycles = 0, start = click_get_cycles();
+  pkt_hdr_info pkt_info = OLSRPacketHandle::get_pkt_hdr_info(packet);
+  int paint=static_cast<int>(PAINT_ANNO(packet));//packets get marked with paint 0..N depending on Interface they arrive on
+  OLSRLocalIfInfoBase::Interface *iface = _localIfInfoBase->get_iface(paint);
+  IPAddress receiving_ip = iface ? iface->addr : IPAddress(); //IP of Interface N
+
+  //only the bytes covered by pkt_length are looked at; each message goes out
+  //as a clone (which shares the packet data) trimmed to that one message, and
+  //its header is read in place through an OLSRMessageView. The last message
+  //takes the received packet itself, so a packet holding a single message
+  //is not cloned at all. What the duplicate set says about a message goes
+  //with it in OLSR_DUPLICATE_ANNO, so OLSRForward need not look again
+  int offset = sizeof(olsr_pkt_hdr);
+  int end = pkt_info.pkt_length;
+  if (end > (int)packet->length())
+    end = packet->length();
+
+  while (end - offset >= (int)sizeof(olsr_msg_hdr)){
+    OLSRMessageView msg(packet, offset);
+    int msg_size = msg.size();
+    if (msg_size < (int)sizeof(olsr_msg_hdr) || msg_size > end - offset)
+      break; //malformed message, the rest of the packet cannot be trusted
+
+    bool last = end - offset - msg_size < (int)sizeof(olsr_msg_hdr);
+    Packet *p = last ? packet : packet->clone();
+    if (!p)
+      break;
+    p->pull(offset);
+    p->take(p->length() - msg_size);
+    offset += msg_size;
+
+    int msg_type = msg.type();
+    int port;
+    int dup = OLSR_DUP_UNKNOWN;
+    duplicate_data *duplicate = 0;
+    _stats.count(OLSRMessageStats::RECEIVED, paint, msg_type, msg_size);
+    if (iface)
+      iface->received++;
+    if (run_port > 0 && in_run(run, msg.originator(), msg.seq())){
+      cycles += click_get_cycles() - start;
+      flush(run, run_port);
+      start = click_get_cycles();
+    }
+
+    if (msg.ttl() <= 0 ){
+      port = 0; //discard messages with ttl = 0
+      _stats.count(OLSRMessageStats::DISCARDED, paint, msg_type, msg_size);
     }
-    else if ( msg_info.originator_address == _myMainIP ){
-//      click_chatter("Discarding message sent by me (%s)", _myMainIP.unparse().cc() );
-      output(0).push(p); //discard messages from self
+    else if ( msg.originator() == _myMainIP ){
+      port = 0; //discard messages from self
+      _stats.count(OLSRMessageStats::DISCARDED, paint, msg_type, msg_size);
     }
     else{
-      duplicate_data *duplicate = _duplicateSet->find_duplicate_entry(msg_info.originator_address, msg_info.msg_seq);
+      duplicate = _duplicateSet->find_duplicate_entry(msg.originator(), msg.seq());
+      dup = OLSR_DUP_LOOKED_UP;
       if ( duplicate != 0 ){
 	bool considered_for_forward = false;
-	int paint=static_cast<int>(PAINT_ANNO(packet));//packets get marked with paint 0..N depending on Interface they arrive on
-  IPAddress receiving_ip=_localIfInfoBase->get_iface_addr(paint); //gets IP of Interface N
-	
-	for ( int i = 0; i < duplicate->D_iface_list.size(); i++ ){
-	  IPAddress iface_addr = duplicate->D_iface_list.at(i);
-	  if ( receiving_ip == iface_addr ) 
+	for ( int i = 0; i < duplicate->D_iface_list.size(); i++ )
+	  if ( receiving_ip == duplicate->D_iface_list.at(i) ){
 	    considered_for_forward = true;
-	}
+	    break;
+	  }
 	if ( considered_for_forward ){
-// 	  click_chatter ("OLSRCLASSIFIER (node %s): DROPPING message from %s (org_add) received on interface %s \n",_myMainIP.unparse().cc(), msg_info.originator_address.unparse().cc(), receiving_ip.unparse().cc());
-// 	  click_chatter("Discarding message, already considered for forward"); 
-	  output(0).push(p); //discard messages already considered for forward
+	  port = 0; //discard messages already considered for forward
+	  _stats.count(OLSRMessageStats::DUPLICATE, paint, msg_type, msg_size);
 	}
 	else
-	  output(5).push(p); //consider message for forward without processing
+	  port = 5; //consider message for forward without processing
       }
       else{ //process message
-	//	click_chatter("extra_message: %d, msg_info.msg_size: %d\n", extra_message, msg_info.msg_size);
-	if (extra_message >= (int)sizeof(olsr_msg_hdr)){
-	  p->take(extra_message);
-	}
-	switch(msg_info.msg_type){
+	switch(msg_type){
 	case OLSR_HELLO_MESSAGE:
-	  output(1).push(p);
+	case OLSR_LQ_HELLO_MESSAGE:
+	case OLSR_COMPACT_HELLO_MESSAGE:
+	  port = 1;
 	  break;
 	case OLSR_TC_MESSAGE:
-	  output(2).push(p);
+	case OLSR_LQ_TC_MESSAGE:
+	case OLSR_COMPACT_TC_MESSAGE:
+	  port = 2;
 	  break;
 	case OLSR_MID_MESSAGE:
-	  output(3).push(p);
+	  port = 3;
 	  break;
 	case OLSR_HNA_MESSAGE:
-	  output(4).push(p);
+	case OLSR_GATEWAY_LOAD_MESSAGE:
+	  port = 4;
 	  break;
 	default:
-	  output(5).push(p); //not a known message type, consider for forward anyway
+	  port = 5; //not a known message type, consider for forward anyway
 	}
       }
     }
-
-    int offset = msg_info.msg_size;
-
-    //remove message just considered from packet
-    if (extra_message >= (int)sizeof(olsr_msg_hdr)){
-      msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, offset);
-      packet->pull( offset );
-      extra_message = extra_message - msg_info.msg_size;
+    SET_OLSR_DUPLICATE_ANNO(p, dup);
+    SET_OLSR_DUPLICATE_GEN_ANNO(p, _duplicateSet->generation());
+    SET_OLSR_DUPLICATE_TUPLE_ANNO(p, duplicate);
+    cycles += click_get_cycles() - start;
+    emit(port, p, run, run_port);
+    if (last){
+      _stats.cycles.add(cycles);
+      return;
     }
-    else
-      extra_message = -1;
-
-  }while ( extra_message >= 0 );  //there is more than one message in packet
+    start = click_get_cycles();
+  }
   
   packet->kill(); //all messages considered, kill original packet
+  _stats.cycles.add(cycles + click_get_cycles() - start);
+}
+
+
+void
+OLSRClassifier::add_handlers()
+{
+  _stats.add_handlers(this);
 }
 
 
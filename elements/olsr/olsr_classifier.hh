@@ -6,6 +6,7 @@
 #include "click_olsr.hh"
 #include "olsr_duplicate_set.hh"
 #include "olsr_local_if_infobase.hh"
+#include "olsr_msg_stats.hh"
 
 CLICK_DECLS
 /* =c
@@ -27,15 +28,24 @@ CLICK_DECLS
  * One input, five outputs
  * Output port 0: Discarded messages - received out of order, from the address given 
  * as argument 2 or already considered for forward (as indicated by duplicate set)
- * Output port 1: Hello messages
- * Output port 2: TC messages
+ * Output port 1: Hello and LQ_HELLO messages
+ * Output port 2: TC and LQ_TC messages
  * Output port 3: MID messages
- * Output port 4: HNA messages
+ * Output port 4: HNA and GATEWAY_LOAD messages
  * Output port 5: Messages with unknown message type
  *
  * =processing
  * PUSH
  *
+ * =h stats read-only
+ * Messages and bytes received, discarded (TTL 0 or from this node) and
+ * discarded as duplicates, per interface (paint annotation) and message
+ * type, and the cycles spent per packet, not counting the elements the
+ * messages are pushed to. See OLSRForward for the format.
+ *
+ * =h clear_stats write-only
+ * Resets the counters.
+ *
  * =a
  * OLSRProcessHello, OLSRProcessTC, OLSRProcessMID, OLSRForward
  */
@@ -55,11 +65,19 @@ public:
   int configure(Vector<String> &conf, ErrorHandler *errh);
   int initialize(ErrorHandler *);
   void push(int, Packet*);
+  void push_batch(int, PacketBatch &);
+  void add_handlers();
 
 private:
   OLSRLocalIfInfoBase *_localIfInfoBase;
   OLSRDuplicateSet *_duplicateSet;
   IPAddress _myMainIP;
+  OLSRMessageStats _stats;
+
+  void classify(Packet *packet, PacketBatch &run, int &run_port);
+  inline void emit(int port, Packet *p, PacketBatch &run, int &run_port);
+  void flush(PacketBatch &run, int run_port);
+  static bool in_run(const PacketBatch &run, IPAddress originator, int seq);
 };
 
 CLICK_ENDDECLS
@@ -10,6 +10,7 @@
 CLICK_DECLS
 
 OLSRCompactAssociationInfoBase::OLSRCompactAssociationInfoBase()
+  : _version(0)
 {
   _compactSet = new CompactSet;
 }
@@ -45,6 +46,7 @@ void OLSRCompactAssociationInfoBase::uninitialize()
 void
 OLSRCompactAssociationInfoBase::add(IPAddress network_addr, IPAddress netmask)
 {
+	_version++;
 
 	// make sure that the network_addr ends with zeros
 	IPPair ippair(network_addr & netmask, netmask);
@@ -99,6 +101,7 @@ OLSRCompactAssociationInfoBase::add(IPAddress network_addr, IPAddress netmask)
 void
 OLSRCompactAssociationInfoBase::remove(IPAddress network_addr, IPAddress netmask)
 {
+	_version++;
 
 	// make sure that the network_addr ends with zeros
 	IPPair ippair(network_addr & netmask, netmask);
@@ -36,11 +36,13 @@ public:
   void remove(IPAddress network_addr, IPAddress netmask);
   void print_compact_set();
   CompactSet *get_compact_set();
+  uint32_t version() const { return _version; }	// bumped by add() and remove()
 
 
 private:
   
   CompactSet *_compactSet;
+  uint32_t _version;
 };
 
 
@@ -0,0 +1,62 @@
+#ifndef OLSR_CONTROL_TIMER_HH
+#define OLSR_CONTROL_TIMER_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/task.hh>
+#include <click/standard/scheduleinfo.hh>
+
+CLICK_DECLS
+
+// A Timer that calls its element's run_timer() on the element's home
+// thread. Timers run on whichever RouterThread gets to the timer heap
+// first; the OLSR information bases are not locked, and with a control
+// thread (StaticThreadSched) every change to them must come from that
+// thread. With multithreading the timer reschedules a Task of the element
+// instead, which StaticThreadSched puts on the element's thread, and
+// run_timer() follows from there; otherwise run_timer() is called at once
+// as with a plain Timer.
+//
+// A ScheduleInfo DEADLINE for the element puts that Task in the deadline
+// class, ahead of the data path Tasks of the thread; the elements report
+// how it met the deadline in their timer_deadline_stats handlers.
+class OLSRControlTimer : public Timer { public:
+
+  OLSRControlTimer(Element *e)
+    : Timer(timer_hook, this), _element(e), _task(task_hook, this) {
+  }
+
+  void initialize(Element *owner) {
+    Timer::initialize(owner);
+    if (Timestamp deadline = ScheduleInfo::query_deadline(owner))
+      _task.set_deadline(deadline);
+    _task.initialize(owner, false);
+  }
+
+  Task *task()			{ return &_task; }
+
+private:
+
+  Element *_element;
+  Task _task;
+
+  static void timer_hook(Timer *t, void *thunk) {
+    OLSRControlTimer *ct = static_cast<OLSRControlTimer *>(thunk);
+#if HAVE_MULTITHREAD
+    (void) t;
+    ct->_task.reschedule();
+#else
+    ct->_element->run_timer(t);
+#endif
+  }
+
+  static bool task_hook(Task *, void *thunk) {
+    OLSRControlTimer *ct = static_cast<OLSRControlTimer *>(thunk);
+    ct->_element->run_timer(ct);
+    return true;
+  }
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,111 @@
+/*
+ * olsr_convergence.{cc,hh} -- time until emulated OLSR nodes reach each other
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include "olsr_convergence.hh"
+
+CLICK_DECLS
+
+OLSRConvergence::OLSRConvergence()
+  : _interval(Timestamp::make_msec(100)), _stop(false), _timer(this),
+    _reachable(0)
+{
+}
+
+
+OLSRConvergence::~OLSRConvergence()
+{
+}
+
+
+int
+OLSRConvergence::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  if (cp_va_kparse_remove_keywords(conf, this, errh,
+				   "INTERVAL", 0, cpTimestamp, &_interval,
+				   "STOP", 0, cpBool, &_stop,
+				   cpEnd) < 0)
+    return -1;
+  if (!_interval)
+    return errh->error("INTERVAL must be positive");
+
+  _routingTables.clear();
+  _addresses.clear();
+  for (int i = 0; i < conf.size(); i++) {
+    Vector<String> words;
+    cp_spacevec(conf[i], words);
+    IPAddress addr;
+    if (words.size() != 2 || !cp_ip_address(words[1], &addr, this))
+      return errh->error("argument %d should be 'OLSRRoutingTable ADDRESS'", i + 1);
+    Element *e = cp_element(words[0], this, errh);
+    if (!e)
+      return -1;
+    OLSRRoutingTable *rt = (OLSRRoutingTable *) e->cast("OLSRRoutingTable");
+    if (!rt)
+      return errh->error("%s is not an OLSRRoutingTable", e->name().c_str());
+    _routingTables.push_back(rt);
+    _addresses.push_back(addr);
+  }
+  if (_routingTables.size() < 2)
+    return errh->error("need at least two nodes");
+  return 0;
+}
+
+
+int
+OLSRConvergence::initialize(ErrorHandler *)
+{
+  _start = Timestamp::now();
+  _timer.initialize(this);
+  _timer.schedule_after(_interval);
+  return 0;
+}
+
+
+void
+OLSRConvergence::run_timer(Timer *)
+{
+  int n = _routingTables.size();
+  _reachable = 0;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      if (i != j && _routingTables[i]->route_distance(_addresses[j]) >= 0)
+	_reachable++;
+
+  if (!_converged && _reachable == n * (n - 1)) {
+    _converged = Timestamp::now() - _start;
+    click_chatter("%s: %d nodes converged after %s seconds", name().c_str(), n, _converged.unparse().c_str());
+    if (_stop)
+      router()->please_stop_driver();
+  }
+  _timer.reschedule_after(_interval);
+}
+
+
+String
+OLSRConvergence::read_handler(Element *e, void *thunk)
+{
+  OLSRConvergence *oc = (OLSRConvergence *) e;
+  if (thunk)
+    return oc->_converged ? oc->_converged.unparse() : String();
+  int n = oc->_routingTables.size();
+  StringAccum sa;
+  sa << oc->_reachable << ' ' << n * (n - 1);
+  return sa.take_string();
+}
+
+
+void
+OLSRConvergence::add_handlers()
+{
+  add_read_handler("converged", read_handler, (void *) 1);
+  add_read_handler("reachable", read_handler, (void *) 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRConvergence)
@@ -0,0 +1,87 @@
+/*
+  =c
+  OLSRConvergence(NODE1, NODE2, ... [, I<keywords> INTERVAL, STOP])
+
+  =s
+  OLSR specific element, measures when emulated OLSR nodes all reach each other
+
+  =io
+  None
+
+  =d
+  For OLSR nodes emulated in one router, typically by click-combine
+  --olsr: each NODE argument is an OLSRRoutingTable element and the main
+  address of its node, separated by a space. Every INTERVAL, the element
+  counts the pairs of nodes where the first has a route to the second. The
+  first time every node has a route to every other, the network has
+  converged; the time since the router was initialized is kept, and printed.
+
+  The routing tables are read directly, so the element must run on the
+  thread that owns them.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item INTERVAL
+
+  Time. How often the routes are checked. Default is 100 milliseconds.
+
+  =item STOP
+
+  Boolean. If true, stop the router once the network has converged.
+  Default is false.
+
+  =back
+
+  =h converged read-only
+  Seconds from initialization to convergence, or nothing before it.
+
+  =h reachable read-only
+  Number of ordered pairs of nodes where the first has a route to the
+  second, and the number of pairs.
+
+  =a OLSRRoutingTable, RadioSim, click-combine(1) */
+
+#ifndef OLSR_CONVERGENCE_HH
+#define OLSR_CONVERGENCE_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/ipaddress.hh>
+#include "olsr_rtable.hh"
+
+CLICK_DECLS
+
+class OLSRConvergence : public Element { public:
+
+  OLSRConvergence();
+  ~OLSRConvergence();
+
+  const char *class_name() const	{ return "OLSRConvergence"; }
+  const char *port_count() const	{ return PORTS_0_0; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  void run_timer(Timer *);
+
+private:
+
+  Vector<OLSRRoutingTable *> _routingTables;
+  Vector<IPAddress> _addresses;
+  Timestamp _interval;
+  bool _stop;
+
+  Timer _timer;
+  Timestamp _start;
+  Timestamp _converged;		// zero until then
+  int _reachable;
+
+  static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
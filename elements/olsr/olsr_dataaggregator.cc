@@ -0,0 +1,277 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include "olsr_dataaggregator.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+OLSRDataAggregator::OLSRDataAggregator()
+  : _timer(this)
+{
+}
+
+
+OLSRDataAggregator::~OLSRDataAggregator()
+{
+}
+
+
+int
+OLSRDataAggregator::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _delay = 2;
+  _mtu = 1500;
+  _small = 400;
+  if ( cp_va_parse(conf, this, errh,
+		   cpIPAddress, "address of the interface", &_addr,
+		   cpKeywords,
+		   "DELAY", cpInteger, "holding time (msecs)", &_delay,
+		   "MTU", cpInteger, "largest combined packet", &_mtu,
+		   "SMALL", cpInteger, "largest packet held", &_small,
+		   0) < 0 )
+    return -1;
+  if (_delay < 0)
+    return errh->error("DELAY must be positive");
+  if (_small < (int) sizeof(click_ip)
+      || _mtu < (int) sizeof(click_ip) + 2 * (int) sizeof(olsr_aggregate_record) + 2 * ((_small + 3) & ~3))
+    return errh->error("MTU must hold two packets of SMALL bytes");
+  return 0;
+}
+
+
+int
+OLSRDataAggregator::initialize(ErrorHandler *)
+{
+  _timer.initialize(this);
+  _ip_id = 0;
+  _packets_in = _packets_combined = _combined_out = _alone_out = _packets_held = 0;
+  _delay_total = 0;
+  _delay_max = 0;
+  return 0;
+}
+
+
+void
+OLSRDataAggregator::cleanup(CleanupStage)
+{
+  for (GroupMap::iterator iter = _groups.begin(); iter != _groups.end(); iter++){
+    if (iter.value().combined)
+      iter.value().combined->kill();
+    else
+      iter.value().first->kill();
+  }
+  _groups.clear();
+}
+
+
+bool
+OLSRDataAggregator::add(Group &group, Packet *packet)
+{
+  if (!group.combined){
+    //the first packet moves into the combined one once a second joins it
+    Packet *first = group.first;
+    int length = sizeof(click_ip) + record_size(first);
+    WritablePacket *q = Packet::make(first->headroom(), 0, length, _mtu - length);
+    if (!q)
+      return false;
+    q->copy_annotations(first);
+    olsr_aggregate_record *rec = (olsr_aggregate_record *) (q->data() + sizeof(click_ip));
+    rec->length = htons(first->length());
+    rec->reserved = 0;
+    memcpy(rec + 1, first->data(), first->length());
+    group.combined = q;
+    group.first = 0;
+    first->kill();
+  }
+
+  int size = record_size(packet);
+  WritablePacket *q = group.combined->put(size);
+  if (!q){
+    group.combined = 0;
+    return false;
+  }
+  group.combined = q;
+  olsr_aggregate_record *rec = (olsr_aggregate_record *) (q->end_data() - size);
+  rec->length = htons(packet->length());
+  rec->reserved = 0;
+  memcpy(rec + 1, packet->data(), packet->length());
+  packet->kill();
+  return true;
+}
+
+
+void
+OLSRDataAggregator::push(int, Packet *packet)
+{
+  _packets_in++;
+  Timestamp now = Timestamp::now();
+  IPAddress next_hop = packet->dst_ip_anno();
+  Group *group = _groups.findp(next_hop);
+
+  if ((int) packet->length() > _small){
+    if (group)
+      flush(next_hop, *group, now);
+    _alone_out++;
+    output(0).push(packet);
+    return;
+  }
+
+  if (group){
+    int length = (group->combined ? group->combined->length() : sizeof(click_ip) + record_size(group->first));
+    if (length + record_size(packet) > _mtu){
+      flush(next_hop, *group, now);
+      group = 0;
+    }
+  }
+
+  if (!group){
+    Group g;
+    g.first = packet;
+    g.combined = 0;
+    g.packets = 1;
+    g.started = now;
+    _groups.insert(next_hop, g);
+    schedule();
+    return;
+  }
+
+  //a packet that joins later has waited that much less
+  _delay_total -= (now - group->started).usecval();
+  if (add(*group, packet))
+    group->packets++;
+  else{
+    //out of memory: the group goes as far as it still exists, the packet
+    //alone after it
+    _delay_total += (now - group->started).usecval();
+    if (group->first)
+      flush(next_hop, *group, now);
+    else
+      _groups.remove(next_hop);
+    schedule();
+    _alone_out++;
+    output(0).push(packet);
+  }
+}
+
+
+void
+OLSRDataAggregator::flush(IPAddress next_hop, Group &group, const Timestamp &now)
+{
+  Group g = group;
+  _groups.remove(next_hop);
+
+  Timestamp::value_type waited = (now - g.started).usecval();
+  _delay_total += waited * g.packets;
+  _packets_held += g.packets;
+  if (waited > _delay_max)
+    _delay_max = waited;
+
+  if (!g.combined){
+    _alone_out++;
+    output(0).push(g.first);
+    return;
+  }
+
+  WritablePacket *q = g.combined;
+  click_ip *ip = (click_ip *) q->data();
+  memset(ip, 0, sizeof(click_ip));
+  ip->ip_v = 4;
+  ip->ip_hl = sizeof(click_ip) >> 2;
+  ip->ip_len = htons(q->length());
+  ip->ip_id = htons(_ip_id++);
+  ip->ip_ttl = 1;
+  ip->ip_p = OLSR_AGGREGATE_PROTO;
+  ip->ip_src = _addr.in_addr();
+  ip->ip_dst = next_hop.in_addr();
+  ip->ip_sum = click_in_cksum_iphdr(ip);
+  q->set_ip_header(ip, sizeof(click_ip));
+  q->set_dst_ip_anno(next_hop);
+
+  _combined_out++;
+  _packets_combined += g.packets;
+  output(0).push(q);
+}
+
+
+void
+OLSRDataAggregator::schedule()
+{
+  GroupMap::iterator iter = _groups.begin();
+  if (iter == _groups.end()){
+    _timer.unschedule();
+    return;
+  }
+  Timestamp earliest = iter.value().started;
+  for (iter++; iter != _groups.end(); iter++)
+    if (iter.value().started < earliest)
+      earliest = iter.value().started;
+  _timer.schedule_at(earliest + Timestamp::make_msec(_delay));
+}
+
+
+void
+OLSRDataAggregator::run_timer(Timer *)
+{
+  Timestamp now = Timestamp::now();
+  Timestamp started = now - Timestamp::make_msec(_delay);
+  Vector<IPAddress> due;
+  for (GroupMap::iterator iter = _groups.begin(); iter != _groups.end(); iter++)
+    if (iter.value().started <= started)
+      due.push_back(iter.key());
+  for (int i = 0; i < due.size(); i++)
+    if (Group *group = _groups.findp(due[i]))
+      flush(due[i], *group, now);
+  schedule();
+}
+
+
+String
+OLSRDataAggregator::read_handler(Element *e, void *thunk)
+{
+  OLSRDataAggregator *ag = (OLSRDataAggregator *) e;
+  StringAccum sa;
+  switch ((intptr_t) thunk){
+  case 1: {
+    //packets per combined packet with two decimals, without floating point
+    uint32_t r = ag->_combined_out ? (ag->_packets_combined * 100) / ag->_combined_out : 0;
+    sa << (r / 100) << '.';
+    if (r % 100 < 10)
+      sa << '0';
+    sa << (r % 100) << "\n";
+    break;
+  }
+  case 2: {
+    uint32_t held = ag->_packets_held;
+    sa << "average " << (held ? (uint32_t) (ag->_delay_total / held) : 0) << "\n"
+       << "max " << ag->_delay_max << "\n";
+    break;
+  }
+  default:
+    sa << "packets_in " << ag->_packets_in << "\n"
+       << "packets_combined " << ag->_packets_combined << "\n"
+       << "combined_out " << ag->_combined_out << "\n"
+       << "alone_out " << ag->_alone_out << "\n";
+    break;
+  }
+  return sa.take_string();
+}
+
+
+void
+OLSRDataAggregator::add_handlers()
+{
+  add_read_handler("stats", read_handler, (void *) 0);
+  add_read_handler("ratio", read_handler, (void *) 1);
+  add_read_handler("delay", read_handler, (void *) 2);
+}
+
+#include <click/bighashmap.cc>
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class HashMap<IPAddress, OLSRDataAggregator::Group>;
+#endif
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRDataAggregator);
@@ -0,0 +1,116 @@
+/*
+  =c
+  OLSR specific element, combines small data packets for the same next hop into one frame
+
+  =s
+  OLSRDataAggregator(ADDR [, KEYWORDS])
+
+  =io
+  One input, one output
+
+  =processing
+  PUSH
+
+  =d
+  Gets routed IP packets on its input, the next hop in their destination IP address annotations, as they leave the route lookup for the interface with address ADDR. Packets of at most SMALL bytes are held, one group per next hop, and sent together in one IP packet from ADDR to the next hop, so the link layer spends its per-frame overhead only once for them. A group is sent DELAY milliseconds after its first packet arrived, or earlier if the next packet would make it longer than MTU bytes. A group of one packet is sent as it is; a larger packet for a next hop with a group pending is sent right after the group, so the order of the packets to a next hop is kept.
+
+  The combined packet has protocol OLSR_AGGREGATE_PROTO and a TTL of 1; every packet in it follows a four-byte record giving its length. The next hop takes them apart with an OLSRDataDeaggregator on its input path, so all nodes have to run one.
+
+  Keyword arguments are:
+
+  =item DELAY
+
+  Integer. Longest time in milliseconds a packet is held for others to join it, the latency budget. Default is 2.
+
+  =item MTU
+
+  Integer. Largest combined IP packet built. Default is 1500.
+
+  =item SMALL
+
+  Integer. Largest packet held for combining; larger ones pass at once. Default is 400.
+
+  =h stats read-only
+  Returns the numbers of packets received, of packets sent combined, of combined packets sent, and of packets sent alone.
+
+  =h ratio read-only
+  Returns the average number of packets per combined packet sent.
+
+  =h delay read-only
+  Returns the average and the largest time a held packet waited, in microseconds.
+
+  =a
+  OLSRDataDeaggregator, OLSRAggregator, OLSRNeighborQueue
+*/
+#ifndef OLSR_DATAAGGREGATOR_HH
+#define OLSR_DATAAGGREGATOR_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/ipaddress.hh>
+#include <click/bighashmap.hh>
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+class OLSRDataAggregator: public Element{
+public:
+
+  OLSRDataAggregator();
+  ~OLSRDataAggregator();
+
+  const char* class_name() const { return "OLSRDataAggregator"; }
+  const char* processing() const { return PUSH; }
+  OLSRDataAggregator *clone() const { return new OLSRDataAggregator(); }
+  const char *port_count() const  { return "1/1"; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void push(int, Packet *packet);
+  void run_timer(Timer *);
+
+private:
+  struct Group {
+    Packet *first;		// sent alone if no other packet joins it
+    WritablePacket *combined;	// once one has
+    int packets;
+    Timestamp started;
+  };
+  typedef HashMap<IPAddress, Group> GroupMap;
+
+  IPAddress _addr;
+  int _delay;
+  int _mtu;
+  int _small;
+  GroupMap _groups;
+  uint16_t _ip_id;
+  Timer _timer;
+
+  uint32_t _packets_in;
+  uint32_t _packets_combined;
+  uint32_t _combined_out;
+  uint32_t _alone_out;
+  uint32_t _packets_held;
+  uint64_t _delay_total;	// microseconds, over the packets held
+  uint32_t _delay_max;
+
+  static inline int record_size(const Packet *);
+  bool add(Group &, Packet *);
+  void flush(IPAddress next_hop, Group &, const Timestamp &now);
+  void schedule();
+  static String read_handler(Element *, void *);
+};
+
+//bytes a packet takes in the combined packet; here rather than in the .cc
+//file, so that click-devirtualize's copies of the methods see it
+inline int
+OLSRDataAggregator::record_size(const Packet *p)
+{
+  return sizeof(olsr_aggregate_record) + ((p->length() + 3) & ~3);
+}
+
+CLICK_ENDDECLS
+#endif
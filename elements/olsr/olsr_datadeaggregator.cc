@@ -0,0 +1,86 @@
+#include <click/config.h>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include "olsr_datadeaggregator.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+OLSRDataDeaggregator::OLSRDataDeaggregator()
+{
+}
+
+
+OLSRDataDeaggregator::~OLSRDataDeaggregator()
+{
+}
+
+
+int
+OLSRDataDeaggregator::initialize(ErrorHandler *)
+{
+  _combined_in = _packets_out = _bad = 0;
+  return 0;
+}
+
+
+void
+OLSRDataDeaggregator::push(int, Packet *packet)
+{
+  const click_ip *ip = packet->ip_header();
+  if (!ip || ip->ip_p != OLSR_AGGREGATE_PROTO){
+    output(0).push(packet);
+    return;
+  }
+  _combined_in++;
+
+  const unsigned char *data = packet->transport_header();
+  const unsigned char *end = packet->end_data();
+  while (data < end){
+    const olsr_aggregate_record *rec = (const olsr_aggregate_record *) data;
+    int length = (end - data >= (int) sizeof(olsr_aggregate_record) ? ntohs(rec->length) : 0);
+    if (length < (int) sizeof(click_ip) || length > end - data - (int) sizeof(olsr_aggregate_record)){
+      _bad++;
+      break;
+    }
+    WritablePacket *q = Packet::make(packet->headroom(), rec + 1, length, 0);
+    if (!q)
+      break;
+    const click_ip *qip = (const click_ip *) q->data();
+    int hlen = qip->ip_hl << 2;
+    if (hlen < (int) sizeof(click_ip) || hlen > length){
+      q->kill();
+      _bad++;
+      break;
+    }
+    q->copy_annotations(packet);
+    q->set_ip_header(qip, hlen);
+    _packets_out++;
+    output(0).push(q);
+    data += sizeof(olsr_aggregate_record) + ((length + 3) & ~3);
+  }
+  packet->kill();
+}
+
+
+String
+OLSRDataDeaggregator::read_handler(Element *e, void *)
+{
+  OLSRDataDeaggregator *d = (OLSRDataDeaggregator *) e;
+  StringAccum sa;
+  sa << "combined_in " << d->_combined_in << "\n"
+     << "packets_out " << d->_packets_out << "\n"
+     << "bad " << d->_bad << "\n";
+  return sa.take_string();
+}
+
+
+void
+OLSRDataDeaggregator::add_handlers()
+{
+  add_read_handler("stats", read_handler, (void *) 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRDataDeaggregator);
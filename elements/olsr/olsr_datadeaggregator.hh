@@ -0,0 +1,57 @@
+/*
+  =c
+  OLSR specific element, takes apart the packets combined by an OLSRDataAggregator
+
+  =s
+  OLSRDataDeaggregator()
+
+  =io
+  One input, one output
+
+  =processing
+  PUSH
+
+  =d
+  Gets IP packets with their IP header annotations set on its input. One of protocol OLSR_AGGREGATE_PROTO, as a neighbor's OLSRDataAggregator sends them, is replaced on the output by the packets in it, in their order, each with the annotations of the combined packet and its own IP header annotation. Other packets pass unchanged. Belongs on the input path of the node's data, in front of the local delivery and the forwarding, so the packets are treated as if they had arrived one by one.
+
+  A combined packet whose records run past its end is dropped from the first bad record on.
+
+  =h stats read-only
+  Returns the numbers of combined packets received, of packets taken out of them and of combined packets with bad records.
+
+  =a
+  OLSRDataAggregator
+*/
+#ifndef OLSR_DATADEAGGREGATOR_HH
+#define OLSR_DATADEAGGREGATOR_HH
+
+#include <click/element.hh>
+
+CLICK_DECLS
+
+class OLSRDataDeaggregator: public Element{
+public:
+
+  OLSRDataDeaggregator();
+  ~OLSRDataDeaggregator();
+
+  const char* class_name() const { return "OLSRDataDeaggregator"; }
+  const char* processing() const { return PUSH; }
+  OLSRDataDeaggregator *clone() const { return new OLSRDataDeaggregator(); }
+  const char *port_count() const  { return "1/1"; }
+
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  void push(int, Packet *packet);
+
+private:
+  uint32_t _combined_in;
+  uint32_t _packets_out;
+  uint32_t _bad;
+
+  static String read_handler(Element *, void *);
+};
+
+CLICK_ENDDECLS
+#endif
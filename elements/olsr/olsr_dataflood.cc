@@ -0,0 +1,248 @@
+/*
+ * olsr_dataflood.{cc,hh} -- floods broadcast and multicast data through the
+ * MPRs, with hash-based duplicate detection
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/packet_anno.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ether.h>
+#include "click_olsr.hh"
+#include "olsr_dataflood.hh"
+
+CLICK_DECLS
+
+OLSRDataFlood::OLSRDataFlood()
+  : _entries(0)
+{
+}
+
+
+OLSRDataFlood::~OLSRDataFlood()
+{
+}
+
+
+int
+OLSRDataFlood::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *neighbor_info, *interface_info;
+  String arp_queriers;
+  int hold = 3000;
+  _size = 4096;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRNeighborInfoBase element", &neighbor_info,
+		  cpElement, "OLSRInterfaceInfoBase element", &interface_info,
+		  cpArgument, "OLSRARPQuerier elements", &arp_queriers,
+		  cpKeywords,
+		  "HOLD", cpInteger, "duplicate hold time (msec)", &hold,
+		  "SIZE", cpInteger, "number of duplicate table entries", &_size,
+		  0) < 0)
+    return -1;
+
+  if (!(_neighborInfo = (OLSRNeighborInfoBase *) neighbor_info->cast("OLSRNeighborInfoBase")))
+    return errh->error("%s is not an OLSRNeighborInfoBase", neighbor_info->name().c_str());
+  if (!(_interfaceInfo = (OLSRInterfaceInfoBase *) interface_info->cast("OLSRInterfaceInfoBase")))
+    return errh->error("%s is not an OLSRInterfaceInfoBase", interface_info->name().c_str());
+  if (hold <= 0)
+    return errh->error("HOLD must be greater than 0");
+  if (_size <= 0 || _size > (1 << 24))
+    return errh->error("SIZE must be between 1 and %d", 1 << 24);
+  _hold = olsr_msec(hold);
+
+  Vector<String> names;
+  cp_spacevec(arp_queriers, names);
+  _arpQueriers.clear();
+  for (int i = 0; i < names.size(); i++) {
+    Element *e = cp_element(names[i], this, errh);
+    if (!e)
+      return -1;
+    OLSRARPQuerier *arpq = (OLSRARPQuerier *) e->cast("OLSRARPQuerier");
+    if (!arpq)
+      return errh->error("%s is not an OLSRARPQuerier", e->name().c_str());
+    _arpQueriers.push_back(arpq);
+  }
+  if (_arpQueriers.empty())
+    return errh->error("no OLSRARPQuerier elements given");
+  return 0;
+}
+
+
+int
+OLSRDataFlood::initialize(ErrorHandler *errh)
+{
+  int size = 1;
+  while (size < _size)
+    size <<= 1;
+  _size = size;
+  _mask = size - 1;
+  if (!(_entries = new Entry[size]))
+    return errh->error("out of memory");
+  clear();
+  return 0;
+}
+
+
+void
+OLSRDataFlood::cleanup(CleanupStage)
+{
+  delete[] _entries;
+  _entries = 0;
+}
+
+
+void
+OLSRDataFlood::clear()
+{
+  for (int i = 0; i < _size; i++) {
+    _entries[i].hash = 0;
+    _entries[i].expires = 0;
+  }
+  _received = _originated = _duplicates = _delivered = _relayed = 0;
+  _not_selected = _unknown_hop = 0;
+}
+
+
+/**
+ * FNV-1a over the fields of p that no hop changes: not the TTL, the
+ * checksum or the options, which routers may rewrite
+ */
+uint32_t
+OLSRDataFlood::packet_hash(const Packet *p)
+{
+  const click_ip *iph = p->ip_header();
+  uint32_t h = 2166136261U;
+  const uint8_t *fields[4] = {
+    (const uint8_t *) &iph->ip_src, (const uint8_t *) &iph->ip_dst,
+    (const uint8_t *) &iph->ip_id, (const uint8_t *) &iph->ip_len
+  };
+  const int lengths[4] = { 4, 4, 2, 2 };
+  for (int f = 0; f < 4; f++)
+    for (int i = 0; i < lengths[f]; i++)
+      h = (h ^ fields[f][i]) * 16777619U;
+  h = (h ^ iph->ip_p) * 16777619U;
+  const uint8_t *payload = p->transport_header();
+  int length = p->end_data() - payload;
+  if (length > 64)
+    length = 64;
+  for (int i = 0; i < length; i++)
+    h = (h ^ payload[i]) * 16777619U;
+  return h;
+}
+
+
+/**
+ * returns true if p was seen within the hold time, and records it if not
+ */
+bool
+OLSRDataFlood::duplicate(const Packet *p)
+{
+  uint32_t h = packet_hash(p);
+  Entry &e = _entries[(h ^ (h >> 16)) & _mask];
+  olsr_time_t now = olsr_now();
+  if (e.expires > now && e.hash == h)
+    return true;
+  e.hash = h;
+  e.expires = now + _hold;
+  return false;
+}
+
+
+/**
+ * the main address of the neighbor p was sent by, from its Ethernet source
+ * address; 0.0.0.0 if no ARP table knows it
+ */
+IPAddress
+OLSRDataFlood::previous_hop(const Packet *p)
+{
+  if (!p->has_mac_header())
+    return IPAddress();
+  EtherAddress src(p->ether_header()->ether_shost);
+  for (int i = 0; i < _arpQueriers.size(); i++) {
+    IPAddress addr = _arpQueriers[i]->lookup_mac(src);
+    if (addr)
+      return _interfaceInfo->get_main_address(addr);
+  }
+  return IPAddress();
+}
+
+
+void
+OLSRDataFlood::push(int port, Packet *p)
+{
+  if (port == 0)
+    _received++;
+  else
+    _originated++;
+  if (duplicate(p)) {
+    _duplicates++;
+    p->kill();
+    return;
+  }
+
+  if (port == 1) {
+    _relayed++;
+    output(1).push(p);
+    return;
+  }
+
+  bool relay = false;
+  IPAddress prev = previous_hop(p);
+  if (!prev)
+    _unknown_hop++;
+  else if (!_neighborInfo->is_mpr_selector(prev))
+    _not_selected++;
+  else
+    relay = (p->ip_header()->ip_ttl > 1);
+
+  if (relay)
+    if (Packet *q = p->clone())
+      if (WritablePacket *w = q->uniqueify()) {
+	click_ip_decrement_ttl(w->ip_header());
+	_relayed++;
+	output(1).push(w);
+      }
+  _delivered++;
+  output(0).push(p);
+}
+
+
+String
+OLSRDataFlood::read_stats(Element *e, void *)
+{
+  OLSRDataFlood *df = (OLSRDataFlood *) e;
+  StringAccum sa;
+  sa << "received " << df->_received << '\n'
+     << "originated " << df->_originated << '\n'
+     << "duplicates " << df->_duplicates << '\n'
+     << "delivered " << df->_delivered << '\n'
+     << "relayed " << df->_relayed << '\n'
+     << "not_selected " << df->_not_selected << '\n'
+     << "unknown_hop " << df->_unknown_hop << '\n';
+  return sa.take_string();
+}
+
+
+int
+OLSRDataFlood::clear_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRDataFlood *df = (OLSRDataFlood *) e;
+  if (df->_entries)
+    df->clear();
+  return 0;
+}
+
+
+void
+OLSRDataFlood::add_handlers()
+{
+  add_read_handler("stats", read_stats, 0);
+  add_write_handler("clear", clear_handler, 0);
+}
+
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRDataFlood)
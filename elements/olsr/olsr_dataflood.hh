@@ -0,0 +1,136 @@
+/*
+  =c
+  OLSRDataFlood(OLSRNeighborInfoBase element, OLSRInterfaceInfoBase element, ARP queriers [, KEYWORDS])
+
+  =s
+  OLSR specific element, floods broadcast and multicast data through the MPRs
+
+  =io
+  Two inputs, two outputs
+
+  =d
+  Floods IP broadcast and multicast data the way OLSRForward floods control
+  messages, after the S-MPR relay set of SMF (RFC 6621): a node relays a
+  packet only if the node it heard the packet from selected it as MPR, so
+  that a flood reaches every node with a fraction of the transmissions of
+  blind re-broadcasting.
+
+  Input 0 takes the packets received from the network, with their IP and
+  Ethernet header annotations set (MarkEtherHeader before the Strip) and
+  painted with the number of the interface they came in on. Input 1 takes
+  the packets this node sends. Each packet is first looked up by a hash of
+  its invariant fields (source, destination, protocol, identification,
+  length and up to the first 64 bytes of the payload, as the hash-based
+  duplicate detection of SMF does), and dropped if the same packet was seen
+  within HOLD msecs.
+
+  A new packet from the network is emitted on output 0, for delivery to the
+  host, and its previous hop is found from its Ethernet source address in
+  the ARP tables of the OLSRARPQuerier elements of the third argument, a
+  space-separated list, and mapped to its main address by the
+  OLSRInterfaceInfoBase. If that node is in the MPR selector set of the
+  OLSRNeighborInfoBase, a copy with its TTL decremented, unless that would
+  make it 0, is emitted on output 1, to be sent on every interface. A
+  packet from input 1 is always emitted on output 1, with its TTL unchanged.
+
+  The duplicate table is direct-mapped: a packet displaced by another one
+  before its HOLD is up may be relayed once more, never dropped wrongly,
+  short of a collision of the 32-bit hashes. It is not locked.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item HOLD
+
+  Integer. How long a packet is remembered, in msecs. Default is 3000.
+
+  =item SIZE
+
+  Integer. Entries of the duplicate table, rounded up to a power of two.
+  Default is 4096.
+
+  =back
+
+  =h stats read-only
+  Packets received from the network and sent by the node, duplicates
+  dropped, packets delivered, packets relayed, packets not relayed as their
+  previous hop did not select this node as MPR, and packets whose previous
+  hop was unknown, one per line.
+
+  =h clear write-only
+  Empties the duplicate table and resets the counters.
+
+  =e
+  flood::OLSRDataFlood(neighbor_info, interface_info, arpq0 arpq1);
+  flood[0] -> EtherEncap(0x0800, 1:1:1:1:1:1, 0:1:2:3:4:5) -> tolocal;
+  flood[1] -> t::Tee(2);
+  t[0] -> EtherEncap(0x0800, $my_ether0, ff:ff:ff:ff:ff:ff) -> out0;
+  t[1] -> EtherEncap(0x0800, $my_ether1, ff:ff:ff:ff:ff:ff) -> out1;
+
+  =a
+  OLSRForward, OLSRDuplicateSet, OLSRNeighborInfoBase, OLSRARPQuerier */
+
+#ifndef OLSR_DATAFLOOD_HH
+#define OLSR_DATAFLOOD_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+#include "olsr_neighbor_infobase.hh"
+#include "olsr_interface_infobase.hh"
+#include "olsr_arpquerier.hh"
+
+CLICK_DECLS
+
+class OLSRDataFlood : public Element { public:
+
+  OLSRDataFlood();
+  ~OLSRDataFlood();
+
+  const char *class_name() const	{ return "OLSRDataFlood"; }
+  const char *port_count() const	{ return "2/2"; }
+  const char *processing() const	{ return PUSH; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void push(int, Packet *);
+
+private:
+
+  struct Entry {
+    uint32_t hash;
+    olsr_time_t expires;	// 0 if empty
+  };
+
+  OLSRNeighborInfoBase *_neighborInfo;
+  OLSRInterfaceInfoBase *_interfaceInfo;
+  Vector<OLSRARPQuerier *> _arpQueriers;
+  olsr_time_t _hold;
+  Entry *_entries;
+  uint32_t _mask;		// number of entries - 1
+  int _size;
+
+  uint32_t _received;
+  uint32_t _originated;
+  uint32_t _duplicates;
+  uint32_t _delivered;
+  uint32_t _relayed;
+  uint32_t _not_selected;
+  uint32_t _unknown_hop;
+
+  static uint32_t packet_hash(const Packet *);
+  bool duplicate(const Packet *);
+  IPAddress previous_hop(const Packet *);
+  void clear();
+
+  static String read_stats(Element *, void *);
+  static int clear_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
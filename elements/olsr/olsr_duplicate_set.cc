@@ -2,13 +2,16 @@
 
 #include <click/config.h>
 #include <click/bighashmap.hh>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/integers.hh>
 #include "click_olsr.hh"
 #include "olsr_duplicate_set.hh"
 
 CLICK_DECLS
 
 OLSRDuplicateSet::OLSRDuplicateSet()
-  : _timer(this)
+  : _timer(this), _expiryQueue(0), _generation(0)
 {
 }
 
@@ -19,8 +22,21 @@ OLSRDuplicateSet::~OLSRDuplicateSet()
 
 
 int 
-OLSRDuplicateSet::configure(Vector<String> &, ErrorHandler *)
+OLSRDuplicateSet::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+  Element *expiry_queue = 0;
+  int max_originators = 0;
+  if ( cp_va_parse(conf, this, errh,
+		   cpKeywords,
+		   "EXPIRY_QUEUE", cpElement, "shared expiry timer", &expiry_queue,
+		   "MAX_ORIGINATORS", cpInteger, "maximum number of originators", &max_originators,
+		   0) < 0 )
+    return -1;
+  if (expiry_queue && !(_expiryQueue = (OLSRExpiryQueue *) expiry_queue->cast("OLSRExpiryQueue")))
+    return errh->error("EXPIRY_QUEUE element is not an OLSRExpiryQueue");
+  if (max_originators < 0)
+    return errh->error("MAX_ORIGINATORS must be positive");
+  _admission.set(max_originators, 0, 0);
   return 0;
 }
 
@@ -29,115 +45,297 @@ int
 OLSRDuplicateSet::initialize(ErrorHandler *)
 {
   _timer.initialize(this);
-  _duplicateSet = new HashMap<DuplicatePair, void *>;	//ok new
-  _packetSeqList = new HashMap<IPAddress, int>;		//ok new
+  set_expiry(_expiryQueue, &_timer);
+  _duplicateSet = new DuplicateSet;	//ok new
+  _duplicateSet->set_incremental_resizing(true);	//grows during floods
   return 0;
 }
 
 void OLSRDuplicateSet::uninitialize()
 {
  delete _duplicateSet;
- delete _packetSeqList;
+ _packetSeqs.clear();
+}
+
+void
+OLSRDuplicateSet::take_state(Element *e, ErrorHandler *)
+{
+  OLSRDuplicateSet *old = (OLSRDuplicateSet *) e->cast("OLSRDuplicateSet");
+  if (!old)
+    return;
+
+  // without the tuples the new configuration would forward again every
+  // message still in flight, and accept old packet sequence numbers
+  DuplicateSet *duplicateSet = _duplicateSet;
+  _duplicateSet = old->_duplicateSet;
+  old->_duplicateSet = duplicateSet;
+  _packetSeqs.swap(old->_packetSeqs);
+  _expiry.swap(old->_expiry);
+  _generation++;
+
+  if (!_expiry.empty())
+    expire_at(_expiry.next());
 }
 
 
 duplicate_data *
 OLSRDuplicateSet::find_duplicate_entry(IPAddress address, int seq_num)
 {
-  if (! _duplicateSet->empty()){
-    DuplicatePair pair = DuplicatePair(address, seq_num);
-    duplicate_data *data = (duplicate_data *) _duplicateSet->find(pair);
-    return data;
+  DuplicateWindow *window = _duplicateSet->findp(address);
+  if (! window)
+    return 0;
+
+  int16_t age = (int16_t) (window->top - (uint16_t) seq_num);
+  if (age < 0)
+    return 0;			//newer than anything seen
+  if (age >= OLSR_DUPLICATE_WINDOW) {
+    //too old to tell; report it as already retransmitted, so it is
+    //neither processed nor forwarded again
+    _stale.D_addr = address;
+    _stale.D_seq_num = seq_num;
+    _stale.D_retransmitted = true;
+    _stale.D_iface_list.clear();
+    return &_stale;
   }
-  return 0;
+  if (! (window->seen & (1U << age)))
+    return 0;
+  return &window->slot[(uint16_t) seq_num % OLSR_DUPLICATE_WINDOW];
 }  
 
 
+/**
+ * the window of address, made if there is none or slid forward if seq_num
+ * is newer than its top, and the age of seq_num in it; 0 if there is no
+ * room for another originator or seq_num is too old for the window
+ */
+OLSRDuplicateSet::DuplicateWindow *
+OLSRDuplicateSet::window_for(IPAddress address, int seq_num, olsr_time_t time, int &age)
+{
+  DuplicateWindow *window = _duplicateSet->findp(address);
+  if (! window) {
+    if (_admission.full(_duplicateSet->size()) && !make_room()) {
+      _admission.refused();
+      return 0;
+    }
+    _duplicateSet->insert(address, DuplicateWindow());
+    window = _duplicateSet->findp(address);
+    window->top = seq_num;
+    _expiry.push(time, address);
+    expire_at(time);
+    _generation++;
+  }
+
+  age = (int16_t) (window->top - (uint16_t) seq_num);
+  if (age < 0) {		//slide the window forward
+    window->seen = (-age >= OLSR_DUPLICATE_WINDOW ? 0 : window->seen << -age);
+    window->verified = (-age >= OLSR_DUPLICATE_WINDOW ? 0 : window->verified << -age);
+    window->top = seq_num;
+    age = 0;
+    _generation++;
+  }
+  else if (age >= OLSR_DUPLICATE_WINDOW)
+    return 0;
+  return window;
+}
+
+
 duplicate_data *
-OLSRDuplicateSet::add_duplicate_entry(IPAddress address, int seq_num)
+OLSRDuplicateSet::add_duplicate_entry(IPAddress address, int seq_num, olsr_time_t time)
 {
-  DuplicatePair pair = DuplicatePair(address, seq_num);
-  duplicate_data *data = new duplicate_data;		//new ok, freed en remove
+  int age;
+  DuplicateWindow *window = window_for(address, seq_num, time, age);
+  if (! window)
+    return 0;
+
+  window->seen |= (1U << age);
+  duplicate_data *data = &window->slot[(uint16_t) seq_num % OLSR_DUPLICATE_WINDOW];
   data->D_addr = address;
   data->D_seq_num = seq_num;
-
-  if (_duplicateSet->insert(pair, data))
-    return data;
-
-  return 0;
+  data->D_retransmitted = false;
+  data->D_iface_list.clear();
+  data->D_time = time;
+  return data;
 }
 
 
 void
 OLSRDuplicateSet::remove_duplicate_entry(IPAddress address, int seq_num)
 {
-  DuplicatePair pair = DuplicatePair(address, seq_num);
-  DuplicatePair *ptr = (DuplicatePair*) _duplicateSet->find(pair); //getting stored generic pointer, to release allocated memory 
-  _duplicateSet->remove(pair);
-  delete ptr;
+  DuplicateWindow *window = _duplicateSet->findp(address);
+  if (! window)
+    return;
+  int16_t age = (int16_t) (window->top - (uint16_t) seq_num);
+  if (age >= 0 && age < OLSR_DUPLICATE_WINDOW)
+    window->seen &= ~(1U << age);
+  _generation++;
+}
+
+
+bool
+OLSRDuplicateSet::add_verified(IPAddress address, int seq_num, const uint8_t *digest, olsr_time_t time)
+{
+  //a window made here for a message that never gets a tuple goes at time
+  int age;
+  DuplicateWindow *window = window_for(address, seq_num, time, age);
+  if (! window)
+    return false;
+  if (! (window->verified & (1U << age))) {
+    window->verified |= (1U << age);
+    memcpy(window->slot[(uint16_t) seq_num % OLSR_DUPLICATE_WINDOW].D_digest,
+	   digest, OLSR_AUTH_DIGEST_SIZE);
+  }
+  return true;
+}
+
+
+const uint8_t *
+OLSRDuplicateSet::verified_digest(IPAddress address, int seq_num)
+{
+  DuplicateWindow *window = _duplicateSet->findp(address);
+  if (! window)
+    return 0;
+  int16_t age = (int16_t) (window->top - (uint16_t) seq_num);
+  if (age < 0 || age >= OLSR_DUPLICATE_WINDOW || ! (window->verified & (1U << age)))
+    return 0;
+  return window->slot[(uint16_t) seq_num % OLSR_DUPLICATE_WINDOW].D_digest;
+}
+
+
+/**
+ * evicts the originator whose tuples expire soonest, as far as the first
+ * entries of the expiry heap tell. Duplicate tuples only live a few
+ * seconds, so which originator goes matters little
+ */
+bool
+OLSRDuplicateSet::make_room()
+{
+  for (int i = 0; i < OLSRAdmission::SAMPLE && !_expiry.empty(); i++) {
+    IPAddress address = _expiry.pop();
+    if (_duplicateSet->remove(address)) {
+      _generation++;
+      _admission.evicted();
+      return true;
+    }
+  }
+  return false;
+}
+
+
+String
+OLSRDuplicateSet::admission_handler(Element *e, void *)
+{
+  OLSRDuplicateSet *ds = (OLSRDuplicateSet *) e;
+  StringAccum sa;
+  ds->_admission.unparse(sa, ds->_duplicateSet->size());
+  return sa.take_string();
 }
 
 
+void *
+OLSRDuplicateSet::cast(const char *n)
+{
+  if (strcmp(n, "OLSRMemoryClient") == 0)
+    return (OLSRMemoryReport::Client *) this;
+  return Element::cast(n);
+}
+
+
+/**
+ * a window takes all its slots whether they hold tuples or not; receiving
+ * interfaces beyond OLSR_DUPLICATE_IFACES spill to the heap and are not
+ * counted
+ */
 void
-OLSRDuplicateSet::add_packet_seq(IPAddress iface_addr, int seq_num){
-  _packetSeqList->insert(iface_addr, seq_num);
+OLSRDuplicateSet::memory_usage(Vector<OLSRMemoryReport::Usage> &usage)
+{
+  size_t tuples = 0;
+  for (DuplicateSet::const_iterator it = _duplicateSet->begin(); it != _duplicateSet->end(); it++)
+    tuples += popcount(it.value().seen);
+  usage.push_back(OLSRMemoryReport::Usage("duplicates", tuples,
+					  OLSRMemoryReport::bytes(*_duplicateSet) + _expiry.bytes()));
+  usage.push_back(OLSRMemoryReport::Usage("packet_seqs", _packetSeqs.size(),
+					  OLSRMemoryReport::bytes(_packetSeqs)));
 }
 
+
 void
-OLSRDuplicateSet::remove_packet_seq(IPAddress iface_addr){
-  _packetSeqList->remove(iface_addr);
+OLSRDuplicateSet::hash_stats(StringAccum &sa)
+{
+  OLSRMemoryReport::unparse_chains(sa, "duplicates", *_duplicateSet);
 }
 
+
 void
-OLSRDuplicateSet::update_packet_seq(IPAddress iface_addr, int seq_num){
-  HashMap<IPAddress, int>::Pair *pair =_packetSeqList->find_pair(iface_addr);
-  pair->value = seq_num;
+OLSRDuplicateSet::add_handlers()
+{
+  add_read_handler("admission", admission_handler, 0);
+  add_memory_handlers(this);
+  add_hash_stats_handler(this);
 }
 
-int
-OLSRDuplicateSet::find_packet_seq(IPAddress iface_addr){
-  int pkt_seq = _packetSeqList->find(iface_addr);
-  return pkt_seq;
+
+void
+OLSRDuplicateSet::remove_packet_seq(IPAddress iface_addr){
+  _packetSeqs.remove(iface_addr);
 }
 
 
 void
 OLSRDuplicateSet::run_timer(Timer *)
 {
-  struct timeval now, next_timeout;
-  click_gettimeofday(&now);
-  next_timeout = make_timeval(0, 0);
+  run_expiry_timer();
+}
+
 
-  //find expired duplicate entries and delete them
-  if (! _duplicateSet->empty()){
-    for (DuplicateSet::iterator iter = _duplicateSet->begin(); iter != _duplicateSet->end(); iter++){
-      duplicate_data *entry = (duplicate_data *) iter.value();
-      if (entry->D_time <= now){
-	remove_duplicate_entry(entry->D_addr, entry->D_seq_num);
+olsr_time_t
+OLSRDuplicateSet::expire_window(DuplicateWindow *window, olsr_time_t now)
+{//clears the expired tuples of window, returns the time of its latest one
+  olsr_time_t latest = now;
+  for (int age = 0; age < OLSR_DUPLICATE_WINDOW; age++)
+    if (window->seen & (1U << age)) {
+      olsr_time_t time = window->slot[(uint16_t) (window->top - age) % OLSR_DUPLICATE_WINDOW].D_time;
+      if (time <= now) {
+	window->seen &= ~(1U << age);
+	window->verified &= ~(1U << age);
       }
+      else if (latest < time)
+	latest = time;
     }
-  }
+  return latest;
+}
 
-  //find next duplicate entry to expire
-  if (! _duplicateSet->empty()){
-    for (DuplicateSet::iterator iter = _duplicateSet->begin(); iter != _duplicateSet->end(); iter++){
-      duplicate_data *entry = (duplicate_data *) iter.value();
-      if (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0)
-	next_timeout = entry->D_time;
-      if ( entry->D_time < next_timeout )
-	next_timeout = entry->D_time;
-    }
+
+olsr_time_t
+OLSRDuplicateSet::run_expiry(olsr_time_t now)
+{
+  //drop the expired tuples of the originators at the top of the heap; an
+  //originator goes back into the heap for its latest tuple, or is removed
+  //once it has none left
+  _generation++;
+  while (! _expiry.empty() && _expiry.next() <= now){
+    IPAddress address = _expiry.pop();
+    DuplicateWindow *window = _duplicateSet->findp(address);
+    if (! window)
+      continue;
+    olsr_time_t latest = expire_window(window, now);
+    if (window->seen)
+      _expiry.push(latest, address);
+    else
+      _duplicateSet->remove(address);
   }
 
-  if (! (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0) )
-    _timer.schedule_at(next_timeout);    //set timer
+  _expiry.compact_if_stale(*_duplicateSet, WindowExpiry(now));
 
+  if (_expiry.empty())
+    return 0;
+  return _expiry.next();
 }
 
 
 #include <click/bighashmap.cc>
+#include <click/vector.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
-template class HashMap<DuplicatePair, void *>;
+template class HashMap<IPAddress, OLSRDuplicateSet::DuplicateWindow>;
 template HashMap<IPAddress, int>;
 #endif
 
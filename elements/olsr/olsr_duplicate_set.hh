@@ -5,39 +5,16 @@
 #include <click/element.hh>
 #include <click/timer.hh>
 #include <click/bighashmap.hh>
+#include <click/flathashmap.hh>
+#include <click/ipaddress.hh>
+#include "click_olsr.hh"
+#include "olsr_expiry_queue.hh"
+#include "olsr_admission.hh"
+#include "olsr_memory_report.hh"
 
 CLICK_DECLS
 
-class DuplicatePair {
-public:
-
-  IPAddress _address;
-  int _seq_num;
-
-  DuplicatePair() : _address(), _seq_num() { }
-
-  DuplicatePair(IPAddress address, int seq_num) {
-      _address = address;
-      _seq_num = seq_num;
-  }
-
-
-};
-
-inline bool
-operator==(DuplicatePair one, DuplicatePair other)
-{
-  return (other._address == one._address && other._seq_num == one._seq_num);
-}
-
-inline unsigned
-hashcode(DuplicatePair p) 
-{
-  return hashcode(p._address) + hashcode(p._seq_num);
-}
-
-
-class OLSRDuplicateSet: public Element{
+class OLSRDuplicateSet: public Element, public OLSRExpiryQueue::Client, public OLSRMemoryReport::Client{
 public:
   OLSRDuplicateSet();
   ~OLSRDuplicateSet();
@@ -49,24 +26,112 @@ public:
   int configure(Vector<String> &conf, ErrorHandler *errh);
   int initialize(ErrorHandler *);
   void uninitialize();
+  void take_state(Element *, ErrorHandler *);
+  void add_handlers();
+  void *cast(const char *);
+  void memory_usage(Vector<OLSRMemoryReport::Usage> &);
+  void hash_stats(StringAccum &);
 
   struct duplicate_data *find_duplicate_entry(IPAddress address, int seq_num);
-  struct duplicate_data *add_duplicate_entry(IPAddress address, int seq_num);
+  // returns 0 also if there are MAX_ORIGINATORS originators already and
+  // none could be evicted
+  struct duplicate_data *add_duplicate_entry(IPAddress address, int seq_num, olsr_time_t time);
   void remove_duplicate_entry(IPAddress address, int seq_num);
 
-  void add_packet_seq(IPAddress iface_addr, int seq_num);
+  // authentication verdicts of OLSRAuthenticate, kept in the windows with
+  // the tuples: add_verified records the digest a message was verified
+  // with (false if there is no room for it), verified() tells whether a
+  // copy with that digest need not be verified again, which is only when
+  // the message has a tuple too, as a copy of it is then never processed,
+  // and verified_digest() gives the digest to forward the message with
+  bool add_verified(IPAddress address, int seq_num, const uint8_t *digest, olsr_time_t time);
+  inline bool verified(IPAddress address, int seq_num, const uint8_t *digest);
+  const uint8_t *verified_digest(IPAddress address, int seq_num);
+
+  // changes whenever a lookup could change its answer other than by a
+  // tuple being added for that same message: windows sliding or appearing,
+  // tuples removed or expired. Tuple pointers stay valid while it does not
+  uint32_t generation() const		{ return _generation; }
+
+  // records pkt_seq as the newest packet sequence number seen from
+  // iface_addr, or returns true if it is not newer than the one recorded
+  // (RFC 3626 section 19)
+  inline bool packet_seq_old(IPAddress iface_addr, int pkt_seq);
   void remove_packet_seq(IPAddress iface_addr);
-  void update_packet_seq(IPAddress iface_addr, int seq_num);
-  int find_packet_seq(IPAddress iface_addr);
 
 private:
-  typedef HashMap<DuplicatePair, void *> DuplicateSet;
+  // The duplicate tuples of one originator, for the OLSR_DUPLICATE_WINDOW
+  // message sequence numbers up to and including the newest one seen.
+  // Bit i of seen is set if there is a tuple for sequence number top - i;
+  // the tuple itself lives in slot[(top - i) % OLSR_DUPLICATE_WINDOW].
+  // Older sequence numbers fall out of the window. Bit i of verified is
+  // set if the message was authenticated, with the digest in its slot.
+  enum { OLSR_DUPLICATE_WINDOW = 32 };
+
+  struct DuplicateWindow {
+    uint16_t top;
+    uint32_t seen;
+    uint32_t verified;
+    duplicate_data slot[OLSR_DUPLICATE_WINDOW];
+
+    DuplicateWindow() : top(0), seen(0), verified(0) { }
+  };
+
+  typedef HashMap<IPAddress, DuplicateWindow> DuplicateSet;
   DuplicateSet *_duplicateSet;
+  duplicate_data _stale;
+  OLSRExpiryHeap<IPAddress> _expiry;
   Timer _timer;
-  HashMap<IPAddress, int> *_packetSeqList;
-
+  OLSRExpiryQueue *_expiryQueue;
+  uint32_t _generation;
+  // newest packet sequence number per neighbor interface, tagged with
+  // PACKET_SEQ_KNOWN so that sequence number 0 is told from no entry;
+  // entries are removed with the interface's link tuple
+  enum { PACKET_SEQ_KNOWN = 0x10000 };
+  FlatHashMap<IPAddress, uint32_t> _packetSeqs;
+  OLSRAdmission _admission;	// capacity in originators, no rate
+
+  bool make_room();
+  DuplicateWindow *window_for(IPAddress address, int seq_num, olsr_time_t time, int &age);
+  static String admission_handler(Element *, void *);
+
+  static olsr_time_t expire_window(DuplicateWindow *window, olsr_time_t now);
+  struct WindowExpiry {
+    olsr_time_t now;
+    WindowExpiry(olsr_time_t n) : now(n) { }
+    olsr_time_t operator()(DuplicateWindow &w) const { return expire_window(&w, now); }
+  };
+  olsr_time_t run_expiry(olsr_time_t now);
   void run_timer(Timer *);
 };
 
+inline bool
+OLSRDuplicateSet::packet_seq_old(IPAddress iface_addr, int pkt_seq)
+{
+  uint32_t &entry = _packetSeqs.find_force(iface_addr, 0);
+  uint16_t seq = pkt_seq;
+  if (entry & PACKET_SEQ_KNOWN) {
+    int16_t newer = (int16_t) (seq - (uint16_t) entry);
+    if (newer <= 0)
+      return true;
+  }
+  entry = PACKET_SEQ_KNOWN | seq;
+  return false;
+}
+
+inline bool
+OLSRDuplicateSet::verified(IPAddress address, int seq_num, const uint8_t *digest)
+{
+  DuplicateWindow *window = _duplicateSet->findp(address);
+  if (! window)
+    return false;
+  int16_t age = (int16_t) (window->top - (uint16_t) seq_num);
+  if (age < 0 || age >= OLSR_DUPLICATE_WINDOW
+      || ! (window->seen & window->verified & (1U << age)))
+    return false;
+  return memcmp(window->slot[(uint16_t) seq_num % OLSR_DUPLICATE_WINDOW].D_digest,
+		digest, OLSR_AUTH_DIGEST_SIZE) == 0;
+}
+
 CLICK_ENDDECLS
 #endif
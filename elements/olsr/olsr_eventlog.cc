@@ -0,0 +1,183 @@
+/*
+ * olsr_eventlog.{cc,hh} -- ring buffer of route, neighbor and MPR set
+ * changes, read by management clients through a handler
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/router.hh>
+#include "olsr_eventlog.hh"
+
+CLICK_DECLS
+
+OLSREventLog::OLSREventLog()
+  : _next(0), _first(0)
+{
+}
+
+
+OLSREventLog::~OLSREventLog()
+{
+}
+
+
+int
+OLSREventLog::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *routing_table, *neighbor_info = 0;
+  _capacity = 1024;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRRoutingTable element", &routing_table,
+		  cpKeywords,
+		  "NEIGHBORS", cpElement, "OLSRNeighborInfoBase element", &neighbor_info,
+		  "CAPACITY", cpInteger, "number of events kept", &_capacity,
+		  0) < 0)
+    return -1;
+
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("%s is not an OLSRRoutingTable", routing_table->name().c_str());
+  _neighborInfo = 0;
+  if (neighbor_info
+      && !(_neighborInfo = (OLSRNeighborInfoBase *) neighbor_info->cast("OLSRNeighborInfoBase")))
+    return errh->error("%s is not an OLSRNeighborInfoBase", neighbor_info->name().c_str());
+  if (_capacity <= 0 || _capacity > (1 << 20))
+    return errh->error("CAPACITY must be between 1 and %d", 1 << 20);
+  return 0;
+}
+
+
+int
+OLSREventLog::initialize(ErrorHandler *)
+{
+  _ring.resize(_capacity);
+  _routingTable->add_listener(this);
+  if (_neighborInfo)
+    _neighborInfo->add_listener(this);
+  return 0;
+}
+
+
+void
+OLSREventLog::record(int type, const IPRoute &route, const Timestamp &now)
+{
+  Event &e = _ring[_next % _capacity];
+  e.seq = _next;
+  e.type = type;
+  e.time = now;
+  e.route = route;
+  _next++;
+  if (_next - _first > (uint32_t) _capacity)
+    _first = _next - _capacity;
+}
+
+
+void
+OLSREventLog::routes_changed(const Vector<OLSRRoutingTable::RouteChange> &delta)
+{
+  Timestamp now = Timestamp::now();
+  for (int i = 0; i < delta.size(); i++)
+    switch (delta[i].type) {
+    case OLSRRoutingTable::ROUTE_ADDED:
+      record(EV_ROUTE_ADD, delta[i].route, now);
+      break;
+    case OLSRRoutingTable::ROUTE_CHANGED:
+      record(EV_ROUTE_CHANGE, delta[i].route, now);
+      break;
+    default:
+      record(EV_ROUTE_REMOVE, delta[i].route, now);
+      break;
+    }
+}
+
+
+void
+OLSREventLog::neighbor_changed(const IPAddress &main_addr, bool up)
+{
+  Timestamp now = Timestamp::now();
+  record(up ? EV_NEIGHBOR_UP : EV_NEIGHBOR_DOWN, IPRoute(main_addr, IPAddress(), IPAddress(), -1), now);
+}
+
+
+void
+OLSREventLog::mprs_changed(const Vector<IPAddress> &added, const Vector<IPAddress> &removed)
+{
+  Timestamp now = Timestamp::now();
+  for (int i = 0; i < added.size(); i++)
+    record(EV_MPR_ADD, IPRoute(added[i], IPAddress(), IPAddress(), -1), now);
+  for (int i = 0; i < removed.size(); i++)
+    record(EV_MPR_REMOVE, IPRoute(removed[i], IPAddress(), IPAddress(), -1), now);
+}
+
+
+static const char * const event_names[] = {
+  "route_add", "route_change", "route_remove",
+  "neighbor_up", "neighbor_down", "mpr_add", "mpr_remove"
+};
+
+
+int
+OLSREventLog::events_handler(int, String &s, Element *e, const Handler *, ErrorHandler *errh)
+{
+  OLSREventLog *log = (OLSREventLog *) e;
+  uint32_t seq = 0;
+  String arg = cp_uncomment(s);
+  if (arg && !cp_integer(arg, &seq))
+    return errh->error("expected sequence number");
+
+  // sequence numbers wrap, so compare differences
+  uint32_t lost = 0;
+  if ((int32_t) (seq - log->_first) < 0) {
+    lost = log->_first - seq;
+    seq = log->_first;
+  } else if ((int32_t) (log->_next - seq) < 0)
+    seq = log->_next;
+
+  StringAccum sa;
+  sa << "next " << log->_next << " lost " << lost << "\n";
+  for (; seq != log->_next; seq++) {
+    const Event &ev = log->_ring[seq % log->_capacity];
+    sa << ev.seq << ' ' << ev.time << ' ' << event_names[ev.type] << ' ';
+    if (ev.type <= EV_ROUTE_REMOVE)
+      sa << ev.route.addr << '/' << ev.route.prefix_len() << ' '
+	 << ev.route.gw << ' ' << ev.route.port << "\n";
+    else
+      sa << ev.route.addr << "\n";
+  }
+  s = sa.take_string();
+  return 0;
+}
+
+
+String
+OLSREventLog::next_handler(Element *e, void *)
+{
+  OLSREventLog *log = (OLSREventLog *) e;
+  return String(log->_next) + "\n";
+}
+
+
+int
+OLSREventLog::clear_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSREventLog *log = (OLSREventLog *) e;
+  log->_first = log->_next;
+  return 0;
+}
+
+
+void
+OLSREventLog::add_handlers()
+{
+  set_handler("events", Handler::OP_READ | Handler::READ_PARAM, events_handler);
+  add_read_handler("next", next_handler, 0);
+  add_write_handler("clear", clear_handler, 0);
+}
+
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<OLSREventLog::Event>;
+#endif
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSREventLog);
@@ -0,0 +1,131 @@
+/*
+  =c
+  OLSREventLog(OLSRRoutingTable element [, KEYWORDS])
+
+  =s
+  OLSR specific element, records changes of the OLSR state for management clients
+
+  =io
+  None
+
+  =d
+  Keeps a log of the changes to the routes of the OLSRRoutingTable element
+  given as argument and, with NEIGHBORS, to the neighbor set and the MPR set,
+  so that management programs can follow them through the C<events> handler
+  instead of polling and comparing the table handlers. Every event gets the
+  next sequence number and the time it happened. The log is a ring of
+  CAPACITY events; the oldest events are overwritten once it is full.
+
+  Events are written one per line as `C<SEQ TIME TYPE ARGS>', with these
+  types:
+
+  =over 8
+
+  =item route_add, route_change, route_remove
+
+  ARGS are the route, as `C<ADDR/MASK GW PORT>'; for route_change the new
+  route.
+
+  =item neighbor_up, neighbor_down
+
+  ARGS is the neighbor's main address.
+
+  =item mpr_add, mpr_remove
+
+  ARGS is the main address of a neighbor elected MPR, or no longer MPR.
+
+  =back
+
+  A client reads C<events> with the sequence number it wants next, 0 at
+  first. The reply starts with the line `C<next N lost L>': read from N next
+  time. L is the number of events the client missed because they were
+  overwritten meanwhile, after which it should read the tables anew. A read
+  when nothing happened costs that one line, so a client can read as often
+  as it likes; through ControlSocket, `C<READ events N>'.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item NEIGHBORS
+
+  OLSRNeighborInfoBase element. Also records neighbor and MPR set changes.
+
+  =item CAPACITY
+
+  Integer. Number of events kept. Default is 1024.
+
+  =back
+
+  =h events read-only
+  Takes the sequence number SEQ and returns the events from SEQ on.
+
+  =h next read-only
+  Sequence number of the next event.
+
+  =h clear write-only
+  Drops all events; sequence numbers go on.
+
+  =a
+  OLSRRoutingTable, OLSRNeighborInfoBase, ControlSocket */
+
+#ifndef OLSR_EVENTLOG_HH
+#define OLSR_EVENTLOG_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/timestamp.hh>
+#include <click/vector.hh>
+#include "../ip/iproutetable.hh"
+#include "olsr_rtable.hh"
+#include "olsr_neighbor_infobase.hh"
+
+CLICK_DECLS
+
+class OLSREventLog : public Element, public OLSRRoutingTable::Listener,
+		     public OLSRNeighborInfoBase::Listener { public:
+
+  OLSREventLog();
+  ~OLSREventLog();
+
+  const char *class_name() const	{ return "OLSREventLog"; }
+  const char *port_count() const	{ return "0/0"; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  void routes_changed(const Vector<OLSRRoutingTable::RouteChange> &delta);
+  void neighbor_changed(const IPAddress &main_addr, bool up);
+  void mprs_changed(const Vector<IPAddress> &added, const Vector<IPAddress> &removed);
+
+  enum { EV_ROUTE_ADD, EV_ROUTE_CHANGE, EV_ROUTE_REMOVE,
+	 EV_NEIGHBOR_UP, EV_NEIGHBOR_DOWN, EV_MPR_ADD, EV_MPR_REMOVE };
+
+  struct Event {
+    uint32_t seq;
+    int type;
+    Timestamp time;
+    IPRoute route;		// route events; else addr is the neighbor
+  };
+
+private:
+
+  OLSRRoutingTable *_routingTable;
+  OLSRNeighborInfoBase *_neighborInfo;
+  int _capacity;
+
+  Vector<Event> _ring;		// event seq at seq % _capacity
+  uint32_t _next;		// sequence number of the next event
+  uint32_t _first;		// oldest event kept
+
+  void record(int type, const IPRoute &route, const Timestamp &now);
+
+  static int events_handler(int, String &, Element *, const Handler *, ErrorHandler *);
+  static String next_handler(Element *, void *);
+  static int clear_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,138 @@
+/*
+ * olsr_expiry_queue.{cc,hh} -- expiry heaps and a shared expiry timer for
+ * the OLSR information bases
+ */
+
+#include <click/config.h>
+#include "olsr_expiry_queue.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+void
+OLSRExpiryQueue::Client::set_expiry(OLSRExpiryQueue *queue, Timer *timer)
+{
+  _expiry_queue = queue;
+  _expiry_timer = timer;
+}
+
+
+void
+OLSRExpiryQueue::Client::expire_at(olsr_time_t when)
+{
+  if (_expiry_queue)
+    _expiry_queue->schedule(this, when);
+  else if (_expiry_timer) {
+    Timestamp expiry = olsr_timer_expiry(when);
+    if (!_expiry_timer->scheduled() || expiry < _expiry_timer->expiry())
+      _expiry_timer->schedule_at(expiry);
+  }
+}
+
+
+void
+OLSRExpiryQueue::Client::run_expiry_timer()
+{
+  olsr_time_t next_timeout = run_expiry(olsr_now());
+  if (next_timeout)
+    expire_at(next_timeout);
+}
+
+
+OLSRExpiryQueue::OLSRExpiryQueue()
+  : _timer(this)
+{
+}
+
+
+OLSRExpiryQueue::~OLSRExpiryQueue()
+{
+}
+
+
+int
+OLSRExpiryQueue::initialize(ErrorHandler *)
+{
+  _timer.initialize(this);
+  reschedule();
+  return 0;
+}
+
+
+void
+OLSRExpiryQueue::add_handlers()
+{
+  add_task_handlers(_timer.task(), "timer_");
+}
+
+
+void
+OLSRExpiryQueue::schedule(Client *client, olsr_time_t when)
+{
+  int i;
+  for (i = 0; i < _deadlines.size(); i++)
+    if (_deadlines[i].client == client)
+      break;
+  if (i == _deadlines.size()) {
+    Deadline d;
+    d.client = client;
+    d.when = 0;
+    _deadlines.push_back(d);
+  }
+
+  olsr_time_t &pending = _deadlines[i].when;
+  if (!pending || when < pending)
+    pending = when;
+
+  if (_timer.initialized()) {
+    Timestamp expiry = olsr_timer_expiry(when);
+    if (!_timer.scheduled() || expiry < _timer.expiry())
+      _timer.schedule_at(expiry);
+  }
+}
+
+
+void
+OLSRExpiryQueue::reschedule()
+{
+  olsr_time_t next_timeout = 0;
+  for (int i = 0; i < _deadlines.size(); i++) {
+    olsr_time_t when = _deadlines[i].when;
+    if (when && (!next_timeout || when < next_timeout))
+      next_timeout = when;
+  }
+  if (next_timeout)
+    _timer.schedule_at(olsr_timer_expiry(next_timeout));
+}
+
+
+void
+OLSRExpiryQueue::run_timer(Timer *)
+{
+  olsr_time_t now = olsr_now();
+
+  // a client's expiry can register deadlines for other clients, so index
+  // into _deadlines afresh every time
+  for (int i = 0; i < _deadlines.size(); i++) {
+    olsr_time_t when = _deadlines[i].when;
+    if (!when || now < when)
+      continue;
+    _deadlines[i].when = 0;
+    olsr_time_t next_timeout = _deadlines[i].client->run_expiry(now);
+    if (next_timeout)
+      schedule(_deadlines[i].client, next_timeout);
+  }
+
+  _timer.unschedule();
+  reschedule();
+}
+
+
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<OLSRExpiryQueue::Deadline>;
+#endif
+
+CLICK_ENDDECLS
+
+EXPORT_ELEMENT(OLSRExpiryQueue);
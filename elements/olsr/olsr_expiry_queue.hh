@@ -0,0 +1,199 @@
+#ifndef OLSR_EXPIRY_QUEUE_HH
+#define OLSR_EXPIRY_QUEUE_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+#include <click/algorithm.hh>
+#include "olsr_control_timer.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+/*
+=c
+
+OLSRExpiryQueue()
+
+=s OLSR
+
+shared expiry timer for the OLSR information bases
+
+=d
+
+The OLSR information bases (OLSRLinkInfoBase, OLSRNeighborInfoBase,
+OLSRTopologyInfoBase, OLSRInterfaceInfoBase, OLSRAssociationInfoBase and
+OLSRDuplicateSet) keep their tuples in a min-heap ordered by expiry time,
+so an expiry run only looks at the tuples that are due instead of scanning
+the whole set. Tuples whose time was extended in the meantime are simply
+put back into the heap.
+
+By default each information base arms a Timer of its own for its earliest
+deadline. Given the keyword EXPIRY_QUEUE naming an OLSRExpiryQueue they
+register that deadline here instead, and the single Timer of this element
+serves all of them.
+
+The expiries run on the home thread of this element: when the Timer fires
+on another thread, a Task takes over. On a multithreaded router, bind
+OLSRExpiryQueue with StaticThreadSched to the thread that processes the
+OLSR messages, so the unlocked information bases change on that thread
+only.
+
+=a OLSRLinkInfoBase, OLSRNeighborInfoBase, OLSRTopologyInfoBase,
+OLSRInterfaceInfoBase, OLSRAssociationInfoBase, OLSRDuplicateSet */
+
+class OLSRExpiryQueue: public Element{
+public:
+
+  class Client { public:
+
+    Client() : _expiry_queue(0), _expiry_timer(0) { }
+    virtual ~Client() { }
+
+    // expire all tuples due at or before now; returns the next deadline,
+    // or zero if no tuple is left
+    virtual olsr_time_t run_expiry(olsr_time_t now) = 0;
+
+    void set_expiry(OLSRExpiryQueue *queue, Timer *timer);
+    void expire_at(olsr_time_t when);
+    void run_expiry_timer();
+
+  private:
+
+    OLSRExpiryQueue *_expiry_queue;
+    Timer *_expiry_timer;
+
+  };
+
+  OLSRExpiryQueue();
+  ~OLSRExpiryQueue();
+
+  const char* class_name() const { return "OLSRExpiryQueue"; }
+  OLSRExpiryQueue *clone() const { return new OLSRExpiryQueue(); }
+  const char *port_count() const  { return "0/0"; }
+
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  void schedule(Client *client, olsr_time_t when);
+
+private:
+
+  struct Deadline {
+    Client *client;
+    olsr_time_t when;		// zero if nothing is pending
+  };
+
+  Vector<Deadline> _deadlines;
+  OLSRControlTimer _timer;
+
+  void reschedule();
+  void run_timer(Timer *);
+};
+
+
+// Min-heap of (expiry time, key) used by the information bases. Entries are
+// never removed or updated in place: an entry whose tuple is gone is dropped
+// when it reaches the top, one whose tuple was refreshed is pushed again with
+// the new time.
+template <typename K>
+class OLSRExpiryHeap{
+public:
+
+  bool empty() const		{ return _heap.empty(); }
+  size_t size() const		{ return _heap.size(); }
+  olsr_time_t next() const	{ return _heap[0].when; }
+
+  void push(olsr_time_t when, const K &key) {
+    Entry e;
+    e.when = when;
+    e.key = key;
+    _heap.push_back(e);
+    push_heap(_heap.begin(), _heap.end(), entry_less());
+  }
+
+  // adds an entry without restoring the heap order, for loading many
+  // tuples at once; rebuild() must follow before next(), push() or pop()
+  void append(olsr_time_t when, const K &key) {
+    Entry e;
+    e.when = when;
+    e.key = key;
+    _heap.push_back(e);
+  }
+
+  // restores the heap order after append()s in one bottom-up pass
+  void rebuild() {
+    for (int i = _heap.size() / 2 - 1; i >= 0; i--)
+      sift_down(i);
+  }
+
+  K pop() {
+    pop_heap(_heap.begin(), _heap.end(), entry_less());
+    K key = _heap.back().key;
+    _heap.pop_back();
+    return key;
+  }
+
+  // Tuples removed and added again leave stale entries behind. Once the
+  // entries outnumber the live tuples of set by far, rebuilds the heap from
+  // set, with time_of(value) as the time of each tuple; returns whether it
+  // did. time_of is a member pointer such as &link_data::L_time, or a
+  // function object taking the value.
+  template <typename Map, typename TimeOf>
+  bool compact_if_stale(Map &set, TimeOf time_of) {
+    if (size() <= 2 * set.size() + 16)
+      return false;
+    _heap.clear();
+    for (typename Map::iterator iter = set.begin(); iter != set.end(); iter++)
+      append(time_of(iter.value()), iter.key());
+    rebuild();
+    return true;
+  }
+
+  template <typename Map, typename V>
+  bool compact_if_stale(Map &set, olsr_time_t V::*time) {
+    return compact_if_stale(set, member_time<V>(time));
+  }
+
+  void clear()			{ _heap.clear(); }
+  void swap(OLSRExpiryHeap<K> &o)	{ _heap.swap(o._heap); }
+  size_t bytes() const		{ return _heap.capacity() * sizeof(Entry); }
+
+private:
+
+  struct Entry {
+    olsr_time_t when;
+    K key;
+  };
+
+  struct entry_less {
+    bool operator()(const Entry &a, const Entry &b) const { return a.when < b.when; }
+  };
+
+  template <typename V>
+  struct member_time {
+    olsr_time_t V::*_time;
+    member_time(olsr_time_t V::*time) : _time(time) { }
+    olsr_time_t operator()(const V &v) const { return v.*_time; }
+  };
+
+  Vector<Entry> _heap;
+
+  void sift_down(int i) {
+    int n = _heap.size();
+    Entry e = _heap[i];
+    for (int child = 2 * i + 1; child < n; child = 2 * i + 1) {
+      if (child + 1 < n && _heap[child + 1].when < _heap[child].when)
+	child++;
+      if (!(_heap[child].when < e.when))
+	break;
+      _heap[i] = _heap[child];
+      i = child;
+    }
+    _heap[i] = e;
+  }
+
+};
+
+CLICK_ENDDECLS
+#endif
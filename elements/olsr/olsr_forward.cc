@@ -2,14 +2,17 @@
 
 #include <click/config.h>
 #include <click/confparse.hh>
+#include <click/straccum.hh>
 #include "click_olsr.hh"
 #include "olsr_forward.hh"
 #include "olsr_packethandle.hh"
 #include <click/packet_anno.hh>
+#include <click/standard/scheduleinfo.hh>
 
 CLICK_DECLS
 
 OLSRForward::OLSRForward()
+  : _pending(0), _task(this)
 {
 }
 
@@ -21,6 +24,8 @@ int
 OLSRForward::configure(Vector<String> &conf, ErrorHandler *errh)
 {
  int dup_hold_time;
+  _batch = false;
+  _mtu = 1472;
   if (cp_va_parse(conf, this, errh,
   		  cpInteger, "Duplicate Holding Time (sec)",&dup_hold_time,
 		  cpElement, "DuplicateSet Element", &_duplicateSet, 
@@ -28,110 +33,297 @@ OLSRForward::configure(Vector<String> &conf, ErrorHandler *errh)
 		  cpElement, "InterfaceInfoBase Element", &_interfaceInfo,
 		  cpElement, "localIfInfoBase Element", &_localIfInfoBase,
 		  cpIPAddress, "main IP address", &_myMainIP,
+		  cpKeywords,
+		  "BATCH", cpBool, "collect retransmitted messages", &_batch,
+		  "MTU", cpInteger, "largest OLSR packet in BATCH mode", &_mtu,
 		  0) < 0)
     return -1;
- _dup_hold_time=make_timeval (dup_hold_time,0);
+ _dup_hold_time = olsr_msec(dup_hold_time * 1000);
   return 0;
 }
 
 int 
-OLSRForward::initialize(ErrorHandler *)
+OLSRForward::initialize(ErrorHandler *errh)
 {
   _msg_seq = 0;
+  //entries of no generation: the first lookup of each sender misses
+  for (int i = 0; i < SENDER_CACHE_SIZE; i++){
+    _senders[i].iface_generation = _interfaceInfo->generation() - 1;
+    _senders[i].selector_generation = _neighborInfo->mpr_selector_generation() - 1;
+  }
+  _sender_hits = _sender_misses = 0;
+  ScheduleInfo::initialize_task(this, &_task, false, errh);
   return 0;
 }
 
+void
+OLSRForward::cleanup(CleanupStage)
+{
+  if (_pending)
+    _pending->kill();
+  _pending = 0;
+}
+
+void
+OLSRForward::take_state(Element *e, ErrorHandler *)
+{
+  // neighbors would drop our messages as duplicates if the sequence
+  // numbers started over
+  if (OLSRForward *old = (OLSRForward *) e->cast("OLSRForward"))
+    _msg_seq = old->_msg_seq;
+}
+
 void
 OLSRForward::push(int port, Packet *packet)
 {
-    struct timeval now;
-  click_gettimeofday(&now);
+  olsr_time_t now = olsr_now();
+  int out;
+  if ((packet = forward(port, packet, now, out)))
+    output(out).push(packet);
+}
+
+
+//each message still sees the duplicate tuples of the ones before it, only
+//the outputs wait: nothing downstream of them changes the duplicate set
+void
+OLSRForward::push_batch(int port, PacketBatch &batch)
+{
+  olsr_time_t now = olsr_now();
+  PacketBatch out[2];
+  while (Packet *packet = batch.pop_front()){
+    int o;
+    if ((packet = forward(port, packet, now, o)))
+      out[o].push_back(packet);
+  }
+  output(0).push_batch(out[0]);
+  output(1).push_batch(out[1]);
+}
+
+
+//whether the node whose interface source_addr sent a message selected this
+//node as MPR. Flooded TC and HNA messages arrive from a handful of
+//neighbors, so the answer is nearly always in the cache
+bool
+OLSRForward::sender_is_mpr_selector(IPAddress source_addr)
+{
+  uint32_t a = ntohl(source_addr.addr());
+  Sender &s = _senders[(a ^ (a >> 8)) & (SENDER_CACHE_SIZE - 1)];
+  unsigned iface_generation = _interfaceInfo->generation();
+  unsigned selector_generation = _neighborInfo->mpr_selector_generation();
+  if (s.addr == source_addr && s.iface_generation == iface_generation){
+    if (s.selector_generation != selector_generation){
+      s.selector = _neighborInfo->is_mpr_selector(s.main_addr);
+      s.selector_generation = selector_generation;
+      _sender_misses++;
+    }
+    else
+      _sender_hits++;
+    return s.selector;
+  }
+  s.addr = source_addr;
+  s.main_addr = _interfaceInfo->get_main_address(source_addr);
+  s.selector = _neighborInfo->is_mpr_selector(s.main_addr);
+  s.iface_generation = iface_generation;
+  s.selector_generation = selector_generation;
+  _sender_misses++;
+  return s.selector;
+}
+
+
+//returns the packet to emit and sets out to its output, or returns null if
+//the packet was consumed
+Packet *
+OLSRForward::forward(int port, Packet *packet, olsr_time_t now, int &out)
+{
+  //cycles spent here, not counting the elements the packets are pushed to
+  click_cycles_t start = click_get_cycles();
 
   int paint=static_cast<int>(PAINT_ANNO(packet));//packets get marked with paint 0..N depending on Interface they arrive on
   IPAddress receiving_If_IP=_localIfInfoBase->get_iface_addr(paint); //gets IP of Interface N
+  out = 1; //discard
   if (port == 0){
-      bool retransmit=false;
-    msg_hdr_info msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, 0);
-    
-    if (msg_info.originator_address != _myMainIP){
-      //step 2
-      duplicate_data *duplicate_tuple = _duplicateSet->find_duplicate_entry(msg_info.originator_address, msg_info.msg_seq);
+    bool retransmit=false;
+    OLSRMessageView msg(packet, 0);
+    int msg_type = msg.type();
+    int msg_size = msg.size();
+    int counter = OLSRMessageStats::DISCARDED;
+
+    if (msg.originator() != _myMainIP){
+      //step 2; OLSRClassifier has looked already. Its answer still holds if
+      //the duplicate set's generation has not changed: tuples added since
+      //are those of other messages, as the classifier lets a second copy of
+      //a message wait until the first has been forwarded
+      int dup = OLSR_DUPLICATE_ANNO(packet);
+      duplicate_data *duplicate_tuple;
+      if (dup != OLSR_DUP_LOOKED_UP || OLSR_DUPLICATE_GEN_ANNO(packet) != _duplicateSet->generation())
+	duplicate_tuple = _duplicateSet->find_duplicate_entry(msg.originator(), msg.seq());
+      else
+	duplicate_tuple = (duplicate_data *) OLSR_DUPLICATE_TUPLE_ANNO(packet);
       if (duplicate_tuple != 0){
-	
 	if (duplicate_tuple->D_retransmitted){
-	  //olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) packet->data();
-	 //click_chatter ("FORWARD (node %s): DROPPING message from %s received on interface %s messagetype  --  ALREADY RETRANSMITTED: %d\n",_myMainIP.unparse().cc(),msg_info.originator_address.unparse().cc(), receiving_If_IP.unparse().cc(),msg_hdr->msg_type);
-	  output(1).push(packet); //discard
-	  return;
+	  _stats.count(OLSRMessageStats::DUPLICATE, paint, msg_type, msg_size);
+	  _stats.cycles.add(click_get_cycles() - start);
+	  return packet;
 	}
 	//check if interface msg was received on is in D_iface_list
 	for (int i = 0; i < duplicate_tuple->D_iface_list.size(); i++){
-	  IPAddress iface_address = duplicate_tuple->D_iface_list.at(i);
-	  if (iface_address == receiving_If_IP){
-	    //olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) packet->data();
-	 //click_chatter ("FORWARD (node %s): DROPPING message from %s received on interface %s messagetype  --  receiving INTERFACE on D_iface_list: %d\n",_myMainIP.unparse().cc(),msg_info.originator_address.unparse().cc(), receiving_If_IP.unparse().cc(),msg_hdr->msg_type);
-	    output(1).push(packet); //discard
-	    return;
+	  if (duplicate_tuple->D_iface_list.at(i) == receiving_If_IP){
+	    _stats.count(OLSRMessageStats::DUPLICATE, paint, msg_type, msg_size);
+	    _stats.cycles.add(click_get_cycles() - start);
+	    return packet;
 	  }
 	}
       }
-        //step 4
-      
+
+      //step 4
       IPAddress source_addr = packet->dst_ip_anno();
-      IPAddress source_addr_main_IP =  _interfaceInfo->get_main_address(source_addr);
-      if (_neighborInfo->is_mpr_selector(source_addr_main_IP)){
-  	if (msg_info.ttl > 1)//message must be retransmitted
-	retransmit=true;
-	 //else click_chatter ("DISCARDING message because of TTL\n");
-	  if (duplicate_tuple == 0)
-	    duplicate_tuple = _duplicateSet->add_duplicate_entry(msg_info.originator_address, msg_info.msg_seq);
-	  duplicate_tuple->D_time = now + _dup_hold_time;
-	  duplicate_tuple->D_iface_list.push_back(receiving_If_IP);
-	  duplicate_tuple->D_retransmitted = retransmit;
-	  }
-	  //else click_chatter ("DISCARDING message because main Address %s of source Address %s is NOT an MPR Selector\n",source_addr.unparse().cc(),source_addr_main_IP.unparse().cc());
-	 }
-	  if (retransmit)
-	  {
-	  olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) packet->data();
-	  msg_hdr->ttl = msg_hdr->ttl - 1;
-	  msg_hdr->hop_count = msg_hdr->hop_count + 1;
-	//adding olsr packet header
-	packet=packet->push(sizeof(olsr_pkt_hdr));
-	olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) packet->data();
-	pkt_hdr->pkt_length = htons(msg_info.msg_size + sizeof(olsr_pkt_hdr));
-	pkt_hdr->pkt_seq = 0;
-	output(0).push(packet); //forward packet
-	//click_chatter ("FORWARD (node %s): relaying message from %s received on interface %s messagetype: %d\n",_myMainIP.unparse().cc(),msg_info.originator_address.unparse().cc(), receiving_If_IP.unparse().cc(),msg_hdr->msg_type);
-	return;
+      if (sender_is_mpr_selector(source_addr)){
+	if (msg.ttl() > 1)//message must be retransmitted
+	  retransmit=true;
+	if (duplicate_tuple == 0
+	    && !(duplicate_tuple = _duplicateSet->add_duplicate_entry(msg.originator(), msg.seq(), now + _dup_hold_time))){
+	  //fell out of the duplicate window: too old to forward
+	  _stats.count(OLSRMessageStats::DUPLICATE, paint, msg_type, msg_size);
+	  _stats.cycles.add(click_get_cycles() - start);
+	  return packet;
 	}
-	else
-	 {
-	 //olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) packet->data();
-	 //click_chatter ("FORWARD (node %s): DROPPING message from %s received on interface %s messagetype: %d\n",_myMainIP.unparse().cc(),msg_info.originator_address.unparse().cc(), receiving_If_IP.unparse().cc(),msg_hdr->msg_type);
-	 output(1).push(packet); //discard
-	 
-         return;
+	duplicate_tuple->D_time = now + _dup_hold_time;
+	duplicate_tuple->D_iface_list.push_back(receiving_If_IP);
+	duplicate_tuple->D_retransmitted = retransmit;
       }
+      else
+	counter = OLSRMessageStats::NOT_MPR_SELECTOR;
     }
+    if (retransmit){
+      _stats.count(OLSRMessageStats::FORWARDED, paint, msg_type, msg_size);
+      out = 0; //forward packet
+      return retransmit_message(packet, start);
+    }
+    _stats.count(counter, paint, msg_type, msg_size);
+    _stats.cycles.add(click_get_cycles() - start);
+    return packet;
+  }
   else if ( port == 1 ) { //packets from self, and msg_seq
-      msg_hdr_info msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, sizeof(olsr_pkt_hdr));
-    olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) packet->data();
-    pkt_hdr->pkt_length = htons(msg_info.msg_size + sizeof(olsr_pkt_hdr));
+    WritablePacket *q = packet->uniqueify();
+    if (!q){
+      _stats.cycles.add(click_get_cycles() - start);
+      return 0;
+    }
+    olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) q->data();
+    pkt_hdr->pkt_length = htons(OLSRMessageView(q, sizeof(olsr_pkt_hdr)).size() + sizeof(olsr_pkt_hdr));
     pkt_hdr->pkt_seq = 0;
     olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (pkt_hdr + 1);
     msg_hdr->msg_seq = htons ( get_msg_seq() );
-    //click_chatter ("FORWARD (node %s) broadcasting message from me: messagetype: %d\n",_myMainIP.unparse().cc(),msg_hdr->msg_type);
-    output(0).push(packet); //forward packet
-    return;
+    _stats.count(OLSRMessageStats::GENERATED, paint, msg_hdr->msg_type, ntohs(pkt_hdr->pkt_length) - sizeof(olsr_pkt_hdr));
+    _stats.cycles.add(click_get_cycles() - start);
+    out = 0; //forward packet
+    return q;
   }
   else{
     click_chatter("reached end of OLSRForward::push, discarding packet"); //should never get here
-    output(1).push(packet);//discard packet
+    return packet;
   }
 }
 
 
+void
+OLSRForward::add_handlers()
+{
+  _stats.add_handlers(this);
+  add_read_handler("sender_cache", read_sender_cache, 0);
+}
+
+
+String
+OLSRForward::read_sender_cache(Element *e, void *)
+{
+  OLSRForward *f = (OLSRForward *) e;
+  StringAccum sa;
+  sa << "hits " << f->_sender_hits << '\n'
+     << "misses " << f->_sender_misses << '\n';
+  return sa.take_string();
+}
+
+
+//start: cycle count when push() got the packet, for the accounting;
+//returns the packet to forward, or null if it is held back or consumed
+WritablePacket *
+OLSRForward::retransmit_message(Packet *packet, click_cycles_t start)
+{
+  int msg_size = OLSRMessageView(packet, 0).size();
+
+  if (_batch && _pending){
+    if ((int) _pending->length() + msg_size <= _mtu){
+      //append the message behind the ones already collected
+      WritablePacket *q = _pending->put(msg_size);
+      if (!q){
+	_pending = 0;
+	packet->kill();
+	_stats.cycles.add(click_get_cycles() - start);
+	return 0;
+      }
+      _pending = q;
+      olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (q->end_data() - msg_size);
+      memcpy(msg_hdr, packet->data(), msg_size);
+      msg_hdr->ttl = msg_hdr->ttl - 1;
+      msg_hdr->hop_count = msg_hdr->hop_count + 1;
+      packet->kill();
+      _stats.cycles.add(click_get_cycles() - start);
+      return 0;
+    }
+    click_cycles_t before = click_get_cycles();
+    flush();
+    start += click_get_cycles() - before;
+  }
+
+  //adding olsr packet header; the message data may still be shared with
+  //the other clones of the received packet, push() gives a private copy
+  WritablePacket *q = packet->push(sizeof(olsr_pkt_hdr));
+  if (!q){
+    _stats.cycles.add(click_get_cycles() - start);
+    return 0;
+  }
+  olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) q->data();
+  pkt_hdr->pkt_length = htons(msg_size + sizeof(olsr_pkt_hdr));
+  pkt_hdr->pkt_seq = 0;
+  olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (pkt_hdr + 1);
+  msg_hdr->ttl = msg_hdr->ttl - 1;
+  msg_hdr->hop_count = msg_hdr->hop_count + 1;
+  _stats.cycles.add(click_get_cycles() - start);
+
+  if (_batch){
+    //the remaining messages of the received packet reach us before the task
+    //runs, so they end up in this packet too
+    _pending = q;
+    _task.reschedule();
+    return 0;
+  }
+  return q;
+}
+
+
+void
+OLSRForward::flush()
+{
+  if (!_pending)
+    return;
+  WritablePacket *q = _pending;
+  _pending = 0;
+  olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) q->data();
+  pkt_hdr->pkt_length = htons(q->length());
+  output(0).push(q); //forward packet
+}
+
+
+bool
+OLSRForward::run_task(Task *)
+{
+  bool work = (_pending != 0);
+  flush();
+  return work;
+}
+
+
 uint16_t
 OLSRForward::get_msg_seq()
 {
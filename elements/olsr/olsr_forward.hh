@@ -4,7 +4,7 @@
   OLSR specific element, considers OLSR messages for forwarding, adds OLSR packet header to messages that are to be forwarded and decrements their TTL and increments their hop count. Adds OLSR message sequence numbers and OLSR packet headers to messages from nodes own message generators 
 
   =s
-  OLSRForward(OLSRDuplicateSet element, OLSRNeighborInfobase element, ip_address)
+  OLSRForward(OLSRDuplicateSet element, OLSRNeighborInfobase element, ip_address [, KEYWORDS])
   
   =io
   Two inputa, two outputs
@@ -19,6 +19,38 @@
   =d
   The OLSRClassifier element gets OLSR messages on its input ports. Input port 0 gets packets from the elements processing incoming packets, input port 1 gets packets from the node's message generating elements. Packets from the processing elements must have their destination addres annotation set to the source address of the packet. If the message is to be forwarded, OLSR packet headers are added and the packet is output on port 0. If the message is generated by the node itself, the OLSR message sequence number is added as well. Messages that are not to be forwarded, are output on port 1.
 
+  Keyword arguments are:
+
+  =item BATCH
+
+  Boolean. If true, messages retransmitted from input port 0 are not sent one per packet but collected behind a single OLSR packet header, which is output once the messages of the packets received in the meantime have all been considered. Default is false.
+
+  =item MTU
+
+  Integer. Largest OLSR packet (header and messages) built in BATCH mode; a message that does not fit starts a new packet. Default is 1472, an Ethernet frame minus the IP and UDP headers.
+
+  =h stats read-only
+  Control traffic accounting: one line per interface (paint annotation),
+  message type and outcome seen, with the number of messages and their
+  bytes, followed by the cycles spent per packet, not counting the elements
+  downstream, as in the profile handler of OLSRRoutingTable. The outcomes
+  are forwarded, duplicate (already retransmitted or considered on that
+  interface), not_mpr_selector (received from a node that did not select
+  this one as MPR), discarded (TTL exhausted or originated here) and
+  generated (from input port 1). The OLSRClassifier and OLSRProcess*
+  elements have the same handler, counting received and discarded
+  messages.
+
+  =h clear_stats write-only
+  Resets the counters.
+
+  =h sender_cache read-only
+  Lookups of the sender's main address and MPR selector status answered by
+  the sender cache, and those that went to the OLSRInterfaceInfoBase and
+  OLSRNeighborInfoBase, one per line. The cache remembers the answer for
+  the last senders seen until an interface or MPR selector tuple is added
+  or removed.
+
   =a
   OLSRProcessHello, OLSRProcessTC, OLSRProcessMID, OLSRClassifier, OLSRHelloGenerator, OLSRTCGenerator
   
@@ -27,11 +59,13 @@
 #define OLSR_FORWARD_HH
 
 #include <click/element.hh>
+#include <click/task.hh>
 #include <click/ipaddress.hh>
 #include "olsr_neighbor_infobase.hh"
 #include "olsr_duplicate_set.hh"
 #include "olsr_interface_infobase.hh"
 #include "olsr_local_if_infobase.hh"
+#include "olsr_msg_stats.hh"
 
 CLICK_DECLS
 
@@ -52,8 +86,13 @@ public:
   
   int configure(Vector<String> &conf, ErrorHandler *errh);
   int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void take_state(Element *, ErrorHandler *);
   void push(int port, Packet *packet);
+  void push_batch(int port, PacketBatch &batch);
+  bool run_task(Task *);
   uint16_t get_msg_seq();
+  void add_handlers();
 
 private:
   OLSRInterfaceInfoBase *_interfaceInfo;
@@ -62,7 +101,34 @@ private:
   OLSRNeighborInfoBase *_neighborInfo;
   IPAddress _myMainIP;
   uint16_t _msg_seq;
-  struct timeval _dup_hold_time;
+  olsr_time_t _dup_hold_time;
+
+  bool _batch;
+  int _mtu;
+  WritablePacket *_pending;	// retransmitted messages not yet output in BATCH mode
+  Task _task;
+  OLSRMessageStats _stats;
+
+  //the main address and MPR selector status of recent senders, valid while
+  //the interface and MPR selector sets keep the generations they had
+  struct Sender {
+    IPAddress addr;
+    IPAddress main_addr;
+    bool selector;
+    unsigned iface_generation;
+    unsigned selector_generation;
+  };
+  enum { SENDER_CACHE_SIZE = 64 };
+  Sender _senders[SENDER_CACHE_SIZE];
+  uint32_t _sender_hits;
+  uint32_t _sender_misses;
+  bool sender_is_mpr_selector(IPAddress source_addr);
+
+  static String read_sender_cache(Element *, void *);
+
+  Packet *forward(int port, Packet *packet, olsr_time_t now, int &out);
+  WritablePacket *retransmit_message(Packet *packet, click_cycles_t start);
+  void flush();
 };
 
 CLICK_ENDDECLS
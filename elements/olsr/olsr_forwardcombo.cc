@@ -0,0 +1,252 @@
+/*
+ * olsr_forwardcombo.{cc,hh} -- TTL decrement, route lookup and Ethernet
+ * encapsulation of the OLSR data path in one element
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ether.h>
+#include "olsr_forwardcombo.hh"
+
+CLICK_DECLS
+
+OLSRForwardCombo::OLSRForwardCombo()
+  : _entries(0)
+{
+}
+
+
+OLSRForwardCombo::~OLSRForwardCombo()
+{
+}
+
+
+int
+OLSRForwardCombo::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *routing_table, *route_table;
+  String arp_queriers;
+  _size = 1024;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRRoutingTable element", &routing_table,
+		  cpElement, "IPRouteTable element", &route_table,
+		  cpArgument, "OLSRARPQuerier elements", &arp_queriers,
+		  cpKeywords,
+		  "SIZE", cpInteger, "number of cache entries", &_size,
+		  0) < 0)
+    return -1;
+
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("%s is not an OLSRRoutingTable", routing_table->name().c_str());
+  if (!(_routeTable = (IPRouteTable *) route_table->cast("IPRouteTable")))
+    return errh->error("%s is not an IPRouteTable", route_table->name().c_str());
+  _radixLookup = (OLSRRadixIPLookup *) route_table->cast("OLSRRadixIPLookup");
+  if (_size <= 0 || _size > (1 << 24))
+    return errh->error("SIZE must be between 1 and %d", 1 << 24);
+
+  Vector<String> names;
+  cp_spacevec(arp_queriers, names);
+  _arpQueriers.clear();
+  for (int i = 0; i < names.size(); i++) {
+    Element *e = cp_element(names[i], this, errh);
+    if (!e)
+      return -1;
+    OLSRARPQuerier *arpq = (OLSRARPQuerier *) e->cast("OLSRARPQuerier");
+    if (!arpq)
+      return errh->error("%s is not an OLSRARPQuerier", e->name().c_str());
+    _arpQueriers.push_back(arpq);
+  }
+  if (_arpQueriers.empty())
+    return errh->error("no OLSRARPQuerier elements given");
+  if (noutputs() != 2 * _arpQueriers.size())
+    return errh->error("need two outputs per OLSRARPQuerier, %d in all", 2 * _arpQueriers.size());
+  return 0;
+}
+
+
+int
+OLSRForwardCombo::initialize(ErrorHandler *errh)
+{
+  int size = 1;
+  while (size < _size)
+    size <<= 1;
+  _size = size;
+  _mask = size - 1;
+  if (!(_entries = new Entry[size]))
+    return errh->error("out of memory");
+  clear();
+  return 0;
+}
+
+
+void
+OLSRForwardCombo::cleanup(CleanupStage)
+{
+  delete[] _entries;
+  _entries = 0;
+}
+
+
+/**
+ * invalidates all entries; an entry is valid only while its generation is
+ * the one of the routing table, which never goes back. Next hop states are
+ * refreshed before their next use.
+ */
+void
+OLSRForwardCombo::clear()
+{
+  unsigned stale = _routingTable->generation() - 1;
+  for (int i = 0; i < _size; i++) {
+    _entries[i].dst = IPAddress();
+    _entries[i].generation = stale;
+  }
+  for (int i = 0; i < _adjacencies.size(); i++)
+    _adjacencies[i].resolved = false;
+  _hits = _misses = _arp_lookups = _unresolved = _drops = 0;
+}
+
+
+/**
+ * asks the ARP querier of nh for the Ethernet address of its IP address,
+ * and prebuilds the header if there is one
+ */
+void
+OLSRForwardCombo::resolve(NextHop &nh)
+{
+  OLSRARPQuerier *arpq = _arpQueriers[nh.port];
+  // read before the lookup, so that a change during it leaves nh stale
+  nh.arp_generation = arpq->generation();
+  EtherAddress ether;
+  nh.resolved = arpq->lookup_ip(nh.ip, ether);
+  if (nh.resolved) {
+    memcpy(nh.header.ether_shost, arpq->ether_address().data(), 6);
+    memcpy(nh.header.ether_dhost, ether.data(), 6);
+    nh.header.ether_type = htons(ETHERTYPE_IP);
+  }
+  _arp_lookups++;
+}
+
+
+void
+OLSRForwardCombo::push(int, Packet *p)
+{
+  const click_ip *iph = p->ip_header();
+  if (iph->ip_ttl <= 1) {
+    _drops++;
+    p->kill();
+    return;
+  }
+
+  IPAddress dst(iph->ip_dst);
+  uint32_t a = ntohl(dst.addr());
+  Entry &e = _entries[(a ^ (a >> 12)) & _mask];
+  unsigned generation = _routingTable->generation();
+
+  if (e.dst == dst && e.generation == generation)
+    _hits++;
+  else {
+    IPAddress gw;
+    int adjacency = -1;
+    int port;
+    if (_radixLookup)
+      port = _radixLookup->lookup_route(dst, gw, adjacency);
+    else
+      port = _routeTable->lookup_route(dst, gw);
+    if (port < 0 || port >= _arpQueriers.size()) {
+      static int complained = 0;
+      if (++complained <= 5)
+	click_chatter("%s: no route for %s", name().c_str(), dst.unparse().c_str());
+      _drops++;
+      p->kill();
+      return;
+    }
+
+    NextHop *nh = &e.own;
+    if (adjacency >= 0) {
+      if (adjacency >= _adjacencies.size()) {
+	int n = _adjacencies.size();
+	_adjacencies.resize(adjacency + 1);
+	for (; n < _adjacencies.size(); n++)
+	  _adjacencies[n].resolved = false;
+      }
+      nh = &_adjacencies[adjacency];
+    }
+    // an adjacency's address and port never change, an own next hop's may
+    if (adjacency < 0)
+      nh->resolved = false;
+    nh->ip = gw ? gw : dst;
+    nh->port = port;
+    e.dst = dst;
+    e.generation = generation;
+    e.adjacency = adjacency;
+    _misses++;
+  }
+
+  NextHop &nh = (e.adjacency >= 0 ? _adjacencies[e.adjacency] : e.own);
+  if (!nh.resolved || nh.arp_generation != _arpQueriers[nh.port]->generation())
+    resolve(nh);
+
+  WritablePacket *q = decrement_ttl(p);
+  if (!q) {
+    _drops++;
+    return;
+  }
+  if (!nh.resolved) {
+    q->set_dst_ip_anno(nh.ip);
+    _unresolved++;
+    output(_arpQueriers.size() + nh.port).push(q);
+  } else if ((q = q->push_mac_header(sizeof(click_ether)))) {
+    memcpy(q->ether_header(), &nh.header, sizeof(click_ether));
+    output(nh.port).push(q);
+  } else
+    _drops++;
+}
+
+
+String
+OLSRForwardCombo::read_handler(Element *e, void *thunk)
+{
+  OLSRForwardCombo *fc = (OLSRForwardCombo *) e;
+  switch ((intptr_t) thunk) {
+  case 0:
+    return String(fc->_hits) + "\n";
+  case 1:
+    return String(fc->_misses) + "\n";
+  case 2:
+    return String(fc->_arp_lookups) + "\n";
+  case 3:
+    return String(fc->_unresolved) + "\n";
+  default:
+    return String(fc->_drops) + "\n";
+  }
+}
+
+
+int
+OLSRForwardCombo::clear_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRForwardCombo *fc = (OLSRForwardCombo *) e;
+  fc->clear();
+  return 0;
+}
+
+
+void
+OLSRForwardCombo::add_handlers()
+{
+  add_read_handler("hits", read_handler, (void *) 0);
+  add_read_handler("misses", read_handler, (void *) 1);
+  add_read_handler("arp_lookups", read_handler, (void *) 2);
+  add_read_handler("unresolved", read_handler, (void *) 3);
+  add_read_handler("drops", read_handler, (void *) 4);
+  add_write_handler("clear", clear_handler, (void *) 0);
+}
+
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<OLSRForwardCombo::NextHop>;
+#endif
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRForwardCombo);
@@ -0,0 +1,167 @@
+/*
+  =c
+  OLSRForwardCombo(OLSRRoutingTable element, IPRouteTable element, ARP queriers [, KEYWORDS])
+
+  =s
+  OLSR specific element, forwards data packets in one element
+
+  =io
+  One input; two outputs per OLSRARPQuerier given
+
+  =d
+  Does the work of DecIPTTL, GetIPAddress(16), the route lookup and
+  OLSRARPQuerier on the data path of an OLSR node in one pass. Expects IP
+  packets with their IP header annotation set. A packet whose TTL would
+  expire is dropped; otherwise its TTL is decremented and the checksum
+  updated incrementally, and the destination address looked up.
+
+  The third argument is a space-separated list of OLSRARPQuerier elements,
+  one per interface: a route with output port I<i> leaves through the I<i>th
+  ARP querier. If the next hop's Ethernet address is known, the packet gets
+  its Ethernet header right here and is emitted on output I<i>, to go
+  straight to the device. Otherwise it is emitted, with its destination
+  annotation set to the next hop, on output I<n> + I<i>, where I<n> is the
+  number of ARP queriers; connect that output to input 0 of the I<i>th
+  querier, which queries for the address and holds the packet meanwhile.
+
+  The routes are kept in a direct-mapped cache of SIZE entries indexed by
+  the destination address, so a packet to a recently seen destination costs
+  a single probe, just as with OLSRRouteCache. An entry is good while the
+  generation() of the OLSRRoutingTable element has not moved on, and
+  refers to the state of its next hop: the prebuilt Ethernet header, which
+  a resolved packet gets with one copy. If the IPRouteTable element is an
+  OLSRRadixIPLookup, the routes through one gateway share that state by the
+  adjacency number the lookup reports, so it survives route changes and an
+  ARP change costs one ARP table lookup per gateway; otherwise each cache
+  entry has its own. Next hop state is good while the generation() of its
+  ARP querier has not moved on; an unresolved next hop asks the querier
+  again for every packet until it has an answer. Routes changed through the
+  handlers of the lookup element do not change the generation; write the
+  C<clear> handler after those.
+
+  The entries are not locked; on an SMP router, give each forwarding thread
+  its own OLSRForwardCombo.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item SIZE
+
+  Integer. Number of cache entries, rounded up to a power of two. Default is
+  1024.
+
+  =back
+
+  =h hits read-only
+  Packets forwarded from a cache entry.
+
+  =h misses read-only
+  Packets forwarded after a route lookup.
+
+  =h arp_lookups read-only
+  Next hop states refreshed from the ARP table.
+
+  =h unresolved read-only
+  Packets handed to an ARP querier.
+
+  =h drops read-only
+  Packets dropped, for an expiring TTL or the lack of a route.
+
+  =h clear write-only
+  Invalidates all entries and resets the counters.
+
+  =a
+  OLSRRouteCache, OLSRARPQuerier, OLSRRadixIPLookup, OLSRRoutingTable,
+  DecIPTTL, IPOutputCombo */
+
+#ifndef OLSR_FORWARDCOMBO_HH
+#define OLSR_FORWARDCOMBO_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/etheraddress.hh>
+#include <click/vector.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include "../ip/iproutetable.hh"
+#include "olsr_rtable.hh"
+#include "olsr_radixiplookup.hh"
+#include "olsr_arpquerier.hh"
+
+CLICK_DECLS
+
+class OLSRForwardCombo : public Element { public:
+
+  OLSRForwardCombo();
+  ~OLSRForwardCombo();
+
+  const char *class_name() const	{ return "OLSRForwardCombo"; }
+  const char *port_count() const	{ return "1/-"; }
+  const char *processing() const	{ return PUSH; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void push(int, Packet *);
+
+private:
+
+  struct NextHop {
+    IPAddress ip;
+    int port;
+    bool resolved;
+    unsigned arp_generation;
+    click_ether header;		// valid if resolved
+  };
+
+  struct Entry {
+    IPAddress dst;
+    unsigned generation;
+    int adjacency;		// index into _adjacencies, or -1 for own
+    NextHop own;
+  };
+
+  OLSRRoutingTable *_routingTable;
+  IPRouteTable *_routeTable;
+  OLSRRadixIPLookup *_radixLookup;	// _routeTable, if it numbers adjacencies
+  Vector<OLSRARPQuerier *> _arpQueriers;
+  Entry *_entries;
+  uint32_t _mask;		// number of entries - 1
+  int _size;
+  Vector<NextHop> _adjacencies;
+
+  uint32_t _hits;
+  uint32_t _misses;
+  uint32_t _arp_lookups;
+  uint32_t _unresolved;
+  uint32_t _drops;
+
+  void clear();
+  void resolve(NextHop &);
+  static inline WritablePacket *decrement_ttl(Packet *);
+
+  static String read_handler(Element *, void *);
+  static int clear_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+/**
+ * decrements the TTL of p, whose TTL is above 1, and updates the checksum
+ * incrementally; returns 0 if p could not be made writable. Defined here
+ * rather than in the .cc file, so that click-devirtualize's copy of push()
+ * sees it.
+ */
+inline WritablePacket *
+OLSRForwardCombo::decrement_ttl(Packet *p)
+{
+  WritablePacket *q = p->uniqueify();
+  if (q)
+    click_ip_decrement_ttl(q->ip_header());
+  return q;
+}
+
+CLICK_ENDDECLS
+#endif
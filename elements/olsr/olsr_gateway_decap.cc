@@ -0,0 +1,78 @@
+/*
+ * olsr_gateway_decap.{cc,hh} -- takes the packets an OLSRGatewayTunnel sent
+ * to this gateway out of their tunnel
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include "olsr_gateway_decap.hh"
+
+CLICK_DECLS
+
+OLSRGatewayDecap::OLSRGatewayDecap()
+  : _decapsulated(0), _bad(0)
+{
+}
+
+
+OLSRGatewayDecap::~OLSRGatewayDecap()
+{
+}
+
+
+int
+OLSRGatewayDecap::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  return cp_va_parse(conf, this, errh,
+		     cpIPAddress, "Nodes main IP address", &_myMainIP,
+		     0);
+}
+
+
+Packet *
+OLSRGatewayDecap::simple_action(Packet *p)
+{
+  const click_ip *iph = p->ip_header();
+  if (!iph || iph->ip_p != IP_PROTO_IPIP || iph->ip_dst.s_addr != _myMainIP.addr())
+    return p;
+
+  int inner_length = p->transport_length();
+  const click_ip *inner = reinterpret_cast<const click_ip *>(p->transport_header());
+  int hlen;
+  if (IP_ISFRAG(iph) || inner_length < (int) sizeof(click_ip) || inner->ip_v != 4
+      || (hlen = inner->ip_hl << 2) < (int) sizeof(click_ip) || hlen > inner_length) {
+    _bad++;
+    return p;
+  }
+
+  p->pull(p->transport_header_offset());
+  p->set_ip_header(reinterpret_cast<const click_ip *>(p->data()), hlen);
+  p->set_dst_ip_anno(IPAddress(p->ip_header()->ip_dst));
+  _decapsulated++;
+  return p;
+}
+
+
+String
+OLSRGatewayDecap::read_handler(Element *e, void *)
+{
+  OLSRGatewayDecap *d = (OLSRGatewayDecap *) e;
+  StringAccum sa;
+  sa << "decapsulated " << d->_decapsulated << '\n'
+     << "bad " << d->_bad << '\n';
+  return sa.take_string();
+}
+
+
+void
+OLSRGatewayDecap::add_handlers()
+{
+  add_read_handler("stats", read_handler, 0);
+}
+
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRGatewayDecap)
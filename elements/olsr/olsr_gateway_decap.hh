@@ -0,0 +1,64 @@
+/*
+  =c
+  OLSRGatewayDecap(ip_address)
+
+  =s
+  OLSR specific element, takes the packets tunnelled to this gateway out of their tunnel
+
+  =io
+  One input, one output
+
+  =d
+  Gets the IP packets received from the mesh, with their IP header
+  annotations set. An IP-in-IP packet to ip_address, the node's main
+  address, as an OLSRGatewayTunnel sends them, is replaced on the output by
+  the packet inside, with its own IP header and destination annotations.
+  Other packets pass unchanged. Belongs on the input path of the node's
+  data of an HNA gateway, in front of the local delivery and the
+  forwarding, so the packet goes on as if it had been routed to the
+  gateway hop by hop.
+
+  Fragments of a tunnelled packet, and packets whose inner header is not
+  a whole IPv4 header, pass unchanged, to be delivered to the host.
+
+  =h stats read-only
+  Returns the numbers of packets taken out of their tunnel and of tunnelled
+  packets passed unchanged.
+
+  =a
+  OLSRGatewayTunnel, IPEncap
+*/
+#ifndef OLSR_GATEWAY_DECAP_HH
+#define OLSR_GATEWAY_DECAP_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+
+CLICK_DECLS
+
+class OLSRGatewayDecap : public Element { public:
+
+  OLSRGatewayDecap();
+  ~OLSRGatewayDecap();
+
+  const char *class_name() const	{ return "OLSRGatewayDecap"; }
+  const char *port_count() const	{ return "1/1"; }
+  const char *processing() const	{ return AGNOSTIC; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+
+private:
+
+  IPAddress _myMainIP;
+  uint32_t _decapsulated;
+  uint32_t _bad;
+
+  static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,238 @@
+/*
+ * olsr_gateway_tunnel.{cc,hh} -- tunnels the Internet traffic of an OLSR
+ * node to the HNA gateway each flow was given
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include "olsr_gateway_tunnel.hh"
+
+CLICK_DECLS
+
+OLSRGatewayTunnel::OLSRGatewayTunnel()
+  : _flows(0)
+{
+}
+
+
+OLSRGatewayTunnel::~OLSRGatewayTunnel()
+{
+}
+
+
+int
+OLSRGatewayTunnel::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *association_info, *routing_table;
+  int timeout = 30000;
+  _size = 1024;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRAssociationInfoBase element", &association_info,
+		  cpElement, "OLSRRoutingTable element", &routing_table,
+		  cpIPAddress, "Nodes main IP address", &_myMainIP,
+		  cpKeywords,
+		  "TIMEOUT", cpInteger, "idle flow timeout (msec)", &timeout,
+		  "SIZE", cpInteger, "number of flow table entries", &_size,
+		  0) < 0)
+    return -1;
+
+  if (!(_associationInfo = (OLSRAssociationInfoBase *) association_info->cast("OLSRAssociationInfoBase")))
+    return errh->error("%s is not an OLSRAssociationInfoBase", association_info->name().c_str());
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("%s is not an OLSRRoutingTable", routing_table->name().c_str());
+  if (timeout <= 0)
+    return errh->error("TIMEOUT must be greater than 0");
+  if (_size <= 0 || _size > (1 << 24))
+    return errh->error("SIZE must be between 1 and %d", 1 << 24);
+  _timeout = olsr_msec(timeout);
+  return 0;
+}
+
+
+int
+OLSRGatewayTunnel::initialize(ErrorHandler *errh)
+{
+  int size = 1;
+  while (size < _size)
+    size <<= 1;
+  _size = size;
+  _mask = size - 1;
+  if (!(_flows = new Flow[size]))
+    return errh->error("out of memory");
+  for (int i = 0; i < _size; i++)
+    _flows[i].gateway = IPAddress();
+  _id = 0;
+  _tunnelled = _passed = _new_flows = _no_gateway = 0;
+  //the versions never match before the first refresh
+  _association_version = _associationInfo->version() - 1;
+  _generation = _routingTable->generation() - 1;
+  return 0;
+}
+
+
+void
+OLSRGatewayTunnel::cleanup(CleanupStage)
+{
+  delete[] _flows;
+  _flows = 0;
+}
+
+
+bool
+OLSRGatewayTunnel::reachable(IPAddress gateway) const
+{
+  return _routingTable->route_distance(gateway) >= 0;
+}
+
+
+/**
+ * sorts the gateways of the default route by distance and collects the
+ * other HNA networks, once per change of the associations or the routes
+ */
+void
+OLSRGatewayTunnel::refresh()
+{
+  _association_version = _associationInfo->version();
+  _generation = _routingTable->generation();
+  _gateways.clear();
+  _networks.clear();
+  Vector<int> distances;
+  OLSRAssociationInfoBase::AssociationSet *associations = _associationInfo->get_association_set();
+  for (OLSRAssociationInfoBase::AssociationSet::iterator iter = associations->begin(); iter != associations->end(); iter++) {
+    const association_data &a = iter.value();
+    if (a.A_netmask) {
+      _networks.push_back(IPPair(a.A_network_addr, a.A_netmask));
+      continue;
+    }
+    int distance = _routingTable->route_distance(a.A_gateway_addr);
+    if (distance < 0)
+      continue;
+    int i = _gateways.size();
+    _gateways.push_back(a.A_gateway_addr);
+    distances.push_back(distance);
+    for (; i > 0 && distances[i - 1] > distance; i--) {
+      _gateways[i] = _gateways[i - 1];
+      distances[i] = distances[i - 1];
+    }
+    _gateways[i] = a.A_gateway_addr;
+    distances[i] = distance;
+  }
+}
+
+
+/**
+ * true if only a default route would take a packet to dst
+ */
+bool
+OLSRGatewayTunnel::default_routed(IPAddress dst) const
+{
+  if (reachable(dst))
+    return false;
+  for (int i = 0; i < _networks.size(); i++)
+    if (dst.matches_prefix(_networks[i]._from, _networks[i]._to))
+      return false;
+  return true;
+}
+
+
+uint32_t
+OLSRGatewayTunnel::flow_hash(const Packet *p)
+{
+  const click_ip *iph = p->ip_header();
+  uint32_t h = olsr_hash_mix(iph->ip_src.s_addr, iph->ip_dst.s_addr);
+  h = olsr_hash_mix(h, iph->ip_p);
+  if ((iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP)
+      && !IP_ISFRAG(iph) && p->transport_length() >= 4)
+    h = olsr_hash_mix(h, *(const uint32_t *) p->transport_header());
+  return h;
+}
+
+
+Packet *
+OLSRGatewayTunnel::simple_action(Packet *p)
+{
+  const click_ip *iph = p->ip_header();
+  if (!iph || iph->ip_p == IP_PROTO_IPIP) {
+    _passed++;
+    return p;
+  }
+  if (_associationInfo->version() != _association_version
+      || _routingTable->generation() != _generation)
+    refresh();
+  if (_gateways.empty()) {
+    _no_gateway++;
+    return p;
+  }
+
+  uint32_t h = flow_hash(p);
+  Flow &flow = _flows[(h ^ (h >> 16)) & _mask];
+  olsr_time_t now = olsr_now();
+  if (!flow.gateway || flow.hash != h || flow.expires <= now || !reachable(flow.gateway)) {
+    IPAddress dst(iph->ip_dst);
+    if (!default_routed(dst)) {
+      _passed++;
+      return p;
+    }
+    flow.hash = h;
+    flow.gateway = _gateways[0];
+    _new_flows++;
+  }
+  flow.expires = now + _timeout;
+
+  int tos = iph->ip_tos, ttl = iph->ip_ttl;
+  WritablePacket *q = p->push(sizeof(click_ip));
+  if (!q)
+    return 0;
+  click_ip *outer = reinterpret_cast<click_ip *>(q->data());
+  outer->ip_v = 4;
+  outer->ip_hl = sizeof(click_ip) >> 2;
+  outer->ip_tos = tos;
+  outer->ip_len = htons(q->length());
+  outer->ip_id = htons(_id++);
+  outer->ip_off = 0;
+  outer->ip_ttl = ttl;
+  outer->ip_p = IP_PROTO_IPIP;
+  outer->ip_src = _myMainIP.in_addr();
+  outer->ip_dst = flow.gateway.in_addr();
+  outer->ip_sum = 0;
+  outer->ip_sum = click_in_cksum((unsigned char *) outer, sizeof(click_ip));
+  q->set_ip_header(outer, sizeof(click_ip));
+  q->set_dst_ip_anno(flow.gateway);
+  _tunnelled++;
+  return q;
+}
+
+
+String
+OLSRGatewayTunnel::read_handler(Element *e, void *thunk)
+{
+  OLSRGatewayTunnel *t = (OLSRGatewayTunnel *) e;
+  StringAccum sa;
+  if (thunk) {
+    for (int i = 0; i < t->_gateways.size(); i++)
+      sa << t->_gateways[i] << '\n';
+  } else
+    sa << "tunnelled " << t->_tunnelled << '\n'
+       << "passed " << t->_passed << '\n'
+       << "new_flows " << t->_new_flows << '\n'
+       << "no_gateway " << t->_no_gateway << '\n';
+  return sa.take_string();
+}
+
+
+void
+OLSRGatewayTunnel::add_handlers()
+{
+  add_read_handler("stats", read_handler, (void *) 0);
+  add_read_handler("gateways", read_handler, (void *) 1);
+}
+
+
+#include <click/vector.cc>
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRGatewayTunnel)
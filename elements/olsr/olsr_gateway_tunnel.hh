@@ -0,0 +1,134 @@
+/*
+  =c
+  OLSRGatewayTunnel(OLSRAssociationInfoBase element, OLSRRoutingTable element, ip_address [, KEYWORDS])
+
+  =s
+  OLSR specific element, tunnels the Internet traffic of the node to an HNA gateway
+
+  =io
+  One input, one output
+
+  =d
+  Takes the IP packets the node sends, with their IP header annotations
+  set. A packet whose destination is neither a node of the OLSRRoutingTable
+  nor in a network an HNA gateway advertises, other than the default route
+  0.0.0.0/0, would leave the mesh through a gateway advertising the default
+  route: it is encapsulated in an IP-in-IP header (IP protocol 4, as
+  IPEncap would) from ip_address, the node's main address, to that
+  gateway's main address, and its destination annotation set to the
+  gateway. Other packets pass unchanged.
+
+  The nodes on the way forward the packet on the host route to the
+  gateway, the same for all its flows, which an OLSRRouteCache answers
+  from one entry, and the gateway takes the header off with
+  OLSRGatewayDecap. A new flow, told apart by its addresses, protocol and
+  ports, goes to the nearest gateway, and stays with it as long as the
+  gateway has a route and the flow is not idle for TIMEOUT msecs: route
+  changes on the way no longer move a flow to another gateway midway.
+
+  The flow table is direct-mapped: a flow displaced by another one picks
+  its gateway again. It is not locked.
+
+  The outer header makes each packet 20 bytes longer; the MTU of the hosts
+  needs to leave room for it. The outer header takes the TTL and TOS of the
+  packet, and is never fragmented here.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item TIMEOUT
+
+  Integer. How long an idle flow stays with its gateway, in msecs. Default
+  is 30000.
+
+  =item SIZE
+
+  Integer. Entries of the flow table, rounded up to a power of two.
+  Default is 1024.
+
+  =back
+
+  =h stats read-only
+  Packets tunnelled, packets passed unchanged as they had a route in the
+  mesh, flows given a gateway, and packets passed unchanged as no gateway
+  of the default route had a route, one per line.
+
+  =h gateways read-only
+  The gateways advertising the default route that have a route, nearest
+  first.
+
+  =e
+  ... -> MarkIPHeader -> OLSRGatewayTunnel(association_info, routing_table, $my_ip0) -> ...
+
+  =a
+  OLSRGatewayDecap, OLSRAssociationInfoBase, OLSRRouteCache, IPEncap */
+
+#ifndef OLSR_GATEWAY_TUNNEL_HH
+#define OLSR_GATEWAY_TUNNEL_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+#include "click_olsr.hh"
+#include "olsr_association_infobase.hh"
+#include "olsr_rtable.hh"
+
+CLICK_DECLS
+
+class OLSRGatewayTunnel : public Element { public:
+
+  OLSRGatewayTunnel();
+  ~OLSRGatewayTunnel();
+
+  const char *class_name() const	{ return "OLSRGatewayTunnel"; }
+  const char *port_count() const	{ return "1/1"; }
+  const char *processing() const	{ return AGNOSTIC; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+
+private:
+
+  struct Flow {
+    uint32_t hash;
+    IPAddress gateway;		// 0.0.0.0 if empty
+    olsr_time_t expires;
+  };
+
+  OLSRAssociationInfoBase *_associationInfo;
+  OLSRRoutingTable *_routingTable;
+  IPAddress _myMainIP;
+  olsr_time_t _timeout;
+  Flow *_flows;
+  uint32_t _mask;		// number of entries - 1
+  int _size;
+  uint16_t _id;
+
+  // the gateways of the default route, nearest first, and the other HNA
+  // networks, as of these versions of the association set and the routes
+  Vector<IPAddress> _gateways;
+  Vector<IPPair> _networks;
+  uint32_t _association_version;
+  unsigned _generation;
+
+  uint32_t _tunnelled;
+  uint32_t _passed;
+  uint32_t _new_flows;
+  uint32_t _no_gateway;
+
+  void refresh();
+  bool default_routed(IPAddress dst) const;
+  bool reachable(IPAddress gateway) const;
+  static uint32_t flow_hash(const Packet *);
+
+  static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
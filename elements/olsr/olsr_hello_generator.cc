@@ -15,12 +15,13 @@
 #include "olsr_link_infobase.hh"
 #include "click_olsr.hh"
 #include "olsr_packethandle.hh"
+#include "olsr_address_block.hh"
 
 
 CLICK_DECLS
 
 OLSRHelloGenerator::OLSRHelloGenerator()
-		: _timer( this ), _node_willingness( OLSR_WILLINGNESS )
+		: _timer( this ), _node_willingness( OLSR_WILLINGNESS ), _link_quality( false ), _compact( false ), _hello_template( 0 )
 {
 }
 
@@ -28,6 +29,14 @@ OLSRHelloGenerator::~OLSRHelloGenerator()
 {
 }
 
+void
+OLSRHelloGenerator::cleanup( CleanupStage )
+{
+	if ( _hello_template )
+		_hello_template->kill();
+	_hello_template = 0;
+}
+
 int
 OLSRHelloGenerator::configure( Vector<String> &conf, ErrorHandler *errh )
 {
@@ -41,7 +50,9 @@ OLSRHelloGenerator::configure( Vector<String> &conf, ErrorHandler *errh )
 	                       cpIPAddress, "Interface IPAddress", &_local_iface_addr,
 	                       cpIPAddress, "Main IPAddress of node", &_myMainIP,
 	                       cpKeywords,
-	                       "WILLINGNESS", cpInteger, "Willingness of the node", &_node_willingness
+	                       "WILLINGNESS", cpInteger, "Willingness of the node", &_node_willingness,
+	                       "LINK_QUALITY", cpBool, "send LQ_HELLO messages", &_link_quality,
+	                       "COMPACT", cpBool, "send COMPACT_HELLO messages", &_compact
 	                       , 0 );
 	if ( res < 0 )
 		return res;
@@ -57,8 +68,8 @@ OLSRHelloGenerator::initialize( ErrorHandler * )
 	uint32_t start = ( random() % _period );
 	click_chatter ( "hello start %d\n", start );
 	_timer.schedule_after_msec( start ); // Send OLSR HELLO periodically
-	_htime = compute_htime();
-	_vtime = compute_vtime();
+	_htime = olsr_vtime_encode( olsr_msec( _period ) );
+	_vtime = olsr_vtime_encode( olsr_msec( _neighbor_hold_time ) );
 	click_chatter ( "_neighbor_hold_time = %d | _vtime = %d\n", _neighbor_hold_time, _vtime );
 	return 0;
 }
@@ -66,7 +77,8 @@ OLSRHelloGenerator::initialize( ErrorHandler * )
 void
 OLSRHelloGenerator::run_timer(Timer *)
 {
-	output( 0 ).push( generate_hello() );
+	if ( Packet *p = generate_hello() )
+		output( 0 ).push( p );
 	int period = ( int ) ( _period * .95 + ( random() % ( _period / 10 ) ) );
 	//click_chatter ("emitting other hello after %d ms\n",period);
 	_timer.reschedule_after_msec( period );
@@ -76,160 +88,199 @@ Packet *
 OLSRHelloGenerator::generate_hello()
 {
 	//  uint64_t cycles=click_get_cycles();
-	struct timeval now;
-	click_gettimeofday( &now );
-	int number_link_codes = 0;
-	int number_addresses = 0;
-	HashMap<uint8_t, Vector<IPAddress> > neighbor_interfaces;
-	HashMap<IPAddress, bool> neighbor_included;
-	HashMap<IPPair, void *> *link_set = _linkInfoBase->get_link_set();
-	Vector <IPAddress> adv_link_addr;
-	if ( ! link_set->empty() )
+	olsr_time_t now = olsr_now();
+
+	//collect the (link code, address) pairs to advertise on this interface
+	_advertised.clear();
+	OLSRLinkInfoBase::LinkSet *link_set = _linkInfoBase->get_link_set();
+	for ( OLSRLinkInfoBase::LinkSet::iterator iter = link_set->begin(); iter != link_set->end(); iter++ )
 	{
-		for ( HashMap<IPPair, void*>::iterator iter = link_set->begin(); iter != link_set->end(); iter++ )
+		struct link_data *data = &iter.value();
+		if ( ( data->L_local_iface_addr == _local_iface_addr ) && ( data->L_time >= now ) )
 		{
-			struct link_data *data;
-			data = ( link_data * ) iter.value();
-			if ( ( data->L_local_iface_addr == _local_iface_addr ) && ( data->L_time >= now ) )
+			//a pending link is not advertised, except as lost (RFC 3626 section 14.3)
+			if ( data->L_link_pending && data->L_LOST_LINK_time < now )
+				continue;
+			AdvertisedAddress adv;
+			adv.link_code = get_link_code( data, now );
+			adv.address = data->L_neigh_iface_addr;
+			adv.lq = adv.nlq = 0;
+			if ( _link_quality )
 			{
-				uint8_t link_code = get_link_code( data, now );
-				//click_chatter ("link with link_code: %d\n",link_code);
-				IPAddress main_address = _interfaceInfoBase->get_main_address( data->L_neigh_iface_addr ); //get main address of links remote interface
-				neighbor_included.insert ( main_address, true );
-				Vector <IPAddress> * neighbor_iface = neighbor_interfaces.findp( link_code );
-				if ( neighbor_iface == 0 )
-				{
-					adv_link_addr.clear();
-					adv_link_addr.push_back( data->L_neigh_iface_addr );
-					neighbor_interfaces.insert( link_code, adv_link_addr );
-					number_link_codes++;
-					number_addresses++;
-				}
-				else
-				{
-					neighbor_iface->push_back( data->L_neigh_iface_addr );
-					number_addresses++;
-				}
+				adv.lq = data->L_lq >> 8;
+				adv.nlq = data->L_nlq;
 			}
+			_advertised.push_back( adv );
 		}
 	}
 
-	HashMap<IPAddress, void *> *neighborSet = _neighborInfoBase->get_neighbor_set();
-
-	for ( HashMap<IPAddress, void *> ::iterator iter = neighborSet->begin(); iter != neighborSet->end(); iter++ )
+	//neighbors without a link on this interface are advertised by main address
+	OLSRNeighborInfoBase::NeighborSet *neighborSet = _neighborInfoBase->get_neighbor_set();
+	for ( OLSRNeighborInfoBase::NeighborSet::iterator iter = neighborSet->begin(); iter != neighborSet->end(); iter++ )
 	{
-		neighbor_data *neighbor = ( neighbor_data * ) iter.value();
-		if ( !neighbor_included.findp( neighbor->N_neigh_main_addr ) )
+		neighbor_data *neighbor = &iter.value();
+		bool included = false;
+		if ( const OLSRLinkInfoBase::LinkList *links = _linkInfoBase->links_to( neighbor->N_neigh_main_addr ) )
+			for ( int i = 0; i < links->size() && !included; i++ )
+				if ( ( *links )[ i ]->L_local_iface_addr == _local_iface_addr && ( *links )[ i ]->L_time >= now )
+					included = true;
+		if ( included )
+			continue;
+
+		uint8_t link_code = OLSR_UNSPEC_LINK;
+		if ( _neighborInfoBase->find_mpr( neighbor->N_neigh_main_addr ) != 0 )
+			link_code = link_code | ( OLSR_MPR_NEIGH << 2 );
+		else
 		{
-			uint8_t link_code = OLSR_UNSPEC_LINK;
-			if ( _neighborInfoBase->find_mpr( neighbor->N_neigh_main_addr ) != 0 )
-				link_code = link_code | ( OLSR_MPR_NEIGH << 2 );
+			if ( neighbor->N_status == OLSR_SYM_NEIGH )
+				link_code = link_code | ( OLSR_SYM_NEIGH << 2 );
 			else
+				link_code = link_code | ( OLSR_NOT_NEIGH << 2 );
+		}
+		AdvertisedAddress adv;
+		adv.link_code = link_code;
+		adv.address = neighbor->N_neigh_main_addr;
+		adv.lq = adv.nlq = 0;
+		if ( _link_quality )
+			if ( link_data *link = _linkInfoBase->best_link_to( neighbor->N_neigh_main_addr ) )
 			{
-				if ( neighbor->N_status == OLSR_SYM_NEIGH )
-					link_code = link_code | ( OLSR_SYM_NEIGH << 2 );
-				else
-					link_code = link_code | ( OLSR_NOT_NEIGH << 2 );
+				adv.lq = link->L_lq >> 8;
+				adv.nlq = link->L_nlq;
 			}
+		_advertised.push_back( adv );
+	}
 
-			Vector <IPAddress> * neighbor_iface = neighbor_interfaces.findp( link_code );
-			if ( neighbor_iface == 0 )
-			{
-				adv_link_addr.clear();
-				adv_link_addr.push_back( neighbor->N_neigh_main_addr );
-				neighbor_interfaces.insert( link_code, adv_link_addr );
-				number_link_codes++;
-				number_addresses++;
-			}
-			else
-			{
-				neighbor_iface->push_back( neighbor->N_neigh_main_addr );
-				number_addresses++;
-			}
+	//link codes expire with time as well as change on events, so the cached
+	//message is checked against what would be advertised now; if that is
+	//unchanged only the per-message fields are written into a copy
+	bool unchanged = _hello_template && _advertised.size() == _template_advertised.size();
+	for ( int i = 0; unchanged && i < _advertised.size(); i++ )
+		if ( _advertised[ i ].link_code != _template_advertised[ i ].link_code
+		        || _advertised[ i ].address != _template_advertised[ i ].address
+		        || _advertised[ i ].lq != _template_advertised[ i ].lq
+		        || _advertised[ i ].nlq != _template_advertised[ i ].nlq )
+			unchanged = false;
+	if ( !unchanged )
+	{
+		if ( _hello_template )
+			_hello_template->kill();
+		_hello_template = build_hello();
+		_template_advertised = _advertised;
+		if ( !_hello_template )
+			return 0;
+	}
+
+	WritablePacket *packet = olsr_copy_packet( _hello_template );
+	if ( packet == 0 )
+		return 0;
+	packet->set_timestamp_anno( Timestamp::now() );
+	olsr_msg_hdr *msg_hdr = ( olsr_msg_hdr * ) ( packet->data() + sizeof( olsr_pkt_hdr ) );
+	msg_hdr->msg_seq = htons ( _forward->get_msg_seq() );	//this also increases the sequence number;
+	return packet;
+}
+
+
+Packet *
+OLSRHelloGenerator::build_hello()
+{
+	//group the addresses by link code; the code has four bits
+	int addresses_with_code[ 16 ];
+	int number_link_codes = 0;
+	memset( addresses_with_code, 0, sizeof( addresses_with_code ) );
+	for ( int i = 0; i < _advertised.size(); i++ )
+		if ( addresses_with_code[ _advertised[ i ].link_code & 0x0f ]++ == 0 )
+			number_link_codes++;
+
+	//with COMPACT, the addresses of a link code go in address blocks
+	Vector<IPAddress> block_addresses[ 16 ];
+	Vector<olsr_lq_info> block_lq[ 16 ];
+	int blocks_size = 0;
+	if ( _compact )
+	{
+		for ( int i = 0; i < _advertised.size(); i++ )
+		{
+			int code = _advertised[ i ].link_code & 0x0f;
+			block_addresses[ code ].push_back( _advertised[ i ].address );
+			olsr_lq_info lq_info;
+			lq_info.lq = _advertised[ i ].lq;
+			lq_info.nlq = _advertised[ i ].nlq;
+			lq_info.reserved = 0;
+			block_lq[ code ].push_back( lq_info );
 		}
+		for ( int code = 0; code < 16; code++ )
+			blocks_size += OLSRAddressBlock::size( block_addresses[ code ].begin(), block_addresses[ code ].size(), _link_quality );
 	}
 
-	int packet_size = sizeof( olsr_pkt_hdr ) + sizeof( olsr_msg_hdr ) + sizeof( olsr_hello_hdr ) + number_link_codes * sizeof ( olsr_link_hdr ) + number_addresses * sizeof ( in_addr );
-	int headroom = sizeof( click_ether ) + sizeof( click_ip ) + sizeof( click_udp );
+	int address_size = sizeof( in_addr ) + ( _link_quality ? sizeof( olsr_lq_info ) : 0 );
+	int msg_size = sizeof( olsr_msg_hdr ) + sizeof( olsr_hello_hdr ) + number_link_codes * sizeof ( olsr_link_hdr ) + _advertised.size() * address_size;
+	if ( _compact )
+		msg_size = sizeof( olsr_msg_hdr ) + sizeof( olsr_hello_hdr ) + blocks_size;
+	int packet_size = sizeof( olsr_pkt_hdr ) + msg_size;
+	int headroom = OLSR_HEADROOM;
 	int tailroom = 0;
 	WritablePacket *packet = Packet::make( headroom, 0, packet_size, tailroom );
 	if ( packet == 0 )
 	{
 		click_chatter( "in %s: cannot make packet!", name().c_str() );
+		return 0;
 	}
 	memset( packet->data(), 0, packet->length() );
-	//packet->set_perfctr_anno(cycles);
-	struct timeval tv;
-	click_gettimeofday( &tv );
-	packet->set_timestamp_anno( tv );
 
 	olsr_pkt_hdr *pkt_hdr = ( olsr_pkt_hdr * ) packet->data();
-	pkt_hdr->pkt_length = 0;
-	pkt_hdr->pkt_seq = 0; //added in OLSRAddPaqSeq
+	pkt_hdr->pkt_length = htons( packet_size );
+	pkt_hdr->pkt_seq = 0; //added in AddPacketSeq (for each interface)
 
 	olsr_msg_hdr *msg_hdr = ( olsr_msg_hdr * ) ( pkt_hdr + 1 );
-	msg_hdr->msg_type = OLSR_HELLO_MESSAGE;
+	msg_hdr->msg_type = _link_quality ? OLSR_LQ_HELLO_MESSAGE : OLSR_HELLO_MESSAGE;
+	if ( _compact )
+		msg_hdr->msg_type = OLSR_COMPACT_HELLO_MESSAGE;
 	msg_hdr->vtime = _vtime;
-	msg_hdr->msg_size = htons( sizeof( olsr_msg_hdr ) + sizeof( olsr_hello_hdr ) );
+	msg_hdr->msg_size = htons( msg_size );
 	msg_hdr->originator_address = _myMainIP.in_addr();
 	msg_hdr->ttl = 1;  //hello packets MUST NOT be forwarded
 	msg_hdr->hop_count = 0;
-
+	msg_hdr->msg_seq = 0; //set per copy in generate_hello
 
 	olsr_hello_hdr *hello_hdr = ( olsr_hello_hdr * ) ( msg_hdr + 1 );
 	hello_hdr->reserved = 0;
 	hello_hdr->htime = _htime;
 	hello_hdr->willingness = _node_willingness;
 
-	if ( neighbor_interfaces.empty() )
+	if ( _advertised.empty() )
 	{ //if no neighbors, broadcast willingness
 		click_chatter( "OLSRHelloGenerator, no neighbors, broadcasting willingness anyway\n" );
 	}
 
-	else
-	{ // there are neighbors, generate link messages
-		in_addr *address = 0;
-		olsr_link_hdr *link_hdr;
-		int number_in_neighbor_interfaces = 0; //rather unelegant solution to problem with pointers,
-		//avoids overwriting addresses in hello message
-
-		for ( HashMap<uint8_t, Vector <IPAddress> >::iterator iter = neighbor_interfaces.begin(); iter != neighbor_interfaces.end(); iter++ )
-		{
-			//if (packet->put(sizeof(olsr_link_hdr))==0) click_chatter ("put 1 resulted in 0\n");
-
-			if ( number_in_neighbor_interfaces == 0 )
-			{
-				link_hdr = ( olsr_link_hdr * ) ( hello_hdr + 1 );
-			}
-			else
-				link_hdr = ( olsr_link_hdr * ) ( address + 1 );
-
-			link_hdr->link_code = iter.key();
-			link_hdr->reserved = 0;
-			link_hdr->link_msg_size = htons( sizeof( olsr_link_hdr ) );
-			Vector<IPAddress> addr_vector = iter.value();
-			int size = addr_vector.size();
-			//click_chatter ("adding %d addresses with linkcode %d \n",size, iter.key());
-			for ( int i = 0; i < size; i++ )
+	// there are neighbors, generate one link message per link code
+	uint8_t *pos = ( uint8_t * ) ( hello_hdr + 1 );
+	if ( _compact )
+	{
+		for ( int code = 0; code < 16; code++ )
+			pos = OLSRAddressBlock::write( pos, block_addresses[ code ].begin(), _link_quality ? block_lq[ code ].begin() : 0, block_addresses[ code ].size(), code );
+		return packet;
+	}
+	for ( int code = 0; code < 16; code++ )
+	{
+		if ( addresses_with_code[ code ] == 0 )
+			continue;
+		olsr_link_hdr *link_hdr = ( olsr_link_hdr * ) pos;
+		link_hdr->link_code = code;
+		link_hdr->reserved = 0;
+		link_hdr->link_msg_size = htons( sizeof( olsr_link_hdr ) + addresses_with_code[ code ] * address_size );
+		pos = ( uint8_t * ) ( link_hdr + 1 );
+		for ( int i = 0; i < _advertised.size(); i++ )
+			if ( ( _advertised[ i ].link_code & 0x0f ) == code )
 			{
-				// click_chatter ("\t i=%d: %s\n",i,addr_vector[i].unparse().c_str());
-				if ( i == 0 )
-					address = ( in_addr * ) ( link_hdr + 1 );
-				else
-					address = ( in_addr * ) ( address + 1 );
-
-				*address = addr_vector[ i ].in_addr();
-				link_hdr->link_msg_size = htons( ntohs( link_hdr->link_msg_size ) + sizeof( in_addr ) );
+				*( in_addr * ) pos = _advertised[ i ].address.in_addr();
+				if ( _link_quality )
+				{
+					olsr_lq_info *lq_info = ( olsr_lq_info * ) ( pos + sizeof( in_addr ) );
+					lq_info->lq = _advertised[ i ].lq;
+					lq_info->nlq = _advertised[ i ].nlq;
+				}
+				pos += address_size;
 			}
-
-			msg_hdr->msg_size = htons( ntohs( msg_hdr->msg_size ) + ntohs( link_hdr->link_msg_size ) );
-			number_in_neighbor_interfaces++;
-		}
 	}
-	msg_hdr_info msg_info = OLSRPacketHandle::get_msg_hdr_info( packet, sizeof( olsr_pkt_hdr ) );
-	pkt_hdr->pkt_length = htons( msg_info.msg_size + sizeof( olsr_pkt_hdr ) );
-	pkt_hdr->pkt_seq = 0; //added in AddPacketSeq (for each interface)
-	msg_hdr->msg_seq = htons ( _forward->get_msg_seq() );	//this also increases the sequence number;
 	return packet;
 }
 
@@ -240,10 +291,12 @@ void OLSRHelloGenerator::notify_mpr_change()
 }
 
 uint8_t
-OLSRHelloGenerator::get_link_code( struct link_data *data, timeval now )
+OLSRHelloGenerator::get_link_code( struct link_data *data, olsr_time_t now )
 {
 	uint8_t link_code;
-	if ( data->L_SYM_time >= now )
+	if ( data->L_LOST_LINK_time >= now )
+		link_code = OLSR_LOST_LINK;
+	else if ( data->L_SYM_time >= now )
 		link_code = OLSR_SYM_LINK;
 	else if ( data->L_ASYM_time >= now && data->L_SYM_time < now )
 		link_code = OLSR_ASYM_LINK;
@@ -251,13 +304,13 @@ OLSRHelloGenerator::get_link_code( struct link_data *data, timeval now )
 		link_code = OLSR_LOST_LINK;
 
 	IPAddress neigh_iface_addr = data->L_neigh_iface_addr.addr();
-	IPAddress neigh_main_addr = _interfaceInfoBase->get_main_address( neigh_iface_addr );
+	IPAddress neigh_main_addr = _linkInfoBase->neighbor_main_address( data );
 
 	if ( _neighborInfoBase->find_mpr( neigh_main_addr ) != 0 )
 		link_code = link_code | ( OLSR_MPR_NEIGH << 2 );
 	else
 	{
-		neighbor_data *neigh_data = _neighborInfoBase->find_neighbor( neigh_main_addr );
+		neighbor_data *neigh_data = _linkInfoBase->neighbor_tuple( data );
 		if ( ! neigh_data == 0 )
 		{
 			if ( neigh_data->N_status == OLSR_SYM_NEIGH )
@@ -271,50 +324,16 @@ OLSRHelloGenerator::get_link_code( struct link_data *data, timeval now )
 	return link_code;
 }
 
-
-uint8_t
-OLSRHelloGenerator::compute_htime()
-{
-	//_period in milliseconds
-	//OLSR_C_us in sec
-	uint8_t return_value = 0;
-	int t = _period * 1000;
-	int b = 0;
-	while ( ( t / OLSR_C_us ) >= ( 1 << ( b + 1 ) ) )
-		b++;
-	int a = ( ( ( 16 * t / OLSR_C_us ) >> b ) - 16 );
-	int value = ( OLSR_C_us * ( 16 + a ) * ( 1 << b ) ) >> 4;
-	if ( value < t ) a++;
-if ( a == 16 ) {b++; a = 0;}
-	if ( ( a <= 15 && a >= 0 ) && ( b <= 15 && b >= 0 ) )
-		return_value = ( ( a << 4 ) | b );
-	return return_value;
-}
-
-uint8_t
-OLSRHelloGenerator::compute_vtime()
-{
-	uint8_t return_value = 0;
-	int t = _neighbor_hold_time * 1000; //msec->sec
-	//_neighbor_hold_time.tv_usec+_neighbor_hold_time.tv_sec*1000000; //fixpoint -> calculation in sec
-	int b = 0;
-	while ( ( t / OLSR_C_us ) >= ( 1 << ( b + 1 ) ) )
-		b++;
-	int a = ( ( ( 16 * t / OLSR_C_us ) >> b ) - 16 );
-	int value = ( OLSR_C_us * ( 16 + a ) * ( 1 << b ) ) >> 4;
-	if ( value < t ) a++;
-if ( a == 16 ) {b++; a = 0;}
-	if ( ( a <= 15 && a >= 0 ) && ( b <= 15 && b >= 0 ) )
-		return_value = ( ( a << 4 ) | b );
-	return return_value;
-}
-
 /// == mvhaen ====================================================================================================
 void
 OLSRHelloGenerator::set_period(int period)
 {
 	_period = period;
-	_htime = compute_htime();
+	_htime = olsr_vtime_encode( olsr_msec( _period ) );
+	//a shorter period takes effect now, not after the pending interval
+	if ( _timer.scheduled() && Timestamp::now() + Timestamp::make_msec( period ) < _timer.expiry() )
+		_timer.reschedule_after_msec( period );
+	cleanup( CLEANUP_ROUTER_INITIALIZED );	//drop the cached message, it has the old htime
 	click_chatter ( "_period = %d | _htime = %d\n", _period, _htime );
 }
 
@@ -322,7 +341,8 @@ void
 OLSRHelloGenerator::set_neighbor_hold_time(int neighbor_hold_time)
 {
 	_neighbor_hold_time = neighbor_hold_time;
-	_vtime = compute_vtime();
+	_vtime = olsr_vtime_encode( olsr_msec( _neighbor_hold_time ) );
+	cleanup( CLEANUP_ROUTER_INITIALIZED );	//drop the cached message, it has the old vtime
 	click_chatter ( "_neighbor_hold_time = %d | _vtime = %d\n", _neighbor_hold_time, _vtime );
 }
 
@@ -357,6 +377,7 @@ OLSRHelloGenerator::add_handlers()
 {
 	add_write_handler("set_period", set_period_handler, (void *)0);
 	add_write_handler("set_neighbor_hold_time", set_neighbor_hold_time_handler, (void *)0);
+	add_task_handlers(_timer.task(), "timer_");
 }
 /// == !mvhaen ===================================================================================================
 
@@ -364,8 +385,8 @@ OLSRHelloGenerator::add_handlers()
 #include <click/vector.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
 template class Vector<IPAddress>;
-template class HashMap<IPPair, void *>;
-template class HashMap<IPPair, void *>::iterator;
+template class Vector<OLSRHelloGenerator::AdvertisedAddress>;
+template class Vector<olsr_lq_info>;
 #endif
 
 
@@ -14,6 +14,12 @@
  
   =d
   Generates a Hello message every INTERVAL msecs based on the information stored in the OLSRLinkInfoBase given as argument. If the node has no neighbors, a Hello message is made, containing only this node's willingness to forward traffic.
+
+  The last message built is kept; as long as the link codes and addresses to advertise stay the same, each interval copies it and only sets the message sequence number.
+
+  Keyword LINK_QUALITY, a boolean, makes the element send LQ_HELLO messages (type 201, as in olsrd) instead: every address is followed by the share of that neighbor's HELLOs received on the link and the share of ours the neighbor reported, see OLSRProcessHello. Default is false.
+
+  Keyword COMPACT, a boolean, makes the element send COMPACT_HELLO messages (type 204) instead, which carry the addresses of each link code in address blocks: the leading bytes the addresses share are sent once, so that in a network numbered from one /16 an address takes two bytes instead of four. Every OLSRProcessHello reads them, but other OLSR implementations do not, so all nodes of the network need the same setting. Default is false.
  
   =a
   OLSRTCGenerator, OLSRForward
@@ -31,6 +37,7 @@
 #include "olsr_neighbor_infobase.hh"
 #include "olsr_interface_infobase.hh"
 #include "click_olsr.hh"
+#include "olsr_control_timer.hh"
 #include "olsr_forward.hh"
 
 CLICK_DECLS
@@ -51,28 +58,36 @@ public:
 
 	int configure(Vector<String> &, ErrorHandler *);
 	int initialize(ErrorHandler *);
+	void cleanup(CleanupStage);
 
 	Packet *generate_hello();//IPAddress local_iface_addr);
 	void notify_mpr_change();
 	void run_timer(Timer *);
 
 	void add_handlers();	
-	
-private:
 
-	uint8_t get_link_code(struct link_data *data, timeval now);
-	uint8_t compute_htime();
-	uint8_t compute_vtime();	
-	
+	int period() const			{ return _period; }
+	int neighbor_hold_time() const		{ return _neighbor_hold_time; }
 	void set_period(int period);
 	void set_neighbor_hold_time(int neighbor_hold_time);
+	
+private:
+
+	struct AdvertisedAddress {
+		uint8_t link_code;
+		IPAddress address;
+		uint8_t lq, nlq;	// with LINK_QUALITY
+	};
+
+	uint8_t get_link_code(struct link_data *data, olsr_time_t now);
+	Packet *build_hello();
 
 	static int set_period_handler(const String &conf, Element *e, void *, ErrorHandler * errh);
 	static int set_neighbor_hold_time_handler(const String &conf, Element *e, void *, ErrorHandler * errh);
 	
 	int _period;
 	uint8_t _htime, _vtime;
-	Timer _timer;
+	OLSRControlTimer _timer;
 	OLSRLinkInfoBase *_linkInfoBase;
 	OLSRNeighborInfoBase *_neighborInfoBase;
 	OLSRInterfaceInfoBase *_interfaceInfoBase;
@@ -81,6 +96,12 @@ private:
 	IPAddress _myMainIP;
 	int _neighbor_hold_time;
 	int _node_willingness;
+	bool _link_quality;
+	bool _compact;
+
+	Packet *_hello_template;			// last Hello built, msg_seq not filled in
+	Vector<AdvertisedAddress> _template_advertised;	// what _hello_template advertises
+	Vector<AdvertisedAddress> _advertised;		// what is to be advertised now
 };
 
 
@@ -33,6 +33,7 @@
 #include <click/confparse.hh>
 #include <click/error.hh>
 #include <math.h>
+#include <clicknet/ip.h>
 #include <clicknet/udp.h>
 #include <clicknet/ether.h>
 #include <click/ipaddress.hh>
@@ -46,7 +47,7 @@
 CLICK_DECLS
 
 OLSRHNAGenerator::OLSRHNAGenerator()
-		: _timer(this), _association_info(0)
+		: _timer(this), _association_info(0), _mtu(1500), _capacity(0), _load(0)
 {
 }
 
@@ -61,6 +62,8 @@ OLSRHNAGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
 {
 	IPAddress network_addr = IPAddress();
 	IPAddress netmask = IPAddress();
+	Element *trace = 0;
+	uint32_t trace_mask = 0xFFFFFFFFU;
 	int res = cp_va_parse(conf, this, errh,
 	                      cpInteger, "HNA sending interval (msec)", &_period,
 	                      cpInteger, "HNA Holding Time (msec)",&_hna_hold_time,
@@ -68,12 +71,20 @@ OLSRHNAGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
 	                      cpKeywords,
 	                      "NETWORK", cpIPPrefix, "the network that HNA should advertise e.g. 10.0.0.0/24", &network_addr, &netmask,
 	                      "ASSOCIATION_INFO", cpElement, "AssociationInfoBase element: contains the networks to be advertised", &_association_info,
+	                      "MTU", cpInteger, "largest packet to build (bytes)", &_mtu,
+	                      "CAPACITY", cpUnsigned, "uplink capacity to advertise (kbit/s)", &_capacity,
+	                      "TRACE", cpElement, "OLSRTrace element", &trace,
+	                      "TRACE_MASK", cpUnsigned, "events to trace", &trace_mask,
 	                      0);
 
 	if ( res < 0 )
 		return res;
+	if ( set_trace(trace, trace_mask, this, errh) < 0 )
+		return -1;
 	if ( _period <= 0 )
 		return errh->error("period must be greater than 0");
+	if ( _mtu < (int) (sizeof(click_ip) + sizeof(click_udp) + sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + 2 * sizeof(in_addr)) )
+		return errh->error("MTU too small to carry an association");
 	if (!(network_addr == IPAddress() || netmask == IPAddress()))
 	{
 		_Association association;
@@ -90,13 +101,23 @@ OLSRHNAGenerator::initialize(ErrorHandler *)
 {
 	_timer.initialize(this);
 	_timer.schedule_after_msec(_period); // Send OLSR HELLO periodically
-	_vtime = compute_vtime();
+	_vtime = olsr_vtime_encode(olsr_msec(_hna_hold_time));
 	_end_of_validity_time = make_timeval(0,0);
 	_last_msg_sent_at = make_timeval(0,0);
+	_associations_changed = true;
 	return 0;
 }
 
 
+void
+OLSRHNAGenerator::cleanup(CleanupStage)
+{
+	for (int i = 0; i < _hna_templates.size(); i++)
+		_hna_templates[i]->kill();
+	_hna_templates.clear();
+}
+
+
 void
 OLSRHNAGenerator::run_timer(Timer *)
 {
@@ -110,30 +131,72 @@ void
 OLSRHNAGenerator::generate_hna()
 {
 	//click_chatter ("generate_hna \n");
-	Vector<IPPair> *association_set = 0;
-	int packet_size;
+	if (_association_info != 0 && _association_info->version() != _association_version)
+		_associations_changed = true;
+	if (_associations_changed)
+		build_hna();
+
+	//the copies are made here and not in OLSRForward, which writes msg_seq
+	for (int i = 0; i < _hna_templates.size(); i++)
+		if (WritablePacket *packet = olsr_copy_packet(_hna_templates[i]))
+			output(0).push(packet);
+
+	//the load changes between emissions, so this one is built each time
+	if (_capacity > 0 && !_hna_templates.empty())
+		if (Packet *packet = make_gateway_load())
+			output(0).push(packet);
+}
+
 
-	// compute the HNA packet size
-	// HNAGenerator stores a list of fixed associations.
-	packet_size = sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + sizeof(in_addr)*2*_fixedAssociations.size();
-	// HNAGenerator can also advertise the information in an _association_info element
+/**
+ * rebuilds the HNA messages from the fixed associations and those of the
+ * AssociationInfoBase, as many messages as the MTU requires
+ */
+void
+OLSRHNAGenerator::build_hna()
+{
+	for (int i = 0; i < _hna_templates.size(); i++)
+		_hna_templates[i]->kill();
+	_hna_templates.clear();
+	_associations_changed = false;
+
+	Vector<IPPair> associations;
+	for (Vector<_Association>::iterator iter = _fixedAssociations.begin(); iter != _fixedAssociations.end(); iter++)
+		associations.push_back(IPPair(iter->network_addr, iter->netmask));
 	if (_association_info != 0)
 	{
-		association_set = _association_info->get_associations();
-		if (_fixedAssociations.size() == 0 && association_set->size() == 0)
-		{
-			return;
-		}
-		packet_size += association_set->size()*sizeof(in_addr)*2;
+		_association_version = _association_info->version();
+		Vector<IPPair> *association_set = _association_info->get_associations();
+		for (Vector<IPPair>::iterator iter = association_set->begin(); iter != association_set->end(); iter++)
+			associations.push_back(*iter);
+	}
+	trace(OLSR_TRACE_HNA_BUILT, _my_ip, IPAddress(), IPAddress(), associations.size());
+	for (int i = 0; i < associations.size(); i++)
+		trace(OLSR_TRACE_HNA_ASSOCIATION, _my_ip, associations[i]._from, associations[i]._to);
+
+	int per_message = (_mtu - sizeof(click_ip) - sizeof(click_udp) - sizeof(olsr_pkt_hdr) - sizeof(olsr_msg_hdr)) / (2 * sizeof(in_addr));
+	for (int begin = 0; begin < associations.size(); begin += per_message)
+	{
+		int end = begin + per_message;
+		if (end > associations.size())
+			end = associations.size();
+		if (Packet *packet = make_hna(associations, begin, end))
+			_hna_templates.push_back(packet);
 	}
+}
 
 
-	int headroom = sizeof(click_ether) + sizeof(click_ip) + sizeof(click_udp);
+Packet *
+OLSRHNAGenerator::make_hna(const Vector<IPPair> &associations, int begin, int end)
+{
+	int packet_size = sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + (end - begin) * 2 * sizeof(in_addr);
+	int headroom = OLSR_HEADROOM;
 	int tailroom = 5 * sizeof(in_addr); //enough room for 5 advertised neighbors
 	WritablePacket *packet = Packet::make(headroom,0,packet_size, tailroom);
 	if ( packet == 0 )
 	{
 		click_chatter( "in %s: cannot make packet!", name().c_str());
+		return 0;
 	}
 	memset(packet->data(), 0, packet->length());
 
@@ -144,91 +207,46 @@ OLSRHNAGenerator::generate_hna()
 	olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (pkt_hdr + 1);
 	msg_hdr->msg_type = OLSR_HNA_MESSAGE;
 	msg_hdr->vtime = _vtime;
-	msg_hdr->msg_size = htons(sizeof(olsr_msg_hdr));
+	msg_hdr->msg_size = htons(sizeof(olsr_msg_hdr) + (end - begin) * 2 * sizeof(in_addr));
 	msg_hdr->originator_address = _my_ip.in_addr();
 	msg_hdr->ttl = 255;  //HNA messages should diffuse into entire network
 	msg_hdr->hop_count = 0;
 	msg_hdr->msg_seq = 0; //added in OLSRForward element
 
-
-	bool first_iter = true;
-	in_addr *address = 0;
-	address = (in_addr *) (msg_hdr + 1);
-	if (! _fixedAssociations.empty())
+	in_addr *address = (in_addr *) (msg_hdr + 1);
+	for (int i = begin; i < end; i++)
 	{
-		//click_chatter("%s | generating a hna for the subnet\n");
-		//click_chatter("%s | I am advertising the following subnets that can be reached\n");
-		for (Vector<_Association>::iterator iter = _fixedAssociations.begin(); iter != _fixedAssociations.end(); iter++)
-		{
-
-			if (first_iter)	first_iter = false;
-			else address = (in_addr *) (address + 1);
-
-			_Association* association = iter;
-			*address = association->network_addr.in_addr();
-			//	click_chatter("%s | network_addr = %s\n", _my_ip.unparse().c_str(), association->network_addr.unparse().c_str());
-			address = (in_addr *) (address + 1);
-			*address = association->netmask.in_addr();
-			//	click_chatter("%s | netmask = %s\n", _my_ip.unparse().c_str(), association->netmask.unparse().c_str());
-			msg_hdr->msg_size = htons( ntohs(msg_hdr->msg_size) + 2 * sizeof(in_addr) );
-
-		}
+		*address++ = associations[i]._from.in_addr();
+		*address++ = associations[i]._to.in_addr();
 	}
-	if (_association_info != 0 && association_set != 0 && ! association_set->empty())
-	{
-		click_chatter("%s | generating a hna for the subnet\n", name().c_str());
-		click_chatter("%s | I am advertising the following subnets that can be reached\n", name().c_str());
-		for (Vector<IPPair>::iterator iter = association_set->begin(); iter != association_set->end(); iter++)
-		{
-			/* //--mvhaen-- changes due to MORHE
-			 // a slight hack. If we were set to advertise a subnet, don't advertise nodes that we already advertised
-			 for (Vector<_Association>::iterator iter2 = _fixedAssociations.begin(); iter2 != _fixedAssociations.end(); iter2++)
-			 {
-			   if (iter->_from.matches_prefix(iter->_network_addr, iter2->netmask_))
-			   {
-			     continue;
-			   }
-			 }
-			 //--mvhaen--*/
-			if (first_iter)	first_iter = false;
-			else address = (in_addr *) (address + 1);
-
-			*address = iter->_from.in_addr();
-			click_chatter("%s | A_network_addr = %s\n", _my_ip.unparse().c_str(), iter->_from.unparse().c_str());
-			address = (in_addr *) (address + 1);
-			*address = iter->_to.in_addr();
-			click_chatter("%s | A_netmask = %s\n", _my_ip.unparse().c_str(), iter->_to.unparse().c_str());
-			msg_hdr->msg_size = htons( ntohs(msg_hdr->msg_size) + 2 * sizeof(in_addr) );
-
-		}
-	}
-	//  pkt_hdr->pkt_length = htons ( ntohs(pkt_hdr->pkt_length) + ntohs(msg_hdr->msg_size) );
-	//click_chatter ("end hna_generate\n");
-	output(0).push(packet);
-
+	return packet;
 }
 
-uint8_t
-OLSRHNAGenerator::compute_vtime()
+Packet *
+OLSRHNAGenerator::make_gateway_load()
 {
-	uint8_t return_value = 0;
-	int t = _hna_hold_time*1000; //top_hold_time in msec -> t in sec
-	//_top_hold_time.tv_usec+_top_hold_time.tv_sec*1000000; //fixpoint -> calculation in sec
-
-	int b=0;
-	while ((t / OLSR_C_us) >= (1<<(b+1)))
-		b++;
-	int a=(((16*t/OLSR_C_us)>>b)-16);
-	int value=(OLSR_C_us *(16+a)*(1<<b))>>4;
-	if (value<t) a++;
-	if (a==16)
+	int packet_size = sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + sizeof(olsr_gateway_load);
+	WritablePacket *packet = Packet::make(OLSR_HEADROOM, 0, packet_size, 0);
+	if ( packet == 0 )
 	{
-		b++; a=0;
+		click_chatter( "in %s: cannot make packet!", name().c_str());
+		return 0;
 	}
+	memset(packet->data(), 0, packet->length());
+
+	olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (packet->data() + sizeof(olsr_pkt_hdr));
+	msg_hdr->msg_type = OLSR_GATEWAY_LOAD_MESSAGE;
+	msg_hdr->vtime = _vtime;
+	msg_hdr->msg_size = htons(sizeof(olsr_msg_hdr) + sizeof(olsr_gateway_load));
+	msg_hdr->originator_address = _my_ip.in_addr();
+	msg_hdr->ttl = 255;  //reaches every node the HNA messages reach
+	msg_hdr->hop_count = 0;
+	msg_hdr->msg_seq = 0; //added in OLSRForward element
 
-	if ( (a <= 15 && a >= 0) && (b <= 15 && b >= 0) )
-		return_value = ((a << 4) | b );
-	return return_value;
+	olsr_gateway_load *gl = (olsr_gateway_load *) (msg_hdr + 1);
+	gl->capacity = htonl(_capacity);
+	gl->load = htonl(_load);
+	return packet;
 }
 
 int
@@ -246,18 +264,50 @@ OLSRHNAGenerator::add_association_write_handler(const String &conf, Element *e,
 	association.network_addr = network_addr;
 	association.netmask = netmask;
 	me->_fixedAssociations.push_back(association);
+	me->_associations_changed = true;
+
+	return 0;
+}
+
 
+int
+OLSRHNAGenerator::load_write_handler(const String &conf, Element *e, void *thunk, ErrorHandler *errh)
+{
+	OLSRHNAGenerator* me = (OLSRHNAGenerator *) e;
+	uint32_t value;
+	if (!cp_integer(cp_uncomment(conf), &value))
+		return errh->error("expected kbit/s");
+	if (thunk)
+		me->_capacity = value;
+	else
+		me->_load = value;
 	return 0;
 }
 
 
+String
+OLSRHNAGenerator::read_capacity(Element *e, void *)
+{
+	OLSRHNAGenerator* me = (OLSRHNAGenerator *) e;
+	return String(me->_capacity) + "\n";
+}
+
+
 void
 OLSRHNAGenerator::add_handlers()
 {
 	add_write_handler("add_association", add_association_write_handler, (void *)0);
+	add_write_handler("load", load_write_handler, (void *)0);
+	add_write_handler("capacity", load_write_handler, (void *)1);
+	add_read_handler("capacity", read_capacity, (void *)0);
+	add_trace_handlers(this);
+	add_task_handlers(_timer.task(), "timer_");
 }
 
 #include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<Packet *>;
+#endif
 
 CLICK_ENDDECLS
 
@@ -5,7 +5,7 @@
   OLSR specific element, generates OLSR HNA messages
 
   =s
-  OLSRHNAGenerator(INTERVAL(msecs), Holding Time (msec), IPAddress, NETWORK IPAddress/netmask, ASSOCIATION_INFO AssociationInfoBase Element)
+  OLSRHNAGenerator(INTERVAL(msecs), Holding Time (msec), IPAddress, NETWORK IPAddress/netmask, ASSOCIATION_INFO AssociationInfoBase Element, MTU bytes, CAPACITY kbit/s, TRACE OLSRTrace element, TRACE_MASK mask)
   
   =io
   One output
@@ -19,10 +19,29 @@
     [$node_($i) set classifier_] writehandler "hna_generator_name" "add_association" "143.129.73.0/24"
   "hna_generator_name" should be replaced with the name of the OLSRHNAGenerator Element in the click script.
   MODE 5 is similar to mode 4, but it requires ASSOCIATION_INFO to be set.
+  The messages are built only when the advertised associations change, as
+  told by the version() of the AssociationInfoBase, and then copied every
+  INTERVAL. Associations that do not fit in one packet of MTU bytes
+  (default 1500) are split over several messages. Each rebuild is recorded
+  as an hna_built event, followed by an hna_association event per
+  association, in the OLSRTrace element given as TRACE.
+  With CAPACITY, the uplink capacity of this gateway in kbit/s, every HNA
+  emission is followed by a GATEWAY_LOAD message giving that capacity and
+  the load last written to the load handler, so that OLSRRoutingTable
+  elements with GATEWAY_BALANCE share the flows to the advertised networks
+  among the gateways by the capacity they have left. Nodes that do not know
+  the message type forward it without processing it.
   @NOTE: the interface for configuring hna_generator could be improved upon: instead of having 1 pair, a list of pairs to be advertised should be offered. A possibility is also to allow associations to be removed dynamically.
 
+  =h load write-only
+  Uplink load in kbit/s to advertise with CAPACITY, for example measured by
+  a counter on the uplink.
+
+  =h capacity read/write
+  Uplink capacity in kbit/s; 0 stops the GATEWAY_LOAD messages.
+
   =a
-  OLSRHelloGenerator, OLSRForward
+  OLSRHelloGenerator, OLSRForward, OLSRProcessHNA
 
 */
 
@@ -34,6 +53,8 @@
 #include <click/ipaddress.hh>
 #include "olsr_association_infobase.hh"
 #include "click_olsr.hh"
+#include "olsr_control_timer.hh"
+#include "olsr_trace.hh"
 #include <click/vector.hh>
 
 CLICK_DECLS
@@ -46,7 +67,7 @@ class OLSRNeighborInfoBase;
 #define HNA_MODE_SIM			3
 #define HNA_MODE_SIM_AND_ASSOCIATION	4
 
-class OLSRHNAGenerator : public Element{
+class OLSRHNAGenerator : public Element, public OLSRTrace::Client{
 public:
 
   OLSRHNAGenerator();
@@ -59,6 +80,7 @@ public:
 
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
 
   void generate_hna();
   void run_timer(Timer *);
@@ -72,7 +94,7 @@ private:
   int _period;
   uint8_t _vtime;
   struct timeval _end_of_validity_time;
-  Timer _timer;
+  OLSRControlTimer _timer;
   OLSRAssociationInfoBase *_association_info;
   IPAddress _my_ip;
 
@@ -80,10 +102,21 @@ private:
   
   timeval _last_msg_sent_at;
   int _hna_hold_time;
+  int _mtu;
+  uint32_t _capacity;			// kbit/s, 0 without GATEWAY_LOAD messages
+  uint32_t _load;
+
+  Vector<Packet *> _hna_templates;	// last HNA messages built, msg_seq not filled in
+  bool _associations_changed;		// _hna_templates out of date
+  uint32_t _association_version;	// of _association_info when built
+  void build_hna();
+  Packet *make_hna(const Vector<IPPair> &associations, int begin, int end);
+  Packet *make_gateway_load();
 
-  uint8_t compute_vtime();
   void add_handlers();
   static int add_association_write_handler(const String &association, Element *e, void *, ErrorHandler *);
+  static int load_write_handler(const String &, Element *, void *, ErrorHandler *);
+  static String read_capacity(Element *, void *);
 };
 
 CLICK_ENDDECLS
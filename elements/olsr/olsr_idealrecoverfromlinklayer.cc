@@ -53,18 +53,8 @@ OLSRIdealRecoverFromLinkLayer::notify(const IPAddress &next_hop_IP)
 	IPAddress next_hop_main_IP = _interfaceInfoBase->get_main_address(next_hop_IP);
 	_linkInfoBase->remove_link(_myMainIP, next_hop_IP);
 	// remove the matching neighbor from the neighbor info base if there are no more links
-	bool other_interfaces_left = false;
+	bool other_interfaces_left = (_linkInfoBase->links_to(next_hop_main_IP) != 0);
 	bool mpr_selector_removed = true;
-	for (OLSRLinkInfoBase::LinkSet::iterator iter = _linkInfoBase->get_link_set()->begin(); iter != _linkInfoBase->get_link_set()->end(); iter++)
-	{
-		link_data *data = (link_data *)iter.value();
-		if (_interfaceInfoBase->get_main_address(data->L_neigh_iface_addr) == next_hop_main_IP)
-		{
-			other_interfaces_left = true;
-			break;
-
-		}
-	}
 	if (!other_interfaces_left)
 	{
 		_neighborInfoBase->remove_neighbor(next_hop_main_IP);
@@ -76,8 +66,12 @@ OLSRIdealRecoverFromLinkLayer::notify(const IPAddress &next_hop_IP)
 	}
 	// make sure that the MPRs and Route Table are updated
 	if (mpr_selector_removed) _tcGenerator->notify_mpr_selector_changed();
-	_neighborInfoBase->compute_mprset();
-	_routingTable->compute_routing_table();
+	_neighborInfoBase->schedule_compute_mprset();
+	// switch to the alternate next hops at once if there are any, the full
+	// computation follows from the routing table's Task
+	_routingTable->note_event(OLSRRoutingTable::EVENT_LINK_FAILURE);
+	if (!_routingTable->fail_over(next_hop_IP))
+		_routingTable->compute_routing_table();
 
 }
 
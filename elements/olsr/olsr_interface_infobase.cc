@@ -6,11 +6,13 @@
 #include <click/ipaddress.hh>
 //#include "ippair.hh"
 #include "click_olsr.hh"
+#include "olsr_bulk_load.hh"
+#include <click/error.hh>
 
 CLICK_DECLS
 
 OLSRInterfaceInfoBase::OLSRInterfaceInfoBase()
-  : _timer(this)
+  : _generation(0), _timer(this), _expiryQueue(0), _bulk(false), _bulk_changed(false)
 {
 }
 
@@ -23,11 +25,24 @@ OLSRInterfaceInfoBase::~OLSRInterfaceInfoBase()
 int
 OLSRInterfaceInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+  Element *expiry_queue = 0;
+  int max_interfaces = 0;
+  uint32_t rate = 0, burst = 32;
   if ( cp_va_parse(conf, this, errh, 
 		   cpElement, "Routing Table Element", &_routingTable,
 		   cpElement, "local Interfaces Information Base", &_localIfInfoBase,
+		   cpKeywords,
+		   "EXPIRY_QUEUE", cpElement, "shared expiry timer", &expiry_queue,
+		   "MAX_INTERFACES", cpInteger, "maximum number of tuples", &max_interfaces,
+		   "ALIAS_RATE", cpUnsigned, "new tuples per second per node", &rate,
+		   "ALIAS_BURST", cpUnsigned, "new tuples per node at once", &burst,
 		   0) < 0 )
     return -1;
+  if (expiry_queue && !(_expiryQueue = (OLSRExpiryQueue *) expiry_queue->cast("OLSRExpiryQueue")))
+    return errh->error("EXPIRY_QUEUE element is not an OLSRExpiryQueue");
+  if (max_interfaces < 0 || burst > (1 << 20))
+    return errh->error("MAX_INTERFACES must be positive, ALIAS_BURST at most %d", 1 << 20);
+  _admission.set(max_interfaces, rate, burst);
   return 0;
 }
 
@@ -37,30 +52,197 @@ OLSRInterfaceInfoBase::initialize(ErrorHandler *)
 {
   _interfaceSet = new InterfaceSet();	//ok new
   _timer.initialize(this);
+  set_expiry(_expiryQueue, &_timer);
   return 0;
 }
 
 void OLSRInterfaceInfoBase::uninitialize()
 {
  delete _interfaceSet;
+ _aliases.clear();
+}
+
+void
+OLSRInterfaceInfoBase::take_state(Element *e, ErrorHandler *)
+{
+  OLSRInterfaceInfoBase *old = (OLSRInterfaceInfoBase *) e->cast("OLSRInterfaceInfoBase");
+  if (!old)
+    return;
+
+  InterfaceSet *interfaceSet = _interfaceSet;
+  _interfaceSet = old->_interfaceSet;
+  old->_interfaceSet = interfaceSet;
+  _expiry.swap(old->_expiry);
+  interfaces_changed();
+
+  if (!_expiry.empty())
+    expire_at(_expiry.next());
+}
+
+
+void
+OLSRInterfaceInfoBase::interfaces_changed()
+{
+  _aliases.clear();
+  _generation++;
 }
 
 bool
-OLSRInterfaceInfoBase::add_interface(IPAddress iface_addr, IPAddress main_addr, struct timeval time)
+OLSRInterfaceInfoBase::add_interface(IPAddress iface_addr, IPAddress main_addr, olsr_time_t time)
 {
-  struct interface_data *data;
-  data = new struct interface_data;		//new memory released in remove
+  struct interface_data data;		//stored inline in the interface set
 
-  data->I_iface_addr = iface_addr;
-  data->I_main_addr = main_addr;
-  data->I_time = time;
+  data.I_iface_addr = iface_addr;
+  data.I_main_addr = main_addr;
+  data.I_time = time;
 
-  if (_interfaceSet->empty()) {
-    _timer.schedule_at(time);
+  if (_admission.active() && !_interfaceSet->findp(iface_addr) && !admit(main_addr))
+    return false;
+
+  if (_bulk)
+    _expiry.append(time, iface_addr);
+  else {
+    _expiry.push(time, iface_addr);
+    expire_at(time);
   }
   
 //    click_chatter("Inserted (%s, (iface addr = %s, main addr = %s, timeval=%u)) in interfaceSet", iface_addr.unparse().c_str(), iface_addr.unparse().c_str(), main_addr.unparse().c_str(), time.tv_sec);
-  return ( _interfaceSet->insert(iface_addr, data) );
+  bool added = _interfaceSet->insert(iface_addr, data);
+  if (_bulk) {
+    _bulk_changed |= added;
+    return added;
+  }
+  interfaces_changed();
+  if ( added ) {
+    _routingTable->interface_tuple_changed(main_addr);
+    return true;
+  }
+  return false;
+}
+
+
+/**
+ * the tuple of an alias already known for main_addr only has its time
+ * refreshed, which touches neither the expiry timer, unless the time moves
+ * closer, nor the routing table. Aliases new to main_addr are added
+ * together, and the routing table hears of main_addr, and of any node an
+ * alias moved from, once
+ */
+bool
+OLSRInterfaceInfoBase::upsert_interfaces(IPAddress main_addr, const Vector<IPAddress> &ifaces, olsr_time_t time)
+{
+  bool changed = false, pushed = false;
+
+  for (int i = 0; i < ifaces.size(); i++) {
+    interface_data *data = _interfaceSet->findp(ifaces[i]);
+    if (data && data->I_main_addr == main_addr) {
+      //a later time is found when the tuple's heap entry comes up
+      if (time < data->I_time) {
+	_expiry.push(time, ifaces[i]);
+	pushed = true;
+      }
+      data->I_time = time;
+      continue;
+    }
+
+    if (!data && _admission.active() && !admit(main_addr))
+      continue;
+    if (data && !_bulk)
+      _routingTable->interface_tuple_changed(data->I_main_addr);
+    interface_data tuple;
+    tuple.I_iface_addr = ifaces[i];
+    tuple.I_main_addr = main_addr;
+    tuple.I_time = time;
+    _interfaceSet->insert(ifaces[i], tuple);
+    _expiry.push(time, ifaces[i]);
+    pushed = true;
+    changed = true;
+  }
+
+  if (_bulk) {
+    _bulk_changed |= changed;
+    return changed;
+  }
+  if (pushed)
+    expire_at(time);
+  if (changed) {
+    interfaces_changed();
+    _routingTable->interface_tuple_changed(main_addr);
+  }
+  return changed;
+}
+
+
+/**
+ * a loaded tuple is only held to the capacity, one from a MID message also
+ * to the rate of main_addr
+ */
+bool
+OLSRInterfaceInfoBase::admit(const IPAddress &main_addr)
+{
+  olsr_time_t now = olsr_now();
+  if (!_bulk && !_admission.rate_ok(main_addr, now))
+    return false;
+  if (_admission.full(_interfaceSet->size())
+      && !make_room(OLSRAdmission::priority(_routingTable->route_distance(main_addr)))) {
+    _admission.refused();
+    return false;
+  }
+  return true;
+}
+
+
+/**
+ * evicts the tuple soonest to expire, among the first of the expiry heap,
+ * whose node is no closer than that of a new tuple of this priority
+ */
+bool
+OLSRInterfaceInfoBase::make_room(int priority)
+{
+  if (_bulk)
+    _expiry.rebuild();
+  Vector<IPAddress> kept;
+  bool room = false;
+  for (int i = 0; i < OLSRAdmission::SAMPLE && !_expiry.empty(); i++) {
+    IPAddress iface_addr = _expiry.pop();
+    interface_data *tuple = _interfaceSet->findp(iface_addr);
+    if (!tuple)
+      continue;			//stale entry, gone for good
+    if (OLSRAdmission::priority(_routingTable->route_distance(tuple->I_main_addr)) >= priority) {
+      remove_interface(iface_addr);
+      _admission.evicted();
+      room = true;
+      break;
+    }
+    kept.push_back(iface_addr);
+  }
+  for (int i = 0; i < kept.size(); i++)
+    _expiry.push(_interfaceSet->findp(kept[i])->I_time, kept[i]);
+  return room;
+}
+
+
+void
+OLSRInterfaceInfoBase::begin_bulk()
+{
+  _bulk = true;
+  _bulk_changed = false;
+}
+
+
+void
+OLSRInterfaceInfoBase::commit_bulk()
+{
+  if (!_bulk)
+    return;
+  _bulk = false;
+  _expiry.rebuild();
+  if (!_expiry.empty())
+    expire_at(_expiry.next());
+  if (_bulk_changed) {
+    interfaces_changed();
+    _routingTable->schedule_compute_routing_table();
+  }
 }
 
 
@@ -69,7 +251,7 @@ OLSRInterfaceInfoBase::find_interface(IPAddress iface_addr)
 {
   if (! _interfaceSet->empty() ) {
     interface_data *data;
-    data = (interface_data*) _interfaceSet->find(iface_addr);
+    data = _interfaceSet->findp(iface_addr);
 
     if (! data == 0 )
       return data;
@@ -81,9 +263,17 @@ OLSRInterfaceInfoBase::find_interface(IPAddress iface_addr)
 void
 OLSRInterfaceInfoBase::remove_interface(IPAddress iface_addr)
 {
-	interface_data *ptr=(interface_data *) _interfaceSet->find (iface_addr);
+	interface_data *ptr = _interfaceSet->findp(iface_addr);
+  if (!ptr)
+    return;
+  IPAddress main_addr = ptr->I_main_addr;
   _interfaceSet->remove(iface_addr);
- delete ptr;
+  if (_bulk) {
+    _bulk_changed = true;
+    return;
+  }
+  interfaces_changed();
+  _routingTable->interface_tuple_changed(main_addr);
 }
 
 void
@@ -95,17 +285,20 @@ OLSRInterfaceInfoBase::remove_interfaces_from(IPAddress neigh_addr)
 	if (!_interfaceSet->empty()) {
 		IPAddress main_addr = get_main_address(neigh_addr);
 		
+		//collect first, removing a tuple frees it under the iterator
+		Vector<IPAddress> ifaces;
 		for (InterfaceSet::iterator iter = _interfaceSet->begin(); iter != _interfaceSet->end(); iter++) {
-			interface_data *tuple = (interface_data *) iter.value();
-			if (tuple->I_main_addr == main_addr) {
-				remove_interface(tuple->I_iface_addr);
-				interface_removed = true;
-			}
+			if (iter.value().I_main_addr == main_addr)
+				ifaces.push_back(iter.key());
+		}
+		for (int i = 0; i < ifaces.size(); i++) {
+			remove_interface(ifaces[i]);
+			interface_removed = true;
 		}
 	}
 	
 	if (interface_removed) {
-		_routingTable->compute_routing_table();
+		_routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_MID);
 	}
 }
 
@@ -115,24 +308,33 @@ OLSRInterfaceInfoBase::get_main_address(IPAddress iface_addr)
 {
  //print_interfaces();
  
-  if (! _interfaceSet->empty() ){
-    interface_data *data;
-    data = find_interface(iface_addr);
-    if ( ! data == 0 ){
-      return data->I_main_addr;
-    }
-  }
-  if (_localIfInfoBase->get_index(iface_addr)>=0) return _localIfInfoBase->get_main_IPaddress();
-  //could be node with just 1 interface
-  return iface_addr;
+  if (IPAddress *alias = _aliases.findp(iface_addr))
+    return *alias;
+
+  IPAddress main_addr = iface_addr;	//could be node with just 1 interface
+  interface_data *data = find_interface(iface_addr);
+  if ( ! data == 0 )
+    main_addr = data->I_main_addr;
+  else if (_localIfInfoBase->get_index(iface_addr)>=0)
+    main_addr = _localIfInfoBase->get_main_IPaddress();
+
+  //addresses without tuple are remembered too, keep that bounded
+  if (_aliases.size() > 2 * _interfaceSet->size() + 256)
+    _aliases.clear();
+  _aliases.insert(iface_addr, main_addr);
+  return main_addr;
 }
 
 
 bool
-OLSRInterfaceInfoBase::update_interface(IPAddress iface_addr, struct timeval time){
+OLSRInterfaceInfoBase::update_interface(IPAddress iface_addr, olsr_time_t time){
   interface_data *data;
   data = find_interface(iface_addr);
   if ( ! data == 0 ) {
+    if (time < data->I_time) {
+      _expiry.push(time, iface_addr);
+      expire_at(time);
+    }
     data->I_time = time;
     return true;
   }
@@ -140,63 +342,138 @@ OLSRInterfaceInfoBase::update_interface(IPAddress iface_addr, struct timeval tim
 }
 
 
-HashMap<IPAddress, void*> *
+OLSRInterfaceInfoBase::InterfaceSet *
 OLSRInterfaceInfoBase::get_interface_set()
 {
   return _interfaceSet;
 }
 
 
+/**
+ * adds the tuples of a text of lines IFACE MAIN MSECS, valid for MSECS
+ * milliseconds from now; existing tuples are replaced
+ */
+int
+OLSRInterfaceInfoBase::load_handler(const String &text, Element *e, void *, ErrorHandler *errh)
+{
+  OLSRInterfaceInfoBase *iib = (OLSRInterfaceInfoBase *) e;
+  OLSRBulkLoader loader(text);
+  Vector<String> words;
+  Vector<interface_data> tuples;
+
+  //parse everything first, a bad line loads nothing
+  while (loader.next(words)) {
+    interface_data data;
+    if (words.size() != 3
+	|| !cp_ip_address(words[0], &data.I_iface_addr)
+	|| !cp_ip_address(words[1], &data.I_main_addr)
+	|| !loader.parse_validity(words[2], data.I_time))
+      return errh->error("line %d: expected IFACE MAIN MSECS", loader.line());
+    tuples.push_back(data);
+  }
+
+  iib->begin_bulk();
+  for (int i = 0; i < tuples.size(); i++) {
+    const interface_data &t = tuples[i];
+    iib->remove_interface(t.I_iface_addr);
+    iib->add_interface(t.I_iface_addr, t.I_main_addr, t.I_time);
+  }
+  iib->commit_bulk();
+  return 0;
+}
+
+
+void *
+OLSRInterfaceInfoBase::cast(const char *n)
+{
+  if (strcmp(n, "OLSRMemoryClient") == 0)
+    return (OLSRMemoryReport::Client *) this;
+  return Element::cast(n);
+}
+
+
+void
+OLSRInterfaceInfoBase::memory_usage(Vector<OLSRMemoryReport::Usage> &usage)
+{
+  usage.push_back(OLSRMemoryReport::Usage("interfaces", _interfaceSet->size(),
+					  OLSRMemoryReport::bytes(*_interfaceSet) + _expiry.bytes()));
+  usage.push_back(OLSRMemoryReport::Usage("alias_cache", _aliases.size(),
+					  OLSRMemoryReport::bytes(_aliases)));
+}
+
+
+void
+OLSRInterfaceInfoBase::add_handlers()
+{
+  add_write_handler("load", load_handler, 0);
+  add_read_handler("admission", admission_handler, 0);
+  add_memory_handlers(this);
+}
+
+
+String
+OLSRInterfaceInfoBase::admission_handler(Element *e, void *)
+{
+  OLSRInterfaceInfoBase *iib = (OLSRInterfaceInfoBase *) e;
+  StringAccum sa;
+  iib->_admission.unparse(sa, iib->_interfaceSet->size());
+  return sa.take_string();
+}
+
+
 void
 OLSRInterfaceInfoBase::run_timer(Timer *)
 {
-  struct timeval now, next_timeout;
+  run_expiry_timer();
+}
+
+
+olsr_time_t
+OLSRInterfaceInfoBase::run_expiry(olsr_time_t now)
+{
   bool interface_removed = false;
-  click_gettimeofday(&now);
-  next_timeout = make_timeval(0,0);
   
-  //find expired interface tuples
-  if (!_interfaceSet->empty()){
-    for (InterfaceSet::iterator iter = _interfaceSet->begin(); iter != _interfaceSet->end(); iter++){
-      interface_data *tuple = (interface_data *) iter.value();
-//       if (tuple->I_time <= now) {
-      if (tuple->I_time <= now) {
-	remove_interface(tuple->I_iface_addr);
-	interface_removed = true;
-      }
+  //expire the interface tuples at the top of the heap, put refreshed ones back
+  while (! _expiry.empty() && _expiry.next() <= now){
+    IPAddress iface_addr = _expiry.pop();
+    interface_data *tuple = _interfaceSet->findp(iface_addr);
+    if (! tuple)
+      continue;
+    if (tuple->I_time <= now) {
+      remove_interface(iface_addr);
+      interface_removed = true;
     }
+    else
+      _expiry.push(tuple->I_time, iface_addr);
   }
 
-  //find next interface to expire
-  if (! _interfaceSet->empty()){
-    for (InterfaceSet::iterator iter = _interfaceSet->begin(); iter != _interfaceSet->end(); iter++){
-      interface_data *tuple = (interface_data *) iter.value();
-      if (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0)
-	next_timeout = tuple->I_time;
-      if ( tuple->I_time < next_timeout )
-	next_timeout = tuple->I_time;
-    }
-  }
-  if (! (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0) )
-    _timer.schedule_at(next_timeout);    //set timer
+  _expiry.compact_if_stale(*_interfaceSet, &interface_data::I_time);
+
   if (interface_removed)
-    _routingTable->compute_routing_table();
+    _routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_MID);
+  if (_expiry.empty())
+    return 0;
+  return _expiry.next();
 }
 
 void OLSRInterfaceInfoBase::print_interfaces()
 {
  click_chatter ("Interface Infobase: #%d\n",_interfaceSet->size());
+ char iface[IPAddress::unparse_buflen], main[IPAddress::unparse_buflen];
  for (InterfaceSet::iterator iter = _interfaceSet->begin(); iter != _interfaceSet->end(); iter++){
-      interface_data *tuple = (interface_data *) iter.value();
-      click_chatter ("\tIface_addr=%s\tMain_addr=%s\t\n",tuple->I_iface_addr.unparse().c_str(),tuple->I_main_addr.unparse().c_str());
+      interface_data *tuple = &iter.value();
+      click_chatter ("\tIface_addr=%s\tMain_addr=%s\t\n",tuple->I_iface_addr.unparse(iface),tuple->I_main_addr.unparse(main));
       }
  }
  
 
 
 #include <click/bighashmap.cc>
+#include <click/vector.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
-template class HashMap<IPPair, void *>;
+template class HashMap<IPAddress, interface_data>;
+template class HashMap<IPAddress, IPAddress>;
+template class Vector<interface_data>;
 #endif
 
 CLICK_ENDDECLS
@@ -7,16 +7,20 @@
 #include <click/timer.hh>
 #include <click/ipaddress.hh>
 #include <click/bighashmap.hh>
+#include <click/flathashmap.hh>
 #include "olsr_rtable.hh"
 #include "olsr_local_if_infobase.hh"
 #include "click_olsr.hh"
+#include "olsr_expiry_queue.hh"
+#include "olsr_admission.hh"
+#include "olsr_memory_report.hh"
 
 CLICK_DECLS
 
 class OLSRRoutingTable;
 class OLSRLocalIfInfoBase;
 
-class OLSRInterfaceInfoBase: public Element{
+class OLSRInterfaceInfoBase: public Element, public OLSRExpiryQueue::Client, public OLSRMemoryReport::Client{
 public:
 
   OLSRInterfaceInfoBase();
@@ -29,25 +33,57 @@ public:
   int configure(Vector<String> &conf, ErrorHandler *errh);
   int initialize(ErrorHandler *);
   void uninitialize();
+  void take_state(Element *, ErrorHandler *);
+  void add_handlers();
+  void *cast(const char *);
+  void memory_usage(Vector<OLSRMemoryReport::Usage> &);
 
-  bool add_interface(IPAddress iface_addr, IPAddress main_addr, struct timeval time);
+  // add_interface()s and remove_interface()s in between neither arm the
+  // expiry timer nor notify the routing table; commit_bulk() does both
+  // once. Commit before returning to the driver
+  void begin_bulk();
+  void commit_bulk();
+
+  // returns false also if a new tuple is not admitted: main_addr created
+  // too many lately, or the set is full of tuples that matter more
+  bool add_interface(IPAddress iface_addr, IPAddress main_addr, olsr_time_t time);
+  // adds or refreshes the tuples of all aliases a MID message advertises,
+  // notifying once; returns whether any tuple was added or changed node.
+  // Aliases not admitted are left out
+  bool upsert_interfaces(IPAddress main_addr, const Vector<IPAddress> &ifaces, olsr_time_t time);
   struct interface_data *find_interface(IPAddress iface_addr);
   void remove_interface(IPAddress iface_addr);
   void remove_interfaces_from(IPAddress neigh_addr);
   IPAddress get_main_address(IPAddress iface_addr);
-  bool update_interface(IPAddress iface_addr, struct timeval time);
-  HashMap<IPAddress, void*> *get_interface_set();
+  // changes whenever an interface tuple is added or removed, i.e. whenever
+  // get_main_address() may answer differently
+  unsigned generation() const { return _generation; }
+  bool update_interface(IPAddress iface_addr, olsr_time_t time);
+  typedef HashMap <IPAddress, interface_data> InterfaceSet;
+  InterfaceSet *get_interface_set();
   void print_interfaces();
 
 private:
-  typedef HashMap <IPAddress, void *> InterfaceSet;
 
   InterfaceSet *_interfaceSet;
+  FlatHashMap<IPAddress, IPAddress> _aliases;	// get_main_address() results of this generation
+  unsigned _generation;
   OLSRLocalIfInfoBase *_localIfInfoBase;
   OLSRRoutingTable *_routingTable;
+  OLSRExpiryHeap<IPAddress> _expiry;
   Timer _timer;
+  OLSRExpiryQueue *_expiryQueue;
+  bool _bulk;
+  bool _bulk_changed;
+  OLSRAdmission _admission;
   
+  bool admit(const IPAddress &main_addr);
+  bool make_room(int priority);
+  static int load_handler(const String &, Element *, void *, ErrorHandler *);
+  static String admission_handler(Element *, void *);
+  olsr_time_t run_expiry(olsr_time_t now);
   void run_timer(Timer *);
+  void interfaces_changed();
 
 };
 
@@ -0,0 +1,401 @@
+/*
+ * olsr_kernelroutesync.{cc,hh} -- mirrors the OLSR routes into the Linux
+ * kernel's routing table over netlink
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "olsr_kernelroutesync.hh"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+CLICK_DECLS
+
+OLSRKernelRouteSync::OLSRKernelRouteSync()
+  : _fd(-1), _seq(0), _timer(this), _settle_timer(this)
+{
+}
+
+
+OLSRKernelRouteSync::~OLSRKernelRouteSync()
+{
+}
+
+
+int
+OLSRKernelRouteSync::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *routing_table;
+  String devnames;
+  _table = RT_TABLE_MAIN;
+  _protocol = 42;
+  _metric = 0;
+  _delay = 100;
+  _settle = 10000;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRRoutingTable element", &routing_table,
+		  cpArgument, "device names", &devnames,
+		  cpKeywords,
+		  "TABLE", cpInteger, "kernel routing table", &_table,
+		  "PROTOCOL", cpInteger, "routing protocol number", &_protocol,
+		  "METRIC", cpInteger, "route priority", &_metric,
+		  "DELAY", cpInteger, "batching delay (msecs)", &_delay,
+		  "SETTLE", cpInteger, "time before stale routes are removed (msecs)", &_settle,
+		  0) < 0)
+    return -1;
+
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("%s is not an OLSRRoutingTable", routing_table->name().c_str());
+  cp_spacevec(devnames, _devnames);
+  if (_devnames.empty())
+    return errh->error("no device names given");
+  if (_table <= 0)
+    return errh->error("bad TABLE");
+  if (_protocol <= RTPROT_STATIC || _protocol > 255)
+    return errh->error("PROTOCOL must be between %d and 255", RTPROT_STATIC + 1);
+  if (_delay < 0 || _settle < 0)
+    return errh->error("DELAY and SETTLE must not be negative");
+  return 0;
+}
+
+
+int
+OLSRKernelRouteSync::initialize(ErrorHandler *errh)
+{
+  if (_routingTable->lazy())
+    return errh->error("%s has LAZY routes the kernel cannot ask for", _routingTable->name().c_str());
+  for (int i = 0; i < _devnames.size(); i++) {
+    int index = if_nametoindex(_devnames[i].c_str());
+    if (index == 0)
+      return errh->error("%s: no such device", _devnames[i].c_str());
+    _ifindex.push_back(index);
+  }
+
+  _fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+  if (_fd < 0)
+    return errh->error("netlink socket: %s", strerror(errno));
+  struct sockaddr_nl local;
+  memset(&local, 0, sizeof(local));
+  local.nl_family = AF_NETLINK;
+  if (bind(_fd, (struct sockaddr *) &local, sizeof(local)) < 0)
+    return errh->error("netlink bind: %s", strerror(errno));
+
+  if (read_kernel_routes(errh) < 0)
+    return -1;
+
+  //from now on the kernel only reports errors, read whenever they come
+  fcntl(_fd, F_SETFL, O_NONBLOCK);
+  add_select(_fd, SELECT_READ);
+
+  _messages = _batches = _errors = _stale_removed = 0;
+  _timer.initialize(this);
+  _settle_timer.initialize(this);
+  _settle_timer.schedule_after_msec(_settle);
+  _routingTable->add_listener(this);
+  return 0;
+}
+
+
+void
+OLSRKernelRouteSync::cleanup(CleanupStage)
+{
+  if (_fd >= 0) {
+    remove_select(_fd, SELECT_READ);
+    close(_fd);
+  }
+  _fd = -1;
+}
+
+
+/**
+ * fills the shadow copy with the routes of _protocol in _table, which a
+ * previous run left in the kernel
+ */
+int
+OLSRKernelRouteSync::read_kernel_routes(ErrorHandler *errh)
+{
+  struct {
+    struct nlmsghdr n;
+    struct rtmsg r;
+  } req;
+  memset(&req, 0, sizeof(req));
+  req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+  req.n.nlmsg_type = RTM_GETROUTE;
+  req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  req.n.nlmsg_seq = ++_seq;
+  req.r.rtm_family = AF_INET;
+  if (send(_fd, &req, req.n.nlmsg_len, 0) < 0)
+    return errh->error("netlink route dump: %s", strerror(errno));
+
+  char buf[16384];
+  while (1) {
+    int len = recv(_fd, buf, sizeof(buf), 0);
+    if (len < 0) {
+      if (errno == EINTR)
+	continue;
+      return errh->error("netlink route dump: %s", strerror(errno));
+    }
+    for (struct nlmsghdr *n = (struct nlmsghdr *) buf; NLMSG_OK(n, (unsigned) len); n = NLMSG_NEXT(n, len)) {
+      if (n->nlmsg_type == NLMSG_DONE)
+	return 0;
+      if (n->nlmsg_type == NLMSG_ERROR)
+	return errh->error("netlink route dump failed");
+      if (n->nlmsg_type != RTM_NEWROUTE)
+	continue;
+
+      struct rtmsg *r = (struct rtmsg *) NLMSG_DATA(n);
+      if (r->rtm_family != AF_INET || r->rtm_protocol != _protocol)
+	continue;
+      int table = r->rtm_table;
+      IPRoute route;
+      route.addr = IPAddress();
+      route.mask = IPAddress::make_prefix(r->rtm_dst_len);
+      route.gw = IPAddress();
+      route.port = -1;
+      route.extra = 0;
+      int attr_len = RTM_PAYLOAD(n);
+      for (struct rtattr *a = RTM_RTA(r); RTA_OK(a, attr_len); a = RTA_NEXT(a, attr_len))
+	if (a->rta_type == RTA_DST)
+	  route.addr = IPAddress(*(uint32_t *) RTA_DATA(a));
+	else if (a->rta_type == RTA_GATEWAY)
+	  route.gw = IPAddress(*(uint32_t *) RTA_DATA(a));
+	else if (a->rta_type == RTA_TABLE)
+	  table = *(uint32_t *) RTA_DATA(a);
+	else if (a->rta_type == RTA_OIF) {
+	  int index = *(int *) RTA_DATA(a);
+	  for (int i = 0; i < _ifindex.size(); i++)
+	    if (_ifindex[i] == index)
+	      route.port = i;
+	}
+      if (table != _table)
+	continue;
+      if (!route.gw)
+	route.gw = route.addr;	//direct route
+      _kernel.insert(IPPair(route.addr, route.mask), route);
+    }
+  }
+}
+
+
+void
+OLSRKernelRouteSync::routes_changed(const Vector<OLSRRoutingTable::RouteChange> &)
+{
+  //the prefixes that changed in the lookup element, compressed with AGGREGATE
+  const Vector<OLSRRoutingTable::RouteChange> &delta = _routingTable->lookup_delta();
+  for (int i = 0; i < delta.size(); i++) {
+    const IPRoute &route = delta[i].route;
+    _pending.insert(IPPair(route.addr, route.mask), 1);
+  }
+  if (!_timer.scheduled())
+    _timer.schedule_after_msec(_delay);
+}
+
+
+void
+OLSRKernelRouteSync::run_timer(Timer *t)
+{
+  if (t == &_settle_timer)
+    reconcile();
+  else
+    flush();
+}
+
+
+/**
+ * sends what is needed to bring the kernel's routes for the pending
+ * prefixes in line with the OLSR routes
+ */
+void
+OLSRKernelRouteSync::flush()
+{
+  OLSRRoutingTable::SnapshotRef desired = _routingTable->snapshot();
+  if (!desired)
+    return;
+  StringAccum sa;
+  for (HashMap<IPPair, int>::iterator iter = _pending.begin(); iter != _pending.end(); iter++) {
+    const IPRoute *want = desired->lookup_routes().findp(iter.key());
+    IPRoute *have = _kernel.findp(iter.key());
+    if (want) {
+      if (have && have->gw == want->gw && have->port == want->port)
+	continue;
+      add_message(sa, RTM_NEWROUTE, *want);
+      _kernel.insert(iter.key(), *want);
+    } else if (have) {
+      add_message(sa, RTM_DELROUTE, *have);
+      _kernel.remove(iter.key());
+    }
+  }
+  _pending.clear();
+  send_batch(sa);
+}
+
+
+/**
+ * compares the whole shadow copy with the OLSR routes; the only operation
+ * of this element that costs O(table) rather than O(changes)
+ */
+void
+OLSRKernelRouteSync::reconcile()
+{
+  OLSRRoutingTable::SnapshotRef desired = _routingTable->snapshot();
+  if (!desired)
+    return;
+  for (RouteSet::iterator iter = _kernel.begin(); iter != _kernel.end(); iter++)
+    if (!desired->lookup_routes().findp(iter.key())) {
+      _pending.insert(iter.key(), 1);
+      _stale_removed++;
+    }
+  for (RouteSet::const_iterator iter = desired->lookup_routes().begin(); iter != desired->lookup_routes().end(); iter++)
+    _pending.insert(iter.key(), 1);
+  _timer.unschedule();
+  flush();
+}
+
+
+static void
+add_attribute(struct nlmsghdr *n, int type, uint32_t value)
+{
+  struct rtattr *a = (struct rtattr *) ((char *) n + NLMSG_ALIGN(n->nlmsg_len));
+  a->rta_type = type;
+  a->rta_len = RTA_LENGTH(sizeof(uint32_t));
+  memcpy(RTA_DATA(a), &value, sizeof(uint32_t));
+  n->nlmsg_len = NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(a->rta_len);
+}
+
+
+void
+OLSRKernelRouteSync::add_message(StringAccum &sa, int type, const IPRoute &route)
+{
+  int port = route.port;
+  bool direct = (route.gw == route.addr || !route.gw);
+  if (type == RTM_NEWROUTE && (port < 0 || port >= _ifindex.size())) {
+    click_chatter("%s: route %s has no device for port %d", name().c_str(), route.unparse_addr().c_str(), port);
+    _errors++;
+    return;
+  }
+
+  int size = NLMSG_SPACE(sizeof(struct rtmsg) + 5 * RTA_SPACE(sizeof(uint32_t)));
+  char *data = sa.extend(size);
+  if (!data)
+    return;
+  memset(data, 0, size);
+  struct nlmsghdr *n = (struct nlmsghdr *) data;
+  n->nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+  n->nlmsg_type = type;
+  n->nlmsg_flags = NLM_F_REQUEST;
+  if (type == RTM_NEWROUTE)
+    n->nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+  n->nlmsg_seq = ++_seq;
+
+  struct rtmsg *r = (struct rtmsg *) NLMSG_DATA(n);
+  r->rtm_family = AF_INET;
+  r->rtm_dst_len = route.prefix_len();
+  //tables from 256 on only fit in the RTA_TABLE attribute
+  if (_table < 256)
+    r->rtm_table = _table;
+  else
+    r->rtm_table = RT_TABLE_UNSPEC;
+  r->rtm_protocol = _protocol;
+  r->rtm_type = RTN_UNICAST;
+  if (type == RTM_DELROUTE)
+    r->rtm_scope = RT_SCOPE_NOWHERE;
+  else
+    r->rtm_scope = (direct ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE);
+
+  add_attribute(n, RTA_DST, route.addr.addr());
+  if (_table >= 256)
+    add_attribute(n, RTA_TABLE, _table);
+  if (type == RTM_NEWROUTE) {
+    add_attribute(n, RTA_OIF, _ifindex[port]);
+    if (!direct)
+      add_attribute(n, RTA_GATEWAY, route.gw.addr());
+    if (_metric)
+      add_attribute(n, RTA_PRIORITY, _metric);
+  }
+  //give back what the attributes left over
+  sa.adjust_length(NLMSG_ALIGN(n->nlmsg_len) - size);
+  _messages++;
+}
+
+
+void
+OLSRKernelRouteSync::send_batch(StringAccum &sa)
+{
+  if (sa.length() == 0 || _fd < 0)
+    return;
+  struct sockaddr_nl kernel;
+  memset(&kernel, 0, sizeof(kernel));
+  kernel.nl_family = AF_NETLINK;
+  if (sendto(_fd, sa.data(), sa.length(), 0, (struct sockaddr *) &kernel, sizeof(kernel)) < 0) {
+    click_chatter("%s: netlink: %s", name().c_str(), strerror(errno));
+    _errors++;
+  }
+  _batches++;
+}
+
+
+void
+OLSRKernelRouteSync::selected(int fd)
+{
+  char buf[4096];
+  int len;
+  while ((len = recv(fd, buf, sizeof(buf), 0)) > 0)
+    for (struct nlmsghdr *n = (struct nlmsghdr *) buf; NLMSG_OK(n, (unsigned) len); n = NLMSG_NEXT(n, len))
+      if (n->nlmsg_type == NLMSG_ERROR) {
+	struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA(n);
+	if (err->error) {
+	  click_chatter("%s: netlink: %s", name().c_str(), strerror(-err->error));
+	  _errors++;
+	}
+      }
+}
+
+
+String
+OLSRKernelRouteSync::read_handler(Element *e, void *)
+{
+  OLSRKernelRouteSync *ks = (OLSRKernelRouteSync *) e;
+  StringAccum sa;
+  sa << "routes " << ks->_kernel.size() << "\n"
+     << "messages " << ks->_messages << "\n"
+     << "batches " << ks->_batches << "\n"
+     << "errors " << ks->_errors << "\n"
+     << "stale_removed " << ks->_stale_removed << "\n";
+  return sa.take_string();
+}
+
+
+int
+OLSRKernelRouteSync::reconcile_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRKernelRouteSync *ks = (OLSRKernelRouteSync *) e;
+  ks->reconcile();
+  return 0;
+}
+
+
+void
+OLSRKernelRouteSync::add_handlers()
+{
+  add_read_handler("stats", read_handler, (void *) 0);
+  add_write_handler("reconcile", reconcile_handler, (void *) 0);
+}
+
+#include <click/bighashmap.cc>
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class HashMap<IPPair, IPRoute>;
+template class HashMap<IPPair, int>;
+#endif
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel linux)
+EXPORT_ELEMENT(OLSRKernelRouteSync);
@@ -0,0 +1,146 @@
+/*
+  =c
+  OLSRKernelRouteSync(OLSRRoutingTable element, DEVNAMES [, KEYWORDS])
+
+  =s
+  OLSR specific element, keeps the routes of OLSRRoutingTable in the host's routing table
+
+  =io
+  None
+
+  =d
+  Follows the route deltas of the OLSRRoutingTable element given as argument
+  (see OLSRRoutingTable::Listener) and programs them into the Linux kernel's
+  forwarding table over a netlink socket, so that the host stack routes
+  along the OLSR routes without scripts polling the lookup element. The
+  changes that arrive within DELAY are merged and sent as one batch of
+  netlink messages; a route that changes back within that time causes no
+  message at all.
+
+  DEVNAMES is a space-separated list of network device names, one for each
+  output port of the lookup element: a route with output port i is installed
+  on the i-th device. A route whose gateway is its own destination is
+  installed as a direct route on the link.
+
+  The deltas only mark prefixes to look at; the routes wanted for them are
+  read from the routing table's published snapshot (see
+  OLSRRoutingTable::snapshot()), the compressed ones if the routing table
+  has AGGREGATE (it cannot have LAZY), so the element keeps no copy of the OLSR
+  routes of its own. It keeps a shadow copy of the routes it has installed, which it
+  marks with the routing protocol number PROTOCOL. When it starts, it reads
+  back the routes with that number from the kernel table, left behind by a
+  previous run. These stay in place while the routing table converges, and
+  SETTLE after the start a single reconciliation removes those that OLSR
+  no longer has, instead of a flush and reinstallation of all routes.
+
+  The routes stay in the kernel when the router is stopped, for the next run
+  to reconcile.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item TABLE
+
+  Integer. Kernel routing table to use. Default is 254, the main table.
+
+  =item PROTOCOL
+
+  Integer. Routing protocol number marking the routes of this element.
+  Default is 42.
+
+  =item METRIC
+
+  Integer. Priority of the installed routes. Default is 0.
+
+  =item DELAY
+
+  Integer. Time changes are collected into one batch, in msecs. Default is
+  100.
+
+  =item SETTLE
+
+  Integer. Time after the start until routes left over from a previous run
+  are removed, in msecs. Default is 10000.
+
+  =back
+
+  =h stats read-only
+  Routes installed, netlink messages and batches sent, errors reported by
+  the kernel, and stale routes removed at reconciliation.
+
+  =h reconcile write-only
+  Compares the whole shadow copy with the OLSR routes right away and sends
+  the differences.
+
+  =a
+  OLSRRoutingTable, KernelTun */
+
+#ifndef OLSR_KERNELROUTESYNC_HH
+#define OLSR_KERNELROUTESYNC_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/bighashmap.hh>
+#include <click/straccum.hh>
+#include "olsr_rtable.hh"
+#include "ippair.hh"
+
+CLICK_DECLS
+
+class OLSRKernelRouteSync : public Element, public OLSRRoutingTable::Listener { public:
+
+  OLSRKernelRouteSync();
+  ~OLSRKernelRouteSync();
+
+  const char *class_name() const	{ return "OLSRKernelRouteSync"; }
+  const char *port_count() const	{ return "0/0"; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void run_timer(Timer *);
+  void selected(int fd);
+
+  void routes_changed(const Vector<OLSRRoutingTable::RouteChange> &delta);
+
+private:
+
+  typedef HashMap<IPPair, IPRoute> RouteSet;
+
+  OLSRRoutingTable *_routingTable;
+  Vector<String> _devnames;
+  Vector<int> _ifindex;		// per output port
+  int _table;
+  int _protocol;
+  int _metric;
+  int _delay;
+  int _settle;
+
+  int _fd;
+  uint32_t _seq;
+  RouteSet _kernel;		// shadow copy of the routes in the kernel
+  HashMap<IPPair, int> _pending;	// prefixes whose two routes may differ
+  Timer _timer;
+  Timer _settle_timer;
+
+  uint32_t _messages;
+  uint32_t _batches;
+  uint32_t _errors;
+  uint32_t _stale_removed;
+
+  int read_kernel_routes(ErrorHandler *errh);
+  void flush();
+  void reconcile();
+  void add_message(StringAccum &sa, int type, const IPRoute &route);
+  void send_batch(StringAccum &sa);
+
+  static String read_handler(Element *, void *);
+  static int reconcile_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
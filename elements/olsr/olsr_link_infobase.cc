@@ -9,11 +9,14 @@
 #include <click/bighashmap.hh>
 #include "ippair.hh"
 #include "click_olsr.hh"
+#include "olsr_bulk_load.hh"
+#include <click/error.hh>
 
 CLICK_DECLS
 
 OLSRLinkInfoBase::OLSRLinkInfoBase()
-		: _timer(this)
+		: _neighborLinksGeneration(0), _expiryQueue(0), _bulk(false), _bulk_changed(false),
+		  _timer(this)
 {
 }
 
@@ -26,13 +29,36 @@ OLSRLinkInfoBase::~OLSRLinkInfoBase()
 int
 OLSRLinkInfoBase::configure (Vector<String> &conf, ErrorHandler *errh)
 {
+	Element *expiry_queue = 0;
+	String link_rates;
 	if (cp_va_parse(conf, this, errh,
 	                cpElement, "NeighborInfoBase element", &_neighborInfo,
 	                cpElement, "InterfaceInfoBase element", &_interfaceInfo,
 	                cpElement, "Duplicate Set element", &_duplicateSet,
 	                cpElement, "Routing Table Element", &_routingTable,
-	                cpElement, "TC generator element", &_tcGenerator, 0) < 0)
+	                cpElement, "TC generator element", &_tcGenerator,
+	                cpKeywords,
+	                "EXPIRY_QUEUE", cpElement, "shared expiry timer", &expiry_queue,
+	                "LINK_RATES", cpArgument, "OLSRLinkRate elements", &link_rates,
+	                0) < 0)
 		return -1;
+	if (expiry_queue && !(_expiryQueue = (OLSRExpiryQueue *) expiry_queue->cast("OLSRExpiryQueue")))
+		return errh->error("EXPIRY_QUEUE element is not an OLSRExpiryQueue");
+
+	// one OLSRLinkRate per wireless interface turns ETX into ETT
+	Vector<String> names;
+	cp_spacevec(link_rates, names);
+	_linkRates.clear();
+	for (int i = 0; i < names.size(); i++)
+	{
+		Element *e = cp_element(names[i], this, errh);
+		if (!e)
+			return -1;
+		OLSRLinkRate *rate = (OLSRLinkRate *) e->cast("OLSRLinkRate");
+		if (!rate)
+			return errh->error("%s is not an OLSRLinkRate", e->name().c_str());
+		_linkRates.push_back(rate);
+	}
 	return 0;
 }
 
@@ -41,24 +67,60 @@ int
 OLSRLinkInfoBase::initialize(ErrorHandler *)
 {
 	_timer.initialize(this);
+	set_expiry(_expiryQueue, &_timer);
 	_linkSet = new LinkSet();		//ok new
+	_neighborLinksGeneration = _interfaceInfo->generation();
+	_changes = 0;
 	return 0;
 }
 
 void OLSRLinkInfoBase::uninitialize()
 {
 	delete _linkSet;
+	_neighborLinks.clear();
+}
+
+void
+OLSRLinkInfoBase::take_state(Element *e, ErrorHandler *)
+{
+	OLSRLinkInfoBase *old = (OLSRLinkInfoBase *) e->cast("OLSRLinkInfoBase");
+	if (!old)
+		return;
+
+	// the tuples stay where they are, so the LinkLists' pointers stay valid
+	LinkSet *linkSet = _linkSet;
+	_linkSet = old->_linkSet;
+	old->_linkSet = linkSet;
+	_neighborLinks.swap(old->_neighborLinks);
+	_localIfaces.swap(old->_localIfaces);
+	_expiry.swap(old->_expiry);
+
+	// main addresses were resolved against the old interface infobase:
+	// have the next lookup resolve them again
+	unsigned stale = _interfaceInfo->generation() - 1;
+	for (LinkSet::iterator iter = _linkSet->begin(); iter != _linkSet->end(); iter++) {
+		iter.value()._main_addr_generation = stale;
+		iter.value()._neighbor = 0;
+	}
+	_neighborLinksGeneration = stale;
+
+	if (!_expiry.empty())
+		expire_at(_expiry.next());
 }
 
 void
 OLSRLinkInfoBase::run_timer(Timer *)
 {
-	struct timeval now, next_timeout, time;
+	run_expiry_timer();
+}
+
+
+olsr_time_t
+OLSRLinkInfoBase::run_expiry(olsr_time_t now)
+{
 	bool neighbor_removed = false;
 	bool mpr_selector_removed=false;
 	bool neighbor_downgraded = false;
-	click_gettimeofday(&now);
-	next_timeout = make_timeval(0,0);
 	IPAddress neighbor;
 //	neighbor_data *neighbor_entry;
 	HashMap<IPAddress, IPAddress> links_removed_obj;
@@ -66,35 +128,39 @@ OLSRLinkInfoBase::run_timer(Timer *)
 	HashMap<IPAddress, IPAddress> links_downgraded_obj;
 	HashMap<IPAddress, IPAddress> *links_downgraded = &links_downgraded_obj;
 
-	//find expired links and remove them
-	if (! _linkSet->empty() )
+	//links at the top of the heap are either expired, no longer symmetric,
+	//or were refreshed and go back into the heap for their next event
+	while (! _expiry.empty() && _expiry.next() <= now)
 	{
-		for (LinkSet::iterator iter = _linkSet->begin(); iter != _linkSet->end(); iter++)
+		IPPair ippair = _expiry.pop();
+		link_data *data = _linkSet->findp(ippair);
+		if (! data)
+			continue;
+		//store the main address of the node to which this was a link
+		neighbor = neighbor_main_address(data);
+		if (data->L_time <= now)
 		{
-			link_data *data = (link_data *)iter.value();
-			//store the main address of the node to which this was a link
-			neighbor = data->_main_addr; //_interfaceInfo->get_main_address(data->L_neigh_iface_addr);	
-			if (data->L_time <= now)
-			{
-				links_removed->insert(data->L_neigh_iface_addr, neighbor);
-				click_chatter("link %s <--> %s expired | %d %d\n", data->L_local_iface_addr.unparse().c_str(), data->L_neigh_iface_addr.unparse().c_str(), data->L_time.tv_sec, data->L_time.tv_usec);
-				remove_link(data->L_local_iface_addr, data->L_neigh_iface_addr);
-			}
-			else if (data->L_SYM_time <= now)
+			links_removed->insert(data->L_neigh_iface_addr, neighbor);
+			click_chatter("link %s <--> %s expired | %s\n", data->L_local_iface_addr.unparse().c_str(), data->L_neigh_iface_addr.unparse().c_str(), olsr_timestamp(data->L_time).unparse().c_str());
+			remove_link(data->L_local_iface_addr, data->L_neigh_iface_addr);
+		}
+		else if (data->L_SYM_time <= now)
+		{
+			//only a neighbor that is still symmetric needs downgrading
+			neighbor_data *nbr_entry = neighbor_tuple(data);
+			if (nbr_entry && nbr_entry->N_status == OLSR_SYM_NEIGH)
 			{
 				links_downgraded->insert(data->L_neigh_iface_addr, neighbor);
-// 				neighbor_data* nbr_entry = _neighborInfo->find_neighbor(neighbor);
-// 				if (nbr_entry->N_status == OLSR_SYM_NEIGH || nbr_entry->N_status == OLSR_MPR_NEIGH)
-// 				{
-				click_chatter("link %s <--> %s no longer symmetric | %d %d\n", data->L_local_iface_addr.unparse().c_str(), data->L_neigh_iface_addr.unparse().c_str(), data->L_SYM_time.tv_sec, data->L_SYM_time.tv_usec);
-//					neighbor = _interfaceInfo->get_main_address(data->L_neigh_iface_addr);
-// 					nbr_entry->N_status=OLSR_NOT_NEIGH;
-// 					neighbor_downgraded = true;
-// 				}
+				click_chatter("link %s <--> %s no longer symmetric | %s\n", data->L_local_iface_addr.unparse().c_str(), data->L_neigh_iface_addr.unparse().c_str(), olsr_timestamp(data->L_SYM_time).unparse().c_str());
 			}
+			_expiry.push(data->L_time, ippair);
 		}
+		else
+			_expiry.push(data->L_SYM_time < data->L_time ? data->L_SYM_time : data->L_time, ippair);
 	}
 
+	_expiry.compact_if_stale(*_linkSet, LinkExpiry(now));
+
 	//remove neighbors that have no more links
 	if (! links_removed->empty())
 	{
@@ -102,14 +168,10 @@ OLSRLinkInfoBase::run_timer(Timer *)
 		for( HashMap<IPAddress, IPAddress>::iterator iter = links_removed->begin(); iter != links_removed->end(); iter++)
 		{
 			bool other_links_left = false;
-			for (LinkSet::iterator link = _linkSet->begin(); link != _linkSet->end(); link++)
-			{
-				link_data *data = (link_data *)link.value();
-				if (_interfaceInfo->get_main_address(data->L_neigh_iface_addr) == iter.value() && data->L_SYM_time > now)
-				{
-					other_links_left = true;
-				}
-			}
+			if (const LinkList *links = links_to(iter.value()))
+				for (int i = 0; i < links->size(); i++)
+					if ((*links)[i]->L_SYM_time > now)
+						other_links_left = true;
 			if (!other_links_left) {
 				_neighborInfo->remove_neighbor(iter.value());
 				neighbor_removed = true;
@@ -128,17 +190,16 @@ OLSRLinkInfoBase::run_timer(Timer *)
 		for( HashMap<IPAddress, IPAddress>::iterator iter = links_downgraded->begin(); iter != links_downgraded->end(); iter++)
 		{
 			bool sym_link_left = false;
-			for (LinkSet::iterator link = _linkSet->begin(); link != _linkSet->end(); link++)
-			{
-				link_data *data = (link_data *)link.value();
-				if (_interfaceInfo->get_main_address(data->L_neigh_iface_addr) == iter.value() && data->L_SYM_time > now)
-				{
-					sym_link_left = true;
-				}
-			}
+			if (const LinkList *links = links_to(iter.value()))
+				for (int i = 0; i < links->size(); i++)
+					if ((*links)[i]->L_SYM_time > now)
+						sym_link_left = true;
 			if (!sym_link_left) {
 				neighbor_data* nbr_entry = _neighborInfo->find_neighbor(iter.value());
 				nbr_entry->N_status=OLSR_NOT_NEIGH;
+				_neighborInfo->neighbor_tuple_changed();
+				_changes++;
+				_tcGenerator->notify_advertised_set_changed();
 				neighbor_downgraded = true;
 				if (_neighborInfo->find_mpr_selector (iter.value()))
 				{
@@ -149,63 +210,98 @@ OLSRLinkInfoBase::run_timer(Timer *)
 		}
 	}
 
-	//find next link to expire
-	if (! _linkSet->empty() )
-	{
-		for (LinkSet::iterator iter = _linkSet->begin(); iter != _linkSet->end(); iter++)
-		{
-			link_data *data = (link_data *)iter.value();
-
-			neighbor = data->_main_addr;
-
-			if (_neighborInfo->find_neighbor(neighbor)->N_status == OLSR_SYM_NEIGH)
-			{
-				time = data->L_SYM_time;
-			}
-			else
-			{
-				time = data->L_time;
-			}
-			if (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0)
-			{
-				next_timeout = time;
-			}
-			if ( time < next_timeout )
-			{
-				next_timeout = time;
-			}
-		}
-	}
-
 	if (mpr_selector_removed) _tcGenerator->notify_mpr_selector_changed();
-	if (! (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0) )
-		_timer.schedule_at(next_timeout);    //set timer
 	if (neighbor_removed || neighbor_downgraded)
 	{
-		_neighborInfo->compute_mprset();
-		_routingTable->compute_routing_table();
+		_neighborInfo->schedule_compute_mprset();
+		_routingTable->schedule_compute_routing_table(OLSRRoutingTable::EVENT_LINK_EXPIRED);
 	}
+	if (_expiry.empty())
+		return 0;
+	return _expiry.next();
 }
 
 
 link_data *
-OLSRLinkInfoBase::add_link(IPAddress local_addr, IPAddress neigh_addr, timeval time)
+OLSRLinkInfoBase::add_link(IPAddress local_addr, IPAddress neigh_addr, olsr_time_t time)
 {
 	IPPair ippair=IPPair(local_addr, neigh_addr);;
-	struct link_data *data;
-	data = new struct link_data;		//memory freed in remove
+	struct link_data data;		//stored inline in the link set
+
+	data.L_local_iface_addr = local_addr;
+	data.L_local_iface_index = local_iface_index(local_addr);
+	data.L_neigh_iface_addr = neigh_addr;
+	data.L_time = time;
+	data.L_lq = 0;
+	data.L_nlq = 0;
+	data.L_last_hello = 0;
+	data.L_link_quality = 0;
+	data.L_link_pending = false;
+	data.L_LOST_LINK_time = 0;
+	data.L_degraded = false;
+	check_neighbor_links();
+	data._main_addr = _interfaceInfo->get_main_address(neigh_addr);
+	data._main_addr_generation = _interfaceInfo->generation();
+	data._neighbor = 0;
+	data._neighbor_generation = 0;
+	if (_bulk)
+		_expiry.append(time, ippair);
+	else {
+		click_chatter("link %s <--> %s insert | %s\n", data.L_local_iface_addr.unparse().c_str(), data.L_neigh_iface_addr.unparse().c_str(), olsr_timestamp(data.L_time).unparse().c_str());
+		_expiry.push(time, ippair);
+		expire_at(time);
+	}
+	if (_linkSet->insert(ippair, data) ) {
+		link_data *ptr = _linkSet->findp(ippair);
+		_neighborLinks.find_force(ptr->_main_addr).push_back(ptr);
+		_changes++;
+		_bulk_changed = true;
+		return ptr;
+	}
+	return 0;
+}
 
-	data->L_local_iface_addr = local_addr;
-	data->L_neigh_iface_addr = neigh_addr;
-	data->L_time = time;
-	click_chatter("link %s <--> %s insert | %d %d\n", data->L_local_iface_addr.unparse().c_str(), data->L_neigh_iface_addr.unparse().c_str(), data->L_time.tv_sec, data->L_time.tv_usec);
 
-	if (_linkSet->empty())
-		_timer.schedule_at(time);
-	if (_linkSet->insert(ippair, data) ) {
-		return data;
+void
+OLSRLinkInfoBase::begin_bulk()
+{
+	_bulk = true;
+	_bulk_changed = false;
+}
+
+
+void
+OLSRLinkInfoBase::commit_bulk()
+{
+	if (!_bulk)
+		return;
+	_bulk = false;
+	_expiry.rebuild();
+	if (!_expiry.empty())
+		expire_at(_expiry.next());
+	if (_bulk_changed)
+	{
+		_neighborInfo->schedule_compute_mprset();
+		_routingTable->schedule_compute_routing_table();
 	}
+}
+
+
+int
+OLSRLinkInfoBase::local_iface_index(IPAddress local_addr)
+{
+#if OLSR_SINGLE_INTERFACE
+	if (_localIfaces.empty())
+		_localIfaces.push_back(local_addr);
 	return 0;
+#else
+	//a node has a handful of interfaces at most
+	for (int i = 0; i < _localIfaces.size(); i++)
+		if (_localIfaces[i] == local_addr)
+			return i;
+	_localIfaces.push_back(local_addr);
+	return _localIfaces.size() - 1;
+#endif
 }
 
 
@@ -215,7 +311,7 @@ OLSRLinkInfoBase::find_link(IPAddress local_addr, IPAddress neigh_addr)
 	if (! _linkSet->empty() )
 	{
 		IPPair ippair = IPPair(local_addr, neigh_addr);
-		link_data *data = (link_data *) _linkSet->find(ippair);
+		link_data *data = _linkSet->findp(ippair);
 
 		if (! data == 0 )
 			return data;
@@ -225,7 +321,7 @@ OLSRLinkInfoBase::find_link(IPAddress local_addr, IPAddress neigh_addr)
 
 
 bool
-OLSRLinkInfoBase::update_link(IPAddress local_addr, IPAddress neigh_addr, struct timeval sym_time, struct timeval asym_time, struct timeval time)
+OLSRLinkInfoBase::update_link(IPAddress local_addr, IPAddress neigh_addr, olsr_time_t sym_time, olsr_time_t asym_time, olsr_time_t time)
 {
 	link_data *data;
 	data = find_link(local_addr, neigh_addr);
@@ -235,9 +331,11 @@ OLSRLinkInfoBase::update_link(IPAddress local_addr, IPAddress neigh_addr, struct
 		data->L_ASYM_time = asym_time;
 		data->L_time = time;
 
-		click_chatter("link %s <--> %s updating| %d %d\n", data->L_local_iface_addr.unparse().c_str(), data->L_neigh_iface_addr.unparse().c_str(), data->L_time.tv_sec, data->L_time.tv_usec);
+		click_chatter("link %s <--> %s updating| %s\n", data->L_local_iface_addr.unparse().c_str(), data->L_neigh_iface_addr.unparse().c_str(), olsr_timestamp(data->L_time).unparse().c_str());
 
-		_timer.schedule_now();
+		olsr_time_t now = olsr_now();
+		_expiry.push(now, IPPair(local_addr, neigh_addr));
+		expire_at(now);
 		return true;
 	}
 	return false;
@@ -248,21 +346,198 @@ void
 OLSRLinkInfoBase::remove_link(IPAddress local_addr, IPAddress neigh_addr)
 {
 	IPPair ippair = IPPair(local_addr, neigh_addr);
-	link_data *ptr=(link_data*) _linkSet->find(ippair);
+	link_data *ptr = _linkSet->findp(ippair);
+	if (!ptr)
+		return;
+	check_neighbor_links();
 	
-	click_chatter("link %s <--> %s removing| %d %d\n", ptr->L_local_iface_addr.unparse().c_str(), ptr->L_neigh_iface_addr.unparse().c_str(), ptr->L_time.tv_sec, ptr->L_time.tv_usec);
+	if (!_bulk)
+		click_chatter("link %s <--> %s removing| %s\n", ptr->L_local_iface_addr.unparse().c_str(), ptr->L_neigh_iface_addr.unparse().c_str(), olsr_timestamp(ptr->L_time).unparse().c_str());
 	
 // 	_interfaceInfo->remove_interfaces_from(neigh_addr);
 
+	if (LinkList *links = _neighborLinks.findp(ptr->_main_addr))
+	{
+		for (int i = 0; i < links->size(); i++)
+			if ((*links)[i] == ptr)
+			{
+				(*links)[i] = links->back();
+				links->pop_back();
+				break;
+			}
+		if (links->empty())
+			_neighborLinks.remove(ptr->_main_addr);
+	}
 	_linkSet->remove(ippair);
-	delete ptr;
+	_changes++;
+	_bulk_changed = true;
 
 	//reset the packet seq num from this interface, node might be down
 	_duplicateSet->remove_packet_seq(neigh_addr);
 
 }
 
-HashMap<IPPair, void*> *
+/**
+ * main address of the node at the other end of the link, resolved again
+ * only after the interface association set has changed
+ */
+IPAddress
+OLSRLinkInfoBase::neighbor_main_address(link_data *data)
+{
+	if (data->_main_addr_generation != _interfaceInfo->generation())
+		check_neighbor_links();
+	return data->_main_addr;
+}
+
+
+/**
+ * the remembered tuple is good while the neighbor set has removed no tuple
+ * since, and while it is still the one of the link's neighbor main address;
+ * a missing neighbor is looked up again each time
+ */
+neighbor_data *
+OLSRLinkInfoBase::neighbor_tuple(link_data *data)
+{
+	IPAddress main_addr = neighbor_main_address(data);
+	unsigned generation = _neighborInfo->neighbor_generation();
+	if (!data->_neighbor || data->_neighbor_generation != generation
+	    || data->_neighbor->N_neigh_main_addr != main_addr)
+	{
+		data->_neighbor = _neighborInfo->find_neighbor(main_addr);
+		data->_neighbor_generation = generation;
+	}
+	return data->_neighbor;
+}
+
+
+const OLSRLinkInfoBase::LinkList *
+OLSRLinkInfoBase::links_to(IPAddress neigh_main_addr)
+{
+	check_neighbor_links();
+	return _neighborLinks.findp(neigh_main_addr);
+}
+
+
+/**
+ * the link to the neighbor with the lowest ETX, or null if there is none
+ */
+link_data *
+OLSRLinkInfoBase::best_link_to(IPAddress neigh_main_addr)
+{
+	const LinkList *links = links_to(neigh_main_addr);
+	link_data *best = 0;
+	int best_cost = 0;
+	for (int i = 0; links && i < links->size(); i++)
+	{
+		int c = cost((*links)[i]);
+		if (!best || c < best_cost)
+		{
+			best = (*links)[i];
+			best_cost = c;
+		}
+	}
+	return best;
+}
+
+
+int
+OLSRLinkInfoBase::link_cost(IPAddress neigh_main_addr)
+{
+	link_data *link = best_link_to(neigh_main_addr);
+	return link ? cost(link) : OLSR_ETX_INFINITE;
+}
+
+
+int
+OLSRLinkInfoBase::link_rate(link_data *link)
+{
+	for (int i = 0; i < _linkRates.size(); i++)
+		if (_linkRates[i]->ip_address() == link->L_local_iface_addr)
+			return _linkRates[i]->rate(link->L_neigh_iface_addr);
+	return 0;
+}
+
+
+int
+OLSRLinkInfoBase::cost(link_data *link)
+{
+	int etx = olsr_etx(link->L_lq >> 8, link->L_nlq);
+	if (!_linkRates.empty())
+		etx = olsr_ett(etx, link_rate(link));
+	if (link->L_degraded && etx < OLSR_ETX_INFINITE)
+		etx = (etx < OLSR_ETX_INFINITE / OLSR_DEGRADED_PENALTY ? etx * OLSR_DEGRADED_PENALTY : OLSR_ETX_INFINITE - 1);
+	return etx;
+}
+
+
+/**
+ * olsr_etx(advertised_lq(link), L_nlq) is olsr_ett of the link as long as
+ * its rate is below OLSR_ETT_RATE; the quality only has 8 bits, so slow
+ * links are rounded, and never reach 0
+ */
+int
+OLSRLinkInfoBase::advertised_lq(link_data *link)
+{
+	int lq = link->L_lq >> 8;
+	int rate = _linkRates.empty() ? 0 : link_rate(link);
+	if (rate > 0 && rate < OLSR_ETT_RATE && lq > 0)
+	{
+		lq = lq * rate / OLSR_ETT_RATE;
+		if (lq < 1)
+			lq = 1;
+	}
+	if (link->L_degraded && lq > 0)
+	{
+		lq /= OLSR_DEGRADED_PENALTY;
+		if (lq < 1)
+			lq = 1;
+	}
+	return lq;
+}
+
+
+bool
+OLSRLinkInfoBase::set_link_degraded(IPAddress local_addr, IPAddress neigh_addr, bool degraded)
+{
+	link_data *link = find_link(local_addr, neigh_addr);
+	if (!link)
+		return false;
+	if (link->L_degraded == degraded)
+		return true;
+	link->L_degraded = degraded;
+	click_chatter("link %s <--> %s %s\n", local_addr.unparse().c_str(), neigh_addr.unparse().c_str(), degraded ? "degraded" : "recovered");
+	//the costs change, not the links: the MPRs, the TC messages and the
+	//routes weigh them anew
+	_tcGenerator->notify_advertised_set_changed();
+	_neighborInfo->schedule_compute_mprset();
+	_routingTable->schedule_compute_routing_table(OLSRRoutingTable::EVENT_LINK_DEGRADED);
+	return true;
+}
+
+
+/**
+ * a changed interface association set can move links to another neighbor;
+ * resolve all main addresses again and rebuild the per-neighbor lists
+ */
+void
+OLSRLinkInfoBase::check_neighbor_links()
+{
+	unsigned generation = _interfaceInfo->generation();
+	if (_neighborLinksGeneration == generation)
+		return;
+	_neighborLinks.clear();
+	for (LinkSet::iterator iter = _linkSet->begin(); iter != _linkSet->end(); iter++)
+	{
+		link_data *data = &iter.value();
+		data->_main_addr = _interfaceInfo->get_main_address(data->L_neigh_iface_addr);
+		data->_main_addr_generation = generation;
+		_neighborLinks.find_force(data->_main_addr).push_back(data);
+	}
+	_neighborLinksGeneration = generation;
+}
+
+
+OLSRLinkInfoBase::LinkSet *
 OLSRLinkInfoBase::get_link_set()
 {
 	return _linkSet;
@@ -274,15 +549,16 @@ OLSRLinkInfoBase::print_link_set()
 {
 	if (! _linkSet->empty() )
 	{
+		char buf[Timestamp::unparse_buflen];
 		for (LinkSet::iterator iter = _linkSet->begin(); iter != _linkSet->end(); iter++)
 		{
-			link_data *data = (link_data *) iter.value();
+			link_data *data = &iter.value();
 			click_chatter("link:\n");
-			click_chatter("\tlocal_iface: %s\n", data->L_local_iface_addr.unparse().c_str());
-			click_chatter("\tneigh_iface: %s\n", data->L_neigh_iface_addr.unparse().c_str());
-			click_chatter("\tL_SYM_time: %d\n", data->L_SYM_time.tv_sec);
-			click_chatter("\tL_ASYM_time: %d\n", data->L_ASYM_time.tv_sec);
-			click_chatter("\tL_time: %d\n", data->L_time.tv_sec);
+			click_chatter("\tlocal_iface: %s\n", data->L_local_iface_addr.unparse(buf));
+			click_chatter("\tneigh_iface: %s\n", data->L_neigh_iface_addr.unparse(buf));
+			click_chatter("\tL_SYM_time: %s\n", olsr_timestamp(data->L_SYM_time).unparse(buf));
+			click_chatter("\tL_ASYM_time: %s\n", olsr_timestamp(data->L_ASYM_time).unparse(buf));
+			click_chatter("\tL_time: %s\n", olsr_timestamp(data->L_time).unparse(buf));
 		}
 	}
 	else
@@ -292,11 +568,102 @@ OLSRLinkInfoBase::print_link_set()
 }
 
 
+/**
+ * adds the links of a text of lines LOCAL NEIGH MSECS [SYM|ASYM], valid
+ * for MSECS milliseconds from now and, with SYM, symmetric for as long;
+ * existing links get the new times. The neighbor set is loaded separately
+ */
+int
+OLSRLinkInfoBase::load_handler(const String &text, Element *e, void *, ErrorHandler *errh)
+{
+	OLSRLinkInfoBase *lib = (OLSRLinkInfoBase *) e;
+	OLSRBulkLoader loader(text);
+	Vector<String> words;
+	Vector<link_data> tuples;
+
+	//parse everything first, a bad line loads nothing
+	while (loader.next(words))
+	{
+		link_data data;
+		if (words.size() < 3 || words.size() > 4
+		    || !cp_ip_address(words[0], &data.L_local_iface_addr)
+		    || !cp_ip_address(words[1], &data.L_neigh_iface_addr)
+		    || !loader.parse_validity(words[2], data.L_time)
+		    || (words.size() > 3 && words[3] != "SYM" && words[3] != "ASYM"))
+			return errh->error("line %d: expected LOCAL NEIGH MSECS [SYM|ASYM]", loader.line());
+		data.L_ASYM_time = data.L_time;
+		data.L_SYM_time = (words.size() > 3 && words[3] == "SYM" ? data.L_time : 0);
+		tuples.push_back(data);
+	}
+
+	lib->begin_bulk();
+	for (int i = 0; i < tuples.size(); i++)
+	{
+		const link_data &t = tuples[i];
+		link_data *data = lib->find_link(t.L_local_iface_addr, t.L_neigh_iface_addr);
+		if (data)
+		{//keeps its link quality and the duplicate set its sequence number
+			data->L_time = t.L_time;
+			lib->_expiry.append(t.L_time, IPPair(t.L_local_iface_addr, t.L_neigh_iface_addr));
+			lib->_bulk_changed = true;
+		}
+		else
+			data = lib->add_link(t.L_local_iface_addr, t.L_neigh_iface_addr, t.L_time);
+		if (data)
+		{
+			data->L_SYM_time = t.L_SYM_time;
+			data->L_ASYM_time = t.L_ASYM_time;
+		}
+	}
+	lib->commit_bulk();
+	return 0;
+}
+
+
+void *
+OLSRLinkInfoBase::cast(const char *n)
+{
+	if (strcmp(n, "OLSRMemoryClient") == 0)
+	  return (OLSRMemoryReport::Client *) this;
+	return Element::cast(n);
+}
+
+
+void
+OLSRLinkInfoBase::memory_usage(Vector<OLSRMemoryReport::Usage> &usage)
+{
+	size_t bytes = OLSRMemoryReport::bytes(*_linkSet) + _expiry.bytes()
+		+ OLSRMemoryReport::deep_bytes(_neighborLinks) + OLSRMemoryReport::bytes(_localIfaces);
+	usage.push_back(OLSRMemoryReport::Usage("links", _linkSet->size(), bytes));
+}
+
+
+void
+OLSRLinkInfoBase::hash_stats(StringAccum &sa)
+{
+	OLSRMemoryReport::unparse_chains(sa, "links", *_linkSet);
+	OLSRMemoryReport::unparse_chains(sa, "neighbor_links", _neighborLinks);
+}
+
+
+void
+OLSRLinkInfoBase::add_handlers()
+{
+	add_write_handler("load", load_handler, 0);
+	add_memory_handlers(this);
+	add_hash_stats_handler(this);
+}
+
+
 
 #include <click/bighashmap.cc>
+#include <click/vector.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
-template class HashMap<IPPair, void *>;
-template class HashMap<IPPair, void *>::iterator;
+template class HashMap<IPPair, link_data>;
+template class HashMap<IPPair, link_data>::iterator;
+template class HashMap<IPAddress, Vector<link_data *> >;
+template class Vector<link_data *>;
+template class Vector<link_data>;
 #endif
 
 CLICK_ENDDECLS
@@ -15,6 +15,9 @@
 #include "olsr_rtable.hh"
 #include "ippair.hh"
 #include "click_olsr.hh"
+#include "olsr_expiry_queue.hh"
+#include "olsr_memory_report.hh"
+#include "olsr_linkrate.hh"
 
 CLICK_DECLS
 
@@ -24,7 +27,7 @@ class OLSRInterfaceInfoBase;
 class OLSRDuplicateSet;
 class OLSRTCGenerator;
 
-class OLSRLinkInfoBase: public Element{
+class OLSRLinkInfoBase: public Element, public OLSRExpiryQueue::Client, public OLSRMemoryReport::Client{
 public:
 
   OLSRLinkInfoBase();
@@ -38,30 +41,94 @@ public:
   int configure(Vector<String> &conf, ErrorHandler *errh);
   int initialize(ErrorHandler *);
   void uninitialize();
+  void take_state(Element *, ErrorHandler *);
+  void add_handlers();
+  void *cast(const char *);
+  void memory_usage(Vector<OLSRMemoryReport::Usage> &);
+  void hash_stats(StringAccum &);
 
-  struct link_data *add_link(IPAddress local_addr, IPAddress neigh_addr, struct timeval time);
+  // add_link()s and remove_link()s in between neither arm the expiry timer
+  // nor log each link; commit_bulk() arms it once and has the MPR set and
+  // the routes computed. Commit before returning to the driver
+  void begin_bulk();
+  void commit_bulk();
+
+  struct link_data *add_link(IPAddress local_addr, IPAddress neigh_addr, olsr_time_t time);
   struct link_data *find_link(IPAddress local_addr, IPAddress neigh_addr);
-  bool update_link(IPAddress local_addr, IPAddress neigh_addr, struct timeval sym_time, struct timeval asym_time, struct timeval time);
+  bool update_link(IPAddress local_addr, IPAddress neigh_addr, olsr_time_t sym_time, olsr_time_t asym_time, olsr_time_t time);
   void remove_link(IPAddress local_addr, IPAddress neigh_addr);
-  HashMap<IPPair, void *> *get_link_set();
+  IPAddress neighbor_main_address(link_data *data);
+  // the neighbor tuple of neighbor_main_address(data), or null; remembered
+  // in the link tuple, so that a message arriving on a link finds its
+  // neighbor without hashing
+  neighbor_data *neighbor_tuple(link_data *data);
+  typedef HashMap<IPPair, link_data> LinkSet;
+  typedef Vector<link_data *> LinkList;
+  LinkSet *get_link_set();
+  // links to the neighbor with main address neigh_main_addr, or null
+  const LinkList *links_to(IPAddress neigh_main_addr);
+  // link quality of the best of these links, and its ETX (see olsr_etx),
+  // or its expected transmission time with LINK_RATES (see olsr_ett)
+  link_data *best_link_to(IPAddress neigh_main_addr);
+  int link_cost(IPAddress neigh_main_addr);
+  int cost(link_data *link);
+  // bit-rate of the link as an OLSRLinkRate of LINK_RATES saw it, or 0
+  int link_rate(link_data *link);
+  // L_lq, lowered with LINK_RATES so that the ETX others compute from it
+  // in LQ_TC messages is the link's expected transmission time
+  int advertised_lq(link_data *link);
+  // marks the link as one the MAC reports failing, or no longer: it then
+  // costs and advertises OLSR_DEGRADED_PENALTY times its ETX, and the MPRs,
+  // TC messages and routes follow. Returns false if there is no such link
+  bool set_link_degraded(IPAddress local_addr, IPAddress neigh_addr, bool degraded);
+  // number of links added, removed or no longer symmetric so far, a
+  // measure of neighborhood churn
+  uint32_t changes() const { return _changes; }
+
+  // local interfaces are numbered 0, 1, ... in the order links on them
+  // first appear; numbers are never reused, so per-interface state can live
+  // in a Vector of local_iface_count() entries
+  int local_iface_index(IPAddress local_addr);
+  int local_iface_count() const { return OLSR_SINGLE_INTERFACE ? 1 : _localIfaces.size(); }
+  IPAddress local_iface(int index) const { return _localIfaces[index]; }
   void print_link_set();
-  typedef HashMap<IPPair, void *> LinkSet;
   
 private:
   
   LinkSet *_linkSet;
+  HashMap<IPAddress, LinkList> _neighborLinks;	// neighbor main address -> its links
+  unsigned _neighborLinksGeneration;
+  Vector<IPAddress> _localIfaces;		// by local_iface_index
+  uint32_t _changes;
+  OLSRExpiryHeap<IPPair> _expiry;
 
   OLSRNeighborInfoBase *_neighborInfo;
   OLSRInterfaceInfoBase *_interfaceInfo;
   OLSRRoutingTable *_routingTable;
   OLSRDuplicateSet *_duplicateSet;
   OLSRTCGenerator *_tcGenerator;
+  OLSRExpiryQueue *_expiryQueue;
+  Vector<OLSRLinkRate *> _linkRates;
+  bool _bulk;
+  bool _bulk_changed;
  
 
   Timer _timer;
   
 
+  olsr_time_t run_expiry(olsr_time_t now);
+  // the next time a link changes: its symmetric time if that is still
+  // ahead and comes first, else its expiry
+  struct LinkExpiry {
+    olsr_time_t now;
+    LinkExpiry(olsr_time_t n) : now(n) { }
+    olsr_time_t operator()(const link_data &data) const {
+      return data.L_SYM_time > now && data.L_SYM_time < data.L_time ? data.L_SYM_time : data.L_time;
+    }
+  };
   void run_timer(Timer *);
+  void check_neighbor_links();
+  static int load_handler(const String &, Element *, void *, ErrorHandler *);
 
 };
 
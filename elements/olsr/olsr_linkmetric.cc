@@ -0,0 +1,137 @@
+/*
+ * olsr_linkmetric.{cc,hh} -- ETX link metric from the OLSR link tuples
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include "olsr_linkmetric.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+OLSRLinkMetric::OLSRLinkMetric()
+  : _linkInfo(0)
+{
+}
+
+
+OLSRLinkMetric::~OLSRLinkMetric()
+{
+}
+
+
+void *
+OLSRLinkMetric::cast(const char *n)
+{
+  if (strcmp(n, "OLSRLinkMetric") == 0)
+    return (OLSRLinkMetric *) this;
+  else if (strcmp(n, "GridGenericMetric") == 0)
+    return (GridGenericMetric *) this;
+  else
+    return 0;
+}
+
+
+int
+OLSRLinkMetric::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *link_info;
+  String arp_queriers;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRLinkInfoBase element", &link_info,
+		  cpArgument, "OLSRARPQuerier elements", &arp_queriers,
+		  0) < 0)
+    return -1;
+
+  if (!(_linkInfo = (OLSRLinkInfoBase *) link_info->cast("OLSRLinkInfoBase")))
+    return errh->error("%s is not an OLSRLinkInfoBase", link_info->name().c_str());
+
+  Vector<String> names;
+  cp_spacevec(arp_queriers, names);
+  _arpQueriers.clear();
+  for (int i = 0; i < names.size(); i++) {
+    Element *e = cp_element(names[i], this, errh);
+    if (!e)
+      return -1;
+    OLSRARPQuerier *arpq = (OLSRARPQuerier *) e->cast("OLSRARPQuerier");
+    if (!arpq)
+      return errh->error("%s is not an OLSRARPQuerier", e->name().c_str());
+    _arpQueriers.push_back(arpq);
+  }
+  if (_arpQueriers.empty())
+    return errh->error("no OLSRARPQuerier elements given");
+  return 0;
+}
+
+
+bool
+OLSRLinkMetric::metric_val_lt(const metric_t &m1, const metric_t &m2) const
+{
+  return m1.val() < m2.val();
+}
+
+
+/**
+ * ETX in hundredths, as ETXMetric gives it, of the best symmetric link to
+ * the neighbor with Ethernet address e. The link qualities are shares
+ * scaled to 255, so 100 * 255 * 255 / (lq * nlq) is 100 / (d_f * d_r).
+ * Symmetric, like ETXMetric, so the direction is ignored.
+ */
+GridGenericMetric::metric_t
+OLSRLinkMetric::get_link_metric(const EtherAddress &e, bool) const
+{
+  olsr_time_t now = olsr_now();
+
+  unsigned best = 0;
+  for (int i = 0; i < _arpQueriers.size(); i++) {
+    IPAddress neighbor = _arpQueriers[i]->lookup_mac(e);
+    if (!neighbor)
+      continue;
+    link_data *link = _linkInfo->find_link(_arpQueriers[i]->ip_address(), neighbor);
+    if (!link || link->L_SYM_time < now)
+      continue;
+    unsigned lq = link->L_lq >> 8;
+    unsigned nlq = link->L_nlq ? link->L_nlq : lq;
+    if (lq == 0 || nlq == 0)
+      continue;
+    unsigned val = (100 * 255 * 255) / (lq * nlq);
+    if (best == 0 || val < best)
+      best = val;
+  }
+
+  if (best == 0)
+    return _bad_metric;
+  return metric_t(best);
+}
+
+
+GridGenericMetric::metric_t
+OLSRLinkMetric::append_metric(const metric_t &r, const metric_t &l) const
+{
+  if (!r.good() || !l.good())
+    return _bad_metric;
+  return metric_t(r.val() + l.val());
+}
+
+
+unsigned char
+OLSRLinkMetric::scale_to_char(const metric_t &m) const
+{
+  if (!m.good() || m.val() > (0xff * 10))
+    return 0xff;
+  else
+    return m.val() / 10;
+}
+
+
+GridGenericMetric::metric_t
+OLSRLinkMetric::unscale_from_char(unsigned char c) const
+{
+  return metric_t(c * 10);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(HopcountMetric)
+ELEMENT_PROVIDES(GridGenericMetric)
+EXPORT_ELEMENT(OLSRLinkMetric)
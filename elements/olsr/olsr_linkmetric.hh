@@ -0,0 +1,73 @@
+/*
+  =c
+  OLSRLinkMetric(OLSRLinkInfoBase element, ARP queriers)
+
+  =s
+  OLSR specific element, Grid link metric measured by the OLSR HELLOs
+
+  =io
+  None
+
+  =d
+  A GridGenericMetric computing the estimated transmission count (ETX)
+  exactly as ETXMetric does, from the link qualities OLSR measures anyway:
+  the share of a neighbor's HELLOs received (the reverse delivery ratio)
+  and the share of ours the neighbor reports in its LQ_HELLOs (the forward
+  delivery ratio), as kept in the link tuples of the OLSRLinkInfoBase. Grid
+  elements that take a metric can use it in place of ETXMetric, and the
+  node can do without LinkStat and its broadcast probes; the HELLOs are
+  sent in any case.
+
+  The second argument is a space-separated list of OLSRARPQuerier elements,
+  one per interface, which map the neighbor's Ethernet address to its
+  interface address, and give the local address of the link. A neighbor
+  without a symmetric link on any of these interfaces has no metric.
+
+  The forward ratio needs LQ_HELLOs, so run OLSR with LINK_QUALITY; until a
+  neighbor has reported it, the link is taken as symmetric and the reverse
+  ratio used both ways.
+
+  =a ETXMetric, LinkStat, OLSRLinkInfoBase, OLSRProcessHello */
+
+#ifndef OLSR_LINKMETRIC_HH
+#define OLSR_LINKMETRIC_HH
+
+#include <click/element.hh>
+#include <click/vector.hh>
+#include "../grid/gridgenericmetric.hh"
+#include "olsr_link_infobase.hh"
+#include "olsr_arpquerier.hh"
+
+CLICK_DECLS
+
+class OLSRLinkMetric : public GridGenericMetric { public:
+
+  OLSRLinkMetric();
+  ~OLSRLinkMetric();
+
+  const char *class_name() const	{ return "OLSRLinkMetric"; }
+  const char *port_count() const	{ return PORTS_0_0; }
+  const char *processing() const	{ return AGNOSTIC; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  void *cast(const char *);
+
+  // generic metric methods
+  bool metric_val_lt(const metric_t &, const metric_t &) const;
+  metric_t get_link_metric(const EtherAddress &n, bool) const;
+  metric_t append_metric(const metric_t &, const metric_t &) const;
+  metric_t prepend_metric(const metric_t &r, const metric_t &l) const
+  { return append_metric(r, l); }
+
+  unsigned char scale_to_char(const metric_t &) const;
+  metric_t unscale_from_char(unsigned char) const;
+
+private:
+
+  OLSRLinkInfoBase *_linkInfo;
+  Vector<OLSRARPQuerier *> _arpQueriers;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,118 @@
+/*
+ * olsr_linkrate.{cc,hh} -- transmit rate per neighbor, for the ETT metric
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/packet_anno.hh>
+#include <clicknet/wifi.h>
+#include "olsr_linkrate.hh"
+
+CLICK_DECLS
+
+OLSRLinkRate::OLSRLinkRate()
+  : _arpQuerier(0), _offset(0)
+{
+}
+
+
+OLSRLinkRate::~OLSRLinkRate()
+{
+}
+
+
+void *
+OLSRLinkRate::cast(const char *n)
+{
+  if (strcmp(n, "OLSRLinkRate") == 0)
+    return (OLSRLinkRate *) this;
+  else
+    return Element::cast(n);
+}
+
+
+int
+OLSRLinkRate::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *arpq;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRARPQuerier element", &arpq,
+		  cpKeywords,
+		  "OFFSET", cpUnsigned, "destination address offset", &_offset,
+		  0) < 0)
+    return -1;
+  if (!(_arpQuerier = (OLSRARPQuerier *) arpq->cast("OLSRARPQuerier")))
+    return errh->error("%s is not an OLSRARPQuerier", arpq->name().c_str());
+  return 0;
+}
+
+
+Packet *
+OLSRLinkRate::simple_action(Packet *p)
+{
+  if (p->length() < _offset + 6)
+    return p;
+  EtherAddress dst(p->data() + _offset);
+  int rate = WIFI_EXTRA_ANNO(p)->rate;
+  if (dst.is_group() || !rate)
+    return p;
+
+  _lock.acquire();
+  int *r = _rates.findp(dst);
+  if (!r)
+    _rates.insert(dst, rate);
+  else if (*r != rate)
+    *r = rate;
+  _lock.release();
+  return p;
+}
+
+
+int
+OLSRLinkRate::rate(IPAddress neighbor)
+{
+  EtherAddress ether;
+  if (!_arpQuerier->lookup_ip(neighbor, ether))
+    return 0;
+  _lock.acquire();
+  int *r = _rates.findp(ether);
+  int rate = r ? *r : 0;
+  _lock.release();
+  return rate;
+}
+
+
+String
+OLSRLinkRate::read_rates(Element *e, void *)
+{
+  OLSRLinkRate *lr = (OLSRLinkRate *) e;
+  Vector<EtherAddress> ethers;
+  Vector<int> rates;
+  lr->_lock.acquire();
+  for (HashMap<EtherAddress, int>::const_iterator it = lr->_rates.begin(); it.live(); it++) {
+    ethers.push_back(it.key());
+    rates.push_back(it.value());
+  }
+  lr->_lock.release();
+
+  StringAccum sa;
+  for (int i = 0; i < ethers.size(); i++) {
+    sa << ethers[i] << ' ' << lr->_arpQuerier->lookup_mac(ethers[i]) << ' ' << (rates[i] / 2);
+    if (rates[i] % 2)
+      sa << ".5";
+    sa << '\n';
+  }
+  return sa.take_string();
+}
+
+
+void
+OLSRLinkRate::add_handlers()
+{
+  add_read_handler("rates", read_rates, 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRLinkRate)
@@ -0,0 +1,93 @@
+/*
+  =c
+  OLSRLinkRate(OLSRARPQuerier element [, I<keywords> OFFSET])
+
+  =s
+  OLSR specific element, records the transmit rate used towards each neighbor
+
+  =io
+  One input, one output
+
+  =d
+  Sits in an interface's transmit path behind the rate control of the wifi
+  elements (SetTXRate, AutoRateFallback, MadwifiRate, ProbeTXRate) and
+  remembers, for each unicast destination, the bit-rate the last packet to
+  it was given in its wifi extra header. Packets pass unchanged.
+
+  An OLSRLinkInfoBase given these elements as LINK_RATES turns the ETX of
+  its links into an expected transmission time (see olsr_ett), so that
+  routes computed with LINK_QUALITY prefer fast links to slow ones with the
+  same delivery ratios. The OLSRARPQuerier of the interface maps the
+  destination Ethernet addresses to the neighbor interface addresses of the
+  link tuples, and gives the local address of the interface.
+
+  The table is locked, so the element can run on an interface thread while
+  the control thread reads it.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item OFFSET
+
+  Unsigned. Offset of the destination Ethernet address in the packet data:
+  0 for an Ethernet header, as the rate control elements take by default,
+  or 4 for an 802.11 header. Default is 0.
+
+  =back
+
+  =h rates read-only
+  The destinations known, one per line with their Ethernet address, the
+  neighbor address the OLSRARPQuerier gives for it, and the rate in Mbps.
+
+  =e
+  ... -> AutoRateFallback(RT rates) -> rate :: OLSRLinkRate(arpq)
+      -> WifiEncap(0x00, 00:00:00:00:00:00) -> ...
+  links :: OLSRLinkInfoBase(..., LINK_RATES rate);
+
+  =a OLSRLinkInfoBase, OLSRLinkMetric, AutoRateFallback, SetTXRate */
+
+#ifndef OLSR_LINKRATE_HH
+#define OLSR_LINKRATE_HH
+
+#include <click/element.hh>
+#include <click/etheraddress.hh>
+#include <click/bighashmap.hh>
+#include <click/sync.hh>
+#include "olsr_arpquerier.hh"
+
+CLICK_DECLS
+
+class OLSRLinkRate : public Element { public:
+
+  OLSRLinkRate();
+  ~OLSRLinkRate();
+
+  const char *class_name() const	{ return "OLSRLinkRate"; }
+  const char *port_count() const	{ return "1/1"; }
+  const char *processing() const	{ return AGNOSTIC; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  void *cast(const char *);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+
+  // the rate of the last packet sent to the neighbor interface address
+  // neighbor, in units of 500 kbit/s, or 0 if none was seen
+  int rate(IPAddress neighbor);
+  const IPAddress &ip_address() const	{ return _arpQuerier->ip_address(); }
+
+private:
+
+  OLSRARPQuerier *_arpQuerier;
+  unsigned _offset;
+  HashMap<EtherAddress, int> _rates;
+  Spinlock _lock;
+
+  static String read_rates(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -3,12 +3,14 @@
 #include <click/config.h>
 #include <click/confparse.hh>
 #include <click/error.hh>
+#include <click/straccum.hh>
 #include "olsr_local_if_infobase.hh"
 #include <click/vector.hh>
 
 CLICK_DECLS
 
 OLSRLocalIfInfoBase::OLSRLocalIfInfoBase()
+        : _index(1, 0), _index_mask(0)
 {
 }
 
@@ -35,16 +37,33 @@ OLSRLocalIfInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
         // for (int i=0; i<_localinterfaceEtherSet.size();i++) click_chatter ("eth%d: %s",i,_localinterfaceEtherSet[i].unparse().c_str());
         // for (int i=0; i<_localinterfaceIPSet.size();i++) click_chatter ("IP%d: %s",i,_localinterfaceIPSet[i].unparse().c_str());
 
-        return (errh->nerrors() != before ? -1 : 0);
-}
+#if OLSR_SINGLE_INTERFACE
+        if (_localinterfaceIPSet.size() != 1)
+                return errh->error("this build takes exactly one interface address");
+#endif
+        int size = 4;
+        while (size < 4 * _localinterfaceIPSet.size())
+                size <<= 1;
+        _index.assign(size, 0);
+        _index_mask = size - 1;
+        _ifaces.clear();
+        for (int i=0; i<_localinterfaceIPSet.size(); i++) {
+                if (!OLSR_SINGLE_INTERFACE && get_index(_localinterfaceIPSet[i]) >= 0) {
+                        errh->error("interface address %s given twice", _localinterfaceIPSet[i].unparse().c_str());
+                        continue;
+                }
+                Interface iface;
+                iface.addr = _localinterfaceIPSet[i];
+                iface.port = i;
+                iface.received = 0;
+                _ifaces.push_back(iface);
+                uint32_t h = index_hash(iface.addr);
+                while (_index[h & _index_mask])
+                        h++;
+                _index[h & _index_mask] = _ifaces.size();
+        }
 
-IPAddress
-OLSRLocalIfInfoBase::get_iface_addr(int i)
-{
-        if (i>_localinterfaceIPSet.size())
-                return IPAddress();
-        else
-                return (_localinterfaceIPSet[i]);
+        return (errh->nerrors() != before ? -1 : 0);
 }
 
 
@@ -65,24 +84,29 @@ OLSRLocalIfInfoBase::get_number_ifaces()
         return 0;
 }
 
-int
-OLSRLocalIfInfoBase::get_index(IPAddress local_iface_addr)
-{
-        int index=-1;
-        for (int i=0; i<_localinterfaceIPSet.size(); i++)
-                if (_localinterfaceIPSet[i]==local_iface_addr) {
-                        index=i;
-                        break;
-                }
-        return index;
-}
-
 Vector<IPAddress> *
 OLSRLocalIfInfoBase::get_local_ifaces_addr()
 {
         return (&_localinterfaceIPSet);
 }
 
+String
+OLSRLocalIfInfoBase::read_interfaces(Element *e, void *)
+{
+        OLSRLocalIfInfoBase *lif = (OLSRLocalIfInfoBase *) e;
+        StringAccum sa;
+        for (int i=0; i<lif->_ifaces.size(); i++)
+                sa << i << ' ' << lif->_ifaces[i].addr << ' ' << lif->_ifaces[i].port
+                   << ' ' << lif->_ifaces[i].received << '\n';
+        return sa.take_string();
+}
+
+void
+OLSRLocalIfInfoBase::add_handlers()
+{
+        add_read_handler("interfaces", read_interfaces, 0);
+}
+
 /*EtherAddress
 OLSRLocalIfInfoBase::get_interfaceEther(int i)
 {
@@ -117,6 +141,7 @@ OLSRLocalIfInfoBase::get_all_local_interfacesEther()
 #if EXPLICIT_TEMPLATE_INSTANCES
 template class Vector<IPAddress::push_back>
 ;
+template class Vector<OLSRLocalIfInfoBase::Interface>;
 #endif
 
 
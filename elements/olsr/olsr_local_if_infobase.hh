@@ -6,6 +6,8 @@
 #include <click/element.hh>
 #include <click/etheraddress.hh>
 #include <click/vector.hh>
+#include <click/ipaddress.hh>
+#include "click_olsr.hh"
 
 CLICK_DECLS
 
@@ -21,6 +23,15 @@ public:
   	const char *port_count() const  	{ return "0/0"; }
 
         int configure(Vector<String> &conf, ErrorHandler *errh);
+        void add_handlers();
+
+        // one per local interface, by dense id: the order of the arguments,
+        // which is also the paint of the packets received on it
+        struct Interface {
+                IPAddress addr;
+                int port;
+                uint32_t received;	// OLSR messages received on it
+        };
 
         //  EtherAddress get_main_addressEther();
         //  int get_sizeEther();
@@ -29,8 +40,9 @@ public:
 
         IPAddress get_main_IPaddress();
         int get_number_ifaces();
-        IPAddress get_iface_addr(int i);
-        int get_index (IPAddress local_iface_addr);
+        inline IPAddress get_iface_addr(int i) const;
+        inline int get_index (IPAddress local_iface_addr) const;
+        inline Interface *get_iface(int i);
         Vector <IPAddress> * get_local_ifaces_addr();
 
 private:
@@ -40,8 +52,65 @@ private:
         //  class LocalInterfaceEtherSet _localinterfaceEtherSet;
         LocalInterfaceIPSet _localinterfaceIPSet;
 
+        Vector<Interface> _ifaces;
+        // open addressed by address hash, id + 1 of the interface, 0 if empty
+        Vector<int> _index;
+        uint32_t _index_mask;
+
+        static inline uint32_t index_hash(IPAddress a);
+        static String read_interfaces(Element *, void *);
+
 };
 
 
+inline uint32_t
+OLSRLocalIfInfoBase::index_hash(IPAddress a)
+{
+        uint32_t h = ntohl(a.addr());
+        return h ^ (h >> 16);
+}
+
+inline IPAddress
+OLSRLocalIfInfoBase::get_iface_addr(int i) const
+{
+#if OLSR_SINGLE_INTERFACE
+        return i == 0 ? _ifaces[0].addr : IPAddress();
+#else
+        if ((unsigned) i >= (unsigned) _ifaces.size())
+                return IPAddress();
+        return _ifaces[i].addr;
+#endif
+}
+
+inline int
+OLSRLocalIfInfoBase::get_index(IPAddress local_iface_addr) const
+{
+#if OLSR_SINGLE_INTERFACE
+        return local_iface_addr == _ifaces[0].addr ? 0 : -1;
+#else
+        // the index is at most a quarter full, so this rarely probes
+        for (uint32_t h = index_hash(local_iface_addr); ; h++) {
+                int id = _index[h & _index_mask];
+                if (!id)
+                        return -1;
+                if (_ifaces[id - 1].addr == local_iface_addr)
+                        return id - 1;
+        }
+#endif
+}
+
+inline OLSRLocalIfInfoBase::Interface *
+OLSRLocalIfInfoBase::get_iface(int i)
+{
+#if OLSR_SINGLE_INTERFACE
+        return i == 0 ? &_ifaces[0] : 0;
+#else
+        if ((unsigned) i >= (unsigned) _ifaces.size())
+                return 0;
+        return &_ifaces[i];
+#endif
+}
+
+
 CLICK_ENDDECLS
 #endif
@@ -0,0 +1,169 @@
+/*
+ * olsr_memory_report.{cc,hh} -- memory footprint of the OLSR control plane
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include "olsr_memory_report.hh"
+
+CLICK_DECLS
+
+void
+OLSRMemoryReport::Client::sample_memory(Vector<Usage> &usage, Vector<Usage> &peak)
+{
+  usage.clear();
+  memory_usage(usage);
+  // an element reports its types in the same order every time
+  if (_peak.size() != usage.size())
+    _peak = usage;
+  for (int i = 0; i < usage.size(); i++) {
+    if (usage[i].tuples > _peak[i].tuples)
+      _peak[i].tuples = usage[i].tuples;
+    if (usage[i].bytes > _peak[i].bytes)
+      _peak[i].bytes = usage[i].bytes;
+  }
+  peak = _peak;
+}
+
+
+String
+OLSRMemoryReport::Client::read_memory(Element *, void *thunk)
+{
+  Client *c = (Client *) thunk;
+  Vector<Usage> usage, peak;
+  c->sample_memory(usage, peak);
+  StringAccum sa;
+  for (int i = 0; i < usage.size(); i++)
+    sa << usage[i].type << ' ' << usage[i].tuples << ' ' << usage[i].bytes
+       << ' ' << peak[i].tuples << ' ' << peak[i].bytes << '\n';
+  return sa.take_string();
+}
+
+
+void
+OLSRMemoryReport::Client::add_memory_handlers(Element *e)
+{
+  e->add_read_handler("memory", read_memory, (void *) this);
+}
+
+
+String
+OLSRMemoryReport::Client::read_hash_stats(Element *, void *thunk)
+{
+  StringAccum sa;
+  ((Client *) thunk)->hash_stats(sa);
+  return sa.take_string();
+}
+
+
+void
+OLSRMemoryReport::Client::add_hash_stats_handler(Element *e)
+{
+  e->add_read_handler("hash_stats", read_hash_stats, (void *) this);
+}
+
+
+OLSRMemoryReport::OLSRMemoryReport()
+  : _timer(this)
+{
+}
+
+
+OLSRMemoryReport::~OLSRMemoryReport()
+{
+}
+
+
+int
+OLSRMemoryReport::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _interval = 1000;
+  if (cp_va_parse(conf, this, errh,
+		  cpOptional,
+		  cpSecondsAsMilli, "sampling interval", &_interval,
+		  0) < 0)
+    return -1;
+  return 0;
+}
+
+
+int
+OLSRMemoryReport::initialize(ErrorHandler *)
+{
+  _elements.clear();
+  _clients.clear();
+  for (int i = 0; i < router()->nelements(); i++) {
+    Element *e = router()->element(i);
+    if (Client *c = (Client *) e->cast("OLSRMemoryClient")) {
+      _elements.push_back(e);
+      _clients.push_back(c);
+    }
+  }
+  _timer.initialize(this);
+  if (_interval)
+    _timer.schedule_after_msec(_interval);
+  return 0;
+}
+
+
+void
+OLSRMemoryReport::run_timer(Timer *)
+{
+  Vector<Usage> usage, peak;
+  for (int i = 0; i < _clients.size(); i++)
+    _clients[i]->sample_memory(usage, peak);
+  _timer.reschedule_after_msec(_interval);
+}
+
+
+String
+OLSRMemoryReport::read_summary(Element *e, void *)
+{
+  OLSRMemoryReport *mr = (OLSRMemoryReport *) e;
+  StringAccum sa;
+  Vector<Usage> usage, peak;
+  size_t total_tuples = 0, total_bytes = 0, total_peak = 0;
+  for (int i = 0; i < mr->_clients.size(); i++) {
+    mr->_clients[i]->sample_memory(usage, peak);
+    size_t tuples = 0, bytes = 0, peak_bytes = 0;
+    for (int j = 0; j < usage.size(); j++) {
+      tuples += usage[j].tuples;
+      bytes += usage[j].bytes;
+      peak_bytes += peak[j].bytes;
+    }
+    sa << mr->_elements[i]->name() << ' ' << tuples << ' ' << bytes << ' ' << peak_bytes << '\n';
+    total_tuples += tuples;
+    total_bytes += bytes;
+    total_peak += peak_bytes;
+  }
+  sa << "total " << total_tuples << ' ' << total_bytes << ' ' << total_peak << '\n';
+  return sa.take_string();
+}
+
+
+int
+OLSRMemoryReport::write_reset_peaks(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRMemoryReport *mr = (OLSRMemoryReport *) e;
+  for (int i = 0; i < mr->_clients.size(); i++)
+    mr->_clients[i]->reset_memory_peaks();
+  return 0;
+}
+
+
+void
+OLSRMemoryReport::add_handlers()
+{
+  add_read_handler("summary", read_summary, 0);
+  add_write_handler("reset_peaks", write_reset_peaks, 0);
+}
+
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<OLSRMemoryReport::Usage>;
+template class Vector<OLSRMemoryReport::Client *>;
+#endif
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRMemoryReport);
@@ -0,0 +1,155 @@
+#ifndef OLSR_MEMORY_REPORT_HH
+#define OLSR_MEMORY_REPORT_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/hashmap.hh>
+#include <click/flathashmap.hh>
+#include <click/vector.hh>
+#include <click/straccum.hh>
+
+CLICK_DECLS
+
+/*
+=c
+OLSRMemoryReport([INTERVAL])
+
+=s OLSR
+memory footprint of the OLSR control plane
+
+=d
+
+Sums the memory reported by the OLSR elements that hold protocol state:
+OLSRNeighborInfoBase, OLSRLinkInfoBase, OLSRTopologyInfoBase,
+OLSRInterfaceInfoBase, OLSRAssociationInfoBase, OLSRDuplicateSet,
+OLSRARPQuerier and OLSRRoutingTable. It finds them by itself.
+
+Each of those elements has a C<memory> handler, giving per type of tuple it
+holds the number of tuples, the bytes used for them and the highest of both
+seen so far. Bytes are estimated from the sizes and capacities of the
+containers, including hash buckets and the per-entry overhead of the hash
+maps, but not the allocator's; they do not shrink when a container keeps its
+capacity after a removal. Peaks are sampled: every INTERVAL (default 1
+second; 0 for never) and whenever a C<memory> or C<summary> handler is
+read, so a burst shorter than INTERVAL may not show.
+
+OLSRNeighborInfoBase, OLSRLinkInfoBase, OLSRTopologyInfoBase,
+OLSRAssociationInfoBase and OLSRDuplicateSet also have a C<hash_stats>
+handler, to check how well their hash tables spread keys: one line per
+table, giving its name, entries and buckets, then how many buckets hold 0,
+1, 2, ... entries.
+
+=h summary read-only
+
+Per element, the tuples, bytes and peak bytes of all its tuple types, then
+the totals for the whole control plane.
+
+=h reset_peaks write-only
+
+Restarts all peaks from the current usage.
+
+=a OLSRNeighborInfoBase, OLSRTopologyInfoBase, OLSRRoutingTable */
+
+class OLSRMemoryReport: public Element{
+public:
+
+  struct Usage {
+    const char *type;
+    size_t tuples;
+    size_t bytes;
+
+    Usage()				{ }
+    Usage(const char *t, size_t n, size_t b) : type(t), tuples(n), bytes(b) { }
+  };
+
+  // an element holding protocol state; it must return itself as a Client
+  // from cast("OLSRMemoryClient")
+  class Client { public:
+    virtual ~Client() { }
+    // appends one Usage per type of tuple held
+    virtual void memory_usage(Vector<Usage> &usage) = 0;
+
+    // current usage, with the peaks brought up to date
+    void sample_memory(Vector<Usage> &usage, Vector<Usage> &peak);
+    void reset_memory_peaks()		{ _peak.clear(); }
+    void add_memory_handlers(Element *e);
+
+    // chain lengths of the hash tables held, see unparse_chains(); the
+    // hash_stats handler, added by add_hash_stats_handler(), reads them
+    virtual void hash_stats(StringAccum &) { }
+    void add_hash_stats_handler(Element *e);
+  private:
+    Vector<Usage> _peak;
+    static String read_memory(Element *, void *);
+    static String read_hash_stats(Element *, void *);
+  };
+
+  // estimated bytes of a container, without what its elements point to
+  template <class K, class V>
+  static size_t bytes(const HashMap<K, V> &m) {
+    // a bucket pointer, and per entry its pair and chain pointer
+    return m.nbuckets() * sizeof(void *) + m.size() * (sizeof(K) + sizeof(V) + sizeof(void *));
+  }
+  template <class K, class V>
+  static size_t bytes(const FlatHashMap<K, V> &m) {
+    return m.nbuckets() * (sizeof(uint32_t) + sizeof(typename FlatHashMap<K, V>::Pair));
+  }
+  template <class T>
+  static size_t bytes(const Vector<T> &v) {
+    return v.capacity() * sizeof(T);
+  }
+  // with the Vectors it maps to
+  template <class K, class T>
+  static size_t deep_bytes(const HashMap<K, Vector<T> > &m) {
+    size_t n = bytes(m);
+    for (typename HashMap<K, Vector<T> >::const_iterator it = m.begin(); it != m.end(); it++)
+      n += bytes(it.value());
+    return n;
+  }
+
+  // one line for hash table m: name, entries, buckets, then how many
+  // buckets hold 0, 1, 2, ... entries
+  template <class K, class V>
+  static void unparse_chains(StringAccum &sa, const char *name, const HashMap<K, V> &m) {
+    Vector<int> chain(m.nbuckets(), 0);
+    Vector<int> nchains;
+    for (typename HashMap<K, V>::const_iterator it = m.begin(); it != m.end(); it++) {
+      int &length = chain[((size_t) hashcode(it.key())) % m.nbuckets()];	// HashMap::bucket()
+      length++;
+    }
+    for (int b = 0; b < chain.size(); b++) {
+      if (chain[b] >= nchains.size())
+	nchains.resize(chain[b] + 1, 0);
+      nchains[chain[b]]++;
+    }
+    sa << name << ' ' << m.size() << ' ' << m.nbuckets();
+    for (int i = 0; i < nchains.size(); i++)
+      sa << ' ' << nchains[i];
+    sa << '\n';
+  }
+
+  OLSRMemoryReport();
+  ~OLSRMemoryReport();
+
+  const char* class_name() const { return "OLSRMemoryReport"; }
+  OLSRMemoryReport *clone() const { return new OLSRMemoryReport(); }
+  const char *port_count() const  { return "0/0"; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+  void run_timer(Timer *);
+
+private:
+
+  Vector<Element *> _elements;
+  Vector<Client *> _clients;
+  uint32_t _interval;	// msec
+  Timer _timer;
+
+  static String read_summary(Element *, void *);
+  static int write_reset_peaks(const String &, Element *, void *, ErrorHandler *);
+};
+
+CLICK_ENDDECLS
+#endif
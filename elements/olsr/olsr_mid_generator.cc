@@ -16,7 +16,7 @@
 CLICK_DECLS
 
 OLSRMIDGenerator::OLSRMIDGenerator()
-  : _timer(this)
+  : _timer(this), _mid_template(0)
 {
 }
 
@@ -50,37 +50,69 @@ if (_localIfInfoBase->get_number_ifaces() > 1) //if just one interface mid messa
 {
   _timer.initialize(this);
   _timer.schedule_now(); // Send OLSR MID messages periodically
-  _vtime = compute_vtime();
+  _vtime = olsr_vtime_encode(olsr_msec(_mid_hold_time));
   }
     return 0;
 }
 
 
+void
+OLSRMIDGenerator::cleanup(CleanupStage)
+{
+  if (_mid_template)
+    _mid_template->kill();
+  _mid_template = 0;
+}
+
+
 void
 OLSRMIDGenerator::run_timer(Timer *)
 {
-    output(0).push(generate_mid());
+    if (Packet *p = generate_mid())
+      output(0).push(p);
     _timer.reschedule_after_msec(_period);
 }
 
 
+void
+OLSRMIDGenerator::add_handlers()
+{
+  add_task_handlers(_timer.task(), "timer_");
+}
+
+
 
 Packet *
 OLSRMIDGenerator::generate_mid()
+{
+  if (!_mid_template && !(_mid_template = build_mid()))
+    return 0;
+  WritablePacket *packet = olsr_copy_packet(_mid_template);
+  if ( packet == 0 ){
+      click_chatter( "in %s: cannot make packet!", name().c_str());
+      return 0;
+  }
+  struct timeval tv;
+  click_gettimeofday(&tv);
+  packet->set_timestamp_anno(tv);
+  return packet;
+}
+
+
+WritablePacket *
+OLSRMIDGenerator::build_mid()
 {
   Vector <IPAddress> * localInterfaceList = _localIfInfoBase->get_local_ifaces_addr();
   int packet_size = sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + (_localIfInfoBase->get_number_ifaces()-1)*sizeof(in_addr);
-  int headroom = sizeof(click_ether) + sizeof(click_ip) + sizeof(click_udp);
+  int headroom = OLSR_HEADROOM;
   int tailroom = 0; 
   WritablePacket *packet = Packet::make(headroom,0,packet_size, tailroom);
   if ( packet == 0 ){
       click_chatter( "in %s: cannot make packet!", name().c_str());
+      return 0;
   }
   memset(packet->data(), 0, packet->length());
-   struct timeval tv;
-  click_gettimeofday(&tv);
-  packet->set_timestamp_anno(tv);
-  
+
   olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) packet->data();
   pkt_hdr->pkt_length = 0; //added in OLSRForward 
   pkt_hdr->pkt_seq = 0; //added in OLSRForward
@@ -102,24 +134,6 @@ OLSRMIDGenerator::generate_mid()
   return packet;
 }
 
-uint8_t 
-OLSRMIDGenerator::compute_vtime()
-{
-  uint8_t return_value = 0;
-  int t = _mid_hold_time*1000; //_mid_hold_time in msec, t in sec
-  //_mid_hold_time.tv_usec+_mid_hold_time.tv_sec*1000000; //fixpoint -> calculation in sec
-  int b=0;
-  while ((t / OLSR_C_us) >= (1<<(b+1)))
-    b++;
-  int a=(((16*t/OLSR_C_us)>>b)-16);
-  int value=(OLSR_C_us *(16+a)*(1<<b))>>4;
-  if (value<t) a++;
-  if (a==16) {b++; a=0;}
-  if ( (a <= 15 && a >= 0) && (b <= 15 && b >= 0) )
-    return_value = ((a << 4) | b );
-  return return_value; 
-}
-
 CLICK_ENDDECLS
 
 EXPORT_ELEMENT(OLSRMIDGenerator);
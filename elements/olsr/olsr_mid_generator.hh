@@ -15,6 +15,13 @@
   =d
   Generates a MID message every INTERVAL msecs if the node has been selected as MPR by another node. The message is based on the info in the node's MPR Selector Set stored in the OLSRNeighborInfobase element given as argument.
 
+  The interface set of the OLSRLocalIfInfoBase is fixed once it is
+  configured, so the message is built once and every interval sends a copy
+  of it; OLSRForward fills in the sequence numbers. The message goes out
+  through OLSRForward with the other messages of the node, so an
+  OLSRAggregator behind it puts it in the same packet as the messages sent
+  around the same time.
+
   =a
   OLSRHelloGenerator, OLSRForward
   
@@ -27,6 +34,7 @@
 #include <click/ipaddress.hh>
 #include "olsr_local_if_infobase.hh"
 #include "click_olsr.hh"
+#include "olsr_control_timer.hh"
 
 
 CLICK_DECLS
@@ -47,18 +55,21 @@ public:
 
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
 
   Packet *generate_mid();
+  WritablePacket *build_mid();
   void run_timer(Timer *);
 
 private:
   OLSRLocalIfInfoBase *_localIfInfoBase;
   int _period;
   uint8_t _vtime;
-  Timer _timer;
+  OLSRControlTimer _timer;
   IPAddress _myIP;
   int _mid_hold_time;
-  uint8_t compute_vtime();
+  Packet *_mid_template;		// the message as last built
 };
 
 CLICK_ENDDECLS
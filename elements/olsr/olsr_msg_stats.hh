@@ -0,0 +1,105 @@
+#ifndef OLSR_MSG_STATS_HH
+#define OLSR_MSG_STATS_HH
+
+#include <click/element.hh>
+#include <click/straccum.hh>
+#include "click_olsr.hh"
+#include "olsr_profile.hh"
+
+CLICK_DECLS
+
+// Control traffic accounting of one OLSR element: messages and bytes per
+// interface (the paint annotation), message type and outcome, and the
+// processor cycles the element spent on them, not counting the elements
+// downstream. Paints of NIFACES - 1 and more share the last interface slot.
+class OLSRMessageStats{
+public:
+
+  enum { HELLO, TC, MID, HNA, OTHER, NTYPES };
+  enum { RECEIVED, FORWARDED, DUPLICATE, NOT_MPR_SELECTOR, GENERATED, DISCARDED, NCOUNTERS };
+  enum { NIFACES = 8 };
+
+  OLSRMessageStats()		{ clear(); }
+
+  static int type_index(int msg_type) {
+    switch (msg_type) {
+    case OLSR_HELLO_MESSAGE:
+    case OLSR_LQ_HELLO_MESSAGE:
+    case OLSR_COMPACT_HELLO_MESSAGE:
+      return HELLO;
+    case OLSR_TC_MESSAGE:
+    case OLSR_LQ_TC_MESSAGE:
+    case OLSR_COMPACT_TC_MESSAGE:
+      return TC;
+    case OLSR_MID_MESSAGE:
+      return MID;
+    case OLSR_HNA_MESSAGE:
+      return HNA;
+    default:
+      return OTHER;
+    }
+  }
+
+  void clear() {
+    for (int i = 0; i < NIFACES; i++)
+      for (int t = 0; t < NTYPES; t++)
+	for (int c = 0; c < NCOUNTERS; c++)
+	  _counters[i][t][c].messages = _counters[i][t][c].bytes = 0;
+    cycles.clear();
+  }
+
+  void count(int counter, int iface, int msg_type, int bytes) {
+    if (iface >= NIFACES)
+      iface = NIFACES - 1;
+    Counter &c = _counters[iface][type_index(msg_type)][counter];
+    c.messages++;
+    c.bytes += bytes;
+  }
+
+  // one line per interface, type and outcome seen: interface, type,
+  // outcome, messages and bytes; then the cycles as OLSRPhaseProfile does
+  void unparse(StringAccum &sa) const {
+    static const char * const types[NTYPES] = { "hello", "tc", "mid", "hna", "other" };
+    static const char * const counters[NCOUNTERS] = {
+      "received", "forwarded", "duplicate", "not_mpr_selector", "generated", "discarded"
+    };
+    for (int i = 0; i < NIFACES; i++)
+      for (int t = 0; t < NTYPES; t++)
+	for (int c = 0; c < NCOUNTERS; c++)
+	  if (_counters[i][t][c].messages)
+	    sa << "iface" << i << ' ' << types[t] << ' ' << counters[c] << ' '
+	       << _counters[i][t][c].messages << ' ' << _counters[i][t][c].bytes << '\n';
+    cycles.unparse(sa, "cycles");
+  }
+
+  // adds the stats and clear_stats handlers to element e
+  void add_handlers(Element *e) {
+    e->add_read_handler("stats", read_handler, (void *) this);
+    e->add_write_handler("clear_stats", clear_handler, (void *) this);
+  }
+
+  OLSRPhaseProfile cycles;
+
+private:
+
+  struct Counter {
+    uint32_t messages;
+    uint64_t bytes;
+  };
+  Counter _counters[NIFACES][NTYPES][NCOUNTERS];
+
+  static String read_handler(Element *, void *thunk) {
+    StringAccum sa;
+    ((const OLSRMessageStats *) thunk)->unparse(sa);
+    return sa.take_string();
+  }
+
+  static int clear_handler(const String &, Element *, void *thunk, ErrorHandler *) {
+    ((OLSRMessageStats *) thunk)->clear();
+    return 0;
+  }
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,126 @@
+/*
+ * olsr_multipathlookup.{cc,hh} -- spreads the flows to a destination over
+ * the equal-cost next hops of the OLSR routing table
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/ipflowid.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include "olsr_multipathlookup.hh"
+
+CLICK_DECLS
+
+OLSRMultipathLookup::OLSRMultipathLookup()
+  : _single(0), _spread(0), _balanced(0), _no_route(0)
+{
+}
+
+
+OLSRMultipathLookup::~OLSRMultipathLookup()
+{
+}
+
+
+int
+OLSRMultipathLookup::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *routing_table, *route_table;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRRoutingTable element", &routing_table,
+		  cpElement, "IPRouteTable element", &route_table,
+		  0) < 0)
+    return -1;
+
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("%s is not an OLSRRoutingTable", routing_table->name().c_str());
+  if (!(_routeTable = (IPRouteTable *) route_table->cast("IPRouteTable")))
+    return errh->error("%s is not an IPRouteTable", route_table->name().c_str());
+  return 0;
+}
+
+
+/**
+ * hash of the packet's 5-tuple, the same for every packet of a flow; the
+ * ports count only for TCP and UDP packets that are not fragments
+ */
+uint32_t
+OLSRMultipathLookup::flow_hash(const Packet *p)
+{
+  const click_ip *iph = p->ip_header();
+  if (!iph)
+    return 0;
+  uint16_t sport = 0, dport = 0;
+  if ((iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP)
+      && !IP_ISFRAG(iph) && p->transport_length() >= 4) {
+    const click_udp *udph = p->udp_header();
+    sport = udph->uh_sport;
+    dport = udph->uh_dport;
+  }
+  IPFlowID flow(iph->ip_src, sport, iph->ip_dst, dport);
+  uint32_t h = flow.hashcode() ^ (iph->ip_p << 24);
+  return h ^ (h >> 16);
+}
+
+
+void
+OLSRMultipathLookup::push(int, Packet *p)
+{
+  IPAddress dst = p->dst_ip_anno();
+  IPAddress gw;
+  int port;
+  const IPRoute *balanced;
+
+  if (const Vector<IPRoute> *paths = _routingTable->multipath(dst)) {
+    const IPRoute &route = (*paths)[flow_hash(p) % paths->size()];
+    gw = route.gw;
+    port = route.port;
+    _spread++;
+  } else if (_routingTable->balancing()
+	     && (balanced = _routingTable->balanced_route(dst, flow_hash(p)))) {
+    gw = balanced->gw;
+    port = balanced->port;
+    _balanced++;
+  } else {
+    port = _routeTable->lookup_route(dst, gw);
+    _single++;
+  }
+
+  if (port >= 0 && port < noutputs()) {
+    if (gw)
+      p->set_dst_ip_anno(gw);
+    output(port).push(p);
+  } else {
+    static int complained = 0;
+    if (++complained <= 5)
+      click_chatter("%s: no route for %s", name().c_str(), dst.unparse().c_str());
+    _no_route++;
+    p->kill();
+  }
+}
+
+
+String
+OLSRMultipathLookup::read_handler(Element *e, void *)
+{
+  OLSRMultipathLookup *ml = (OLSRMultipathLookup *) e;
+  StringAccum sa;
+  sa << "single " << ml->_single << "\n"
+     << "spread " << ml->_spread << "\n"
+     << "balanced " << ml->_balanced << "\n"
+     << "no_route " << ml->_no_route << "\n";
+  return sa.take_string();
+}
+
+
+void
+OLSRMultipathLookup::add_handlers()
+{
+  add_read_handler("stats", read_handler, (void *) 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRMultipathLookup);
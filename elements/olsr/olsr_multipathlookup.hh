@@ -0,0 +1,82 @@
+/*
+  =c
+  OLSRMultipathLookup(OLSRRoutingTable element, IPRouteTable element)
+
+  =s
+  OLSR specific element, spreads the flows over equal-cost next hops
+
+  =io
+  One input, as many outputs as the routes use
+
+  =d
+  Takes the place of the lookup element on the data path, as OLSRRouteCache
+  does: expects a destination IP address annotation and an IP header with
+  each packet, sets the destination annotation to the gateway of the
+  matching route (if it has one), and emits the packet on the route's output
+  port. Packets without a route are dropped.
+
+  Destinations for which the OLSRRoutingTable element given as first
+  argument found several equal-cost next hops, with its MULTIPATH keyword,
+  get one of them chosen by a hash of the packet's flow: source and
+  destination address, protocol, and the source and destination port of TCP
+  and UDP packets. All packets of a flow keep taking the same path, so they
+  are not reordered, while different flows spread over the paths. Fragments
+  are hashed without the ports, so they all go the same way. Likewise,
+  destinations in networks that the OLSRRoutingTable shares among several
+  HNA gateways with GATEWAY_BALANCE go to the gateway the flow's hash bucket
+  belongs to. Other destinations are looked up in the IPRouteTable element
+  given as second argument.
+
+  The next hops are read from the OLSRRoutingTable element without locking;
+  on an SMP router this element must run on the thread that computes the
+  routes.
+
+  =h stats read-only
+  Packets forwarded over a single route, packets spread over equal-cost
+  next hops, packets spread over gateways, and packets dropped without a
+  route.
+
+  =a
+  OLSRRoutingTable, OLSRRouteCache, OLSRRadixIPLookup */
+
+#ifndef OLSR_MULTIPATHLOOKUP_HH
+#define OLSR_MULTIPATHLOOKUP_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include "../ip/iproutetable.hh"
+#include "olsr_rtable.hh"
+
+CLICK_DECLS
+
+class OLSRMultipathLookup : public Element { public:
+
+  OLSRMultipathLookup();
+  ~OLSRMultipathLookup();
+
+  const char *class_name() const	{ return "OLSRMultipathLookup"; }
+  const char *port_count() const	{ return "1/-"; }
+  const char *processing() const	{ return PUSH; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  void add_handlers();
+
+  void push(int, Packet *);
+
+private:
+
+  OLSRRoutingTable *_routingTable;
+  IPRouteTable *_routeTable;
+
+  uint32_t _single;
+  uint32_t _spread;
+  uint32_t _balanced;
+  uint32_t _no_route;
+
+  static uint32_t flow_hash(const Packet *p);
+  static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -2,8 +2,13 @@
 
 #include <click/config.h>
 #include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/standard/scheduleinfo.hh>
 #include "olsr_neighbor_infobase.hh"
+#include "olsr_bulk_load.hh"
 #include <click/ipaddress.hh>
+#include <click/vector.cc>
 
 #include "ippair.hh"
 #include "click_olsr.hh"
@@ -14,8 +19,7 @@
 CLICK_DECLS
 
 OLSRNeighborInfoBase::OLSRNeighborInfoBase()
-		: _twohop_timer(twohop_expiry_hook, this),
-		_mpr_selector_timer(mpr_selector_expiry_hook, this)
+		: _mpr_selector_generation(0), _mpr_task(this), _timer(expiry_hook, this), _expiryQueue(0), _bulk(false), _bulk_changed(false)
 {
 }
 
@@ -30,6 +34,11 @@ OLSRNeighborInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
 {
 	bool add_hello_msg=false;
 	bool add_mprs = false;
+	Element *expiry_queue = 0;
+	String mpr_engine = "hash";
+	bool incremental_mpr = false;
+	bool defer_mpr = false;
+	bool link_quality = false;
 	if ( cp_va_parse(conf, this, errh,
 	                 cpElement, "Routing Table Element", &_routingTable,
 	                 cpElement, "TC Generator Element", &_tcGenerator,
@@ -40,143 +49,192 @@ OLSRNeighborInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
 	                 cpOptional,
 	                 cpKeywords,"ADDITIONAL_HELLO",cpBool,"send additional hello message?",&add_hello_msg,
 	                 cpKeywords,"ADDITIONAL_MPRS",cpBool,"choose additional mprs",&add_mprs,
+	                 cpKeywords,"MPR_ENGINE",cpWord,"MPR computation engine",&mpr_engine,
+	                 cpKeywords,"INCREMENTAL_MPR",cpBool,"recompute MPRs only when coverage breaks",&incremental_mpr,
+	                 cpKeywords,"EXPIRY_QUEUE",cpElement,"shared expiry timer",&expiry_queue,
+	                 cpKeywords,"DEFER_MPR",cpBool,"compute MPRs from a Task",&defer_mpr,
+	                 cpKeywords,"LINK_QUALITY",cpBool,"prefer MPRs with better links",&link_quality,
 	                 0) < 0 )
 
 		return -1;
 	_additional_hello_message=add_hello_msg;
 	_additional_mprs=add_mprs;
+	_incremental_mpr=incremental_mpr;
+	_defer_mpr=defer_mpr;
+	_link_quality=link_quality;
+	if (expiry_queue && !(_expiryQueue = (OLSRExpiryQueue *) expiry_queue->cast("OLSRExpiryQueue")))
+		return errh->error("EXPIRY_QUEUE element is not an OLSRExpiryQueue");
+	if (mpr_engine == "hash")
+		_mpr_engine = MPR_ENGINE_HASH;
+	else if (mpr_engine == "bitvector")
+		_mpr_engine = MPR_ENGINE_BITVECTOR;
+	else
+		return errh->error("MPR_ENGINE must be \"hash\" or \"bitvector\"");
 	return 0;
 }
 
 
 int
-OLSRNeighborInfoBase::initialize(ErrorHandler *)
+OLSRNeighborInfoBase::initialize(ErrorHandler *errh)
 {
 	_neighborSet = new NeighborSet;	//ok->freed in uninitialize
 	_twohopSet = new TwoHopSet;		//ok->freed in uninitialize
+	_twohopSet->set_incremental_resizing(true);
 	_mprSelectorSet = new MPRSelectorSet;//ok->freed in uninitialize
 	_mprSet = new MPRSet;		//ok->freed in uninitialize
-	_twohop_timer.initialize(this);
-	_mpr_selector_timer.initialize(this);
-#ifdef profiling_kernel
-	_cyclesaccum=0;
-	_count=0;
-#endif
+	_timer.initialize(this);
+	set_expiry(_expiryQueue, &_timer);
+	_mpr_dirty = true;
+	_mpr_scheduled = false;
+	_mpr_schedule_requests = _mpr_computations = 0;
+	_mpr_scratch_tuples = _mpr_scratch_bytes = 0;
+	_neighbor_generation = 0;
+	_routing_generation = 0;
+	_mpr_inputs_valid = false;
+	_mpr_inputs_neighbors = _mpr_inputs_links = _mpr_inputs_interfaces = 0;
+	_mpr_unchanged_skips = 0;
+	ScheduleInfo::initialize_task(this, &_mpr_task, false, errh);
 
 	return 0;
 }
 
 void OLSRNeighborInfoBase::uninitialize()
 {
+	_mpr_task.unschedule();
 	delete _neighborSet;
 	delete _twohopSet;
 	delete _mprSelectorSet;
 	delete _mprSet;
+	_twohopsByNeighbor.clear();
+	_neighborsByTwohop.clear();
 }
 
-
 void
-OLSRNeighborInfoBase::mpr_selector_expiry_hook(Timer *timer, void *thunk)
+OLSRNeighborInfoBase::take_state(Element *e, ErrorHandler *)
 {
-	OLSRNeighborInfoBase *nib = (OLSRNeighborInfoBase *) thunk;
-	bool mpr_selector_removed = false;
-	struct timeval now, next_timeout;
-	click_gettimeofday(&now);
-	next_timeout = make_timeval(0, 0);
-
-	//find expired MPR selectors and delete them
-	if (! nib->_mprSelectorSet->empty())
-	{
-		for (MPRSelectorSet::iterator iter = nib->_mprSelectorSet->begin(); iter != nib->_mprSelectorSet->end(); iter++)
-		{
-			mpr_selector_data *mpr_selector = (mpr_selector_data *) iter.value();
-			if (mpr_selector->MS_time <= now)
-			{
-				//s        click_chatter ("node %s: MPR_Selector %s has expired, about to delete it\n",nib->_myMainIP.unparse().c_str(),mpr_selector->MS_main_addr.unparse().c_str());
-				nib->remove_mpr_selector(mpr_selector->MS_main_addr);
-				mpr_selector_removed = true;
-			}
-		}
-	}
-
-	//find next MPR selector to expire
-	if (! nib->_mprSelectorSet->empty())
-	{
-		for (MPRSelectorSet::iterator iter = nib->_mprSelectorSet->begin(); iter != nib->_mprSelectorSet->end(); iter++)
-		{
-			mpr_selector_data *mpr_selector = (mpr_selector_data *) iter.value();
-			if (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0)
-				next_timeout = mpr_selector->MS_time;
-			else if ( mpr_selector->MS_time < next_timeout )
-				next_timeout = mpr_selector->MS_time;
-		}
-	}
-
-	if (mpr_selector_removed)
-		nib->_tcGenerator->increment_ansn();
-
-	if (! (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0) )
-		timer->schedule_at(next_timeout);    //set timer
-
+	OLSRNeighborInfoBase *old = (OLSRNeighborInfoBase *) e->cast("OLSRNeighborInfoBase");
+	if (!old)
+		return;
+
+	NeighborSet *neighborSet = _neighborSet;
+	_neighborSet = old->_neighborSet;
+	old->_neighborSet = neighborSet;
+	_neighbor_generation = old->_neighbor_generation + 1;
+	_routing_generation = old->_routing_generation + 1;
+	TwoHopSet *twohopSet = _twohopSet;
+	_twohopSet = old->_twohopSet;
+	old->_twohopSet = twohopSet;
+	_twohopsByNeighbor.swap(old->_twohopsByNeighbor);
+	_neighborsByTwohop.swap(old->_neighborsByTwohop);
+	MPRSelectorSet *mprSelectorSet = _mprSelectorSet;
+	_mprSelectorSet = old->_mprSelectorSet;
+	old->_mprSelectorSet = mprSelectorSet;
+	_mpr_selector_generation = old->_mpr_selector_generation + 1;
+	MPRSet *mprSet = _mprSet;
+	_mprSet = old->_mprSet;
+	old->_mprSet = mprSet;
+	_twohop_refs.swap(old->_twohop_refs);
+	_mpr_coverage.swap(old->_mpr_coverage);
+	_mpr_neighbor_state.swap(old->_mpr_neighbor_state);
+	_twohop_expiry.swap(old->_twohop_expiry);
+	_mpr_selector_expiry.swap(old->_mpr_selector_expiry);
+
+	//the MPR set is kept until the next HELLO or expiry asks for a
+	//computation, which must not skip: the keywords may have changed
+	_mpr_dirty = true;
+
+	if (!_twohop_expiry.empty())
+		expire_at(_twohop_expiry.next());
+	if (!_mpr_selector_expiry.empty())
+		expire_at(_mpr_selector_expiry.next());
 }
 
 
 void
-OLSRNeighborInfoBase::twohop_expiry_hook(Timer *timer, void *thunk)
+OLSRNeighborInfoBase::expiry_hook(Timer *, void *thunk)
 {
 	OLSRNeighborInfoBase *nib = (OLSRNeighborInfoBase *) thunk;
-	struct timeval now, next_timeout;
-	bool twohop_removed = false;;
-	click_gettimeofday(&now);
-	next_timeout = make_timeval(0,0);
+	nib->run_expiry_timer();
+}
+
+
+olsr_time_t
+OLSRNeighborInfoBase::run_expiry(olsr_time_t now)
+{
+	bool mpr_selector_removed = false;
+	bool twohop_removed = false;
 
-	//find expired twohop neighbors and delete them
-	if (! nib->_twohopSet->empty())
+	//expire the MPR selectors at the top of the heap, put refreshed ones back
+	while (! _mpr_selector_expiry.empty() && _mpr_selector_expiry.next() <= now)
 	{
-		for (TwoHopSet::iterator iter = nib->_twohopSet->begin(); iter != nib->_twohopSet->end(); iter++)
+		IPAddress ms_addr = _mpr_selector_expiry.pop();
+		mpr_selector_data *mpr_selector = find_mpr_selector(ms_addr);
+		if (! mpr_selector)
+			continue;
+		if (mpr_selector->MS_time <= now)
 		{
-			twohop_data *twohop = (twohop_data *) iter.value();
-			if (twohop->N_time <= now)
-			{
-				nib->remove_twohop_neighbor(twohop->N_neigh_main_addr, twohop->N_twohop_addr);
-				twohop_removed = true;
-			}
+			//s        click_chatter ("node %s: MPR_Selector %s has expired, about to delete it\n",_myMainIP.unparse().c_str(),mpr_selector->MS_main_addr.unparse().c_str());
+			remove_mpr_selector(ms_addr);
+			mpr_selector_removed = true;
 		}
+		else
+			_mpr_selector_expiry.push(mpr_selector->MS_time, ms_addr);
 	}
 
-	//find next twohop neighbor to expire
-	if (! nib->_twohopSet->empty())
+	//the same for the twohop neighbors
+	while (! _twohop_expiry.empty() && _twohop_expiry.next() <= now)
 	{
-		for (TwoHopSet::iterator iter = nib->_twohopSet->begin(); iter != nib->_twohopSet->end(); iter++)
+		IPPair ippair = _twohop_expiry.pop();
+		twohop_data *twohop = _twohopSet->findp(ippair);
+		if (! twohop)
+			continue;
+		if (twohop->N_time <= now)
 		{
-			twohop_data *twohop = (twohop_data *) iter.value();
-			if (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0)
-				next_timeout = twohop->N_time;
-			else if ( twohop->N_time < next_timeout )
-				next_timeout = twohop->N_time;
+			remove_twohop_neighbor(ippair._from, ippair._to);
+			twohop_removed = true;
 		}
+		else
+			_twohop_expiry.push(twohop->N_time, ippair);
 	}
 
-	if (! (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0) )
-		timer->schedule_at(next_timeout);    //set timer
+	_mpr_selector_expiry.compact_if_stale(*_mprSelectorSet, &mpr_selector_data::MS_time);
+	_twohop_expiry.compact_if_stale(*_twohopSet, &twohop_data::N_time);
+
+	if (mpr_selector_removed)
+		_tcGenerator->notify_advertised_set_changed();
 	if (twohop_removed)
 	{
-		nib->_routingTable->compute_routing_table();
-		nib->compute_mprset();
+		_routingTable->schedule_compute_routing_table(OLSRRoutingTable::EVENT_TWOHOP_EXPIRED);
+		schedule_compute_mprset();
 	}
+
+	if (_twohop_expiry.empty() && _mpr_selector_expiry.empty())
+		return 0;
+	if (_twohop_expiry.empty())
+		return _mpr_selector_expiry.next();
+	if (_mpr_selector_expiry.empty() || _twohop_expiry.next() < _mpr_selector_expiry.next())
+		return _twohop_expiry.next();
+	return _mpr_selector_expiry.next();
 }
 
 
 neighbor_data *
 OLSRNeighborInfoBase::add_neighbor(IPAddress neigh_addr)
 {
-	click_chatter("Adding new neighbor: %s", neigh_addr.unparse().c_str());
-	struct neighbor_data *data;
-	data = new struct neighbor_data;		//freed in remove
+	if (!_bulk)
+		click_chatter("Adding new neighbor: %s", neigh_addr.unparse().c_str());
+	struct neighbor_data data;		//stored inline in the neighbor set
 
-	data->N_neigh_main_addr = neigh_addr;
+	data.N_neigh_main_addr = neigh_addr;
 	if (_neighborSet->insert(neigh_addr, data) )
-		return data;
+	{
+		_bulk_changed = true;
+		_routing_generation++;
+		_tcGenerator->notify_advertised_set_changed();
+		for (int i = 0; i < _listeners.size(); i++)
+			_listeners[i]->neighbor_changed(neigh_addr, true);
+		return _neighborSet->findp(neigh_addr);
+	}
 	return 0;
 }
 
@@ -186,14 +244,10 @@ OLSRNeighborInfoBase::find_neighbor(IPAddress neigh_addr)
 {
 	if (! _neighborSet->empty() )
 	{
-		struct HashMap<IPAddress, void*>::Pair *pair;
-		pair = _neighborSet->find_pair(neigh_addr);
+		neighbor_data *data = _neighborSet->findp(neigh_addr);
 
-		if (! pair == 0 )
-		{
-			neighbor_data *data = (neighbor_data *) pair->value;
+		if (! data == 0 )
 			return data;
-		}
 	}
 
 	return 0;
@@ -207,6 +261,13 @@ OLSRNeighborInfoBase::update_neighbor(IPAddress neigh_addr, int status, int will
 	data = find_neighbor(neigh_addr);
 	if (! data == 0 )
 	{
+		if (data->N_status != status || data->N_willingness != willingness)
+		{
+			_mpr_dirty = true;
+			_routing_generation++;
+		}
+		if (data->N_status != status)
+			_tcGenerator->notify_advertised_set_changed();
 		data->N_status = status;
 		data->N_willingness = willingness;
 		return true;
@@ -218,15 +279,20 @@ OLSRNeighborInfoBase::update_neighbor(IPAddress neigh_addr, int status, int will
 void
 OLSRNeighborInfoBase::remove_neighbor(IPAddress neigh_addr)
 {
-	_neighborSet->remove(neigh_addr);
-	if (! _twohopSet->empty())
+	if (_neighborSet->remove(neigh_addr))
 	{
-		for (TwoHopSet::iterator iter = _twohopSet->begin(); iter != _twohopSet->end(); iter++)
-		{
-			twohop_data *twohop = (twohop_data *) iter.value();
-			if (twohop->N_neigh_main_addr == neigh_addr)
-				remove_twohop_neighbor(twohop->N_neigh_main_addr, twohop->N_twohop_addr);
-		}
+		_neighbor_generation++;
+		_routing_generation++;
+		_tcGenerator->notify_advertised_set_changed();
+		for (int i = 0; i < _listeners.size(); i++)
+			_listeners[i]->neighbor_changed(neigh_addr, false);
+	}
+	if (const NeighborList *list = _twohopsByNeighbor.findp(neigh_addr))
+	{
+		//copy first, removing a tuple changes the list
+		NeighborList twohops(*list);
+		for (int i = 0; i < twohops.size(); i++)
+			remove_twohop_neighbor(neigh_addr, twohops[i]);
 	}
 }
 
@@ -236,10 +302,11 @@ OLSRNeighborInfoBase::print_neighbor_set()
 {
 	if (! _neighborSet->empty())
 	{
+		char buf[IPAddress::unparse_buflen];
 		for (NeighborSet::iterator iter = _neighborSet->begin(); iter != _neighborSet->end(); iter++)
 		{
-			neighbor_data *data = (neighbor_data *) iter.value();
-			click_chatter("neighbor: %s\n", data->N_neigh_main_addr.unparse().c_str());
+			neighbor_data *data = &iter.value();
+			click_chatter("neighbor: %s\n", data->N_neigh_main_addr.unparse(buf));
 			click_chatter("\tstatus: %d\n", data->N_status );
 			click_chatter("\twillingness: %d\n", data->N_willingness );
 		}
@@ -251,7 +318,7 @@ OLSRNeighborInfoBase::print_neighbor_set()
 }
 
 
-HashMap<IPAddress, void *> *
+OLSRNeighborInfoBase::NeighborSet *
 OLSRNeighborInfoBase::get_neighbor_set()
 {
 	return _neighborSet;
@@ -259,28 +326,114 @@ OLSRNeighborInfoBase::get_neighbor_set()
 
 
 bool
-OLSRNeighborInfoBase::add_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr, struct timeval time)
+OLSRNeighborInfoBase::add_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr, olsr_time_t time)
 {
-	IPPair ippair=IPPair(neigh_addr, twohop_neigh_addr);;
-	struct twohop_data *data, *data2;
-	data = new struct twohop_data;		//ok freed in remove
+	bool added;
+	return upsert_twohop_neighbor(IPPair(neigh_addr, twohop_neigh_addr), time, added) != 0;
+}
 
-	data->N_neigh_main_addr = neigh_addr;
-	data->N_twohop_addr = twohop_neigh_addr;
-	data->N_time = time;
 
+/**
+ * adds the 2-hop tuple, or refreshes it if it exists, with one lookup for
+ * a refresh; added tells which
+ */
+twohop_data *
+OLSRNeighborInfoBase::upsert_twohop_neighbor(const IPPair &ippair, olsr_time_t time, bool &added)
+{
+	IPAddress neigh_addr = ippair._from, twohop_neigh_addr = ippair._to;
+	twohop_data *data = _twohopSet->findp(ippair);
+
+	added = (data == 0);
+	if (data != 0)
+	{//refreshed tuple, only needs a new heap entry if it expires earlier
+		if (_bulk)
+			_twohop_expiry.append(time, ippair);
+		else if (time < data->N_time)
+		{
+			_twohop_expiry.push(time, ippair);
+			expire_at(time);
+		}
+		data->N_time = time;
+		return data;
+	}
+
+	if (_incremental_mpr)
+	{
+		_twohop_refs.find_force(twohop_neigh_addr)++;
+		if (_mprSet->findp(neigh_addr))
+			_mpr_coverage.find_force(twohop_neigh_addr)++;
+		else if (_mpr_coverage.find(twohop_neigh_addr) == 0 && twohop_neigh_addr != _myMainIP)
+		{//a 2-hop node no MPR covers yet; it only belongs to N2 if it
+			//is not itself a symmetric neighbor
+			neighbor_data *twohop_neighbor = find_neighbor(twohop_neigh_addr);
+			if (!twohop_neighbor || twohop_neighbor->N_status != OLSR_SYM_NEIGH)
+				_mpr_dirty = true;
+		}
+	}
 
-	data2 = find_twohop_neighbor(neigh_addr, twohop_neigh_addr);
+	struct twohop_data tuple;		//stored inline in the twohop set
+	tuple.N_neigh_main_addr = neigh_addr;
+	tuple.N_twohop_addr = twohop_neigh_addr;
+	tuple.N_time = time;
+	tuple.N_cost = OLSR_ETX_ONE;
 
-	if (data2 != 0)
+	if (_bulk)
 	{
-		_twohopSet->remove(ippair);
+		_twohop_expiry.append(time, ippair);
+		_bulk_changed = true;
 	}
+	else
+	{
+		_twohop_expiry.push(time, ippair);
+		expire_at(time);
+	}
+
+	_twohopSet->insert(ippair, tuple);
+	_routing_generation++;
+	_twohopsByNeighbor.find_force(neigh_addr).push_back(twohop_neigh_addr);
+	_neighborsByTwohop.find_force(twohop_neigh_addr).push_back(neigh_addr);
+	return _twohopSet->findp(ippair);
+}
 
-	if (_twohopSet->empty())
-		_twohop_timer.schedule_at(time);
 
-	return ( _twohopSet->insert(ippair, data) );
+/**
+ * applies the 2-hop neighbors one HELLO of neigh_addr advertises, and
+ * reports the tuples added and removed to the routing table, so that it can
+ * repair its routes instead of rebuilding them; the MPR set follows from
+ * the coverage counts as with add_twohop_neighbor()
+ */
+OLSRNeighborInfoBase::TwoHopDelta
+OLSRNeighborInfoBase::update_twohop_neighbors(IPAddress neigh_addr, const Vector<TwoHopUpdate> &updates, olsr_time_t time)
+{
+	TwoHopDelta delta;
+	delta.added = delta.removed = delta.cost_changed = 0;
+	for (int i = 0; i < updates.size(); i++)
+	{
+		const TwoHopUpdate &update = updates[i];
+		if (update.remove)
+		{
+			if (remove_twohop_neighbor(neigh_addr, update.addr))
+			{
+				delta.removed++;
+				_routingTable->twohop_tuple_removed(update.addr, neigh_addr);
+			}
+			continue;
+		}
+		bool added;
+		twohop_data *data = upsert_twohop_neighbor(IPPair(neigh_addr, update.addr), time, added);
+		if (update.cost >= 0 && data->N_cost != update.cost)
+		{
+			data->N_cost = update.cost;
+			delta.cost_changed++;
+			_routing_generation++;
+		}
+		if (added)
+		{
+			delta.added++;
+			_routingTable->twohop_tuple_added(update.addr, neigh_addr);
+		}
+	}
+	return delta;
 }
 
 
@@ -290,26 +443,41 @@ OLSRNeighborInfoBase::find_twohop_neighbor(IPAddress neigh_addr, IPAddress twoho
 	if (! _twohopSet->empty() )
 	{
 		IPPair ippair = IPPair(neigh_addr, twohop_neigh_addr);
-		struct HashMap<IPPair, void *>::Pair *pair;
-		pair = _twohopSet->find_pair(ippair);
+		twohop_data *data = _twohopSet->findp(ippair);
 
-		if (! pair == 0 )
-		{
-			twohop_data *data = (twohop_data *)pair->value;
+		if (! data == 0 )
 			return data;
-		}
 	}
 
 	return 0;
 }
 
-void
+bool
 OLSRNeighborInfoBase::remove_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr)
 {
 	IPPair ippair = IPPair(neigh_addr, twohop_neigh_addr);
-	twohop_data *ptr = (twohop_data*) _twohopSet->find(ippair);
-	_twohopSet->remove(ippair);
-	delete ptr;
+	if (!_twohopSet->remove(ippair))
+		return false;
+	_routing_generation++;
+	unlink(_twohopsByNeighbor, neigh_addr, twohop_neigh_addr);
+	unlink(_neighborsByTwohop, twohop_neigh_addr, neigh_addr);
+	if (_incremental_mpr)
+	{
+		int *refs = _twohop_refs.findp(twohop_neigh_addr);
+		if (refs && --(*refs) == 0)
+			_twohop_refs.remove(twohop_neigh_addr);
+		if (_mprSet->findp(neigh_addr))
+		{//lost its last covering MPR, but is still reachable through another neighbor
+			int *covered = _mpr_coverage.findp(twohop_neigh_addr);
+			if (covered && --(*covered) == 0)
+			{
+				_mpr_coverage.remove(twohop_neigh_addr);
+				if (_twohop_refs.findp(twohop_neigh_addr))
+					_mpr_dirty = true;
+			}
+		}
+	}
+	return true;
 }
 
 
@@ -318,12 +486,13 @@ OLSRNeighborInfoBase::print_twohop_set()
 {
 	if (! _twohopSet->empty() )
 	{
+		char buf[Timestamp::unparse_buflen];
 		for (TwoHopSet::iterator iter = _twohopSet->begin(); iter != _twohopSet->end(); iter++)
 		{
-			twohop_data *data = (twohop_data *) iter.value();
-			click_chatter("twohop neighbor: %s\n", data->N_twohop_addr.unparse().c_str());
-			click_chatter("\tN_neigh_main_addr: %s\n", data->N_neigh_main_addr.unparse().c_str());
-			click_chatter("\tN_time: %d\n", data->N_time.tv_sec );
+			twohop_data *data = &iter.value();
+			click_chatter("twohop neighbor: %s\n", data->N_twohop_addr.unparse(buf));
+			click_chatter("\tN_neigh_main_addr: %s\n", data->N_neigh_main_addr.unparse(buf));
+			click_chatter("\tN_time: %s\n", olsr_timestamp(data->N_time).unparse(buf));
 		}
 	}
 	else
@@ -333,30 +502,55 @@ OLSRNeighborInfoBase::print_twohop_set()
 }
 
 
-HashMap<IPPair, void*> *
+OLSRNeighborInfoBase::TwoHopSet *
 OLSRNeighborInfoBase::get_twohop_set()
 {
 	return _twohopSet;
 }
 
 
+void
+OLSRNeighborInfoBase::unlink(N2Set &map, IPAddress from, IPAddress to)
+{
+	NeighborList *list = map.findp(from);
+	if (!list)
+		return;
+	for (int i = 0; i < list->size(); i++)
+		if ((*list)[i] == to)
+		{
+			(*list)[i] = list->back();
+			list->pop_back();
+			break;
+		}
+	if (list->empty())
+		map.remove(from);
+}
+
+
 mpr_selector_data *
-OLSRNeighborInfoBase::add_mpr_selector(IPAddress ms_addr, timeval time)
+OLSRNeighborInfoBase::add_mpr_selector(IPAddress ms_addr, olsr_time_t time)
 {
-	struct mpr_selector_data *data;
-	data = new struct mpr_selector_data;		//ok, freed in remove
+	struct mpr_selector_data data;		//stored inline in the MPR selector set
 
-	data->MS_main_addr = ms_addr;
-	data->MS_time = time;
+	data.MS_main_addr = ms_addr;
+	data.MS_time = time;
 
 	if ( _mprSelectorSet->empty() )
-	{
-		_mpr_selector_timer.schedule_at(time);
 		_tcGenerator->set_node_is_mpr(true);
+	if (_bulk)
+		_mpr_selector_expiry.append(time, ms_addr);
+	else
+	{
+		_mpr_selector_expiry.push(time, ms_addr);
+		expire_at(time);
 	}
 
 	if ( _mprSelectorSet->insert(ms_addr, data) )
-		return data;
+	{
+		_mpr_selector_generation++;
+		_tcGenerator->notify_advertised_set_changed();
+		return _mprSelectorSet->findp(ms_addr);
+	}
 
 	return 0;
 
@@ -368,7 +562,7 @@ OLSRNeighborInfoBase::find_mpr_selector(IPAddress ms_addr)
 {
 	if (! _mprSelectorSet->empty() )
 	{
-		mpr_selector_data *data = (mpr_selector_data *) _mprSelectorSet->find(ms_addr);
+		mpr_selector_data *data = _mprSelectorSet->findp(ms_addr);
 
 		if (! data == 0 )
 			return data;
@@ -380,7 +574,7 @@ OLSRNeighborInfoBase::find_mpr_selector(IPAddress ms_addr)
 bool
 OLSRNeighborInfoBase::is_mpr_selector(IPAddress ms_addr)
 {
-	if (_mprSelectorSet->find(ms_addr) != 0)
+	if (_mprSelectorSet->findp(ms_addr) != 0)
 		return true;
 	return false;
 }
@@ -389,11 +583,10 @@ OLSRNeighborInfoBase::is_mpr_selector(IPAddress ms_addr)
 void
 OLSRNeighborInfoBase::remove_mpr_selector(IPAddress ms_addr)
 {
-	mpr_selector_data *ptr=(mpr_selector_data*) _mprSelectorSet->find(ms_addr);
-	if (ptr)
+	if (_mprSelectorSet->remove(ms_addr))
 	{
-		_mprSelectorSet->remove(ms_addr);
-		delete ptr;
+		_mpr_selector_generation++;
+		_tcGenerator->notify_advertised_set_changed();
 		if (_mprSelectorSet->empty())
 			_tcGenerator->set_node_is_mpr(false);
 		//click_chatter ("node %s: removed MPR Selector %s",_myMainIP.unparse().c_str(),ms_addr.unparse().c_str());
@@ -407,10 +600,11 @@ OLSRNeighborInfoBase::print_mpr_selector_set()
 {
 	if (! _mprSelectorSet->empty() )
 	{
+		char buf[IPAddress::unparse_buflen];
 		for (MPRSelectorSet::iterator iter = _mprSelectorSet->begin(); iter != _mprSelectorSet->end(); iter++)
 		{
-			mpr_selector_data *data = (mpr_selector_data *) iter.value();
-			click_chatter("MPR Selector: %s\n", data->MS_main_addr.unparse().c_str());
+			mpr_selector_data *data = &iter.value();
+			click_chatter("MPR Selector: %s\n", data->MS_main_addr.unparse(buf));
 		}
 	}
 
@@ -421,7 +615,7 @@ OLSRNeighborInfoBase::print_mpr_selector_set()
 }
 
 
-HashMap<IPAddress, void *> *
+OLSRNeighborInfoBase::MPRSelectorSet *
 OLSRNeighborInfoBase::get_mpr_selector_set()
 {
 	return _mprSelectorSet;
@@ -429,162 +623,240 @@ OLSRNeighborInfoBase::get_mpr_selector_set()
 
 
 void
-OLSRNeighborInfoBase::compute_mprset()
-{// as described in the RFC, chapter 8.3.1 MPR Computation
-	//node has only one interface
-
-#ifdef do_it
-#ifdef profiling_kernel
-	uint64_t cycles=click_get_cycles();
-	_count++;
-#endif
-
-	HashMap<IPPair, void*> *linkSet=_linkInfoBase->get_link_set();
-	HashMap <IPAddress, void *> *interfaceSet=_interfaceInfoBase->get_interface_set();
-	NeighborSet N_interface;
-	TwoHopSet twohopSet_interface;
+OLSRNeighborInfoBase::begin_bulk()
+{
+	_bulk = true;
+	_bulk_changed = false;
+}
 
-	NeighborSet *N;
-	TwoHopSet *twohopset;
-	N2Set *N2;
-	HashMap<IPAddress, int> D_y_obj;
-	HashMap<IPAddress, int> *D_y = &D_y_obj;
-	MPRSet mprset;
 
-	HashMap<IPAddress, Vector <IPAddress> > coverage;	//stores vector of nodes reachable by a 1hop Neighbor
+void
+OLSRNeighborInfoBase::commit_bulk()
+{
+	if (!_bulk)
+		return;
+	_bulk = false;
+	_twohop_expiry.rebuild();
+	_mpr_selector_expiry.rebuild();
+	if (!_twohop_expiry.empty())
+		expire_at(_twohop_expiry.next());
+	if (!_mpr_selector_expiry.empty())
+		expire_at(_mpr_selector_expiry.next());
+	if (_bulk_changed)
+	{
+		_mpr_dirty = true;
+		_routing_generation++;
+		schedule_compute_mprset();
+		_routingTable->schedule_compute_routing_table();
+	}
+}
 
 
-	Vector <IPAddress> * IP_Vector_ptr;
-	for (TwoHopSet::iterator iter = _twohopSet->begin(); iter != _twohopSet->end(); iter++)
+/**
+ * adds the tuples of a text of lines
+ *   neighbor ADDR SYM|NOT [WILLINGNESS]
+ *   twohop NEIGH TWOHOP MSECS
+ *   selector ADDR MSECS
+ * valid for MSECS milliseconds from now; existing tuples get the new
+ * status or time
+ */
+int
+OLSRNeighborInfoBase::load_handler(const String &text, Element *e, void *, ErrorHandler *errh)
+{
+	OLSRNeighborInfoBase *nib = (OLSRNeighborInfoBase *) e;
+	OLSRBulkLoader loader(text);
+	Vector<String> words;
+	Vector<neighbor_data> neighbors;
+	Vector<twohop_data> twohops;
+	Vector<mpr_selector_data> selectors;
+
+	//parse everything first, a bad line loads nothing
+	while (loader.next(words))
 	{
-		twohop_data *twohop = (twohop_data *) iter.value();
-
-		if ((IP_Vector_ptr = coverage.findp(twohop->N_neigh_main_addr)))
-			IP_Vector_ptr->push_back (twohop->N_twohop_addr);
+		if (words[0] == "neighbor")
+		{
+			neighbor_data data;
+			uint32_t willingness = OLSR_WILL_DEFAULT;
+			if (words.size() < 3 || words.size() > 4
+			    || !cp_ip_address(words[1], &data.N_neigh_main_addr)
+			    || (words[2] != "SYM" && words[2] != "NOT")
+			    || (words.size() > 3 && (!cp_unsigned(words[3], &willingness) || willingness > OLSR_WILL_ALWAYS)))
+				return errh->error("line %d: expected neighbor ADDR SYM|NOT [WILLINGNESS]", loader.line());
+			data.N_status = (words[2] == "SYM" ? OLSR_SYM_NEIGH : OLSR_NOT_NEIGH);
+			data.N_willingness = willingness;
+			neighbors.push_back(data);
+		}
+		else if (words[0] == "twohop")
+		{
+			twohop_data data;
+			if (words.size() != 4
+			    || !cp_ip_address(words[1], &data.N_neigh_main_addr)
+			    || !cp_ip_address(words[2], &data.N_twohop_addr)
+			    || !loader.parse_validity(words[3], data.N_time))
+				return errh->error("line %d: expected twohop NEIGH TWOHOP MSECS", loader.line());
+			twohops.push_back(data);
+		}
+		else if (words[0] == "selector")
+		{
+			mpr_selector_data data;
+			if (words.size() != 3
+			    || !cp_ip_address(words[1], &data.MS_main_addr)
+			    || !loader.parse_validity(words[2], data.MS_time))
+				return errh->error("line %d: expected selector ADDR MSECS", loader.line());
+			selectors.push_back(data);
+		}
 		else
+			return errh->error("line %d: expected neighbor, twohop or selector", loader.line());
+	}
+
+	nib->begin_bulk();
+	for (int i = 0; i < neighbors.size(); i++)
+	{
+		const neighbor_data &t = neighbors[i];
+		if (!nib->find_neighbor(t.N_neigh_main_addr))
+			nib->add_neighbor(t.N_neigh_main_addr);
+		nib->update_neighbor(t.N_neigh_main_addr, t.N_status, t.N_willingness);
+	}
+	for (int i = 0; i < twohops.size(); i++)
+	{
+		bool added;
+		nib->upsert_twohop_neighbor(IPPair(twohops[i].N_neigh_main_addr, twohops[i].N_twohop_addr), twohops[i].N_time, added);
+	}
+	for (int i = 0; i < selectors.size(); i++)
+	{
+		const mpr_selector_data &t = selectors[i];
+		if (mpr_selector_data *data = nib->find_mpr_selector(t.MS_main_addr))
 		{
-			Vector <IPAddress> IP_Vector;
-			IP_Vector.push_back(twohop->N_twohop_addr),
-			coverage.insert (twohop->N_neigh_main_addr,IP_Vector);
+			data->MS_time = t.MS_time;
+			nib->_mpr_selector_expiry.append(t.MS_time, t.MS_main_addr);
 		}
+		else
+			nib->add_mpr_selector(t.MS_main_addr, t.MS_time);
 	}
-	HashMap <IPAddress, NeighborSet > N_set; //Set of Neighborsets (for all local interfaces)
-	NeighborSet *N_of_interface_ptr; 	  //Neighborset pointer for one interface
-	HashMap <IPAddress, TwoHopSet> twohop_set;	//Set of TwoHopSets for (for all local interfaces)
-	TwoHopSet *twohop_of_interface_ptr;
-	HashMap <IPAddress, N2Set> n2_set;
-	//N2Set n2_set_of_interface;
-	MPRSet old_mprset;
-	if (_additional_hello_message) old_mprset=(*_mprSet);
+	nib->_bulk_changed |= !neighbors.empty();
+	nib->commit_bulk();
+	return 0;
+}
 
-	_mprSet->clear();
 
-	//though this is not performance optimized it is the first shot at multiple interfaces
-	if (! linkSet->empty() )
+/**
+ * compute the MPR set now, or with DEFER_MPR once the current burst of
+ * messages has been processed; requests arriving meanwhile are merged
+ */
+void
+OLSRNeighborInfoBase::schedule_compute_mprset()
+{
+	_mpr_schedule_requests++;
+	if (!_defer_mpr)
 	{
-		for (HashMap<IPPair, void*>::iterator iter = linkSet->begin(); iter != linkSet->end(); iter++)
-		{ 	//for all links
-			link_data *data = (link_data *)iter.value();			//get link data
-			IPAddress main_address=_interfaceInfoBase->get_main_address(data->L_neigh_iface_addr); //get main address of other
-			neighbor_data *neigh = find_neighbor (main_address);	//side of the link and its neighbor data ptr
-			if (neigh)
-			{
-				if (!(N_of_interface_ptr=N_set.findp(data->L_local_iface_addr)))	//if there doesnt already exist
-				{								//a neighborset for this
-					NeighborSet N_of_interface; 				//local Interface, create one
-					N_of_interface.insert (main_address,neigh);		//include this in the new created hasmap
-					N_set.insert (data->L_local_iface_addr,N_of_interface);	//insert it in the list for the corresponding
-				}								//local interface address
-				else 				//allmost the same as above, but adding the it to an existing list
-				{
-					N_of_interface_ptr->insert (main_address,neigh);		//include this in the existing hasmap
-				}				//corresponding to the local interface
-				//this builds the neighborsets for all local interfaces
-				//now building a twohopset for all local interfaces
-				if (!(twohop_of_interface_ptr=twohop_set.findp(data->L_local_iface_addr)))	//if there doesnt already exist
-				{								//a twohopborset for this
-					TwoHopSet twohop_of_interface; 				//local Interface, create one
-					N2Set n2_set_of_interface;
-					if ((IP_Vector_ptr=coverage.findp(main_address)))	//all nodes reachable from this neighbor are twohop neighbors
-						for (int i=0;i<IP_Vector_ptr->size();i++)
-						{
-							IPAddress N_twohop_addr=(*(IP_Vector_ptr))[i];
-							twohop_of_interface.insert (IPPair(main_address,N_twohop_addr),_twohopSet->find(IPPair(main_address,N_twohop_addr)));		//include this in the new created hasmap
-							bool insert=false;
+		compute_mprset();
+		return;
+	}
+	if (_mpr_scheduled)
+		return;
+	_mpr_scheduled = true;
+	_mpr_task.reschedule();
+}
 
-							{
-								if ((neigh->N_willingness != OLSR_WILL_NEVER) && (N_twohop_addr!=_myMainIP))
-								{
-									neighbor_data *twohop_neighbor_data = (neighbor_data*) _neighborSet->find(N_twohop_addr);
 
-									if (!twohop_neighbor_data) insert=true;
-									else if (twohop_neighbor_data->N_status == OLSR_NOT_NEIGH) insert=true;
-								}
-							}
-							if (insert)
-							{
-								Vector <IPAddress> * N2firsthopVector;
+bool
+OLSRNeighborInfoBase::run_task(Task *)
+{
+	if (!_mpr_scheduled)
+		return false;
+	_mpr_scheduled = false;
+	compute_mprset();
+	return true;
+}
 
-								if ((N2firsthopVector=n2_set_of_interface.findp(N_twohop_addr)))
-									N2firsthopVector->push_back (main_address);
-								else
-								{
-									Vector <IPAddress> IP_Vector;
-									IP_Vector.push_back(main_address),
-									n2_set_of_interface.insert (N_twohop_addr,IP_Vector);
 
-								}
+void
+OLSRNeighborInfoBase::compute_mprset()
+{// as described in the RFC, chapter 8.3.1 MPR Computation
+	//node has only one interface
 
-							}
-						}
-					twohop_set.insert (data->L_local_iface_addr,twohop_of_interface);	//insert it in the list for the corresponding
-					n2_set.insert (data->L_local_iface_addr,n2_set_of_interface);
-				}								//local interface address
-				else 				//allmost the same as above, but adding the it to an existing list
-				{
-					N2=n2_set.findp(data->L_local_iface_addr);
-					if ((IP_Vector_ptr=coverage.findp(main_address)))	//all nodes reachable from this neighbor are twohop neighbors
-					{
-						for (int i=0;i<IP_Vector_ptr->size();i++)
-						{
-							IPAddress N_twohop_addr=(*(IP_Vector_ptr))[i];
-							twohop_of_interface_ptr->insert (IPPair(main_address,N_twohop_addr),_twohopSet->find(IPPair(main_address,N_twohop_addr)));		//include this in the existing TwoHopSet for this interface
+#ifdef do_it
+	//same neighbor, 2-hop, link and interface tuples as last time: same
+	//MPRs. Link ETX changes without a tuple changing, and the bitvector
+	//engine checks L_SYM_time against the clock, so neither is cached
+	bool cacheable = !_link_quality && _mpr_engine == MPR_ENGINE_HASH;
+	if (cacheable && _mpr_inputs_valid && _mpr_inputs_neighbors == _routing_generation
+	    && _mpr_inputs_links == _linkInfoBase->changes()
+	    && _mpr_inputs_interfaces == _interfaceInfoBase->generation())
+	{
+		_mpr_unchanged_skips++;
+		return;
+	}
+	_mpr_inputs_valid = cacheable;
+	_mpr_inputs_neighbors = _routing_generation;
+	_mpr_inputs_links = _linkInfoBase->changes();
+	_mpr_inputs_interfaces = _interfaceInfoBase->generation();
+	if (_incremental_mpr && !mpr_neighborhood_changed())
+		return;
+	_mpr_computations++;
+	if (_mpr_engine == MPR_ENGINE_BITVECTOR)
+	{
+		compute_mprset_bitvector();
+		if (_incremental_mpr)
+			reset_mpr_coverage();
+		return;
+	}
 
+	click_cycles_t cycles=click_get_cycles();
+	click_cycles_t step_start, step2=0, step3=0, step4=0;
 
-							bool insert=false;
+	OLSRLinkInfoBase::LinkSet *linkSet=_linkInfoBase->get_link_set();
 
-							{
-								if ((neigh->N_willingness != OLSR_WILL_NEVER) && (N_twohop_addr!=_myMainIP))
-								{
-									neighbor_data * twohop_neighbor_data = (neighbor_data*) _neighborSet->find(N_twohop_addr);
+	NeighborView *N;
+	N2Set *N2;
+	HashMap<IPAddress, int> D_y_obj;
+	HashMap<IPAddress, int> *D_y = &D_y_obj;
+	MPRSet mprset;
 
-									if (!twohop_neighbor_data) insert=true;
-									else if (twohop_neighbor_data->N_status == OLSR_NOT_NEIGH) insert=true;
-								}
-							}
-							if (insert)
-							{
-								Vector <IPAddress> * N2firsthopVector;
+	const N2Set &coverage = _twohopsByNeighbor;	//nodes reachable by each 1hop Neighbor, kept with the twohop set
 
-								if ((N2firsthopVector=N2->findp(N_twohop_addr)))
-									N2firsthopVector->push_back (main_address);
 
-								else
-								{
-									Vector <IPAddress> IP_Vector;
-									IP_Vector.push_back(main_address),
-									N2->insert (N_twohop_addr,IP_Vector);
+	const NeighborList * IP_Vector_ptr;
+	MPRSet old_mprset;
+	if (_additional_hello_message || !_listeners.empty())
+		old_mprset.swap(*_mprSet);	//takes the old set over, leaving _mprSet empty
 
-								}
+	_mprSet->clear();
 
-							}
-						}
-					}
+	//neighbor set and N2 of each local interface, by its dense index; the
+	//coverage lists above are shared by all interfaces
+	Vector<InterfaceView> ifaces(_linkInfoBase->local_iface_count(), InterfaceView());
+	for (OLSRLinkInfoBase::LinkSet::iterator iter = linkSet->begin(); iter != linkSet->end(); iter++)
+	{ 	//for all links
+		link_data *data = &iter.value();			//get link data
+		IPAddress main_address=_linkInfoBase->neighbor_main_address(data); //get main address of other
+		neighbor_data *neigh = _linkInfoBase->neighbor_tuple(data);	//side of the link and its neighbor data ptr
+		if (!neigh)
+			continue;
+		InterfaceView &view = ifaces[OLSR_SINGLE_INTERFACE ? 0 : data->L_local_iface_index];
+		if (!view.N.insert (main_address,neigh))
+			continue;		//a second link to this neighbor on this interface
+		if ((IP_Vector_ptr=coverage.findp(main_address)))	//all nodes reachable from this neighbor are twohop neighbors
+			for (int i=0;i<IP_Vector_ptr->size();i++)
+			{
+				IPAddress N_twohop_addr=(*(IP_Vector_ptr))[i];
+				if ((neigh->N_willingness != OLSR_WILL_NEVER) && (N_twohop_addr!=_myMainIP))
+				{
+					neighbor_data *twohop_neighbor_data = _neighborSet->findp(N_twohop_addr);
+					if (!twohop_neighbor_data || twohop_neighbor_data->N_status == OLSR_NOT_NEIGH)
+						view.N2.find_force(N_twohop_addr).push_back(main_address);
 				}
 			}
-		}
 	}
-	//twohopset for all local interfaces built.
+	//neighbor sets and N2 for all local interfaces built.
+
+	_mpr_scratch_tuples = 0;
+	_mpr_scratch_bytes = OLSRMemoryReport::bytes(ifaces);
+	for (int i = 0; i < ifaces.size(); i++)
+	{
+		_mpr_scratch_tuples += ifaces[i].N.size() + ifaces[i].N2.size();
+		_mpr_scratch_bytes += OLSRMemoryReport::bytes(ifaces[i].N) + OLSRMemoryReport::bytes(ifaces[i].N2);
+	}
 
 
 #ifdef debug
@@ -596,7 +868,7 @@ OLSRNeighborInfoBase::compute_mprset()
 	//print_twohop_set();
 	click_chatter ("coverage\n");
 
-	for (HashMap<IPAddress, Vector <IPAddress> >::iterator iter=coverage.begin(); iter != coverage.end(); iter++)
+	for (N2Set::const_iterator iter=coverage.begin(); iter != coverage.end(); iter++)
 	{
 		click_chatter ("\tneighbor \t%s\n",iter.key().unparse().c_str());
 		for (int i =0; i<iter.value().size(); i++)
@@ -604,18 +876,17 @@ OLSRNeighborInfoBase::compute_mprset()
 	}
 
 
-	for (HashMap <IPAddress, NeighborSet>::iterator it=N_set.begin(); it; it++) //for over all Neighborsets for the local Interfaces
+	for (int ifi = 0; ifi < ifaces.size(); ifi++) //for over all Neighborsets for the local Interfaces
 	{
-		click_chatter ("local Interface: %s\n",it.key().unparse().c_str());
-		N = &(it.value()); // Neighborset for this interface
-		N2=n2_set.findp(it.key());
-		twohopset=twohop_set.findp(it.key());
+		click_chatter ("local Interface: %s\n",_linkInfoBase->local_iface(ifi).unparse().c_str());
+		N = &ifaces[ifi].N; // Neighborset for this interface
+		N2 = &ifaces[ifi].N2;
 		click_chatter ("\tNeighborset\t\n");
 		if (! N->empty())
 		{
-			for (NeighborSet::iterator iter = N->begin(); iter != N->end(); iter++)
+			for (NeighborView::iterator iter = N->begin(); iter != N->end(); iter++)
 			{
-				neighbor_data *data = (neighbor_data *) iter.value();
+				neighbor_data *data = iter.value();
 				click_chatter("\tneighbor: %s\n", data->N_neigh_main_addr.unparse().c_str());
 				click_chatter("\t\tstatus: %d\n", data->N_status );
 				click_chatter("\t\twillingness: %d\n", data->N_willingness );
@@ -625,23 +896,8 @@ OLSRNeighborInfoBase::compute_mprset()
 		{
 			click_chatter("\tNeighbor Set empty");
 		}
-		click_chatter ("\ttwohoset\t\n");
-		if (! twohopset->empty() )
-		{
-			for (TwoHopSet::iterator iter = twohopset->begin(); iter != twohopSet->end(); iter++)
-			{
-				twohop_data *data = (twohop_data *) iter.value();
-				click_chatter("\ttwohop neighbor: %s\n", data->N_twohop_addr.unparse().c_str());
-				click_chatter("\t\tN_neigh_main_addr: %s\n", data->N_neigh_main_addr.unparse().c_str());
-				click_chatter("\t\tN_time: %d\n", data->N_time.tv_sec );
-			}
-		}
-		else
-		{
-			click_chatter("\tTwohop Set empty\n");
-		}
 		click_chatter ("\tN2\t\n");
-		for (HashMap<IPAddress, Vector <IPAddress> >::iterator iter=N2->begin(); iter != N2->end(); iter++)
+		for (N2Set::iterator iter=N2->begin(); iter != N2->end(); iter++)
 		{
 			click_chatter ("\tn2 member \t%s\n",iter.key().unparse().c_str());
 			for (int i =0; i<iter.value().size(); i++)
@@ -649,55 +905,57 @@ OLSRNeighborInfoBase::compute_mprset()
 		}
 	}
 #endif
-	for (HashMap <IPAddress, NeighborSet>::iterator it=N_set.begin(); it != N_set.end(); it++) //for over all Neighborsets for the local Interfaces
+	_mpr_profile[MPR_PROFILE_SETUP].add(click_get_cycles()-cycles);
+	for (int ifi = 0; ifi < ifaces.size(); ifi++) //for over all Neighborsets for the local Interfaces
 	{
-
-
-		N = &(it.value()); // Neighborset for this interface
-		N2=n2_set.findp(it.key());
-		twohopset=twohop_set.findp(it.key());
+		N = &ifaces[ifi].N; // Neighborset for this interface
+		if (N->empty())
+			continue;
+		N2 = &ifaces[ifi].N2;
 #ifdef debug
-		click_chatter ("computing for interface %s\n",it.key().unparse().c_str());
+		click_chatter ("computing for interface %s\n",_linkInfoBase->local_iface(ifi).unparse().c_str());
 #endif
 
 		//just like mpr computation for single interface
 
 
 
+		step_start=click_get_cycles();
+
 		//step 0 (optimization in case of multiple interfaces, rfc step 5)
 		//if another interface has already elected a node as mpr, and this interface has a link to this node too,
 		//this node can be elected as mpr as well
 
-		if (!_mprSet->empty())
+		if (!OLSR_SINGLE_INTERFACE && !_mprSet->empty())
 		{
 			for (MPRSet::iterator iter=_mprSet->begin(); iter != _mprSet->end(); iter++)
-				//for all mprs already elected
-				for (HashMap <IPAddress, void *> ::iterator iterat = interfaceSet->begin(); iterat != interfaceSet->end(); iterat++)
-				{ 	//for all interface
-					interface_data *tuple = (interface_data *) iterat.value();			//addresses that match
-					if (tuple->I_main_addr==iter.key())
-					{					//the elected mpr as main address
-						if (linkSet->find(IPPair(it.key(),tuple->I_iface_addr))) 			//check wheter there exists a link to this interface
-						{ mprset.insert(iter.key(),iter.key());
+			{	//for all mprs already elected
+				const OLSRLinkInfoBase::LinkList *links = _linkInfoBase->links_to(iter.key());
+				bool linked = false;
+				for (int i = 0; links && i < links->size(); i++)
+					if ((*links)[i]->L_local_iface_index == ifi)	//check wheter there exists a link from this interface
+						linked = true;
+				if (linked)
+				{
+					mprset.insert(iter.key(),iter.key());
 #ifdef debug
-							click_chatter ("inserting %d as already MPR for other interface and link exists\n",iter.key().unparse().c_str());
+					click_chatter ("inserting %d as already MPR for other interface and link exists\n",iter.key().unparse().c_str());
 #endif
-						}
-					}
 					if ((IP_Vector_ptr=coverage.findp(iter.key())))
 					{
 						for (int i=0;i<IP_Vector_ptr->size();i++)
 							N2->remove((*(IP_Vector_ptr))[i]);
 					}
 				}
+			}
 		}
 
 		///@TODO step 1 RFC 3626 8.3.1
 
 		//step 2 and d_y
-		for ( NeighborSet::iterator iter = N->begin(); iter != N->end(); iter++)
+		for ( NeighborView::iterator iter = N->begin(); iter != N->end(); iter++)
 		{
-			neighbor_data *neighbor = (neighbor_data *)iter.value();
+			neighbor_data *neighbor = iter.value();
 			if (neighbor->N_willingness == OLSR_WILL_ALWAYS) //step 1 of the proposed heuristic in RFC, add all neighbors with willingness WILL_ALWAYS
 			{
 
@@ -720,8 +978,11 @@ OLSRNeighborInfoBase::compute_mprset()
 			D_y->insert(neighbor->N_neigh_main_addr, d_y);
 		}
 
+		step2+=click_get_cycles()-step_start;
+		step_start=click_get_cycles();
+
 		//step 3
-		for(HashMap<IPAddress, Vector <IPAddress> >::iterator iter = N2->begin();iter != N2->end();iter++)
+		for(N2Set::iterator iter = N2->begin();iter != N2->end();iter++)
 		{
 			if (iter.value().size()==1)
 			{
@@ -742,18 +1003,22 @@ OLSRNeighborInfoBase::compute_mprset()
 				}
 			}
 		}
+		step3+=click_get_cycles()-step_start;
+		step_start=click_get_cycles();
+
 		//step 4
 		while (! N2->empty())
 		{ //step 4
 			int best_mpr_willingness = 0;
 			int best_mpr_reachability = 0;
 			int best_mpr_d_y = 0;
+			int best_mpr_cost = 0;
 			IPAddress best_mpr;
-			for (NeighborSet::iterator iter = N->begin(); iter != N->end(); iter++)
+			for (NeighborView::iterator iter = N->begin(); iter != N->end(); iter++)
 			{
 				if (!mprset.findp(iter.key()))
 				{
-					neighbor_data* n_member = (neighbor_data *) iter.value();
+					neighbor_data* n_member = iter.value();
 
 					int reaches = 0;
 					if ((IP_Vector_ptr=coverage.findp(n_member->N_neigh_main_addr)))
@@ -762,12 +1027,14 @@ OLSRNeighborInfoBase::compute_mprset()
 					if (reaches !=0)
 					{
 						int d_y=D_y->find(n_member->N_neigh_main_addr);
+						int cost = _link_quality ? _linkInfoBase->link_cost(n_member->N_neigh_main_addr) : 0;
 						if ( n_member->N_willingness > best_mpr_willingness )
 						{
 
 							best_mpr_willingness = n_member->N_willingness;
 							best_mpr_reachability = reaches;
 							best_mpr_d_y = d_y;
+							best_mpr_cost = cost;
 							best_mpr = n_member->N_neigh_main_addr;
 						}
 						else if (n_member->N_willingness == best_mpr_willingness)
@@ -775,12 +1042,14 @@ OLSRNeighborInfoBase::compute_mprset()
 							{
 								best_mpr_reachability = reaches;
 								best_mpr_d_y = d_y;
+								best_mpr_cost = cost;
 								best_mpr = n_member->N_neigh_main_addr;
 							}
 							else if (reaches == best_mpr_reachability)
-								if (d_y>best_mpr_d_y)
+								if (cost < best_mpr_cost || (cost == best_mpr_cost && d_y>best_mpr_d_y))
 								{
 									best_mpr_d_y = d_y;
+									best_mpr_cost = cost;
 									best_mpr = n_member->N_neigh_main_addr;
 								}
 					}
@@ -802,6 +1071,7 @@ OLSRNeighborInfoBase::compute_mprset()
 			else click_chatter ("ERROR: mpr not covering anything");
 
 		}
+		step4+=click_get_cycles()-step_start;
 
 
 		for (MPRSet::iterator iter=mprset.begin(); iter != mprset.end(); iter++)
@@ -843,15 +1113,13 @@ OLSRNeighborInfoBase::compute_mprset()
 				break;
 			}
 			// this code is not optimized for multiple interfaces
-			for (HashMap <IPAddress, NeighborSet>::iterator it=N_set.begin(); it != N_set.end(); it++) //for over all Neighborsets for the local Interfaces
+			for (int ifi = 0; ifi < ifaces.size(); ifi++) //for over all Neighborsets for the local Interfaces
 			{
-				N = &(it.value()); // Neighborset for this interface
-				N2=n2_set.findp(it.key());
-				twohopset=twohop_set.findp(it.key());
+				N = &ifaces[ifi].N; // Neighborset for this interface
 				// loop over all the neighbors that we can reach through that interface
-				for (NeighborSet::iterator iter=N->begin(); iter != N->end(); iter++)
+				for (NeighborView::iterator iter=N->begin(); iter != N->end(); iter++)
 				{
-					neighbor_data* n_member = (neighbor_data *) iter.value();
+					neighbor_data* n_member = iter.value();
 					// we will only choose those nodes that are not yet MPR
 					if (!_mprSet->findp(n_member->N_neigh_main_addr))
 					{
@@ -890,26 +1158,308 @@ OLSRNeighborInfoBase::compute_mprset()
 
 
 
-	if (_additional_hello_message)
-	{
-		bool mpr_changed=false;
-		if (_mprSet->size()!=old_mprset.size()) mpr_changed=true;
-		else
-			for (MPRSet::iterator iter=_mprSet->begin();iter != _mprSet->end(); iter++)
-			if (!old_mprset.findp(iter.key())) {mpr_changed=true;break;}
-		if (mpr_changed) _helloGenerator->notify_mpr_change(); //triggers reschedule of sending a hello message now!
-	}
+	if (_additional_hello_message || !_listeners.empty())
+		mprset_changed(old_mprset);
 
 	//  click_chatter ("my Main IP %s\n",_myMainIP.unparse().c_str());
 	//  print_mpr_set();
 	//  click_chatter ("end of mpr computation\n\n");
 
-#ifdef profiling_kernel
-	_cyclesaccum+=(click_get_cycles()-cycles);
+	_mpr_profile[MPR_PROFILE_STEP2].add(step2);
+	_mpr_profile[MPR_PROFILE_STEP3].add(step3);
+	_mpr_profile[MPR_PROFILE_STEP4].add(step4);
+	_mpr_profile[MPR_PROFILE_TOTAL].add(click_get_cycles()-cycles);
+	if (_incremental_mpr)
+		reset_mpr_coverage();
 
 #endif
+}
 
-#endif
+
+/**
+ * compares the new MPR set with old_mprset, taken before the computation,
+ * and tells the HELLO generator and the listeners about a difference
+ */
+void
+OLSRNeighborInfoBase::mprset_changed(const MPRSet &old_mprset)
+{
+	Vector<IPAddress> added, removed;
+	for (MPRSet::iterator iter=_mprSet->begin();iter != _mprSet->end(); iter++)
+		if (!old_mprset.findp(iter.key()))
+			added.push_back(iter.key());
+	for (MPRSet::const_iterator iter=old_mprset.begin();iter != old_mprset.end(); iter++)
+		if (!_mprSet->findp(iter.key()))
+			removed.push_back(iter.key());
+	if (added.empty() && removed.empty())
+		return;
+	if (_additional_hello_message)
+		_helloGenerator->notify_mpr_change(); //triggers reschedule of sending a hello message now!
+	for (int i = 0; i < _listeners.size(); i++)
+		_listeners[i]->mprs_changed(added, removed);
+}
+
+
+void
+OLSRNeighborInfoBase::add_listener(Listener *listener)
+{
+	_listeners.push_back(listener);
+}
+
+
+bool
+OLSRNeighborInfoBase::mpr_neighborhood_changed()
+{// neighbor status and willingness are written directly by OLSRProcessHello
+	// and OLSRLinkInfoBase, so changes are found by comparing with the state
+	// recorded at the last computation
+	if (_mpr_dirty || _mpr_neighbor_state.size() != _neighborSet->size())
+		return true;
+	for (NeighborSet::iterator iter = _neighborSet->begin(); iter != _neighborSet->end(); iter++)
+	{
+		neighbor_data *neigh = &iter.value();
+		int *state = _mpr_neighbor_state.findp(iter.key());
+		if (!state || *state != ((neigh->N_status << 8) | neigh->N_willingness))
+			return true;
+	}
+	return false;
+}
+
+
+void
+OLSRNeighborInfoBase::reset_mpr_coverage()
+{
+	_mpr_coverage.clear();
+	_twohop_refs.clear();
+	_mpr_neighbor_state.clear();
+	for (TwoHopSet::iterator iter = _twohopSet->begin(); iter != _twohopSet->end(); iter++)
+	{
+		twohop_data *twohop = &iter.value();
+		_twohop_refs.find_force(twohop->N_twohop_addr)++;
+		if (_mprSet->findp(twohop->N_neigh_main_addr))
+			_mpr_coverage.find_force(twohop->N_twohop_addr)++;
+	}
+	for (NeighborSet::iterator iter = _neighborSet->begin(); iter != _neighborSet->end(); iter++)
+	{
+		neighbor_data *neigh = &iter.value();
+		_mpr_neighbor_state.insert(iter.key(), (neigh->N_status << 8) | neigh->N_willingness);
+	}
+	_mpr_dirty = false;
+}
+
+void
+OLSRNeighborInfoBase::compute_mprset_bitvector()
+{// RFC 3626 8.3.1 MPR computation on dense indices: symmetric 1-hop neighbors
+	// and 2-hop addresses are numbered 0..n-1 and 0..m-1, the 2-hop addresses
+	// reachable through a neighbor are kept as a Bitvector, and reachability
+	// is the popcount of that vector and the still uncovered part of N2
+
+	click_cycles_t cycles=click_get_cycles();
+	click_cycles_t step_start, step2=0, step3=0, step4=0;
+
+	OLSRLinkInfoBase::LinkSet *linkSet=_linkInfoBase->get_link_set();
+	olsr_time_t now = olsr_now();
+
+	//number the symmetric 1-hop neighbors
+	HashMap<IPAddress, int> neigh_index;
+	Vector<neighbor_data *> neighs;
+	for (NeighborSet::iterator iter = _neighborSet->begin(); iter != _neighborSet->end(); iter++)
+	{
+		neighbor_data *neigh = &iter.value();
+		if (neigh->N_status == OLSR_SYM_NEIGH)
+		{
+			neigh_index.insert(neigh->N_neigh_main_addr, neighs.size());
+			neighs.push_back(neigh);
+		}
+	}
+	int n = neighs.size();
+
+	//number the 2-hop addresses
+	HashMap<IPAddress, int> twohop_index;
+	Vector<IPAddress> twohops;
+	for (N2Set::iterator iter = _neighborsByTwohop.begin(); iter != _neighborsByTwohop.end(); iter++)
+	{
+		twohop_index.insert(iter.key(), twohops.size());
+		twohops.push_back(iter.key());
+	}
+	int m = twohops.size();
+
+	//reach[i]: 2-hop addresses advertised by neighbor i
+	//excluded: this node and all symmetric neighbors, which are never part of N2
+	Vector<Bitvector> reach(n, Bitvector(m));
+	Bitvector excluded(m);
+	for (int i = 0; i < n; i++)
+		if (const NeighborList *list = _twohopsByNeighbor.findp(neighs[i]->N_neigh_main_addr))
+			for (int j = 0; j < list->size(); j++)
+				reach[i][twohop_index.find((*list)[j])] = true;
+	Vector<int> neigh_twohop(n, -1);	//2-hop id of neighbor i, if it is advertised as 2-hop address too
+	for (int i = 0; i < n; i++)
+		if (int *j = twohop_index.findp(neighs[i]->N_neigh_main_addr))
+		{
+			neigh_twohop[i] = *j;
+			excluded[*j] = true;
+		}
+	int self = -1;
+	if (int *j = twohop_index.findp(_myMainIP))
+	{
+		self = *j;
+		excluded[self] = true;
+	}
+
+	//neighbors having a symmetric link on each local interface, by its dense index
+	Vector<Bitvector> iface_neighbors(_linkInfoBase->local_iface_count(), Bitvector(n));
+	for (OLSRLinkInfoBase::LinkSet::iterator iter = linkSet->begin(); iter != linkSet->end(); iter++)
+	{
+		link_data *data = &iter.value();
+		if (data->L_SYM_time < now)
+			continue;
+		int *i = neigh_index.findp(_linkInfoBase->neighbor_main_address(data));
+		if (!i)
+			continue;
+		iface_neighbors[OLSR_SINGLE_INTERFACE ? 0 : data->L_local_iface_index][*i] = true;
+	}
+
+	_mpr_scratch_tuples = n + m;
+	_mpr_scratch_bytes = OLSRMemoryReport::bytes(neigh_index) + OLSRMemoryReport::bytes(neighs)
+		+ OLSRMemoryReport::bytes(twohop_index) + OLSRMemoryReport::bytes(twohops)
+		+ OLSRMemoryReport::bytes(reach) + OLSRMemoryReport::bytes(iface_neighbors)
+		+ (n * ((m + 31) >> 5) + iface_neighbors.size() * ((n + 31) >> 5)) * sizeof(uint32_t);
+
+	MPRSet old_mprset;
+	if (_additional_hello_message || !_listeners.empty())
+		old_mprset.swap(*_mprSet);	//takes the old set over, leaving _mprSet empty
+	_mprSet->clear();
+
+	Bitvector mpr(n);	//union of the MPR sets of all interfaces
+	Vector<int> d_y(n, 0);
+	Vector<int> cost(n, 0);	//link ETX, with LINK_QUALITY
+	if (_link_quality)
+		for (int i = 0; i < n; i++)
+			cost[i] = _linkInfoBase->link_cost(neighs[i]->N_neigh_main_addr);
+	_mpr_profile[MPR_PROFILE_SETUP].add(click_get_cycles()-cycles);
+
+	for (int ifi = 0; ifi < iface_neighbors.size(); ifi++)
+	{
+		const Bitvector &on_iface = iface_neighbors[ifi];
+		if (!on_iface)
+			continue;
+
+		//N2: 2-hop addresses reachable through a willing neighbor on this interface
+		Bitvector uncovered(m);
+		Bitvector not_n(m);	//this node and the members of N, excluded from D(y)
+		if (self >= 0)
+			not_n[self] = true;
+		for (int i = on_iface.find_first(); i >= 0; i = on_iface.find_first(i + 1))
+			{
+				if (neighs[i]->N_willingness != OLSR_WILL_NEVER)
+					uncovered |= reach[i];
+				if (neigh_twohop[i] >= 0)
+					not_n[neigh_twohop[i]] = true;
+			}
+		uncovered -= excluded;
+
+		step_start=click_get_cycles();
+
+		//step 1 and 2: neighbors with willingness WILL_ALWAYS, and those already
+		//elected on another interface, are MPRs; compute D(y)
+		for (int i = on_iface.find_first(); i >= 0; i = on_iface.find_first(i + 1))
+			{
+				d_y[i] = reach[i].difference_count(not_n);
+				if (neighs[i]->N_willingness == OLSR_WILL_ALWAYS)
+					mpr[i] = true;
+				if (mpr[i])
+					uncovered -= reach[i];
+			}
+
+		step2+=click_get_cycles()-step_start;
+		step_start=click_get_cycles();
+
+		//step 3: neighbors that are the only ones to reach some node of N2
+		Bitvector once(m), twice(m);
+		for (int i = on_iface.find_first(); i >= 0; i = on_iface.find_first(i + 1))
+			if (neighs[i]->N_willingness != OLSR_WILL_NEVER)
+			{
+				twice |= (once & reach[i]);
+				once |= reach[i];
+			}
+		Bitvector sole = (once - twice) & uncovered;
+		if (sole)
+			for (int i = on_iface.find_first(); i >= 0; i = on_iface.find_first(i + 1))
+				if (!mpr[i] && neighs[i]->N_willingness != OLSR_WILL_NEVER
+				        && reach[i].nonzero_intersection(sole))
+				{
+					mpr[i] = true;
+					uncovered -= reach[i];
+				}
+
+		step3+=click_get_cycles()-step_start;
+		step_start=click_get_cycles();
+
+		//step 4: greedy cover of the remaining part of N2, preferring
+		//willingness, then reachability, then link quality, then D(y)
+		while (uncovered)
+		{
+			int best = -1;
+			int best_reaches = 0;
+			for (int i = on_iface.find_first(); i >= 0; i = on_iface.find_first(i + 1))
+			{
+				if (mpr[i] || neighs[i]->N_willingness == OLSR_WILL_NEVER)
+					continue;
+				int reaches = reach[i].intersection_count(uncovered);
+				if (reaches == 0)
+					continue;
+				if (best < 0
+				        || neighs[i]->N_willingness > neighs[best]->N_willingness
+				        || (neighs[i]->N_willingness == neighs[best]->N_willingness
+				            && (reaches > best_reaches
+				                || (reaches == best_reaches
+				                    && (cost[i] < cost[best] || (cost[i] == cost[best] && d_y[i] > d_y[best]))))))
+				{
+					best = i;
+					best_reaches = reaches;
+				}
+			}
+			if (best < 0)
+			{
+				click_chatter ("ERROR: mpr not covering anything");
+				break;
+			}
+			mpr[best] = true;
+			uncovered -= reach[best];
+		}
+		step4+=click_get_cycles()-step_start;
+	}
+
+	/// == mvhaen ====================================================================================================
+	// This piece of the code does not match the RFC and is optional:
+	// top up to MIN_MPR with the willing non-MPR neighbors of largest D(y)
+	if (_additional_mprs)
+	{
+		int mpr_count = mpr.count();
+		while (mpr_count < MIN_MPR)
+		{
+			int best = -1;
+			for (int i = 0; i < n; i++)
+				if (!mpr[i] && neighs[i]->N_willingness != OLSR_WILL_NEVER
+				        && (best < 0 || d_y[i] > d_y[best]))
+					best = i;
+			if (best < 0)
+				break;
+			mpr[best] = true;
+			mpr_count++;
+		}
+	}
+	/// == !mvhaen ===================================================================================================
+
+	for (int i = 0; i < n; i++)
+		if (mpr[i])
+			_mprSet->insert(neighs[i]->N_neigh_main_addr, neighs[i]->N_neigh_main_addr);
+
+	if (_additional_hello_message || !_listeners.empty())
+		mprset_changed(old_mprset);
+
+	_mpr_profile[MPR_PROFILE_STEP2].add(step2);
+	_mpr_profile[MPR_PROFILE_STEP3].add(step3);
+	_mpr_profile[MPR_PROFILE_STEP4].add(step4);
+	_mpr_profile[MPR_PROFILE_TOTAL].add(click_get_cycles()-cycles);
 }
 
 IPAddress *
@@ -930,10 +1480,11 @@ OLSRNeighborInfoBase::print_mpr_set()
 {
 	if (! _mprSet->empty() )
 	{
+		char buf[IPAddress::unparse_buflen];
 		for (MPRSet::iterator iter = _mprSet->begin(); iter != _mprSet->end(); iter++)
 		{
 			IPAddress mpr = iter.value();
-			click_chatter("MPR: %s\n", mpr.unparse().c_str());
+			click_chatter("MPR: %s\n", mpr.unparse(buf));
 		}
 	}
 	else
@@ -942,7 +1493,18 @@ OLSRNeighborInfoBase::print_mpr_set()
 	}
 }
 
-#ifdef profiling_kernel
+String
+OLSRNeighborInfoBase::mpr_stats_handler(Element *e, void *)
+{
+	OLSRNeighborInfoBase *nib = static_cast<OLSRNeighborInfoBase *>(e);
+	StringAccum sa;
+	sa << "schedule_requests " << nib->_mpr_schedule_requests << "\n"
+	   << "computations " << nib->_mpr_computations << "\n"
+	   << "unchanged_skips " << nib->_mpr_unchanged_skips << "\n"
+	   << "scheduled " << (nib->_mpr_scheduled ? "true" : "false") << "\n";
+	return sa.take_string();
+}
+
 String
 OLSRNeighborInfoBase::read_handler(Element *e, void *thunk)
 {
@@ -950,15 +1512,36 @@ OLSRNeighborInfoBase::read_handler(Element *e, void *thunk)
 	switch ((uintptr_t)thunk)
 	{
 	case 0:
-		return String(cca->_count) + "\n";
+		return String(cca->_mpr_profile[MPR_PROFILE_TOTAL].count) + "\n";
 	case 1:
-		return String(cca->_cyclesaccum) + "\n";
+		return String(cca->_mpr_profile[MPR_PROFILE_TOTAL].total) + "\n";
 
 	default:
 		return String();
 	}
 }
-#endif
+
+String
+OLSRNeighborInfoBase::mpr_profile_handler(Element *e, void *)
+{
+	OLSRNeighborInfoBase *nib = static_cast<OLSRNeighborInfoBase *>(e);
+	static const char * const names[MPR_PROFILE_NPHASES] = {
+		"setup", "step2", "step3", "step4", "total"
+	};
+	StringAccum sa;
+	for (int i = 0; i < MPR_PROFILE_NPHASES; i++)
+		nib->_mpr_profile[i].unparse(sa, names[i]);
+	return sa.take_string();
+}
+
+int
+OLSRNeighborInfoBase::clear_mpr_profile_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+	OLSRNeighborInfoBase *nib = static_cast<OLSRNeighborInfoBase *>(e);
+	for (int i = 0; i < MPR_PROFILE_NPHASES; i++)
+		nib->_mpr_profile[i].clear();
+	return 0;
+}
 
 
 
@@ -968,6 +1551,7 @@ void
 OLSRNeighborInfoBase::additional_mprs_is_enabled(bool in)
 {
 	_additional_mprs = in;
+	_mpr_inputs_valid = false;	//the next computation must not skip
 }
 
 int
@@ -992,19 +1576,75 @@ void
 OLSRNeighborInfoBase::add_handlers()
 {
 	add_write_handler("additional_mprs_is_enabled", &additional_mprs_is_enabled_handler, (void *)0);
-#ifdef profiling_kernel
+	add_read_handler("mpr_stats", mpr_stats_handler, (void *)0);
 	add_read_handler("count",read_handler,(void*) 0);
 	add_read_handler("accum",read_handler,(void*) 1);
-#endif
+	add_read_handler("mpr_profile", mpr_profile_handler, (void *)0);
+	add_write_handler("clear_mpr_profile", clear_mpr_profile_handler, (void *)0);
+	add_write_handler("load", load_handler, (void *)0);
+	add_memory_handlers(this);
+	add_hash_stats_handler(this);
+}
+
+
+void *
+OLSRNeighborInfoBase::cast(const char *n)
+{
+	if (strcmp(n, "OLSRMemoryClient") == 0)
+		return (OLSRMemoryReport::Client *) this;
+	return Element::cast(n);
+}
+
+
+/**
+ * mpr_scratch is what the temporary tables of the last MPR computation
+ * took, with the engine it ran
+ */
+void
+OLSRNeighborInfoBase::memory_usage(Vector<OLSRMemoryReport::Usage> &usage)
+{
+	usage.push_back(OLSRMemoryReport::Usage("neighbors", _neighborSet->size(),
+						OLSRMemoryReport::bytes(*_neighborSet)));
+	usage.push_back(OLSRMemoryReport::Usage("twohops", _twohopSet->size(),
+						OLSRMemoryReport::bytes(*_twohopSet) + _twohop_expiry.bytes()
+						+ OLSRMemoryReport::bytes(_twohop_refs) + OLSRMemoryReport::bytes(_twohopsByNeighbor)
+						+ OLSRMemoryReport::bytes(_neighborsByTwohop)));
+	usage.push_back(OLSRMemoryReport::Usage("mpr_selectors", _mprSelectorSet->size(),
+						OLSRMemoryReport::bytes(*_mprSelectorSet) + _mpr_selector_expiry.bytes()));
+	usage.push_back(OLSRMemoryReport::Usage("mprs", _mprSet->size(),
+						OLSRMemoryReport::bytes(*_mprSet) + OLSRMemoryReport::bytes(_mpr_coverage)
+						+ OLSRMemoryReport::bytes(_mpr_neighbor_state)));
+	usage.push_back(OLSRMemoryReport::Usage("mpr_scratch", _mpr_scratch_tuples, _mpr_scratch_bytes));
+}
+
+
+void
+OLSRNeighborInfoBase::hash_stats(StringAccum &sa)
+{
+	OLSRMemoryReport::unparse_chains(sa, "neighbors", *_neighborSet);
+	OLSRMemoryReport::unparse_chains(sa, "twohops", *_twohopSet);
+	OLSRMemoryReport::unparse_chains(sa, "mpr_selectors", *_mprSelectorSet);
+	OLSRMemoryReport::unparse_chains(sa, "mprs", *_mprSet);
 }
 /// == !mvhaen ===================================================================================================
 
 
 #include <click/bighashmap.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
-template class HashMap<IPAddress, void *>;
-template class HashMap<IPPair, void *>;
+template class HashMap<IPAddress, neighbor_data>;
+template class HashMap<IPPair, twohop_data>;
+template class HashMap<IPAddress, mpr_selector_data>;
+template class HashMap<IPAddress, neighbor_data *>;
+template class HashMap<IPPair, twohop_data *>;
 template class HashMap<IPAddress, IPAddress>;
+template class HashMap<IPAddress, int>;
+template class HashMap<IPAddress, Bitvector>;
+template class Vector<Bitvector>;
+template class Vector<OLSRNeighborInfoBase::Listener *>;
+template class Vector<neighbor_data *>;
+template class Vector<neighbor_data>;
+template class Vector<twohop_data>;
+template class Vector<mpr_selector_data>;
 #endif
 
 CLICK_ENDDECLS
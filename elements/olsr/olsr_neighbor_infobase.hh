@@ -6,8 +6,12 @@
 #include <click/element.hh>
 #include <click/ipaddress.hh>
 #include <click/bighashmap.hh>
+#include <click/flathashmap.hh>
 #include <click/vector.hh>
+#include <click/smallvector.hh>
 #include <click/timer.hh>
+#include <click/task.hh>
+#include <click/bitvector.hh>
 #include "olsr_rtable.hh"
 #include "olsr_tc_generator.hh"
 #include "ippair.hh"
@@ -15,9 +19,11 @@
 #include "olsr_link_infobase.hh"
 #include "olsr_hello_generator.hh"
 #include "olsr_interface_infobase.hh"
+#include "olsr_expiry_queue.hh"
+#include "olsr_profile.hh"
+#include "olsr_memory_report.hh"
 
 
-//#define profiling_kernel
 #define do_it
 
 
@@ -31,7 +37,7 @@ class OLSRLinkInfoBase;
 class OLSRInterfaceInfoBase;
 class OLSRHelloGenerator;
 
-class OLSRNeighborInfoBase: public Element
+class OLSRNeighborInfoBase: public Element, public OLSRExpiryQueue::Client, public OLSRMemoryReport::Client
 {
 public:
 
@@ -42,49 +48,154 @@ public:
 	OLSRNeighborInfoBase *clone() const { return new OLSRNeighborInfoBase(); }
 	int initialize(ErrorHandler *);
 	void uninitialize();
+	void take_state(Element *, ErrorHandler *);
 	int configure(Vector<String>&, ErrorHandler *errh);
+	bool run_task(Task *);
+
+	//tuples added in between do not arm the expiry timer; commit_bulk()
+	//does, and has the MPR set and the routes computed once. Commit
+	//before returning to the driver
+	void begin_bulk();
+	void commit_bulk();
+
+	typedef HashMap<IPAddress, neighbor_data> NeighborSet;
+	typedef HashMap<IPPair, twohop_data> TwoHopSet;
+	typedef HashMap<IPAddress, mpr_selector_data> MPRSelectorSet;
 
 	struct neighbor_data *add_neighbor(IPAddress neigh_addr);
 	struct neighbor_data *find_neighbor(IPAddress neigh_addr);
+	//changes whenever a neighbor tuple is removed; neighbor_data pointers
+	//stay valid while it does not
+	unsigned neighbor_generation() const { return _neighbor_generation; }
+	//changes whenever a neighbor or 2-hop tuple is added or removed, or a
+	//neighbor's status, willingness or a 2-hop cost changes, i.e. whenever
+	//the routes and the MPR set may come out differently
+	unsigned routing_generation() const { return _routing_generation; }
+	//to be called by who writes N_status or N_willingness directly
+	void neighbor_tuple_changed() { _routing_generation++; }
 	bool update_neighbor(IPAddress neigh_addr, int status, int willingness);
 	void remove_neighbor(IPAddress neigh_addr);
 	void print_neighbor_set();
-	HashMap<IPAddress, void *> *get_neighbor_set();
+	NeighborSet *get_neighbor_set();
 
-	bool add_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr, struct timeval time );
+	bool add_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr, olsr_time_t time );
 	struct twohop_data *find_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr);
-	void remove_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr);
+	bool remove_twohop_neighbor(IPAddress neigh_addr, IPAddress twohop_neigh_addr);
+
+	//the 2-hop neighbors advertised in one HELLO, in message order
+	struct TwoHopUpdate {
+		IPAddress addr;		//main address
+		int cost;		//ETX from LQ_HELLO, or -1
+		bool remove;		//advertised as NOT_NEIGH
+	};
+	struct TwoHopDelta {
+		int added, removed, cost_changed;
+	};
+	TwoHopDelta update_twohop_neighbors(IPAddress neigh_addr, const Vector<TwoHopUpdate> &updates, olsr_time_t time);
 	void print_twohop_set();
-	HashMap<IPPair, void*> *get_twohop_set();
+	TwoHopSet *get_twohop_set();
+
+	//the 2-hop tuples are indexed by both addresses, so that neighbor
+	//loss, coverage and N2 only look at the tuples concerned
+	typedef SmallVector<IPAddress, 8> NeighborList;			//short: first hops of a twohop node, twohops of a neighbor
+	const NeighborList *twohops_of(IPAddress neigh_addr) const { return _twohopsByNeighbor.findp(neigh_addr); }
+	const NeighborList *neighbors_of_twohop(IPAddress twohop_addr) const { return _neighborsByTwohop.findp(twohop_addr); }
 
-	struct mpr_selector_data *add_mpr_selector(IPAddress ms_addr, struct timeval time);
+	struct mpr_selector_data *add_mpr_selector(IPAddress ms_addr, olsr_time_t time);
 	struct mpr_selector_data *find_mpr_selector(IPAddress ms_addr);
 	bool is_mpr_selector(IPAddress ms_addr);
+	//changes whenever an MPR selector tuple is added or removed, i.e.
+	//whenever is_mpr_selector() may answer differently
+	unsigned mpr_selector_generation() const { return _mpr_selector_generation; }
 	void remove_mpr_selector(IPAddress ms_addr);
 	void print_mpr_selector_set();
-	HashMap<IPAddress, void *> *get_mpr_selector_set();
+	MPRSelectorSet *get_mpr_selector_set();
 
 	void compute_mprset();
+	void compute_mprset_bitvector();
+	void schedule_compute_mprset();
 	IPAddress *find_mpr(const IPAddress &address);
 	void print_mpr_set();
 
 	void add_handlers();
+	void *cast(const char *);
+	void memory_usage(Vector<OLSRMemoryReport::Usage> &);
+	void hash_stats(StringAccum &);
+
+	//told about neighbor tuples added and removed, and about the
+	//difference each MPR computation made to the MPR set
+	class Listener { public:
+		virtual ~Listener() { }
+		virtual void neighbor_changed(const IPAddress &main_addr, bool up) = 0;
+		virtual void mprs_changed(const Vector<IPAddress> &added, const Vector<IPAddress> &removed) = 0;
+	};
+	void add_listener(Listener *listener);
 	
 	void  additional_mprs_is_enabled(bool in);
-#ifdef profiling_kernel
 	static String read_handler(Element *e, void *thunk);
-#endif
 
 
 private:
-	typedef HashMap<IPAddress, void *> NeighborSet;
-	typedef HashMap<IPPair, void *> TwoHopSet;
-	typedef HashMap<IPAddress, void *> MPRSelectorSet;
+	typedef HashMap<IPAddress, neighbor_data *> NeighborView;	//tuples of one interface, owned by _neighborSet
 	typedef HashMap<IPAddress, IPAddress> MPRSet;
-	typedef HashMap<IPAddress, Vector <IPAddress> > N2Set ;
+	typedef HashMap<IPAddress, NeighborList> N2Set ;
+	struct InterfaceView {		//one local interface, in compute_mprset
+		NeighborView N;		//neighbors linked through it
+		N2Set N2;		//strict 2-hop neighbors reachable through them
+	};
+
+	enum { MPR_ENGINE_HASH, MPR_ENGINE_BITVECTOR };
+	int _mpr_engine;
+
+
+	//INCREMENTAL_MPR: the MPR set is only recomputed when a 2-hop node loses
+	//its last covering MPR, a new uncovered 2-hop node appears, or the
+	//status or willingness of a neighbor changes
+	bool _incremental_mpr;
+	bool _mpr_dirty;
+
+	//DEFER_MPR: message processing and expiry only schedule the MPR
+	//computation, which then runs from _mpr_task after the current burst;
+	//like the routing table Task it can be bound to the control plane
+	//thread with StaticThreadSched
+	bool _defer_mpr;
+	bool _mpr_scheduled;
+
+	//LINK_QUALITY: among candidates covering as many 2-hop nodes, the one
+	//with the lowest link ETX is elected MPR first
+	bool _link_quality;
+
+	unsigned _neighbor_generation;
+	unsigned _routing_generation;
+	//routing_generation(), link changes() and interface generation() of the
+	//last MPR computation; a computation with the same ones would elect the
+	//same MPRs
+	bool _mpr_inputs_valid;
+	unsigned _mpr_inputs_neighbors;
+	uint32_t _mpr_inputs_links;
+	unsigned _mpr_inputs_interfaces;
+	uint32_t _mpr_unchanged_skips;
+	unsigned _mpr_selector_generation;
+	uint32_t _mpr_schedule_requests;
+	uint32_t _mpr_computations;
+	size_t _mpr_scratch_tuples;	//entries and bytes of the temporaries of the last computation
+	size_t _mpr_scratch_bytes;
+	Task _mpr_task;
+	//plain counters, looked up on every 2-hop change: no pointers into them are kept
+	FlatHashMap<IPAddress, int> _mpr_coverage;	//2-hop address -> number of MPRs advertising it
+	FlatHashMap<IPAddress, int> _twohop_refs;	//2-hop address -> number of 2-hop tuples
+	FlatHashMap<IPAddress, int> _mpr_neighbor_state;	//neighbor -> status and willingness at the last computation
+
+	bool mpr_neighborhood_changed();
+	void mprset_changed(const MPRSet &old_mprset);
+	void reset_mpr_coverage();
+	twohop_data *upsert_twohop_neighbor(const IPPair &ippair, olsr_time_t time, bool &added);
 
 	NeighborSet *_neighborSet;
 	TwoHopSet *_twohopSet;
+	N2Set _twohopsByNeighbor;	//N_neigh_main_addr -> N_twohop_addr
+	N2Set _neighborsByTwohop;	//N_twohop_addr -> N_neigh_main_addr
+	static void unlink(N2Set &map, IPAddress from, IPAddress to);
 	MPRSelectorSet *_mprSelectorSet;
 	MPRSet *_mprSet;
 	OLSRRoutingTable *_routingTable;
@@ -93,23 +204,30 @@ private:
 	OLSRLinkInfoBase *_linkInfoBase;
 	OLSRInterfaceInfoBase *_interfaceInfoBase;
 	//OLSRLocalIfInfoBase *_localIfInfoBase;
-	Timer _twohop_timer;
-	Timer _mpr_selector_timer;
+	OLSRExpiryHeap<IPPair> _twohop_expiry;
+	OLSRExpiryHeap<IPAddress> _mpr_selector_expiry;
+	Timer _timer;
+	OLSRExpiryQueue *_expiryQueue;
+	Vector<Listener *> _listeners;
 	bool _additional_hello_message;
 	IPAddress _myMainIP;
+	bool _bulk;
+	bool _bulk_changed;
 /// == mvhaen ====================================================================================================
 	bool _additional_mprs;
 	static int additional_mprs_is_enabled_handler(const String &conf, Element *e, void *, ErrorHandler * errh);
+	static String mpr_stats_handler(Element *e, void *);
 /// == !mvhaen ===================================================================================================
 
-#ifdef profiling_kernel
-	uint64_t _cyclesaccum;
-	long _count;
-
-#endif
+	enum { MPR_PROFILE_SETUP, MPR_PROFILE_STEP2, MPR_PROFILE_STEP3, MPR_PROFILE_STEP4,
+	       MPR_PROFILE_TOTAL, MPR_PROFILE_NPHASES };
+	OLSRPhaseProfile _mpr_profile[MPR_PROFILE_NPHASES];
+	static String mpr_profile_handler(Element *e, void *);
+	static int clear_mpr_profile_handler(const String &, Element *e, void *, ErrorHandler *);
+	static int load_handler(const String &, Element *e, void *, ErrorHandler *);
 
-	static void mpr_selector_expiry_hook(Timer *timer, void *thunk);
-	static void twohop_expiry_hook(Timer *timer, void *thunk);
+	olsr_time_t run_expiry(olsr_time_t now);
+	static void expiry_hook(Timer *timer, void *thunk);
 };
 
 CLICK_ENDDECLS
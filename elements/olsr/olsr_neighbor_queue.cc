@@ -0,0 +1,328 @@
+/*
+ * olsr_neighbor_queue.{cc,hh} -- per-next-hop queues, scheduled by deficit
+ * round robin
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/integers.hh>
+#include "olsr_neighbor_queue.hh"
+
+CLICK_DECLS
+
+OLSRNeighborQueue::OLSRNeighborQueue()
+  : _round_head(-1), _round_tail(-1), _length(0), _highwater_length(0), _drops(0),
+    _aqm_drops(0)
+{
+}
+
+
+OLSRNeighborQueue::~OLSRNeighborQueue()
+{
+}
+
+
+void *
+OLSRNeighborQueue::cast(const char *n)
+{
+  if (strcmp(n, "OLSRNeighborQueue") == 0)
+    return (OLSRNeighborQueue *) this;
+  else if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+    return static_cast<Notifier *>(&_empty_note);
+  else
+    return Element::cast(n);
+}
+
+
+int
+OLSRNeighborQueue::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _capacity = 1000;
+  _neighbor_capacity = -1;
+  _quantum = 1500;
+  _target = Timestamp();
+  _interval = Timestamp::make_msec(100);
+  if (cp_va_parse(conf, this, errh,
+		  cpOptional,
+		  cpInteger, "maximum queue length", &_capacity,
+		  cpKeywords,
+		  "QUANTUM", cpUnsigned, "bytes per round", &_quantum,
+		  "NEIGHBOR_CAPACITY", cpInteger, "maximum queue length per next hop", &_neighbor_capacity,
+		  "TARGET", cpTimestamp, "acceptable queueing delay", &_target,
+		  "INTERVAL", cpTimestamp, "CoDel interval", &_interval,
+		  cpEnd) < 0)
+    return -1;
+  if (_capacity < 0)
+    return errh->error("CAPACITY must be positive");
+  if (_quantum == 0)
+    return errh->error("QUANTUM must be positive");
+  if (_target && !_interval)
+    return errh->error("INTERVAL must be positive");
+  if (_neighbor_capacity < 0 || _neighbor_capacity > _capacity)
+    _neighbor_capacity = _capacity;
+  _empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+  return 0;
+}
+
+
+int
+OLSRNeighborQueue::initialize(ErrorHandler *)
+{
+  _length = _highwater_length = 0;
+  _drops = 0;
+  _aqm_drops = 0;
+  return 0;
+}
+
+
+void
+OLSRNeighborQueue::cleanup(CleanupStage)
+{
+  for (int i = 0; i < _flows.size(); i++)
+    while (Packet *p = _flows[i].head) {
+      _flows[i].head = p->next();
+      p->kill();
+    }
+  _flows.clear();
+  _flow_index.clear();
+  _free.clear();
+  _round_head = _round_tail = -1;
+  _length = 0;
+}
+
+
+void
+OLSRNeighborQueue::drop(Packet *p)
+{
+  if (_drops == 0)
+    click_chatter("%{element}: overflow", this);
+  _drops++;
+  checked_output_push(1, p);
+}
+
+
+void
+OLSRNeighborQueue::release_flow(int i)
+{
+  _flow_index.remove(_flows[i].next_hop);
+  _flows[i].head = _flows[i].tail = 0;
+  _free.push_back(i);
+}
+
+
+void
+OLSRNeighborQueue::push(int, Packet *p)
+{
+  if (_length >= _capacity) {
+    drop(p);
+    return;
+  }
+
+  IPAddress next_hop = p->dst_ip_anno();
+  int *ip = _flow_index.findp(next_hop);
+  int i;
+  if (ip) {
+    i = *ip;
+    if (_flows[i].length >= _neighbor_capacity) {
+      drop(p);
+      return;
+    }
+    _flows[i].tail->set_next(p);
+  } else {
+    if (_free.size()) {
+      i = _free.back();
+      _free.pop_back();
+    } else {
+      i = _flows.size();
+      _flows.push_back(Flow());
+    }
+    _flow_index.insert(next_hop, i);
+    Flow &f = _flows[i];
+    f.next_hop = next_hop;
+    f.head = p;
+    f.length = 0;
+    f.deficit = 0;
+    f.first_above = Timestamp();
+    f.drop_count = 0;
+    f.dropping = false;
+    //a next hop with nothing queued joins the round at the end
+    f.next = -1;
+    if (_round_tail >= 0)
+      _flows[_round_tail].next = i;
+    else
+      _round_head = i;
+    _round_tail = i;
+  }
+
+  Flow &f = _flows[i];
+  if (_target)
+    p->timestamp_anno().set_now();
+  p->set_next(0);
+  f.tail = p;
+  f.length++;
+  if (++_length > _highwater_length)
+    _highwater_length = _length;
+  _empty_note.wake();
+}
+
+
+Packet *
+OLSRNeighborQueue::pull(int)
+{
+  //every pass over a next hop that cannot send adds a quantum, so this
+  //ends after at most the longest packet / QUANTUM rounds
+  while (_round_head >= 0) {
+    int i = _round_head;
+    Flow &f = _flows[i];
+    Packet *p = f.head;
+    if (p->length() <= f.deficit) {
+      f.deficit -= p->length();
+      f.head = p->next();
+      p->set_next(0);
+      f.length--;
+      _length--;
+      bool aqm_drop = _target && codel_drop(f, p);
+      if (!f.head) {
+	_round_head = f.next;
+	if (_round_head < 0)
+	  _round_tail = -1;
+	release_flow(i);
+      }
+      if (aqm_drop) {
+	_aqm_drops++;
+	p->kill();
+	continue;
+      }
+      return p;
+    }
+    f.deficit += _quantum;
+    if (_round_head != _round_tail) {
+      _round_head = f.next;
+      f.next = -1;
+      _flows[_round_tail].next = i;
+      _round_tail = i;
+    }
+  }
+
+  _empty_note.sleep();
+#if HAVE_MULTITHREAD
+  // as in NotifierQueue: a push() may have woken the notifier just before
+  if (_length)
+    _empty_note.wake();
+#endif
+  return 0;
+}
+
+
+Timestamp
+OLSRNeighborQueue::codel_spacing(uint32_t count) const
+{
+  return Timestamp::make_usec(_interval.usecval() / int_sqrt(count));
+}
+
+
+// CoDel (Nichols and Jacobson, "Controlling Queue Delay") on the queue of
+// one next hop, as p leaves it: returns whether to drop p
+bool
+OLSRNeighborQueue::codel_drop(Flow &f, Packet *p)
+{
+  Timestamp now = Timestamp::now();
+  bool above = false;
+  if (now - p->timestamp_anno() < _target || !f.head)
+    f.first_above = Timestamp();
+  else if (!f.first_above)
+    f.first_above = now + _interval;
+  else if (now >= f.first_above)
+    above = true;
+
+  if (f.dropping) {
+    if (!above)
+      f.dropping = false;
+    else if (now >= f.drop_next) {
+      f.drop_count++;
+      f.drop_next += codel_spacing(f.drop_count);
+      return true;
+    }
+    return false;
+  } else if (above) {
+    //if it dropped recently, the last drop rate was about right
+    if (f.drop_count > 2 && now - f.drop_next < Timestamp::make_usec(_interval.usecval() * 16))
+      f.drop_count -= 2;
+    else
+      f.drop_count = 1;
+    f.dropping = true;
+    f.drop_next = now + codel_spacing(f.drop_count);
+    return true;
+  }
+  return false;
+}
+
+
+Packet *
+OLSRNeighborQueue::take_next_hop(IPAddress next_hop)
+{
+  int *ip = _flow_index.findp(next_hop);
+  if (!ip)
+    return 0;
+  int i = *ip;
+
+  int prev = -1;
+  for (int j = _round_head; j != i; j = _flows[j].next)
+    prev = j;
+  if (prev >= 0)
+    _flows[prev].next = _flows[i].next;
+  else
+    _round_head = _flows[i].next;
+  if (_round_tail == i)
+    _round_tail = prev;
+
+  Packet *packets = _flows[i].head;
+  _length -= _flows[i].length;
+  release_flow(i);
+  return packets;
+}
+
+
+String
+OLSRNeighborQueue::read_handler(Element *e, void *thunk)
+{
+  OLSRNeighborQueue *q = static_cast<OLSRNeighborQueue *>(e);
+  switch ((intptr_t) thunk) {
+  case 0:
+    return String(q->_length) + "\n";
+  case 1:
+    return String(q->_highwater_length) + "\n";
+  case 2:
+    return String(q->_drops) + "\n";
+  case 4:
+    return String(q->_aqm_drops) + "\n";
+  default: {
+    StringAccum sa;
+    for (int i = q->_round_head; i >= 0; i = q->_flows[i].next)
+      sa << q->_flows[i].next_hop << ' ' << q->_flows[i].length << '\n';
+    return sa.take_string();
+  }
+  }
+}
+
+
+void
+OLSRNeighborQueue::add_handlers()
+{
+  add_read_handler("length", read_handler, (void *) 0);
+  add_read_handler("highwater_length", read_handler, (void *) 1);
+  add_read_handler("drops", read_handler, (void *) 2);
+  add_read_handler("neighbors", read_handler, (void *) 3);
+  add_read_handler("aqm_drops", read_handler, (void *) 4);
+}
+
+#include <click/vector.cc>
+#include <click/bighashmap.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<OLSRNeighborQueue::Flow>;
+template class HashMap<IPAddress, int>;
+#endif
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRNeighborQueue)
@@ -0,0 +1,161 @@
+#ifndef CLICK_OLSR_NEIGHBOR_QUEUE_HH
+#define CLICK_OLSR_NEIGHBOR_QUEUE_HH
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include <click/ipaddress.hh>
+#include <click/bighashmap.hh>
+#include <click/vector.hh>
+#include <click/timestamp.hh>
+CLICK_DECLS
+
+/*
+=c
+
+OLSRNeighborQueue([CAPACITY, I<keywords>])
+
+=s storage
+
+stores packets in one FIFO queue per next hop, pulled round-robin
+
+=d
+
+Stores the packets arriving on its input in one FIFO queue per next hop,
+the next hop being the destination IP address annotation that the route
+lookup set, and hands them out on pulls by deficit round robin (as
+DRRSched does across its inputs): every next hop with packets waiting gets
+QUANTUM bytes per round. A neighbor over a bad link, whose packets leave
+slowly behind the MAC retries, then only holds up its own packets, and
+not those for the good neighbors queued behind them in a single Queue.
+
+CAPACITY is the number of packets all the queues together can hold, and
+NEIGHBOR_CAPACITY the number one next hop can hold. A packet that does not
+fit is dropped, or sent to output 1 if there is one.
+
+An OLSRRecoverFromLinkLayer given the element as NEIGHBOR_QUEUE takes the
+packets waiting for a next hop out of it when the link layer reports that
+next hop lost, and sends them to be routed again with the packet that
+failed.
+
+With TARGET set, each next hop also gets its own CoDel active queue
+management: when the packets of one next hop have kept waiting longer than
+TARGET for a whole INTERVAL, its queue drops packets at its head, ever more
+often, until their waits fall below TARGET again. As every next hop has its
+own queue and share of the rounds, the waits measure the rate at which that
+neighbor's packets actually leave, so a degraded link is throttled and its
+sources slow down, while the queues of the good links stay short and
+undisturbed. The element then sets the timestamp annotation of every packet
+to the time it arrived. The state of a next hop is forgotten whenever its
+queue empties.
+
+OLSRNeighborQueue notifies downstream elements such as ToDevice when it
+becomes empty or nonempty, as NotifierQueue does.
+
+Keyword arguments are:
+
+=over 8
+
+=item QUANTUM
+
+Unsigned. Bytes a next hop may send per round. Default is 1500.
+
+=item NEIGHBOR_CAPACITY
+
+Unsigned. Packets one next hop can have queued. Default is CAPACITY.
+
+=item TARGET
+
+Time. The wait in a next hop's queue that is acceptable. Default is 0, for no
+active queue management. 5ms suits most links.
+
+=item INTERVAL
+
+Time. How long waits must stay above TARGET before dropping starts, and the
+first interval between drops. Default is 100ms.
+
+=back
+
+=h length read-only
+Number of packets queued.
+
+=h highwater_length read-only
+Largest number of packets ever queued.
+
+=h drops read-only
+Number of packets dropped for lack of room.
+
+=h aqm_drops read-only
+Number of packets dropped by the active queue management.
+
+=h neighbors read-only
+One line per next hop with packets queued: the next hop and the number of
+its packets.
+
+=a Queue, NotifierQueue, DRRSched, OLSRRecoverFromLinkLayer */
+
+class OLSRNeighborQueue : public Element { public:
+
+  OLSRNeighborQueue();
+  ~OLSRNeighborQueue();
+
+  const char *class_name() const	{ return "OLSRNeighborQueue"; }
+  const char *port_count() const	{ return PORTS_1_1X2; }
+  const char *processing() const	{ return "h/lh"; }
+  void *cast(const char *);
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void push(int port, Packet *);
+  Packet *pull(int port);
+
+  // takes the packets queued for next_hop out of the queue, linked with
+  // Packet::next(); null if there are none
+  Packet *take_next_hop(IPAddress next_hop);
+
+ private:
+
+  struct Flow {
+    IPAddress next_hop;
+    Packet *head;
+    Packet *tail;
+    int length;
+    uint32_t deficit;
+    int next;			// next flow in the round, -1 at the end
+
+    // CoDel state, with TARGET
+    Timestamp first_above;	// when the wait may first count as too long
+    Timestamp drop_next;
+    uint32_t drop_count;
+    bool dropping;
+  };
+
+  Vector<Flow> _flows;		// slots, the unused ones on the free list
+  HashMap<IPAddress, int> _flow_index;
+  Vector<int> _free;
+  int _round_head;		// flows with packets, in round-robin order
+  int _round_tail;
+
+  int _capacity;
+  int _neighbor_capacity;
+  uint32_t _quantum;
+  int _length;
+  int _highwater_length;
+  uint32_t _drops;
+  Timestamp _target;
+  Timestamp _interval;
+  uint32_t _aqm_drops;
+  ActiveNotifier _empty_note;
+
+  void release_flow(int);
+  void drop(Packet *);
+  bool codel_drop(Flow &, Packet *);
+  Timestamp codel_spacing(uint32_t count) const;
+
+  static String read_handler(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
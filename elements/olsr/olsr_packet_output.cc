@@ -0,0 +1,153 @@
+/*
+ * olsr_packet_output.{cc,hh} -- packet sequence number, IP, UDP and
+ * Ethernet headers of the OLSR packets of one interface in one element
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include "olsr_packet_output.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+OLSRPacketOutput::OLSRPacketOutput()
+{
+}
+
+
+OLSRPacketOutput::~OLSRPacketOutput()
+{
+}
+
+
+int
+OLSRPacketOutput::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  EtherAddress ether;
+  IPAddress dst(0xFFFFFFFFU);
+  _checksum = true;
+  if ( cp_va_parse(conf, this, errh,
+		   cpIPAddress, "Output Interface Address", &_interfaceAddress,
+		   cpOptional,
+		   cpEthernetAddress, "Output Interface Ethernet Address", &ether,
+		   cpKeywords,
+		   "DST", cpIPAddress, "destination address", &dst,
+		   "CHECKSUM", cpBool, "compute UDP checksum", &_checksum,
+		   0) < 0 )
+    return -1;
+
+  memset(&_headers, 0, sizeof(_headers));
+  _header_offset = sizeof(click_ether);
+  if (ether) {
+    memcpy(_headers.ether.ether_shost, ether.data(), 6);
+    memset(_headers.ether.ether_dhost, 0xFF, 6);
+    _headers.ether.ether_type = htons(ETHERTYPE_IP);
+    _header_offset = 0;
+  }
+  // build the IP header outside the packed template, which need not be
+  // aligned for click_ip
+  click_ip ip;
+  memset(&ip, 0, sizeof(ip));
+  ip.ip_v = 4;
+  ip.ip_hl = sizeof(click_ip) >> 2;
+  ip.ip_p = IP_PROTO_UDP;
+  ip.ip_src = _interfaceAddress.in_addr();
+  ip.ip_dst = dst.in_addr();
+  ip.ip_ttl = 250;	// as UDPIPEncap
+  _ip_sum = (uint16_t) ~click_in_cksum((const unsigned char *) &ip, sizeof(click_ip));
+  memcpy(&_headers.ip, &ip, sizeof(click_ip));
+  _headers.udp.uh_sport = _headers.udp.uh_dport = htons(OLSR_PORT);
+  return 0;
+}
+
+
+int
+OLSRPacketOutput::initialize(ErrorHandler *)
+{
+  _seq_num = 0;
+  _ip_id = 0;
+  _packets = 0;
+  return 0;
+}
+
+
+// these elements are usually anonymous, so find the old one by interface
+Element *
+OLSRPacketOutput::hotswap_element() const
+{
+  if (Router *r = router()->hotswap_router())
+    for (int i = 0; i < r->nelements(); i++)
+      if (OLSRPacketOutput *e = (OLSRPacketOutput *) r->element(i)->cast("OLSRPacketOutput"))
+	if (e->_interfaceAddress == _interfaceAddress)
+	  return e;
+  return 0;
+}
+
+
+void
+OLSRPacketOutput::take_state(Element *e, ErrorHandler *)
+{
+  // the neighbors' OLSRCheckPacketSeq drops packets not newer than the
+  // last one they saw from this interface
+  OLSRPacketOutput *old = (OLSRPacketOutput *) e;
+  _seq_num = old->_seq_num;
+  _ip_id = old->_ip_id;
+}
+
+
+void
+OLSRPacketOutput::push(int, Packet *p)
+{
+  int olsr_length = p->length();
+  int header_length = sizeof(Headers) - _header_offset;
+  WritablePacket *q = p->push(header_length);
+  if (!q)
+    return;
+
+  olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) (q->data() + header_length);
+  if (++_seq_num >= OLSR_MAX_SEQNUM)
+    _seq_num = 1;
+  pkt_hdr->pkt_length = htons(olsr_length);
+  pkt_hdr->pkt_seq = htons(_seq_num);
+
+  memcpy(q->data(), (const uint8_t *) &_headers + _header_offset, header_length);
+  click_ip *ip = (click_ip *) (q->data() + sizeof(click_ether) - _header_offset);
+  click_udp *udp = (click_udp *) (ip + 1);
+  int udp_length = olsr_length + sizeof(click_udp);
+  ip->ip_len = htons(udp_length + sizeof(click_ip));
+  ip->ip_id = htons(_ip_id++);
+  // RFC 1071 sums are byte order independent: add the fields as stored
+  uint32_t sum = _ip_sum + ip->ip_len + ip->ip_id;
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  ip->ip_sum = ~(sum + (sum >> 16));
+  udp->uh_ulen = htons(udp_length);
+  if (_checksum)
+    udp->uh_sum = click_in_cksum_pseudohdr(click_in_cksum((const unsigned char *) udp, udp_length), ip, udp_length);
+
+  if (!_header_offset)
+    q->set_mac_header(q->data(), sizeof(click_ether));
+  q->set_ip_header(ip, sizeof(click_ip));
+  q->set_dst_ip_anno(IPAddress(ip->ip_dst));
+  _packets++;
+  output(0).push(q);
+}
+
+
+String
+OLSRPacketOutput::read_handler(Element *e, void *)
+{
+  OLSRPacketOutput *po = (OLSRPacketOutput *) e;
+  return String(po->_packets) + "\n";
+}
+
+
+void
+OLSRPacketOutput::add_handlers()
+{
+  add_read_handler("packets", read_handler, 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRPacketOutput);
@@ -0,0 +1,82 @@
+/*
+  =c
+  OLSR specific element, final header stage of the OLSR packets sent on one interface
+
+  =s
+  OLSRPacketOutput(Output Interface Address, [Output Interface Ethernet Address, KEYWORDS])
+
+  =io
+  One input, one output
+
+  =processing
+  PUSH
+
+  =d
+  Gets OLSR packets on its input, ready but for their packet header: sets the packet length and packet sequence number of the OLSR packet header, and prepends the IP and UDP headers (port 698, to DST) and, if an Ethernet address is given, an Ethernet header to the broadcast address. It does the work of OLSRAddPacketSeq, UDPIPEncap and EtherEncap in one pass: the headers are built once at configuration, so each packet costs a copy and the fields that change. The IP checksum is not recomputed either: the sum of the template's constant fields is kept, and only the length and id are added to it. One is needed for each network interface, after its OLSRAggregator; JitterUnqueue may follow.
+
+  Keyword arguments are:
+
+  =item DST
+  IP address. Destination of the packets. Default is 255.255.255.255.
+
+  =item CHECKSUM
+  Boolean. Whether to compute the UDP checksum, which IPv4 makes optional. Default is true.
+
+  =h packets read-only
+  Returns the number of packets sent.
+
+  =a
+  OLSRAddPacketSeq, OLSRAggregator, OLSRForward, UDPIPEncap
+*/
+#ifndef OLSR_PACKET_OUTPUT_HH
+#define OLSR_PACKET_OUTPUT_HH
+
+#include <click/element.hh>
+#include <click/etheraddress.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include <clicknet/ether.h>
+
+CLICK_DECLS
+
+class OLSRPacketOutput: public Element{
+public:
+
+  OLSRPacketOutput();
+  ~OLSRPacketOutput();
+
+  const char* class_name() const { return "OLSRPacketOutput"; }
+  const char* processing() const { return PUSH; }
+  OLSRPacketOutput *clone() const { return new OLSRPacketOutput(); }
+  const char *port_count() const  { return "1/1"; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  Element *hotswap_element() const;
+  void take_state(Element *, ErrorHandler *);
+  void add_handlers();
+
+  void push(int, Packet *packet);
+
+private:
+  // the headers put in front of every packet, length, id and sums zero
+  struct Headers {
+    click_ether ether;
+    click_ip ip;
+    click_udp udp;
+  } CLICK_SIZE_PACKED_ATTRIBUTE;
+
+  IPAddress _interfaceAddress;
+  Headers _headers;
+  int _header_offset;		// of the headers used in _headers, 0 with Ethernet
+  bool _checksum;
+  uint16_t _seq_num;
+  uint16_t _ip_id;
+  uint32_t _ip_sum;		// one's complement sum of _headers.ip, length and id zero
+  uint32_t _packets;
+
+  static String read_handler(Element *, void *);
+};
+
+CLICK_ENDDECLS
+#endif
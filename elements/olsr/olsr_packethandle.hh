@@ -57,8 +57,48 @@ public :
         static void print_packet(Packet *);
 
 private:
-        static struct timeval calculate_validity_time(int vtime_a, int vtime_b);
 
+        friend class OLSRMessageView;
+};
+
+
+/* Zero-copy view of one OLSR message inside a packet. The fields are read
+   in place from the message header, so an element only pays for what it
+   looks at instead of decoding a whole msg_hdr_info. valid() checks the
+   header and the advertised message size against the bytes available;
+   nothing else is checked here.
+*/
+class OLSRMessageView
+{
+public :
+        OLSRMessageView(const Packet *p, int offset = 0)
+                : _hdr(reinterpret_cast<const olsr_msg_hdr *>(p->data() + offset)),
+                  _room((int) p->length() - offset) { }
+
+        bool valid() const {
+                return _room >= (int) sizeof(olsr_msg_hdr)
+                        && size() >= (int) sizeof(olsr_msg_hdr) && size() <= _room;
+        }
+
+        int type() const                { return _hdr->msg_type; }
+        int size() const                { return ntohs(_hdr->msg_size); }
+        IPAddress originator() const    { return IPAddress(_hdr->originator_address); }
+        int ttl() const                 { return _hdr->ttl; }
+        int hop_count() const           { return _hdr->hop_count; }
+        int seq() const                 { return ntohs(_hdr->msg_seq); }
+        olsr_time_t validity_time() const {
+                return olsr_vtime_decode(_hdr->vtime);
+        }
+
+        // bytes following the message header, up to the advertised size
+        const uint8_t *body() const     { return reinterpret_cast<const uint8_t *>(_hdr + 1); }
+        int body_length() const         { return size() - (int) sizeof(olsr_msg_hdr); }
+
+        const olsr_msg_hdr *header() const { return _hdr; }
+
+private:
+        const olsr_msg_hdr *_hdr;
+        int _room;
 };
 
 
@@ -90,7 +130,7 @@ OLSRPacketHandle::get_msg_hdr_info(Packet *_packet, int offset)
         hdr_info.msg_type = (int) msg_hdr->msg_type;
         hdr_info.vtime_a = (int) (msg_hdr->vtime) >> 4;
         hdr_info.vtime_b = (int) (msg_hdr->vtime) & 0x0f;
-        hdr_info.validity_time = calculate_validity_time(hdr_info.vtime_a, hdr_info.vtime_b);
+        hdr_info.validity_time = olsr_vtime_decode(msg_hdr->vtime);
         hdr_info.msg_size = (int) ntohs(msg_hdr->msg_size);
         hdr_info.originator_address = IPAddress(msg_hdr->originator_address);
         hdr_info.ttl = (int) msg_hdr->ttl;
@@ -170,56 +210,6 @@ OLSRPacketHandle::print_packet(Packet *_packet)
 }
 
 
-/*inline timeval
-OLSRPacketHandle::calculate_validity_time(int vtime_a, int vtime_b){
- //calculates validity time as described in OLSR RFC3626 section 3.3.2 
- double part_a, part_b, result;
- struct timeval validity_time;
- 
- part_a =  1 + (double) (vtime_a)/16;
- part_b = pow(2, vtime_b);
- result = OLSR_C * part_a * part_b;
- validity_time = double2timeval(result);
- 
- return validity_time;
-}*/
-
-
-inline timeval
-OLSRPacketHandle::calculate_validity_time(int vtime_a, int vtime_b)
-{
-        //calculates validity time as described in OLSR RFC3626 section 3.3.2
-        int t;
-        struct timeval validity_time;
-
-        t=(OLSR_C_us *(16+vtime_a)*(1<<vtime_b))>>4;
-
-        validity_time.tv_sec=(t / 1000000);
-        validity_time.tv_usec=(t % 1000000);
-
-        /*  //______________________________
-          
-            double part_a, part_b, result;
-          struct timeval validity_t;
-         
-          part_a =  1 + (double) (vtime_a)/16;
-          part_b = pow(2, vtime_b);
-          result = OLSR_C * part_a * part_b;
-          validity_t = double2timeval(result);
-          
-          
-          if (validity_time!=validity_t)
-          {
-          click_chatter ("calculate_validity_time new: vtime_a=%d \t vtime_b=%d \t t=%d\n",vtime_a,vtime_b,t);
-          click_chatter ("calculate_validity_time old: vtime_a=%d \t vtime_b=%d \t t=%f\n",vtime_a,vtime_b,result);
-           click_chatter ("calc_val_time: valor nuevo: %d %d \nvalor viejo: %d %d\n",validity_time.tv_sec,validity_time.tv_usec,validity_t.tv_sec,validity_t.tv_usec);
-          } 
-        */
-
-        return validity_time;
-}
-
-
 CLICK_ENDDECLS
 
 #endif
@@ -0,0 +1,185 @@
+/*
+ * olsr_priosched.{cc,hh} -- priority scheduler for the output of an OLSR
+ * interface, with rate-limited inputs and queue delay histograms
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "olsr_priosched.hh"
+
+CLICK_DECLS
+
+OLSRPrioSched::OLSRPrioSched()
+  : _inputs(0)
+{
+}
+
+
+OLSRPrioSched::~OLSRPrioSched()
+{
+}
+
+
+int
+OLSRPrioSched::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _burst = 10;
+  if (cp_va_parse_remove_keywords(conf, 0, this, errh,
+				  "BURST", cpUnsigned, "token bucket size", &_burst,
+				  cpEnd) < 0)
+    return -1;
+  if (conf.size() > ninputs())
+    return errh->error("%d rates for %d inputs", conf.size(), ninputs());
+  if (_burst == 0 || _burst > TOKEN)
+    return errh->error("BURST should be between 1 and %u", (unsigned) TOKEN);
+
+  _rates.clear();
+  for (int i = 0; i < conf.size(); i++) {
+    uint32_t rate;
+    if (!cp_unsigned(conf[i], &rate) || rate > TOKEN)
+      return errh->error("rate %d should be packets per second, at most %u", i, (unsigned) TOKEN);
+    _rates.push_back(rate);
+  }
+  return 0;
+}
+
+
+int
+OLSRPrioSched::initialize(ErrorHandler *errh)
+{
+  if (!(_inputs = new Input[ninputs()]))
+    return errh->error("out of memory!");
+  Timestamp now = Timestamp::now();
+  for (int i = 0; i < ninputs(); i++) {
+    Input &in = _inputs[i];
+    in.signal = Notifier::upstream_empty_signal(this, i, 0);
+    in.rate = (i < _rates.size() ? _rates[i] : 0);
+    in.tokens = (uint64_t) _burst * TOKEN;
+    in.refilled = now;
+    in.limited = in.packets = in.max_delay = 0;
+    memset(in.delays, 0, sizeof(in.delays));
+  }
+  return 0;
+}
+
+
+void
+OLSRPrioSched::cleanup(CleanupStage)
+{
+  delete[] _inputs;
+}
+
+
+bool
+OLSRPrioSched::take_token(Input &in, const Timestamp &now)
+{
+  uint64_t full = (uint64_t) _burst * TOKEN;
+  if (in.tokens < full) {
+    //at one packet per second or more the bucket is full after burst
+    //seconds, longer gaps add nothing
+    Timestamp::value_type usecs = (now - in.refilled).usecval();
+    if (usecs >= (Timestamp::value_type) full)
+      in.tokens = full;
+    else if (usecs > 0) {
+      in.tokens += (uint64_t) usecs * in.rate;
+      if (in.tokens > full)
+	in.tokens = full;
+    }
+  }
+  in.refilled = now;
+  if (in.tokens < TOKEN)
+    return false;
+  in.tokens -= TOKEN;
+  return true;
+}
+
+
+void
+OLSRPrioSched::count_delay(Input &in, const Packet *p, const Timestamp &now)
+{
+  if (!p->timestamp_anno())
+    return;
+  Timestamp::value_type usecs = (now - p->timestamp_anno()).usecval();
+  uint32_t delay = (usecs <= 0 ? 0 : usecs >= 0xFFFFFFFFU ? 0xFFFFFFFFU : (uint32_t) usecs);
+
+  //bucket k > 0 holds the delays from 2^(k-1) up to 2^k microseconds
+  int k = 0;
+  for (uint32_t d = delay; d && k < NBUCKETS - 1; d >>= 1)
+    k++;
+  in.delays[k]++;
+  in.packets++;
+  if (delay > in.max_delay)
+    in.max_delay = delay;
+}
+
+
+Packet *
+OLSRPrioSched::pull(int)
+{
+  Timestamp now = Timestamp::now();
+  for (int i = 0; i < ninputs(); i++) {
+    Input &in = _inputs[i];
+    if (!in.signal)
+      continue;
+    if (in.rate && !take_token(in, now)) {
+      in.limited++;
+      continue;
+    }
+    if (Packet *p = input(i).pull()) {
+      count_delay(in, p, now);
+      return p;
+    }
+    if (in.rate)
+      in.tokens += TOKEN;	//nothing was sent for it
+  }
+  return 0;
+}
+
+
+String
+OLSRPrioSched::read_handler(Element *e, void *thunk)
+{
+  OLSRPrioSched *s = static_cast<OLSRPrioSched *>(e);
+  StringAccum sa;
+  for (int i = 0; i < s->ninputs(); i++) {
+    const Input &in = s->_inputs[i];
+    sa << i;
+    if (thunk)
+      sa << ' ' << in.limited;
+    else {
+      sa << ' ' << in.packets << ' ' << in.max_delay;
+      for (int k = 0; k < NBUCKETS; k++)
+	if (in.delays[k])
+	  sa << ' ' << (1U << k) << ':' << in.delays[k];
+    }
+    sa << '\n';
+  }
+  return sa.take_string();
+}
+
+
+int
+OLSRPrioSched::reset_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRPrioSched *s = static_cast<OLSRPrioSched *>(e);
+  for (int i = 0; i < s->ninputs(); i++) {
+    Input &in = s->_inputs[i];
+    in.limited = in.packets = in.max_delay = 0;
+    memset(in.delays, 0, sizeof(in.delays));
+  }
+  return 0;
+}
+
+
+void
+OLSRPrioSched::add_handlers()
+{
+  add_read_handler("delays", read_handler, (void *) 0);
+  add_read_handler("limited", read_handler, (void *) 1);
+  add_write_handler("reset", reset_handler, 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRPrioSched)
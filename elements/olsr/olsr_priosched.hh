@@ -0,0 +1,113 @@
+#ifndef CLICK_OLSR_PRIOSCHED_HH
+#define CLICK_OLSR_PRIOSCHED_HH
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include <click/timestamp.hh>
+CLICK_DECLS
+
+/*
+=c
+
+OLSRPrioSched([RATE0, ..., RATEI<N-1>, I<keywords>])
+
+=s scheduling
+
+pulls from priority-scheduled inputs, some of them rate limited
+
+=d
+
+A PrioSched for the output of an OLSR interface: each pull tries the inputs
+starting from input 0 and returns the first packet it gets, so the inputs
+are strictly prioritized. In the generated configuration input 0 gets the
+node's own control messages, HELLOs and ARP, input 1 the floods forwarded
+for other nodes and input 2 the data packets; a HELLO then waits at most
+for the packet being sent, whatever the load of the lower inputs.
+
+RATEI<i> is the rate, in packets per second, at which input I<i> may be
+pulled; 0, the default, means no limit. A limited input has a token bucket
+of BURST packets: while it is empty the input is passed over, and lower
+inputs are served. Limiting the forwarded floods keeps a storm of TC
+messages from starving the data, and from filling the lower queues.
+
+For every input OLSRPrioSched keeps a histogram of the delays of the
+packets it pulls, measured from their timestamp annotations; a SetTimestamp
+in front of each input's Queue makes that the time spent in the queue.
+Packets without a timestamp are not counted.
+
+The inputs usually come from Queues. OLSRPrioSched uses notification to
+avoid pulling from empty inputs.
+
+Keyword arguments are:
+
+=over 8
+
+=item BURST
+
+Unsigned. Size of the token buckets of the limited inputs, in packets.
+Default is 10.
+
+=back
+
+=h delays read-only
+One line per input: the input, the number of packets pulled, the largest
+delay in microseconds, and then UPPER:COUNT for every nonempty bucket of
+the histogram, COUNT being the number of packets delayed by less than
+UPPER microseconds but not by less than half of UPPER; the last bucket
+also counts all longer delays.
+
+=h limited read-only
+One line per input: the input and the number of pulls that passed over it
+because its token bucket was empty.
+
+=h reset write-only
+Clears the histograms and the counts of limited pulls.
+
+=a PrioSched, Queue, SetTimestamp, OLSRForward */
+
+class OLSRPrioSched : public Element { public:
+
+  OLSRPrioSched();
+  ~OLSRPrioSched();
+
+  const char *class_name() const	{ return "OLSRPrioSched"; }
+  const char *port_count() const	{ return "-/1"; }
+  const char *processing() const	{ return PULL; }
+  const char *flags() const		{ return "S0"; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  Packet *pull(int port);
+
+ private:
+
+  enum { NBUCKETS = 24 };	// the last one holds the delays of 4 s and longer
+  enum { TOKEN = 1000000 };	// a packet, in the units of the token buckets
+
+  struct Input {
+    NotifierSignal signal;
+    uint32_t rate;		// packets per second, 0 if not limited
+    uint64_t tokens;
+    Timestamp refilled;
+    uint32_t limited;
+    uint32_t packets;
+    uint32_t max_delay;		// microseconds
+    uint32_t delays[NBUCKETS];
+  };
+
+  Input *_inputs;
+  Vector<uint32_t> _rates;
+  uint32_t _burst;
+
+  bool take_token(Input &, const Timestamp &now);
+  void count_delay(Input &, const Packet *, const Timestamp &now);
+
+  static String read_handler(Element *, void *);
+  static int reset_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
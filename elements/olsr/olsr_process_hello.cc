@@ -9,7 +9,8 @@
 #include "olsr_neighbor_infobase.hh"
 #include "olsr_process_hello.hh"
 #include "olsr_packethandle.hh"
-#include "clicknet/ether.h"
+#include "olsr_address_block.hh"
+#include <clicknet/ether.h>
 
 CLICK_DECLS
 
@@ -26,6 +27,9 @@ int
 OLSRProcessHello::configure(Vector<String> &conf, ErrorHandler *errh)
 {
 	int neighbor_hold_time;
+	_link_quality = false;
+	_lq_window = 10;
+	_hysteresis = false;
 
 	if (cp_va_parse(conf, this, errh,
 	                cpInteger,"Neihbor Hold time",&neighbor_hold_time,
@@ -35,72 +39,190 @@ OLSRProcessHello::configure(Vector<String> &conf, ErrorHandler *errh)
 	                cpElement, "Routing Table Element", &_routingTable,
 	                cpElement, "TC generator element", &_tcGenerator,
 	                cpElement, "localIfInfoBase Element", &_localIfInfoBase,
-	                cpIPAddress, "Main IPAddress of node", &_myMainIp,  0) < 0)
+	                cpIPAddress, "Main IPAddress of node", &_myMainIp,
+	                cpKeywords,
+	                "LINK_QUALITY", cpBool, "route by link quality", &_link_quality,
+	                "LQ_WINDOW", cpInteger, "HELLOs averaged into the link quality", &_lq_window,
+	                "HYSTERESIS", cpBool, "link hysteresis", &_hysteresis,
+	                0) < 0)
 		return -1;
-	_neighbor_hold_time_tv=make_timeval ((int) (neighbor_hold_time / 1000),(neighbor_hold_time % 1000));
+	if (_lq_window <= 0)
+		return errh->error("LQ_WINDOW must be greater than 0");
+	_neighbor_hold_time = olsr_msec(neighbor_hold_time);
 	return 0;
 }
 
+
+/**
+ * number of the neighbor's HELLOs lost on the link since the previous one,
+ * estimated from the time in between and the advertised interval; -1 for
+ * the first HELLO on the link, 0 if the interval is unknown
+ */
+int
+OLSRProcessHello::lost_hellos(const link_data *link, const hello_hdr_info &hello_info, olsr_time_t now) const
+{
+	if (!link->L_last_hello)
+		return -1;
+	int interval = olsr_vtime_decode((hello_info.htime_a << 4) | hello_info.htime_b) / 1000;	//msecs
+	if (interval <= 0)
+		return 0;
+	olsr_time_t gap = now - link->L_last_hello;
+	if (gap >= olsr_msec(3600000))
+		return 3600;
+	int lost = ((int) (gap / 1000) + interval / 2) / interval - 1;
+	return lost > 0 ? lost : 0;
+}
+
+
+/**
+ * moving average of the share of the neighbor's HELLOs received on the
+ * link over the last _lq_window of them.
+ * Returns true if the advertised value, the upper byte, changed.
+ */
+bool
+OLSRProcessHello::update_link_quality(link_data *link, int lost)
+{
+	int old_lq = link->L_lq >> 8;
+	if (lost < 0)
+		link->L_lq = 65535;
+	else
+	{
+		if (lost > _lq_window)
+			lost = _lq_window;
+		for (int i = 0; i < lost; i++)
+			link->L_lq -= link->L_lq / _lq_window;
+		link->L_lq += (65535 - link->L_lq) / _lq_window;
+	}
+	return (link->L_lq >> 8) != old_lq;
+}
+
+
+/**
+ * RFC 3626 section 14.3: the HELLOs lost scale the quality down, and the
+ * one received moves it up; as HYST_SCALING is 1/2 both are shifts. A new
+ * link starts pending. Returns true if the link was dropped, in which case
+ * its L_SYM_time has expired.
+ */
+bool
+OLSRProcessHello::update_hysteresis(link_data *link, int lost, olsr_time_t now)
+{
+	bool dropped = false;
+	if (lost < 0)
+	{
+		link->L_link_quality = 0;
+		link->L_link_pending = true;
+	}
+	else if (lost > 0)
+	{
+		link->L_link_quality >>= (lost < 16 ? lost : 16) * OLSR_HYST_SCALING_SHIFT;
+		if (!link->L_link_pending && link->L_link_quality < OLSR_HYST_THRESHOLD_LOW)
+		{
+			link->L_link_pending = true;
+			link->L_LOST_LINK_time = now + _neighbor_hold_time;
+			if (link->L_time < link->L_LOST_LINK_time)
+				link->L_LOST_LINK_time = link->L_time;
+			link->L_SYM_time = now - olsr_msec(1000);  // == expired
+			dropped = true;
+		}
+	}
+	link->L_link_quality += (65535 - link->L_link_quality) >> OLSR_HYST_SCALING_SHIFT;
+	if (link->L_link_pending && link->L_link_quality > OLSR_HYST_THRESHOLD_HIGH)
+	{
+		link->L_link_pending = false;
+		link->L_LOST_LINK_time = 0;
+	}
+	return dropped;
+}
+
+
 void
 OLSRProcessHello::push(int, Packet *packet)
 {
 
-	msg_hdr_info msg_info;
 	hello_hdr_info hello_info;
 	link_hdr_info link_info;
 	link_data *link_tuple;
 	neighbor_data *neighbor_tuple;
 
 	bool update_twohop = false;
-	bool twohop_deleted = false;
-	bool new_twohop_added = false;
+	bool twohop_changed = false;
 	bool new_neighbor_added = false;
 	bool mpr_selector_added = false;
-	struct timeval now;
+	bool link_quality_changed = false;
+	bool link_dropped = false;
 	IPAddress neighbor_main_address, originator_address, source_address;
-	click_gettimeofday(&now);
-	msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, 0);
+	olsr_time_t now = olsr_now();
+	click_cycles_t start = click_get_cycles();
+	OLSRMessageView msg(packet, 0);
+	olsr_time_t validity_time = msg.validity_time();
 
-	//click_chatter ("Process HELLO: validity time %d %d",  msg_info.validity_time.tv_sec,msg_info.validity_time.tv_usec);
-	originator_address = msg_info.originator_address;
+	originator_address = msg.originator();
 	//dst_ip_anno must be set, must be source address of ippacket
 	source_address = packet->dst_ip_anno();
 
 	int paint=static_cast<int>(PAINT_ANNO(packet));//packets get marked with paint 0..N depending on Interface they arrive on
 	IPAddress receiving_If_IP=_localIfInfoBase->get_iface_addr(paint); //gets IP of Interface N
+	_stats.count(OLSRMessageStats::RECEIVED, paint, msg.type(), msg.size());
+	//a COMPACT_HELLO is read as the HELLO or LQ_HELLO it stands for
+	if (msg.type() == OLSR_COMPACT_HELLO_MESSAGE)
+	{
+		Packet *expanded = OLSRAddressBlock::expand(packet);
+		if (!expanded)
+		{
+			_stats.count(OLSRMessageStats::DISCARDED, paint, msg.type(), msg.size());
+			_stats.cycles.add(click_get_cycles() - start);
+			packet->kill();
+			return;
+		}
+		packet->kill();
+		packet = expanded;
+		msg = OLSRMessageView(packet, 0);
+	}
 	//7.1.1 - 1
 	link_tuple = _linkInfo->find_link(receiving_If_IP, source_address);
 
 	if (link_tuple == NULL)
 	{
-		link_tuple = _linkInfo->add_link(receiving_If_IP, source_address, (now + msg_info.validity_time));
-		link_tuple->L_SYM_time = now - make_timeval(1,0);
-		link_tuple->L_ASYM_time = now + msg_info.validity_time;
-		link_tuple->_main_addr = originator_address;
-		click_chatter("%s adding link to %s\n", receiving_If_IP.unparse().c_str(), source_address.unparse().c_str());
+		link_tuple = _linkInfo->add_link(receiving_If_IP, source_address, (now + validity_time));
+		link_tuple->L_SYM_time = now - olsr_msec(1000);
+		link_tuple->L_ASYM_time = now + validity_time;
 	}
 	else
 	{
-		link_tuple->L_ASYM_time = now + msg_info.validity_time;
-		if ( _interfaceInfo->get_main_address(link_tuple->L_neigh_iface_addr) == originator_address)
+		link_tuple->L_ASYM_time = now + validity_time;
+		if ( _linkInfo->neighbor_main_address(link_tuple) == originator_address)
 		{ // From RFC 8.2.1
 			if (link_tuple->L_SYM_time >= now)
 				update_twohop = true;
 		}
 	}
 	hello_info = OLSRPacketHandle::get_hello_hdr_info(packet, sizeof(olsr_msg_hdr));
+	int lost = lost_hellos(link_tuple, hello_info, now);
+	if (update_link_quality(link_tuple, lost))
+		link_quality_changed = true;
+	if (_hysteresis && update_hysteresis(link_tuple, lost, now))
+		link_dropped = true;
+	link_tuple->L_last_hello = now;
+	//LQ_HELLO messages follow each address with its link quality
+	bool lq_hello = (msg.type() == OLSR_LQ_HELLO_MESSAGE);
+	int address_size = sizeof(in_addr) + (lq_hello ? sizeof(olsr_lq_info) : 0);
 	//from RFC 8.1
 	neighbor_main_address = originator_address;
-	neighbor_tuple = _neighborInfo->find_neighbor(neighbor_main_address);
+	if (_linkInfo->neighbor_main_address(link_tuple) == neighbor_main_address)
+		neighbor_tuple = _linkInfo->neighbor_tuple(link_tuple);
+	else
+		neighbor_tuple = _neighborInfo->find_neighbor(neighbor_main_address);
 	if (neighbor_tuple == NULL)
 	{
 		neighbor_tuple = _neighborInfo->add_neighbor(neighbor_main_address);
 		neighbor_tuple->N_status = OLSR_NOT_NEIGH;
 	}
+	int old_willingness = neighbor_tuple->N_willingness;
 	neighbor_tuple->N_willingness = hello_info.willingness;
+	int old_status = neighbor_tuple->N_status;
 	//end 8.1
 	// end 7.1.1
-	int link_msg_bytes_left = msg_info.msg_size - sizeof(olsr_msg_hdr) - sizeof(olsr_hello_hdr);
+	int link_msg_bytes_left = msg.size() - sizeof(olsr_msg_hdr) - sizeof(olsr_hello_hdr);
 	int link_msg_offset = sizeof(olsr_msg_hdr) + sizeof(olsr_hello_hdr);
 	int address_offset = link_msg_offset + sizeof(olsr_link_hdr);
 	if (link_msg_bytes_left > 0)
@@ -108,23 +230,27 @@ OLSRProcessHello::push(int, Packet *packet)
 		do
 		{
 			link_info = OLSRPacketHandle::get_link_hdr_info(packet, link_msg_offset);
+			if (link_info.link_msg_size < (int) sizeof(olsr_link_hdr) || link_info.link_msg_size > link_msg_bytes_left)
+				break; //malformed link message
 			int interface_address_bytes_left = link_info.link_msg_size - sizeof(olsr_link_hdr);
 			do
 			{
 				in_addr *address = (in_addr *) (packet->data() + address_offset);
 				IPAddress neighbor_address = IPAddress(*address);
+				IPAddress main_neighbor_address = _interfaceInfo->get_main_address(neighbor_address);
+				const olsr_lq_info *lq_info = lq_hello ? (const olsr_lq_info *) (address + 1) : 0;
 
 				//from RFC 7.1.1 - 2
 				if (neighbor_address == receiving_If_IP)
 				{
 					if (link_info.link_type == OLSR_LOST_LINK)
 					{
-						link_tuple->L_SYM_time = now - make_timeval(1,0);  // == expired
+						link_tuple->L_SYM_time = now - olsr_msec(1000);  // == expired
 					}
-					else if (link_info.link_type == OLSR_SYM_LINK || link_info.link_type == OLSR_ASYM_LINK)
-					{
-						link_tuple->L_SYM_time = now + msg_info.validity_time;
-						link_tuple->L_time = link_tuple->L_SYM_time + _neighbor_hold_time_tv;
+					else if ((link_info.link_type == OLSR_SYM_LINK || link_info.link_type == OLSR_ASYM_LINK) && !link_tuple->L_link_pending)
+					{ //a pending link is not considered, RFC 14.3
+						link_tuple->L_SYM_time = now + validity_time;
+						link_tuple->L_time = link_tuple->L_SYM_time + _neighbor_hold_time;
 					}
 
 					if (link_tuple->L_time < link_tuple->L_ASYM_time)
@@ -132,6 +258,13 @@ OLSRProcessHello::push(int, Packet *packet)
 						link_tuple->L_time = link_tuple->L_ASYM_time;
 					}
 
+					//the neighbor's view of the link from us
+					if (lq_info && lq_info->lq != link_tuple->L_nlq)
+					{
+						link_tuple->L_nlq = lq_info->lq;
+						link_quality_changed = true;
+					}
+
 					//from RFC 8.1
 					if ( link_tuple->L_SYM_time >= now )
 					{
@@ -148,64 +281,91 @@ OLSRProcessHello::push(int, Packet *packet)
 					// end 7.1.1 - 2
 				}
 
-				//from RFC 8.2.1
+				//from RFC 8.2.1, applied below in one batch
 				if(update_twohop && (link_info.neigh_type==OLSR_SYM_NEIGH||link_info.neigh_type==OLSR_MPR_NEIGH))
 				{
 					if ( neighbor_address != _myMainIp )
 					{
-						IPAddress main_neighbor_address = _interfaceInfo->get_main_address(neighbor_address);
-						if (_neighborInfo->find_twohop_neighbor(originator_address, main_neighbor_address) == 0)
-							new_twohop_added = true;
-						_neighborInfo->add_twohop_neighbor(originator_address, main_neighbor_address, (now+msg_info.validity_time));
+						OLSRNeighborInfoBase::TwoHopUpdate update;
+						update.addr = main_neighbor_address;
+						update.cost = lq_info ? olsr_etx(lq_info->lq, lq_info->nlq) : -1;
+						update.remove = false;
+						_twohop_updates.push_back(update);
 					}
 				}
 				else if (update_twohop && link_info.neigh_type == OLSR_NOT_NEIGH)
 				{
-					IPAddress main_neighbor_address = _interfaceInfo->get_main_address(neighbor_address);
-					_neighborInfo->remove_twohop_neighbor(originator_address, main_neighbor_address);
-					twohop_deleted = true; //RFC 8.5
+					OLSRNeighborInfoBase::TwoHopUpdate update;
+					update.addr = main_neighbor_address;
+					update.cost = -1;
+					update.remove = true;
+					_twohop_updates.push_back(update);
 				}	// end 8.2.1
 
 				// from RFC 8.4.1
-				//click_chatter ("main address of neighbor: %s, my Main IP %s\n",_interfaceInfo->get_main_address(neighbor_address).unparse().c_str(),_myMainIp.unparse().c_str());
-				if ( _interfaceInfo->get_main_address(neighbor_address) == _myMainIp )
+				if ( main_neighbor_address == _myMainIp )
 				{
 					if (link_info.neigh_type == OLSR_MPR_NEIGH )
 					{
 						mpr_selector_data *mpr_selector = _neighborInfo->find_mpr_selector(originator_address);
 						if (mpr_selector == 0)
 						{
-							mpr_selector = _neighborInfo->add_mpr_selector(originator_address, (now + msg_info.validity_time));
+							mpr_selector = _neighborInfo->add_mpr_selector(originator_address, (now + validity_time));
 							mpr_selector_added = true;
 						}
 						else
 						{
-							mpr_selector->MS_time = now + msg_info.validity_time;
+							mpr_selector->MS_time = now + validity_time;
 						}
 					}
 				}//end 8.4.1
 
-				interface_address_bytes_left -= sizeof(in_addr);
-				address_offset += sizeof(in_addr);
+				interface_address_bytes_left -= address_size;
+				address_offset += address_size;
 			}
-			while ( interface_address_bytes_left >= (int) sizeof(in_addr) );
+			while ( interface_address_bytes_left >= address_size );
 
 			link_msg_bytes_left -= link_info.link_msg_size;
 			link_msg_offset += link_info.link_msg_size;
 			address_offset += sizeof(olsr_link_hdr);
 		}
-		while (  link_msg_bytes_left >= (int) ( sizeof(olsr_link_hdr) + sizeof(in_addr) )  );
+		while (  link_msg_bytes_left >= (int) sizeof(olsr_link_hdr) + address_size  );
+	}
+
+	if (!_twohop_updates.empty())
+	{
+		OLSRNeighborInfoBase::TwoHopDelta delta = _neighborInfo->update_twohop_neighbors(originator_address, _twohop_updates, now + validity_time);
+		_twohop_updates.clear();
+		twohop_changed = delta.added || delta.removed;
+		if (delta.cost_changed)
+			link_quality_changed = true;
 	}
 
 	//_neighborInfo->print_mpr_selector_set();
+	if ( neighbor_tuple->N_status != old_status )
+		_tcGenerator->notify_advertised_set_changed();
+	if ( neighbor_tuple->N_status != old_status || neighbor_tuple->N_willingness != old_willingness )
+		_neighborInfo->neighbor_tuple_changed();
 	if ( mpr_selector_added )
-		_tcGenerator->notify_mpr_selector_changed();  //this includes incrementing ansn; if activated an additional tc message is sent;
+		_tcGenerator->notify_mpr_selector_changed();  //the ansn follows; if activated an additional tc message is sent;
 	// in a strictly RFC interpretation this should only be done if change is based on link failure
-	if (twohop_deleted || new_twohop_added || new_neighbor_added)
+	if (new_neighbor_added || link_dropped)
 	{
-		_neighborInfo->compute_mprset();
-		_routingTable->compute_routing_table();
+		_neighborInfo->schedule_compute_mprset();
+		_routingTable->schedule_compute_routing_table(OLSRRoutingTable::EVENT_HELLO);
+	}
+	else if (twohop_changed)
+	{ //the routing table has repaired its routes already, and with
+		//INCREMENTAL_MPR the MPR computation returns early if no coverage changed
+		_neighborInfo->schedule_compute_mprset();
+		_routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_HELLO);
+	}
+	else if (_link_quality && link_quality_changed)
+	{ //link qualities are advertised in TC messages and weigh the routes
+		_tcGenerator->notify_advertised_set_changed();
+		_routingTable->schedule_compute_routing_table(OLSRRoutingTable::EVENT_HELLO);
 	}
+	_stats.cycles.add(click_get_cycles() - start);
 	output(0).push(packet);
 }
 
@@ -214,8 +374,8 @@ OLSRProcessHello::push(int, Packet *packet)
 void
 OLSRProcessHello::set_neighbor_hold_time_tv(int neighbor_hold_time)
 {
-	_neighbor_hold_time_tv=make_timeval ((int) (neighbor_hold_time / 1000),(neighbor_hold_time % 1000));;
-	click_chatter ("_neighbor_hold_time_tv = %d %d\n", _neighbor_hold_time_tv.tv_sec,  _neighbor_hold_time_tv.tv_usec);
+	_neighbor_hold_time = olsr_msec(neighbor_hold_time);
+	click_chatter ("_neighbor_hold_time = %s\n", olsr_timestamp(_neighbor_hold_time).unparse().c_str());
 }
 
 int
@@ -234,6 +394,7 @@ void
 OLSRProcessHello::add_handlers()
 {
 	add_write_handler("set_neighbor_hold_time_tv", set_neighbor_hold_time_tv_handler, (void *)0);
+	_stats.add_handlers(this);
 }
 /// == !mvhaen ===================================================================================================
 
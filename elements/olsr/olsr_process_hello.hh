@@ -14,6 +14,20 @@
  
   =d
   Gets OLSR Hello messages on input port. The incoming packets need to have their destionation address annotation set to the 1-hop source address of the message. Packets are parsed, and information is stored in the OLSRLinkInfoBase and OLSRNeighborInfoBase elements given as arguments. If the processing of the packet leads to the adding of an MPR Selector in the OLSRNeighborInfoBase element, the Advertise Neighbor Sequence Number (ANSN) in the OLSRTCGenerator element is updated. If a neighbor or 2-hop neighbor node is added in the OLSRNeighborInfoBase element, an MPR calculation is triggered in the OLSRNeighborInfobase element, and a routing table update is triggered in the OLSRRoutingTable element.
+
+  Every HELLO received also updates the quality of its link, a moving average over the last LQ_WINDOW (default 10) HELLOs of the share that got through; the ones lost in between are estimated from the time since the previous HELLO and its HTIME. LQ_HELLO messages additionally report the neighbor's measure of the link from this node, and of the links to its own neighbors, see OLSRHelloGenerator. With LINK_QUALITY true, a change of these values triggers a new TC message and a full routing table computation.
+
+  COMPACT_HELLO messages (see OLSRHelloGenerator) are expanded into the HELLO or LQ_HELLO layout before they are read, and the expanded copy goes to the output. A malformed one is discarded.
+
+  With HYSTERESIS true, links go through the hysteresis of RFC 3626 section 14: a second quality, which halves with every HELLO lost and moves halfway to 1 with every HELLO received, must rise above 0.8 before a new link is used, and a link whose quality falls below 0.3 is advertised as lost and not used until it rises above 0.8 again. A link with occasional losses so stays up, or down, instead of flapping and triggering MPR and routing table computations. Both qualities are kept in integer fixed point, and the HELLOs lost since the previous one cost one shift, not one step each. Default is false.
+ 
+  =h stats read-only
+  Messages and bytes received, per interface (paint annotation), and the
+  cycles spent per message, not counting the elements downstream. See
+  OLSRForward for the format.
+
+  =h clear_stats write-only
+  Resets the counters.
  
   =a
   OLSRProcessTC, OLSRProcessMID, OLSRClassifier, OLSRForward
@@ -26,6 +40,7 @@
 #include "olsr_link_infobase.hh"
 #include "olsr_neighbor_infobase.hh"
 #include "olsr_interface_infobase.hh"
+#include "olsr_msg_stats.hh"
 #include "olsr_tc_generator.hh"
 #include "olsr_rtable.hh"
 #include "olsr_packethandle.hh"
@@ -80,13 +95,21 @@ public:
 	void push(int, Packet *);
 	
 	void add_handlers();
+
+	void set_neighbor_hold_time_tv(int neighbor_hold_time);
 	
 private:
-	void set_neighbor_hold_time_tv(int neighbor_hold_time);
+	int lost_hellos(const link_data *link, const hello_hdr_info &hello_info, olsr_time_t now) const;
+	bool update_link_quality(link_data *link, int lost);
+	bool update_hysteresis(link_data *link, int lost, olsr_time_t now);
+	bool _link_quality;
+	int _lq_window;
+	bool _hysteresis;
+	Vector<OLSRNeighborInfoBase::TwoHopUpdate> _twohop_updates;	//of the HELLO being processed, kept for its capacity
 
 	static int set_neighbor_hold_time_tv_handler(const String &conf, Element *e, void *, ErrorHandler * errh);
 	
-	struct timeval _neighbor_hold_time_tv;
+	olsr_time_t _neighbor_hold_time;
 	OLSRLinkInfoBase *_linkInfo;
 	OLSRNeighborInfoBase *_neighborInfo;
 	OLSRInterfaceInfoBase *_interfaceInfo;
@@ -94,6 +117,7 @@ private:
 	OLSRTCGenerator *_tcGenerator;
 	OLSRLocalIfInfoBase *_localIfInfoBase;
 	IPAddress _myMainIp;
+	OLSRMessageStats _stats;
 };
 
 CLICK_ENDDECLS
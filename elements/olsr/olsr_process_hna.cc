@@ -33,6 +33,7 @@
 #include <click/confparse.hh>
 #include <click/error.hh>
 #include <click/ipaddress.hh>
+#include <click/packet_anno.hh>
 #include "click_olsr.hh"
 #include "olsr_neighbor_infobase.hh"
 #include "olsr_process_hna.hh"
@@ -65,20 +66,23 @@ OLSRProcessHNA::configure(Vector<String> &conf, ErrorHandler *errh)
 void
 OLSRProcessHNA::push(int, Packet *packet){
   //click_chatter ("OLSR_process_HNA::push \n");
-  msg_hdr_info msg_info;
   neighbor_data *neighbor_tuple;
   association_data *association_tuple;
 
   bool update_hna = false;
   bool new_hna_added = false;
-  struct timeval now;
+  olsr_time_t now;
   IPAddress network_address, originator_address, source_address, netmask;
   in_addr * addr;
 
-  click_gettimeofday(&now);
+  now = olsr_now();
+  click_cycles_t start = click_get_cycles();
 
-  msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, 0);
-  originator_address = msg_info.originator_address;
+  OLSRMessageView msg(packet, 0);
+  olsr_time_t validity_time = msg.validity_time();
+  originator_address = msg.originator();
+  int paint = static_cast<int>(PAINT_ANNO(packet));
+  _stats.count(OLSRMessageStats::RECEIVED, paint, msg.type(), msg.size());
 
   //dst_ip_anno must be set, must be source address of ippacket
   source_address = packet->dst_ip_anno();
@@ -86,11 +90,24 @@ OLSRProcessHNA::push(int, Packet *packet){
   /// 12.5.1 if sender interface not in symmetric 1-hop neighborhood the message is discarded
   neighbor_tuple = _neighborInfo->find_neighbor(source_address);
   if (neighbor_tuple == 0 || neighbor_tuple->N_status == OLSR_NOT_NEIGH) {
+	_stats.count(OLSRMessageStats::DISCARDED, paint, msg.type(), msg.size());
+	_stats.cycles.add(click_get_cycles() - start);
 	packet->kill();
 	return;
   }
 
-  int msg_bytes_left = msg_info.msg_size - sizeof(olsr_msg_hdr);
+  if (msg.type() == OLSR_GATEWAY_LOAD_MESSAGE){
+    if (msg.body_length() >= (int) sizeof(olsr_gateway_load)){
+      const olsr_gateway_load *gl = (const olsr_gateway_load *) msg.body();
+      if (_associationInfo->set_gateway_load(originator_address, ntohl(gl->capacity), ntohl(gl->load), now + validity_time))
+	_routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_HNA);
+    }
+    _stats.cycles.add(click_get_cycles() - start);
+    output(0).push(packet);
+    return;
+  }
+
+  int msg_bytes_left = msg.size() - sizeof(olsr_msg_hdr);
   int msg_offset = sizeof(olsr_msg_hdr);
 
   click_chatter("%f | %s | received a HNA message from %s", Timestamp(now).doubleval(), _my_ip.unparse().c_str(), originator_address.unparse().c_str());
@@ -107,10 +124,10 @@ OLSRProcessHNA::push(int, Packet *packet){
 
       association_tuple = _associationInfo->find_tuple(originator_address, network_address, netmask);
       if (association_tuple != 0) {
-        association_tuple->A_time = now + msg_info.validity_time;
+        association_tuple->A_time = now + validity_time;
 	update_hna = true;
       } else {
-	_associationInfo->add_tuple(originator_address, network_address, netmask, (now + msg_info.validity_time));
+	_associationInfo->add_tuple(originator_address, network_address, netmask, (now + validity_time));
 	new_hna_added = true;
       }
 
@@ -121,15 +138,20 @@ OLSRProcessHNA::push(int, Packet *packet){
 
   _associationInfo->print_association_set();
 
-  if (new_hna_added || update_hna){
-    //click_chatter("Recomputing Routing Table\n");
-    _routingTable->compute_routing_table();
-    //click_chatter("Routing table recomputed");
-    click_chatter("%f | %s | Routing Table:\n",Timestamp(now).doubleval(), _my_ip.unparse().c_str());
-    _routingTable->print_routing_table();
-  }
+  // the table is recomputed later, so printing it here would show the
+  // old routes; read the routes handler of the routing table instead
+  if (new_hna_added || update_hna)
+    _routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_HNA);
+  _stats.cycles.add(click_get_cycles() - start);
   output(0).push(packet);
 }
+
+
+void
+OLSRProcessHNA::add_handlers()
+{
+  _stats.add_handlers(this);
+}
  
 
 CLICK_ENDDECLS
@@ -14,6 +14,19 @@
   =d
   Gets OLSR Hello messages on input port. The incoming packets need to have their destionation address annotation set to the 1-hop source address of the message. Packets are parsed, and information is stored in the OLSRLinkInfoBase and OLSRNeighborInfoBase elements given as arguments. If the processing of the packet leads to the adding of an MPR Selector in the OLSRNeighborInfoBase element, the Advertise Neighbor Sequence Number (ANSN) in the OLSRTCGenerator element is updated. If a neighbor or 2-hop neighbor node is added in the OLSRNeighborInfoBase element, an MPR calculation is triggered in the OLSRNeighborInfobase element, and a routing table update is triggered in the OLSRRoutingTable element.
 
+  GATEWAY_LOAD messages, which the OLSRClassifier sends here with the HNA
+  messages, record the originator's advertised uplink capacity and load in
+  the OLSRAssociationInfoBase element; a changed load triggers a routing
+  table update as well.
+
+  =h stats read-only
+  Messages and bytes received and discarded, per interface (paint
+  annotation), and the cycles spent per message, not counting the elements
+  downstream. See OLSRForward for the format.
+
+  =h clear_stats write-only
+  Resets the counters.
+
   =a
   OLSRProcessTC, OLSRProcessMID, OLSRClassifier, OLSRForward
 
@@ -26,6 +39,7 @@
 #include "olsr_rtable.hh"
 #include "olsr_packethandle.hh"
 #include "click_olsr.hh"
+#include "olsr_msg_stats.hh"
 
 
 CLICK_DECLS
@@ -70,12 +84,14 @@ public:
   //  int initialize(ErrorHandler *);
   //  void uninitialize();
   void push(int, Packet *);
+  void add_handlers();
 
 private:
   OLSRAssociationInfoBase *_associationInfo;
   OLSRNeighborInfoBase *_neighborInfo;
   OLSRRoutingTable *_routingTable;
   IPAddress _my_ip;
+  OLSRMessageStats _stats;
 };
 
 CLICK_ENDDECLS
@@ -3,6 +3,7 @@
 #include <click/config.h>
 #include <click/ipaddress.hh>
 #include <click/confparse.hh>
+#include <click/packet_anno.hh>
 #include "olsr_process_mid.hh"
 #include "olsr_packethandle.hh"
 #include "click_olsr.hh"
@@ -38,45 +39,41 @@ OLSRProcessMID::configure(Vector<String> &conf, ErrorHandler *errh)
 void
 OLSRProcessMID::push(int, Packet *packet){
  
-  bool interface_changed = false;
-  msg_hdr_info msg_info;
-  interface_data* data;
   int mid_msg_offset, bytes_left;
-  struct timeval now;
+  olsr_time_t now = olsr_now();
 
-  click_gettimeofday(&now);
-  msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, 0);
+  click_cycles_t start = click_get_cycles();
+  OLSRMessageView msg(packet, 0);
+  olsr_time_t validity_time = msg.validity_time();
+  _stats.count(OLSRMessageStats::RECEIVED, static_cast<int>(PAINT_ANNO(packet)), msg.type(), msg.size());
 
   mid_msg_offset = sizeof(olsr_msg_hdr);
-  bytes_left = msg_info.msg_size - sizeof(olsr_msg_hdr);
+  bytes_left = msg.size() - sizeof(olsr_msg_hdr);
 
-  do{
+  //all aliases go to the interface set at once, which tells the routing
+  //table only about originators whose aliases changed
+  _aliases.clear();
+  while ( bytes_left >= (int) sizeof(in_addr) ){
     in_addr *address = (in_addr *) (packet->data() + mid_msg_offset);
-    IPAddress interface_address = IPAddress(*address);
-    data = _interfaceInfo->find_interface(interface_address);
-    
-    if ( data == 0 ){
-      _interfaceInfo->add_interface(interface_address, msg_info.originator_address, now + msg_info.validity_time);
-//      click_chatter("adding new interface: %s\n", interface_address.unparse().cc()); 
-      interface_changed = true;
-    }
-    else{
-//      click_chatter("found interface %s, updating\n", interface_address.unparse().cc());
-      _interfaceInfo->update_interface(interface_address, now + msg_info.validity_time);
-    }
+    _aliases.push_back(IPAddress(*address));
     bytes_left -= sizeof(in_addr);
     mid_msg_offset += sizeof(in_addr);
-  }while ( bytes_left >= (int) sizeof(in_addr) );
-
-  //_interfaceInfo->print_interfaces();
-  if (interface_changed)
-  { //_interfaceInfo->print_interfaces();
-    _routingTable->compute_routing_table();
   }
+
+  if (_interfaceInfo->upsert_interfaces(msg.originator(), _aliases, now + validity_time))
+    _routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_MID);
+  _stats.cycles.add(click_get_cycles() - start);
   output(0).push(packet);
 }
 
 
+void
+OLSRProcessMID::add_handlers()
+{
+  _stats.add_handlers(this);
+}
+
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(OLSRProcessMID);
 
@@ -15,6 +15,14 @@
   =d
   Gets OLSR MID messages on input port. Packets are parsed, and information is stored in the OLSRInterfaceInfoBase element given as argument. If the processing of the packet leads to a change in the OLSRInterfacInfoBase, a routing table update is triggered in the OLSRRoutingTable element.
 
+  =h stats read-only
+  Messages and bytes received and discarded, per interface (paint
+  annotation), and the cycles spent per message, not counting the elements
+  downstream. See OLSRForward for the format.
+
+  =h clear_stats write-only
+  Resets the counters.
+
   =a
   OLSRProcessTC, OLSRProcessHello, OLSRClassifier, OLSRForward
 
@@ -27,6 +35,7 @@
 #include "olsr_interface_infobase.hh"
 #include "olsr_packethandle.hh"
 #include "click_olsr.hh"
+#include "olsr_msg_stats.hh"
 
 CLICK_DECLS
 
@@ -46,11 +55,14 @@ public:
   //  int initialize(ErrorHandler *);  
   //  void uninitialize();
   void push(int, Packet *);
+  void add_handlers();
 
 private:
 
   OLSRInterfaceInfoBase *_interfaceInfo;
   OLSRRoutingTable *_routingTable;
+  OLSRMessageStats _stats;
+  Vector<IPAddress> _aliases;	// of the message at hand, kept for its storage
 
 };
 
@@ -4,14 +4,17 @@
 #include <click/confparse.hh>
 #include <click/error.hh>
 #include <click/ipaddress.hh>
+#include <click/packet_anno.hh>
 #include "click_olsr.hh"
 #include "olsr_process_tc.hh"
 #include "olsr_topology_infobase.hh"
+#include "olsr_address_block.hh"
 
 
 CLICK_DECLS
 
 OLSRProcessTC::OLSRProcessTC()
+  : _localIfaces(0)
 {
 }
 
@@ -29,11 +32,25 @@ OLSRProcessTC::configure(Vector<String> &conf, ErrorHandler *errh)
 		  cpElement, "InterfaceInfoBase Element", &_interfaceInfo,
 		  cpElement, "Routing Table Element", &_routingTable,
 		  cpIPAddress, "my main IP", &_myMainIP,
+		  cpKeywords,
+		  "LOCAL_IFACES", cpElement, "LocalIfInfoBase Element", &_localIfaces,
 		  0) < 0)
     return -1;
   return 0;
 }
 
+
+int
+OLSRProcessTC::initialize(ErrorHandler *errh)
+{
+  _localAddresses.add(_myMainIP);
+  if (_localIfaces)
+    for (int i = 0; i < _localIfaces->get_number_ifaces(); i++)
+      if (!_localAddresses.add(_localIfaces->get_iface_addr(i)))
+	return errh->error("more than %d local interfaces", (int) OLSRLocalAddressSet::MAX_ADDRESSES);
+  return 0;
+}
+
 //output 0 - Packets that are to be forwarded
 //output 1 - Discard
 
@@ -41,19 +58,18 @@ void
 OLSRProcessTC::push(int, Packet *packet)
 {
 
-  bool topology_tuple_added = false;
-  bool topology_tuple_removed = false;
-  msg_hdr_info msg_info;
   tc_hdr_info tc_info;
   int ansn;
-  topology_data *topology_tuple;
   IPAddress originator_address;
-  struct timeval now;
-  click_gettimeofday(&now);
+  olsr_time_t now = olsr_now();
+  click_cycles_t start = click_get_cycles();
   
-  msg_info = OLSRPacketHandle::get_msg_hdr_info(packet, 0);
+  OLSRMessageView msg(packet, 0);
+  olsr_time_t validity_time = msg.validity_time();
+  int paint = static_cast<int>(PAINT_ANNO(packet));
+  _stats.count(OLSRMessageStats::RECEIVED, paint, msg.type(), msg.size());
   tc_info = OLSRPacketHandle::get_tc_hdr_info(packet, (int) sizeof(olsr_msg_hdr));
-  originator_address = msg_info.originator_address;
+  originator_address = msg.originator();
   ansn = tc_info.ansn;
   //click_chatter ("node %s Processing TC message with ansn %d from originator address %s\n",_myMainIP.unparse().cc(),ansn,originator_address.unparse().cc());
   //_topologyInfo->print_topology();
@@ -63,56 +79,81 @@ OLSRProcessTC::push(int, Packet *packet)
   IPAddress src_addr = packet->dst_ip_anno();
   if ( _neighborInfo->find_neighbor(_interfaceInfo->get_main_address( src_addr)) == 0 ){
     //click_chatter("Discarded TC message, not from 1-hop neighbor (src address: %s)\n",src_addr.unparse().cc());
+    _stats.count(OLSRMessageStats::DISCARDED, paint, msg.type(), msg.size());
+    _stats.cycles.add(click_get_cycles() - start);
     output(1).push(packet);
     return;
   }
   //RFC 9.5 step 2 - discard message received out of order
   if ( _topologyInfo->newer_tuple_exists(originator_address, (int) ansn) ){
    //click_chatter("Discarded TC message, received out of order\n");
+    _stats.count(OLSRMessageStats::DISCARDED, paint, msg.type(), msg.size());
+    _stats.cycles.add(click_get_cycles() - start);
     output(1).push(packet);
     return;
   }
-  //step 3 - delete outdated topology tuples
-  if ( _topologyInfo->remove_outdated_tuples(originator_address, (int) ansn) ){
-    //click_chatter("topology_tuple_removed\n");
-    topology_tuple_removed = true;
-  }  
-
-  //step 4 - record topology tuple
-  int remaining_neigh_bytes = msg_info.msg_size - (int)sizeof(olsr_msg_hdr) - (int)sizeof(olsr_tc_hdr);
+  //steps 3 and 4 - replace the outdated topology tuples and record the new
+  //ones, at once below
+  //a COMPACT_TC is read as the TC or LQ_TC it stands for, and forwarded as is
+  Packet *view = packet;
+  if (msg.type() == OLSR_COMPACT_TC_MESSAGE){
+    if (!(view = OLSRAddressBlock::expand(packet))){
+      _stats.count(OLSRMessageStats::DISCARDED, paint, msg.type(), msg.size());
+      _stats.cycles.add(click_get_cycles() - start);
+      output(1).push(packet);
+      return;
+    }
+    msg = OLSRMessageView(view, 0);
+  }
+  int remaining_neigh_bytes = msg.size() - (int)sizeof(olsr_msg_hdr) - (int)sizeof(olsr_tc_hdr);
   int neigh_addr_offset = sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr);
+  //LQ_TC messages follow each address with the quality of the link to it
+  bool lq_tc = (msg.type() == OLSR_LQ_TC_MESSAGE);
+  int address_size = sizeof(in_addr) + (lq_tc ? sizeof(olsr_lq_info) : 0);
   
-  while ( remaining_neigh_bytes >= (int) sizeof(in_addr) ){
-    in_addr *address = (in_addr *) (packet->data() + neigh_addr_offset);
+  //dont record entries for myself or my neighbors
+  int naddresses = remaining_neigh_bytes >= address_size ? remaining_neigh_bytes / address_size : 0;
+  _kept.clear();
+  _dests.clear();
+  _costs.clear();
+  _localAddresses.scan(view->data() + neigh_addr_offset, naddresses, address_size, _kept);
+  for (int i = 0; i < _kept.size(); i++){
+    in_addr *address = (in_addr *) (view->data() + neigh_addr_offset + _kept[i] * address_size);
     IPAddress dest_addr = IPAddress(*address);
-    if (dest_addr != _myMainIP && _neighborInfo->find_neighbor(dest_addr) == 0){
-      //dont record entries for myself or my neighbors
-      topology_tuple = _topologyInfo->find_tuple(dest_addr, originator_address);
-      if ( topology_tuple == 0 ){
-	topology_tuple = _topologyInfo->add_tuple(dest_addr, originator_address, (now+msg_info.validity_time));
-	topology_tuple->T_seq = ansn;
-	//click_chatter("topology tuple added\n");
-	topology_tuple_added = true;
-      }
-      else{
-	topology_tuple->T_time = now + msg_info.validity_time;
-	//click_chatter ("topology tuple updates\n");
-      }
+    const olsr_lq_info *lq_info = (const olsr_lq_info *) (address + 1);
+    if (_neighborInfo->find_neighbor(dest_addr) == 0){
+      _dests.push_back(dest_addr);
+      if (lq_tc)
+	_costs.push_back(olsr_etx(lq_info->lq, lq_info->nlq));
     }
-    remaining_neigh_bytes -= sizeof(in_addr);
-    neigh_addr_offset += sizeof(in_addr);
   }
-  if ( topology_tuple_added || topology_tuple_removed ){
+  if (view != packet)
+    view->kill();
+  OLSRTopologyInfoBase::Diff diff;
+  _topologyInfo->update_tuples(originator_address, ansn, _dests, lq_tc ? &_costs : 0, now + validity_time, diff);
+  if ( diff.cost_changed ){
+    //weights are not repaired incrementally
+    _routingTable->schedule_compute_routing_table(OLSRRoutingTable::EVENT_TC);
+  }
+  else if ( diff.added || diff.removed ){
     //click_chatter("recomputing routing table");
-    _routingTable->compute_routing_table();
+    _routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_TC);
     //_routingTable->print_routing_table();
   }
 
+  _stats.cycles.add(click_get_cycles() - start);
   output(0).push(packet);
   //_topologyInfo->print_topology();
 }
 
 
+void
+OLSRProcessTC::add_handlers()
+{
+  _stats.add_handlers(this);
+}
+
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(OLSRProcessTC);
 
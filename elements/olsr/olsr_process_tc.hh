@@ -4,7 +4,7 @@
   Processes OLSR TC messages, storing information in the OLSRInterfaceInfoBase, triggering routing table update if necessary
 
   =s
-  OLSRProcessTC(OLSRTopologyInfoBase Element, OLSRNeighborInfoBase Element,  OLSRRoutingTable Element)
+  OLSRProcessTC(OLSRTopologyInfoBase Element, OLSRNeighborInfoBase Element,  OLSRRoutingTable Element [, LOCAL_IFACES])
 
   =io
   One input, two outputs, discarded messages are output on port 1, all other on port 0
@@ -15,6 +15,18 @@
   =d
   Gets OLSR TC messages on input port. Packets are parsed, and information is stored in the OLSRTopologyInfoBase element given as argument. If the processing of the packet leads to a change in the OLSRTopologyInfoBase, a routing table update is triggered in the OLSRRoutingTable element.
 
+  No topology tuples are recorded for this node or its neighbors. The advertised addresses are first checked against the main address and, if the OLSRLocalIfInfoBase LOCAL_IFACES is given, the addresses of all local interfaces in one pass over the message; only the others are looked up in the neighbor set.
+
+  COMPACT_TC messages (see OLSRTCGenerator) are expanded into a scratch copy in the TC or LQ_TC layout and read from there; the message itself goes on to be forwarded unchanged. A malformed one is discarded.
+
+  =h stats read-only
+  Messages and bytes received and discarded, per interface (paint
+  annotation), and the cycles spent per message, not counting the elements
+  downstream. See OLSRForward for the format.
+
+  =h clear_stats write-only
+  Resets the counters.
+
   =a
   OLSRProcessMID, OLSRProcessHello, OLSRClassifier, OLSRForward
 
@@ -30,6 +42,9 @@
 #include "olsr_rtable.hh"
 #include "olsr_interface_infobase.hh"
 #include "click_olsr.hh"
+#include "olsr_msg_stats.hh"
+#include "olsr_local_if_infobase.hh"
+#include "olsr_address_list.hh"
 
 
 CLICK_DECLS
@@ -51,7 +66,9 @@ public:
   const char *port_count() const  { return "1/2"; }
   
   int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
   void push(int, Packet *);
+  void add_handlers();
   
 private:
   
@@ -60,6 +77,12 @@ private:
   OLSRRoutingTable *_routingTable;
   OLSRInterfaceInfoBase *_interfaceInfo;
   IPAddress _myMainIP;
+  OLSRLocalIfInfoBase *_localIfaces;
+  OLSRLocalAddressSet _localAddresses;
+  Vector<int> _kept;		//of the message being processed, kept for its capacity
+  Vector<IPAddress> _dests;	//likewise
+  Vector<int> _costs;
+  OLSRMessageStats _stats;
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,55 @@
+#ifndef OLSR_PROFILE_HH
+#define OLSR_PROFILE_HH
+
+#include <click/glue.hh>
+#include <click/straccum.hh>
+
+CLICK_DECLS
+
+// Cycle counts of one phase of a computation: the number of runs, their
+// total and maximum, and a histogram of the runs by powers of two, the
+// first bucket holding those below 2^FIRST_SHIFT cycles and the last those
+// of 2^(FIRST_SHIFT + NBUCKETS - 2) cycles and more.
+class OLSRPhaseProfile{
+public:
+
+  enum { NBUCKETS = 16, FIRST_SHIFT = 10 };
+
+  OLSRPhaseProfile()		{ clear(); }
+
+  void clear() {
+    count = 0;
+    total = max = 0;
+    for (int i = 0; i < NBUCKETS; i++)
+      histogram[i] = 0;
+  }
+
+  void add(click_cycles_t cycles) {
+    count++;
+    total += cycles;
+    if (cycles > max)
+      max = cycles;
+    int bucket = 0;
+    for (click_cycles_t c = cycles >> FIRST_SHIFT; c && bucket < NBUCKETS - 1; c >>= 1)
+      bucket++;
+    histogram[bucket]++;
+  }
+
+  // one line: name, count, total, max, average and the histogram
+  void unparse(StringAccum &sa, const char *name) const {
+    sa << name << " count " << count << " total " << total << " max " << max
+       << " avg " << (count ? total / count : 0) << " hist";
+    for (int i = 0; i < NBUCKETS; i++)
+      sa << ' ' << histogram[i];
+    sa << '\n';
+  }
+
+  uint32_t count;
+  click_cycles_t total;
+  click_cycles_t max;
+  uint32_t histogram[NBUCKETS];
+
+};
+
+CLICK_ENDDECLS
+#endif
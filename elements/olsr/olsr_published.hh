@@ -0,0 +1,90 @@
+#ifndef OLSR_PUBLISHED_HH
+#define OLSR_PUBLISHED_HH
+
+#include <click/glue.hh>
+#include <click/atomic.hh>
+#include <click/sync.hh>
+
+CLICK_DECLS
+
+// An immutable copy of some state, which its owner replaces as a whole on
+// its own thread and others read from any thread: handlers, monitoring and
+// elements that only follow the state. publish() hands over a new copy; get()
+// returns a Ref to the current one, which stays valid, and unchanged, for
+// as long as the Ref lives, however many copies are published meanwhile.
+// The last Ref to a replaced copy frees it. Only taking and dropping a
+// reference is atomic; reading a copy takes no lock.
+template <class T>
+class OLSRPublished{
+
+  struct Holder {
+    T *value;
+    atomic_uint32_t refcount;
+  };
+
+  static void release(Holder *h) {
+    if (h && h->refcount.dec_and_test()) {
+      delete h->value;
+      delete h;
+    }
+  }
+
+public:
+
+  class Ref { public:
+    Ref() : _h(0)			{ }
+    Ref(const Ref &r) : _h(r._h)	{ if (_h) _h->refcount++; }
+    ~Ref()				{ release(_h); }
+    Ref &operator=(const Ref &r) {
+      if (r._h)
+	r._h->refcount++;
+      release(_h);
+      _h = r._h;
+      return *this;
+    }
+
+    // null before the first publish()
+    const T *get() const		{ return _h ? _h->value : 0; }
+    const T *operator->() const		{ return _h->value; }
+    const T &operator*() const		{ return *_h->value; }
+    operator bool() const		{ return _h != 0; }
+
+  private:
+    Holder *_h;
+    explicit Ref(Holder *h) : _h(h)	{ }
+    friend class OLSRPublished<T>;
+  };
+
+  OLSRPublished() : _current(0)		{ }
+  ~OLSRPublished()			{ release(_current); }
+
+  // takes over value, which must not be changed from now on
+  void publish(T *value) {
+    Holder *h = new Holder;
+    h->value = value;
+    h->refcount = 1;			// held by _current
+    _lock.acquire();
+    Holder *old = _current;
+    _current = h;
+    _lock.release();
+    release(old);
+  }
+
+  Ref get() const {
+    _lock.acquire();
+    Holder *h = _current;
+    if (h)
+      h->refcount++;
+    _lock.release();
+    return Ref(h);
+  }
+
+private:
+
+  Holder *_current;
+  mutable Spinlock _lock;	// so a reader's reference beats the release
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,356 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * olsr_radixiplookup.{cc,hh} -- radix trie IP lookup that keeps the full
+ * routes for the OLSR route computation and publishes new tables with a
+ * pointer swap
+ */
+
+#include <click/config.h>
+#include <click/ipaddress.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/master.hh>
+#include <click/routerthread.hh>
+#include "olsr_radixiplookup.hh"
+CLICK_DECLS
+
+OLSRRadixIPLookup::Table::Table(const RouteSet &r)
+    : routes(r), version(0), default_key(-1), radix(RadixIPLookup::Radix::make_radix(24, 256))
+{
+    for (int i = 0; i <= 32; i++)
+	prefix_count[i] = 0;
+
+    for (RouteSet::const_iterator iter = routes.begin(); iter != routes.end(); iter++) {
+	int key = v.size();
+	v.push_back(iter.value());
+	prefix_count[iter.value().prefix_len()]++;
+	uint32_t hmask = ntohl(iter.value().mask.addr());
+	if (hmask)
+	    (void) radix->change(ntohl(iter.value().addr.addr()), ~hmask + 1, key, hmask);
+	else
+	    default_key = key;
+    }
+}
+
+OLSRRadixIPLookup::Table::~Table()
+{
+    RadixIPLookup::Radix::free_radix(radix);
+}
+
+const IPRoute *
+OLSRRadixIPLookup::Table::lookup_iproute(const IPAddress& dst) const
+{
+    for (int len = 32; len >= 0; len--)
+	if (prefix_count[len]) {
+	    IPAddress mask = IPAddress::make_prefix(len);
+	    if (const IPRoute *route = routes.findp(IPPair(dst & mask, mask)))
+		return route;
+	}
+    return 0;
+}
+
+
+OLSRRadixIPLookup::OLSRRadixIPLookup()
+    : _current(new Table(RouteSet())), _miss_handler(0), _adjacency_count(0), _timer(this)
+{
+}
+
+OLSRRadixIPLookup::~OLSRRadixIPLookup()
+{
+}
+
+void *
+OLSRRadixIPLookup::cast(const char *name)
+{
+    if (strcmp(name, "OLSRRadixIPLookup") == 0)
+	return (void *)this;
+    else
+	return IPRouteTable::cast(name);
+}
+
+int
+OLSRRadixIPLookup::initialize(ErrorHandler *)
+{
+    _timer.initialize(this);
+    return 0;
+}
+
+void
+OLSRRadixIPLookup::cleanup(CleanupStage)
+{
+    for (int i = 0; i < _retired.size(); i++)
+	delete _retired[i];
+    _retired.clear();
+    delete _current;
+    _current = 0;
+}
+
+/**
+ * installs a new table built from routes. Readers see either the old or
+ * the new table, never a partial one.
+ */
+void
+OLSRRadixIPLookup::publish(const RouteSet &routes)
+{
+    Table *t = new Table(routes);
+    for (int key = 0; key < t->v.size(); key++)
+	t->adjacency.push_back(adjacency(t->v[key]));
+    Table *old = _current;
+    t->version = old->version + 1;
+    click_write_fence();	// table complete before it is visible
+    _current = t;
+    retire(old);
+    reclaim();
+}
+
+/**
+ * returns the adjacency number of route's gateway and port, handing out the
+ * next free one for a new pair. Numbers are never reused: the pairs seen are
+ * the node's neighbor interfaces, a small set.
+ */
+int
+OLSRRadixIPLookup::adjacency(const IPRoute &route)
+{
+    if (!route.gw || route.port < 0)
+	return -1;
+    if (route.port >= _adjacency_ids.size())
+	_adjacency_ids.resize(route.port + 1);
+    int *id = _adjacency_ids[route.port].findp(route.gw);
+    if (!id) {
+	_adjacency_ids[route.port].insert(route.gw, _adjacency_count++);
+	id = _adjacency_ids[route.port].findp(route.gw);
+    }
+    return *id;
+}
+
+void
+OLSRRadixIPLookup::retire(Table *t)
+{
+    if (!_timer.initialized()) {
+	// still configuring; nobody can be looking at the old table
+	delete t;
+	return;
+    }
+
+    Master *m = master();
+    for (int i = 0; i < m->nthreads(); i++)
+	t->retire_epochs.push_back(m->thread(i)->driver_epoch());
+
+    _retired_lock.acquire();
+    _retired.push_back(t);
+    _retired_lock.release();
+    if (!_timer.scheduled())
+	_timer.schedule_after_msec(100);
+}
+
+/**
+ * frees the replaced tables that no RouterThread can still be reading: each
+ * thread has left the driver loop iteration it was in when the table was
+ * replaced
+ */
+void
+OLSRRadixIPLookup::reclaim()
+{
+    Master *m = master();
+    _retired_lock.acquire();
+    int n = 0;
+    for (int i = 0; i < _retired.size(); i++) {
+	Table *t = _retired[i];
+	bool quiescent = true;
+	for (int j = 0; j < t->retire_epochs.size() && quiescent; j++)
+	    if (m->thread(j)->driver_epoch() == t->retire_epochs[j])
+		quiescent = false;
+	if (quiescent)
+	    delete t;
+	else
+	    _retired[n++] = t;
+    }
+    _retired.resize(n);
+    _retired_lock.release();
+}
+
+void
+OLSRRadixIPLookup::run_timer(Timer *)
+{
+    reclaim();
+    _retired_lock.acquire();
+    bool more = _retired.size();
+    _retired_lock.release();
+    if (more)
+	_timer.schedule_after_msec(100);
+}
+
+int
+OLSRRadixIPLookup::add_route(const IPRoute& route, bool set, IPRoute* old_route, ErrorHandler *errh)
+{
+    if (route.prefix_len() < 0) {
+	if (errh)
+	    errh->error("%s: mask is not a prefix", route.unparse_addr().c_str());
+	return -EINVAL;
+    }
+
+    IPPair key(route.addr, route.mask);
+    if (IPRoute *old = _current->routes.findp(key)) {
+	if (old_route)
+	    *old_route = *old;
+	if (!set)
+	    return -EEXIST;
+    }
+
+    RouteSet routes(_current->routes);
+    routes.insert(key, route);
+    publish(routes);
+    return 0;
+}
+
+int
+OLSRRadixIPLookup::remove_route(const IPRoute& route, IPRoute* old_route, ErrorHandler *)
+{
+    IPPair key(route.addr, route.mask);
+    IPRoute *old = _current->routes.findp(key);
+    if (!old || !route.match(*old))
+	return -ENOENT;
+    if (old_route)
+	*old_route = *old;
+
+    RouteSet routes(_current->routes);
+    routes.remove(key);
+    publish(routes);
+    return 0;
+}
+
+int
+OLSRRadixIPLookup::lookup_route(IPAddress addr, IPAddress &gw) const
+{
+    const Table *t = current();
+    int key = t->lookup_entry(addr);
+    if (key >= 0) {
+	gw = t->v[key].gw;
+	return t->v[key].port;
+    } else {
+	gw = 0;
+	return (_miss_handler ? _miss_handler->route_missed(addr, gw) : -1);
+    }
+}
+
+void
+OLSRRadixIPLookup::lookup_routes(const IPAddress* addrs, int n, int* ports, IPAddress* gws) const
+{
+    const Table *t = current();
+    uint32_t a[LOOKUP_BATCH];
+    int keys[LOOKUP_BATCH];
+    for (int j = 0; j < n; j += LOOKUP_BATCH) {
+	int m = (n - j < LOOKUP_BATCH ? n - j : LOOKUP_BATCH);
+	for (int i = 0; i < m; i++)
+	    a[i] = ntohl(addrs[j + i].addr());
+	RadixIPLookup::Radix::lookup_batch(t->radix, t->default_key, a, m, keys);
+	for (int i = 0; i < m; i++)
+	    if (keys[i] >= 0)
+		CLICK_PREFETCH(&t->v[keys[i]]);
+	for (int i = 0; i < m; i++) {
+	    int key = keys[i];
+	    if (key >= 0 && t->v[key].contains(addrs[j + i])) {
+		gws[j + i] = t->v[key].gw;
+		ports[j + i] = t->v[key].port;
+	    } else {
+		gws[j + i] = 0;
+		ports[j + i] = (_miss_handler ? _miss_handler->route_missed(addrs[j + i], gws[j + i]) : -1);
+	    }
+	}
+    }
+}
+
+String
+OLSRRadixIPLookup::dump_routes()
+{
+    StringAccum sa;
+    const Table *t = current();
+    for (int i = 0; i < t->v.size(); i++)
+	t->v[i].unparse(sa, true) << '\n';
+    return sa.take_string();
+}
+
+/**
+ * copies up to count routes of the current table, from index start on;
+ * a table is never changed once published, so its version names the pages
+ */
+int
+OLSRRadixIPLookup::page_routes(int start, int count, Vector<IPRoute>& routes, unsigned& version)
+{
+    const Table *t = current();
+    for (int i = start; i < t->v.size() && i - start < count; i++)
+	routes.push_back(t->v[i]);
+    version = t->version;
+    return t->v.size();
+}
+
+const IPRoute *
+OLSRRadixIPLookup::lookup_iproute(const IPAddress& dst) const
+{
+    return current()->lookup_iproute(dst);
+}
+
+/**
+ * completely clears the routing table
+ */
+void
+OLSRRadixIPLookup::clear()
+{
+    publish(RouteSet());
+}
+
+void
+OLSRRadixIPLookup::update(const IPAddress& dst, const IPAddress& gw, int port, int extra)
+{
+    const IPRoute *found = lookup_iproute(dst);
+    if (!found)
+	return;
+
+    IPRoute route = *found;
+    route.gw = gw;
+    route.port = port;
+    route.extra = extra;
+    RouteSet routes(_current->routes);
+    routes.insert(IPPair(route.addr, route.mask), route);
+    publish(routes);
+}
+
+OLSRRadixIPLookup::IPRouteTableIterator
+OLSRRadixIPLookup::begin() const
+{
+    return _current->routes.begin();
+}
+
+OLSRRadixIPLookup::IPRouteTableIterator
+OLSRRadixIPLookup::end() const
+{
+    return _current->routes.end();
+}
+
+String
+OLSRRadixIPLookup::read_retired(Element *e, void *)
+{
+    OLSRRadixIPLookup *rt = (OLSRRadixIPLookup *) e;
+    rt->_retired_lock.acquire();
+    int n = rt->_retired.size();
+    rt->_retired_lock.release();
+    return String(n) + "\n";
+}
+
+void
+OLSRRadixIPLookup::add_handlers()
+{
+    IPRouteTable::add_handlers();
+    add_read_handler("retired", read_retired, 0);
+}
+
+#include <click/bighashmap.cc>
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class HashMap<IPPair, IPRoute>;
+template class HashMap<IPAddress, int>;
+template class Vector<HashMap<IPAddress, int> >;
+#endif
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(RadixIPLookup)
+EXPORT_ELEMENT(OLSRRadixIPLookup)
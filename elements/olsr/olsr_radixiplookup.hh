@@ -0,0 +1,219 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_OLSR_RADIXIPLOOKUP_HH
+#define CLICK_OLSR_RADIXIPLOOKUP_HH
+#include <click/bighashmap.hh>
+#include <click/timer.hh>
+#include <click/sync.hh>
+#include "../ip/radixiplookup.hh"
+#include "ippair.hh"
+CLICK_DECLS
+
+/*
+=c
+
+OLSRRadixIPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ...)
+
+=s IP, classification
+
+IP routing table for OLSR, using a radix trie
+
+=d
+
+Behaves like RadixIPLookup on the data path: expects a destination IP
+address annotation with each packet, looks it up using longest-prefix-match
+in a radix trie, sets the destination annotation to the corresponding GW (if
+specified), and emits the packet on the indicated OUTput port. The packets
+of a batch are looked up together, against one table, with the walks down
+the trie interleaved as in RadixIPLookup.
+
+For OLSRRoutingTable it additionally keeps a copy of every route, indexed by
+prefix, whose C<extra> field is left alone. The OLSR route computation can
+read back route entries with lookup_iproute(), change them with update(), and
+iterate over them, as with OLSRLinearIPLookup. lookup_iproute() probes that
+index once per prefix length present in the table, longest first, so it
+costs a handful of hash lookups rather than a scan of the table.
+
+The table is never changed in place. OLSRRoutingTable builds each new set of
+routes off to the side and hands it to publish(), which builds a new trie and
+installs it with a single pointer store, so lookups never take a lock and
+never see a half-built table. Route changes through the handlers or
+add_route()/remove_route() publish a modified copy the same way. A replaced
+table is freed once every RouterThread has been through its driver loop
+since the replacement.
+
+Each route also carries an adjacency number, the same for all routes
+through one gateway and output port, which the data path gets along with
+the route from the three-argument lookup_route(). The numbers stay put for
+the lifetime of the element, so a forwarding element can keep per-next-hop
+state, like a prebuilt Ethernet header, in a plain array across table
+changes. Routes without a gateway have no adjacency (-1).
+
+A MissHandler set with set_miss_handler() is asked for the route of every
+address the table has none for, on the thread of the lookup. OLSRRoutingTable
+with LAZY uses this to install host routes only once traffic needs them.
+
+Only masks that are prefixes are accepted.
+
+=h table read-only
+
+Outputs a human-readable version of the current routing table.
+
+=h lookup read-only
+
+Reports the OUTput port and GW corresponding to an address.
+
+=h table_page read-only
+
+Takes `C<START [COUNT]>' and outputs COUNT routes from route START on, as
+text, after a line `C<version V next N total T>'. Reading a large table page
+by page keeps each read short. Since each published table has its own
+version, a client that sees V change between pages should start over.
+
+=h table_binary read-only
+
+As C<table_page>, but in binary: four 32-bit words V, START, N and T, then
+16 bytes per route, holding address, mask, gateway and output port. All
+words are in network byte order; see IPRouteTable.
+
+=h add write-only
+
+Adds a route to the table. Format should be `C<ADDR/MASK [GW] OUT>'.
+Fails if a route for C<ADDR/MASK> already exists.
+
+=h set write-only
+
+Sets a route, whether or not a route for the same prefix already exists.
+
+=h remove write-only
+
+Removes a route from the table. Format should be `C<ADDR/MASK>'.
+
+=h ctrl write-only
+
+Adds or removes a group of routes, as for RadixIPLookup.
+
+=h retired read-only
+
+Number of replaced tables that are not yet freed.
+
+=a OLSRLinearIPLookup, RadixIPLookup, OLSRRoutingTable */
+
+class OLSRRadixIPLookup : public IPRouteTable { public:
+
+    OLSRRadixIPLookup();
+    ~OLSRRadixIPLookup();
+
+    const char *class_name() const	{ return "OLSRRadixIPLookup"; }
+    const char *port_count() const	{ return "1/-"; }
+    const char *processing() const	{ return PUSH; }
+    void *cast(const char *);
+
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+    void run_timer(Timer *);
+
+    int add_route(const IPRoute&, bool, IPRoute*, ErrorHandler *);
+    int remove_route(const IPRoute&, IPRoute*, ErrorHandler *);
+    int lookup_route(IPAddress, IPAddress&) const;
+    inline int lookup_route(IPAddress, IPAddress&, int &adjacency) const;
+    void lookup_routes(const IPAddress*, int, int*, IPAddress*) const;
+    int adjacencies() const		{ return _adjacency_count; }
+    String dump_routes();
+    int page_routes(int start, int count, Vector<IPRoute>& routes, unsigned& version);
+
+    typedef HashMap<IPPair, IPRoute> RouteSet;
+
+    class MissHandler { public:
+	virtual ~MissHandler() { }
+	// the output port, setting gw, of a route to addr the table lacks,
+	// or -1; called on any thread, with no lock held
+	virtual int route_missed(IPAddress addr, IPAddress &gw) = 0;
+    };
+    void set_miss_handler(MissHandler *h)	{ _miss_handler = h; }
+
+    void publish(const RouteSet &routes);
+    const IPRoute *lookup_iproute(const IPAddress&) const;
+    void clear();
+    void update(const IPAddress& dst, const IPAddress& gw, int port, int extra);
+
+    typedef RouteSet::const_iterator IPRouteTableIterator;
+    IPRouteTableIterator begin() const;
+    IPRouteTableIterator end() const;
+
+  private:
+
+    class Table;
+
+    Table * volatile _current;
+    MissHandler *_miss_handler;
+    Vector<HashMap<IPAddress, int> > _adjacency_ids;	// [port][gw]
+    int _adjacency_count;
+    Vector<Table *> _retired;
+    Spinlock _retired_lock;
+    Timer _timer;
+
+    // the current table, for readers on any thread: the loads of its
+    // contents stay after the load of the pointer (see publish())
+    const Table *current() const {
+	const Table *t = _current;
+	click_read_fence();
+	return t;
+    }
+
+    int adjacency(const IPRoute &);
+    void retire(Table *);
+    void reclaim();
+
+    static String read_retired(Element *, void *);
+
+};
+
+class OLSRRadixIPLookup::Table { public:
+
+    Table(const RouteSet &routes);
+    ~Table();
+
+    inline int lookup_entry(IPAddress addr) const;
+    const IPRoute *lookup_iproute(const IPAddress &) const;
+
+    RouteSet routes;			// (addr, mask) -> route, extra preserved
+    Vector<IPRoute> v;
+    Vector<int> adjacency;		// of v[key], or -1
+    unsigned version;			// one more than the table it replaced
+    int32_t default_key;
+    RadixIPLookup::Radix *radix;
+    int prefix_count[33];		// number of routes per prefix length
+    Vector<uint32_t> retire_epochs;	// driver epochs when replaced
+
+};
+
+inline int
+OLSRRadixIPLookup::Table::lookup_entry(IPAddress addr) const
+{
+    int key = RadixIPLookup::Radix::lookup(radix, default_key, ntohl(addr.addr()));
+    return (key >= 0 && v[key].contains(addr) ? key : -1);
+}
+
+/**
+ * as the two-argument lookup_route(), also setting adjacency to the number
+ * of the route's gateway and port
+ */
+inline int
+OLSRRadixIPLookup::lookup_route(IPAddress addr, IPAddress &gw, int &adjacency) const
+{
+    const Table *t = current();
+    int key = t->lookup_entry(addr);
+    if (key >= 0) {
+	gw = t->v[key].gw;
+	adjacency = t->adjacency[key];
+	return t->v[key].port;
+    } else {
+	adjacency = -1;
+	gw = 0;
+	return (_miss_handler ? _miss_handler->route_missed(addr, gw) : -1);
+    }
+}
+
+CLICK_ENDDECLS
+#endif
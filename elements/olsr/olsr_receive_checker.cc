@@ -11,7 +11,7 @@
 CLICK_DECLS
 
 OLSRReceiveChecker::OLSRReceiveChecker()
-		:_timer(this), _period(15000)
+		:_timer(this), _period(15000), _receiving(false)
 {
 }
 
@@ -48,23 +48,28 @@ OLSRReceiveChecker::initialize(ErrorHandler *)
 void
 OLSRReceiveChecker::run_timer(Timer *)
 {
+	// packets that arrived since the timer was set push the expiry back
+	Timestamp expiry = _last_seen + Timestamp::make_msec(_period);
+	if (Timestamp::now() < expiry)
+	{
+		_timer.schedule_at(expiry);
+		return;
+	}
+	_receiving = false;
 	_neighborInfo->additional_mprs_is_enabled(false);
 }
 
 void
 OLSRReceiveChecker::push(int, Packet *packet)
 {
-	// if we start receiving packets we will need additional MPRs to guarantee connectivity.
-	_neighborInfo->additional_mprs_is_enabled(true);
-	// start a timer that after _period will stop the node from choosing additional_mprs
-	if (_timer.scheduled())
+	_last_seen = Timestamp::now();
+	if (!_receiving)
 	{
-		_timer.reschedule_after_msec(_period);
-	}
-	else
-	{
-		_timer.schedule_after_msec(_period);
-
+		// if we start receiving packets we will need additional MPRs to guarantee connectivity.
+		_receiving = true;
+		_neighborInfo->additional_mprs_is_enabled(true);
+		// start a timer that after _period will stop the node from choosing additional_mprs
+		_timer.schedule_at(_last_seen + Timestamp::make_msec(_period));
 	}
 	output(0).push(packet);
 }
@@ -13,7 +13,13 @@
   PUSH
 
   =d
-  @TODO
+  Passes packets through unchanged.  While packets arrive, the
+  OLSRNeighborInfoBase element chooses additional MPRs; once none has
+  arrived for INTERVAL milliseconds, it stops.
+
+  Each packet only records its arrival time.  The timer runs at most once
+  per INTERVAL while packets keep arriving, and the neighbor information
+  base is told only when the node starts or stops receiving.
 
   =a
   OLSRHelloGenerator, OLSRForward
@@ -26,6 +32,7 @@
 #include <click/element.hh>
 #include <click/timer.hh>
 #include <click/ipaddress.hh>
+#include <click/timestamp.hh>
 #include "olsr_neighbor_infobase.hh"
 #include "click_olsr.hh"
 
@@ -54,6 +61,8 @@ private:
   OLSRNeighborInfoBase *_neighborInfo;
   int _period;
   IPAddress _myIP;
+  Timestamp _last_seen;
+  bool _receiving;
   
 };
 
@@ -1,6 +1,8 @@
 
 #include <click/config.h>
 #include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
 #include "olsr_recoverfromlinklayer.hh"
 #include "click_olsr.hh"
 #include <clicknet/ether.h>
@@ -10,6 +12,7 @@ CLICK_DECLS
 
 
 OLSRRecoverFromLinkLayer::OLSRRecoverFromLinkLayer()
+	: _neighborQueue(0)
 {
 }
 
@@ -22,6 +25,10 @@ OLSRRecoverFromLinkLayer::~OLSRRecoverFromLinkLayer()
 int
 OLSRRecoverFromLinkLayer::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+	int window = 1000;
+	Element *trace = 0;
+	Element *neighbor_queue = 0;
+	uint32_t trace_mask = 0xFFFFFFFFU;
 	if (cp_va_parse(conf, this, errh,
 	                cpElement, "NeighborInfoBase Element", &_neighborInfoBase,
 	                cpElement, "LinkInfoBase Element", &_linkInfoBase,
@@ -30,8 +37,20 @@ OLSRRecoverFromLinkLayer::configure(Vector<String> &conf, ErrorHandler *errh)
 			cpElement, "RoutingTable Element", &_routingTable,
 	                cpElement, "OLSR ARP Querier Element", &_arpQuerier,
 	                cpIPAddress, "Nodes main IP address", &_myMainIP,
+	                cpKeywords,
+	                "WINDOW", cpInteger, "time a failed next hop is remembered (msecs)", &window,
+	                "NEIGHBOR_QUEUE", cpElement, "OLSRNeighborQueue element", &neighbor_queue,
+	                "TRACE", cpElement, "OLSRTrace element", &trace,
+	                "TRACE_MASK", cpUnsigned, "events to trace", &trace_mask,
 	                0) < 0)
 		return -1;
+	if (set_trace(trace, trace_mask, this, errh) < 0)
+		return -1;
+	if (window < 0)
+		return errh->error("WINDOW must be positive");
+	if (neighbor_queue && !(_neighborQueue = (OLSRNeighborQueue *) neighbor_queue->cast("OLSRNeighborQueue")))
+		return errh->error("NEIGHBOR_QUEUE element is not an OLSRNeighborQueue");
+	_window = Timestamp::make_msec(window);
 	return 0;
 }
 
@@ -39,18 +58,42 @@ OLSRRecoverFromLinkLayer::configure(Vector<String> &conf, ErrorHandler *errh)
 int
 OLSRRecoverFromLinkLayer::initialize(ErrorHandler *)
 {
+	_failures = _rerouted = 0;
 	return 0;
 }
 
+
+void
+OLSRRecoverFromLinkLayer::expire_failures(const Timestamp &now)
+{
+	Vector<EtherAddress> expired;
+	for (FailureSet::iterator iter = _recent_failures.begin(); iter != _recent_failures.end(); iter++)
+		if (iter.value() + _window <= now)
+			expired.push_back(iter.key());
+	for (int i = 0; i < expired.size(); i++)
+		_recent_failures.remove(expired[i]);
+}
+
 void
 OLSRRecoverFromLinkLayer::push(int, Packet *packet)
 {
-	timeval now;
-	click_gettimeofday(&now);
+	Timestamp now = Timestamp::recent();
 
 	EtherAddress ether_addr;
 	memcpy(ether_addr.data(), packet->data(), 6);
 
+	// the failure of this next hop has been handled already, the routes
+	// no longer use it
+	if (Timestamp *failed = _recent_failures.findp(ether_addr))
+	{
+		if (now < *failed + _window)
+		{
+			_rerouted++;
+			output(0).push(packet);
+			return;
+		}
+	}
+
 	// do reverse ARP
 	IPAddress next_hop_IP = _arpQuerier->lookup_mac(ether_addr);
 
@@ -60,25 +103,19 @@ OLSRRecoverFromLinkLayer::push(int, Packet *packet)
 		return;
 	}
 
-	click_chatter("%f | %s | %s | reverse lookup succeeded: the original next hop was %s", Timestamp(now).doubleval(), _myMainIP.unparse().c_str(), __FUNCTION__, next_hop_IP.s().c_str());
+	expire_failures(now);
+	_recent_failures.insert(ether_addr, now);
+	_failures++;
+
+	trace(OLSR_TRACE_LINK_FAILURE, _myMainIP, next_hop_IP);
 	// set the gw as dst (for logging purposes)
 	packet->set_dst_ip_anno(next_hop_IP);
 	// remove the matching link from the link info base
 	IPAddress next_hop_main_IP = _interfaceInfoBase->get_main_address(next_hop_IP);
 	_linkInfoBase->remove_link(_myMainIP, next_hop_IP);
 	// remove the matching neighbor from the neighbor info base if there are no more links
-	bool other_interfaces_left = false;
+	bool other_interfaces_left = (_linkInfoBase->links_to(next_hop_main_IP) != 0);
 	bool mpr_selector_removed = true;
-	for (OLSRLinkInfoBase::LinkSet::iterator iter = _linkInfoBase->get_link_set()->begin(); iter != _linkInfoBase->get_link_set()->end(); iter++)
-	{
-		link_data *data = (link_data *)iter.value();
-		if (_interfaceInfoBase->get_main_address(data->L_neigh_iface_addr) == next_hop_main_IP)
-		{
-			other_interfaces_left = true;
-			break;
-
-		}
-	}
 	if (!other_interfaces_left)
 	{
 		_neighborInfoBase->remove_neighbor(next_hop_main_IP);
@@ -90,13 +127,53 @@ OLSRRecoverFromLinkLayer::push(int, Packet *packet)
 	}
 	// make sure that the MPRs and Route Table are updated
 	if (mpr_selector_removed) _tcGenerator->notify_mpr_selector_changed();
-	_neighborInfoBase->compute_mprset();
-	_routingTable->compute_routing_table();
-	// now push the packet out through output 0
+	_neighborInfoBase->schedule_compute_mprset();
+	// switch to the alternate next hops at once if there are any, the full
+	// computation follows from the routing table's Task
+	_routingTable->note_event(OLSRRoutingTable::EVENT_LINK_FAILURE);
+	if (!_routingTable->fail_over(next_hop_IP))
+		_routingTable->compute_routing_table();
+	// now push the packet out through output 0, and the ones queued for
+	// the same next hop after it
+	Packet *queued = (_neighborQueue ? _neighborQueue->take_next_hop(next_hop_IP) : 0);
 	output(0).push(packet);
+	while (queued)
+	{
+		Packet *next = queued->next();
+		queued->set_next(0);
+		_rerouted++;
+		output(0).push(queued);
+		queued = next;
+	}
+}
+
+
+String
+OLSRRecoverFromLinkLayer::read_handler(Element *e, void *)
+{
+	OLSRRecoverFromLinkLayer *r = (OLSRRecoverFromLinkLayer *) e;
+	StringAccum sa;
+	sa << "failures " << r->_failures << "\n"
+	   << "rerouted " << r->_rerouted << "\n";
+	return sa.take_string();
 }
 
 
+void
+OLSRRecoverFromLinkLayer::add_handlers()
+{
+	add_read_handler("stats", read_handler, (void *) 0);
+	add_trace_handlers(this);
+}
+
+#include <click/bighashmap.cc>
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class HashMap<EtherAddress, Timestamp>;
+template class Vector<EtherAddress>;
+#endif
+
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(OLSRRecoverFromLinkLayer);
 
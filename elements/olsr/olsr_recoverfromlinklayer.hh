@@ -3,22 +3,44 @@
 #define OLSR_RECOVERFROMLINKLAYER_HH
 
 #include <click/element.hh>
+#include <click/etheraddress.hh>
+#include <click/bighashmap.hh>
+#include <click/timestamp.hh>
 #include "olsr_neighbor_infobase.hh"
 #include "olsr_link_infobase.hh"
 #include "olsr_arpquerier.hh"
 #include "olsr_rtable.hh"
 #include "olsr_interface_infobase.hh"
 #include "olsr_tc_generator.hh"
+#include "olsr_trace.hh"
+#include "olsr_neighbor_queue.hh"
 
 CLICK_DECLS
 /* =c
  * OLSR specific element, splits up OSLR packets and classifies the OLSR messages within 
  *
  * =s
- * OLSRRecoverFromLinkLayer(OLSRDuplicateSet element, ip_address)
+ * OLSRRecoverFromLinkLayer(OLSRNeighborInfoBase element, OLSRLinkInfoBase element, OLSRInterfaceInfoBase element, OLSRTCGenerator element, OLSRRoutingTable element, OLSRARPQuerier element, ip_address [, WINDOW, NEIGHBOR_QUEUE, TRACE, TRACE_MASK])
  *
  * =d
- * The OLSRRecoverFromLinkLayer element  
+ * The OLSRRecoverFromLinkLayer element gets the packets the link layer
+ * failed to deliver. The first failure towards a next hop removes the link
+ * (and the neighbor, if no other link to it is left), has the MPR set
+ * recomputed and recomputes the routes once, or with BACKUP_ROUTES in the
+ * OLSRRoutingTable switches the routes to their alternate next hops and
+ * leaves the recomputation to its Task. Further packets for the same
+ * next hop within WINDOW milliseconds, typically those still queued for it,
+ * leave through output 0 again straight away, to be routed over the new
+ * routes. Default WINDOW is 1000. Each failure handled is recorded as a
+ * link_failure event in the OLSRTrace element given as TRACE.
+ *
+ * With an OLSRNeighborQueue as NEIGHBOR_QUEUE, the packets still queued
+ * there for the failed next hop are taken out at the first failure and
+ * leave through output 0 after the failed packet, instead of each
+ * waiting for its own failure behind the MAC retries.
+ *
+ * =h stats read-only
+ * Returns the number of link failures handled and of packets rerouted.
  *
  * =io
  * One input, five outputs
@@ -28,11 +50,11 @@ CLICK_DECLS
  * PUSH
  *
  * =a
- * OLSRProcessHello, OLSRProcessTC, OLSRProcessMID, OLSRForward
+ * OLSRProcessHello, OLSRProcessTC, OLSRProcessMID, OLSRForward, OLSRNeighborQueue
  */
 
 
-class OLSRRecoverFromLinkLayer : public Element
+class OLSRRecoverFromLinkLayer : public Element, public OLSRTrace::Client
 {
 public:
 	OLSRRecoverFromLinkLayer();
@@ -46,14 +68,25 @@ public:
 	int configure(Vector<String> &conf, ErrorHandler *errh);
 	int initialize(ErrorHandler *);
 	void push(int, Packet*);
+	void add_handlers();
 
 private:
+	typedef HashMap<EtherAddress, Timestamp> FailureSet;
+	FailureSet _recent_failures;	//next hops handled within the window, by the time they failed
+	Timestamp _window;
+	uint32_t _failures;
+	uint32_t _rerouted;
+
+	void expire_failures(const Timestamp &now);
+	static String read_handler(Element *, void *);
+
 	OLSRNeighborInfoBase	*_neighborInfoBase;
 	OLSRLinkInfoBase 	*_linkInfoBase;
 	OLSRARPQuerier		*_arpQuerier;
 	OLSRInterfaceInfoBase	*_interfaceInfoBase;
 	OLSRRoutingTable	*_routingTable;
 	OLSRTCGenerator		*_tcGenerator;
+	OLSRNeighborQueue	*_neighborQueue;
 	IPAddress		_myMainIP;
 };
 
@@ -0,0 +1,258 @@
+/*
+ * olsr_replay.{cc,hh} -- replays captured OLSR traffic through the receive
+ * pipeline and measures it
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include "olsr_replay.hh"
+#include "click_olsr.hh"
+#if defined(__GLIBC__)
+# include <malloc.h>
+#endif
+
+CLICK_DECLS
+
+OLSRReplay::OLSRReplay()
+  : _task(this), _timer(&_task), _pending(0)
+{
+}
+
+
+OLSRReplay::~OLSRReplay()
+{
+}
+
+
+int
+OLSRReplay::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _speedup = 0;
+  _offset = 14;
+  if (cp_va_parse(conf, this, errh,
+		  cpKeywords,
+		  "SPEEDUP", cpDouble, "replay speed, 0 for as fast as possible", &_speedup,
+		  "OFFSET", cpInteger, "offset of the IP header", &_offset,
+		  0) < 0)
+    return -1;
+  if (_speedup < 0)
+    return errh->error("SPEEDUP must not be negative");
+  if (_offset < 0)
+    return errh->error("OFFSET must not be negative");
+  return 0;
+}
+
+
+int
+OLSRReplay::initialize(ErrorHandler *errh)
+{
+  ScheduleInfo::initialize_task(this, &_task, true, errh);
+  _timer.initialize(this);
+  _signal = Notifier::upstream_empty_signal(this, 0, &_task);
+  reset();
+  return 0;
+}
+
+
+void
+OLSRReplay::cleanup(CleanupStage)
+{
+  if (_pending)
+    _pending->kill();
+  _pending = 0;
+}
+
+
+void
+OLSRReplay::reset()
+{
+  _started = false;
+  _packets = _messages = _rescaled = 0;
+  _bytes = 0;
+  _pipeline.clear();
+  _late.clear();
+}
+
+
+Timestamp
+OLSRReplay::due(const Packet *p) const
+{
+  return _wall_start + (p->timestamp_anno() - _trace_start) * (1 / _speedup);
+}
+
+
+// counts the messages of an OLSR packet and, when replaying at a speedup,
+// divides their validity times by it; other packets pass unchanged
+Packet *
+OLSRReplay::rescale(Packet *p)
+{
+  if (p->length() < _offset + sizeof(click_ip))
+    return p;
+  const click_ip *ip = reinterpret_cast<const click_ip *>(p->data() + _offset);
+  int hl = ip->ip_hl << 2;
+  int udp_offset = _offset + hl;
+  int olsr_offset = udp_offset + sizeof(click_udp);
+  if (ip->ip_p != IP_PROTO_UDP || hl < (int) sizeof(click_ip)
+      || (int) p->length() < olsr_offset + (int) sizeof(olsr_pkt_hdr))
+    return p;
+  const click_udp *udp = reinterpret_cast<const click_udp *>(p->data() + udp_offset);
+  if (ntohs(udp->uh_dport) != OLSR_PORT)
+    return p;
+
+  int end = _offset + ntohs(ip->ip_len);
+  if (end > (int) p->length())
+    end = p->length();
+  WritablePacket *q = 0;
+  int offset = olsr_offset + sizeof(olsr_pkt_hdr);
+  while (offset + (int) sizeof(olsr_msg_hdr) <= end) {
+    const olsr_msg_hdr *msg = reinterpret_cast<const olsr_msg_hdr *>(p->data() + offset);
+    int size = ntohs(msg->msg_size);
+    if (size < (int) sizeof(olsr_msg_hdr) || offset + size > end)
+      break;
+    _messages++;
+    if (_speedup > 0) {
+      uint8_t vtime = olsr_vtime_encode((olsr_time_t) (olsr_vtime_decode(msg->vtime) / _speedup));
+      if (vtime != msg->vtime) {
+	if (!q && !(q = p->uniqueify()))
+	  return 0;
+	p = q;
+	reinterpret_cast<olsr_msg_hdr *>(q->data() + offset)->vtime = vtime;
+	_rescaled++;
+      }
+    }
+    offset += size;
+  }
+
+  if (q) {
+    click_ip *qip = reinterpret_cast<click_ip *>(q->data() + _offset);
+    click_udp *qudp = reinterpret_cast<click_udp *>(q->data() + udp_offset);
+    int len = ntohs(qudp->uh_ulen);
+    if (qudp->uh_sum && udp_offset + len <= (int) q->length()) {
+      qudp->uh_sum = 0;
+      unsigned csum = click_in_cksum((unsigned char *) qudp, len);
+      qudp->uh_sum = click_in_cksum_pseudohdr(csum, qip, len);
+    }
+  }
+  return p;
+}
+
+
+void
+OLSRReplay::push_timed(Packet *p)
+{
+  if (!(p = rescale(p)))
+    return;
+  _packets++;
+  _bytes += p->length();
+  click_cycles_t start = click_get_cycles();
+  output(0).push(p);
+  _pipeline.add(click_get_cycles() - start);
+  _wall_end = Timestamp::now();
+}
+
+
+bool
+OLSRReplay::run_task(Task *)
+{
+  // waiting for the packet held until it is due
+  if (_timer.scheduled())
+    return false;
+
+  bool worked = false;
+  for (int i = 0; i < BURST; i++) {
+    Packet *p = _pending;
+    _pending = 0;
+    if (!p && !(p = input(0).pull())) {
+      if (!_signal)
+	return worked;	// without rescheduling: the notifier wakes us up
+      break;
+    }
+
+    if (!_started) {
+      _started = true;
+      _trace_start = p->timestamp_anno();
+      _wall_start = Timestamp::now();
+      _heap_start = heap_in_use();
+    } else if (_speedup > 0) {
+      Timestamp when = due(p);
+      Timestamp now = Timestamp::now();
+      if (when > now) {
+	_pending = p;
+	_timer.schedule_at(when);
+	return worked;
+      }
+      _late.add((now - when).usecval());
+    }
+
+    push_timed(p);
+    worked = true;
+  }
+
+  _task.fast_reschedule();
+  return worked;
+}
+
+
+long
+OLSRReplay::heap_in_use()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+  return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+  return mallinfo().uordblks;
+#else
+  return -1;
+#endif
+}
+
+
+String
+OLSRReplay::read_results(Element *e, void *)
+{
+  OLSRReplay *r = (OLSRReplay *) e;
+  StringAccum sa;
+  double elapsed = r->_packets ? (r->_wall_end - r->_wall_start).doubleval() : 0;
+  sa << "packets " << r->_packets << '\n'
+     << "messages " << r->_messages << '\n'
+     << "bytes " << r->_bytes << '\n'
+     << "rescaled " << r->_rescaled << '\n'
+     << "elapsed " << elapsed << '\n'
+     << "messages_per_sec " << (elapsed > 0 ? r->_messages / elapsed : 0) << '\n'
+     << "packets_per_sec " << (elapsed > 0 ? r->_packets / elapsed : 0) << '\n';
+  long heap = heap_in_use();
+  if (heap < 0 || r->_heap_start < 0 || !r->_started)
+    sa << "heap_per_message unavailable\n";
+  else
+    sa << "heap_per_message " << (r->_messages ? (double) (heap - r->_heap_start) / r->_messages : 0) << '\n';
+  r->_pipeline.unparse(sa, "pipeline");
+  r->_late.unparse(sa, "late");
+  return sa.take_string();
+}
+
+
+int
+OLSRReplay::reset_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  ((OLSRReplay *) e)->reset();
+  return 0;
+}
+
+
+void
+OLSRReplay::add_handlers()
+{
+  add_read_handler("results", read_results, 0);
+  add_write_handler("reset", reset_handler, 0);
+  add_task_handlers(&_task);
+}
+
+
+CLICK_ENDDECLS
+
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(OLSRReplay);
@@ -0,0 +1,143 @@
+/*
+  =c
+  OLSRReplay([KEYWORDS])
+
+  =s
+  OLSR specific element, replays captured OLSR traffic and measures the receive pipeline
+
+  =io
+  One pull input, one push output
+
+  =d
+  Pulls the packets of a captured trace, normally from a FromDump with
+  TIMING false, and pushes them into the receive pipeline of an OLSR node,
+  timing how long the pipeline takes to consume them. Must come before the
+  element that sets the timestamp annotation to the time of reception, as
+  the trace timestamps are used for pacing.
+
+  With SPEEDUP 0, packets are pushed as fast as the pipeline accepts them.
+  The validity times in the messages are left alone, so the tuples they
+  create do not expire during the replay: this measures the processing cost
+  of the traffic, not its effect on the information bases.
+
+  With SPEEDUP S, packets are pushed at S times the speed at which they were
+  captured, and the validity time of every OLSR message is divided by S
+  (rounded up to the next value the vtime field can hold, and never below
+  its minimum of 1/16 second), so that tuples expire at the same point of
+  the trace as they did in the node that captured it. The UDP checksum of a
+  rewritten packet is recomputed. A packet pushed late because the pipeline
+  could not keep up counts in the C<late> line of the results; a small
+  lateness is the timer granularity.
+
+  Packets that are not UDP to port 698 are pushed unchanged and only count
+  as packets.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item SPEEDUP
+
+  Double. Replay speed relative to the trace, 0 meaning as fast as
+  possible. Default is 0.
+
+  =item OFFSET
+
+  Integer. Offset of the IP header in the packets. Default is 14, for
+  Ethernet frames.
+
+  =back
+
+  =h results read-only
+  Packets, OLSR messages and bytes pushed; the elapsed time from the first
+  push to the end of the last; messages and packets per second; the heap
+  growth over the replay per message, where the C library reports it; then
+  the cycles spent in the pipeline per packet and the lateness in
+  microseconds, formatted as in the C<profile> handler of OLSRRoutingTable.
+  The cost of each element of the pipeline is in its own C<stats> handler.
+
+  =h reset write-only
+  Clears the results. The next packet starts a new measurement.
+
+  =e
+  Default OLSR configuration of one node, with its input replaced by
+
+    FromDump(trace.dump, TIMING false, STOP true)
+      -> replay::OLSRReplay(SPEEDUP 0)
+      -> in0::Null;
+
+  and its outputs by Discard, as C<make-olsr-config.pl -u --replay
+  trace.dump> writes it, run with
+
+    click -h olsr/replay.results -h olsr/olsrclassifier.stats \
+          -h olsr/process_hello.stats -h olsr/process_tc.stats ...
+
+  =a
+  FromDump, ToDump, OLSRClassifier, OLSRBenchmark */
+
+#ifndef OLSR_REPLAY_HH
+#define OLSR_REPLAY_HH
+
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include <click/notifier.hh>
+#include "olsr_profile.hh"
+
+CLICK_DECLS
+
+class OLSRReplay : public Element { public:
+
+  OLSRReplay();
+  ~OLSRReplay();
+
+  const char *class_name() const	{ return "OLSRReplay"; }
+  OLSRReplay *clone() const		{ return new OLSRReplay; }
+  const char *port_count() const	{ return PORTS_1_1; }
+  const char *processing() const	{ return PULL_TO_PUSH; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  bool run_task(Task *);
+
+private:
+
+  enum { BURST = 32 };
+
+  Task _task;
+  Timer _timer;
+  NotifierSignal _signal;
+
+  double _speedup;
+  int _offset;
+
+  Packet *_pending;		// pulled, not yet due
+  bool _started;
+  Timestamp _trace_start;	// timestamp of the first packet
+  Timestamp _wall_start;	// when it was pushed
+  Timestamp _wall_end;		// end of the last push
+  long _heap_start;
+
+  uint32_t _packets;
+  uint32_t _messages;
+  uint64_t _bytes;
+  uint32_t _rescaled;
+  OLSRPhaseProfile _pipeline;
+  OLSRPhaseProfile _late;
+
+  Timestamp due(const Packet *p) const;
+  Packet *rescale(Packet *p);
+  void push_timed(Packet *p);
+  void reset();
+
+  static long heap_in_use();
+  static String read_results(Element *, void *);
+  static int reset_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,221 @@
+/*
+ * olsr_residence_time.{cc,hh} -- histograms of the time packets spend in
+ * the node, by class
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/integers.hh>
+#include <click/packet_anno.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include "click_olsr.hh"
+#include "olsr_residence_time.hh"
+
+CLICK_DECLS
+
+static const char * const class_names[] = {
+  "hello", "tc", "mid", "hna", "control", "data", "other"
+};
+
+
+void
+OLSRResidenceTime::Histogram::clear()
+{
+  count = 0;
+  total = max = 0;
+  min = ~(uint64_t) 0;
+  memset(buckets, 0, sizeof(buckets));
+}
+
+
+void
+OLSRResidenceTime::Histogram::add(uint64_t nsec)
+{
+  count++;
+  total += nsec;
+  if (nsec < min)
+    min = nsec;
+  if (nsec > max)
+    max = nsec;
+  int b;
+  if (nsec < SUB_BUCKETS)
+    b = nsec;
+  else {
+    if (nsec >> (MAX_SHIFT + 1))
+      nsec = ((uint64_t) 2 << MAX_SHIFT) - 1;
+    int shift = 64 - ffs_msb((uint64_t) nsec);	// of the highest bit set
+    b = SUB_BUCKETS + (shift - SUB_BITS) * SUB_BUCKETS
+      + (int) (nsec >> (shift - SUB_BITS)) - SUB_BUCKETS;
+  }
+  buckets[b]++;
+}
+
+
+uint64_t
+OLSRResidenceTime::Histogram::bucket_low(int b)
+{
+  if (b < SUB_BUCKETS)
+    return b;
+  b -= SUB_BUCKETS;
+  int shift = b / SUB_BUCKETS;
+  return (uint64_t) (SUB_BUCKETS + b % SUB_BUCKETS) << shift;
+}
+
+
+uint64_t
+OLSRResidenceTime::Histogram::percentile(double fraction) const
+{
+  uint64_t target = (uint64_t) (fraction * count + 0.5), seen = 0;
+  if (target < 1)
+    target = 1;
+  for (int b = 0; b < NBUCKETS; b++) {
+    seen += buckets[b];
+    if (seen >= target) {
+      uint64_t t = bucket_low(b);
+      return t < min ? min : (t > max ? max : t);
+    }
+  }
+  return max;
+}
+
+
+OLSRResidenceTime::OLSRResidenceTime()
+  : _offset(14), _unstamped(0)
+{
+  for (int c = 0; c < NCLASSES; c++)
+    _hist[c].clear();
+}
+
+
+OLSRResidenceTime::~OLSRResidenceTime()
+{
+}
+
+
+int
+OLSRResidenceTime::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  if (cp_va_parse(conf, this, errh,
+		  cpKeywords,
+		  "OFFSET", cpUnsigned, "IP header offset", &_offset,
+		  0) < 0)
+    return -1;
+  return 0;
+}
+
+
+int
+OLSRResidenceTime::classify(Packet *p) const
+{
+  const unsigned char *data = p->data() + _offset;
+  unsigned len = (p->length() > _offset ? p->length() - _offset : 0);
+  if (len < sizeof(click_ip))
+    return CLASS_OTHER;
+  const click_ip *iph = reinterpret_cast<const click_ip *>(data);
+  if (iph->ip_v != 4)
+    return CLASS_OTHER;
+  unsigned hlen = iph->ip_hl << 2;
+  if (iph->ip_p != IP_PROTO_UDP || (ntohs(iph->ip_off) & IP_OFFMASK)
+      || len < hlen + sizeof(click_udp))
+    return CLASS_DATA;
+  const click_udp *udph = reinterpret_cast<const click_udp *>(data + hlen);
+  if (ntohs(udph->uh_dport) != OLSR_PORT)
+    return CLASS_DATA;
+  unsigned msg = hlen + sizeof(click_udp) + sizeof(olsr_pkt_hdr);
+  if (len <= msg)
+    return CLASS_CONTROL;
+  switch (data[msg]) {
+  case OLSR_HELLO_MESSAGE:
+  case OLSR_LQ_HELLO_MESSAGE:
+  case OLSR_COMPACT_HELLO_MESSAGE:
+    return CLASS_HELLO;
+  case OLSR_TC_MESSAGE:
+  case OLSR_LQ_TC_MESSAGE:
+  case OLSR_COMPACT_TC_MESSAGE:
+    return CLASS_TC;
+  case OLSR_MID_MESSAGE:
+    return CLASS_MID;
+  case OLSR_HNA_MESSAGE:
+  case OLSR_GATEWAY_LOAD_MESSAGE:
+    return CLASS_HNA;
+  default:
+    return CLASS_CONTROL;
+  }
+}
+
+
+Packet *
+OLSRResidenceTime::simple_action(Packet *p)
+{
+  Timestamp since = CONST_FIRST_TIMESTAMP_ANNO(p);
+  if (!since)
+    since = p->timestamp_anno();
+  if (!since) {
+    _unstamped++;
+    return p;
+  }
+  Timestamp::value_type nsec = (Timestamp::now() - since).nsecval();
+  _hist[classify(p)].add(nsec > 0 ? nsec : 0);
+  return p;
+}
+
+
+String
+OLSRResidenceTime::read_stats(Element *e, void *)
+{
+  OLSRResidenceTime *rt = (OLSRResidenceTime *) e;
+  StringAccum sa;
+  sa << "# class\tcount\tmin\tmean\tp50\tp90\tp99\tp99.9\tmax (usec)\n";
+  for (int c = 0; c < NCLASSES; c++) {
+    const Histogram &h = rt->_hist[c];
+    if (!h.count)
+      continue;
+    sa << class_names[c] << '\t' << h.count << '\t'
+       << h.min / 1000 << '\t' << h.total / h.count / 1000 << '\t'
+       << h.percentile(0.5) / 1000 << '\t' << h.percentile(0.9) / 1000 << '\t'
+       << h.percentile(0.99) / 1000 << '\t' << h.percentile(0.999) / 1000 << '\t'
+       << h.max / 1000 << '\n';
+  }
+  sa << "unstamped\t" << rt->_unstamped << '\n';
+  return sa.take_string();
+}
+
+
+String
+OLSRResidenceTime::read_histogram(Element *e, void *)
+{
+  OLSRResidenceTime *rt = (OLSRResidenceTime *) e;
+  StringAccum sa;
+  for (int c = 0; c < NCLASSES; c++)
+    for (int b = 0; b < NBUCKETS; b++)
+      if (rt->_hist[c].buckets[b])
+	sa << class_names[c] << '\t' << Histogram::bucket_low(b) << '\t'
+	   << rt->_hist[c].buckets[b] << '\n';
+  return sa.take_string();
+}
+
+
+int
+OLSRResidenceTime::reset_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRResidenceTime *rt = (OLSRResidenceTime *) e;
+  for (int c = 0; c < NCLASSES; c++)
+    rt->_hist[c].clear();
+  rt->_unstamped = 0;
+  return 0;
+}
+
+
+void
+OLSRResidenceTime::add_handlers()
+{
+  add_read_handler("stats", read_stats, 0);
+  add_read_handler("histogram", read_histogram, 0);
+  add_write_handler("reset", reset_handler, 0);
+}
+
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRResidenceTime)
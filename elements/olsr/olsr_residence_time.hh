@@ -0,0 +1,120 @@
+/*
+  =c
+  OLSRResidenceTime([I<keywords> OFFSET])
+
+  =s
+  OLSR specific element, histograms of the time packets spend in the node
+
+  =io
+  One input, one output
+
+  =d
+  Sits in front of an interface's ToDevice and records, for every packet on
+  its way out, how long it has been in the node: since the "first timestamp"
+  annotation that a SetTimestamp(FIRST true) behind the FromDevice gave it,
+  or, for the node's own messages, which have none, since the timestamp
+  annotation the HELLO, TC and MID generators give them as they make them
+  (with an output SetTimestamp, as make-olsr-config.pl puts in for
+  --prio-sched, since they were queued). Packets with neither are counted
+  as unstamped. Packets pass unchanged.
+
+  The times are kept apart by class: OLSR control packets by the type of
+  their first message (hello, including LQ_HELLO and COMPACT_HELLO; tc, including LQ_TC and
+  COMPACT_TC; mid;
+  hna, including GATEWAY_LOAD; and control for any other), IP packets that
+  are not OLSR control (data), and the rest, such as ARP (other). Each class
+  has a log-linear histogram in nanoseconds, in the manner of HDR
+  histograms: the times below 2^SUB_BITS ns are counted exactly, and every
+  power of two above is split into 2^SUB_BITS equal buckets, so that every
+  bucket is within 1/2^SUB_BITS (6.25%) of the times in it, from
+  nanoseconds to minutes, in a few kilobytes per class. The counters are not
+  locked; the element belongs on the one thread that sends on the interface.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item OFFSET
+
+  Unsigned. Offset of the IP header in the packet data. Default is 14, for
+  the Ethernet frames a ToDevice sends.
+
+  =back
+
+  =h stats read-only
+  One line per class that saw packets: its name, the number of packets,
+  and the minimum, mean, median, 90th, 99th and 99.9th percentile and
+  maximum time in microseconds, the percentiles read off the histogram.
+  A last line gives the number of unstamped packets.
+
+  =h histogram read-only
+  The buckets that counted packets, one per line: the class, the lowest
+  time of the bucket in nanoseconds and the count.
+
+  =h reset write-only
+  Clears the histograms.
+
+  =e
+  in :: FromDevice(eth0) -> SetTimestamp(FIRST true) -> ...
+  ... -> Queue -> JitterUnqueue(0.1) -> OLSRResidenceTime -> ToDevice(eth0);
+
+  =a SetTimestamp, OLSRPrioSched */
+
+#ifndef OLSR_RESIDENCE_TIME_HH
+#define OLSR_RESIDENCE_TIME_HH
+
+#include <click/element.hh>
+#include <click/straccum.hh>
+
+CLICK_DECLS
+
+class OLSRResidenceTime : public Element { public:
+
+  OLSRResidenceTime();
+  ~OLSRResidenceTime();
+
+  const char *class_name() const	{ return "OLSRResidenceTime"; }
+  const char *port_count() const	{ return "1/1"; }
+  const char *processing() const	{ return AGNOSTIC; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+
+private:
+
+  enum { CLASS_HELLO, CLASS_TC, CLASS_MID, CLASS_HNA, CLASS_CONTROL,
+	 CLASS_DATA, CLASS_OTHER, NCLASSES };
+
+  // log-linear histogram of times in nanoseconds
+  enum { SUB_BITS = 4, SUB_BUCKETS = 1 << SUB_BITS, MAX_SHIFT = 40,
+	 NBUCKETS = (MAX_SHIFT - SUB_BITS + 1) * SUB_BUCKETS + SUB_BUCKETS };
+  struct Histogram {
+    uint32_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint32_t buckets[NBUCKETS];
+
+    void clear();
+    void add(uint64_t nsec);
+    // the lowest time of bucket b
+    static uint64_t bucket_low(int b);
+    uint64_t percentile(double fraction) const;
+  };
+
+  unsigned _offset;
+  Histogram _hist[NCLASSES];
+  uint32_t _unstamped;
+
+  int classify(Packet *p) const;
+
+  static String read_stats(Element *, void *);
+  static String read_histogram(Element *, void *);
+  static int reset_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,176 @@
+#ifndef OLSR_ROUTE_COMPRESS_HH
+#define OLSR_ROUTE_COMPRESS_HH
+
+#include <click/ipaddress.hh>
+#include <click/bighashmap.hh>
+#include <click/vector.hh>
+#include "../ip/iproutetable.hh"
+#include "ippair.hh"
+
+CLICK_DECLS
+
+// Optimal route table compression (ORTC, Draves et al., INFOCOM 1999) of the
+// routes of OLSRRoutingTable with AGGREGATE: the routes are put in a binary
+// trie, every node gets the set of next hops (gateway and port) that would
+// serve all addresses below it, the intersection of its children's sets if
+// that is not empty and their union otherwise, and a route is written only
+// where the next hop chosen for the parent is not in a node's set. Routes
+// with the same next hop that are adjacent or covered by a shorter one thus
+// merge, and the lookup forwards every address exactly as before.
+//
+// Unlike plain ORTC, no route may cover an address the table has no route
+// for, since the lookup elements have no null route to carve it out again:
+// a node above such an address gets no route, and the compression only
+// merges within the address space the table covers completely.
+class OLSRRouteCompressor{
+public:
+
+  typedef HashMap<IPPair, IPRoute> RouteTable;
+
+  // writes to out the compressed form of table; routes with non-contiguous
+  // netmasks are copied unchanged. A route of out has the extra of the
+  // route of table with the same prefix and next hop, or 0
+  void compress(const RouteTable &table, RouteTable &out) {
+    _nodes.clear();
+    _sets.clear();
+    _hops.clear();
+    _hops.push_back(IPRoute());	//NO_ROUTE
+    _nodes.push_back(Node());
+    for (RouteTable::const_iterator iter = table.begin(); iter != table.end(); iter++) {
+      const IPRoute &route = iter.value();
+      int len = route.mask.mask_to_prefix_len();
+      if (len < 0) {
+	out.insert(iter.key(), route);
+	continue;
+      }
+      uint32_t addr = ntohl(route.addr.addr());
+      int n = 0;
+      for (int i = 0; i < len; i++) {
+	int bit = (addr >> (31 - i)) & 1;
+	if (_nodes[n].child[bit] < 0) {
+	  _nodes[n].child[bit] = _nodes.size();
+	  _nodes.push_back(Node());
+	}
+	n = _nodes[n].child[bit];
+      }
+      _nodes[n].hop = hop_id(route);
+      _nodes[n].extra = route.extra;
+    }
+    build(0, NO_ROUTE);
+    emit(0, 0, 0, NO_ROUTE, out);
+  }
+
+  // trie nodes and next hop set entries of the last compression
+  size_t bytes() const {
+    return _nodes.capacity() * sizeof(Node) + _sets.capacity() * sizeof(int)
+      + _hops.capacity() * sizeof(IPRoute);
+  }
+
+private:
+
+  enum { NO_ROUTE = 0 };
+
+  struct Node {
+    int child[2];
+    int hop;		// index into _hops of the route with this prefix, or -1
+    int extra;
+    int set;		// the node's next hop set is _sets[set, set + set_size)
+    int set_size;
+    Node() : hop(-1), extra(0), set(0), set_size(0) { child[0] = child[1] = -1; }
+  };
+
+  Vector<Node> _nodes;
+  Vector<int> _sets;
+  Vector<IPRoute> _hops;	// the distinct next hops, gateway and port
+
+  int hop_id(const IPRoute &route) {
+    for (int i = 1; i < _hops.size(); i++)
+      if (_hops[i].gw == route.gw && _hops[i].port == route.port)
+	return i;
+    _hops.push_back(route);
+    return _hops.size() - 1;
+  }
+
+  bool in_set(const Node &node, int hop) const {
+    for (int i = node.set; i < node.set + node.set_size; i++)
+      if (_sets[i] == hop)
+	return true;
+    return false;
+  }
+
+  // first and second passes: completes the trie, so that every node has
+  // two children or none, and gives each node its next hop set, sorted
+  void build(int n, int inherited) {
+    if (_nodes[n].hop >= 0)
+      inherited = _nodes[n].hop;
+    if (_nodes[n].child[0] < 0 && _nodes[n].child[1] < 0) {
+      _nodes[n].set = _sets.size();
+      _nodes[n].set_size = 1;
+      _sets.push_back(inherited);
+      return;
+    }
+    for (int bit = 0; bit < 2; bit++) {
+      if (_nodes[n].child[bit] < 0) {
+	_nodes[n].child[bit] = _nodes.size();
+	_nodes.push_back(Node());
+      }
+      build(_nodes[n].child[bit], inherited);
+    }
+
+    const Node &a = _nodes[_nodes[n].child[0]], &b = _nodes[_nodes[n].child[1]];
+    int set = _sets.size();
+    if (_sets[a.set] == NO_ROUTE || _sets[b.set] == NO_ROUTE)
+      _sets.push_back(NO_ROUTE);	//an uncovered address below: no route here
+    else {
+      //intersection of the sorted sets, or their union if it is empty
+      int i = a.set, j = b.set, ie = a.set + a.set_size, je = b.set + b.set_size;
+      while (i < ie && j < je)
+	if (_sets[i] < _sets[j])
+	  i++;
+	else if (_sets[j] < _sets[i])
+	  j++;
+	else {
+	  int hop = _sets[i];
+	  _sets.push_back(hop);
+	  i++, j++;
+	}
+      if (_sets.size() == set)
+	for (i = a.set, j = b.set; i < ie || j < je; ) {
+	  int hop;
+	  if (j == je || (i < ie && _sets[i] < _sets[j]))
+	    hop = _sets[i++];
+	  else if (i == ie || _sets[j] < _sets[i])
+	    hop = _sets[j++];
+	  else
+	    hop = _sets[i++], j++;
+	  _sets.push_back(hop);
+	}
+    }
+    _nodes[n].set = set;
+    _nodes[n].set_size = _sets.size() - set;
+  }
+
+  // third pass: a route wherever the next hop chosen above does not serve
+  // the whole subtree, preferring the node's own next hop
+  void emit(int n, uint32_t addr, int len, int above, RouteTable &out) {
+    const Node &node = _nodes[n];
+    int chosen = above;
+    if (!in_set(node, above)) {
+      chosen = (node.hop > NO_ROUTE && in_set(node, node.hop) ? node.hop : _sets[node.set]);
+      if (chosen != NO_ROUTE) {
+	IPRoute route(IPAddress(htonl(addr)), IPAddress::make_prefix(len),
+		      _hops[chosen].gw, _hops[chosen].port);
+	route.extra = (chosen == node.hop ? node.extra : 0);
+	out.insert(IPPair(route.addr, route.mask), route);
+      }
+    }
+    if (node.child[0] >= 0) {
+      emit(node.child[0], addr, len + 1, chosen, out);
+      emit(node.child[1], addr | (0x80000000U >> len), len + 1, chosen, out);
+    }
+  }
+
+};
+
+CLICK_ENDDECLS
+#endif
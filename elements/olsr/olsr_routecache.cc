@@ -0,0 +1,147 @@
+/*
+ * olsr_routecache.{cc,hh} -- direct-mapped cache in front of the OLSR route
+ * lookup
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include "olsr_routecache.hh"
+
+CLICK_DECLS
+
+OLSRRouteCache::OLSRRouteCache()
+  : _entries(0)
+{
+}
+
+
+OLSRRouteCache::~OLSRRouteCache()
+{
+}
+
+
+int
+OLSRRouteCache::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *routing_table, *route_table;
+  _size = 1024;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRRoutingTable element", &routing_table,
+		  cpElement, "IPRouteTable element", &route_table,
+		  cpKeywords,
+		  "SIZE", cpInteger, "number of cache entries", &_size,
+		  0) < 0)
+    return -1;
+
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("%s is not an OLSRRoutingTable", routing_table->name().c_str());
+  if (!(_routeTable = (IPRouteTable *) route_table->cast("IPRouteTable")))
+    return errh->error("%s is not an IPRouteTable", route_table->name().c_str());
+  if (_size <= 0 || _size > (1 << 24))
+    return errh->error("SIZE must be between 1 and %d", 1 << 24);
+  return 0;
+}
+
+
+int
+OLSRRouteCache::initialize(ErrorHandler *errh)
+{
+  int size = 1;
+  while (size < _size)
+    size <<= 1;
+  _size = size;
+  _mask = size - 1;
+  if (!(_entries = new Entry[size]))
+    return errh->error("out of memory");
+  clear();
+  return 0;
+}
+
+
+void
+OLSRRouteCache::cleanup(CleanupStage)
+{
+  delete[] _entries;
+  _entries = 0;
+}
+
+
+/**
+ * invalidates all entries; an entry is valid only while its generation is
+ * the one of the routing table, which never goes back
+ */
+void
+OLSRRouteCache::clear()
+{
+  unsigned stale = _routingTable->generation() - 1;
+  for (int i = 0; i < _size; i++) {
+    _entries[i].dst = IPAddress();
+    _entries[i].generation = stale;
+  }
+  _hits = _misses = 0;
+}
+
+
+void
+OLSRRouteCache::push(int, Packet *p)
+{
+  IPAddress dst = p->dst_ip_anno();
+  uint32_t a = ntohl(dst.addr());
+  Entry &e = _entries[(a ^ (a >> 12)) & _mask];
+  unsigned generation = _routingTable->generation();
+
+  if (e.dst == dst && e.generation == generation)
+    _hits++;
+  else {
+    e.dst = dst;
+    e.port = _routeTable->lookup_route(dst, e.gw);
+    e.generation = generation;
+    _misses++;
+  }
+
+  if (e.port >= 0 && e.port < noutputs()) {
+    if (e.gw)
+      p->set_dst_ip_anno(e.gw);
+    output(e.port).push(p);
+  } else {
+    static int complained = 0;
+    if (++complained <= 5)
+      click_chatter("%s: no route for %s", name().c_str(), dst.unparse().c_str());
+    p->kill();
+  }
+}
+
+
+String
+OLSRRouteCache::read_handler(Element *e, void *thunk)
+{
+  OLSRRouteCache *rc = (OLSRRouteCache *) e;
+  switch ((intptr_t) thunk) {
+  case 0:
+    return String(rc->_hits) + "\n";
+  default:
+    return String(rc->_misses) + "\n";
+  }
+}
+
+
+int
+OLSRRouteCache::clear_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRRouteCache *rc = (OLSRRouteCache *) e;
+  rc->clear();
+  return 0;
+}
+
+
+void
+OLSRRouteCache::add_handlers()
+{
+  add_read_handler("hits", read_handler, (void *) 0);
+  add_read_handler("misses", read_handler, (void *) 1);
+  add_write_handler("clear", clear_handler, (void *) 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRRouteCache);
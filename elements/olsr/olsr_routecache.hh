@@ -0,0 +1,106 @@
+/*
+  =c
+  OLSRRouteCache(OLSRRoutingTable element, IPRouteTable element [, KEYWORDS])
+
+  =s
+  OLSR specific element, caches route lookups of the data path
+
+  =io
+  One input, as many outputs as the routes use
+
+  =d
+  Takes the place of the lookup element on the data path: expects a
+  destination IP address annotation with each packet, sets the destination
+  annotation to the gateway of the matching route (if it has one), and emits
+  the packet on the route's output port, exactly as the IPRouteTable element
+  given as second argument would. Packets without a route are dropped.
+
+  The results are kept in a direct-mapped cache of SIZE entries indexed by
+  the destination address, so a packet to a recently seen destination costs
+  a single probe; on a miss the IPRouteTable element is asked and the entry
+  replaced. Each entry records the generation() of the OLSRRoutingTable
+  element given as first argument, which increases whenever the computed
+  routes change, so every entry is invalidated at once by a route change
+  without touching the cache. Routes changed through the handlers of the
+  lookup element do not change the generation; write the C<clear> handler
+  after those.
+
+  The entries are not locked; on an SMP router, give each forwarding thread
+  its own OLSRRouteCache.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item SIZE
+
+  Integer. Number of cache entries, rounded up to a power of two. Default is
+  1024.
+
+  =back
+
+  =h hits read-only
+  Lookups answered from the cache.
+
+  =h misses read-only
+  Lookups passed on to the IPRouteTable element.
+
+  =h clear write-only
+  Invalidates all entries and resets the counters.
+
+  =a
+  OLSRRadixIPLookup, OLSRLinearIPLookup, OLSRRoutingTable */
+
+#ifndef OLSR_ROUTECACHE_HH
+#define OLSR_ROUTECACHE_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include "../ip/iproutetable.hh"
+#include "olsr_rtable.hh"
+
+CLICK_DECLS
+
+class OLSRRouteCache : public Element { public:
+
+  OLSRRouteCache();
+  ~OLSRRouteCache();
+
+  const char *class_name() const	{ return "OLSRRouteCache"; }
+  const char *port_count() const	{ return "1/-"; }
+  const char *processing() const	{ return PUSH; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void push(int, Packet *);
+
+private:
+
+  struct Entry {
+    IPAddress dst;
+    IPAddress gw;
+    int port;
+    unsigned generation;
+  };
+
+  OLSRRoutingTable *_routingTable;
+  IPRouteTable *_routeTable;
+  Entry *_entries;
+  uint32_t _mask;		// number of entries - 1
+  int _size;
+
+  uint32_t _hits;
+  uint32_t _misses;
+
+  void clear();
+
+  static String read_handler(Element *, void *);
+  static int clear_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
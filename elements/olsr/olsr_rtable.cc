@@ -5,17 +5,52 @@
 #include <click/router.hh>
 #include <click/confparse.hh>
 #include <click/ipaddress.hh>
+#include <click/straccum.hh>
+#include <click/algorithm.hh>
+#include <click/standard/scheduleinfo.hh>
 #include "ippair.hh"
 #include "olsr_rtable.hh"
 #include "click_olsr.hh"
 
-// #define profiling
-
 CLICK_DECLS
 
 OLSRRoutingTable::OLSRRoutingTable()
+		: _lazy_timer(this), _task(this), _timer(this)
 {
 	_visitorInfo = 0;
+	_min_interval = 0;
+	_max_delay = 1000;
+	_scheduled = _scheduled_full = false;
+	_last_computation = Timestamp();
+	_schedule_requests = _scheduled_computations = _coalesced = 0;
+	_inputs_valid = false;
+	_unchanged_skips = 0;
+	_incremental = true;
+	_validate = false;
+	_full_rebuild_needed = true;
+	_full_rebuilds = _incremental_updates = _repaired_routes = _validation_failures = 0;
+	_link_quality = false;
+	_backup_routes = false;
+	_fail_overs = _routes_failed_over = 0;
+	_multipath = 1;
+	_gateway_balance = false;
+	_gateway_hysteresis = 20;
+	_rebalances = 0;
+	_generation = 0;
+	_route_changes = 0;
+	_threads = 1;
+	_parallel_threshold = 1000;
+	_parallel_computations = 0;
+	_next_event = 1;
+	_events_stamped = _events_dropped = 0;
+	_installed_event = 0;
+	_aggregate = false;
+	_lookup_changes = 0;
+	_lazy = false;
+	_lazy_timeout = olsr_msec( 30000 );
+	_misses = _misses_dropped = 0;
+	for ( int i = 0; i < NEVENT_TYPES; i++ )
+		_events_unchanged[i] = 0;
 }
 
 OLSRRoutingTable::~OLSRRoutingTable()
@@ -25,6 +60,9 @@ OLSRRoutingTable::~OLSRRoutingTable()
 int
 OLSRRoutingTable::configure( Vector<String> &conf, ErrorHandler *errh )
 {
+	Element *route_table, *trace = 0;
+	uint32_t trace_mask = 0xFFFFFFFFU;
+	int lazy_timeout = 30000;
 	if ( cp_va_parse( conf, this, errh,
 	                  cpElement, "Neighbor InfoBase Element", &_neighborInfo,
 	                  cpElement, "Link InfoBase Element", &_linkInfo,
@@ -32,13 +70,51 @@ OLSRRoutingTable::configure( Vector<String> &conf, ErrorHandler *errh )
 	                  cpElement, "Interface InfoBase", &_interfaceInfo,
 	                  cpElement, "local Interface Infobase", &_localIfaces,
 	                  cpElement, "association Infobase", &_associationInfo,
-	                  cpElement, "Routing table", &_linearIPlookup,
+	                  cpElement, "Routing table", &route_table,
 	                  cpIPAddress, "own IPAddress", &_myIP,
 	                  cpKeywords,
 	                  "SUBNET_MASK", cpIPAddress, "subnet mask", &_myMask,
 	                  "VISITOR_INFO", cpElement, "visitor Infobase", &_visitorInfo,
+	                  "INCREMENTAL", cpBool, "repair routes incrementally", &_incremental,
+	                  "MIN_INTERVAL", cpInteger, "minimum interval between computations (msecs)", &_min_interval,
+	                  "MAX_DELAY", cpInteger, "maximum delay of a scheduled computation (msecs)", &_max_delay,
+	                  "VALIDATE", cpBool, "check incremental updates against a full rebuild", &_validate,
+	                  "BACKUP_ROUTES", cpBool, "select loop-free alternate next hops", &_backup_routes,
+	                  "MULTIPATH", cpInteger, "maximum number of equal-cost next hops", &_multipath,
+	                  "GATEWAY_BALANCE", cpBool, "share networks among their gateways", &_gateway_balance,
+	                  "GATEWAY_HYSTERESIS", cpInteger, "free capacity change to rebalance (percent)", &_gateway_hysteresis,
+	                  "LINK_QUALITY", cpBool, "route by link quality", &_link_quality,
+	                  "THREADS", cpInteger, "threads sharing large computations", &_threads,
+	                  "PARALLEL_THRESHOLD", cpUnsigned, "topology tuples from which to use THREADS", &_parallel_threshold,
+	                  "AGGREGATE", cpBool, "compress the routes written to the lookup element", &_aggregate,
+	                  "LAZY", cpBool, "install host routes only once traffic misses them", &_lazy,
+	                  "LAZY_TIMEOUT", cpInteger, "working set timeout (msecs)", &lazy_timeout,
+	                  "TRACE", cpElement, "OLSRTrace element", &trace,
+	                  "TRACE_MASK", cpUnsigned, "events to trace", &trace_mask,
 	                  0 ) < 0 )
 		return -1;
+	if ( set_trace( trace, trace_mask, this, errh ) < 0 )
+		return -1;
+	if ( _link_quality && _backup_routes )
+		return errh->error( "BACKUP_ROUTES cannot be combined with LINK_QUALITY" );
+	if ( _link_quality && _multipath > 1 )
+		return errh->error( "MULTIPATH cannot be combined with LINK_QUALITY" );
+	if ( _multipath < 1 )
+		return errh->error( "MULTIPATH must be at least 1" );
+	if ( _gateway_hysteresis < 0 )
+		return errh->error( "GATEWAY_HYSTERESIS must not be negative" );
+	if ( _threads < 1 || _threads > OLSRWorkerPool::MAX_THREADS )
+		return errh->error( "THREADS must be between 1 and %d", ( int ) OLSRWorkerPool::MAX_THREADS );
+	if ( _link_quality )
+		_incremental = false;	//changed weights need a full computation anyway
+	if ( !( _routeTable = ( IPRouteTable * ) route_table->cast( "IPRouteTable" ) ) )
+		return errh->error( "%s is not an IPRouteTable element", route_table->name().c_str() );
+	_radixLookup = ( OLSRRadixIPLookup * ) route_table->cast( "OLSRRadixIPLookup" );
+	if ( _lazy && !_radixLookup )
+		return errh->error( "LAZY needs an OLSRRadixIPLookup" );
+	if ( lazy_timeout <= 0 )
+		return errh->error( "LAZY_TIMEOUT must be greater than 0" );
+	_lazy_timeout = olsr_msec( lazy_timeout );
 
 	_errh = errh;
 	return 0;
@@ -57,285 +133,1816 @@ OLSRRoutingTable::initialize( ErrorHandler *errh )
 	if ( !_interfaceInfo )
 		return errh->error( "Could not find Interface InfoBase" );
 
+	ScheduleInfo::initialize_task( this, &_task, false, errh );
+	_timer.initialize( this );
+	_lazy_timer.initialize( this );
+	if ( _lazy )
+		_radixLookup->set_miss_handler( this );
+	publish_snapshot();
+	if ( _threads > 1 && _workers.start( _threads ) < _threads )
+		errh->warning( "only %d of %d THREADS available", _workers.slices(), _threads );
 	return 0;
 }
 
 
 void
 OLSRRoutingTable::uninitialize()
-{}
+{
+	_task.unschedule();
+	_timer.unschedule();
+	_lazy_timer.unschedule();
+	if ( _lazy )
+		_radixLookup->set_miss_handler( 0 );
+	_workers.stop();
+}
+
+
+void
+OLSRRoutingTable::take_state( Element *e, ErrorHandler * )
+{
+	if ( !e->cast( "OLSRRoutingTable" ) )
+		return;
+	// The routes are derived state, and the new route table element starts
+	// empty: compute them all from the infobases, which take their tuples
+	// in this same pass, as soon as the new configuration runs.
+	schedule_compute_routing_table();
+}
 
 
 void
 OLSRRoutingTable::print_routing_table()
 {
-	struct timeval now;
-	click_gettimeofday( &now );
-	click_chatter( "%f | %s | %s\n", Timestamp( now ).doubleval(), _myIP.unparse().c_str(), _linearIPlookup->dump_routes().c_str() );
+	char buf[IPAddress::unparse_buflen];
+	click_chatter( "%f | %s | %s\n", Timestamp::now().doubleval(), _myIP.unparse( buf ), _routeTable->dump_routes().c_str() );
 }
 
 
 void
-OLSRRoutingTable::compute_routing_table()
+OLSRRoutingTable::set_route( RouteMap &routes, const IPAddress &dest, const IPAddress &gw, int port, int dist, const IPAddress &last, int cost )
 {
-	HashMap<IPAddress, void *> *neighbor_set = _neighborInfo->get_neighbor_set();
-	HashMap<IPPair, void *> *link_set = _linkInfo->get_link_set();
-	HashMap<IPPair, void*> *twohop_set = _neighborInfo->get_twohop_set();
-	HashMap<IPPair, void*> *topology_set = _topologyInfo->get_topology_set();
-	HashMap<IPAddress, void*> *interface_set = _interfaceInfo->get_interface_set();
-	HashMap<IPPair, void*> *association_set = _associationInfo->get_association_set();
-	IPAddress netmask32( "255.255.255.255" );
-	IPRoute newiproute;
-	const IPRoute *iproute = 0;
+	RouteEntry entry;
+	entry.gw = gw;
+	entry.port = port;
+	entry.dist = dist;
+	entry.last = last;
+	entry.cost = cost;
+	routes.insert( dest, entry );
+}
 
-#ifdef profiling
 
-	click_chatter ( "%f | %s | CALCULATING ROUTINGTABLE\n", timeval2double( now ), _myIP.unparse().c_str() );
-	click_chatter ( "%f | %s | Neighbors: %d\ttwohopset: %d\ttopology_set: %d\tlink_set: %d\t interface_set %d\t\n", timeval2double( now ), _myIP.unparse().c_str(), neighbor_set->size(), twohop_set->size(), topology_set->size(), link_set->size(), interface_set->size() );
-	struct timeval start;
-	struct timeval now;
-	double time_dif;
-	click_gettimeofday( &start );
-#endif
+/**
+ * RFC ch 10 steps 1-4: computes the routes to all neighbors, twohop
+ * neighbors and nodes further away into routes.
+ */
+void
+OLSRRoutingTable::compute_host_routes( RouteMap &routes )
+{
+	OLSRNeighborInfoBase::NeighborSet *neighbor_set = _neighborInfo->get_neighbor_set();
+	click_cycles_t start = click_get_cycles();
 
+	//step 1 - delete all entries
+	routes.clear();
 
+	//step 2 - adding routes to symmetric neighbors
+	for ( OLSRNeighborInfoBase::NeighborSet::iterator iter = neighbor_set->begin(); iter != neighbor_set->end(); iter++ ) {
+		neighbor_data *neighbor = &iter.value();
+		if ( neighbor->N_status == OLSR_SYM_NEIGH ) {
+			link_data *lastlinktoneighbor = 0;
+			bool neigh_main_addr_added = false;
+			int cost = _link_quality ? _linkInfo->link_cost( neighbor->N_neigh_main_addr ) : 0;
+			const OLSRLinkInfoBase::LinkList *links = _linkInfo->links_to( neighbor->N_neigh_main_addr );
+			for ( int i = 0; links && i < links->size(); i++ ) {
+				link_data *link = ( *links )[i];
+				lastlinktoneighbor = link;
+				set_route( routes, link->L_neigh_iface_addr, link->L_neigh_iface_addr,
+				           _localIfaces->get_index( link->L_local_iface_addr ), 1, _myIP, cost );
+				if ( neighbor->N_neigh_main_addr == link->L_neigh_iface_addr )
+					neigh_main_addr_added = true;
+			}
+			if ( ! neigh_main_addr_added && lastlinktoneighbor != 0 ) //(lastlinktoneighbor != 0) should never fail
+				set_route( routes, neighbor->N_neigh_main_addr, lastlinktoneighbor->L_neigh_iface_addr,
+				           _localIfaces->get_index( lastlinktoneighbor->L_local_iface_addr ), 1, _myIP, cost );
+		}
+	}
 
-	/*
-	_neighborInfo->print_neighbor_set();
-	_neighborInfo->print_mpr_set();
-	_neighborInfo->print_mpr_selector_set();
-	_neighborInfo->print_twohop_set();
-	_topologyInfo->print_topology();
-	*/
+	_profile[PROFILE_NEIGHBORS].add( click_get_cycles() - start );
 
+	//steps 3 and 4 - twohop neighbors and nodes further away
+	compute_distant_routes( routes );
+}
 
-	//RFC ch 10 'Routing table calculation' - step 1 - delete all entries
-	_linearIPlookup->clear();
-#ifdef profiling
 
-	click_gettimeofday( &now );
-	time_dif = ( now.tv_sec - start.tv_sec ) + ( now.tv_usec - start.tv_usec ) / 1E6;
-	click_chatter ( "%f | %s | time part 1 %f", timeval2double( now ), _myIP.unparse().c_str(), time_dif );
-	click_gettimeofday( &start );
-#endif
+/**
+ * RFC ch 10 steps 3 and 4 in one pass: Dijkstra's algorithm from the routes
+ * to the symmetric neighbors over the twohop set and the topology set, whose
+ * destinations_from() index serves as adjacency list. Every link weighs 1,
+ * which gives the RFC's breadth first hop counts, or the ETX of the link
+ * with LINK_QUALITY. Among equally short paths the first one found wins.
+ */
+void
+OLSRRoutingTable::compute_distant_routes( RouteMap &routes )
+{
+	OLSRNeighborInfoBase::NeighborSet *neighbor_set = _neighborInfo->get_neighbor_set();
+	OLSRNeighborInfoBase::TwoHopSet *twohop_set = _neighborInfo->get_twohop_set();
+	Vector<RepairItem> heap;
+	int order = 0;
+	bool parallel = !_link_quality && parallel_computation();
+	click_cycles_t start = click_get_cycles();
 
+	for ( OLSRNeighborInfoBase::TwoHopSet::iterator iter = twohop_set->begin(); iter != twohop_set->end(); iter++ ) {
+		twohop_data *twohop = &iter.value();
+		if ( twohop->N_twohop_addr == _myIP || routes.findp( twohop->N_twohop_addr ) )
+			continue;
+		RouteEntry *neighbor_route = routes.findp( twohop->N_neigh_main_addr );
+		neighbor_data *neighbor = neighbor_set->findp( twohop->N_neigh_main_addr );
+		if ( neighbor_route && neighbor && neighbor->N_willingness > OLSR_WILL_NEVER ) {
+			RepairItem item;
+			item.dist = 2;
+			item.dest = twohop->N_twohop_addr;
+			item.last = twohop->N_neigh_main_addr;
+			item.cost = neighbor_route->cost + ( _link_quality ? twohop->N_cost : 1 );
+			item.order = order++;
+			heap.push_back( item );
+			if ( !parallel )	//else all at distance 2, in order
+				push_heap( heap.begin(), heap.end(), cost_less() );
+		}
+	}
+	click_cycles_t seeded = click_get_cycles();
+	_profile[PROFILE_TWOHOP].add( seeded - start );
 
-	//step 2 - adding routes to symmetric neighbors
-	for ( HashMap<IPAddress, void*>::iterator iter = neighbor_set->begin(); iter != neighbor_set->end(); iter++ ) {
-		neighbor_data *neighbor = ( neighbor_data * ) iter.value();
-		if ( neighbor->N_status == OLSR_SYM_NEIGH ) {
-			link_data * link = 0;
-			link_data *lastlinktoneighbor = 0;
-			bool neigh_main_addr_added = false;
-			for ( HashMap<IPPair, void *>::iterator i = link_set->begin(); i != link_set->end(); i++ ) {
-				link = ( link_data * ) i.value();
-				IPAddress neigh_main_addr = _interfaceInfo->get_main_address( link->L_neigh_iface_addr );
-				if ( neigh_main_addr == neighbor->N_neigh_main_addr ) {
-					lastlinktoneighbor = link;
-					newiproute.addr = link->L_neigh_iface_addr;
-					newiproute.mask = netmask32;
-					newiproute.gw = link->L_neigh_iface_addr;
-					newiproute.port = _localIfaces->get_index( link->L_local_iface_addr );
-					newiproute.extra = 1;
-					_linearIPlookup->add_route( newiproute, false, 0, _errh );
-					// 					_linearIPlookup->add_route( link->L_neigh_iface_addr,
-					// 					                            netmask32,
-					// 					                            link->L_neigh_iface_addr,
-					// 					                            _localIfaces->get_index( link->L_local_iface_addr ),
-					// 					                            1,
-					// 					                            _errh );
-
-					if ( neigh_main_addr == link->L_neigh_iface_addr )
-						neigh_main_addr_added = true;
-					//	  click_chatter ("adding neighbor %s\n",link->L_neigh_iface_addr.unparse().c_str());
+	if ( parallel ) {
+		expand_levels( routes, heap );
+		_profile[PROFILE_TOPOLOGY].add( click_get_cycles() - seeded );
+		return;
+	}
+
+	while ( !heap.empty() ) {
+		pop_heap( heap.begin(), heap.end(), cost_less() );
+		RepairItem item = heap.back();
+		heap.pop_back();
+		if ( routes.findp( item.dest ) )
+			continue;
+		RouteEntry via = routes.find( item.last );
+		set_route( routes, item.dest, via.gw, via.port, item.dist, item.last, item.cost );
+		if ( const Vector<IPAddress> *dests = _topologyInfo->destinations_from( item.dest ) )
+			for ( int j = 0; j < dests->size(); j++ ) {
+				const IPAddress &dest = ( *dests )[j];
+				if ( dest == _myIP || routes.findp( dest ) )
+					continue;
+				int weight = 1;
+				if ( _link_quality ) {
+					topology_data *tuple = _topologyInfo->find_tuple( dest, item.dest );
+					weight = tuple ? tuple->T_cost : OLSR_ETX_ONE;
 				}
+				RepairItem next;
+				next.dist = item.dist + 1;
+				next.dest = dest;
+				next.last = item.dest;
+				next.cost = item.cost + weight;
+				next.order = order++;
+				heap.push_back( next );
+				push_heap( heap.begin(), heap.end(), cost_less() );
 			}
-			if ( ! neigh_main_addr_added && lastlinktoneighbor != 0 ) { //(lastlinktoneighbor != 0) should never fail
-				newiproute.addr = _interfaceInfo->get_main_address( lastlinktoneighbor->L_neigh_iface_addr );
-				newiproute.mask = netmask32;
-				newiproute.gw = link->L_neigh_iface_addr;
-				newiproute.port = _localIfaces->get_index( link->L_local_iface_addr );
-				newiproute.extra = 1;
-				_linearIPlookup->add_route( newiproute, false, 0, _errh );
-				// 				_linearIPlookup->add_route( _interfaceInfo->get_main_address( lastlinktoneighbor->L_neigh_iface_addr ),
-				// 				                            netmask32,
-				// 				                            lastlinktoneighbor->L_neigh_iface_addr,
-				// 				                            _localIfaces->get_index( lastlinktoneighbor->L_local_iface_addr ),
-				// 				                            1,
-				// 				                            _errh );
-
-				// 	click_chatter ("adding MAIN neighbor %s\n",lastlinktoneighbor->L_neigh_iface_addr.unparse().c_str());
-			}
+	}
+	_profile[PROFILE_TOPOLOGY].add( click_get_cycles() - seeded );
+}
+
+
+/**
+ * whether THREADS share this computation
+ */
+bool
+OLSRRoutingTable::parallel_computation()
+{
+	return _workers.slices() > 1 && _topologyInfo->get_topology_set()->size() >= _parallel_threshold;
+}
+
+
+/**
+ * steps 3 and 4 with THREADS. With every link weighing 1, Dijkstra's
+ * algorithm reaches the nodes one hop count at a time, each level in the
+ * order of the nodes that found them. level holds the 2-hop candidates in
+ * that order. The candidates of a level are claimed here, then the workers
+ * expand slices of the nodes claimed over the topology set, reading routes
+ * (HashMap lookups do not rearrange the buckets) but not changing them,
+ * and their finds, concatenated in slice order, are the next level's
+ * candidates in the sequential order.
+ */
+void
+OLSRRoutingTable::expand_levels( RouteMap &routes, Vector<RepairItem> &level )
+{
+	ExpandJob job;
+	Vector<RepairItem> reached;
+	job.topology = _topologyInfo;
+	job.routes = &routes;
+	job.my_ip = _myIP;
+	job.level = &reached;
+
+	while ( !level.empty() ) {
+		reached.clear();
+		for ( int i = 0; i < level.size(); i++ ) {
+			const RepairItem &item = level[i];
+			if ( routes.findp( item.dest ) )
+				continue;
+			RouteEntry via = routes.find( item.last );
+			set_route( routes, item.dest, via.gw, via.port, item.dist, item.last, item.cost );
+			reached.push_back( item );
 		}
+		for ( int s = 0; s < _workers.slices(); s++ )
+			job.found[s].clear();
+		_workers.run( expand_slice, &job, reached.size() );
+		level.clear();
+		for ( int s = 0; s < _workers.slices(); s++ )
+			for ( int i = 0; i < job.found[s].size(); i++ )
+				level.push_back( job.found[s][i] );
 	}
+}
 
-#ifdef profiling
 
-	click_gettimeofday( &now );
-	time_dif = ( now.tv_sec - start.tv_sec ) + ( now.tv_usec - start.tv_usec ) / 1E6;
-	click_chatter ( "%f | %s | time part 2 %f", timeval2double( now ), _myIP.unparse().c_str(), time_dif );
-	click_gettimeofday( &start );
-#endif
+void
+OLSRRoutingTable::expand_slice( void *thunk, int slice, int begin, int end )
+{
+	ExpandJob *job = ( ExpandJob * ) thunk;
+	Vector<RepairItem> &found = job->found[slice];
+	for ( int i = begin; i < end; i++ ) {
+		const RepairItem &from = ( *job->level )[i];
+		const Vector<IPAddress> *dests = job->topology->destinations_from( from.dest );
+		for ( int j = 0; dests && j < dests->size(); j++ ) {
+			const IPAddress &dest = ( *dests )[j];
+			if ( dest == job->my_ip || job->routes->findp( dest ) )
+				continue;
+			RepairItem next;
+			next.dist = from.dist + 1;
+			next.dest = dest;
+			next.last = from.dest;
+			next.cost = from.cost + 1;
+			next.order = 0;
+			found.push_back( next );
+		}
+	}
+}
+
+
+/**
+ * a route to from has been added or shortened; relax the topology tuples
+ * leading away from it, breadth first.
+ */
+void
+OLSRRoutingTable::propagate_routes( const IPAddress &from )
+{
+	Vector<IPAddress> queue;
+	queue.push_back( from );
+
+	for ( int i = 0; i < queue.size(); i++ ) {
+		const Vector<IPAddress> *dests = _topologyInfo->destinations_from( queue[i] );
+		if ( !dests )
+			continue;
+		RouteEntry via = _routes.find( queue[i] );
+		for ( int j = 0; j < dests->size(); j++ ) {
+			const IPAddress &dest = ( *dests )[j];
+			RouteEntry *route = _routes.findp( dest );
+			if ( dest == _myIP || ( route && ( route->dist < 3 || route->dist <= via.dist + 1 ) ) )
+				continue;
+			set_route( _routes, dest, via.gw, via.port, via.dist + 1, queue[i] );
+			_repaired_routes++;
+			queue.push_back( dest );
+		}
+	}
+}
 
-	//step 3 - adding routes to twohop neighbors
-	for ( HashMap<IPPair, void*>::iterator iter = twohop_set->begin(); iter != twohop_set->end(); iter++ ) {
-		twohop_data *twohop = ( twohop_data * ) iter.value();
-		if ( twohop->N_twohop_addr != _myIP ) {
-			//do not add neighbors, do not add twohop neighbors that have already been added
-			if ( !_linearIPlookup->lookup_iproute( twohop->N_twohop_addr ) ) {
-				if ( (iproute = _linearIPlookup->lookup_iproute( twohop->N_neigh_main_addr )) ) {
-					neighbor_data *neighbor = ( neighbor_data * ) neighbor_set->find( twohop->N_neigh_main_addr );
-					if ( neighbor->N_willingness > OLSR_WILL_NEVER ) {
-						newiproute.addr = twohop->N_twohop_addr;
-						newiproute.mask = netmask32;
-						newiproute.gw = iproute->gw;
-						newiproute.port = iproute->port;
-						newiproute.extra = 2;
-						_linearIPlookup->add_route( newiproute, false, 0, _errh );
-// 						_linearIPlookup->add_route( twohop->N_twohop_addr,
-// 						                            netmask32,
-// 						                            entry.gw,
-// 						                            entry.output,
-// 						                            2,
-// 						                            _errh );
-						// 	  click_chatter ("adding twohopneighbor %s\n",new_entry->R_dest_addr.unparse().c_str());
-					}
+
+/**
+ * the route to root lost the topology tuple it was derived from. Drops the
+ * subtree of the shortest path tree below root and reattaches its nodes
+ * through their remaining topology tuples, shortest distance first. A root
+ * that was a 2-hop neighbor is reattached through the neighbor root_via
+ * first, if given.
+ */
+void
+OLSRRoutingTable::repair_subtree( const IPAddress &root, const IPAddress *root_via )
+{
+	HashMap<IPAddress, int> orphans;
+	Vector<IPAddress> stack;
+
+	orphans.insert( root, 1 );
+	stack.push_back( root );
+	while ( !stack.empty() ) {
+		IPAddress node = stack.back();
+		stack.pop_back();
+		if ( const Vector<IPAddress> *dests = _topologyInfo->destinations_from( node ) )
+			for ( int j = 0; j < dests->size(); j++ ) {
+				RouteEntry *route = _routes.findp( ( *dests )[j] );
+				if ( route && route->dist >= 3 && route->last == node && !orphans.findp( ( *dests )[j] ) ) {
+					orphans.insert( ( *dests )[j], 1 );
+					stack.push_back( ( *dests )[j] );
 				}
 			}
+	}
+
+	for ( HashMap<IPAddress, int>::iterator iter = orphans.begin(); iter != orphans.end(); iter++ )
+		_routes.remove( iter.key() );
+
+	//routes from outside the subtree are still shortest, seed from them
+	Vector<RepairItem> heap;
+	if ( root_via ) {
+		RepairItem item;
+		item.dist = 2;
+		item.dest = root;
+		item.last = *root_via;
+		heap.push_back( item );
+	}
+	for ( HashMap<IPAddress, int>::iterator iter = orphans.begin(); iter != orphans.end(); iter++ ) {
+		const Vector<IPAddress> *lasts = _topologyInfo->last_hops_to( iter.key() );
+		if ( !lasts )
+			continue;
+		for ( int j = 0; j < lasts->size(); j++ ) {
+			RouteEntry *route = _routes.findp( ( *lasts )[j] );
+			if ( route && route->dist >= 2 ) {
+				RepairItem item;
+				item.dist = route->dist + 1;
+				item.dest = iter.key();
+				item.last = ( *lasts )[j];
+				heap.push_back( item );
+				push_heap( heap.begin(), heap.end(), repair_less() );
+			}
 		}
 	}
-#ifdef profiling
 
-	click_gettimeofday( &now );
-	time_dif = ( now.tv_sec - start.tv_sec ) + ( now.tv_usec - start.tv_usec ) / 1E6;
-	click_chatter ( "%f | %s | time part 3 %f", timeval2double( now ), _myIP.unparse().c_str(), time_dif );
-	click_gettimeofday( &start );
-#endif
-	//step 4 - adding nodes with distance greater than 2
-	for ( int h = 2; h >= 2; h++ ) {
-		bool route_added = false;
-		for ( HashMap<IPPair, void*>::iterator iter = topology_set->begin(); iter != topology_set->end(); iter++ ) {
-			topology_data *topology = ( topology_data * ) iter.value();
-			//if (_routingTable->find(topology->T_dest_addr) == 0 ){
-			if ( ! _linearIPlookup->lookup_iproute( topology->T_dest_addr ) ) {
-				//there is no entry in the routing table for this address
-				if ( (iproute = _linearIPlookup->lookup_iproute( topology->T_last_addr )) ) {
-					if ( iproute->extra == h ) {
-						// there is an entry for the last but one address in the route
-						newiproute.addr = topology->T_dest_addr;
-						newiproute.mask = netmask32;
-						newiproute.gw = iproute->gw;
-						newiproute.port = iproute->port;
-						newiproute.extra = h + 1;
-						_linearIPlookup->add_route( newiproute, false, 0, _errh );
-// 						_linearIPlookup->add_route( topology->T_dest_addr,
-// 						                            IPAddress( "255.255.255.255" ),
-// 						                            entry.gw,
-// 						                            entry.output,
-// 						                            h + 1,
-// 						                            _errh );
-						// click_chatter("route added to %s, distance: %d\n", new_entry->R_dest_addr.unparse().c_str(),  new_entry->R_dist);
-						route_added = true;
-					}
+	while ( !heap.empty() ) {
+		pop_heap( heap.begin(), heap.end(), repair_less() );
+		RepairItem item = heap.back();
+		heap.pop_back();
+		if ( _routes.findp( item.dest ) )
+			continue;
+		RouteEntry via = _routes.find( item.last );
+		set_route( _routes, item.dest, via.gw, via.port, item.dist, item.last );
+		_repaired_routes++;
+		if ( const Vector<IPAddress> *dests = _topologyInfo->destinations_from( item.dest ) )
+			for ( int j = 0; j < dests->size(); j++ )
+				if ( orphans.findp( ( *dests )[j] ) && !_routes.findp( ( *dests )[j] ) ) {
+					RepairItem next;
+					next.dist = item.dist + 1;
+					next.dest = ( *dests )[j];
+					next.last = item.dest;
+					heap.push_back( next );
+					push_heap( heap.begin(), heap.end(), repair_less() );
 				}
+	}
+}
+
+
+void
+OLSRRoutingTable::topology_tuple_added( const IPAddress &dest_addr, const IPAddress &last_addr )
+{
+	if ( !_incremental || _full_rebuild_needed || dest_addr == _myIP )
+		return;
+
+	RouteEntry *last_route = _routes.findp( last_addr );
+	if ( !last_route || last_route->dist < 2 )
+		return;
+	RouteEntry via = *last_route;
+	RouteEntry *route = _routes.findp( dest_addr );
+	if ( route && ( route->dist < 3 || route->dist <= via.dist + 1 ) )
+		return;
+
+	click_cycles_t start = click_get_cycles();
+	set_route( _routes, dest_addr, via.gw, via.port, via.dist + 1, last_addr );
+	_repaired_routes++;
+	propagate_routes( dest_addr );
+	_profile[PROFILE_REPAIR].add( click_get_cycles() - start );
+}
+
+
+void
+OLSRRoutingTable::topology_tuple_removed( const IPAddress &dest_addr, const IPAddress &last_addr )
+{
+	if ( !_incremental || _full_rebuild_needed )
+		return;
+
+	RouteEntry *route = _routes.findp( dest_addr );
+	if ( route && route->dist >= 3 && route->last == last_addr ) {
+		click_cycles_t start = click_get_cycles();
+		repair_subtree( dest_addr );
+		_profile[PROFILE_REPAIR].add( click_get_cycles() - start );
+	}
+}
+
+
+/**
+ * a 2-hop tuple is an edge from a symmetric neighbor, whose route is the one
+ * of step 2, at distance 2; it is repaired like a topology tuple
+ */
+void
+OLSRRoutingTable::twohop_tuple_added( const IPAddress &twohop_addr, const IPAddress &neigh_addr )
+{
+	if ( !_incremental || _full_rebuild_needed || twohop_addr == _myIP )
+		return;
+
+	RouteEntry *neighbor_route = _routes.findp( neigh_addr );
+	neighbor_data *neighbor = _neighborInfo->find_neighbor( neigh_addr );
+	if ( !neighbor_route || neighbor_route->dist != 1 || !neighbor || neighbor->N_willingness <= OLSR_WILL_NEVER )
+		return;
+	RouteEntry via = *neighbor_route;
+	RouteEntry *route = _routes.findp( twohop_addr );
+	if ( route && route->dist <= 2 )
+		return;
+
+	click_cycles_t start = click_get_cycles();
+	set_route( _routes, twohop_addr, via.gw, via.port, 2, neigh_addr );
+	_repaired_routes++;
+	propagate_routes( twohop_addr );
+	_profile[PROFILE_REPAIR].add( click_get_cycles() - start );
+}
+
+
+void
+OLSRRoutingTable::twohop_tuple_removed( const IPAddress &twohop_addr, const IPAddress &neigh_addr )
+{
+	if ( !_incremental || _full_rebuild_needed )
+		return;
+
+	RouteEntry *route = _routes.findp( twohop_addr );
+	if ( !route || route->dist != 2 || route->last != neigh_addr )
+		return;
+
+	//another neighbor may still reach it at distance 2. The 2-hop set has no
+	//index by 2-hop address; a scan still beats a rebuild
+	click_cycles_t start = click_get_cycles();
+	OLSRNeighborInfoBase::TwoHopSet *twohop_set = _neighborInfo->get_twohop_set();
+	IPAddress other;
+	for ( OLSRNeighborInfoBase::TwoHopSet::iterator iter = twohop_set->begin(); iter != twohop_set->end(); iter++ ) {
+		twohop_data *twohop = &iter.value();
+		if ( twohop->N_twohop_addr != twohop_addr || twohop->N_neigh_main_addr == neigh_addr )
+			continue;
+		RouteEntry *neighbor_route = _routes.findp( twohop->N_neigh_main_addr );
+		neighbor_data *neighbor = _neighborInfo->find_neighbor( twohop->N_neigh_main_addr );
+		if ( neighbor_route && neighbor_route->dist == 1 && neighbor && neighbor->N_willingness > OLSR_WILL_NEVER ) {
+			other = twohop->N_neigh_main_addr;
+			break;
+		}
+	}
+
+	repair_subtree( twohop_addr, other ? &other : 0 );
+	_profile[PROFILE_REPAIR].add( click_get_cycles() - start );
+}
+
+
+void
+OLSRRoutingTable::interface_tuple_changed( const IPAddress &main_addr )
+{
+	//interface aliases of neighbors decide which links belong to which
+	//neighbor in step 2; anything else only changes the routes of step 5
+	if ( _neighborInfo->find_neighbor( main_addr ) )
+		_full_rebuild_needed = true;
+}
+
+
+/**
+ * compares the incrementally maintained routes with a full rebuild, and
+ * switches to the rebuilt routes if they differ
+ */
+bool
+OLSRRoutingTable::validate_routes()
+{
+	RouteMap reference;
+	compute_host_routes( reference );
+
+	bool ok = ( reference.size() == _routes.size() );
+	for ( RouteMap::iterator iter = reference.begin(); ok && iter != reference.end(); iter++ ) {
+		RouteEntry *route = _routes.findp( iter.key() );
+		if ( !route || route->dist != iter.value().dist ) {
+			click_chatter( "%s: incremental route to %s differs from full rebuild", name().c_str(), iter.key().unparse().c_str() );
+			ok = false;
+		}
+	}
+	if ( !ok ) {
+		_validation_failures++;
+		_routes.swap( reference );
+	}
+	return ok;
+}
+
+
+/**
+ * the symmetric links, the twohop set and the topology set as adjacency
+ * lists over main addresses, and the symmetric neighbors that routes may
+ * go through
+ */
+void
+OLSRRoutingTable::build_adjacency( Adjacency &adjacency, Vector<IPAddress> &neighbors )
+{
+	OLSRNeighborInfoBase::NeighborSet *neighbor_set = _neighborInfo->get_neighbor_set();
+	OLSRNeighborInfoBase::TwoHopSet *twohop_set = _neighborInfo->get_twohop_set();
+	OLSRTopologyInfoBase::TopologySet *topology_set = _topologyInfo->get_topology_set();
+
+	for ( OLSRNeighborInfoBase::NeighborSet::iterator iter = neighbor_set->begin(); iter != neighbor_set->end(); iter++ ) {
+		neighbor_data *neighbor = &iter.value();
+		if ( neighbor->N_status != OLSR_SYM_NEIGH )
+			continue;
+		adjacency.find_force( _myIP ).push_back( neighbor->N_neigh_main_addr );
+		adjacency.find_force( neighbor->N_neigh_main_addr ).push_back( _myIP );
+		if ( neighbor->N_willingness > OLSR_WILL_NEVER && _routes.findp( neighbor->N_neigh_main_addr ) )
+			neighbors.push_back( neighbor->N_neigh_main_addr );
+	}
+	for ( OLSRNeighborInfoBase::TwoHopSet::iterator iter = twohop_set->begin(); iter != twohop_set->end(); iter++ )
+		if ( iter.value().N_twohop_addr != _myIP )
+			adjacency.find_force( iter.value().N_neigh_main_addr ).push_back( iter.value().N_twohop_addr );
+	for ( OLSRTopologyInfoBase::TopologySet::iterator iter = topology_set->begin(); iter != topology_set->end(); iter++ )
+		adjacency.find_force( iter.value().T_last_addr ).push_back( iter.value().T_dest_addr );
+}
+
+
+/**
+ * hop distances from node from over adjacency, breadth first; queue is
+ * scratch space
+ */
+void
+OLSRRoutingTable::hop_distances( const Adjacency &adjacency, const IPAddress &from, HashMap<IPAddress, int> &distance, Vector<IPAddress> &queue )
+{
+	distance.clear();
+	queue.clear();
+	distance.insert( from, 0 );
+	queue.push_back( from );
+	for ( int i = 0; i < queue.size(); i++ ) {
+		const Vector<IPAddress> *next = adjacency.findp( queue[i] );
+		int d = distance.find( queue[i] ) + 1;
+		for ( int j = 0; next && j < next->size(); j++ )
+			if ( !distance.findp( ( *next )[j] ) ) {
+				distance.insert( ( *next )[j], d );
+				queue.push_back( ( *next )[j] );
 			}
+	}
+}
+
+
+/**
+ * selects a loop-free alternate for the route to every node in _routes,
+ * keyed by the node's main address. The alternate's gw and port are those
+ * of the route to the neighbor, dist is the neighbor's distance to the node
+ * plus one.
+ */
+void
+OLSRRoutingTable::compute_alternates( RouteMap &alternates )
+{
+	Adjacency adjacency;
+	Vector<IPAddress> neighbors;
+
+	alternates.clear();
+	build_adjacency( adjacency, neighbors );
+
+	HashMap<IPAddress, int> node_protecting;
+	HashMap<IPAddress, int> distance;
+	Vector<IPAddress> queue;
+	for ( int n = 0; n < neighbors.size(); n++ ) {
+		hop_distances( adjacency, neighbors[n], distance, queue );
+
+		const RouteEntry &via = _routes.find( neighbors[n] );
+		for ( RouteMap::iterator iter = _routes.begin(); iter != _routes.end(); iter++ ) {
+			IPAddress dest = _interfaceInfo->get_main_address( iter.key() );
+			IPAddress primary = _interfaceInfo->get_main_address( iter.value().gw );
+			int *dist_n = distance.findp( dest );
+			if ( dest == neighbors[n] || primary == neighbors[n] || !dist_n )
+				continue;
+			if ( *dist_n >= 1 + iter.value().dist )	//would loop back through this node
+				continue;
+			int *dist_primary = distance.findp( primary );
+			int protecting = ( dest != primary && dist_primary && *dist_n < *dist_primary + iter.value().dist - 1 );
+			RouteEntry *best = alternates.findp( dest );
+			int *best_protecting = node_protecting.findp( dest );
+			if ( best && ( *best_protecting > protecting || ( *best_protecting == protecting && best->dist <= *dist_n + 1 ) ) )
+				continue;
+			set_route( alternates, dest, via.gw, via.port, *dist_n + 1, neighbors[n] );
+			node_protecting.insert( dest, protecting );
 		}
-		if ( ! route_added )
-			break; //if no new nodes are added in an iteration, stop looking for new routes
 	}
+}
 
-#ifdef profiling
 
-	click_gettimeofday( &now );
-	time_dif = ( now.tv_sec - start.tv_sec ) + ( now.tv_usec - start.tv_usec ) / 1E6;
-	click_chatter ( "time part 4 %f", time_dif );
-	click_gettimeofday( &start );
-#endif
+void
+OLSRRoutingTable::add_backup( RouteTable &backups, const IPRoute &route, const RouteEntry *alternate )
+{
+	if ( !alternate || alternate->gw == route.gw )
+		return;
+	IPRoute backup = route;
+	backup.gw = alternate->gw;
+	backup.port = alternate->port;
+	backup.extra = alternate->dist;
+	backups.insert( IPPair( route.addr, route.mask ), backup );
+}
 
-	//step 5 - add routes to other nodes' interfaces that have not already been added
-	for ( HashMap<IPAddress, void *>::iterator iter = interface_set->begin(); iter != interface_set->end(); iter++ ) {
-		interface_data *interface = ( interface_data * ) iter.value();
-		//rtable_entry *entry = (rtable_entry *) _routingTable->find(interface->I_main_addr);
-		if ( _linearIPlookup->lookup_iproute( interface->I_main_addr )  ) {
-			if (! (iproute = _linearIPlookup->lookup_iproute( interface->I_iface_addr ) )) {
-
-				newiproute.addr = interface->I_iface_addr;
-				newiproute.mask = netmask32;
-				newiproute.gw = iproute->gw;
-				newiproute.port = iproute->port;
-				newiproute.extra = iproute->extra;
-				_linearIPlookup->add_route( newiproute, false, 0, _errh );
-// 				_linearIPlookup->add_route( interface->I_iface_addr,
-// 				                            IPAddress( "255.255.255.255" ),
-// 				                            entry.gw,
-// 				                            entry.output,
-// 				                            entry.dist,
-// 				                            _errh );
-				// 	click_chatter ("adding other ifaces %s\n",new_entry->R_dest_addr.unparse().c_str());
+
+/**
+ * collects for every node at two hops or more in _routes, keyed by its main
+ * address, the symmetric neighbors other than the primary next hop that are
+ * one hop closer to it than this node: paths through them are as short as
+ * the route. At most MULTIPATH - 1 are kept, in the order of the neighbor
+ * set.
+ */
+void
+OLSRRoutingTable::compute_multipaths( HashMap<IPAddress, Vector<IPAddress> > &next_hops )
+{
+	Adjacency adjacency;
+	Vector<IPAddress> neighbors;
+
+	next_hops.clear();
+	build_adjacency( adjacency, neighbors );
+
+	HashMap<IPAddress, int> distance;
+	Vector<IPAddress> queue;
+	for ( int n = 0; n < neighbors.size(); n++ ) {
+		hop_distances( adjacency, neighbors[n], distance, queue );
+
+		for ( RouteMap::iterator iter = _routes.begin(); iter != _routes.end(); iter++ ) {
+			if ( iter.value().dist < 2 )
+				continue;
+			IPAddress dest = _interfaceInfo->get_main_address( iter.key() );
+			int *dist_n = distance.findp( dest );
+			if ( !dist_n || *dist_n != iter.value().dist - 1
+			     || _interfaceInfo->get_main_address( iter.value().gw ) == neighbors[n] )
+				continue;
+			Vector<IPAddress> &hops = next_hops.find_force( dest );
+			if ( hops.size() < _multipath - 1 && ( hops.empty() || hops.back() != neighbors[n] ) )
+				hops.push_back( neighbors[n] );
+		}
+	}
+}
+
+
+/**
+ * records the equal-cost next hops of host route route, if there are any
+ * besides its own
+ */
+void
+OLSRRoutingTable::add_multipath( MultipathTable &multipaths, const IPRoute &route, const Vector<IPAddress> *next_hops )
+{
+	if ( !next_hops || next_hops->empty() )
+		return;
+	Vector<IPRoute> &paths = multipaths.find_force( route.addr );
+	paths.clear();
+	paths.push_back( route );
+	for ( int i = 0; i < next_hops->size(); i++ ) {
+		const RouteEntry &via = _routes.find( ( *next_hops )[i] );
+		if ( via.gw == route.gw )
+			continue;
+		IPRoute path = route;
+		path.gw = via.gw;
+		path.port = via.port;
+		paths.push_back( path );
+	}
+	if ( paths.size() < 2 )
+		multipaths.remove( route.addr );
+}
+
+
+/**
+ * makes the networks in candidates with more than one gateway the shared
+ * ones: weighs each gateway by its free capacity and hands out the buckets.
+ * Networks whose gateways are the same as before and whose free capacities
+ * moved by at most GATEWAY_HYSTERESIS keep their buckets.
+ */
+void
+OLSRRoutingTable::update_balance( BalanceTable &candidates )
+{
+	olsr_time_t now = olsr_now();
+	BalanceTable balanced;
+
+	for ( BalanceTable::iterator iter = candidates.begin(); iter != candidates.end(); iter++ ) {
+		Vector<GatewayShare> &shares = iter.value().shares;
+		if ( shares.size() < 2 )
+			continue;
+		if ( shares.size() > BALANCE_BUCKETS )
+			shares.resize( BALANCE_BUCKETS );
+
+		int least = -1;
+		for ( int i = 0; i < shares.size(); i++ ) {
+			shares[i].weight = _associationInfo->gateway_free_capacity( shares[i].gateway, now );
+			if ( shares[i].weight > 0 && ( least < 0 || shares[i].weight < least ) )
+				least = shares[i].weight;
+		}
+		for ( int i = 0; i < shares.size(); i++ )
+			if ( shares[i].weight < 0 )
+				shares[i].weight = ( least > 0 ? least : 1 );
+
+		Balance &balance = balanced.find_force( iter.key() );
+		balance.shares.swap( shares );
+		const Balance *old = _balanced.findp( iter.key() );
+
+		//the old shares, in the order of the new ones, if all are within
+		//the hysteresis
+		Vector<int> old_index;
+		for ( int i = 0; old && old->shares.size() == balance.shares.size() && i < balance.shares.size(); i++ ) {
+			int j = 0;
+			while ( j < old->shares.size() && old->shares[j].gateway != balance.shares[i].gateway )
+				j++;
+			if ( j == old->shares.size() )
+				break;
+			int64_t moved = balance.shares[i].weight - old->shares[j].weight;
+			if ( ( moved < 0 ? -moved : moved ) * 100 > (int64_t) old->shares[j].weight * _gateway_hysteresis )
+				break;
+			old_index.push_back( j );
+		}
+
+		if ( old && old_index.size() == balance.shares.size() ) {
+			Vector<int> new_index( old->shares.size(), 0 );
+			for ( int i = 0; i < old_index.size(); i++ ) {
+				balance.shares[i].weight = old->shares[old_index[i]].weight;
+				new_index[old_index[i]] = i;
 			}
+			for ( int k = 0; k < BALANCE_BUCKETS; k++ )
+				balance.buckets[k] = new_index[old->buckets[k]];
+		} else {
+			assign_buckets( balance, old );
+			_rebalances++;
 		}
 	}
+	_balanced.swap( balanced );
+}
+
+
+/**
+ * gives every share a number of buckets in proportion to its weight; as
+ * many buckets as possible stay with the gateway they had in old
+ */
+void
+OLSRRoutingTable::assign_buckets( Balance &balance, const Balance *old )
+{
+	Vector<GatewayShare> &shares = balance.shares;
+	int n = shares.size();
+
+	//scale the weights down so that their sum times the buckets fits an int
+	int largest = 0, shift = 0;
+	for ( int i = 0; i < n; i++ )
+		if ( shares[i].weight > largest )
+			largest = shares[i].weight;
+	while ( ( largest >> shift ) >= ( 1 << 18 ) )
+		shift++;
+	Vector<int> target( n, 0 ), remainder( n, 0 ), count( n, 0 );
+	int total = 0, given = 0;
+	for ( int i = 0; i < n; i++ )
+		total += ( shares[i].weight >> shift ) + 1;
+	for ( int i = 0; i < n; i++ ) {
+		int w = ( shares[i].weight >> shift ) + 1;
+		target[i] = w * BALANCE_BUCKETS / total;
+		remainder[i] = w * BALANCE_BUCKETS % total;
+		given += target[i];
+	}
+	//largest remainders first
+	for ( ; given < BALANCE_BUCKETS; given++ ) {
+		int best = 0;
+		for ( int i = 1; i < n; i++ )
+			if ( remainder[i] > remainder[best] )
+				best = i;
+		target[best]++;
+		remainder[best] = -1;
+	}
+
+	for ( int k = 0; k < BALANCE_BUCKETS; k++ ) {
+		balance.buckets[k] = 0xFF;
+		if ( !old )
+			continue;
+		const IPAddress &gateway = old->shares[old->buckets[k]].gateway;
+		for ( int i = 0; i < n; i++ )
+			if ( shares[i].gateway == gateway ) {
+				if ( count[i] < target[i] ) {
+					balance.buckets[k] = i;
+					count[i]++;
+				}
+				break;
+			}
+	}
+	for ( int k = 0, i = 0; k < BALANCE_BUCKETS; k++ )
+		if ( balance.buckets[k] == 0xFF ) {
+			while ( count[i] >= target[i] )
+				i++;
+			balance.buckets[k] = i;
+			count[i]++;
+		}
+}
+
+
+const IPRoute *
+OLSRRoutingTable::balanced_route( const IPAddress &dst, uint32_t flow_hash ) const
+{
+	if ( _balanced.empty() )
+		return 0;
+	IPAddress ones( 0xFFFFFFFFU );
+	for ( int i = 0; i < _installed_masks.size(); i++ ) {
+		const IPAddress &mask = _installed_masks[i];
+		IPPair key( dst & mask, ones, mask, ones );
+		if ( _installed.findp( key ) ) {
+			const Balance *balance = _balanced.findp( key );
+			return balance ? &balance->shares[balance->buckets[flow_hash % BALANCE_BUCKETS]].route : 0;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * derives steps 5 and 6 and the visitor set from the routes of steps 2-4
+ * and writes the routes that changed to the lookup element
+ */
+void
+OLSRRoutingTable::install_routes()
+{
+	OLSRInterfaceInfoBase::InterfaceSet *interface_set = _interfaceInfo->get_interface_set();
+	OLSRAssociationInfoBase::AssociationSet *association_set = _associationInfo->get_association_set();
+	IPAddress netmask32( "255.255.255.255" );
+	RouteTable table;
+	IPRoute newiproute;
+	RouteMap alternates;
+	HashMap<IPAddress, Vector<IPAddress> > next_hops;
+	MultipathTable multipaths;
+	BalanceTable candidates;
+	AttachJob job;
+	Vector<interface_data *> interfaces;
+	Vector<RouteEntry *> main_routes;
+	Vector<association_data *> associations;
+	Vector<IPRoute *> gw_routes;
+	bool parallel = parallel_computation();
+	click_cycles_t start = click_get_cycles(), now;
+
+	_topologyInfo->publish_snapshot();
+	if ( parallel )
+		_parallel_computations++;
+	job.routes = &_routes;
+	job.table = &table;
+	job.interfaces = &interfaces;
+	job.main_routes = &main_routes;
+	job.associations = &associations;
+	job.gw_routes = &gw_routes;
+
+	_backups.clear();
+	if ( _backup_routes ) {
+		compute_alternates( alternates );
+		now = click_get_cycles();
+		_profile[PROFILE_BACKUPS].add( now - start );
+		start = now;
+	}
+	if ( _multipath > 1 ) {
+		compute_multipaths( next_hops );
+		now = click_get_cycles();
+		_profile[PROFILE_MULTIPATHS].add( now - start );
+		start = now;
+	}
+
+	for ( RouteMap::iterator iter = _routes.begin(); iter != _routes.end(); iter++ ) {
+		newiproute.addr = iter.key();
+		newiproute.mask = netmask32;
+		newiproute.gw = iter.value().gw;
+		newiproute.port = iter.value().port;
+		newiproute.extra = iter.value().dist;
+		table.insert( IPPair( newiproute.addr, newiproute.mask ), newiproute );
+		if ( _backup_routes )
+			add_backup( _backups, newiproute, alternates.findp( _interfaceInfo->get_main_address( iter.key() ) ) );
+		if ( _multipath > 1 )
+			add_multipath( multipaths, newiproute, next_hops.findp( _interfaceInfo->get_main_address( iter.key() ) ) );
+	}
+
+	//step 5 - add routes to other nodes' interfaces that have not already been added
+	for ( OLSRInterfaceInfoBase::InterfaceSet::iterator iter = interface_set->begin(); iter != interface_set->end(); iter++ )
+		interfaces.push_back( &iter.value() );
+	main_routes.resize( interfaces.size(), 0 );
+	_workers.run( attach_interfaces, &job, interfaces.size(), parallel );
+	for ( int i = 0; i < interfaces.size(); i++ ) {
+		interface_data *interface = interfaces[i];
+		RouteEntry *main_route = main_routes[i];
+		if ( main_route ) {
+			newiproute.addr = interface->I_iface_addr;
+			newiproute.mask = netmask32;
+			newiproute.gw = main_route->gw;
+			newiproute.port = main_route->port;
+			newiproute.extra = main_route->dist;
+			table.insert( IPPair( newiproute.addr, newiproute.mask ), newiproute );
+			if ( _backup_routes )
+				add_backup( _backups, newiproute, alternates.findp( interface->I_main_addr ) );
+			if ( _multipath > 1 )
+				add_multipath( multipaths, newiproute, next_hops.findp( interface->I_main_addr ) );
+		}
+	}
+
+	now = click_get_cycles();
+	_profile[PROFILE_INTERFACES].add( now - start );
+	start = now;
+
 	if ( _visitorInfo ) {
-		_visitorInfo->clear();
-		//	click_chatter ("%s | checking for new visitors!!!!\n",_myIP.unparse().c_str());
-		for ( OLSRLinearIPLookup::IPRouteTableIterator iter = _linearIPlookup->begin() ; iter != _linearIPlookup->end(); iter++ ) {
-			// click_chatter ("%s | CHECKING if node %s is visiting my network\n",_myIP.unparse().c_str(), _linearIPlookup->_t[index].addr.unparse().c_str());
-			if ( iter->mask == netmask32 && !iter->addr.matches_prefix( _myIP, _myMask ) ) { // check if this node is on my subnet
-				_visitorInfo->add_tuple( iter->gw, iter->addr, iter->mask, make_timeval( 0, 0 ) );
-				timeval now;
-				click_gettimeofday( &now );
-				click_chatter ( "%f | %s | node %s is visiting my network\n", Timestamp( now ).doubleval(), _myIP.unparse().c_str(), iter->addr.unparse().c_str() );
+		update_visitors( table );
+		now = click_get_cycles();
+		_profile[PROFILE_VISITORS].add( now - start );
+		start = now;
+	}
+
+	//step 6 - add routes to entries in the association table, preferring
+	//the closest gateway for each network
+	for ( OLSRAssociationInfoBase::AssociationSet::iterator iter = association_set->begin(); iter != association_set->end(); iter++ )
+		associations.push_back( &iter.value() );
+	gw_routes.resize( associations.size(), 0 );
+	_workers.run( attach_associations, &job, associations.size(), parallel );
+	for ( int i = 0; i < associations.size(); i++ ) {
+		association_data *association = associations[i];
+		IPRoute *gw_route = gw_routes[i];
+		if ( !gw_route )	//unless an earlier network of this loop added it
+			gw_route = table.findp( IPPair( association->A_gateway_addr, netmask32 ) );
+		if ( !gw_route )
+			continue;
+		IPPair network( association->A_network_addr, association->A_netmask );
+		if ( _gateway_balance ) {
+			GatewayShare share;
+			share.gateway = association->A_gateway_addr;
+			share.weight = 0;
+			share.route.addr = association->A_network_addr;
+			share.route.mask = association->A_netmask;
+			share.route.gw = gw_route->gw;
+			share.route.port = gw_route->port;
+			share.route.extra = gw_route->extra;
+			candidates.find_force( network ).shares.push_back( share );
+		}
+		IPRoute *route = table.findp( network );
+		if ( !route || route->extra > gw_route->extra ) {
+			newiproute.addr = association->A_network_addr;
+			newiproute.mask = association->A_netmask;
+			newiproute.gw = gw_route->gw;
+			newiproute.port = gw_route->port;
+			newiproute.extra = gw_route->extra;
+			table.insert( network, newiproute );
+			if ( _backup_routes ) {
+				_backups.remove( network );
+				add_backup( _backups, newiproute, alternates.findp( association->A_gateway_addr ) );
 			}
 		}
 	}
 
-	//step 6 - add routes to entries in the association table
-	/// @TODO I don't feel that this code is 100% compliant, this definitely needs to be looked at and possibly rewritten (see p. 54 of the RFC)
-	for ( HashMap<IPPair, void *>::iterator iter = association_set->begin(); iter != association_set->end(); iter++ ) {
-		association_data *association = ( association_data * ) iter.value();
-		if ( (iproute = _linearIPlookup->lookup_iproute( association->A_gateway_addr )) ) {
-			if ( !_linearIPlookup->lookup_iproute( association->A_network_addr ) /** @TODO This seems like a weird or. have to check this again!! || _linearIPlookup->lookup_iproute( association->A_network_addr )->gw != iproute->gw */) {
-				newiproute.addr = association->A_network_addr;
-				newiproute.mask = association->A_netmask;
-				newiproute.gw = iproute->gw;
-				newiproute.port = iproute->port;
-				newiproute.extra = iproute->extra;
-				_linearIPlookup->add_route( newiproute, false, 0, _errh );
-/*				_linearIPlookup->add_route( association->A_network_addr,
-				                            association->A_netmask,
-				                            gw_entry.gw,
-				                            gw_entry.output,
-				                            gw_entry.dist,
-				                            _errh );*/
-			} else {
-				if ( _linearIPlookup->lookup_iproute( association->A_network_addr )->extra > iproute->extra ) {
-					_linearIPlookup->update(association->A_network_addr, iproute->gw, iproute->port, iproute->extra);
-				}
+	if ( _gateway_balance )
+		update_balance( candidates );
+
+	now = click_get_cycles();
+	_profile[PROFILE_HNA].add( now - start );
+
+	_multipaths.swap( multipaths );
+	apply_routes( table );
+	_profile[PROFILE_APPLY].add( click_get_cycles() - now );
+	_last_computation = Timestamp::now();
+}
+
+
+/**
+ * the main address route of each interface in a slice, unless its
+ * interface address has a route of its own
+ */
+void
+OLSRRoutingTable::attach_interfaces( void *thunk, int, int begin, int end )
+{
+	AttachJob *job = ( AttachJob * ) thunk;
+	for ( int i = begin; i < end; i++ ) {
+		interface_data *interface = ( *job->interfaces )[i];
+		if ( !job->routes->findp( interface->I_iface_addr ) )
+			( *job->main_routes )[i] = job->routes->findp( interface->I_main_addr );
+	}
+}
+
+
+/**
+ * the host route to the gateway of each association in a slice
+ */
+void
+OLSRRoutingTable::attach_associations( void *thunk, int, int begin, int end )
+{
+	AttachJob *job = ( AttachJob * ) thunk;
+	IPAddress netmask32( 0xFFFFFFFFU );
+	for ( int i = begin; i < end; i++ )
+		( *job->gw_routes )[i] = job->table->findp( IPPair( ( *job->associations )[i]->A_gateway_addr, netmask32 ) );
+}
+
+
+/**
+ * makes table the installed routes: computes the delta against the routes
+ * installed so far, writes it to the lookup element and hands it to the
+ * listeners. table is left empty.
+ */
+void
+OLSRRoutingTable::apply_routes( RouteTable &table )
+{
+	Vector<RouteChange> delta;
+	diff_routes( _installed, table, delta );
+	if ( delta.empty() ) {
+		table.clear();
+		return;
+	}
+	_delta.swap( delta );
+
+	_installed.swap( table );
+	table.clear();
+	if ( own_lookup() )
+		update_lookup();
+	else
+		write_routes( _installed, _delta );
+	if ( _gateway_balance ) {
+		bool used[33];
+		memset( used, 0, sizeof( used ) );
+		for ( RouteTable::iterator iter = _installed.begin(); iter != _installed.end(); iter++ ) {
+			int len = iter.value().mask.mask_to_prefix_len();
+			if ( len >= 0 )
+				used[len] = true;
+		}
+		_installed_masks.clear();
+		for ( int len = 32; len >= 0; len-- )
+			if ( used[len] )
+				_installed_masks.push_back( IPAddress::make_prefix( len ) );
+	}
+
+	_generation++;
+	_route_changes += _delta.size();
+	if ( !_computing.empty() )
+		_installed_event = _computing.back().id;
+	publish_snapshot();
+	for ( int i = 0; i < _listeners.size(); i++ )
+		_listeners[i]->routes_changed( _delta );
+}
+
+
+/**
+ * the routes added, removed or changed in going from old to table; a route
+ * whose hop distance alone changed counts as changed, so that the snapshot
+ * and the working set of LAZY follow it
+ */
+void
+OLSRRoutingTable::diff_routes( const RouteTable &old, const RouteTable &table, Vector<RouteChange> &delta )
+{
+	for ( RouteTable::const_iterator iter = old.begin(); iter != old.end(); iter++ )
+		if ( !table.findp( iter.key() ) ) {
+			RouteChange change;
+			change.type = ROUTE_REMOVED;
+			change.route = change.old_route = iter.value();
+			delta.push_back( change );
+		}
+	for ( RouteTable::const_iterator iter = table.begin(); iter != table.end(); iter++ ) {
+		const IPRoute *prev = old.findp( iter.key() );
+		if ( prev && prev->gw == iter.value().gw && prev->port == iter.value().port
+		     && prev->extra == iter.value().extra )
+			continue;
+		RouteChange change;
+		change.type = prev ? ROUTE_CHANGED : ROUTE_ADDED;
+		change.route = iter.value();
+		if ( prev )
+			change.old_route = *prev;
+		delta.push_back( change );
+	}
+}
+
+
+/**
+ * writes table, which differs from the routes in the lookup element by
+ * delta, to the lookup element
+ */
+void
+OLSRRoutingTable::write_routes( const RouteTable &table, const Vector<RouteChange> &delta )
+{
+	if ( _radixLookup )	//built off to the side, readers switch over in one step
+		_radixLookup->publish( table );
+	else {	//one batch, so the lookup element can share work across it
+		Vector<IPRoute> removes, sets;
+		for ( int i = 0; i < delta.size(); i++ )
+			if ( delta[i].type == ROUTE_REMOVED )
+				removes.push_back( delta[i].route );
+			else
+				sets.push_back( delta[i].route );
+		_routeTable->change_routes( removes, sets, _errh );
+	}
+}
+
+
+/**
+ * writes to the lookup element the installed routes LAZY keeps, compressed
+ * with AGGREGATE; only the prefixes that changed are written
+ */
+void
+OLSRRoutingTable::update_lookup()
+{
+	RouteTable picked, lookup;
+	const RouteTable *routes = &_installed;
+	if ( _lazy ) {
+		IPAddress netmask32( 0xFFFFFFFFU );
+		HashMap<IPAddress, int> gateways;
+		OLSRAssociationInfoBase::AssociationSet *association_set = _associationInfo->get_association_set();
+		for ( OLSRAssociationInfoBase::AssociationSet::iterator iter = association_set->begin(); iter != association_set->end(); iter++ )
+			gateways.insert( iter.value().A_gateway_addr, 1 );
+		for ( RouteTable::const_iterator iter = _installed.begin(); iter != _installed.end(); iter++ ) {
+			const IPRoute &route = iter.value();
+			if ( route.mask != netmask32 || route.extra <= 1 || _wanted.findp( route.addr ) || gateways.findp( route.addr ) )
+				picked.insert( iter.key(), route );
+		}
+		routes = &picked;
+	}
+	if ( _aggregate )	//the compressed table only changes where the routes did
+		_compressor.compress( *routes, lookup );
+	else if ( _lazy )
+		lookup.swap( picked );
+	else
+		lookup = _installed;
+
+	Vector<RouteChange> lookup_delta;
+	diff_routes( _lookup, lookup, lookup_delta );
+	_lookup_delta.swap( lookup_delta );
+	if ( !_lookup_delta.empty() )
+		write_routes( lookup, _lookup_delta );
+	_lookup.swap( lookup );
+	_lookup_changes += _lookup_delta.size();
+}
+
+
+/**
+ * the route of the current snapshot to a destination the lookup element
+ * missed under LAZY, which is queued for the working set. Runs on the
+ * lookup element's thread: reads nothing but the snapshot and the queue.
+ */
+int
+OLSRRoutingTable::route_missed( IPAddress dst, IPAddress &gw )
+{
+	SnapshotRef s = snapshot();
+	const IPRoute *route = ( s ? s->routes.findp( IPPair( dst, IPAddress( 0xFFFFFFFFU ) ) ) : 0 );
+	if ( !route )
+		return -1;
+	_missed_lock.acquire();
+	_misses++;
+	if ( _missed.size() < MAX_MISSES )
+		_missed.push_back( dst );
+	else
+		_misses_dropped++;
+	_missed_lock.release();
+	_task.reschedule();
+	gw = route->gw;
+	return route->port;
+}
+
+
+/**
+ * moves the destinations missed into the working set; returns true if
+ * any was new
+ */
+bool
+OLSRRoutingTable::take_misses()
+{
+	Vector<IPAddress> missed;
+	_missed_lock.acquire();
+	missed.swap( _missed );
+	_missed_lock.release();
+	if ( missed.empty() )
+		return false;
+	olsr_time_t expiry = olsr_now() + _lazy_timeout;
+	bool added = false;
+	for ( int i = 0; i < missed.size(); i++ ) {
+		if ( !_wanted.findp( missed[i] ) )
+			added = true;
+		_wanted.insert( missed[i], expiry );
+	}
+	if ( !_lazy_timer.scheduled() )
+		_lazy_timer.schedule_at( olsr_timer_expiry( expiry ) );
+	return added;
+}
+
+
+/**
+ * drops the destinations of the working set whose time is up, and arms
+ * the timer for the next
+ */
+void
+OLSRRoutingTable::expire_wanted()
+{
+	olsr_time_t now = olsr_now(), next = 0;
+	Vector<IPAddress> expired;
+	for ( HashMap<IPAddress, olsr_time_t>::iterator iter = _wanted.begin(); iter != _wanted.end(); iter++ )
+		if ( iter.value() <= now )
+			expired.push_back( iter.key() );
+		else if ( !next || iter.value() < next )
+			next = iter.value();
+	for ( int i = 0; i < expired.size(); i++ )
+		_wanted.remove( expired[i] );
+	if ( next )
+		_lazy_timer.schedule_at( olsr_timer_expiry( next ) );
+	if ( !expired.empty() ) {
+		update_lookup();
+		publish_snapshot();
+	}
+}
+
+
+/**
+ * publishes a copy of the installed routes and their last delta; a
+ * listener that reads snapshot() gets the routes the delta led to
+ */
+void
+OLSRRoutingTable::publish_snapshot()
+{
+	Snapshot *s = new Snapshot;
+	s->routes = _installed;
+	s->delta = _delta;
+	s->generation = _generation;
+	s->last_event = _installed_event;
+	s->own_lookup = own_lookup();
+	if ( own_lookup() )
+		s->lookup = _lookup;
+	_snapshot.publish( s );
+}
+
+
+/**
+ * brings the visitor infobase in line with the host routes in table:
+ * only the tuples of visitors that arrived, left or changed gateway are
+ * touched, the others keep their place in the infobase
+ */
+void
+OLSRRoutingTable::update_visitors( const RouteTable &table )
+{
+	IPAddress netmask32( "255.255.255.255" );
+
+	Vector<IPAddress> departed;
+	for ( VisitorMap::iterator iter = _visitors.begin(); iter != _visitors.end(); iter++ ) {
+		const IPRoute *route = table.findp( IPPair( iter.key(), netmask32 ) );
+		if ( route && route->gw == iter.value() )
+			continue;
+		_visitorInfo->remove_tuple( iter.value(), iter.key(), netmask32 );
+		if ( route ) {	//new gateway
+			_visitorInfo->add_tuple( route->gw, route->addr, route->mask, 0 );
+			iter.value() = route->gw;
+		} else {
+			trace( OLSR_TRACE_VISITOR_LEFT, _myIP, iter.key(), iter.value() );
+			departed.push_back( iter.key() );
+		}
+	}
+	for ( int i = 0; i < departed.size(); i++ )
+		_visitors.remove( departed[i] );
+
+	for ( RouteTable::const_iterator iter = table.begin(); iter != table.end(); iter++ ) {
+		const IPRoute &route = iter.value();
+		if ( route.addr.matches_prefix( _myIP, _myMask ) || _visitors.findp( route.addr ) ) // on my subnet, or known
+			continue;
+		_visitorInfo->add_tuple( route.gw, route.addr, route.mask, 0 );
+		_visitors.insert( route.addr, route.gw );
+		trace( OLSR_TRACE_VISITOR_ARRIVED, _myIP, route.addr, route.gw );
+	}
+}
+
+
+void
+OLSRRoutingTable::add_listener( Listener *listener )
+{
+	_listeners.push_back( listener );
+}
+
+
+/**
+ * hop count of the installed host route to dest, or -1 if there is none.
+ * The installed routes keep the hop count they were added with as long as
+ * their gateway stays the same; the computed ones have the current count.
+ */
+int
+OLSRRoutingTable::route_distance( const IPAddress &dest ) const
+{
+	if ( !_installed.findp( IPPair( dest, IPAddress( 0xFFFFFFFFU ) ) ) )
+		return -1;
+	RouteEntry *route = _routes.findp( _interfaceInfo->get_main_address( dest ) );
+	return route ? route->dist : -1;
+}
+
+
+/**
+ * the link to next hop gw failed: routes through it switch to their
+ * alternates, or are removed if they have none, until the full computation
+ * scheduled here has run. The equal-cost next hops of MULTIPATH lose gw
+ * in any case. Returns false without BACKUP_ROUTES.
+ */
+bool
+OLSRRoutingTable::fail_over( const IPAddress &gw )
+{
+	Vector<IPAddress> single;
+	for ( MultipathTable::iterator iter = _multipaths.begin(); iter != _multipaths.end(); iter++ ) {
+		Vector<IPRoute> &paths = iter.value();
+		for ( int i = 0; i < paths.size(); i++ )
+			if ( paths[i].gw == gw ) {
+				paths.erase( paths.begin() + i );
+				break;
+			}
+		if ( paths.size() < 2 )
+			single.push_back( iter.key() );
+	}
+	for ( int i = 0; i < single.size(); i++ )
+		_multipaths.remove( single[i] );
+	//shared networks through gw go back to their route until recomputed
+	Vector<IPPair> unshared;
+	for ( BalanceTable::iterator iter = _balanced.begin(); iter != _balanced.end(); iter++ )
+		for ( int i = 0; i < iter.value().shares.size(); i++ )
+			if ( iter.value().shares[i].route.gw == gw ) {
+				unshared.push_back( iter.key() );
+				break;
 			}
+	for ( int i = 0; i < unshared.size(); i++ )
+		_balanced.remove( unshared[i] );
+
+	//the routes no longer follow from the infobases alone
+	_inputs_valid = false;
+	if ( !_backup_routes )
+		return false;
+	_fail_overs++;
+
+	Vector<IPPair> failed;
+	for ( RouteTable::iterator iter = _installed.begin(); iter != _installed.end(); iter++ )
+		if ( iter.value().gw == gw )
+			failed.push_back( iter.key() );
+	Vector<IPPair> stale;
+	for ( RouteTable::iterator iter = _backups.begin(); iter != _backups.end(); iter++ )
+		if ( iter.value().gw == gw )
+			stale.push_back( iter.key() );
+	for ( int i = 0; i < stale.size(); i++ )
+		_backups.remove( stale[i] );
+
+	RouteTable table = _installed;
+	for ( int i = 0; i < failed.size(); i++ ) {
+		IPRoute *backup = _backups.findp( failed[i] );
+		if ( backup ) {
+			table.insert( failed[i], *backup );
+			_backups.remove( failed[i] );
+		} else
+			table.remove( failed[i] );
+		_routes_failed_over++;
+	}
+	if ( !failed.empty() ) {
+		//the alternates answer the link failures stamped so far
+		unsigned generation = _generation;
+		take_events( EVENT_LINK_FAILURE );
+		apply_routes( table );
+		finish_events( _generation != generation );
+	}
+
+	schedule_computation( true );
+	return true;
+}
+
+
+void
+OLSRRoutingTable::compute_routing_table()
+{
+	click_cycles_t start = click_get_cycles();
+	unsigned generation = _generation;
+	cancel_scheduled( true );
+	take_events();
+	record_inputs();
+	compute_host_routes( _routes );
+	_full_rebuild_needed = false;
+	_full_rebuilds++;
+	install_routes();
+	finish_events( _generation != generation );
+	_profile[PROFILE_FULL].add( click_get_cycles() - start );
+}
+
+
+/**
+ * applies the topology and interface changes reported since the last
+ * computation, falling back to a full rebuild where needed
+ */
+void
+OLSRRoutingTable::update_routing_table()
+{
+	if ( !_incremental || _full_rebuild_needed ) {
+		compute_routing_table();
+		return;
+	}
+	click_cycles_t start = click_get_cycles();
+	unsigned generation = _generation;
+	cancel_scheduled( false );
+	take_events();
+	record_inputs();
+	if ( _validate )
+		validate_routes();
+	_incremental_updates++;
+	install_routes();
+	finish_events( _generation != generation );
+	_profile[PROFILE_INCREMENTAL].add( click_get_cycles() - start );
+}
+
+
+/**
+ * a computation run now satisfies the scheduled one, unless only an
+ * incremental update is run while a full rebuild has been asked for
+ */
+void
+OLSRRoutingTable::cancel_scheduled( bool full )
+{
+	if ( _scheduled && ( full || !_scheduled_full ) ) {
+		_task.unschedule();
+		_timer.unschedule();
+		_scheduled = _scheduled_full = false;
+		_coalesced++;
+	}
+}
+
+
+void
+OLSRRoutingTable::record_inputs()
+{
+	_inputs.neighbors = _neighborInfo->routing_generation();
+	_inputs.links = _linkInfo->changes();
+	_inputs.topology = _topologyInfo->changes();
+	_inputs.interfaces = _interfaceInfo->generation();
+	_inputs.associations = _associationInfo->version();
+	_inputs_valid = !_link_quality && !_gateway_balance;
+}
+
+
+bool
+OLSRRoutingTable::inputs_unchanged() const
+{
+	return _inputs_valid
+	       && _inputs.neighbors == _neighborInfo->routing_generation()
+	       && _inputs.links == _linkInfo->changes()
+	       && _inputs.topology == _topologyInfo->changes()
+	       && _inputs.interfaces == _interfaceInfo->generation()
+	       && _inputs.associations == _associationInfo->version();
+}
+
+
+void
+OLSRRoutingTable::schedule_computation( bool full )
+{
+	_schedule_requests++;
+	if ( full )
+		_scheduled_full = true;
+	if ( _scheduled ) {
+		_coalesced++;		//merged into the pending computation
+		return;
+	}
+	_scheduled = true;
+
+	Timestamp now = Timestamp::now();
+	Timestamp when = _last_computation + Timestamp::make_msec( _min_interval );
+	Timestamp latest = now + Timestamp::make_msec( _max_delay );
+	if ( latest < when )
+		when = latest;
+	if ( when <= now )
+		_task.reschedule();
+	else
+		_timer.schedule_at( when );
+}
+
+
+void
+OLSRRoutingTable::schedule_compute_routing_table( int event )
+{
+	note_event( event );
+	schedule_computation( true );
+}
+
+
+void
+OLSRRoutingTable::schedule_update_routing_table( int event )
+{
+	note_event( event );
+	schedule_computation( false );
+}
+
+
+unsigned
+OLSRRoutingTable::note_event( int type )
+{
+	if ( _events.size() >= MAX_PENDING_EVENTS ) {
+		_events_dropped++;
+		return 0;
+	}
+	Event event;
+	event.id = _next_event++;
+	if ( !_next_event )	//0 is no event
+		_next_event = 1;
+	event.type = ( type >= 0 && type < NEVENT_TYPES ? type : EVENT_OTHER );
+	event.time = olsr_now();
+	_events.push_back( event );
+	_events_stamped++;
+	return event.id;
+}
+
+
+/**
+ * hands the pending events of type, or all of them if type is negative, to
+ * the computation about to run, and records how long they waited for it
+ */
+void
+OLSRRoutingTable::take_events( int type )
+{
+	olsr_time_t now = olsr_now();
+	int kept = 0;
+	for ( int i = 0; i < _events.size(); i++ )
+		if ( type < 0 || _events[i].type == type ) {
+			_event_queueing[_events[i].type].add( now - _events[i].time );
+			_computing.push_back( _events[i] );
+		} else
+			_events[kept++] = _events[i];
+	_events.resize( kept );
+}
+
+
+/**
+ * records the latency from event to install of the events the computation
+ * just run took, or counts them as unchanged if it changed no route
+ */
+void
+OLSRRoutingTable::finish_events( bool changed )
+{
+	olsr_time_t now = olsr_now();
+	for ( int i = 0; i < _computing.size(); i++ )
+		if ( changed )
+			_event_install[_computing[i].type].add( now - _computing[i].time );
+		else
+			_events_unchanged[_computing[i].type]++;
+	_computing.clear();
+}
+
+
+bool
+OLSRRoutingTable::run_task( Task * )
+{
+	if ( _lazy && take_misses() && !_scheduled ) {
+		update_lookup();
+		publish_snapshot();
+		return true;
+	}
+	if ( !_scheduled )
+		return false;
+	bool full = _scheduled_full;
+	_scheduled = _scheduled_full = false;
+	if ( inputs_unchanged() ) {
+		//the requests are answered by the routes installed
+		_unchanged_skips++;
+		take_events();
+		finish_events( false );
+		return true;
+	}
+	_scheduled_computations++;
+	if ( full )
+		compute_routing_table();
+	else
+		update_routing_table();
+	return true;
+}
+
+
+void
+OLSRRoutingTable::run_timer( Timer *t )
+{
+	if ( t == &_lazy_timer )
+		expire_wanted();
+	else
+		_task.reschedule();
+}
+
+
+String
+OLSRRoutingTable::read_handler( Element *e, void *thunk )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	if ( thunk )
+		return String( rt->_coalesced ) + "\n";
+	StringAccum sa;
+	sa << "full_rebuilds " << rt->_full_rebuilds << "\n"
+	   << "incremental_updates " << rt->_incremental_updates << "\n"
+	   << "repaired_routes " << rt->_repaired_routes << "\n"
+	   << "validation_failures " << rt->_validation_failures << "\n"
+	   << "schedule_requests " << rt->_schedule_requests << "\n"
+	   << "scheduled_computations " << rt->_scheduled_computations << "\n"
+	   << "coalesced " << rt->_coalesced << "\n"
+	   << "fail_overs " << rt->_fail_overs << "\n"
+	   << "routes_failed_over " << rt->_routes_failed_over << "\n"
+	   << "parallel_computations " << rt->_parallel_computations << "\n"
+	   << "generation " << rt->_generation << "\n"
+	   << "route_changes " << rt->_route_changes << "\n"
+	   << "rebalances " << rt->_rebalances << "\n"
+	   << "unchanged_skips " << rt->_unchanged_skips << "\n";
+	if ( rt->own_lookup() )
+		sa << "lookup_routes " << rt->_lookup.size() << "\n"
+		   << "lookup_changes " << rt->_lookup_changes << "\n";
+	if ( rt->_lazy )
+		sa << "misses " << rt->_misses << "\n"
+		   << "misses_dropped " << rt->_misses_dropped << "\n"
+		   << "working_set " << rt->_wanted.size() << "\n";
+	return sa.take_string();
+}
+
+
+String
+OLSRRoutingTable::read_delta( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	static const char * const types[] = { "add", "remove", "change" };
+	SnapshotRef snapshot = rt->snapshot();
+	StringAccum sa;
+	char buf[IPAddress::unparse_with_mask_buflen];
+	for ( int i = 0; snapshot && i < snapshot->delta.size(); i++ ) {
+		const RouteChange &change = snapshot->delta[i];
+		sa << types[change.type] << '\t' << change.route.unparse_addr( buf );
+		if ( change.type != ROUTE_REMOVED )
+			sa << '\t' << change.route.gw << '\t' << change.route.port;
+		sa << '\n';
+	}
+	return sa.take_string();
+}
+
+
+String
+OLSRRoutingTable::read_routes( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	SnapshotRef snapshot = rt->snapshot();
+	StringAccum sa;
+	char buf[IPAddress::unparse_with_mask_buflen];
+	if ( snapshot )
+		for ( RouteTable::const_iterator iter = snapshot->routes.begin(); iter != snapshot->routes.end(); iter++ ) {
+			const IPRoute &route = iter.value();
+			sa << route.unparse_addr( buf ) << '\t' << route.gw << '\t' << route.port << '\t' << route.extra << '\n';
 		}
+	return sa.take_string();
+}
+
+
+String
+OLSRRoutingTable::read_lookup_routes( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	SnapshotRef snapshot = rt->snapshot();
+	StringAccum sa;
+	char buf[IPAddress::unparse_with_mask_buflen];
+	if ( snapshot )
+		for ( RouteTable::const_iterator iter = snapshot->lookup_routes().begin(); iter != snapshot->lookup_routes().end(); iter++ ) {
+			const IPRoute &route = iter.value();
+			sa << route.unparse_addr( buf ) << '\t' << route.gw << '\t' << route.port << '\t' << route.extra << '\n';
+		}
+	return sa.take_string();
+}
+
+
+String
+OLSRRoutingTable::read_backups( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	StringAccum sa;
+	char buf[IPAddress::unparse_with_mask_buflen];
+	for ( RouteTable::iterator iter = rt->_backups.begin(); iter != rt->_backups.end(); iter++ )
+		sa << iter.value().unparse_addr( buf ) << '\t' << iter.value().gw << '\t' << iter.value().port << '\t' << iter.value().extra << '\n';
+	return sa.take_string();
+}
+
+
+String
+OLSRRoutingTable::read_multipaths( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	StringAccum sa;
+	for ( MultipathTable::iterator iter = rt->_multipaths.begin(); iter != rt->_multipaths.end(); iter++ ) {
+		sa << iter.key();
+		for ( int i = 0; i < iter.value().size(); i++ )
+			sa << '\t' << iter.value()[i].gw << '\t' << iter.value()[i].port;
+		sa << '\n';
+	}
+	return sa.take_string();
+}
+
+
+String
+OLSRRoutingTable::read_gateways( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	StringAccum sa;
+	char buf[IPAddress::unparse_with_mask_buflen];
+	for ( BalanceTable::iterator iter = rt->_balanced.begin(); iter != rt->_balanced.end(); iter++ ) {
+		const Balance &balance = iter.value();
+		sa << balance.shares[0].route.unparse_addr( buf );
+		for ( int i = 0; i < balance.shares.size(); i++ ) {
+			int buckets = 0;
+			for ( int k = 0; k < BALANCE_BUCKETS; k++ )
+				buckets += ( balance.buckets[k] == i );
+			sa << '\t' << balance.shares[i].gateway << '\t' << balance.shares[i].weight << '\t' << buckets;
+		}
+		sa << '\n';
 	}
+	return sa.take_string();
+}
+
 
+String
+OLSRRoutingTable::read_profile( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	static const char * const names[PROFILE_NPHASES] = {
+		"neighbors", "twohop", "topology", "repair", "backups", "multipaths", "interfaces",
+		"visitors", "hna", "apply", "full", "incremental"
+	};
+	StringAccum sa;
+	for ( int i = 0; i < PROFILE_NPHASES; i++ )
+		rt->_profile[i].unparse( sa, names[i] );
+	return sa.take_string();
+}
 
-#ifdef profiling
 
-	click_gettimeofday( &now );
-	time_dif = ( now.tv_sec - start.tv_sec ) + ( now.tv_usec - start.tv_usec ) / 1E6;
-	click_chatter ( "%f | %s | time part 5 %f", timeval2double( now ), _myIP.unparse().c_str(), time_dif );
-	click_chatter ( "%f | %s | Routingtable size: %d\n", timeval2double( now ), _myIP.unparse().c_str(), _routingTable->size() );
+int
+OLSRRoutingTable::clear_profile_handler( const String &, Element *e, void *, ErrorHandler * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	for ( int i = 0; i < PROFILE_NPHASES; i++ )
+		rt->_profile[i].clear();
+	return 0;
+}
 
-#endif
 
-	// #ifdef logging
-	//   timeval now;
-	//   click_gettimeofday(&now);
-	//   click_chatter ("%f | %s | ROUTINGTABLE has been computed \n",timeval2double(now), _myIP.unparse().c_str());
-	//   print_routing_table();
-	//   //  _neighborInfo->print_mpr_set();
-	//   _neighborInfo->print_mpr_selector_set();
-	//   _topologyInfo->print_topology();
-	//   click_chatter ("\n");
-	// #endif
+int
+OLSRRoutingTable::recompute_handler( const String &, Element *e, void *, ErrorHandler * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	rt->compute_routing_table();
+	return 0;
+}
+
+
+String
+OLSRRoutingTable::read_events( Element *e, void * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	static const char * const names[NEVENT_TYPES] = {
+		"link_expired", "link_failure", "twohop_expired", "hello", "tc", "tc_expired",
+		"mid", "hna", "link_degraded", "other"
+	};
+	StringAccum sa;
+	sa << "stamped " << rt->_events_stamped << "\n"
+	   << "dropped " << rt->_events_dropped << "\n"
+	   << "pending " << rt->_events.size() << "\n"
+	   << "installed_event " << rt->_installed_event << "\n";
+	for ( int i = 0; i < NEVENT_TYPES; i++ ) {
+		String name = names[i];
+		rt->_event_queueing[i].unparse( sa, ( name + ".queueing" ).c_str() );
+		rt->_event_install[i].unparse( sa, ( name + ".install" ).c_str() );
+		sa << name << ".unchanged " << rt->_events_unchanged[i] << '\n';
+	}
+	return sa.take_string();
+}
+
+
+int
+OLSRRoutingTable::clear_events_handler( const String &, Element *e, void *, ErrorHandler * )
+{
+	OLSRRoutingTable *rt = ( OLSRRoutingTable * ) e;
+	rt->_events_stamped = rt->_events_dropped = 0;
+	for ( int i = 0; i < NEVENT_TYPES; i++ ) {
+		rt->_event_queueing[i].clear();
+		rt->_event_install[i].clear();
+		rt->_events_unchanged[i] = 0;
+	}
+	return 0;
+}
+
+
+void
+OLSRRoutingTable::add_handlers()
+{
+	add_read_handler( "stats", read_handler, ( void * ) 0 );
+	add_read_handler( "coalesced", read_handler, ( void * ) 1 );
+	add_read_handler( "backups", read_backups, ( void * ) 0 );
+	add_read_handler( "multipaths", read_multipaths, ( void * ) 0 );
+	add_read_handler( "gateways", read_gateways, ( void * ) 0 );
+	add_read_handler( "delta", read_delta, ( void * ) 0 );
+	add_read_handler( "routes", read_routes, ( void * ) 0 );
+	add_read_handler( "lookup_routes", read_lookup_routes, ( void * ) 0 );
+	add_write_handler( "recompute", recompute_handler, ( void * ) 0 );
+	add_read_handler( "profile", read_profile, ( void * ) 0 );
+	add_write_handler( "clear_profile", clear_profile_handler, ( void * ) 0 );
+	add_read_handler( "events", read_events, ( void * ) 0 );
+	add_write_handler( "clear_events", clear_events_handler, ( void * ) 0 );
+	add_trace_handlers( this );
+	add_memory_handlers( this );
+}
 
+
+void *
+OLSRRoutingTable::cast( const char *n )
+{
+	if ( strcmp( n, "OLSRMemoryClient" ) == 0 )
+		return ( OLSRMemoryReport::Client * ) this;
+	return Element::cast( n );
+}
+
+
+void
+OLSRRoutingTable::memory_usage( Vector<OLSRMemoryReport::Usage> &usage )
+{
+	usage.push_back( OLSRMemoryReport::Usage( "routes", _routes.size(), OLSRMemoryReport::bytes( _routes ) ) );
+	usage.push_back( OLSRMemoryReport::Usage( "installed", _installed.size(),
+						  OLSRMemoryReport::bytes( _installed ) + OLSRMemoryReport::bytes( _installed_masks )
+						  + OLSRMemoryReport::bytes( _delta ) ) );
+	if ( own_lookup() )
+		usage.push_back( OLSRMemoryReport::Usage( "lookup", _lookup.size(),
+							  OLSRMemoryReport::bytes( _lookup ) + OLSRMemoryReport::bytes( _lookup_delta )
+							  + _compressor.bytes() + OLSRMemoryReport::bytes( _wanted ) ) );
+	usage.push_back( OLSRMemoryReport::Usage( "backups", _backups.size(), OLSRMemoryReport::bytes( _backups ) ) );
+	usage.push_back( OLSRMemoryReport::Usage( "multipaths", _multipaths.size(), OLSRMemoryReport::deep_bytes( _multipaths ) ) );
+	size_t bytes = OLSRMemoryReport::bytes( _balanced );
+	for ( BalanceTable::const_iterator it = _balanced.begin(); it != _balanced.end(); it++ )
+		bytes += OLSRMemoryReport::bytes( it.value().shares );
+	usage.push_back( OLSRMemoryReport::Usage( "balances", _balanced.size(), bytes ) );
+	usage.push_back( OLSRMemoryReport::Usage( "visitors", _visitors.size(), OLSRMemoryReport::bytes( _visitors ) ) );
 }
 
 
@@ -343,9 +1950,22 @@ OLSRRoutingTable::compute_routing_table()
 
 #include <click/bighashmap.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
-template class HashMap<IPAddress, void *>
-;
+template class HashMap<IPAddress, OLSRRoutingTable::RouteEntry>;
+template class HashMap<IPPair, IPRoute>;
+template class HashMap<IPAddress, int>;
+template class HashMap<IPAddress, IPAddress>;
+template class HashMap<IPAddress, Vector<IPAddress> >;
+template class HashMap<IPAddress, Vector<IPRoute> >;
+template class Vector<IPRoute>;
+template class HashMap<IPPair, OLSRRoutingTable::Balance>;
+template class Vector<OLSRRoutingTable::GatewayShare>;
+template class Vector<IPPair>;
+template class Vector<OLSRRoutingTable::RouteChange>;
+template class Vector<OLSRRoutingTable::Listener *>;
+template class Vector<OLSRRoutingTable::Event>;
+template class OLSRPublished<OLSRRoutingTable::Snapshot>;
 #endif
+#include <click/vector.cc>
 
 CLICK_ENDDECLS
 
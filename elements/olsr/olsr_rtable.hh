@@ -1,19 +1,338 @@
 //TED 190404: Created
+/*
+  =c
+  OLSRRoutingTable(OLSRNeighborInfoBase, OLSRLinkInfoBase, OLSRTopologyInfoBase, OLSRInterfaceInfoBase, OLSRLocalIfInfoBase, OLSRAssociationInfoBase, IPRouteTable, MY_IPADDRESS [, I<KEYWORDS>])
+
+  =s
+  OLSR specific element, computes the routing table
+
+  =io
+  None
+
+  =d
+  Computes the routes of RFC 3626 chapter 10 from the information bases and
+  installs them in the IPRouteTable element given as argument, normally an
+  OLSRRadixIPLookup (OLSRLinearIPLookup and the other IPRouteTable elements
+  work as well). An OLSRRadixIPLookup receives each new table as a whole and
+  switches to it atomically; other elements get the changed routes as one
+  change_routes() batch, which a DirectIPLookup applies with a minimum of
+  table rewrites. Hop distances are kept in a route map owned by this element,
+  so they survive the lookup element's own use of the IPRoute extra field.
+
+  compute_routing_table() rebuilds all routes from scratch. Topology tuples
+  report their additions and removals through topology_tuple_added() and
+  topology_tuple_removed(), and the 2-hop tuples a HELLO changes through
+  twohop_tuple_added() and twohop_tuple_removed(); update_routing_table()
+  then only repairs the part of the shortest path tree below the changed
+  tuples. Changes to the one-hop neighborhood and expired 2-hop tuples still
+  require a full rebuild. In both cases the new
+  routes are compared with the installed ones, and only this delta of added,
+  removed and changed routes, changed meaning another gateway, output port
+  or hop distance, is written to the lookup element (an
+  OLSRRadixIPLookup still gets the whole table, for its atomic switch). The
+  delta is also handed to every Listener registered with add_listener(), so
+  that those can follow the table in O(changes), and each non-empty delta
+  increments generation().
+
+  After each computation that changed them, the installed routes and their
+  delta are also published as an immutable, reference counted Snapshot. The
+  handlers below that show routes, OLSRKernelRouteSync and any element on
+  another thread read those through snapshot() without locking, while the
+  computation goes on changing its own state. The computation also has the
+  OLSRTopologyInfoBase publish its tuples, if they changed.
+
+  The information bases and message processing elements do not compute
+  routes themselves but call schedule_compute_routing_table() or
+  schedule_update_routing_table(). These mark the table dirty and run one
+  computation from a Task once the current burst of messages has been
+  processed, at most once every MIN_INTERVAL, and never later than MAX_DELAY
+  after the first change.
+
+  Each of these calls also stamps the event that caused it with an id, its
+  type and the time: a link or two-hop tuple expiring, a link layer
+  transmission failure (OLSRRecoverFromLinkLayer), a HELLO, a TC or the
+  expiry of topology tuples, a MID or an HNA. The events stamped since the
+  last computation, including those that reached this element through an
+  MPR recomputation, are taken by the next computation, which records their
+  queueing delay; once its routes are installed, it records their latency
+  from event to install, or counts them as unchanged if the routes stayed
+  the same. Link failures that fail_over() repairs at once are installed
+  with the alternates. Both are kept per event type in microseconds, and
+  every Snapshot carries the id of the last event its routes reflect.
+
+  On an SMP router the computation stays off the forwarding threads when
+  this element's Task, the Task of an OLSRNeighborInfoBase with DEFER_MPR,
+  and the Unqueue feeding the OLSR messages from a ThreadSafeQueue are all
+  bound to one thread with StaticThreadSched. The information bases are not
+  locked, so these must share that thread; the forwarding threads only read
+  the routes, which an OLSRRadixIPLookup switches atomically.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item SUBNET_MASK
+
+  IP address. Netmask of the local network, used for visitor detection.
+
+  =item VISITOR_INFO
+
+  OLSRAssociationInfoBase element receiving the routes to visiting nodes,
+  the hosts outside SUBNET_MASK. Each computation only adds and removes the
+  tuples of the visitors that arrived, left or changed gateway. The tuples
+  do not expire, so the element should have USE_TIMER false and should not
+  be changed otherwise.
+
+  =item INCREMENTAL
+
+  Boolean. If false, update_routing_table() always does a full rebuild.
+  Default is true.
+
+  =item MIN_INTERVAL
+
+  Integer. Minimum time between two scheduled computations, in msecs.
+  Default is 0.
+
+  =item MAX_DELAY
+
+  Integer. Maximum time a scheduled computation is held back by
+  MIN_INTERVAL, in msecs. Default is 1000.
+
+  =item VALIDATE
+
+  Boolean. If true, every incremental update is checked against a full
+  rebuild; on mismatch the rebuilt routes are used and the failure is counted.
+  Default is false.
+
+  =item BACKUP_ROUTES
+
+  Boolean. If true, every computation also selects a loop-free alternate
+  next hop for each route (RFC 5286): a symmetric neighbor N other than the
+  primary next hop whose own shortest path to the destination D is shorter
+  than its path through this node S, dist(N, D) < dist(N, S) + dist(S, D).
+  Distances from the neighbors are found breadth first over the links,
+  two-hop and topology sets. Alternates that also avoid the primary next
+  hop node are preferred, then the closer ones. fail_over() switches the
+  routes through a failed next hop to their alternates at once and
+  schedules a full computation. Default is false.
+
+  =item MULTIPATH
+
+  Integer. If greater than 1, every computation also collects up to this
+  many equal-cost next hops for each host route of two hops or more: the
+  primary one and the symmetric neighbors N whose own shortest path to the
+  destination D is one hop shorter than the route, dist(N, D) = dist(S, D) -
+  1. Distances from the neighbors are found as for BACKUP_ROUTES. An
+  OLSRMultipathLookup spreads the flows over them; the routes written to the
+  lookup element are unchanged. Routes to HNA networks keep their single
+  next hop. Cannot be combined with LINK_QUALITY. Default is 1.
+
+  =item GATEWAY_BALANCE
+
+  Boolean. If true, networks advertised by several reachable HNA gateways,
+  such as the default route, are shared among all of them instead of going
+  to the closest one: the flows are hashed into 64 buckets, and every
+  gateway gets a number of buckets in proportion to the capacity it has
+  left, as its OLSRHNAGenerator advertises in GATEWAY_LOAD messages.
+  Gateways that advertise none count like the least free one that does, or
+  all equally. When the gateways stay the same, the buckets are only
+  redistributed once a free capacity has moved by more than
+  GATEWAY_HYSTERESIS, and a redistribution moves as few buckets as it can,
+  so that flows stay with their gateway. An OLSRMultipathLookup applies the
+  shares; the lookup element still gets the route through the closest
+  gateway. Default is false.
+
+  =item GATEWAY_HYSTERESIS
+
+  Integer. Percentage by which the free capacity of a gateway has to change
+  before GATEWAY_BALANCE redistributes the buckets. Default is 20.
+
+  =item LINK_QUALITY
+
+  Boolean. If true, routes to nodes beyond the symmetric neighbors minimize
+  the sum of the ETX of their links (see olsr_etx) instead of the number of
+  hops; the same Dijkstra pass over the two-hop and topology sets then
+  weighs each link by its ETX instead of 1. The link qualities are measured by OLSRProcessHello and
+  carry over in LQ_HELLO and LQ_TC messages, so the HELLO and TC generators
+  of all nodes must have LINK_QUALITY on as well. Neighbors are still
+  reached directly. Every computation is a full one, and BACKUP_ROUTES,
+  which reasons in hops, cannot be used. With LINK_RATES on the
+  OLSRLinkInfoBase, the links of this node weigh their expected
+  transmission time instead (see olsr_ett and OLSRLinkRate), and so do
+  those in the LQ_TC messages of nodes that have LINK_RATES too. Default is
+  false.
+
+  =item THREADS
+
+  Integer. If greater than 1, computations over a topology of at least
+  PARALLEL_THRESHOLD tuples are shared among this many threads: the one
+  running this element and THREADS - 1 worker threads, which exist only at
+  user level with multithreading. Without LINK_QUALITY steps 3 and 4 of full
+  rebuilds are then run one hop count at a time, each thread expanding a slice of the
+  nodes just reached over the topology set, and the nodes they find are
+  claimed in the order the single threaded pass would have claimed them, so
+  the routes are the same. Steps 5 and 6 look up the routes that the MID
+  and HNA tuples attach to in slices as well. With LINK_QUALITY only steps 5
+  and 6 are shared. Default is 1.
+
+  =item PARALLEL_THRESHOLD
+
+  Unsigned integer. Number of topology tuples from which THREADS is used; smaller
+  topologies are not worth waking the workers for. Default is 1000.
+
+  =item AGGREGATE
+
+  Boolean. If true, the routes are compressed before they are written to
+  the lookup element (see OLSRRouteCompressor): host and HNA routes with the
+  same gateway and output port that are adjacent or covered by a shorter
+  prefix are merged into as few prefixes as forward every address the same
+  way, so that meshes numbered from one subnet need far fewer routes. The
+  compressed table is diffed against the one written before, and only the
+  prefixes that changed are written, to the lookup element and to an
+  OLSRKernelRouteSync. The routes and delta handlers, the deltas handed to
+  Listeners and route_distance() still see the uncompressed routes;
+  lookup_delta() and Snapshot::lookup_routes() give the compressed ones,
+  as they give the working set with LAZY.
+  The lookup element should hold no other routes overlapping the OLSR ones,
+  which a merged shorter prefix could otherwise lose to. Default is false.
+
+  =item LAZY
+
+  Boolean. If true, the routes are still all computed, but the lookup
+  element, which must be an OLSRRadixIPLookup, only gets those traffic
+  needs: the routes to networks, to symmetric neighbors and to HNA gateways,
+  and the host routes to destinations it missed within LAZY_TIMEOUT. A
+  packet to a destination without a host route in the lookup element is
+  forwarded along the route of the current snapshot, from the lookup's own
+  thread (see OLSRRadixIPLookup::MissHandler), and the destination is added
+  to the working set, whose routes this element's Task installs. The lookup
+  element and the cost of writing to it then follow the working set rather
+  than the size of the network. Cannot be used with OLSRKernelRouteSync,
+  since the kernel does not call back. Default is false.
+
+  =item LAZY_TIMEOUT
+
+  Integer. Time a destination stays in the working set of LAZY after its
+  last miss, in msecs; a destination still in use then misses once more.
+  Default is 30000.
+
+  =item TRACE
+
+  OLSRTrace element recording the arrival and departure of visitors.
+
+  =item TRACE_MASK
+
+  Unsigned. Events recorded in TRACE. Default is all.
+
+  =back
+
+  =h stats read-only
+  Number of full rebuilds, incremental updates, repaired destinations and
+  validation failures, as well as scheduled computation requests, the
+  computations run for them and the number of requests coalesced, fail-overs,
+  the number of computations shared among THREADS, the generation, the number of route changes installed and the number of
+  bucket redistributions of GATEWAY_BALANCE, and the scheduled computations
+  skipped as no neighbor, 2-hop, link, topology, interface or association
+  tuple had changed since the last one. With AGGREGATE or LAZY, also
+  the number of routes written to the lookup element and of changes
+  written; with LAZY, the misses, the misses not recorded as too many were
+  pending, and the size of the working set.
+
+  =h lookup_routes read-only
+  The routes written to the lookup element, as for the routes handler; the
+  compressed ones with AGGREGATE, whose hop distance is 0 where merged, and
+  only those of the working set with LAZY.
+
+  =h coalesced read-only
+  Number of scheduled computation requests that were merged into another
+  computation.
+
+  =h backups read-only
+  Alternate routes selected with BACKUP_ROUTES, one per line.
+
+  =h profile read-only
+  Processor cycles spent in each phase of the computations, one phase per
+  line with the number of runs, their total, maximum and average, and a
+  histogram by powers of two from below 2^10 to 2^24 and more (see
+  OLSRPhaseProfile): steps 2 (neighbors), 3 (twohop) and 4 (topology) of
+  full rebuilds, including those made for VALIDATE; incremental repairs
+  after topology changes (repair); the alternates of BACKUP_ROUTES
+  (backups); the equal-cost next hops of MULTIPATH (multipaths); step 5 (interfaces), the visitor set (visitors), step 6 (hna);
+  writing the delta to the lookup element and the listeners (apply); and
+  whole full and incremental computations (full, incremental).
+
+  =h clear_profile write-only
+  Resets the profile counters.
+
+  =h multipaths read-only
+  Host routes with more than one next hop under MULTIPATH, one per line:
+  the destination followed by the gateway and output port of every next
+  hop, the primary one first.
+
+  =h gateways read-only
+  Networks shared among gateways under GATEWAY_BALANCE, one per line: the
+  network followed by every gateway with the free capacity its buckets were
+  given for and its number of buckets.
+
+  =h routes read-only
+  The installed routes of the current snapshot, one per line: the prefix,
+  gateway, output port and hop distance.
+
+  =h delta read-only
+  The routes added, removed or changed by the last computation that changed
+  any, from the current snapshot, one per line: "add", "remove" or "change", the prefix, and for
+  additions and changes the new gateway and output port. A change may keep
+  the gateway and port and only have another hop distance.
+
+  =h recompute write-only
+  Forces a full rebuild of the routing table.
+
+  =h events read-only
+  The number of events stamped, the number dropped because MAX_PENDING_EVENTS
+  were pending, the number pending and the id of the last event installed,
+  followed per event type by the queueing delay (".queueing") and the latency
+  from event to install (".install"), as for the profile handler but in
+  microseconds, so that the histogram starts below 1.024 ms, and the number
+  of events whose computation left the routes unchanged (".unchanged"). The
+  event types are link_expired, link_failure, twohop_expired, hello, tc,
+  tc_expired, mid, hna, link_degraded and other.
+
+  =h clear_events write-only
+  Resets the event statistics.
+
+  =h memory read-only
+  Per kind of route kept (computed routes, installed routes, backups,
+  multipaths, gateway balances, visitors, and with AGGREGATE or LAZY the
+  routes written to the lookup element, with the trie that compressed them
+  and the working set) the number of them and the bytes
+  they use, and the highest of both seen; see OLSRMemoryReport.
+
+  =a
+  OLSRRadixIPLookup, OLSRLinearIPLookup, OLSRTopologyInfoBase,
+  OLSRMultipathLookup
+*/
 
 #ifndef OLSR_RTABLE_HH
 #define OLSR_RTABLE_HH
 
 #include <click/element.hh>
 #include <click/bighashmap.hh>
+#include <click/timer.hh>
+#include <click/task.hh>
 #include "olsr_link_infobase.hh"
 #include "olsr_neighbor_infobase.hh"
 #include "olsr_topology_infobase.hh"
 #include "olsr_interface_infobase.hh"
 #include "olsr_association_infobase.hh"
 #include "click_olsr.hh"
-#include "olsr_lineariplookup.hh"
-
-#define logging
+#include "ippair.hh"
+#include "olsr_radixiplookup.hh"
+#include "olsr_trace.hh"
+#include "olsr_profile.hh"
+#include "olsr_memory_report.hh"
+#include "olsr_worker_pool.hh"
+#include "olsr_published.hh"
+#include "olsr_route_compress.hh"
 
 CLICK_DECLS
 
@@ -24,7 +343,7 @@ class OLSRInterfaceInfoBase;
 class OLSRAssociationInfoBase;
 
 
-class OLSRRoutingTable: public Element {
+class OLSRRoutingTable: public Element, public OLSRTrace::Client, public OLSRMemoryReport::Client, public OLSRRadixIPLookup::MissHandler {
 public:
 
   OLSRRoutingTable();
@@ -37,14 +356,294 @@ public:
   int configure(Vector<String> &conf, ErrorHandler *errh);
   int initialize(ErrorHandler *);
   void uninitialize();
+  void take_state(Element *, ErrorHandler *);
+
+  void add_handlers();
+  void *cast(const char *);
+  void memory_usage(Vector<OLSRMemoryReport::Usage> &);
+  bool run_task(Task *);
+  void run_timer(Timer *);
 
   //IPAddress get_next_hop(const IPAddress& destination);
   //IPAddress get_output_interface(const IPAddress& destination);
   void print_routing_table();
   void compute_routing_table();
+  void update_routing_table();
+  void schedule_compute_routing_table(int event = EVENT_OTHER);
+  void schedule_update_routing_table(int event = EVENT_OTHER);
+
+  void topology_tuple_added(const IPAddress &dest_addr, const IPAddress &last_addr);
+  void topology_tuple_removed(const IPAddress &dest_addr, const IPAddress &last_addr);
+  void twohop_tuple_added(const IPAddress &twohop_addr, const IPAddress &neigh_addr);
+  void twohop_tuple_removed(const IPAddress &twohop_addr, const IPAddress &neigh_addr);
+  void interface_tuple_changed(const IPAddress &main_addr);
+
+  bool fail_over(const IPAddress &gw);
+
+  // the events that change the topology, stamped as they reach this element
+  enum { EVENT_LINK_EXPIRED, EVENT_LINK_FAILURE, EVENT_TWOHOP_EXPIRED, EVENT_HELLO,
+	 EVENT_TC, EVENT_TC_EXPIRED, EVENT_MID, EVENT_HNA, EVENT_LINK_DEGRADED,
+	 EVENT_OTHER, NEVENT_TYPES };
+  // stamps an event the next computation is to account for; returns its
+  // id, or 0 if too many are pending
+  unsigned note_event(int type);
+
+  enum { ROUTE_ADDED, ROUTE_REMOVED, ROUTE_CHANGED };
+  struct RouteChange {
+    int type;
+    IPRoute route;	// the new route, or the removed one
+    IPRoute old_route;	// the route replaced by ROUTE_CHANGED
+  };
+
+  class Listener { public:
+    virtual ~Listener() { }
+    // called after each computation that changed the installed routes
+    virtual void routes_changed(const Vector<RouteChange> &delta) = 0;
+  };
+
+  void add_listener(Listener *listener);
+  const Vector<RouteChange> &last_delta() const	{ return _delta; }
+  // the delta of the last change written to the lookup element: last_delta()
+  // unless AGGREGATE compresses the routes or LAZY picks some
+  const Vector<RouteChange> &lookup_delta() const	{ return own_lookup() ? _lookup_delta : _delta; }
+  bool lazy() const				{ return _lazy; }
+  IPRouteTable *route_table() const		{ return _routeTable; }
+  int route_missed(IPAddress dst, IPAddress &gw);
+  unsigned generation() const			{ return _generation; }
+  int route_distance(const IPAddress &dest) const;
+
+  // the next hops of the host route to dst, primary first, if MULTIPATH
+  // found more than one
+  const Vector<IPRoute> *multipath(const IPAddress &dst) const { return _multipaths.findp(dst); }
+  // the route for flow_hash if the longest installed prefix matching dst is
+  // shared among gateways by GATEWAY_BALANCE, else 0
+  const IPRoute *balanced_route(const IPAddress &dst, uint32_t flow_hash) const;
+  bool balancing() const			{ return !_balanced.empty(); }
+
+  // the installed routes as of one computation, never changed once published
+  struct Snapshot {
+    HashMap<IPPair, IPRoute> routes;	// extra is the hop distance
+    Vector<RouteChange> delta;		// from the previous snapshot
+    unsigned generation;
+    unsigned last_event;		// id of the last event reflected
+    HashMap<IPPair, IPRoute> lookup;	// as written with AGGREGATE or LAZY, else empty
+    bool own_lookup;
+    const HashMap<IPPair, IPRoute> &lookup_routes() const { return own_lookup ? lookup : routes; }
+  };
+  typedef OLSRPublished<Snapshot>::Ref SnapshotRef;
+  SnapshotRef snapshot() const		{ return _snapshot.get(); }
 
 private:
 
+  struct RouteEntry {
+    IPAddress gw;
+    int port;
+    int dist;
+    IPAddress last;	// node this route was derived from
+    int cost;		// sum of the links' ETX, with LINK_QUALITY
+  };
+
+  struct RepairItem {
+    int dist;
+    IPAddress dest;
+    IPAddress last;
+    int cost;
+    int order;		// ties go to the item pushed first
+  };
+  struct repair_less {
+    bool operator()(const RepairItem &a, const RepairItem &b) const { return a.dist < b.dist; }
+  };
+  struct cost_less {
+    bool operator()(const RepairItem &a, const RepairItem &b) const {
+      return a.cost < b.cost || (a.cost == b.cost && a.order < b.order);
+    }
+  };
+
+  typedef HashMap<IPAddress, RouteEntry> RouteMap;
+  typedef HashMap<IPPair, IPRoute> RouteTable;
+  typedef HashMap<IPAddress, IPAddress> VisitorMap;
+  typedef HashMap<IPAddress, Vector<IPRoute> > MultipathTable;
+  typedef HashMap<IPAddress, Vector<IPAddress> > Adjacency;
+
+  enum { BALANCE_BUCKETS = 64 };
+  struct GatewayShare {
+    IPAddress gateway;
+    int weight;		// free capacity the buckets were given for
+    IPRoute route;	// to the network through this gateway
+  };
+  struct Balance {
+    Vector<GatewayShare> shares;
+    uint8_t buckets[BALANCE_BUCKETS];	// index into shares, by flow hash
+  };
+  typedef HashMap<IPPair, Balance> BalanceTable;
+
+  RouteMap _routes;		// routes of steps 2-4, keyed by destination
+  RouteTable _installed;	// routes currently in _routeTable
+  RouteTable _backups;		// loop-free alternates of _installed, with BACKUP_ROUTES
+  MultipathTable _multipaths;	// equal-cost next hops of the host routes in _installed, with MULTIPATH
+  BalanceTable _balanced;	// networks of _installed shared among gateways, with GATEWAY_BALANCE
+  Vector<IPAddress> _installed_masks;	// netmasks in _installed, longest first, with GATEWAY_BALANCE
+  VisitorMap _visitors;		// visitor -> gateway of its tuple in _visitorInfo
+  Vector<RouteChange> _delta;	// of the last change to _installed
+  bool _aggregate;
+  OLSRRouteCompressor _compressor;
+  RouteTable _lookup;		// _installed as in _routeTable, with AGGREGATE or LAZY
+  Vector<RouteChange> _lookup_delta;	// of the last change to _lookup
+  unsigned _lookup_changes;
+
+  enum { MAX_MISSES = 1024 };
+  bool _lazy;
+  olsr_time_t _lazy_timeout;
+  HashMap<IPAddress, olsr_time_t> _wanted;	// working set of LAZY, with expiry
+  Vector<IPAddress> _missed;	// by the lookup element, not yet in _wanted
+  Spinlock _missed_lock;
+  unsigned _misses;
+  unsigned _misses_dropped;
+  Timer _lazy_timer;
+  OLSRPublished<Snapshot> _snapshot;
+  Vector<Listener *> _listeners;
+  unsigned _generation;
+  unsigned _route_changes;
+
+  enum { MAX_PENDING_EVENTS = 1024 };
+  struct Event {
+    unsigned id;
+    int type;
+    olsr_time_t time;
+  };
+  Vector<Event> _events;	// stamped, not yet taken by a computation
+  Vector<Event> _computing;	// taken by the running computation
+  unsigned _next_event;
+  unsigned _events_stamped;
+  unsigned _events_dropped;
+  unsigned _installed_event;	// id of the last event whose routes were installed
+  unsigned _events_unchanged[NEVENT_TYPES];
+  OLSRPhaseProfile _event_queueing[NEVENT_TYPES];	// stamp to computation, in usecs
+  OLSRPhaseProfile _event_install[NEVENT_TYPES];	// stamp to install, in usecs
+
+  Task _task;
+  Timer _timer;
+  int _min_interval;
+  int _max_delay;
+  bool _scheduled;
+  bool _scheduled_full;
+  Timestamp _last_computation;
+  unsigned _schedule_requests;
+  unsigned _scheduled_computations;
+  unsigned _coalesced;
+
+  // generations of the infobases the last computation read; a scheduled
+  // computation finding the same ones would install the same routes, and
+  // is skipped. Not kept with LINK_QUALITY or GATEWAY_BALANCE, whose link
+  // rates and gateway loads change without a tuple changing
+  struct Inputs {
+    unsigned neighbors;
+    uint32_t links;
+    uint32_t topology;
+    unsigned interfaces;
+    uint32_t associations;
+  };
+  Inputs _inputs;
+  bool _inputs_valid;
+  unsigned _unchanged_skips;
+
+  bool _incremental;
+  bool _validate;
+  bool _full_rebuild_needed;
+
+  unsigned _full_rebuilds;
+  unsigned _incremental_updates;
+  unsigned _repaired_routes;
+  unsigned _validation_failures;
+
+  bool _link_quality;
+
+  bool _backup_routes;
+  unsigned _fail_overs;
+  unsigned _routes_failed_over;
+
+  int _multipath;
+
+  bool _gateway_balance;
+  int _gateway_hysteresis;
+  unsigned _rebalances;
+
+  int _threads;
+  unsigned _parallel_threshold;
+  unsigned _parallel_computations;
+  OLSRWorkerPool _workers;
+
+  // the state a worker slice of a route computation reads and writes
+  struct ExpandJob {
+    const OLSRTopologyInfoBase *topology;
+    const RouteMap *routes;
+    IPAddress my_ip;
+    const Vector<RepairItem> *level;	// nodes reached at one hop count
+    Vector<RepairItem> found[OLSRWorkerPool::MAX_THREADS];	// per slice
+  };
+  struct AttachJob {
+    const RouteMap *routes;
+    const RouteTable *table;
+    const Vector<interface_data *> *interfaces;
+    Vector<RouteEntry *> *main_routes;	// step 5, per interface
+    const Vector<association_data *> *associations;
+    Vector<IPRoute *> *gw_routes;	// step 6, per association
+  };
+
+  enum { PROFILE_NEIGHBORS, PROFILE_TWOHOP, PROFILE_TOPOLOGY, PROFILE_REPAIR,
+	 PROFILE_BACKUPS, PROFILE_MULTIPATHS, PROFILE_INTERFACES, PROFILE_VISITORS, PROFILE_HNA,
+	 PROFILE_APPLY, PROFILE_FULL, PROFILE_INCREMENTAL, PROFILE_NPHASES };
+  OLSRPhaseProfile _profile[PROFILE_NPHASES];
+
+  void compute_host_routes(RouteMap &routes);
+  void compute_distant_routes(RouteMap &routes);
+  bool parallel_computation();
+  void expand_levels(RouteMap &routes, Vector<RepairItem> &level);
+  static void expand_slice(void *thunk, int slice, int begin, int end);
+  static void attach_interfaces(void *thunk, int slice, int begin, int end);
+  static void attach_associations(void *thunk, int slice, int begin, int end);
+  void propagate_routes(const IPAddress &from);
+  void repair_subtree(const IPAddress &root, const IPAddress *root_via = 0);
+  bool validate_routes();
+  void install_routes();
+  void apply_routes(RouteTable &table);
+  static void diff_routes(const RouteTable &old, const RouteTable &table, Vector<RouteChange> &delta);
+  void write_routes(const RouteTable &table, const Vector<RouteChange> &delta);
+  bool own_lookup() const		{ return _aggregate || _lazy; }
+  void update_lookup();
+  bool take_misses();
+  void expire_wanted();
+  void publish_snapshot();
+  void update_visitors(const RouteTable &table);
+  void build_adjacency(Adjacency &adjacency, Vector<IPAddress> &neighbors);
+  static void hop_distances(const Adjacency &adjacency, const IPAddress &from, HashMap<IPAddress, int> &distance, Vector<IPAddress> &queue);
+  void compute_alternates(RouteMap &alternates);
+  static void add_backup(RouteTable &backups, const IPRoute &route, const RouteEntry *alternate);
+  void compute_multipaths(HashMap<IPAddress, Vector<IPAddress> > &next_hops);
+  void add_multipath(MultipathTable &multipaths, const IPRoute &route, const Vector<IPAddress> *next_hops);
+  void update_balance(BalanceTable &candidates);
+  static void assign_buckets(Balance &balance, const Balance *old);
+  void schedule_computation(bool full);
+  void take_events(int type = -1);
+  void finish_events(bool changed);
+  void cancel_scheduled(bool full);
+  void record_inputs();
+  bool inputs_unchanged() const;
+  static void set_route(RouteMap &routes, const IPAddress &dest, const IPAddress &gw, int port, int dist, const IPAddress &last, int cost = 0);
+
+  static String read_handler(Element *, void *);
+  static String read_backups(Element *, void *);
+  static String read_multipaths(Element *, void *);
+  static String read_gateways(Element *, void *);
+  static String read_delta(Element *, void *);
+  static String read_routes(Element *, void *);
+  static String read_lookup_routes(Element *, void *);
+  static String read_profile(Element *, void *);
+  static int clear_profile_handler(const String &, Element *, void *, ErrorHandler *);
+  static int recompute_handler(const String &, Element *, void *, ErrorHandler *);
+  static String read_events(Element *, void *);
+  static int clear_events_handler(const String &, Element *, void *, ErrorHandler *);
+
   //typedef HashMap<IPAddress, void *> RTable;
   //class RTable *_routingTable;
   IPAddress _myIP;
@@ -55,7 +654,8 @@ private:
   OLSRTopologyInfoBase *_topologyInfo;
   OLSRLocalIfInfoBase *_localIfaces;
   OLSRAssociationInfoBase *_associationInfo;
-  OLSRLinearIPLookup *_linearIPlookup;
+  IPRouteTable *_routeTable;
+  OLSRRadixIPLookup *_radixLookup;	// _routeTable, if it can publish whole tables
   OLSRAssociationInfoBase *_visitorInfo;
   ErrorHandler *_errh;
 
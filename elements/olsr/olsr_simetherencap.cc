@@ -0,0 +1,142 @@
+/*
+ * olsr_simetherencap.{cc,hh} -- Ethernet encapsulation without ARP for
+ * simulated OLSR nodes
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ether.h>
+#include "olsr_simetherencap.hh"
+
+CLICK_DECLS
+
+OLSRSimEtherEncap::AddressTable *OLSRSimEtherEncap::_table = 0;
+int OLSRSimEtherEncap::_table_users = 0;
+
+OLSRSimEtherEncap::OLSRSimEtherEncap()
+  : _unknown(0)
+{
+}
+
+
+OLSRSimEtherEncap::~OLSRSimEtherEncap()
+{
+}
+
+
+int
+OLSRSimEtherEncap::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  _bcast = IPAddress();
+  return cp_va_parse(conf, this, errh,
+		     cpIPAddress, "IP address", &_ip,
+		     cpEthernetAddress, "Ethernet address", &_ether,
+		     cpKeywords,
+		     "BROADCAST", cpIPAddress, "local broadcast address", &_bcast,
+		     cpEnd);
+}
+
+
+int
+OLSRSimEtherEncap::initialize(ErrorHandler *errh)
+{
+  if (!_table)
+    _table = new AddressTable;
+
+  Entry *entry = _table->findp(_ip);
+  if (entry && entry->ether != _ether) {
+    if (_table_users == 0) {
+      delete _table;
+      _table = 0;
+    }
+    return errh->error("%s is %s already", _ip.unparse().c_str(), entry->ether.unparse().c_str());
+  }
+  if (entry)
+    entry->users++;
+  else {
+    Entry e;
+    e.ether = _ether;
+    e.users = 1;
+    _table->insert(_ip, e);
+  }
+  _table_users++;
+  return 0;
+}
+
+
+void
+OLSRSimEtherEncap::cleanup(CleanupStage stage)
+{
+  if (stage < CLEANUP_INITIALIZED || !_table)
+    return;
+  Entry *entry = _table->findp(_ip);
+  if (entry && --entry->users == 0)
+    _table->remove(_ip);
+  if (--_table_users == 0) {
+    delete _table;
+    _table = 0;
+  }
+}
+
+
+Packet *
+OLSRSimEtherEncap::simple_action(Packet *p)
+{
+  IPAddress dst = p->dst_ip_anno();
+  const Entry *entry = 0;
+  static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+  if (!dst) {
+    p->kill();
+    return 0;
+  }
+  if (dst.addr() != 0xFFFFFFFFU && dst != _bcast) {
+    entry = _table->findp(dst);
+    if (!entry) {
+      _unknown++;
+      p->kill();
+      return 0;
+    }
+  }
+
+  WritablePacket *q = p->push_mac_header(sizeof(click_ether));
+  if (!q)
+    return 0;
+  click_ether *e = reinterpret_cast<click_ether *>(q->data());
+  memcpy(e->ether_dhost, entry ? entry->ether.data() : broadcast, 6);
+  memcpy(e->ether_shost, _ether.data(), 6);
+  e->ether_type = htons(ETHERTYPE_IP);
+  return q;
+}
+
+
+String
+OLSRSimEtherEncap::read_table(Element *, void *)
+{
+  StringAccum sa;
+  if (_table)
+    for (AddressTable::iterator iter = _table->begin(); iter != _table->end(); iter++)
+      sa << iter.key() << ' ' << iter.value().ether << '\n';
+  return sa.take_string();
+}
+
+
+String
+OLSRSimEtherEncap::read_unknown(Element *e, void *)
+{
+  OLSRSimEtherEncap *s = static_cast<OLSRSimEtherEncap *>(e);
+  return String(s->_unknown) + "\n";
+}
+
+
+void
+OLSRSimEtherEncap::add_handlers()
+{
+  add_read_handler("table", read_table, 0);
+  add_read_handler("unknown", read_unknown, 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRSimEtherEncap)
@@ -0,0 +1,94 @@
+#ifndef CLICK_OLSR_SIMETHERENCAP_HH
+#define CLICK_OLSR_SIMETHERENCAP_HH
+#include <click/element.hh>
+#include <click/etheraddress.hh>
+#include <click/ipaddress.hh>
+#include <click/bighashmap.hh>
+CLICK_DECLS
+
+/*
+=c
+
+OLSRSimEtherEncap(IP, ETH [, I<keywords>])
+
+=s Ethernet, encapsulation
+
+encapsulates IP packets in Ethernet headers without ARP, in ns-click
+
+=d
+
+Takes the place of OLSRARPQuerier in a simulation. Every
+OLSRSimEtherEncap registers its IP address IP and Ethernet address ETH in
+a table shared by all nodes of the simulation, which run in one process.
+An IP packet arriving on the input is given an Ethernet header from ETH to
+the address registered for its destination address annotation, the next
+hop, and sent to the output; no ARP query or reply is ever sent, and no
+packet waits for one.
+
+Packets to 0.0.0.0, and to addresses no node has registered, are dropped.
+Packets to 255.255.255.255 or the BROADCAST address go to
+FF:FF:FF:FF:FF:FF.
+
+The table is filled while the nodes are created and only read while the
+simulation runs, so nodes simulated by several worker threads share it
+without locking.
+
+Keyword arguments are:
+
+=over 8
+
+=item BROADCAST
+
+IP address. Local broadcast IP address. Default is none.
+
+=back
+
+=h table read-only
+The IP and Ethernet addresses of all nodes, one pair per line.
+
+=h unknown read-only
+Number of packets dropped for an unregistered next hop.
+
+=a
+OLSRARPQuerier, FromSimDevice, ToSimDevice */
+
+class OLSRSimEtherEncap : public Element { public:
+
+  OLSRSimEtherEncap();
+  ~OLSRSimEtherEncap();
+
+  const char *class_name() const	{ return "OLSRSimEtherEncap"; }
+  const char *port_count() const	{ return PORTS_1_1; }
+  const char *processing() const	{ return AGNOSTIC; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+
+ private:
+
+  struct Entry {
+    EtherAddress ether;
+    int users;			// elements registering it, old and new across a hotswap
+  };
+  typedef HashMap<IPAddress, Entry> AddressTable;
+
+  // shared by the routers of all simulated nodes
+  static AddressTable *_table;
+  static int _table_users;
+
+  IPAddress _ip;
+  EtherAddress _ether;
+  IPAddress _bcast;
+  uint32_t _unknown;
+
+  static String read_table(Element *, void *);
+  static String read_unknown(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,267 @@
+/*
+ * olsr_snapshot.{cc,hh} -- saves and restores the topology of an OLSR node
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include "olsr_snapshot.hh"
+#include "click_olsr.hh"
+
+CLICK_DECLS
+
+OLSRSnapshot::OLSRSnapshot()
+  : _associationInfo(0), _loaded(0), _timer(this)
+{
+}
+
+
+OLSRSnapshot::~OLSRSnapshot()
+{
+}
+
+
+int
+OLSRSnapshot::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *topology_info = 0, *interface_info = 0, *routing_table = 0, *association_info = 0;
+  _interval = 5000;
+  _hold = 15000;
+  if (cp_va_parse(conf, this, errh,
+		  cpFilename, "snapshot file", &_filename,
+		  cpElement, "TopologyInfoBase element", &topology_info,
+		  cpElement, "InterfaceInfoBase element", &interface_info,
+		  cpElement, "RoutingTable element", &routing_table,
+		  cpKeywords,
+		  "ASSOCIATION_INFO", cpElement, "AssociationInfoBase element", &association_info,
+		  "INTERVAL", cpInteger, "milliseconds between snapshots", &_interval,
+		  "HOLD", cpInteger, "longest validity of a restored tuple (msecs)", &_hold,
+		  0) < 0)
+    return -1;
+  if (!(_topologyInfo = (OLSRTopologyInfoBase *) topology_info->cast("OLSRTopologyInfoBase")))
+    return errh->error("TOPOLOGY_INFO element is not an OLSRTopologyInfoBase");
+  if (!(_interfaceInfo = (OLSRInterfaceInfoBase *) interface_info->cast("OLSRInterfaceInfoBase")))
+    return errh->error("INTERFACE_INFO element is not an OLSRInterfaceInfoBase");
+  if (!(_routingTable = (OLSRRoutingTable *) routing_table->cast("OLSRRoutingTable")))
+    return errh->error("ROUTING_TABLE element is not an OLSRRoutingTable");
+  if (association_info
+      && !(_associationInfo = (OLSRAssociationInfoBase *) association_info->cast("OLSRAssociationInfoBase")))
+    return errh->error("ASSOCIATION_INFO element is not an OLSRAssociationInfoBase");
+  if (_interval <= 0)
+    return errh->error("INTERVAL must be positive");
+  if (_hold <= 0)
+    return errh->error("HOLD must be positive");
+  return 0;
+}
+
+
+int
+OLSRSnapshot::initialize(ErrorHandler *errh)
+{
+  // a missing or unreadable snapshot only means a cold start
+  load(errh);
+  _timer.initialize(this);
+  _timer.schedule_after_msec(_interval);
+  return 0;
+}
+
+
+void
+OLSRSnapshot::cleanup(CleanupStage stage)
+{
+  // the information bases are cleaned up after this element
+  if (stage == CLEANUP_ROUTER_INITIALIZED)
+    save(ErrorHandler::default_handler());
+}
+
+
+void
+OLSRSnapshot::run_timer(Timer *)
+{
+  save(ErrorHandler::default_handler());
+  _timer.reschedule_after_msec(_interval);
+}
+
+
+uint32_t
+OLSRSnapshot::validity_left(olsr_time_t expiry, olsr_time_t now)
+{
+  if (expiry <= now)
+    return 0;
+  return (expiry - now) / 1000;
+}
+
+
+int
+OLSRSnapshot::save(ErrorHandler *errh)
+{
+  olsr_time_t now = olsr_now();
+
+  Vector<Record> records;
+  Record r;
+  r.reserved = 0;
+
+  OLSRTopologyInfoBase::TopologySet *topologySet = _topologyInfo->get_topology_set();
+  for (OLSRTopologyInfoBase::TopologySet::iterator iter = topologySet->begin(); iter != topologySet->end(); iter++) {
+    const topology_data &data = iter.value();
+    r.type = TOPOLOGY_RECORD;
+    r.seq = htons(data.T_seq);
+    r.validity = htonl(validity_left(data.T_time, now));
+    r.addr[0] = data.T_dest_addr.addr();
+    r.addr[1] = data.T_last_addr.addr();
+    r.addr[2] = htonl(data.T_cost);
+    if (r.validity)
+      records.push_back(r);
+  }
+
+  OLSRInterfaceInfoBase::InterfaceSet *interfaceSet = _interfaceInfo->get_interface_set();
+  for (OLSRInterfaceInfoBase::InterfaceSet::iterator iter = interfaceSet->begin(); iter != interfaceSet->end(); iter++) {
+    const interface_data &data = iter.value();
+    r.type = INTERFACE_RECORD;
+    r.seq = 0;
+    r.validity = htonl(validity_left(data.I_time, now));
+    r.addr[0] = data.I_iface_addr.addr();
+    r.addr[1] = data.I_main_addr.addr();
+    r.addr[2] = 0;
+    if (r.validity)
+      records.push_back(r);
+  }
+
+  if (_associationInfo) {
+    OLSRAssociationInfoBase::AssociationSet *associationSet = _associationInfo->get_association_set();
+    for (OLSRAssociationInfoBase::AssociationSet::iterator iter = associationSet->begin(); iter != associationSet->end(); iter++) {
+      const association_data &data = iter.value();
+      r.type = ASSOCIATION_RECORD;
+      r.seq = 0;
+      r.validity = htonl(validity_left(data.A_time, now));
+      r.addr[0] = data.A_gateway_addr.addr();
+      r.addr[1] = data.A_network_addr.addr();
+      r.addr[2] = data.A_netmask.addr();
+      if (r.validity)
+	records.push_back(r);
+    }
+  }
+
+  Header h;
+  h.magic = htonl(MAGIC);
+  h.version = htons(VERSION);
+  h.reserved = 0;
+  Timestamp written = Timestamp::now();
+  h.written_sec = htonl(written.sec());
+  h.written_usec = htonl(written.usec());
+  h.nrecords = htonl(records.size());
+
+  String tmpname = _filename + ".tmp";
+  FILE *f = fopen(tmpname.c_str(), "wb");
+  if (!f)
+    return errh->error("%s: %s", tmpname.c_str(), strerror(errno));
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  if (ok && records.size())
+    ok = fwrite(&records[0], sizeof(Record), records.size(), f) == (size_t) records.size();
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok || rename(tmpname.c_str(), _filename.c_str()) != 0) {
+    int err = errno;
+    remove(tmpname.c_str());
+    return errh->error("%s: %s", _filename.c_str(), strerror(err));
+  }
+  return 0;
+}
+
+
+int
+OLSRSnapshot::load(ErrorHandler *errh)
+{
+  FILE *f = fopen(_filename.c_str(), "rb");
+  if (!f)
+    return -ENOENT;
+
+  Header h;
+  if (fread(&h, sizeof(h), 1, f) != 1 || ntohl(h.magic) != MAGIC || ntohs(h.version) != VERSION) {
+    fclose(f);
+    return errh->warning("%s: not an OLSR snapshot, ignored", _filename.c_str());
+  }
+
+  // the file may come from before a reboot, so its age is wall-clock time
+  Timestamp wall_now = Timestamp::now();
+  Timestamp written = Timestamp::make_usec(ntohl(h.written_sec), ntohl(h.written_usec));
+  int64_t age = 0;		// milliseconds
+  if (written < wall_now)
+    age = (wall_now - written).msecval();
+  olsr_time_t now = olsr_now();
+
+  uint32_t nrecords = ntohl(h.nrecords);
+  Record r;
+  _topologyInfo->begin_bulk();
+  _interfaceInfo->begin_bulk();
+  if (_associationInfo)
+    _associationInfo->begin_bulk();
+  for (uint32_t i = 0; i < nrecords && fread(&r, sizeof(r), 1, f) == 1; i++) {
+    int64_t validity = (int64_t) ntohl(r.validity) - age;
+    if (validity <= 0)
+      continue;
+    if (validity > _hold)
+      validity = _hold;
+    olsr_time_t expiry = now + olsr_msec(validity);
+
+    if (r.type == TOPOLOGY_RECORD) {
+      IPAddress dest_addr(r.addr[0]), last_addr(r.addr[1]);
+      if (_topologyInfo->find_tuple(dest_addr, last_addr))
+	continue;
+      if (topology_data *data = _topologyInfo->add_tuple(dest_addr, last_addr, expiry, ntohs(r.seq))) {
+	data->T_cost = ntohl(r.addr[2]);
+	_loaded++;
+      }
+    } else if (r.type == INTERFACE_RECORD) {
+      IPAddress iface_addr(r.addr[0]);
+      if (!_interfaceInfo->find_interface(iface_addr)
+	  && _interfaceInfo->add_interface(iface_addr, IPAddress(r.addr[1]), expiry))
+	_loaded++;
+    } else if (r.type == ASSOCIATION_RECORD && _associationInfo) {
+      IPAddress gateway_addr(r.addr[0]), network_addr(r.addr[1]), netmask(r.addr[2]);
+      if (!_associationInfo->find_tuple(gateway_addr, network_addr, netmask)
+	  && _associationInfo->add_tuple(gateway_addr, network_addr, netmask, expiry))
+	_loaded++;
+    }
+  }
+  fclose(f);
+
+  // one expiry heap build and one full route computation, after the costs
+  // were set
+  _topologyInfo->commit_bulk();
+  _interfaceInfo->commit_bulk();
+  if (_associationInfo)
+    _associationInfo->commit_bulk();
+  return 0;
+}
+
+
+String
+OLSRSnapshot::read_loaded(Element *e, void *)
+{
+  OLSRSnapshot *s = (OLSRSnapshot *) e;
+  return String(s->_loaded) + "\n";
+}
+
+
+int
+OLSRSnapshot::save_handler(const String &, Element *e, void *, ErrorHandler *errh)
+{
+  OLSRSnapshot *s = (OLSRSnapshot *) e;
+  return s->save(errh);
+}
+
+
+void
+OLSRSnapshot::add_handlers()
+{
+  add_read_handler("loaded", read_loaded, 0);
+  add_write_handler("save", save_handler, 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRSnapshot);
+ELEMENT_REQUIRES(userlevel);
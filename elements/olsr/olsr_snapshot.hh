@@ -0,0 +1,134 @@
+/*
+  =c
+  OLSRSnapshot(FILENAME, TOPOLOGY_INFO, INTERFACE_INFO, ROUTING_TABLE [, KEYWORDS])
+
+  =s
+  OLSR specific element, saves the topology of an OLSR node for a warm restart
+
+  =io
+  None
+
+  =d
+  Writes the tuples of the OLSRTopologyInfoBase TOPOLOGY_INFO, the
+  OLSRInterfaceInfoBase INTERFACE_INFO and, if given, the
+  OLSRAssociationInfoBase ASSOCIATION_INFO to FILENAME every INTERVAL
+  milliseconds, and once more when the router is removed. The snapshot is
+  written to FILENAME.tmp and renamed, so a crash leaves the previous one
+  intact.
+
+  When the router starts, an existing FILENAME is loaded back. Every tuple
+  keeps the validity it had when the snapshot was written, less the time
+  since, and at most HOLD milliseconds; tuples that would have expired in
+  the meantime are dropped. ROUTING_TABLE then computes its routes. The
+  link and neighbor sets are not saved, since only a HELLO proves a link
+  symmetric, but as soon as the first neighbor is, the node routes to
+  every destination of the restored topology instead of waiting for the
+  TC, MID and HNA messages to reach it.
+
+  A snapshot is a header of the magic number 0x4F4C5353 ("OLSS"), a version
+  and the time it was written, followed by fixed size records, all in
+  network byte order. A file with another magic number or version is
+  ignored.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item ASSOCIATION_INFO
+
+  OLSRAssociationInfoBase element whose HNA tuples to save too.
+
+  =item INTERVAL
+
+  Integer. Milliseconds between snapshots. Default is 5000.
+
+  =item HOLD
+
+  Integer. Longest validity, in milliseconds, a restored tuple gets.
+  Default is 15000, the default topology holding time.
+
+  =back
+
+  =h loaded read-only
+  Number of tuples restored from the snapshot at startup.
+
+  =h save write-only
+  Writes a snapshot now.
+
+  =a
+  OLSRTopologyInfoBase, OLSRInterfaceInfoBase, OLSRAssociationInfoBase,
+  OLSRRoutingTable */
+
+#ifndef OLSR_SNAPSHOT_HH
+#define OLSR_SNAPSHOT_HH
+
+#include <click/element.hh>
+#include <click/timer.hh>
+#include "olsr_topology_infobase.hh"
+#include "olsr_interface_infobase.hh"
+#include "olsr_association_infobase.hh"
+#include "olsr_rtable.hh"
+
+CLICK_DECLS
+
+class OLSRSnapshot : public Element { public:
+
+  OLSRSnapshot();
+  ~OLSRSnapshot();
+
+  const char *class_name() const	{ return "OLSRSnapshot"; }
+  OLSRSnapshot *clone() const		{ return new OLSRSnapshot; }
+  const char *port_count() const	{ return PORTS_0_0; }
+
+  // after the information bases it fills
+  int configure_phase() const		{ return CONFIGURE_PHASE_LAST; }
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  void run_timer(Timer *);
+
+private:
+
+  enum { MAGIC = 0x4F4C5353, VERSION = 1 };
+  enum { TOPOLOGY_RECORD = 1, INTERFACE_RECORD = 2, ASSOCIATION_RECORD = 3 };
+
+  struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t written_sec;	// when, as a timeval
+    uint32_t written_usec;
+    uint32_t nrecords;
+  };
+
+  struct Record {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t seq;		// T_seq of a topology tuple
+    uint32_t validity;		// milliseconds left when written
+    uint32_t addr[3];		// in network byte order already
+  };
+
+  String _filename;
+  OLSRTopologyInfoBase *_topologyInfo;
+  OLSRInterfaceInfoBase *_interfaceInfo;
+  OLSRAssociationInfoBase *_associationInfo;
+  OLSRRoutingTable *_routingTable;
+  int _interval;
+  int _hold;
+  uint32_t _loaded;
+  Timer _timer;
+
+  int save(ErrorHandler *errh);
+  int load(ErrorHandler *errh);
+  static uint32_t validity_left(olsr_time_t expiry, olsr_time_t now);
+
+  static String read_loaded(Element *, void *);
+  static int save_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
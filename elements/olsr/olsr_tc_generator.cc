@@ -3,6 +3,7 @@
 #include <click/config.h>
 #include <click/confparse.hh>
 #include <click/error.hh>
+#include <clicknet/ip.h>
 #include <clicknet/udp.h>
 #include <clicknet/ether.h>
 #include <click/ipaddress.hh>
@@ -11,12 +12,15 @@
 #include <click/bighashmap.hh>
 #include "olsr_tc_generator.hh"
 #include "olsr_neighbor_infobase.hh"
+#include "olsr_link_infobase.hh"
 #include "click_olsr.hh"
+#include "olsr_address_block.hh"
 
 CLICK_DECLS
 
 OLSRTCGenerator::OLSRTCGenerator()
-		: _timer(this)
+		: _timer(this), _linkInfo(0), _link_quality(false), _compact(false), _mtu(1500),
+		  _min_tc_interval(1000), _tc_settle(100)
 {
 }
 
@@ -32,6 +36,8 @@ OLSRTCGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
 	bool add_tc_msg=false;
 	bool mpr_full_link_state=false;
 	bool full_link_state=false;
+	String ttl_schedule;
+	Element *link_info = 0;
 	int res = cp_va_parse(conf, this, errh,
 	                      cpInteger, "TC sending interval (msec)", &_period,
 	                      cpInteger, "Topology Holding Time (msec)",&_top_hold_time,
@@ -41,6 +47,13 @@ OLSRTCGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
 	                      "ADDITIONAL_TC",cpBool,"send addtional TC messages?",&add_tc_msg,
 	                      "MPR_FULL_LINK_STATE", cpBool, "send full link state information", &mpr_full_link_state,
 	                      "FULL_LINK_STATE", cpBool, "enable sending TC packets even when a node is not an MPR", &full_link_state,
+	                      "TTL_SCHEDULE", cpString, "TTLs of successive TC messages", &ttl_schedule,
+	                      "LINK_QUALITY", cpBool, "send LQ_TC messages", &_link_quality,
+	                      "COMPACT", cpBool, "send COMPACT_TC messages", &_compact,
+	                      "LINK_INFO", cpElement, "Link InfoBase element", &link_info,
+	                      "MTU", cpInteger, "largest packet to build (bytes)", &_mtu,
+	                      "MIN_TC_INTERVAL", cpInteger, "least time between a triggered TC and the previous one (msec)", &_min_tc_interval,
+	                      "SETTLE", cpInteger, "time without MPR selector change before a triggered TC (msec)", &_tc_settle,
 	                      cpEnd);
 	_additional_TC_msg=add_tc_msg;
 	_mpr_full_link_state=mpr_full_link_state;
@@ -49,6 +62,25 @@ OLSRTCGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
 		return res;
 	if ( _period <= 0 )
 		return errh->error("period must be greater than 0");
+	if (link_info && !(_linkInfo = (OLSRLinkInfoBase *) link_info->cast("OLSRLinkInfoBase")))
+		return errh->error("%s is not an OLSRLinkInfoBase", link_info->name().c_str());
+	if (_link_quality && !_linkInfo)
+		return errh->error("LINK_QUALITY requires LINK_INFO");
+	if ( _mtu < (int) (sizeof(click_ip) + sizeof(click_udp) + sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr) + sizeof(in_addr) + sizeof(olsr_lq_info)) )
+		return errh->error("MTU too small to carry an advertised neighbor");
+	if ( _min_tc_interval < 0 || _tc_settle < 0 )
+		return errh->error("MIN_TC_INTERVAL and SETTLE must not be negative");
+
+	Vector<String> ttls;
+	cp_spacevec(ttl_schedule, ttls);
+	_ttl_schedule.clear();
+	for (int i = 0; i < ttls.size(); i++)
+	{
+		int ttl;
+		if (!cp_integer(ttls[i], &ttl) || ttl < 1 || ttl > 255)
+			return errh->error("TTL_SCHEDULE must be a list of TTLs between 1 and 255");
+		_ttl_schedule.push_back(ttl);
+	}
 	return res;
 }
 
@@ -59,23 +91,74 @@ OLSRTCGenerator::initialize(ErrorHandler *)
 
 	_timer.initialize(this);
 
-	_vtime = compute_vtime();
+	_vtime = olsr_vtime_encode(olsr_msec(_top_hold_time));
+	compute_ttl_vtimes();
+	_ttl_index = 0;
 	_end_of_validity_time = make_timeval(0,0);
 	_node_is_mpr = false;
 	_ansn = 1;
-	_last_msg_sent_at = make_timeval(0,0);
+	_last_msg_sent_at = Timestamp();
+	_next_periodic = Timestamp();
+	_last_advertised.clear();
+	_sent_ansn = _ansn;
+	_triggered = _suppressed = 0;
+	_advertised_changed = true;
 	return 0;
 }
 
+
+void
+OLSRTCGenerator::cleanup(CleanupStage)
+{
+	for (int i = 0; i < _tc_templates.size(); i++)
+		_tc_templates[i]->kill();
+	_tc_templates.clear();
+}
+
+void
+OLSRTCGenerator::take_state(Element *e, ErrorHandler *)
+{
+	OLSRTCGenerator *old = (OLSRTCGenerator *) e->cast("OLSRTCGenerator");
+	if (!old)
+		return;
+
+	//neighbors drop TCs whose ANSN is older than the last one they saw
+	_ansn = old->_ansn;
+	_node_is_mpr = old->_node_is_mpr;
+	_end_of_validity_time = old->_end_of_validity_time;
+	_last_msg_sent_at = old->_last_msg_sent_at;
+	_next_periodic = old->_next_periodic;
+	_last_advertised = old->_last_advertised;
+	_sent_ansn = old->_sent_ansn;
+	if (old->_timer.scheduled())
+		_timer.schedule_at(old->_timer.expiry());
+}
+
 void
 OLSRTCGenerator::run_timer(Timer *)
 {
 	if (_node_is_mpr)
 	{
-		output(0).push(generate_tc());
+		Timestamp now = Timestamp::now();
+		if (now < _next_periodic)
+		{	//a triggered TC, only worth sending if the advertised set changed
+			if (_advertised_changed || _tc_templates.empty())
+				build_tc();
+			if (_ansn == _sent_ansn)
+			{
+				_suppressed++;
+				_timer.schedule_at(_next_periodic);
+				return;
+			}
+			_triggered++;
+		}
+		generate_tc();
+		_last_msg_sent_at = now;
+		_sent_ansn = _ansn;
 		int period=(int)(_period*.95+(random() % (_period/10)));
 		//click_chatter ("emitting other tc after %d ms\n",period);
-		_timer.reschedule_after_msec(period);
+		_next_periodic = now + Timestamp::make_msec(period);
+		_timer.schedule_at(_next_periodic);
 	}
 	else
 	{
@@ -90,9 +173,11 @@ OLSRTCGenerator::set_node_is_mpr(bool value)
 {
 	bool node_was_mpr = _node_is_mpr;
 	_node_is_mpr = value;
+	_advertised_changed = true;
 	if (_node_is_mpr)
 	{
 		_end_of_validity_time = make_timeval(0,0);
+		_next_periodic = Timestamp();
 		int delay=(int) (random() % (_period/20));
 		_timer.schedule_after_msec(delay);
 		click_chatter ("node %s has become MPR, emitting tc after %d ms\n",_myIP.unparse().c_str(),delay);
@@ -112,94 +197,126 @@ OLSRTCGenerator::set_node_is_mpr(bool value)
 }
 
 
-Packet *
+/**
+ * emits the TC messages advertising the current set, all with the same
+ * ANSN and, with TTL_SCHEDULE, the same TTL
+ */
+void
 OLSRTCGenerator::generate_tc()
 {
-	//   uint64_t cycles=click_get_cycles();
-	HashMap<IPAddress, void *> *advertise_set = 0;
-	int num_to_advertise = 0;
+	if (_advertised_changed || _tc_templates.empty())
+	{
+		build_tc();
+		if (_tc_templates.empty())
+			return;
+	}
 
-	if (_mpr_full_link_state)
+	struct timeval now;
+	click_gettimeofday(&now);
+	for (int i = 0; i < _tc_templates.size(); i++)
 	{
-		HashMap<IPAddress, void *> *neighbor_set = _neighborInfo->get_neighbor_set();
-		if (! neighbor_set->empty())
-		{
-			for (HashMap<IPAddress, void *>::iterator iter = neighbor_set->begin(); iter != neighbor_set->end(); iter++)
-			{
-				neighbor_data *nbr = (neighbor_data *) iter.value();
-				if (nbr->N_status == OLSR_SYM_NEIGH || nbr->N_status == OLSR_MPR_NEIGH)
-				{
-					num_to_advertise++;
-				}
+		//the copies are made here and not in OLSRForward, which writes msg_seq
+		WritablePacket *packet = olsr_copy_packet(_tc_templates[i]);
+		if ( packet == 0 )
+			continue;
+		packet->set_timestamp_anno(now);
 
-			}
+		olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (packet->data() + sizeof(olsr_pkt_hdr));
+		olsr_tc_hdr *tc_hdr = (olsr_tc_hdr *) (msg_hdr + 1);
+		tc_hdr->ansn = htons( get_ansn() );
+		if (!_ttl_schedule.empty())
+		{
+			msg_hdr->ttl = _ttl_schedule[_ttl_index];
+			msg_hdr->vtime = _ttl_vtime[_ttl_index];
 		}
+		output(0).push(packet);
 	}
-	else
-	{
-		advertise_set = _neighborInfo->get_mpr_selector_set();
-		num_to_advertise = advertise_set->size();
-	}
+	if (!_ttl_schedule.empty())
+		_ttl_index = (_ttl_index + 1) % _ttl_schedule.size();
+}
 
 
-	int packet_size = sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr) + num_to_advertise*sizeof(in_addr);
-	int headroom = sizeof(click_ether) + sizeof(click_ip) + sizeof(click_udp);
-	int tailroom = 0;
-	WritablePacket *packet = Packet::make(headroom,0,packet_size, tailroom);
-	if ( packet == 0 )
+/**
+ * the quality of the best link to an advertised neighbor, for LINK_QUALITY
+ */
+void
+OLSRTCGenerator::read_link_quality(const IPAddress &neighbor, olsr_lq_info *lq_info)
+{
+	memset(lq_info, 0, sizeof(olsr_lq_info));
+	if (link_data *link = _linkInfo->best_link_to(neighbor))
 	{
-		click_chatter( "in %s: cannot make packet!", name().c_str());
+		lq_info->lq = _linkInfo->advertised_lq(link);
+		lq_info->nlq = link->L_nlq;
 	}
-	memset(packet->data(), 0, packet->length());
-	//   packet->set_perfctr_anno(cycles);
-	olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) packet->data();
-	pkt_hdr->pkt_length = 0; //added in OLSRForward
-	pkt_hdr->pkt_seq = 0; //added in OLSRForward
+}
 
-	struct timeval now;
-	click_gettimeofday(&now);
-	packet->set_timestamp_anno(now);
 
+static int
+ipaddr_sorter(const void *va, const void *vb, void *)
+{
+	uint32_t a = ntohl(((const IPAddress *) va)->addr());
+	uint32_t b = ntohl(((const IPAddress *) vb)->addr());
+	return (a < b ? -1 : (a == b ? 0 : 1));
+}
 
-	olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (pkt_hdr + 1);
-	msg_hdr->msg_type = OLSR_TC_MESSAGE;
-	msg_hdr->vtime = _vtime;
-	msg_hdr->msg_size = htons(sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr)+ num_to_advertise*sizeof(in_addr));
-	msg_hdr->originator_address = _myIP.in_addr();
-	msg_hdr->ttl = 255;  //TC messages should diffuse into entire network
-	msg_hdr->hop_count = 0;
-	msg_hdr->msg_seq = 0; //added in OLSRForward element
 
-	olsr_tc_hdr *tc_hdr = (olsr_tc_hdr *) (msg_hdr + 1);
-	tc_hdr->ansn = htons( get_ansn() );
-	tc_hdr->reserved = 0;
+/**
+ * rebuilds the TC messages from the neighbor information: as few as the
+ * MTU allows, with the advertised neighbors spread evenly over them; the
+ * ANSN is incremented if the advertised set is not the one it last had
+ */
+void
+OLSRTCGenerator::build_tc()
+{
+	for (int i = 0; i < _tc_templates.size(); i++)
+		_tc_templates[i]->kill();
+	_tc_templates.clear();
 
-	if ( num_to_advertise != 0 )
+	Vector<IPAddress> advertised;
+	if (_mpr_full_link_state)
 	{
-		if (_mpr_full_link_state)
-		{
-			in_addr * address = (in_addr *) (tc_hdr + 1);
-			for (HashMap<IPAddress, void *>::iterator iter = advertise_set->begin(); iter != advertise_set->end(); iter++)
-			{
-				neighbor_data *nbr = (neighbor_data *) iter.value();
-				if (nbr->N_status == OLSR_SYM_NEIGH || nbr->N_status == OLSR_MPR_NEIGH)
-				{
-					*address = nbr->N_neigh_main_addr.in_addr();
-					address++;
-				}
-			}
-		}
-		else
+		OLSRNeighborInfoBase::NeighborSet *neighbor_set = _neighborInfo->get_neighbor_set();
+		for (OLSRNeighborInfoBase::NeighborSet::iterator iter = neighbor_set->begin(); iter != neighbor_set->end(); iter++)
 		{
-			in_addr *address = (in_addr *) (tc_hdr + 1);
-			for (HashMap<IPAddress, void *>::iterator iter = advertise_set->begin(); iter != advertise_set->end(); iter++)
-			{
-				mpr_selector_data *mpr_selector = (mpr_selector_data *) iter.value();
-				*address = mpr_selector->MS_main_addr.in_addr();
-				address++;
-			}
+			neighbor_data *nbr = &iter.value();
+			if (nbr->N_status == OLSR_SYM_NEIGH || nbr->N_status == OLSR_MPR_NEIGH)
+				advertised.push_back(nbr->N_neigh_main_addr);
 		}
 	}
+	else
+	{
+		OLSRNeighborInfoBase::MPRSelectorSet *advertise_set = _neighborInfo->get_mpr_selector_set();
+		for (OLSRNeighborInfoBase::MPRSelectorSet::iterator iter = advertise_set->begin(); iter != advertise_set->end(); iter++)
+			advertised.push_back(iter.value().MS_main_addr);
+	}
+
+	click_qsort(advertised.begin(), advertised.size(), sizeof(IPAddress), ipaddr_sorter);
+	bool same = (advertised.size() == _last_advertised.size());
+	for (int i = 0; same && i < advertised.size(); i++)
+		same = (advertised[i] == _last_advertised[i]);
+	if (!same)
+	{
+		_ansn++;
+		_last_advertised = advertised;
+	}
+
+	int address_size = sizeof(in_addr) + (_link_quality ? sizeof(olsr_lq_info) : 0);
+	int room = (_mtu - sizeof(click_ip) - sizeof(click_udp) - sizeof(olsr_pkt_hdr) - sizeof(olsr_msg_hdr) - sizeof(olsr_tc_hdr)) / address_size;
+	int nmessages = (advertised.size() + room - 1) / room;
+	int per_message = (nmessages ? (advertised.size() + nmessages - 1) / nmessages : 0);
+	int begin = 0;
+	do
+	{	//an empty TC still carries the ANSN
+		int end = begin + per_message;
+		if (end > advertised.size())
+			end = advertised.size();
+		if (Packet *packet = make_tc(advertised, begin, end))
+			_tc_templates.push_back(packet);
+		begin = end;
+	}
+	while (begin < advertised.size());
+	if (!_tc_templates.empty())
+		_advertised_changed = false;
 
 	/// == mvhaen ====================================================================================================
 	// some experimental stuff. maybe finish this later on. Basically has an MPR advertise all its symmetrical neighbors instead of all the MPR selectors
@@ -226,9 +343,61 @@ OLSRTCGenerator::generate_tc()
 	}
 	*/
 	/// ==!mvhaen ===================================================================================================
+}
 
 
+Packet *
+OLSRTCGenerator::make_tc(const Vector<IPAddress> &advertised, int begin, int end)
+{
+	int address_size = sizeof(in_addr) + (_link_quality ? sizeof(olsr_lq_info) : 0);
+	int msg_size = sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr) + (end - begin) * address_size;
+	if (_compact)	//no larger than the plain message, so it fits the MTU as well
+		msg_size = sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr) + OLSRAddressBlock::size(advertised.begin() + begin, end - begin, _link_quality);
+	WritablePacket *packet = Packet::make(OLSR_HEADROOM, 0, sizeof(olsr_pkt_hdr) + msg_size, 0);
+	if ( packet == 0 )
+	{
+		click_chatter( "in %s: cannot make packet!", name().c_str());
+		return 0;
+	}
+	memset(packet->data(), 0, packet->length());
+	olsr_pkt_hdr *pkt_hdr = (olsr_pkt_hdr *) packet->data();
+	pkt_hdr->pkt_length = 0; //added in OLSRForward
+	pkt_hdr->pkt_seq = 0; //added in OLSRForward
+
+	olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (pkt_hdr + 1);
+	msg_hdr->msg_type = _link_quality ? OLSR_LQ_TC_MESSAGE : OLSR_TC_MESSAGE;
+	if (_compact)
+		msg_hdr->msg_type = OLSR_COMPACT_TC_MESSAGE;
+	msg_hdr->vtime = _vtime;
+	msg_hdr->msg_size = htons(msg_size);
+	msg_hdr->originator_address = _myIP.in_addr();
+	msg_hdr->ttl = 255;  //TC messages should diffuse into entire network
+	msg_hdr->hop_count = 0;
+	msg_hdr->msg_seq = 0; //added in OLSRForward element
+
+	olsr_tc_hdr *tc_hdr = (olsr_tc_hdr *) (msg_hdr + 1);
+	tc_hdr->ansn = 0; //set per copy in generate_tc
+	tc_hdr->reserved = 0;
 
+	uint8_t *pos = (uint8_t *) (tc_hdr + 1);
+	if (_compact)
+	{
+		Vector<olsr_lq_info> lq;
+		if (_link_quality)
+		{
+			lq.resize(end - begin);
+			for (int i = begin; i < end; i++)
+				read_link_quality(advertised[i], &lq[i - begin]);
+		}
+		OLSRAddressBlock::write(pos, advertised.begin() + begin, _link_quality ? lq.begin() : 0, end - begin, 0);
+		return packet;
+	}
+	for (int i = begin; i < end; i++, pos += address_size)
+	{
+		*(in_addr *) pos = advertised[i].in_addr();
+		if (_link_quality)
+			read_link_quality(advertised[i], (olsr_lq_info *) (pos + sizeof(in_addr)));
+	}
 	return packet;
 }
 
@@ -242,8 +411,13 @@ OLSRTCGenerator::generate_tc_when_not_mpr()
 	click_gettimeofday(&now);
 	if (now <= _end_of_validity_time)
 	{
+		if (!_last_advertised.empty())
+		{	//the advertised set is now empty
+			_last_advertised.clear();
+			_ansn++;
+		}
 		int packet_size = sizeof(olsr_pkt_hdr) + sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr) ;
-		int headroom = sizeof(click_ether) + sizeof(click_ip) + sizeof(click_udp);
+		int headroom = OLSR_HEADROOM;
 		WritablePacket *packet = Packet::make(headroom,0,packet_size, 0);
 		if ( packet == 0 )
 		{
@@ -256,7 +430,7 @@ OLSRTCGenerator::generate_tc_when_not_mpr()
 		pkt_hdr->pkt_seq = 0; //added in OLSRForward
 
 		olsr_msg_hdr *msg_hdr = (olsr_msg_hdr *) (pkt_hdr + 1);
-		msg_hdr->msg_type = OLSR_TC_MESSAGE;
+		msg_hdr->msg_type = _link_quality ? OLSR_LQ_TC_MESSAGE : OLSR_TC_MESSAGE;
 		msg_hdr->vtime = _vtime;
 		msg_hdr->msg_size = htons(sizeof(olsr_msg_hdr) + sizeof(olsr_tc_hdr));
 		msg_hdr->originator_address = _myIP.in_addr();
@@ -276,16 +450,67 @@ OLSRTCGenerator::generate_tc_when_not_mpr()
 
 
 void
-OLSRTCGenerator::increment_ansn()
+OLSRTCGenerator::notify_mpr_selector_changed()
 {
-	_ansn++;
+	_advertised_changed = true;
+	if (_additional_TC_msg && _node_is_mpr)
+		schedule_triggered_tc();
 }
 
+
+/**
+ * (re)schedules the triggered TC: SETTLE after the last change, at least
+ * MIN_TC_INTERVAL after the last TC, and no later than the periodic one
+ */
 void
-OLSRTCGenerator::notify_mpr_selector_changed()
+OLSRTCGenerator::schedule_triggered_tc()
+{
+	Timestamp at = Timestamp::now() + Timestamp::make_msec(_tc_settle);
+	Timestamp earliest = _last_msg_sent_at + Timestamp::make_msec(_min_tc_interval);
+	if (at < earliest)
+		at = earliest;
+	if (_next_periodic < at)
+		at = _next_periodic;
+	_timer.schedule_at(at);
+}
+
+
+void
+OLSRTCGenerator::set_period(int period)
+{
+	_period = period;
+	//a shorter period takes effect now, not after the pending interval
+	if ( _node_is_mpr && _timer.scheduled() && Timestamp::now() + Timestamp::make_msec( period ) < _timer.expiry() )
+	{
+		_next_periodic = Timestamp::now() + Timestamp::make_msec( period );
+		_timer.schedule_at( _next_periodic );
+	}
+}
+
+
+void
+OLSRTCGenerator::set_top_hold_time(int top_hold_time)
+{
+	_top_hold_time = top_hold_time;
+	_vtime = olsr_vtime_encode(olsr_msec(_top_hold_time));
+	compute_ttl_vtimes();
+	_advertised_changed = true;	//the cached TC has the old vtime
+}
+
+
+String
+OLSRTCGenerator::read_handler(Element *e, void *)
 {
-	_ansn++;
-	if (_additional_TC_msg) _timer.schedule_now();
+	OLSRTCGenerator *tg = (OLSRTCGenerator *) e;
+	return "triggered " + String(tg->_triggered) + "\nsuppressed " + String(tg->_suppressed) + "\n";
+}
+
+
+void
+OLSRTCGenerator::add_handlers()
+{
+	add_read_handler("tc_stats", read_handler, 0);
+	add_task_handlers(_timer.task(), "timer_");
 }
 
 
@@ -296,24 +521,20 @@ OLSRTCGenerator::get_ansn()
 }
 
 
-uint8_t
-OLSRTCGenerator::compute_vtime()
+void
+OLSRTCGenerator::compute_ttl_vtimes()
 {
-	uint8_t return_value = 0;
-	int t = _top_hold_time*1000; //top_hold_time in msec -> t in sec
-	//_top_hold_time.tv_usec+_top_hold_time.tv_sec*1000000; //fixpoint -> calculation in sec
-
-	int b=0;
-	while ((t / OLSR_C_us) >= (1<<(b+1)))
-		b++;
-	int a=(((16*t/OLSR_C_us)>>b)-16);
-	int value=(OLSR_C_us *(16+a)*(1<<b))>>4;
-	if (value<t) a++;
-if (a==16) {b++; a=0;}
-
-	if ( (a <= 15 && a >= 0) && (b <= 15 && b >= 0) )
-		return_value = ((a << 4) | b );
-	return return_value;
+	//a node d hops away is refreshed by the next message with a TTL of at
+	//least d; a message's tuples must last until the next one reaching as far
+	int n = _ttl_schedule.size();
+	_ttl_vtime.clear();
+	for (int i = 0; i < n; i++)
+	{
+		int gap = 1;
+		while (gap < n && _ttl_schedule[(i + gap) % n] < _ttl_schedule[i])
+			gap++;
+		_ttl_vtime.push_back(olsr_vtime_encode(olsr_msec(gap * _top_hold_time)));
+	}
 }
 
 
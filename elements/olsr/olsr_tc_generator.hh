@@ -14,7 +14,22 @@
  
   =d
   Generates a TC message every INTERVAL msecs if the node has been selected as MPR by another node. The message is based on the info in the node's MPR Selector Set stored in the OLSRNeighborInfobase element given as argument.
+
+  Keyword TTL_SCHEDULE, a space-separated list of TTLs such as "2 8 2 16 2 255", enables fisheye flooding: successive TC messages get the TTLs of the list in turn, so most of them stay in the vicinity and far away nodes are refreshed less often. Each message advertises a validity time long enough to last until the next message reaching as far, so the topology tuples of distant nodes do not expire in between. By default every TC message has TTL 255.
+
+  The message is kept ready-made between intervals: only when the advertised set changes (see notify_advertised_set_changed) is it built again from the neighbor information, otherwise each interval copies it and only sets the ANSN.
+
+  Keyword MTU, the largest IP packet to build in bytes (default 1500), bounds the messages: when the advertised neighbors do not fit in one, they are spread evenly over as few TC messages as will do, all with the same ANSN, as RFC 3626 section 9.3 allows. Evenly filled messages leave room for OLSRAggregator to add other messages to their packets.
+
+  Keyword ADDITIONAL_TC, a boolean, sends a TC message as soon as the MPR selector set changes instead of waiting for the next interval. Such a triggered message waits until the selectors have been quiet for SETTLE msecs (default 100), so that a burst of changes goes out in one message, and never comes sooner than MIN_TC_INTERVAL msecs (default 1000) after the previous TC message, nor later than the next periodic one, which it replaces. The ANSN is incremented only when the advertised set differs from the one of the last message sent; when the changes have cancelled out by the time a triggered message is due, as with a flapping selector, it is not sent.
+
+  Keyword LINK_QUALITY, a boolean, makes the element send LQ_TC messages (type 202, as in olsrd) instead, where every advertised neighbor is followed by the quality of the best link to it in both directions, as measured by OLSRProcessHello. It requires keyword LINK_INFO, the OLSRLinkInfoBase element. If that element has LINK_RATES, the advertised quality of each link is lowered in proportion to its bit-rate, so that the ETX other nodes compute from it is its expected transmission time (see olsr_ett). OLSRProcessHello reports changes of the link qualities as changes of the advertised set.
+
+  Keyword COMPACT, a boolean, makes the element send COMPACT_TC messages (type 205) instead, which carry the advertised neighbors in address blocks, the leading bytes they share sent once; see OLSRHelloGenerator. Nodes that do not know the type still forward the messages, but cannot read them, so all nodes of the network need the same setting. Default is false.
  
+  =h tc_stats read-only
+  Returns the numbers of triggered TC messages sent and of those suppressed because the advertised set had not changed.
+
   =a
   OLSRHelloGenerator, OLSRForward
   
@@ -30,11 +45,13 @@
 #include <click/ipaddress.hh>
 #include "olsr_neighbor_infobase.hh"
 #include "click_olsr.hh"
+#include "olsr_control_timer.hh"
 
 
 CLICK_DECLS
 
 class OLSRNeighborInfoBase;
+class OLSRLinkInfoBase;
 
 class OLSRTCGenerator : public Element
 {
@@ -50,13 +67,21 @@ public:
 
 	int configure(Vector<String> &, ErrorHandler *);
 	int initialize(ErrorHandler *);
+	void cleanup(CleanupStage);
+	void take_state(Element *, ErrorHandler *);
+	void add_handlers();
 
-	Packet *generate_tc();
+	void generate_tc();
 	Packet *generate_tc_when_not_mpr();
 	void run_timer(Timer *);
 	void set_node_is_mpr(bool value);
-	void increment_ansn();
 	void notify_mpr_selector_changed();
+	void notify_advertised_set_changed()	{ _advertised_changed = true; }
+
+	int period() const			{ return _period; }
+	int top_hold_time() const		{ return _top_hold_time; }
+	void set_period(int period);
+	void set_top_hold_time(int top_hold_time);
 
 private:
 	int _period;
@@ -65,15 +90,41 @@ private:
 	uint8_t _vtime;
 	uint16_t _ansn;
 	struct timeval _end_of_validity_time;
-	Timer _timer;
+	OLSRControlTimer _timer;
 	OLSRNeighborInfoBase *_neighborInfo;
 	IPAddress _myIP;
 	bool _node_is_mpr;
-	timeval _last_msg_sent_at;
+	Timestamp _last_msg_sent_at;
 	uint16_t get_ansn();
-	uint8_t compute_vtime();
 	bool _full_link_state;
 	bool _mpr_full_link_state;
+
+	Vector<int> _ttl_schedule;	// fisheye TTLs, empty if disabled
+	Vector<uint8_t> _ttl_vtime;	// vtime to advertise with each of them
+	int _ttl_index;
+	void compute_ttl_vtimes();
+
+	OLSRLinkInfoBase *_linkInfo;
+	bool _link_quality;		// send LQ_TC messages
+	bool _compact;			// send COMPACT_TC messages
+	void read_link_quality(const IPAddress &neighbor, olsr_lq_info *lq_info);
+
+	int _mtu;
+	Vector<Packet *> _tc_templates;	// last TC messages built, ANSN not filled in
+	bool _advertised_changed;	// _tc_templates out of date
+	void build_tc();
+	Packet *make_tc(const Vector<IPAddress> &advertised, int begin, int end);
+
+	int _min_tc_interval;		// msec between a triggered TC and the last one
+	int _tc_settle;			// msec without selector change before it
+	Timestamp _next_periodic;	// when the next periodic TC is due
+	Vector<IPAddress> _last_advertised;	// sorted, as of _ansn
+	uint16_t _sent_ansn;		// ANSN of the last TC sent
+	uint32_t _triggered;
+	uint32_t _suppressed;
+	void schedule_triggered_tc();
+
+	static String read_handler(Element *, void *);
 };
 
 CLICK_ENDDECLS
@@ -5,11 +5,13 @@
 #include <click/ipaddress.hh>
 #include "ippair.hh"
 #include "click_olsr.hh"
+#include "olsr_bulk_load.hh"
+#include <click/error.hh>
 
 CLICK_DECLS
 
 OLSRTopologyInfoBase::OLSRTopologyInfoBase()
-  : _timer(this)
+  : _timer(this), _expiryQueue(0), _bulk(false), _bulk_changes(0)
 {
 }
 
@@ -22,10 +24,23 @@ OLSRTopologyInfoBase::~OLSRTopologyInfoBase()
 int
 OLSRTopologyInfoBase::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+  Element *expiry_queue = 0;
+  int max_tuples = 0;
+  uint32_t rate = 0, burst = 256;
   if ( cp_va_parse( conf, this, errh,
 		    cpElement, "Routing Table Element", &_routingTable, 
+		    cpKeywords,
+		    "EXPIRY_QUEUE", cpElement, "shared expiry timer", &expiry_queue,
+		    "MAX_TUPLES", cpInteger, "maximum number of tuples", &max_tuples,
+		    "TUPLE_RATE", cpUnsigned, "new tuples per second per originator", &rate,
+		    "TUPLE_BURST", cpUnsigned, "new tuples per originator at once", &burst,
 		    0) < 0 )
     return -1;
+  if (expiry_queue && !(_expiryQueue = (OLSRExpiryQueue *) expiry_queue->cast("OLSRExpiryQueue")))
+    return errh->error("EXPIRY_QUEUE element is not an OLSRExpiryQueue");
+  if (max_tuples < 0 || burst > (1 << 20))
+    return errh->error("MAX_TUPLES must be positive, TUPLE_BURST at most %d", 1 << 20);
+  _admission.set(max_tuples, rate, burst);
   return 0;
 }
 
@@ -34,45 +49,158 @@ int
 OLSRTopologyInfoBase::initialize(ErrorHandler *)
 {
   _timer.initialize(this);
+  set_expiry(_expiryQueue, &_timer);
   _topologySet = new TopologySet;	//ok
+  _topologySet->set_incremental_resizing(true);	//no pause when a TC burst grows it
+  _changes = 0;
+  publish_snapshot();
   return 0;
 }
 
 void OLSRTopologyInfoBase::uninitialize()
 {
  delete _topologySet;
+ _byLast.clear();
+ _byDest.clear();
+}
+
+void
+OLSRTopologyInfoBase::take_state(Element *e, ErrorHandler *)
+{
+  OLSRTopologyInfoBase *old = (OLSRTopologyInfoBase *) e->cast("OLSRTopologyInfoBase");
+  if (!old)
+    return;
+
+  TopologySet *topologySet = _topologySet;
+  _topologySet = old->_topologySet;
+  old->_topologySet = topologySet;
+  _byLast.swap(old->_byLast);
+  _byDest.swap(old->_byDest);
+  _expiry.swap(old->_expiry);
+  _changes = old->_changes + 1;	//the tuples differ from the empty snapshot
+
+  if (!_expiry.empty())
+    expire_at(_expiry.next());
 }
 
 topology_data *
-OLSRTopologyInfoBase::add_tuple(IPAddress dest_addr, IPAddress last_addr, timeval time)
+OLSRTopologyInfoBase::add_tuple(IPAddress dest_addr, IPAddress last_addr, olsr_time_t time, int seq)
 {
   IPPair ippair= IPPair(dest_addr, last_addr);;
-  struct topology_data *data;
-  data = new struct topology_data;		//released in remove
+  struct topology_data data;		//stored inline in the topology set
+
+  data.T_dest_addr = dest_addr;
+  data.T_last_addr = last_addr; 
+  data.T_seq = seq;
+  data.T_time = time;
+  data.T_cost = OLSR_ETX_ONE;
 
-  data->T_dest_addr = dest_addr;
-  data->T_last_addr = last_addr; 
-  data->T_time = time;
+  if (_admission.active() && !_topologySet->findp(ippair) && !admit(last_addr))
+    return 0;
 
-    if ( _topologySet->empty() )
-    _timer.schedule_at(time);
-  if ( _topologySet->insert(ippair, data) )
-    return data;
+  if (_bulk)
+    _expiry.append(time, ippair);
+  else {
+    _expiry.push(time, ippair);
+    expire_at(time);
+  }
+  if ( _topologySet->insert(ippair, data) ){
+    Originator &o = _byLast.find_force(last_addr);
+    if (o.dests.empty() || seq > o.ansn)
+      o.ansn = seq;
+    o.dests.push_back(dest_addr);
+    _byDest.find_force(dest_addr).push_back(last_addr);
+    _changes++;
+    if (_bulk)
+      _bulk_changes++;
+    else
+      _routingTable->topology_tuple_added(dest_addr, last_addr);
+    return _topologySet->findp(ippair);
+  }
   
   return 0;
 }
 
 
+/**
+ * a loaded tuple is only held to the capacity, one from a TC also to the
+ * rate of last_addr
+ */
+bool
+OLSRTopologyInfoBase::admit(const IPAddress &last_addr)
+{
+  olsr_time_t now = olsr_now();
+  if (!_bulk && !_admission.rate_ok(last_addr, now))
+    return false;
+  if (_admission.full(_topologySet->size())
+      && !make_room(OLSRAdmission::priority(_routingTable->route_distance(last_addr)))) {
+    _admission.refused();
+    return false;
+  }
+  return true;
+}
+
+
+/**
+ * evicts the tuple soonest to expire, among the first of the expiry heap,
+ * whose last hop is no closer than that of a new tuple of this priority
+ */
+bool
+OLSRTopologyInfoBase::make_room(int priority)
+{
+  if (_bulk)
+    _expiry.rebuild();
+  Vector<IPPair> kept;
+  bool room = false;
+  for (int i = 0; i < OLSRAdmission::SAMPLE && !_expiry.empty(); i++) {
+    IPPair ippair = _expiry.pop();
+    topology_data *tuple = _topologySet->findp(ippair);
+    if (!tuple)
+      continue;			//stale entry, gone for good
+    if (OLSRAdmission::priority(_routingTable->route_distance(tuple->T_last_addr)) >= priority) {
+      remove_tuple(ippair._from, ippair._to);
+      _admission.evicted();
+      room = true;
+      break;
+    }
+    kept.push_back(ippair);
+  }
+  for (int i = 0; i < kept.size(); i++)
+    _expiry.push(_topologySet->findp(kept[i])->T_time, kept[i]);
+  return room;
+}
+
+
+void
+OLSRTopologyInfoBase::begin_bulk()
+{
+  _bulk = true;
+  _bulk_changes = 0;
+}
+
+
+void
+OLSRTopologyInfoBase::commit_bulk()
+{
+  if (!_bulk)
+    return;
+  _bulk = false;
+  _expiry.rebuild();
+  if (!_expiry.empty())
+    expire_at(_expiry.next());
+  if (_bulk_changes)
+    _routingTable->schedule_compute_routing_table();
+}
+
+
 topology_data *
 OLSRTopologyInfoBase::find_tuple(IPAddress dest_addr, IPAddress last_addr)
 {
   if (! _topologySet->empty() ) {
     IPPair ippair = IPPair(dest_addr, last_addr);
-    struct HashMap<IPPair, void*>::Pair *pair;
-    pair = _topologySet->find_pair(ippair);
+    topology_data *data = _topologySet->findp(ippair);
     
-    if (! pair == 0 ){
-      topology_data *data = (topology_data *)pair->value;
+    if (! data == 0 ){
       return data;
     }
   }
@@ -84,20 +212,17 @@ OLSRTopologyInfoBase::find_tuple(IPAddress dest_addr, IPAddress last_addr)
 bool
 OLSRTopologyInfoBase::newer_tuple_exists(IPAddress last_addr, int ansn)
 {
-  for (TopologySet::iterator iter = _topologySet->begin(); iter != _topologySet->end(); iter++){
-    topology_data *data = (topology_data *) iter.value();
-    if (data->T_last_addr == last_addr && data->T_seq > ansn)
-      return true;
-  }
-  return false;
+  const Originator *o = _byLast.findp(last_addr);
+  return o && o->ansn > ansn;
 }
 
 void OLSRTopologyInfoBase::print_topology()
 {
 click_chatter ("TOPOLOGY SET\n");
+ char dest[IPAddress::unparse_buflen], last[IPAddress::unparse_buflen];
  for (TopologySet::iterator iter = _topologySet->begin(); iter != _topologySet->end(); iter++){
-    topology_data *data = (topology_data *) iter.value();
-    click_chatter ("T_dest: %s\t T_last: %s\tT_seq: %d\t\n",data->T_dest_addr.unparse().c_str(),data->T_last_addr.unparse().c_str(),data->T_seq);
+    topology_data *data = &iter.value();
+    click_chatter ("T_dest: %s\t T_last: %s\tT_seq: %d\t\n",data->T_dest_addr.unparse(dest),data->T_last_addr.unparse(last),data->T_seq);
  }
 }
  
@@ -105,18 +230,49 @@ click_chatter ("TOPOLOGY SET\n");
     
    
 bool
-OLSRTopologyInfoBase::remove_outdated_tuples(IPAddress last_addr, int ansn)
-{
-  bool tuple_removed = false;
-  for(TopologySet::iterator iter =_topologySet->begin(); iter != _topologySet->end(); iter++){
-    topology_data *data = (topology_data *) iter.value();
-    if (data->T_last_addr == last_addr && data->T_seq < ansn){
-      remove_tuple(data->T_dest_addr, data->T_last_addr);
-      tuple_removed = true;
+OLSRTopologyInfoBase::update_tuples(IPAddress last_addr, int ansn, const Vector<IPAddress> &dests,
+				    const Vector<int> *costs, olsr_time_t time, Diff &diff)
+{
+  Originator *o = _byLast.findp(last_addr);
+  if (o && o->ansn > ansn)
+    return false;
+
+  //the tuples advertised again take the new ANSN first, so that those
+  //still holding an older one are exactly the ones to remove
+  for (int i = 0; i < dests.size(); i++)
+    if (topology_data *data = _topologySet->findp(IPPair(dests[i], last_addr))){
+      data->T_seq = ansn;
+      data->T_time = time;
+      if (costs && data->T_cost != (*costs)[i]){
+	data->T_cost = (*costs)[i];
+	diff.cost_changed = true;
+      }
+      diff.refreshed++;
+    }
+  if (o && o->ansn < ansn){
+    o->ansn = ansn;
+    //collect first, removing a tuple changes the list
+    Vector<IPAddress> outdated;
+    for (int i = 0; i < o->dests.size(); i++){
+      topology_data *data = _topologySet->findp(IPPair(o->dests[i], last_addr));
+      if (data && data->T_seq < ansn)
+	outdated.push_back(o->dests[i]);
     }
+    for (int i = 0; i < outdated.size(); i++)
+      remove_tuple(outdated[i], last_addr);
+    diff.removed = outdated.size();
   }
-  return tuple_removed;
-} 
+
+  if (diff.refreshed < dests.size())
+    for (int i = 0; i < dests.size(); i++)
+      if (!_topologySet->findp(IPPair(dests[i], last_addr)))
+	if (topology_data *data = add_tuple(dests[i], last_addr, time, ansn)){
+	  if (costs)
+	    data->T_cost = (*costs)[i];
+	  diff.added++;
+	}
+  return true;
+}
 
 
 void
@@ -124,63 +280,212 @@ OLSRTopologyInfoBase::remove_tuple(IPAddress dest_addr, IPAddress last_addr)
 {
  
   IPPair ippair = IPPair(dest_addr, last_addr);
-  topology_data *ptr=(topology_data *)_topologySet->find(ippair);
-  _topologySet->remove(ippair);
-  delete ptr;
+  if (_topologySet->remove(ippair)){
+    Originator *o = _byLast.findp(last_addr);
+    if (o && unlink(o->dests, dest_addr) && o->dests.empty())
+      _byLast.remove(last_addr);
+    Vector<IPAddress> *lasts = _byDest.findp(dest_addr);
+    if (lasts && unlink(*lasts, last_addr) && lasts->empty())
+      _byDest.remove(dest_addr);
+    _changes++;
+    if (_bulk)
+      _bulk_changes++;
+    else
+      _routingTable->topology_tuple_removed(dest_addr, last_addr);
+  }
+}
+
+
+bool
+OLSRTopologyInfoBase::unlink(Vector<IPAddress> &v, IPAddress to)
+{
+  for (int i = 0; i < v.size(); i++)
+    if (v[i] == to){
+      v[i] = v.back();
+      v.pop_back();
+      return true;
+    }
+  return false;
 }
 
 
-HashMap<IPPair, void*> *
+OLSRTopologyInfoBase::TopologySet *
 OLSRTopologyInfoBase::get_topology_set()
 {
   return _topologySet;
 }
 
 
+/**
+ * adds the tuples of a text of lines DEST LAST MSECS [SEQ [COST]], valid
+ * for MSECS milliseconds from now; existing tuples are replaced
+ */
+int
+OLSRTopologyInfoBase::load_handler(const String &text, Element *e, void *, ErrorHandler *errh)
+{
+  OLSRTopologyInfoBase *tib = (OLSRTopologyInfoBase *) e;
+  OLSRBulkLoader loader(text);
+  Vector<String> words;
+  Vector<topology_data> tuples;
+
+  //parse everything first, a bad line loads nothing
+  while (loader.next(words)) {
+    topology_data data;
+    uint32_t seq = 0, cost = OLSR_ETX_ONE;
+    if (words.size() < 3 || words.size() > 5
+	|| !cp_ip_address(words[0], &data.T_dest_addr)
+	|| !cp_ip_address(words[1], &data.T_last_addr)
+	|| !loader.parse_validity(words[2], data.T_time)
+	|| (words.size() > 3 && (!cp_unsigned(words[3], &seq) || seq > 0xFFFF))
+	|| (words.size() > 4 && !cp_unsigned(words[4], &cost)))
+      return errh->error("line %d: expected DEST LAST MSECS [SEQ [COST]]", loader.line());
+    data.T_seq = seq;
+    data.T_cost = cost;
+    tuples.push_back(data);
+  }
+
+  tib->begin_bulk();
+  for (int i = 0; i < tuples.size(); i++) {
+    const topology_data &t = tuples[i];
+    if (tib->find_tuple(t.T_dest_addr, t.T_last_addr))
+      tib->remove_tuple(t.T_dest_addr, t.T_last_addr);
+    if (topology_data *data = tib->add_tuple(t.T_dest_addr, t.T_last_addr, t.T_time, t.T_seq))
+      data->T_cost = t.T_cost;
+  }
+  tib->commit_bulk();
+  return 0;
+}
+
+
+void *
+OLSRTopologyInfoBase::cast(const char *n)
+{
+  if (strcmp(n, "OLSRMemoryClient") == 0)
+    return (OLSRMemoryReport::Client *) this;
+  return Element::cast(n);
+}
+
+
+void
+OLSRTopologyInfoBase::memory_usage(Vector<OLSRMemoryReport::Usage> &usage)
+{
+  size_t bytes = OLSRMemoryReport::bytes(*_topologySet) + _expiry.bytes()
+    + OLSRMemoryReport::bytes(_byLast) + OLSRMemoryReport::deep_bytes(_byDest);
+  for (OriginatorMap::const_iterator it = _byLast.begin(); it != _byLast.end(); it++)
+    bytes += OLSRMemoryReport::bytes(it.value().dests);
+  usage.push_back(OLSRMemoryReport::Usage("topology", _topologySet->size(), bytes));
+}
+
+
+void
+OLSRTopologyInfoBase::hash_stats(StringAccum &sa)
+{
+  OLSRMemoryReport::unparse_chains(sa, "topology", *_topologySet);
+  OLSRMemoryReport::unparse_chains(sa, "by_last", _byLast);
+  OLSRMemoryReport::unparse_chains(sa, "by_dest", _byDest);
+}
+
+
+void
+OLSRTopologyInfoBase::publish_snapshot()
+{
+  SnapshotRef current = _snapshot.get();
+  if (current && current->changes == _changes)
+    return;
+  Snapshot *s = new Snapshot;
+  s->tuples.reserve(_topologySet->size());
+  for (TopologySet::iterator iter = _topologySet->begin(); iter != _topologySet->end(); iter++)
+    s->tuples.push_back(iter.value());
+  s->changes = _changes;
+  _snapshot.publish(s);
+}
+
+
+void
+OLSRTopologyInfoBase::add_handlers()
+{
+  add_write_handler("load", load_handler, 0);
+  add_read_handler("admission", admission_handler, 0);
+  add_read_handler("tuples", tuples_handler, 0);
+  add_memory_handlers(this);
+  add_hash_stats_handler(this);
+}
+
+
+String
+OLSRTopologyInfoBase::admission_handler(Element *e, void *)
+{
+  OLSRTopologyInfoBase *tib = (OLSRTopologyInfoBase *) e;
+  StringAccum sa;
+  tib->_admission.unparse(sa, tib->_topologySet->size());
+  return sa.take_string();
+}
+
+
+// from the snapshot, so it can be read from any thread
+String
+OLSRTopologyInfoBase::tuples_handler(Element *e, void *)
+{
+  OLSRTopologyInfoBase *tib = (OLSRTopologyInfoBase *) e;
+  SnapshotRef snapshot = tib->snapshot();
+  StringAccum sa;
+  for (int i = 0; snapshot && i < snapshot->tuples.size(); i++) {
+    const topology_data &data = snapshot->tuples[i];
+    sa << data.T_dest_addr << ' ' << data.T_last_addr << ' ' << data.T_seq << ' ' << data.T_cost << '\n';
+  }
+  return sa.take_string();
+}
+
+
 void
 OLSRTopologyInfoBase::run_timer(Timer *)
 {
-  struct timeval now, next_timeout;
+  run_expiry_timer();
+}
+
+
+olsr_time_t
+OLSRTopologyInfoBase::run_expiry(olsr_time_t now)
+{
   bool topology_tuple_removed = false;
-  click_gettimeofday(&now);
-  next_timeout = make_timeval(0, 0);
-
-  //find expired topology tuple and delete them
-  if (! _topologySet->empty()){
-    for (TopologySet::iterator iter = _topologySet->begin(); iter != _topologySet->end(); iter++){
-      topology_data *tuple = (topology_data *) iter.value();
-      if (tuple->T_time <= now){
-	remove_tuple(tuple->T_dest_addr, tuple->T_last_addr);
-	//click_chatter("Topology tuple expired");
-	topology_tuple_removed = true;
-      }
-    }
-  }
 
-  //find next topology tuple to expire
-  if (! _topologySet->empty()){
-    for (TopologySet::iterator iter = _topologySet->begin(); iter != _topologySet->end(); iter++){
-      topology_data *tuple = (topology_data *) iter.value();
-      if (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0)
-	next_timeout = tuple->T_time;
-      if ( tuple->T_time < next_timeout )
-	next_timeout = tuple->T_time;
+  //expire the tuples at the top of the heap, put refreshed ones back
+  while (! _expiry.empty() && _expiry.next() <= now){
+    IPPair ippair = _expiry.pop();
+    topology_data *tuple = _topologySet->findp(ippair);
+    if (! tuple)
+      continue;
+    if (tuple->T_time <= now){
+      remove_tuple(ippair._from, ippair._to);
+      //click_chatter("Topology tuple expired");
+      topology_tuple_removed = true;
     }
+    else
+      _expiry.push(tuple->T_time, ippair);
   }
 
-  if (! (next_timeout.tv_sec == 0 && next_timeout.tv_usec == 0) )
-    _timer.schedule_at(next_timeout);    //set timer
+  _expiry.compact_if_stale(*_topologySet, &topology_data::T_time);
+
   if (topology_tuple_removed){
   //  click_chatter("recomputing routing table");
-    _routingTable->compute_routing_table();
+    _routingTable->schedule_update_routing_table(OLSRRoutingTable::EVENT_TC_EXPIRED);
     //_routingTable->print_routing_table();
   }
+  if (_expiry.empty())
+    return 0;
+  return _expiry.next();
 }  
 
 
 #include <click/bighashmap.cc>
+#include <click/vector.cc>
 #if EXPLICIT_TEMPLATE_INSTANCES
-template class HashMap<IPPair, void *>;
+template class HashMap<IPPair, topology_data>;
+template class HashMap<IPAddress, Vector<IPAddress> >;
+template class HashMap<IPAddress, OLSRTopologyInfoBase::Originator>;
+template class Vector<topology_data>;
+template class Vector<IPPair>;
+template class OLSRPublished<OLSRTopologyInfoBase::Snapshot>;
 #endif
 
 CLICK_ENDDECLS
@@ -7,15 +7,20 @@
 #include <click/ipaddress.hh>
 #include <click/bighashmap.hh>
 #include <click/timer.hh>
+#include <click/vector.hh>
 #include "ippair.hh"
 #include "olsr_rtable.hh"
 #include "click_olsr.hh"
+#include "olsr_expiry_queue.hh"
+#include "olsr_admission.hh"
+#include "olsr_memory_report.hh"
+#include "olsr_published.hh"
 
 CLICK_DECLS
 
 class OLSRRoutingTable;
 
-class OLSRTopologyInfoBase: public Element{
+class OLSRTopologyInfoBase: public Element, public OLSRExpiryQueue::Client, public OLSRMemoryReport::Client{
 public:
 
   OLSRTopologyInfoBase();
@@ -28,22 +33,105 @@ public:
   int configure(Vector<String> &, ErrorHandler *);
   int initialize(ErrorHandler *);
   void uninitialize();
+  void take_state(Element *, ErrorHandler *);
+  void add_handlers();
+  void *cast(const char *);
+  void memory_usage(Vector<OLSRMemoryReport::Usage> &);
+  void hash_stats(StringAccum &);
 
-  struct topology_data *add_tuple(IPAddress dest_addr, IPAddress last_addr, timeval time);
+  // add_tuple()s and remove_tuple()s in between neither arm the expiry timer nor notify the
+  // routing table; commit_bulk() does both once, with a full route
+  // computation. No expiry may run in between: commit before returning
+  // to the driver
+  void begin_bulk();
+  void commit_bulk();
+
+  // returns 0 if a new tuple is not admitted: last_addr created too many
+  // lately, or the set is full of tuples that matter more. seq is the
+  // tuple's T_seq, the ANSN of the TC it came from
+  struct topology_data *add_tuple(IPAddress dest_addr, IPAddress last_addr, olsr_time_t time, int seq);
   struct topology_data *find_tuple(IPAddress dest_addr, IPAddress last_addr);
+  // true if a TC of last_addr with a newer ANSN was recorded, one lookup
   bool newer_tuple_exists(IPAddress last_addr, int ansn);
-  bool remove_outdated_tuples(IPAddress last_addr, int ansn);
   void remove_tuple(IPAddress dest_addr, IPAddress last_addr);
-  HashMap<IPPair, void*> *get_topology_set();
+
+  // what update_tuples() did to the tuples of an originator
+  struct Diff {
+    int added;
+    int removed;
+    int refreshed;
+    bool cost_changed;
+    Diff() : added(0), removed(0), refreshed(0), cost_changed(false) { }
+  };
+  // records a TC of last_addr advertising dests, valid until time, with
+  // the costs parallel to dests if not null (RFC 3626 9.5 steps 2 to 4).
+  // Returns false and changes nothing if a newer ANSN was recorded. A TC
+  // with the current ANSN adds to the advertised set; one with a newer
+  // ANSN replaces it, and only the tuples that are not advertised again are
+  // removed, so the routing table hears of the difference alone
+  bool update_tuples(IPAddress last_addr, int ansn, const Vector<IPAddress> &dests,
+		     const Vector<int> *costs, olsr_time_t time, Diff &diff);
+  typedef HashMap <IPPair, topology_data> TopologySet;
+  TopologySet *get_topology_set();
  void print_topology();
+
+  // the tuples are indexed by both ends, so TC processing and the route
+  // computation only look at the tuples of one node
+  const Vector<IPAddress> *destinations_from(IPAddress last_addr) const {
+    const Originator *o = _byLast.findp(last_addr);
+    return o ? &o->dests : 0;
+  }
+  const Vector<IPAddress> *last_hops_to(IPAddress dest_addr) const { return _byDest.findp(dest_addr); }
+
+  // number of tuples added or removed so far, a measure of topology churn
+  uint32_t changes() const { return _changes; }
+
+  // the tuples as of the last publish_snapshot(), which OLSRRoutingTable
+  // calls before each computation; a published Snapshot never changes, so
+  // readers on other threads need no lock. Validity times are those of then
+  struct Snapshot {
+    Vector<topology_data> tuples;
+    uint32_t changes;		// changes() when taken
+  };
+  typedef OLSRPublished<Snapshot>::Ref SnapshotRef;
+  SnapshotRef snapshot() const { return _snapshot.get(); }
+  // publishes the tuples if tuples were added or removed since the last time
+  void publish_snapshot();
+
 private:
-  typedef HashMap <IPPair, void *> TopologySet;
+  typedef HashMap<IPAddress, Vector<IPAddress> > AdjacencyMap;
+
+  // the state of one T_last_addr: the newest ANSN of its tuples and their
+  // T_dest_addrs, kept together so a TC is judged by one lookup
+  struct Originator {
+    int ansn;
+    Vector<IPAddress> dests;
+    Originator() : ansn(0) { }
+  };
+  typedef HashMap<IPAddress, Originator> OriginatorMap;
+
+  uint32_t _changes;
 
   TopologySet *_topologySet;
+  OriginatorMap _byLast;	// T_last_addr -> ANSN and T_dest_addr
+  AdjacencyMap _byDest;		// T_dest_addr -> T_last_addr
+  OLSRExpiryHeap<IPPair> _expiry;
   Timer _timer;
   OLSRRoutingTable *_routingTable;
+  OLSRExpiryQueue *_expiryQueue;
+  bool _bulk;
+  uint32_t _bulk_changes;
+  OLSRAdmission _admission;
+  OLSRPublished<Snapshot> _snapshot;
 
+  bool admit(const IPAddress &last_addr);
+  bool make_room(int priority);
+  static int load_handler(const String &, Element *, void *, ErrorHandler *);
+  static String admission_handler(Element *, void *);
+  static String tuples_handler(Element *, void *);
+  olsr_time_t run_expiry(olsr_time_t now);
   void run_timer(Timer *);
+  static bool unlink(Vector<IPAddress> &v, IPAddress to);
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,180 @@
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include "olsr_trace.hh"
+
+CLICK_DECLS
+
+static const struct {
+  const char *name;
+  int naddrs;
+  bool has_value;
+} trace_types[OLSR_TRACE_NTYPES] = {
+  { "link_failure", 2, false },
+  { "visitor_arrived", 3, false },
+  { "visitor_left", 3, false },
+  { "hna_built", 1, true },
+  { "hna_association", 3, false },
+  { "associations", 0, true }
+};
+
+
+int
+OLSRTrace::Client::set_trace(Element *trace, uint32_t mask, Element *e, ErrorHandler *errh)
+{
+  if (!trace)
+    return 0;
+  if (!(_trace = (OLSRTrace *) trace->cast("OLSRTrace")))
+    return errh->error("%s is not an OLSRTrace", trace->name().c_str());
+  _trace_source = _trace->add_source(e);
+  _trace_mask = mask;
+  return 0;
+}
+
+
+String
+OLSRTrace::Client::read_trace_mask(Element *, void *thunk)
+{
+  Client *c = (Client *) thunk;
+  return String(c->_trace_mask) + "\n";
+}
+
+
+int
+OLSRTrace::Client::write_trace_mask(const String &conf, Element *, void *thunk, ErrorHandler *errh)
+{
+  Client *c = (Client *) thunk;
+  uint32_t mask;
+  if (!cp_unsigned(cp_uncomment(conf), &mask))
+    return errh->error("trace_mask must be an unsigned integer");
+  if (!c->_trace)
+    return errh->error("no TRACE element given");
+  c->_trace_mask = mask;
+  return 0;
+}
+
+
+void
+OLSRTrace::Client::add_trace_handlers(Element *e)
+{
+  e->add_read_handler("trace_mask", read_trace_mask, (void *) this);
+  e->add_write_handler("trace_mask", write_trace_mask, (void *) this);
+}
+
+
+OLSRTrace::OLSRTrace()
+  : _ring(0)
+{
+}
+
+
+OLSRTrace::~OLSRTrace()
+{
+}
+
+
+int
+OLSRTrace::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  int capacity = 4096;
+  if (cp_va_parse(conf, this, errh,
+		  cpOptional,
+		  cpInteger, "number of records", &capacity,
+		  0) < 0)
+    return -1;
+  if (capacity <= 0 || capacity > (1 << 24))
+    return errh->error("CAPACITY must be between 1 and %d", 1 << 24);
+  for (_capacity = 1; _capacity < (uint32_t) capacity; _capacity <<= 1)
+    /* nothing */;
+  return 0;
+}
+
+
+int
+OLSRTrace::initialize(ErrorHandler *errh)
+{
+  if (!(_ring = new olsr_trace_record[_capacity]))
+    return errh->error("out of memory");
+  _next = _first = 0;
+  return 0;
+}
+
+
+void
+OLSRTrace::cleanup(CleanupStage)
+{
+  delete[] _ring;
+  _ring = 0;
+}
+
+
+int
+OLSRTrace::add_source(Element *e)
+{
+  _sources.push_back(e->name());
+  return _sources.size() - 1;
+}
+
+
+String
+OLSRTrace::read_handler(Element *e, void *thunk)
+{
+  OLSRTrace *t = (OLSRTrace *) e;
+  uint32_t first = t->_first;
+  if (t->_next - first > t->_capacity)
+    first = t->_next - t->_capacity;
+  StringAccum sa;
+
+  switch ((intptr_t) thunk) {
+  case 0:
+    for (uint32_t seq = first; seq != t->_next; seq++) {
+      const olsr_trace_record &r = t->_ring[seq & (t->_capacity - 1)];
+      sa << r.seq << ' ' << Timestamp::make_usec(r.sec, r.usec) << ' '
+	 << (r.source < t->_sources.size() ? t->_sources[r.source] : String("?")) << ' ';
+      if (r.type < OLSR_TRACE_NTYPES) {
+	sa << trace_types[r.type].name;
+	for (int i = 0; i < trace_types[r.type].naddrs; i++)
+	  sa << ' ' << IPAddress(r.addr[i]);
+	if (trace_types[r.type].has_value)
+	  sa << ' ' << r.value;
+      } else
+	sa << "type" << r.type;
+      sa << '\n';
+    }
+    break;
+  case 1:
+    for (uint32_t seq = first; seq != t->_next; seq++)
+      sa.append((const char *) &t->_ring[seq & (t->_capacity - 1)], sizeof(olsr_trace_record));
+    break;
+  default:
+    sa << "capacity " << t->_capacity << "\n"
+       << "recorded " << (t->_next - t->_first) << "\n";
+    break;
+  }
+  return sa.take_string();
+}
+
+
+int
+OLSRTrace::clear_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+  OLSRTrace *t = (OLSRTrace *) e;
+  t->_first = t->_next;
+  return 0;
+}
+
+
+void
+OLSRTrace::add_handlers()
+{
+  add_read_handler("dump", read_handler, (void *) 0);
+  add_read_handler("raw", read_handler, (void *) 1);
+  add_read_handler("stats", read_handler, (void *) 2);
+  add_write_handler("clear", clear_handler, (void *) 0);
+}
+
+#include <click/vector.cc>
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRTrace);
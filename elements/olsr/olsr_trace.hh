@@ -0,0 +1,186 @@
+#ifndef OLSR_TRACE_HH
+#define OLSR_TRACE_HH
+
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/timestamp.hh>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+/*
+=c
+
+OLSRTrace([CAPACITY])
+
+=s OLSR
+
+binary event trace for the OLSR elements
+
+=d
+
+Keeps the last CAPACITY events (default 4096, rounded up to a power of two)
+reported by the OLSR elements in a ring buffer of fixed-size records, in
+place of formatted click_chatter lines. An element given the keyword TRACE
+naming an OLSRTrace records the events whose bit is set in its TRACE_MASK
+(default all) and in the OLSR_TRACE mask it was compiled with; recording
+an event costs a timestamp and a few stores, and an event that is disabled
+costs a single test. Each traced element has a C<trace_mask> handler to
+change its mask at run time.
+
+A record is 32 bytes in host byte order: seconds and microseconds of the
+time, a sequence number, the event type and the index of the element that
+reported it (both 16 bits), three IP addresses in network byte order and a
+32-bit value. They are decoded by the C<dump> handler, or read in binary
+from the C<raw> handler.
+
+The events are:
+
+=over 8
+
+=item link_failure (0)
+
+OLSRRecoverFromLinkLayer: the link layer failed to deliver to a next hop.
+Addresses are this node and the next hop.
+
+=item visitor_arrived (1), visitor_left (2)
+
+OLSRRoutingTable: a node outside SUBNET_MASK appeared in or disappeared
+from the routes. Addresses are this node, the visitor and its gateway.
+
+=item hna_built (3)
+
+OLSRHNAGenerator: the HNA messages were rebuilt. Address is the
+originator, the value the number of associations.
+
+=item hna_association (4)
+
+OLSRHNAGenerator: an association in the rebuilt HNA messages. Addresses
+are the originator, the network and the netmask.
+
+=item associations (5)
+
+OLSRAssociationInfoBase: the associations to advertise were read out.
+The value is their number.
+
+=back
+
+=h dump read-only
+
+The recorded events, oldest first, one per line: sequence number, time,
+element, event and its addresses and value.
+
+=h raw read-only
+
+The recorded events as binary records, oldest first.
+
+=h stats read-only
+
+Capacity, and number of events recorded since the start or the last clear.
+
+=h clear write-only
+
+Discards the recorded events.
+
+=a OLSRRecoverFromLinkLayer, OLSRRoutingTable, OLSRHNAGenerator,
+OLSRAssociationInfoBase */
+
+#ifndef OLSR_TRACE
+# define OLSR_TRACE 0xFFFFFFFFU		// event types compiled in
+#endif
+
+enum {
+  OLSR_TRACE_LINK_FAILURE = 0,
+  OLSR_TRACE_VISITOR_ARRIVED,
+  OLSR_TRACE_VISITOR_LEFT,
+  OLSR_TRACE_HNA_BUILT,
+  OLSR_TRACE_HNA_ASSOCIATION,
+  OLSR_TRACE_ASSOCIATIONS,
+  OLSR_TRACE_NTYPES
+};
+
+struct olsr_trace_record {
+  uint32_t sec;
+  uint32_t usec;
+  uint32_t seq;
+  uint16_t type;
+  uint16_t source;	// index of the reporting element
+  uint32_t addr[3];	// network byte order
+  int32_t value;
+};
+
+class OLSRTrace: public Element{
+public:
+
+  class Client { public:
+
+    Client() : _trace(0), _trace_mask(0), _trace_source(0) { }
+    virtual ~Client() { }
+
+    // trace is the TRACE keyword of element e, or null
+    int set_trace(Element *trace, uint32_t mask, Element *e, ErrorHandler *errh);
+    void add_trace_handlers(Element *e);
+
+    inline void trace(int type, IPAddress a0, IPAddress a1 = IPAddress(),
+		      IPAddress a2 = IPAddress(), int32_t value = 0) {
+      if ((OLSR_TRACE & (1U << type)) && (_trace_mask & (1U << type)))
+	_trace->record(type, _trace_source, a0, a1, a2, value);
+    }
+
+  private:
+
+    OLSRTrace *_trace;
+    uint32_t _trace_mask;	// zero without a trace
+    uint16_t _trace_source;
+
+    static String read_trace_mask(Element *, void *);
+    static int write_trace_mask(const String &, Element *, void *, ErrorHandler *);
+
+  };
+
+  OLSRTrace();
+  ~OLSRTrace();
+
+  const char* class_name() const { return "OLSRTrace"; }
+  OLSRTrace *clone() const { return new OLSRTrace(); }
+  const char *port_count() const  { return "0/0"; }
+
+  int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
+  void add_handlers();
+
+  int add_source(Element *e);
+  void record(int type, int source, IPAddress a0, IPAddress a1, IPAddress a2, int32_t value);
+
+private:
+
+  olsr_trace_record *_ring;
+  uint32_t _capacity;
+  uint32_t _next;		// sequence number of the next record
+  uint32_t _first;		// sequence number of the first one kept since clear
+  Vector<String> _sources;
+
+  static String read_handler(Element *, void *);
+  static int clear_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+inline void
+OLSRTrace::record(int type, int source, IPAddress a0, IPAddress a1, IPAddress a2, int32_t value)
+{
+  olsr_trace_record &r = _ring[_next & (_capacity - 1)];
+  Timestamp now = Timestamp::now();
+  r.sec = now.sec();
+  r.usec = now.usec();
+  r.seq = _next++;
+  r.type = type;
+  r.source = source;
+  r.addr[0] = a0.addr();
+  r.addr[1] = a1.addr();
+  r.addr[2] = a2.addr();
+  r.value = value;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,203 @@
+/*
+ * olsr_txfeedback.{cc,hh} -- flags the links the MAC reports as degrading
+ */
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/packet_anno.hh>
+#include <clicknet/wifi.h>
+#include "olsr_txfeedback.hh"
+
+CLICK_DECLS
+
+OLSRTXFeedback::OLSRTXFeedback()
+  : _arpQuerier(0), _linkInfo(0), _offset(0), _timer(this),
+    _degradations(0), _recoveries(0)
+{
+}
+
+
+OLSRTXFeedback::~OLSRTXFeedback()
+{
+}
+
+
+int
+OLSRTXFeedback::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+  Element *arpq, *link_info;
+  int window = 16, min_frames = 8, failures = 20, tries = 4, hold = 5000;
+  if (cp_va_parse(conf, this, errh,
+		  cpElement, "OLSRARPQuerier element", &arpq,
+		  cpElement, "OLSRLinkInfoBase element", &link_info,
+		  cpKeywords,
+		  "OFFSET", cpUnsigned, "destination address offset", &_offset,
+		  "WINDOW", cpInteger, "frames averaged over", &window,
+		  "MIN_FRAMES", cpInteger, "frames before a link is judged", &min_frames,
+		  "FAILURES", cpInteger, "failed frames threshold (percent)", &failures,
+		  "TRIES", cpInteger, "transmissions per frame threshold", &tries,
+		  "HOLD", cpInteger, "feedback hold time (msec)", &hold,
+		  0) < 0)
+    return -1;
+  if (!(_arpQuerier = (OLSRARPQuerier *) arpq->cast("OLSRARPQuerier")))
+    return errh->error("%s is not an OLSRARPQuerier", arpq->name().c_str());
+  if (!(_linkInfo = (OLSRLinkInfoBase *) link_info->cast("OLSRLinkInfoBase")))
+    return errh->error("%s is not an OLSRLinkInfoBase", link_info->name().c_str());
+  if (window < 1 || window > 1024 || (window & (window - 1)))
+    return errh->error("WINDOW must be a power of two up to 1024");
+  if (failures <= 0 || failures > 100)
+    return errh->error("FAILURES must be between 1 and 100");
+  if (tries < 1 || tries > 255)
+    return errh->error("TRIES must be between 1 and 255");
+  if (min_frames < 1 || hold <= 0)
+    return errh->error("MIN_FRAMES and HOLD must be greater than 0");
+  for (_shift = 0; (1 << _shift) < window; _shift++)
+    /* nada */;
+  _min_frames = min_frames;
+  _max_failures = failures * 65536 / 100;
+  _max_tries = tries * 256;
+  _hold = olsr_msec(hold);
+  return 0;
+}
+
+
+int
+OLSRTXFeedback::initialize(ErrorHandler *)
+{
+  _timer.initialize(this);
+  return 0;
+}
+
+
+void
+OLSRTXFeedback::set_degraded(const EtherAddress &ether, LinkState &state, bool degraded)
+{
+  IPAddress neighbor = _arpQuerier->lookup_mac(ether);
+  if (!neighbor) {
+    if (!degraded)
+      state.degraded = false;
+    return;
+  }
+  if (!_linkInfo->set_link_degraded(_arpQuerier->ip_address(), neighbor, degraded)) {
+    //no such link (any more): start over once there is one
+    state.degraded = false;
+    state.frames = 0;
+    return;
+  }
+  state.degraded = degraded;
+  if (degraded) {
+    _degradations++;
+    if (!_timer.scheduled())
+      _timer.schedule_at(olsr_timer_expiry(state.last + _hold));
+  } else
+    _recoveries++;
+}
+
+
+Packet *
+OLSRTXFeedback::simple_action(Packet *p)
+{
+  const click_wifi_extra *ceh = WIFI_EXTRA_ANNO(p);
+  if (p->length() < _offset + 6 || !(ceh->flags & WIFI_EXTRA_TX))
+    return p;
+  EtherAddress dst(p->data() + _offset);
+  if (dst.is_group())
+    return p;
+
+  bool failed = (ceh->flags & WIFI_EXTRA_TX_FAIL);
+  uint32_t tries = (failed ? (ceh->max_tries ? ceh->max_tries : ceh->retries + 1) : ceh->retries + 1);
+  LinkState *state = _links.findp(dst);
+  if (!state) {
+    LinkState s;
+    s.frames = 0;
+    s.tries = 256;
+    s.failures = 0;
+    s.degraded = false;
+    _links.insert(dst, s);
+    state = _links.findp(dst);
+  }
+
+  //exponentially weighted moving averages with a weight of 1/WINDOW; the
+  //first frames weigh more, so that a fresh link is judged quickly
+  int shift = _shift;
+  if (state->frames < (1U << _shift))
+    for (shift = 0; (1U << shift) <= state->frames; shift++)
+      /* nada */;
+  int32_t tries_delta = (int32_t) (tries * 256) - (int32_t) state->tries;
+  int32_t failures_delta = (failed ? 65536 : 0) - (int32_t) state->failures;
+  state->tries += tries_delta >> shift;
+  state->failures += failures_delta >> shift;
+  state->frames++;
+  state->last = olsr_now();
+
+  if (state->frames < _min_frames)
+    return p;
+  if (!state->degraded
+      && (state->failures > _max_failures || state->tries > _max_tries))
+    set_degraded(dst, *state, true);
+  else if (state->degraded
+	   && state->failures < _max_failures / 2 && state->tries < _max_tries / 2)
+    set_degraded(dst, *state, false);
+  return p;
+}
+
+
+void
+OLSRTXFeedback::run_timer(Timer *)
+{
+  //links the traffic left are restored, to be tried again
+  olsr_time_t now = olsr_now(), next = 0;
+  for (HashMap<EtherAddress, LinkState>::iterator it = _links.begin(); it.live(); it++) {
+    LinkState &state = it.value();
+    if (!state.degraded)
+      continue;
+    if (state.last + _hold <= now) {
+      set_degraded(it.key(), state, false);
+      state.frames = 0;
+    } else if (!next || state.last + _hold < next)
+      next = state.last + _hold;
+  }
+  if (next)
+    _timer.schedule_at(olsr_timer_expiry(next));
+}
+
+
+String
+OLSRTXFeedback::read_links(Element *e, void *)
+{
+  OLSRTXFeedback *tf = (OLSRTXFeedback *) e;
+  StringAccum sa;
+  for (HashMap<EtherAddress, LinkState>::const_iterator it = tf->_links.begin(); it.live(); it++) {
+    const LinkState &state = it.value();
+    sa << it.key() << ' ' << tf->_arpQuerier->lookup_mac(it.key()) << ' '
+       << state.frames << ' ' << (state.failures * 100 / 65536) << ' '
+       << (state.tries / 256) << '.' << ((state.tries % 256) * 10 / 256)
+       << (state.degraded ? " degraded" : "") << '\n';
+  }
+  return sa.take_string();
+}
+
+
+String
+OLSRTXFeedback::read_stats(Element *e, void *)
+{
+  OLSRTXFeedback *tf = (OLSRTXFeedback *) e;
+  StringAccum sa;
+  sa << "degradations " << tf->_degradations << '\n'
+     << "recoveries " << tf->_recoveries << '\n';
+  return sa.take_string();
+}
+
+
+void
+OLSRTXFeedback::add_handlers()
+{
+  add_read_handler("links", read_links, 0);
+  add_read_handler("stats", read_stats, 0);
+}
+
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(OLSRTXFeedback)
@@ -0,0 +1,150 @@
+/*
+  =c
+  OLSRTXFeedback(OLSRARPQuerier element, OLSRLinkInfoBase element [, I<keywords> OFFSET, WINDOW, MIN_FRAMES, FAILURES, TRIES, HOLD])
+
+  =s
+  OLSR specific element, flags links the MAC reports as degrading
+
+  =io
+  One input, one output
+
+  =d
+  Takes the transmit feedback of an interface, the packets a wifi device
+  hands back after sending them (ExtraDecap behind a FromDevice in the
+  madwifi style, or the TX feedback output of the device element), and
+  keeps for each unicast destination a moving average, over about WINDOW
+  frames, of the share of frames that failed and of the transmissions a
+  frame took: its retries plus one, or all of its max_tries if it failed.
+  Both are read from the wifi extra header annotation. Packets pass
+  unchanged.
+
+  When, after at least MIN_FRAMES frames, more than FAILURES percent of
+  the frames fail or a frame takes more than TRIES transmissions on
+  average, the link to the neighbor the OLSRARPQuerier gives for the
+  destination is marked degraded in the OLSRLinkInfoBase (see
+  OLSRLinkInfoBase::set_link_degraded): it then costs and advertises
+  OLSR_DEGRADED_PENALTY times its ETX, the MPR set and the TC message are
+  rebuilt and the routes are recomputed, recorded as a link_degraded event.
+  Traffic thus moves off a link that is about to break, rather than after
+  OLSRRecoverFromLinkLayer sees it fail outright. Rerouting weighs link
+  costs, so it takes an OLSRRoutingTable with LINK_QUALITY; without it
+  only the MPR selection and the TC messages notice.
+
+  A link recovers once both averages are below half their thresholds, or
+  when no feedback came for it in HOLD msecs, typically because the traffic
+  moved away, so that it is tried again.
+
+  Like OLSRRecoverFromLinkLayer, the element changes the information bases
+  unlocked, and so belongs on the thread that runs them.
+
+  Keyword arguments are:
+
+  =over 8
+
+  =item OFFSET
+
+  Unsigned. Offset of the destination Ethernet address in the packet data:
+  0 for an Ethernet header, 4 for an 802.11 header. Default is 0.
+
+  =item WINDOW
+
+  Integer. Frames the averages span, a power of two. Default is 16.
+
+  =item MIN_FRAMES
+
+  Integer. Frames to a destination before its link can be marked degraded.
+  Default is 8.
+
+  =item FAILURES
+
+  Integer. Percentage of failed frames above which a link is degraded.
+  Default is 20.
+
+  =item TRIES
+
+  Integer. Average transmissions per frame above which a link is degraded.
+  Default is 4.
+
+  =item HOLD
+
+  Integer. Msecs without feedback after which a degraded link is
+  restored. Default is 5000.
+
+  =back
+
+  =h links read-only
+  The destinations known, one per line with their Ethernet address, the
+  neighbor address, the frames seen, the failure percentage, the average
+  transmissions per frame and whether the link is degraded.
+
+  =h stats read-only
+  The number of times links were marked degraded and restored.
+
+  =e
+  FromDevice(ath0) -> ExtraDecap -> txf :: Classifier(...);
+  txf[0] -> OLSRTXFeedback(arpq0, link_info) -> Discard;
+
+  =a OLSRLinkInfoBase, OLSRRecoverFromLinkLayer, OLSRLinkRate, ExtraDecap */
+
+#ifndef OLSR_TXFEEDBACK_HH
+#define OLSR_TXFEEDBACK_HH
+
+#include <click/element.hh>
+#include <click/etheraddress.hh>
+#include <click/bighashmap.hh>
+#include <click/timer.hh>
+#include "click_olsr.hh"
+#include "olsr_arpquerier.hh"
+#include "olsr_link_infobase.hh"
+
+CLICK_DECLS
+
+class OLSRTXFeedback : public Element { public:
+
+  OLSRTXFeedback();
+  ~OLSRTXFeedback();
+
+  const char *class_name() const	{ return "OLSRTXFeedback"; }
+  const char *port_count() const	{ return "1/1"; }
+  const char *processing() const	{ return AGNOSTIC; }
+
+  int configure(Vector<String> &conf, ErrorHandler *errh);
+  int initialize(ErrorHandler *);
+  void add_handlers();
+
+  Packet *simple_action(Packet *);
+  void run_timer(Timer *);
+
+private:
+
+  struct LinkState {
+    uint32_t frames;
+    uint32_t tries;		// average transmissions per frame, * 256
+    uint32_t failures;		// average failed share of the frames, * 65536
+    bool degraded;
+    olsr_time_t last;		// time of the last feedback
+  };
+
+  OLSRARPQuerier *_arpQuerier;
+  OLSRLinkInfoBase *_linkInfo;
+  unsigned _offset;
+  int _shift;			// log2 of WINDOW
+  uint32_t _min_frames;
+  uint32_t _max_failures;	// * 65536
+  uint32_t _max_tries;		// * 256
+  olsr_time_t _hold;
+  HashMap<EtherAddress, LinkState> _links;
+  Timer _timer;
+
+  uint32_t _degradations;
+  uint32_t _recoveries;
+
+  void set_degraded(const EtherAddress &, LinkState &, bool);
+
+  static String read_links(Element *, void *);
+  static String read_stats(Element *, void *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,161 @@
+#ifndef OLSR_WORKER_POOL_HH
+#define OLSR_WORKER_POOL_HH
+
+#include <click/glue.hh>
+
+CLICK_DECLS
+
+// A few threads that share the work of one job over a range of indices,
+// for computations too large for the control thread alone. run() splits
+// the range into one contiguous slice per thread, runs the first slice on
+// the calling thread and returns once all are done; the job tells slices
+// apart by number, so that each can write its own results and the caller
+// can merge them in slice order, the same on every run. Jobs must only
+// read shared state. The threads are plain pthreads outside the Click
+// scheduler, which sleep between jobs. Without multithreading support
+// start() starts none, and every job runs whole on the calling thread.
+class OLSRWorkerPool{
+public:
+
+  enum { MAX_THREADS = 16 };
+  typedef void (*Job)(void *thunk, int slice, int begin, int end);
+
+  OLSRWorkerPool() : _nthreads(1) {
+#if HAVE_MULTITHREAD && CLICK_USERLEVEL
+    pthread_mutex_init(&_lock, 0);
+    pthread_cond_init(&_work, 0);
+    pthread_cond_init(&_done, 0);
+    _generation = 0;
+    _pending = 0;
+    _stopping = false;
+#endif
+  }
+
+  ~OLSRWorkerPool() {
+    stop();
+#if HAVE_MULTITHREAD && CLICK_USERLEVEL
+    pthread_mutex_destroy(&_lock);
+    pthread_cond_destroy(&_work);
+    pthread_cond_destroy(&_done);
+#endif
+  }
+
+  // slices of a job, counting the calling thread
+  int slices() const			{ return _nthreads; }
+
+  // returns the number of slices jobs will now have, at most nthreads
+  int start(int nthreads) {
+    stop();
+    if (nthreads > MAX_THREADS)
+      nthreads = MAX_THREADS;
+#if HAVE_MULTITHREAD && CLICK_USERLEVEL
+    _stopping = false;
+    for (int i = 1; i < nthreads; i++) {
+      _workers[i].pool = this;
+      _workers[i].slice = i;
+      _workers[i].seen = _generation;
+      if (pthread_create(&_workers[i].thread, 0, worker_main, &_workers[i]) != 0)
+	break;
+      _nthreads++;
+    }
+#endif
+    return _nthreads;
+  }
+
+  void stop() {
+#if HAVE_MULTITHREAD && CLICK_USERLEVEL
+    if (_nthreads > 1) {
+      pthread_mutex_lock(&_lock);
+      _stopping = true;
+      pthread_cond_broadcast(&_work);
+      pthread_mutex_unlock(&_lock);
+      for (int i = 1; i < _nthreads; i++)
+	pthread_join(_workers[i].thread, 0);
+    }
+#endif
+    _nthreads = 1;
+  }
+
+  // calls job once per slice of [0, n); all on this thread unless parallel
+  void run(Job job, void *thunk, int n, bool parallel = true) {
+#if HAVE_MULTITHREAD && CLICK_USERLEVEL
+    if (parallel && _nthreads > 1) {
+      pthread_mutex_lock(&_lock);
+      _job = job;
+      _thunk = thunk;
+      _n = n;
+      _pending = _nthreads - 1;
+      _generation++;
+      pthread_cond_broadcast(&_work);
+      pthread_mutex_unlock(&_lock);
+
+      job(thunk, 0, 0, bound(n, 1));
+
+      pthread_mutex_lock(&_lock);
+      while (_pending)
+	pthread_cond_wait(&_done, &_lock);
+      pthread_mutex_unlock(&_lock);
+      return;
+    }
+#else
+    (void) parallel;
+#endif
+    job(thunk, 0, 0, n);
+  }
+
+private:
+
+  int _nthreads;
+
+  // start of slice i of [0, n)
+  int bound(int n, int i) const		{ return (int) ((int64_t) n * i / _nthreads); }
+
+#if HAVE_MULTITHREAD && CLICK_USERLEVEL
+  struct Worker {
+    OLSRWorkerPool *pool;
+    int slice;
+    unsigned seen;		// generation of the last job taken
+    pthread_t thread;
+  };
+
+  pthread_mutex_t _lock;
+  pthread_cond_t _work;
+  pthread_cond_t _done;
+  unsigned _generation;		// of the last job handed out
+  int _pending;			// worker slices of it not done yet
+  bool _stopping;
+  Job _job;
+  void *_thunk;
+  int _n;
+  Worker _workers[MAX_THREADS];
+
+  static void *worker_main(void *arg) {
+    Worker *w = (Worker *) arg;
+    OLSRWorkerPool *p = w->pool;
+    pthread_mutex_lock(&p->_lock);
+    while (1) {
+      while (p->_generation == w->seen && !p->_stopping)
+	pthread_cond_wait(&p->_work, &p->_lock);
+      if (p->_stopping)
+	break;
+      w->seen = p->_generation;
+      Job job = p->_job;
+      void *thunk = p->_thunk;
+      int n = p->_n;
+      pthread_mutex_unlock(&p->_lock);
+
+      job(thunk, w->slice, p->bound(n, w->slice), p->bound(n, w->slice + 1));
+
+      pthread_mutex_lock(&p->_lock);
+      if (--p->_pending == 0)
+	pthread_cond_signal(&p->_done);
+    }
+    pthread_mutex_unlock(&p->_lock);
+    return 0;
+  }
+#endif
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -35,8 +35,8 @@ AverageCounter::~AverageCounter()
 void
 AverageCounter::reset()
 {
-  _count = 0;
-  _byte_count = 0;
+  _count.clear();
+  _byte_count.clear();
   _first = 0;
   _last = 0;
 }
@@ -64,12 +64,14 @@ Packet *
 AverageCounter::simple_action(Packet *p)
 {
     uint32_t jpart = click_jiffies();
-    _first.compare_and_swap(0, jpart);
+    if (!_first)
+	_first.compare_and_swap(0, jpart);
     if (jpart - _first >= _ignore) {
 	_count++;
 	_byte_count += p->length();
     }
-    _last = jpart;
+    if (_last != jpart)		// don't dirty the line more than once a jiffy
+	_last = jpart;
     return p;
 }
 
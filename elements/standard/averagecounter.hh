@@ -3,6 +3,7 @@
 #include <click/element.hh>
 #include <click/ewma.hh>
 #include <click/atomic.hh>
+#include <click/percpu.hh>
 #include <click/timer.hh>
 CLICK_DECLS
 
@@ -50,8 +51,8 @@ class AverageCounter : public Element { public:
     const char *processing() const		{ return AGNOSTIC; }
     int configure(Vector<String> &, ErrorHandler *);
 
-    uint32_t count() const			{ return _count; }
-    uint32_t byte_count() const			{ return _byte_count; }
+    uint32_t count() const			{ return _count.value(); }
+    uint32_t byte_count() const			{ return _byte_count.value(); }
     uint32_t first() const			{ return _first; }
     uint32_t last() const			{ return _last; }
     uint32_t ignore() const			{ return _ignore; }
@@ -64,8 +65,8 @@ class AverageCounter : public Element { public:
 
   private:
 
-    atomic_uint32_t _count;
-    atomic_uint32_t _byte_count;
+    PerCPUCounter<uint32_t> _count;
+    PerCPUCounter<uint32_t> _byte_count;
     atomic_uint32_t _first;
     atomic_uint32_t _last;
     atomic_uint32_t _first_count;
@@ -33,15 +33,17 @@ bool
 BandwidthRatedUnqueue::run_task(Task *)
 {
     bool worked = false;
-    if (_rate.need_update(Timestamp::now())) {
+    Timestamp now = Timestamp::now();
+    if (_rate.need_update(now)) {
 	if (Packet *p = input(0).pull()) {
 	    _rate.update_with(p->length());
 	    worked = true;
 	    output(0).push(p);
 	} else if (!_signal)
 	    return false;	// without rescheduling
-    }
-    _task.fast_reschedule();
+	_task.fast_reschedule();
+    } else
+	sleep_until_due(now);
     return worked;
 }
 
@@ -1075,12 +1075,12 @@ Classifier::compress_exprs(Vector<uint32_t> &prog, bool perform_binary_search,
 // RUNNING
 //
 
-void
-Classifier::length_checked_push(Packet *p)
+int
+Classifier::length_checked_match(Packet *p) const
 {
   const unsigned char *packet_data = p->data() - _align_offset;
   int packet_length = p->length() + _align_offset; // XXX >= MAXINT?
-  Expr *ex = &_exprs[0];	// avoid bounds checking
+  const Expr *ex = &_exprs[0];	// avoid bounds checking
   int pos = 0;
   uint32_t data;
 
@@ -1105,26 +1105,22 @@ Classifier::length_checked_push(Packet *p)
     pos = ex[pos].no();
   } while (pos > 0);
 
-  checked_output_push(-pos, p);
+  return -pos;
 }
 
-void
-Classifier::push(int, Packet *p)
+inline int
+Classifier::match(Packet *p) const
 {
   const unsigned char *packet_data = p->data() - _align_offset;
-  Expr *ex = &_exprs[0];	// avoid bounds checking
+  const Expr *ex = &_exprs[0];	// avoid bounds checking
   int pos = 0;
 
-  if (_output_everything >= 0) {
-    // must use checked_output_push because the output number might be
-    // out of range
-    pos = -_output_everything;
-    goto found;
-  } else if (p->length() < _safe_length) {
+  if (_output_everything >= 0)
+    // the output number might be out of range; callers check
+    return _output_everything;
+  else if (p->length() < _safe_length)
     // common case never checks packet length
-    length_checked_push(p);
-    return;
-  }
+    return length_checked_match(p);
 
   do {
       uint32_t data = *((const uint32_t *)(packet_data + ex[pos].offset));
@@ -1132,8 +1128,36 @@ Classifier::push(int, Packet *p)
       pos = ex[pos].j[data == ex[pos].value.u];
   } while (pos > 0);
 
- found:
-  checked_output_push(-pos, p);
+  return -pos;
+}
+
+void
+Classifier::push(int, Packet *p)
+{
+  checked_output_push(match(p), p);
+}
+
+void
+Classifier::push_batch(int, PacketBatch &batch)
+{
+  // collect runs of packets bound for the same output
+  PacketBatch run;
+  int run_port = -1;
+  while (Packet *p = batch.pop_front()) {
+    int port = match(p);
+    if (port != run_port) {
+      if ((unsigned) run_port < (unsigned) noutputs())
+	output(run_port).push_batch(run);
+      else
+	run.kill();
+      run_port = port;
+    }
+    run.push_back(p);
+  }
+  if ((unsigned) run_port < (unsigned) noutputs())
+    output(run_port).push_batch(run);
+  else
+    run.kill();
 }
 
 CLICK_ENDDECLS
@@ -98,6 +98,7 @@ class Classifier : public Element { public:
   void finish_expr_subtree(Vector<int> &, Combiner = C_AND, int success = SUCCESS, int failure = FAILURE);
 
   void push(int port, Packet *);
+  void push_batch(int port, PacketBatch &);
 
   struct Expr {
     int offset;
@@ -148,7 +149,8 @@ class Classifier : public Element { public:
 
   static String program_string(Element *, void *);
 
-  void length_checked_push(Packet *);
+  int length_checked_match(Packet *) const;
+  inline int match(Packet *) const;
 
  private:
 
@@ -37,7 +37,8 @@ Counter::~Counter()
 void
 Counter::reset()
 {
-  _count = _byte_count = 0;
+  _count.clear();
+  _byte_count.clear();
   _count_triggered = _byte_triggered = false;
 }
 
@@ -91,15 +92,15 @@ Counter::simple_action(Packet *p)
     _rate.update(1);
     _byte_rate.update(p->length());
 
-  if (_count == _count_trigger && !_count_triggered) {
+  // summing the counts costs more than adding to them, so only when a
+  // trigger is armed
+  if (_count_trigger_h && !_count_triggered && _count == _count_trigger) {
     _count_triggered = true;
-    if (_count_trigger_h)
-      (void) _count_trigger_h->call_write();
+    (void) _count_trigger_h->call_write();
   }
-  if (_byte_count >= _byte_trigger && !_byte_triggered) {
+  if (_byte_trigger_h && !_byte_triggered && _byte_count >= _byte_trigger) {
     _byte_triggered = true;
-    if (_byte_trigger_h)
-      (void) _byte_trigger_h->call_write();
+    (void) _byte_trigger_h->call_write();
   }
 
   return p;
@@ -115,9 +116,9 @@ Counter::read_handler(Element *e, void *thunk)
     Counter *c = (Counter *)e;
     switch ((intptr_t)thunk) {
       case H_COUNT:
-	return String(c->_count);
+	return String(c->_count.value());
       case H_BYTE_COUNT:
-	return String(c->_byte_count);
+	return String(c->_byte_count.value());
       case H_RATE:
 	c->_rate.update(0);	// drop rate after idle period
 	return c->_rate.unparse_rate();
@@ -200,7 +201,7 @@ Counter::llrpc(unsigned command, void *data)
     uint32_t *val = reinterpret_cast<uint32_t *>(data);
     if (*val != 0 && *val != 1)
       return -EINVAL;
-    *val = (*val == 0 ? _count : _byte_count);
+    *val = (*val == 0 ? _count.value() : _byte_count.value());
     return 0;
 
   } else if (command == CLICK_LLRPC_GET_COUNTS) {
@@ -211,9 +212,9 @@ Counter::llrpc(unsigned command, void *data)
       return -EINVAL;
     for (unsigned i = 0; i < cs.n; i++) {
       if (cs.keys[i] == 0)
-	cs.values[i] = _count;
+	cs.values[i] = _count.value();
       else if (cs.keys[i] == 1)
-	cs.values[i] = _byte_count;
+	cs.values[i] = _byte_count.value();
       else
 	return -EINVAL;
     }
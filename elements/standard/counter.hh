@@ -3,6 +3,7 @@
 #define CLICK_COUNTER_HH
 #include <click/element.hh>
 #include <click/ewma.hh>
+#include <click/percpu.hh>
 #include <click/llrpc.h>
 CLICK_DECLS
 class HandlerCall;
@@ -129,8 +130,8 @@ class Counter : public Element { public:
     typedef RateEWMAX<RateEWMAXParameters<4, 4> > byte_rate_t;
 #endif
 
-    counter_t _count;
-    counter_t _byte_count;
+    PerCPUCounter<counter_t> _count;
+    PerCPUCounter<counter_t> _byte_count;
     rate_t _rate;
     byte_rate_t _byte_rate;
 
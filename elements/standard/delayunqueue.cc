@@ -22,10 +22,11 @@
 #include <click/glue.hh>
 #include "delayunqueue.hh"
 #include <click/standard/scheduleinfo.hh>
+#include <click/timer.hh>
 CLICK_DECLS
 
 DelayUnqueue::DelayUnqueue()
-    : _p(0), _task(this), _timer(&_task)
+    : _p(0), _task(this)
 {
 }
 
@@ -45,7 +46,6 @@ int
 DelayUnqueue::initialize(ErrorHandler *errh)
 {
     ScheduleInfo::initialize_task(this, &_task, errh);
-    _timer.initialize(this);
     _signal = Notifier::upstream_empty_signal(this, 0, &_task);
     return 0;
 }
@@ -86,8 +86,8 @@ DelayUnqueue::run_task(Task *)
 	    // small delta, reschedule Task
 	    /* Task rescheduled below */;
 	else {
-	    // large delta, schedule Timer
-	    _timer.schedule_at(expiry);
+	    // large delta, sleep until shortly before the packet is due
+	    _task.reschedule_at(expiry);
 	    return false;		// without rescheduling
 	}
     } else {
@@ -2,7 +2,6 @@
 #define CLICK_DELAYUNQUEUE_HH
 #include <click/element.hh>
 #include <click/task.hh>
-#include <click/timer.hh>
 #include <click/notifier.hh>
 CLICK_DECLS
 
@@ -50,7 +49,6 @@ class DelayUnqueue : public Element { public:
     Packet *_p;
     Timestamp _delay;
     Task _task;
-    Timer _timer;
     NotifierSignal _signal;
 
 };
@@ -80,6 +80,61 @@ FullNoteQueue::pull(int)
 	return pull_failure();
 }
 
+void
+FullNoteQueue::push_batch(int, PacketBatch &batch)
+{
+    // Store the whole batch, then publish the new tail and notify once.
+    int h = _head, t = _tail, ot = t;
+    while (Packet *p = batch.pop_front()) {
+	int nt = next_i(t);
+	if (nt == h && (h = _head) == nt)
+	    push_failure(p);
+	else {
+	    _q[t] = p;
+	    t = nt;
+	}
+    }
+    if (t == ot)
+	return;
+    asm("" : : : "memory");
+    _tail = t;
+
+    int s = size(h, t);
+    if (s > _highwater_length)
+	_highwater_length = s;
+
+    _empty_note.wake();
+
+    if (s == capacity()) {
+	_full_note.sleep();
+#if HAVE_MULTITHREAD
+	// Same race as in push_success().
+	if (size() < capacity())
+	    _full_note.wake();
+#endif
+    }
+}
+
+void
+FullNoteQueue::pull_batch(int, PacketBatch &batch, unsigned max)
+{
+    int h = _head, t = _tail, oh = h;
+    for (; max && h != t; --max) {
+	batch.push_back(_q[h]);
+	h = next_i(h);
+    }
+    if (h == oh) {
+	if (max)
+	    (void) pull_failure();
+	return;
+    }
+    asm("" : : : "memory");
+    _head = h;
+
+    _sleepiness = 0;
+    _full_note.wake();
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(NotifierQueue)
 EXPORT_ELEMENT(FullNoteQueue FullNoteQueue-FullNoteQueue)
@@ -0,0 +1,202 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * mpscqueue.{cc,hh} -- lock-free queue from many pushing threads to one
+ * pulling thread
+ */
+
+#include <click/config.h>
+#include "mpscqueue.hh"
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+static inline void
+full_fence()
+{
+#if CLICK_LINUXMODULE
+    smp_mb();
+#else
+    __sync_synchronize();
+#endif
+}
+
+MPSCQueue::MPSCQueue()
+    : _ring(0), _counters(0), _counters_mem(0)
+{
+}
+
+MPSCQueue::~MPSCQueue()
+{
+}
+
+void *
+MPSCQueue::cast(const char *n)
+{
+    if (strcmp(n, "MPSCQueue") == 0)
+	return (MPSCQueue *)this;
+    else if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+	return static_cast<Notifier *>(&_empty_note);
+    else
+	return Element::cast(n);
+}
+
+int
+MPSCQueue::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _capacity = 1000;
+    _burst = 16;
+    if (cp_va_kparse(conf, this, errh,
+		     "CAPACITY", cpkP, cpUnsigned, &_capacity,
+		     "BURST", 0, cpUnsigned, &_burst,
+		     cpEnd) < 0)
+	return -1;
+    if (_capacity < 1 || _capacity > 0x10000000)
+	return errh->error("CAPACITY out of range");
+    if (_burst < 1)
+	_burst = 1;
+    _empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+    return 0;
+}
+
+int
+MPSCQueue::initialize(ErrorHandler *errh)
+{
+    // the ring is a power of two long, so positions can wrap freely
+    uint32_t n = 1;
+    while (n < _capacity)
+	n <<= 1;
+    _mask = n - 1;
+    if (!(_ring = new Packet *[n]))
+	return errh->error("out of memory!");
+    for (uint32_t i = 0; i < n; i++)
+	_ring[i] = 0;
+
+    if (!(_counters_mem = new char[ninputs() * sizeof(InputCounters) + CACHE_LINE]))
+	return errh->error("out of memory!");
+    _counters = reinterpret_cast<InputCounters *>((reinterpret_cast<uintptr_t>(_counters_mem) + CACHE_LINE - 1) & ~(uintptr_t) (CACHE_LINE - 1));
+    memset(_counters, 0, ninputs() * sizeof(InputCounters));
+
+    _tail = 0;
+    _head = _pull_head = 0;
+    _sleepiness = 0;
+    return 0;
+}
+
+void
+MPSCQueue::cleanup(CleanupStage)
+{
+    if (_ring) {
+	for (uint32_t i = 0; i <= _mask; i++)
+	    if (_ring[i])
+		_ring[i]->kill();
+	delete[] const_cast<Packet **>(_ring);
+    }
+    delete[] _counters_mem;
+    _ring = 0;
+    _counters_mem = 0;
+}
+
+void
+MPSCQueue::push(int port, Packet *p)
+{
+    // reserve a place; _head may lag behind the puller by up to BURST
+    uint32_t t;
+    do {
+	t = _tail.value();
+	if (t - _head >= _capacity) {
+	    _counters[port].drops++;
+	    p->kill();
+	    return;
+	}
+    } while (!_tail.compare_and_swap(t, t + 1));
+
+    // the compare-and-swap ordered the packet data before the store; the
+    // fence orders the store before the notifier check, as pull() orders
+    // Notifier::sleep() before its own check
+    _ring[t & _mask] = p;
+    full_fence();
+    _counters[port].pushes++;
+    if (!_empty_note.active())
+	_empty_note.wake();
+}
+
+Packet *
+MPSCQueue::pull(int)
+{
+    uint32_t h = _pull_head;
+    Packet *p = _ring[h & _mask];
+    if (p) {
+	full_fence();		// read the packet after its pointer
+	_ring[h & _mask] = 0;
+	_pull_head = ++h;
+	if (h - _head >= _burst) {
+	    full_fence();	// empty the places before handing them back
+	    _head = h;
+	}
+	_sleepiness = 0;
+	return p;
+    }
+
+    // A reserved place may not be filled yet; that is empty for now.
+    if (_head != h) {
+	full_fence();
+	_head = h;
+    }
+    if (_sleepiness >= SLEEPINESS_TRIGGER) {
+	_empty_note.sleep();
+	// a push may have checked the notifier before we slept
+	full_fence();
+	if (_ring[h & _mask])
+	    _empty_note.wake();
+    } else
+	++_sleepiness;
+    return 0;
+}
+
+String
+MPSCQueue::read_handler(Element *e, void *thunk)
+{
+    MPSCQueue *q = static_cast<MPSCQueue *>(e);
+    switch ((intptr_t) thunk) {
+      case 0:
+	return String(q->size());
+      case 1:
+	return String(q->_capacity);
+      case 2: {
+	  uint32_t drops = 0;
+	  for (int i = 0; i < q->ninputs(); i++)
+	      drops += q->_counters[i].drops;
+	  return String(drops);
+      }
+      default: {
+	  StringAccum sa;
+	  for (int i = 0; i < q->ninputs(); i++)
+	      sa << i << ' ' << q->_counters[i].pushes << ' '
+		 << q->_counters[i].drops << '\n';
+	  return sa.take_string();
+      }
+    }
+}
+
+int
+MPSCQueue::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    MPSCQueue *q = static_cast<MPSCQueue *>(e);
+    for (int i = 0; i < q->ninputs(); i++)
+	q->_counters[i].pushes = q->_counters[i].drops = 0;
+    return 0;
+}
+
+void
+MPSCQueue::add_handlers()
+{
+    add_read_handler("length", read_handler, (void *) 0);
+    add_read_handler("capacity", read_handler, (void *) 1);
+    add_read_handler("drops", read_handler, (void *) 2);
+    add_read_handler("inputs", read_handler, (void *) 3);
+    add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(MPSCQueue)
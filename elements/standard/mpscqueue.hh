@@ -0,0 +1,125 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_MPSCQUEUE_HH
+#define CLICK_MPSCQUEUE_HH
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include <click/atomic.hh>
+CLICK_DECLS
+
+/*
+=c
+
+MPSCQueue([CAPACITY, I<keywords> BURST])
+
+=s storage
+
+stores packets from many threads for one thread, without locks
+
+=d
+
+Stores packets pushed on any of its inputs in a first-in-first-out queue, to
+be pulled from its output. Drops incoming packets if the queue already holds
+CAPACITY packets. The default for CAPACITY is 1000.
+
+Any number of threads may push into MPSCQueue at once, but only one thread
+may pull from it. Pushers reserve a place in the queue with one
+compare-and-swap and never wait for each other or for the puller; the puller
+takes no lock at all. This makes it a cheap way to hand packets from several
+data-plane threads to a single control thread. Connect each pushing thread to
+its own input: pushes and drops are counted per input, in counters that do
+not share cache lines.
+
+The puller hands the places it has emptied back to the pushers BURST packets
+at a time, rather than after every packet, to keep the cache line that holds
+the queue head from moving between processors. A queue within BURST packets
+of full may therefore drop a packet slightly early. The default for BURST is
+16.
+
+MPSCQueue has an empty notifier, so the pulling task can sleep while the
+queue is empty.
+
+=h length read-only
+
+Returns the current number of packets in the queue.
+
+=h capacity read-only
+
+Returns the queue's capacity.
+
+=h drops read-only
+
+Returns the number of packets dropped by the queue so far.
+
+=h inputs read-only
+
+Returns the number of packets pushed and dropped on each input, one line per
+input.
+
+=h reset_counts write-only
+
+When written, resets the C<drops> and C<inputs> counters.
+
+=a ThreadSafeQueue, Queue, NotifierQueue */
+
+class MPSCQueue : public Element { public:
+
+    MPSCQueue();
+    ~MPSCQueue();
+
+    const char *class_name() const		{ return "MPSCQueue"; }
+    const char *port_count() const		{ return "-/1"; }
+    const char *processing() const		{ return "h/l"; }
+    void *cast(const char *);
+
+    int configure(Vector<String> &conf, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void push(int port, Packet *);
+    Packet *pull(int port);
+
+    inline uint32_t size() const;
+
+  private:
+
+    enum { CACHE_LINE = 64, SLEEPINESS_TRIGGER = 9 };
+
+    struct InputCounters {
+	uint32_t pushes;
+	uint32_t drops;
+	char pad[CACHE_LINE - 2 * sizeof(uint32_t)];
+    };
+
+    // shared with the pushers
+    Packet * volatile *_ring;
+    uint32_t _mask;
+    uint32_t _capacity;
+    char _pad0[CACHE_LINE];
+    atomic_uint32_t _tail;		// next place to reserve
+    char _pad1[CACHE_LINE];
+    volatile uint32_t _head;		// first place not handed back
+    char _pad2[CACHE_LINE];
+
+    // puller only
+    uint32_t _pull_head;
+    uint32_t _burst;
+    int _sleepiness;
+    ActiveNotifier _empty_note;
+
+    InputCounters *_counters;
+    char *_counters_mem;
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+inline uint32_t
+MPSCQueue::size() const
+{
+    return _tail.value() - _pull_head;
+}
+
+CLICK_ENDDECLS
+#endif
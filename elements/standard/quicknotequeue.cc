@@ -65,6 +65,30 @@ QuickNoteQueue::pull(int)
     return p;
 }
 
+void
+QuickNoteQueue::pull_batch(int, PacketBatch &batch, unsigned max)
+{
+    int h = _head, t = _tail, oh = h;
+    for (; max && h != t; --max) {
+	batch.push_back(_q[h]);
+	h = next_i(h);
+    }
+    if (h != oh) {
+	asm("" : : : "memory");
+	_head = h;
+	_full_note.wake();
+    }
+
+    if (h == t) {
+	_empty_note.sleep();
+#if HAVE_MULTITHREAD
+	// Same race as in pull().
+	if (size())
+	    _empty_note.wake();
+#endif
+    }
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(FullNoteQueue)
 EXPORT_ELEMENT(QuickNoteQueue)
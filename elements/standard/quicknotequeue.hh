@@ -73,8 +73,9 @@ class QuickNoteQueue : public FullNoteQueue { public:
 
     // FullNoteQueue's configure() suffices
 
-    // FullNoteQueue's push() suffices
+    // FullNoteQueue's push() and push_batch() suffice
     Packet *pull(int port);
+    void pull_batch(int port, PacketBatch &batch, unsigned max);
 
 };
 
@@ -22,6 +22,7 @@
 #include <click/confparse.hh>
 #include <click/error.hh>
 #include <click/standard/scheduleinfo.hh>
+#include <click/timer.hh>
 CLICK_DECLS
 
 RatedUnqueue::RatedUnqueue()
@@ -57,7 +58,8 @@ bool
 RatedUnqueue::run_task(Task *)
 {
     bool worked = false;
-    if (_rate.need_update(Timestamp::now())) {
+    Timestamp now = Timestamp::now();
+    if (_rate.need_update(now)) {
 	//_rate.update();  // uncomment this if you want it to run periodically
 	if (Packet *p = input(0).pull()) {
 	    _rate.update();
@@ -66,11 +68,24 @@ RatedUnqueue::run_task(Task *)
 	} else  // no Packet available
 	    if (use_signal && !_signal)
 		return false;		// without rescheduling
-    }
-    _task.fast_reschedule();
+	_task.fast_reschedule();
+    } else
+	sleep_until_due(now);
     return worked;
 }
 
+void
+RatedUnqueue::sleep_until_due(const Timestamp &now)
+{
+    // A short wait is spun off, a longer one slept: the Task leaves the run
+    // queue until shortly before the rate allows the next packet.
+    Timestamp expiry = _rate.expiry() - Timer::adjustment();
+    if (expiry <= now)
+	_task.fast_reschedule();
+    else
+	_task.reschedule_at(expiry);
+}
+
 
 // HANDLERS
 
@@ -17,9 +17,9 @@ CLICK_DECLS
  * Pulls packets at the given RATE in packets per second, and pushes them out
  * its single output.
  *
- * RatedUnqueue will use a lot of CPU if given a low RATE.  This is because it
- * maintains the RATE by constantly rescheduling itself until it's time for a
- * packet to be emitted.  TimedUnqueue is often a better choice for low RATEs.
+ * Between packets, RatedUnqueue sleeps until shortly before the next one is
+ * due (see Task::reschedule_at), and only spins for the last fraction of a
+ * millisecond, so a low RATE costs little CPU.
  *
  * =h rate read/write
  *
@@ -44,6 +44,8 @@ class RatedUnqueue : public Element { public:
 
   protected:
 
+    void sleep_until_due(const Timestamp &now);
+
     GapRate _rate;
     Task _task;
     enum { use_signal = 1 };
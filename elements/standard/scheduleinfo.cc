@@ -41,18 +41,31 @@ int
 ScheduleInfo::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     NameDB* db = NameInfo::getdb(NameInfo::T_SCHEDULEINFO, this, 4, true);
+    NameDB* deadline_db = 0;
 
     // compile scheduling info
     for (int i = 0; i < conf.size(); i++) {
 	Vector<String> parts;
 	int32_t mt;
+	Timestamp deadline;
 	cp_spacevec(conf[i], parts);
 	if (parts.size() == 0)
 	    /* empty argument OK */;
-	else if (parts.size() != 2 || !cp_real2(parts[1], FRAC_BITS, &mt))
-	    errh->error("expected %<ELEMENTNAME PARAM%>");
-	else
+	else if (parts.size() < 2 || parts.size() > 3
+		 || !cp_real2(parts[1], FRAC_BITS, &mt)
+		 || (parts.size() == 3 && (!cp_time(parts[2], &deadline)
+					   || deadline.sec() > 1000)))
+	    errh->error("expected %<ELEMENTNAME PARAM [DEADLINE]%>");
+	else {
 	    db->define(parts[0], &mt, 4);
+	    if (parts.size() == 3) {
+		// deadlines in microseconds
+		if (!deadline_db)
+		    deadline_db = NameInfo::getdb(NameInfo::T_SCHEDULEINFO_DEADLINE, this, 4, true);
+		int32_t usec = deadline.usecval();
+		deadline_db->define(parts[0], &usec, 4);
+	    }
+	}
     }
 
     return 0;
@@ -113,10 +126,29 @@ ScheduleInfo::query(Element *e, ErrorHandler *errh)
 #endif
 }
 
+/** @brief Return the deadline of @a e's Tasks, or 0 if they have none.
+ *
+ * The outermost ScheduleInfo that names @a e with a DEADLINE decides. */
+Timestamp
+ScheduleInfo::query_deadline(Element *e)
+{
+    String id = e->name();
+    int32_t usec = 0;
+    for (NameDB *db = NameInfo::getdb(NameInfo::T_SCHEDULEINFO_DEADLINE, e, 4, false);
+	 db; db = db->context_parent())
+	if (id.length() > db->context().length()
+	    && memcmp(id.data(), db->context().data(), db->context().length()) == 0)
+	    db->query(id.substring(db->context().length()), &usec, 4);
+    return Timestamp::make_usec(usec);
+}
+
 void
 ScheduleInfo::initialize_task(Element *e, Task *task, bool schedule,
 			      ErrorHandler *errh)
 {
+    // the deadline first, so that a task scheduled at once is in its class
+    if (Timestamp deadline = query_deadline(e))
+	task->set_deadline(deadline);
 #if HAVE_STRIDE_SCHED
     int tickets = query(e, errh);
     if (tickets > 0) {
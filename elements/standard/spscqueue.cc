@@ -0,0 +1,263 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * spscqueue.{cc,hh} -- lock-free queue from one pushing thread to one
+ * pulling thread
+ */
+
+#include <click/config.h>
+#include "spscqueue.hh"
+#include <click/confparse.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+static inline void
+full_fence()
+{
+#if CLICK_LINUXMODULE
+    smp_mb();
+#else
+    __sync_synchronize();
+#endif
+}
+
+// orders loads and stores among themselves, but not a store before a load
+static inline void
+order_fence()
+{
+#if CLICK_LINUXMODULE
+    smp_mb();
+#elif defined(__i386__) || defined(__x86_64__)
+    asm volatile("" : : : "memory");
+#else
+    __sync_synchronize();
+#endif
+}
+
+SPSCQueue::SPSCQueue()
+    : _ring(0)
+{
+}
+
+SPSCQueue::~SPSCQueue()
+{
+}
+
+void *
+SPSCQueue::cast(const char *n)
+{
+    if (strcmp(n, "SPSCQueue") == 0)
+	return (SPSCQueue *)this;
+    else if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+	return static_cast<Notifier *>(&_empty_note);
+    else if (strcmp(n, Notifier::FULL_NOTIFIER) == 0)
+	return static_cast<Notifier *>(&_full_note);
+    else
+	return Element::cast(n);
+}
+
+int
+SPSCQueue::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _capacity = 1000;
+    if (cp_va_kparse(conf, this, errh,
+		     "CAPACITY", cpkP, cpUnsigned, &_capacity,
+		     cpEnd) < 0)
+	return -1;
+    if (_capacity < 1 || _capacity > 0x10000000)
+	return errh->error("CAPACITY out of range");
+    _empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+    _full_note.initialize(Notifier::FULL_NOTIFIER, router());
+    _full_note.set_active(true, false);
+    return 0;
+}
+
+int
+SPSCQueue::initialize(ErrorHandler *errh)
+{
+    // the ring is a power of two long, so positions can wrap freely
+    uint32_t n = 1;
+    while (n < _capacity)
+	n <<= 1;
+    _mask = n - 1;
+    if (!(_ring = new Packet *[n]))
+	return errh->error("out of memory!");
+
+    _tail = _head_cache = 0;
+    _head = _tail_cache = 0;
+    _drops = _highwater_length = 0;
+    _sleepiness = 0;
+    return 0;
+}
+
+void
+SPSCQueue::cleanup(CleanupStage)
+{
+    if (_ring)
+	for (uint32_t h = _head; h != _tail; h++)
+	    _ring[h & _mask]->kill();
+    delete[] _ring;
+    _ring = 0;
+}
+
+/**
+ * makes the places before t visible to the puller and wakes it; puts the
+ * full notifier to sleep if the queue is now full
+ */
+inline void
+SPSCQueue::publish_tail(uint32_t t)
+{
+    order_fence();		// fill the places before publishing them
+    _tail = t;
+
+    uint32_t s = t - _head_cache;
+    if (s > _highwater_length)
+	_highwater_length = s;
+
+    // the fence orders the store before the notifier check, as
+    // pull_failure() orders Notifier::sleep() before its own check
+    full_fence();
+    if (!_empty_note.active())
+	_empty_note.wake();
+
+    if (s >= _capacity && t - (_head_cache = _head) >= _capacity) {
+	_full_note.sleep();
+	// a pull may have checked the notifier before we slept
+	full_fence();
+	if (t - _head < _capacity)
+	    _full_note.wake();
+    }
+}
+
+/**
+ * hands the places before h back to the pusher and wakes it
+ */
+inline void
+SPSCQueue::publish_head(uint32_t h)
+{
+    order_fence();		// empty the places before handing them back
+    _head = h;
+    _sleepiness = 0;
+    full_fence();
+    if (!_full_note.active())
+	_full_note.wake();
+}
+
+inline Packet *
+SPSCQueue::pull_failure(uint32_t h)
+{
+    if (_sleepiness >= SLEEPINESS_TRIGGER) {
+	_empty_note.sleep();
+	// a push may have checked the notifier before we slept
+	full_fence();
+	if (_tail != h)
+	    _empty_note.wake();
+    } else
+	++_sleepiness;
+    return 0;
+}
+
+void
+SPSCQueue::push(int, Packet *p)
+{
+    uint32_t t = _tail;
+    if (t - _head_cache >= _capacity
+	&& t - (_head_cache = _head) >= _capacity) {
+	if (_drops == 0)
+	    click_chatter("%{element}: overflow", this);
+	_drops++;
+	p->kill();
+	return;
+    }
+    order_fence();		// the puller is done with the place
+    _ring[t & _mask] = p;
+    publish_tail(t + 1);
+}
+
+Packet *
+SPSCQueue::pull(int)
+{
+    uint32_t h = _head;
+    if (h == _tail_cache && h == (_tail_cache = _tail))
+	return pull_failure(h);
+    order_fence();		// read the place after its publication
+    Packet *p = _ring[h & _mask];
+    publish_head(h + 1);
+    return p;
+}
+
+void
+SPSCQueue::push_batch(int, PacketBatch &batch)
+{
+    // Store the whole batch, then publish the new tail and notify once.
+    uint32_t t = _tail, ot = t;
+    while (Packet *p = batch.pop_front()) {
+	if (t - _head_cache >= _capacity
+	    && t - (_head_cache = _head) >= _capacity) {
+	    if (_drops == 0)
+		click_chatter("%{element}: overflow", this);
+	    _drops++;
+	    p->kill();
+	} else {
+	    order_fence();
+	    _ring[t & _mask] = p;
+	    t++;
+	}
+    }
+    if (t != ot)
+	publish_tail(t);
+}
+
+void
+SPSCQueue::pull_batch(int, PacketBatch &batch, unsigned max)
+{
+    uint32_t h = _head, oh = h;
+    if (_tail_cache - h < max)
+	_tail_cache = _tail;
+    order_fence();
+    for (; max && h != _tail_cache; --max, ++h)
+	batch.push_back(_ring[h & _mask]);
+    if (h == oh) {
+	if (max)
+	    (void) pull_failure(h);
+	return;
+    }
+    publish_head(h);
+}
+
+String
+SPSCQueue::read_handler(Element *e, void *thunk)
+{
+    SPSCQueue *q = static_cast<SPSCQueue *>(e);
+    switch ((intptr_t) thunk) {
+      case 0:
+	return String(q->size());
+      case 1:
+	return String(q->_highwater_length);
+      case 2:
+	return String(q->_capacity);
+      default:
+	return String(q->_drops);
+    }
+}
+
+int
+SPSCQueue::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    SPSCQueue *q = static_cast<SPSCQueue *>(e);
+    q->_drops = 0;
+    q->_highwater_length = q->size();
+    return 0;
+}
+
+void
+SPSCQueue::add_handlers()
+{
+    add_read_handler("length", read_handler, (void *) 0);
+    add_read_handler("highwater_length", read_handler, (void *) 1);
+    add_read_handler("capacity", read_handler, (void *) 2);
+    add_read_handler("drops", read_handler, (void *) 3);
+    add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(SPSCQueue)
@@ -0,0 +1,125 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SPSCQUEUE_HH
+#define CLICK_SPSCQUEUE_HH
+#include <click/element.hh>
+#include <click/notifier.hh>
+CLICK_DECLS
+
+/*
+=c
+
+SPSCQueue
+SPSCQueue(CAPACITY)
+
+=s storage
+
+stores packets from one thread for another, without locks
+
+=d
+
+Stores incoming packets in a first-in-first-out queue. Drops incoming
+packets if the queue already holds CAPACITY packets. The default for
+CAPACITY is 1000.
+
+SPSCQueue is meant to sit between two threads, such as the thread that
+receives and routes packets and the thread that runs a ToDevice: one thread
+pushes into it and another pulls from it, and neither takes a lock. The
+pushing side and the pulling side each keep their position on a cache line
+of their own, together with a copy of the other side's position that they
+refresh only when the queue looks full or empty, so the two processors
+rarely touch the same line. Batches pushed or pulled as a whole publish
+their position once.
+
+Like Queue, SPSCQueue has an empty notifier, which sleeps some time after
+the queue goes empty, and a full notifier, which sleeps while the queue is
+full; both are safe to wake from the other thread. It can replace a Queue
+wherever at most one thread pushes and at most one thread pulls; use
+MPSCQueue or ThreadSafeQueue when several threads push.
+
+=h length read-only
+
+Returns the current number of packets in the queue.
+
+=h highwater_length read-only
+
+Returns the maximum number of packets that have ever been in the queue at once.
+
+=h capacity read-only
+
+Returns the queue's capacity.
+
+=h drops read-only
+
+Returns the number of packets dropped by the queue so far.
+
+=h reset_counts write-only
+
+When written, resets the C<drops> and C<highwater_length> counters.
+
+=a Queue, MPSCQueue, ThreadSafeQueue */
+
+class SPSCQueue : public Element { public:
+
+    SPSCQueue();
+    ~SPSCQueue();
+
+    const char *class_name() const		{ return "SPSCQueue"; }
+    const char *port_count() const		{ return PORTS_1_1; }
+    const char *processing() const		{ return "h/l"; }
+    void *cast(const char *);
+
+    int configure(Vector<String> &conf, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void push(int port, Packet *);
+    Packet *pull(int port);
+    void push_batch(int port, PacketBatch &batch);
+    void pull_batch(int port, PacketBatch &batch, unsigned max);
+
+    inline uint32_t size() const;
+
+  private:
+
+    enum { CACHE_LINE = 64, SLEEPINESS_TRIGGER = 9 };
+
+    // read by both sides
+    Packet **_ring;
+    uint32_t _mask;
+    uint32_t _capacity;
+    char _pad0[CACHE_LINE];
+
+    // pusher only, but _tail is read by the puller
+    volatile uint32_t _tail;		// next place to fill
+    uint32_t _head_cache;		// _head as last seen
+    uint32_t _drops;
+    uint32_t _highwater_length;
+    char _pad1[CACHE_LINE];
+
+    // puller only, but _head is read by the pusher
+    volatile uint32_t _head;		// next place to empty
+    uint32_t _tail_cache;		// _tail as last seen
+    int _sleepiness;
+    char _pad2[CACHE_LINE];
+
+    ActiveNotifier _empty_note;
+    ActiveNotifier _full_note;
+
+    inline void publish_tail(uint32_t t);
+    inline void publish_head(uint32_t h);
+    inline Packet *pull_failure(uint32_t h);
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+inline uint32_t
+SPSCQueue::size() const
+{
+    return _tail - _head;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -64,6 +64,14 @@ class ThreadSafeQueue : public FullNoteQueue { public:
     void push(int port, Packet *);
     Packet *pull(int port);
 
+    // FullNoteQueue's batch code assumes a single pusher and puller
+    void push_batch(int port, PacketBatch &batch) {
+	Element::push_batch(port, batch);
+    }
+    void pull_batch(int port, PacketBatch &batch, unsigned max) {
+	Element::pull_batch(port, batch, max);
+    }
+
   private:
 
     atomic_uint32_t _xhead;
@@ -73,15 +73,12 @@ Unqueue::run_task(Task *)
 	    return false;
     }
 
-    while (worked < limit && _active) {
-	if (Packet *p = input(0).pull()) {
-	    ++worked;
-	    output(0).push(p);
-	} else if (!_signal)
-	    goto out;
-	else
-	    break;
-    }
+    PacketBatch batch;
+    input(0).pull_batch(batch, limit);
+    worked = batch.count();
+    output(0).push_batch(batch);
+    if (worked < limit && !_signal)
+	goto out;
 
     _task.fast_reschedule();
   out:
@@ -29,8 +29,7 @@
 CLICK_DECLS
 
 IPRewriter::IPRewriter()
-  : _tcp_map(0), _udp_map(0), _tcp_done(0),
-    _tcp_done_tail(0),
+  : _shards(0), _nshards(1),
     _tcp_done_gc_timer(tcp_done_gc_hook, this),
     _tcp_gc_timer(tcp_gc_hook, this),
     _udp_gc_timer(udp_gc_hook, this)
@@ -40,6 +39,7 @@ IPRewriter::IPRewriter()
 IPRewriter::~IPRewriter()
 {
   assert(!_tcp_gc_timer.scheduled() && !_udp_gc_timer.scheduled());
+  delete[] _shards;
 }
 
 void *
@@ -67,6 +67,7 @@ IPRewriter::configure(Vector<String> &conf, ErrorHandler *errh)
   _udp_gc_interval = 10;		// 10 seconds
   _tcp_done_gc_incr = false;
   _dst_anno = true;
+  _nshards = 1;
 
   if (cp_va_kparse_remove_keywords
       (conf, this, errh,
@@ -78,9 +79,15 @@ IPRewriter::configure(Vector<String> &conf, ErrorHandler *errh)
        "UDP_TIMEOUT", 0, cpSeconds, &_udp_timeout_jiffies,
        "TCP_DONE_GC_INCR", 0, cpBool, &_tcp_done_gc_incr,
        "DST_ANNO", 0, cpBool, &_dst_anno,
+       "SHARDS", 0, cpInteger, &_nshards,
        cpEnd) < 0)
     return -1;
 
+  if (_nshards < 1 || _nshards > 1024)
+    return errh->error("SHARDS must be between 1 and 1024");
+  delete[] _shards;
+  _shards = new Shard[nshards_total()];
+
   if (conf.size() != ninputs())
       return errh->error("need %d arguments, one per input port", ninputs());
 
@@ -117,8 +124,10 @@ IPRewriter::initialize(ErrorHandler *)
 void
 IPRewriter::cleanup(CleanupStage)
 {
-  clear_map(_tcp_map);
-  clear_map(_udp_map);
+  for (int i = 0; _shards && i < nshards_total(); i++) {
+    clear_map(_shards[i].tcp_map);
+    clear_map(_shards[i].udp_map);
+  }
 
   for (int i = 0; i < _input_specs.size(); i++)
     if (_input_specs[i].kind == INPUT_SPEC_PATTERN)
@@ -146,8 +155,19 @@ IPRewriter::take_state(Element *e, ErrorHandler *errh)
       errh->message("(out of range mappings will be dropped)");
   }
 
-  _tcp_map.swap(rw->_tcp_map);
-  _udp_map.swap(rw->_udp_map);
+  // move every mapping pair into the shard it belongs to here; both
+  // elements may have different numbers of shards
+  for (int i = 0; i < rw->nshards_total(); i++) {
+    Shard &old = rw->_shards[i];
+    for (int proto = 0; proto < 2; proto++) {
+      int ip_p = (proto ? IP_PROTO_UDP : IP_PROTO_TCP);
+      Map &map = old.map(ip_p);
+      for (Map::iterator iter = map.begin(); iter.live(); iter++)
+	_shards[pair_shard(iter.value())].map(ip_p).set(iter.key(), iter.value());
+      map.clear();
+    }
+    old.tcp_done = old.tcp_done_tail = 0;
+  }
 
   // check rw->_all_patterns against our _all_patterns
   Vector<Pattern *> pattern_map;
@@ -159,15 +179,18 @@ IPRewriter::take_state(Element *e, ErrorHandler *errh)
     pattern_map.push_back(q);
   }
 
-  take_state_map(_tcp_map, &_tcp_done, &_tcp_done_tail, rw->_all_patterns, pattern_map);
-  take_state_map(_udp_map, 0, 0, rw->_all_patterns, pattern_map);
-  Mapping *m = _tcp_done;
-  Mapping *mp = 0;
-  while (m) {
-    mp = m;
-    m = m->free_next();
+  for (int i = 0; i < nshards_total(); i++) {
+    Shard &s = _shards[i];
+    take_state_map(s.tcp_map, &s.tcp_done, &s.tcp_done_tail, rw->_all_patterns, pattern_map);
+    take_state_map(s.udp_map, 0, 0, rw->_all_patterns, pattern_map);
+    Mapping *m = s.tcp_done;
+    Mapping *mp = 0;
+    while (m) {
+      mp = m;
+      m = m->free_next();
+    }
+    s.tcp_done_tail = mp;
   }
-  _tcp_done_tail = mp;
 }
 
 void
@@ -175,19 +198,15 @@ IPRewriter::tcp_gc_hook(Timer *timer, void *thunk)
 {
   IPRewriter *rw = (IPRewriter *)thunk;
   unsigned wait = rw->_tcp_gc_interval;
-#if IPRW_RWLOCKS
-  if (rw->_rwlock.attempt_write()) {
-#elif IPRW_SPINLOCKS
-  if (rw->_spinlock.attempt()) {
-#endif
-  rw->clean_map(rw->_tcp_map, click_jiffies() - rw->_tcp_timeout_jiffies);
-#if IPRW_RWLOCKS
-  rw->_rwlock.release_write();
-  } else wait = 1;		// XXX too long a wait?
-#elif IPRW_SPINLOCKS
-  rw->_spinlock.release();
-  } else wait = 1;
-#endif
+  for (int i = 0; i < rw->nshards_total(); i++) {
+    Shard &s = rw->_shards[i];
+    if (!s.attempt()) {
+      wait = 1;			// XXX too long a wait?
+      continue;
+    }
+    rw->clean_map(s.tcp_map, click_jiffies() - rw->_tcp_timeout_jiffies);
+    s.release();
+  }
   timer->reschedule_after_sec(wait);
 }
 
@@ -196,21 +215,17 @@ IPRewriter::tcp_done_gc_hook(Timer *timer, void *thunk)
 {
   IPRewriter *rw = (IPRewriter *)thunk;
   unsigned wait = rw->_tcp_done_gc_interval;
-#if IPRW_RWLOCKS
-  if (rw->_rwlock.attempt_write()) {
-#elif IPRW_SPINLOCKS
-  if (rw->_spinlock.attempt()) {
-#endif
-  rw->clean_map_free_tracked
-    (rw->_tcp_map, rw->_tcp_done, rw->_tcp_done_tail,
-     click_jiffies() - rw->_tcp_done_timeout_jiffies);
-#if IPRW_RWLOCKS
-  rw->_rwlock.release_write();
-  } else wait = 1;		// XXX too long a wait?
-#elif IPRW_SPINLOCKS
-  rw->_spinlock.release();
-  } else wait = 1;
-#endif
+  for (int i = 0; i < rw->nshards_total(); i++) {
+    Shard &s = rw->_shards[i];
+    if (!s.attempt()) {
+      wait = 1;
+      continue;
+    }
+    rw->clean_map_free_tracked
+      (s.tcp_map, s.tcp_done, s.tcp_done_tail,
+       click_jiffies() - rw->_tcp_done_timeout_jiffies);
+    s.release();
+  }
   timer->reschedule_after_sec(wait);
 }
 
@@ -219,22 +234,56 @@ IPRewriter::udp_gc_hook(Timer *timer, void *thunk)
 {
   IPRewriter *rw = (IPRewriter *)thunk;
   unsigned wait = rw->_udp_gc_interval;
-#if IPRW_RWLOCKS
-  if (rw->_rwlock.attempt_write()) {
-#elif IPRW_SPINLOCKS
-  if (rw->_spinlock.attempt()) {
-#endif
-  rw->clean_map(rw->_udp_map, click_jiffies() - rw->_udp_timeout_jiffies);
-#if IPRW_RWLOCKS
-  rw->_rwlock.release_write();
-  } else wait = 1;		// XXX too long a wait?
-#elif IPRW_SPINLOCKS
-  rw->_spinlock.release();
-  } else wait = 1;
-#endif
+  for (int i = 0; i < rw->nshards_total(); i++) {
+    Shard &s = rw->_shards[i];
+    if (!s.attempt()) {
+      wait = 1;
+      continue;
+    }
+    rw->clean_map(s.udp_map, click_jiffies() - rw->_udp_timeout_jiffies);
+    s.release();
+  }
   timer->reschedule_after_sec(wait);
 }
 
+/**
+ * returns the shard holding the mapping pair of m: the home shard of its
+ * flows if they share one, else the extra shard
+ */
+int
+IPRewriter::pair_shard(const Mapping *m) const
+{
+  if (_nshards == 1)
+    return 0;
+  int shard = home_shard(m->flow_id().reverse());
+  if (home_shard(m->reverse()->flow_id().reverse()) != shard)
+    shard = _nshards;
+  return shard;
+}
+
+/**
+ * finds the mapping for flow and returns its shard, locked; if there is
+ * none, sets m to 0 and returns the flow's home shard, locked. The home
+ * shard is locked before the extra one, never the other way round
+ */
+IPRewriter::Shard *
+IPRewriter::lookup(int ip_p, const IPFlowID &flow, Mapping *&m)
+{
+  Shard *s = &_shards[home_shard(flow)];
+  s->acquire();
+  m = s->map(ip_p).get(flow);
+  if (!m && _nshards > 1) {
+    Shard *extra = &_shards[_nshards];
+    extra->acquire();
+    if ((m = extra->map(ip_p).get(flow))) {
+      s->release();
+      return extra;
+    }
+    extra->release();
+  }
+  return s;
+}
+
 IPRw::Mapping *
 IPRewriter::apply_pattern(Pattern *pattern, int ip_p, const IPFlowID &flow,
 			  int fport, int rport)
@@ -248,15 +297,22 @@ IPRewriter::apply_pattern(Pattern *pattern, int ip_p, const IPFlowID &flow,
   Mapping *reverse = new Mapping(_dst_anno);
 
   if (forward && reverse) {
-    Map& map = (ip_p == IP_PROTO_TCP ? _tcp_map : _udp_map);
+    int home = home_shard(flow);
+    Map& map = _shards[home].map(ip_p);
 
     if (!pattern)
       Mapping::make_pair(ip_p, flow, flow, fport, rport, forward, reverse);
-    else if (!pattern->create_mapping(ip_p, flow, fport, rport, forward, reverse, map))
+    else if (!pattern->create_mapping(ip_p, flow, fport, rport, forward, reverse, map, _nshards, home))
       goto failure;
 
-    map.set(flow, forward);
-    map.set(forward->flow_id().reverse(), reverse);
+    // the caller holds the home shard
+    Shard &s = _shards[pair_shard(forward)];
+    if (&s != &_shards[home])
+      s.acquire();
+    s.map(ip_p).set(flow, forward);
+    s.map(ip_p).set(forward->flow_id().reverse(), reverse);
+    if (&s != &_shards[home])
+      s.release();
     return forward;
   }
 
@@ -275,9 +331,6 @@ IPRewriter::push(int port, Packet *p_in)
       return;
 
   click_ip *iph = p->ip_header();
-#if IPRW_RWLOCKS
-  bool has_lock = false;
-#endif
 
   // handle non-TCP and non-first fragments
   int ip_p = iph->ip_p;
@@ -290,33 +343,16 @@ IPRewriter::push(int port, Packet *p_in)
     return;
   }
 
-#if IPRW_RWLOCKS
-  _rwlock.acquire_read();
-#elif IPRW_SPINLOCKS
-  _spinlock.acquire();
-#endif
   IPFlowID flow(p);
-  Mapping *m = (ip_p == IP_PROTO_TCP ? _tcp_map.get(flow) : _udp_map.get(flow));
-
-#if IPRW_RWLOCKS
-  _rwlock.release_read();
-#endif
+  Mapping *m;
+  Shard *s = lookup(ip_p, flow, m);
 
   if (!m) {			// create new mapping
     const InputSpec &is = _input_specs[port];
-#if IPRW_RWLOCKS
-    _rwlock.acquire_write();
-    has_lock = true;
-#endif
     switch (is.kind) {
 
      case INPUT_SPEC_NOCHANGE:
-#if IPRW_RWLOCKS
-      _rwlock.release_write();
-      has_lock = false;
-#elif IPRW_SPINLOCKS
-      _spinlock.release();
-#endif
+      s->release();
       output(is.u.output).push(p);
       return;
 
@@ -339,15 +375,18 @@ IPRewriter::push(int port, Packet *p_in)
 
     }
     if (!m) {
-#if IPRW_RWLOCKS
-      _rwlock.release_write();
-      has_lock = false;
-#elif IPRW_SPINLOCKS
-      _spinlock.release();
-#endif
+      s->release();
       p->kill();
       return;
     }
+
+    // move over to the shard the new mapping went to
+    Shard *ms = &_shards[pair_shard(m)];
+    if (ms != s) {
+      ms->acquire();
+      s->release();
+      s = ms;
+    }
   }
 
   m->apply(p);
@@ -356,32 +395,18 @@ IPRewriter::push(int port, Packet *p_in)
     click_tcp *tcph = p->tcp_header();
     if (tcph->th_flags & (TH_SYN | TH_FIN | TH_RST)) {
 
-#if IPRW_RWLOCKS
-      if (!has_lock) {
-        _rwlock.acquire_write();
-        has_lock = true;
-      }
-#endif
-
-      if (_tcp_done_gc_incr && (tcph->th_flags & TH_SYN))
+      if (_tcp_done_gc_incr && (tcph->th_flags & TH_SYN) && s->tcp_done)
         incr_clean_map_free_tracked
-	  (_tcp_map, _tcp_done, _tcp_done_tail, click_jiffies() - _tcp_done_timeout_jiffies);
+	  (s->tcp_map, s->tcp_done, s->tcp_done_tail, click_jiffies() - _tcp_done_timeout_jiffies);
 
       // add to list for dropping TCP connections faster
       if (!m->free_tracked() && (tcph->th_flags & (TH_FIN | TH_RST))
 	  && m->session_over())
-	m->add_to_free_tracked_tail(_tcp_done, _tcp_done_tail);
+	m->add_to_free_tracked_tail(s->tcp_done, s->tcp_done_tail);
     }
   }
 
-#if IPRW_RWLOCKS
-  if (has_lock) {
-    _rwlock.release_write();
-    has_lock = false;
-  }
-#elif IPRW_SPINLOCKS
-  _spinlock.release();
-#endif
+  s->release();
   output(m->output()).push(p);
 }
 
@@ -390,20 +415,19 @@ String
 IPRewriter::dump_mappings_handler(Element *e, void *thunk)
 {
   IPRewriter *rw = (IPRewriter *)e;
-  Map *map = (thunk ? &rw->_udp_map : &rw->_tcp_map);
+  int ip_p = (thunk ? IP_PROTO_UDP : IP_PROTO_TCP);
 
-#if IPRW_SPINLOCKS
-  rw->_spinlock.acquire();
-#endif
   StringAccum sa;
-  for (Map::iterator iter = map->begin(); iter.live(); iter++) {
-    Mapping *m = iter.value();
-    if (m->is_primary())
-      sa << m->unparse() << "\n";
+  for (int i = 0; i < rw->nshards_total(); i++) {
+    Shard &s = rw->_shards[i];
+    s.acquire();
+    for (Map::iterator iter = s.map(ip_p).begin(); iter.live(); iter++) {
+      Mapping *m = iter.value();
+      if (m->is_primary())
+	sa << m->unparse() << "\n";
+    }
+    s.release();
   }
-#if IPRW_SPINLOCKS
-  rw->_spinlock.release();
-#endif
   return sa.take_string();
 }
 
@@ -412,17 +436,26 @@ IPRewriter::dump_tcp_done_mappings_handler(Element *e, void *)
 {
   IPRewriter *rw = (IPRewriter *)e;
 
-#if IPRW_SPINLOCKS
-  rw->_spinlock.acquire();
-#endif
   StringAccum sa;
-  for (Mapping *m = rw->_tcp_done; m; m = m->free_next()) {
-    if (m->session_over())
-      sa << m->unparse() << "\n";
+  for (int i = 0; i < rw->nshards_total(); i++) {
+    Shard &s = rw->_shards[i];
+    s.acquire();
+    for (Mapping *m = s.tcp_done; m; m = m->free_next()) {
+      if (m->session_over())
+	sa << m->unparse() << "\n";
+    }
+    s.release();
   }
-#if IPRW_SPINLOCKS
-  rw->_spinlock.release();
-#endif
+  return sa.take_string();
+}
+
+String
+IPRewriter::dump_shard_mappings_handler(Element *e, void *)
+{
+  IPRewriter *rw = (IPRewriter *)e;
+  StringAccum sa;
+  for (int i = 0; i < rw->nshards_total(); i++)
+    sa << rw->_shards[i].tcp_map.size() << " " << rw->_shards[i].udp_map.size() << "\n";
   return sa.take_string();
 }
 
@@ -430,9 +463,14 @@ String
 IPRewriter::dump_nmappings_handler(Element *e, void *thunk)
 {
   IPRewriter *rw = (IPRewriter *)e;
-  if (!thunk)
-      return String(rw->_tcp_map.size()) + " " + String(rw->_udp_map.size());
-  else
+  if (!thunk) {
+      int ntcp = 0, nudp = 0;
+      for (int i = 0; i < rw->nshards_total(); i++) {
+	  ntcp += rw->_shards[i].tcp_map.size();
+	  nudp += rw->_shards[i].udp_map.size();
+      }
+      return String(ntcp) + " " + String(nudp);
+  } else
       return String(rw->_nmapping_failures);
 }
 
@@ -441,15 +479,9 @@ IPRewriter::dump_patterns_handler(Element *e, void *)
 {
   IPRewriter *rw = (IPRewriter *)e;
   String s;
-#if IPRW_SPINLOCKS
-  rw->_spinlock.acquire();
-#endif
   for (int i = 0; i < rw->_input_specs.size(); i++)
     if (rw->_input_specs[i].kind == INPUT_SPEC_PATTERN)
       s += rw->_input_specs[i].u.pattern.p->unparse() + "\n";
-#if IPRW_SPINLOCKS
-  rw->_spinlock.release();
-#endif
   return s;
 }
 
@@ -459,6 +491,7 @@ IPRewriter::add_handlers()
   add_read_handler("tcp_mappings", dump_mappings_handler, (void *)0);
   add_read_handler("udp_mappings", dump_mappings_handler, (void *)1);
   add_read_handler("tcp_done_mappings", dump_tcp_done_mappings_handler, 0);
+  add_read_handler("shard_mappings", dump_shard_mappings_handler, 0);
   add_read_handler("nmappings", dump_nmappings_handler, (void *)0);
   add_read_handler("mapping_failures", dump_nmappings_handler, (void *)1);
   add_read_handler("patterns", dump_patterns_handler, (void *)0);
@@ -476,21 +509,12 @@ IPRewriter::llrpc(unsigned command, void *data)
     //		  -EAGAIN.
 
     IPFlowID *val = reinterpret_cast<IPFlowID *>(data);
-#if IPRW_SPINLOCKS
-    _spinlock.acquire();
-#endif
-    Mapping *m = get_mapping(IP_PROTO_TCP, *val);
-    if (!m) {
-#if IPRW_SPINLOCKS
-      _spinlock.release();
-#endif
-      return -EAGAIN;
-    }
-    *val = m->flow_id();
-#if IPRW_SPINLOCKS
-    _spinlock.release();
-#endif
-    return 0;
+    Mapping *m;
+    Shard *s = lookup(IP_PROTO_TCP, *val, m);
+    if (m)
+      *val = m->flow_id();
+    s->release();
+    return (m ? 0 : -EAGAIN);
 
   } else if (command == CLICK_LLRPC_IPREWRITER_MAP_UDP) {
 
@@ -501,21 +525,12 @@ IPRewriter::llrpc(unsigned command, void *data)
     //		  -EAGAIN.
 
     IPFlowID *val = reinterpret_cast<IPFlowID *>(data);
-#if IPRW_SPINLOCKS
-    _spinlock.acquire();
-#endif
-    Mapping *m = get_mapping(IP_PROTO_UDP, *val);
-    if (!m) {
-#if IPRW_SPINLOCKS
-      _spinlock.release();
-#endif
-      return -EAGAIN;
-    }
-    *val = m->flow_id();
-#if IPRW_SPINLOCKS
-    _spinlock.release();
-#endif
-    return 0;
+    Mapping *m;
+    Shard *s = lookup(IP_PROTO_UDP, *val, m);
+    if (m)
+      *val = m->flow_id();
+    s->release();
+    return (m ? 0 : -EAGAIN);
 
   } else
     return Element::llrpc(command, data);
@@ -145,6 +145,19 @@ Reap timed-out UDP connections every I<time> seconds. Default is 10 seconds.
 Boolean. If true, then set the destination IP address annotation on passing
 packets to the rewritten destination address. Default is true.
 
+=item SHARDS I<n>
+
+Splits the mapping table into I<n> shards by a hash of the flow identifier
+that is the same for a flow and its reverse. Each shard has its own TCP and
+UDP tables, its own list of completed TCP sessions to reap and, on an SMP
+kernel, its own lock, so threads handling different flows rarely meet on
+one lock or one hot table. Patterns with a port or address range choose a
+rewritten flow whose reply falls into the original flow's shard, so both
+directions of a session are found in one shard with one lookup; this
+leaves each shard 1/I<n> of the range. Mappings whose two directions
+cannot share a shard, such as those of fixed patterns, are kept in an
+extra shard, looked up after the flow's own shard misses. Default is 1.
+
 =back
 
 =h tcp_mappings read-only
@@ -162,12 +175,16 @@ UDP mappings.
 Returns a human-readable description of the IPRewriter's current set of
 mappings for completed TCP sessions.
 
+=h shard_mappings read-only
+
+Returns the number of TCP and UDP mappings in each shard, one shard per
+line; the extra shard, if any, comes last.
+
 =a TCPRewriter, IPAddrRewriter, IPAddrPairRewriter, IPRewriterPatterns,
 RoundRobinIPMapper, FTPPortMapper, ICMPRewriter, ICMPPingRewriter */
 
 #if defined(CLICK_LINUXMODULE) && __MTCLICK__
 # define IPRW_SPINLOCKS 1
-# define IPRW_RWLOCKS 0
 #endif
 
 class IPRewriter : public IPRw { public:
@@ -196,10 +213,30 @@ class IPRewriter : public IPRw { public:
 
  private:
 
-  Map _tcp_map;
-  Map _udp_map;
-  Mapping *_tcp_done;
-  Mapping *_tcp_done_tail;
+  struct Shard {
+    Map tcp_map;
+    Map udp_map;
+    Mapping *tcp_done;
+    Mapping *tcp_done_tail;
+#if IPRW_SPINLOCKS
+    Spinlock lock;
+#endif
+    Shard() : tcp_map(0), udp_map(0), tcp_done(0), tcp_done_tail(0) { }
+    Map &map(int ip_p)		{ return ip_p == IP_PROTO_TCP ? tcp_map : udp_map; }
+    const Map &map(int ip_p) const { return ip_p == IP_PROTO_TCP ? tcp_map : udp_map; }
+#if IPRW_SPINLOCKS
+    bool attempt()		{ return lock.attempt(); }
+    void acquire()		{ lock.acquire(); }
+    void release()		{ lock.release(); }
+#else
+    bool attempt()		{ return true; }
+    void acquire()		{ }
+    void release()		{ }
+#endif
+  };
+
+  Shard *_shards;		// _nshards, then the extra shard if _nshards > 1
+  int _nshards;
 
   Vector<InputSpec> _input_specs;
   bool _dst_anno;
@@ -215,21 +252,22 @@ class IPRewriter : public IPRw { public:
   int _tcp_timeout_jiffies;
   int _tcp_done_timeout_jiffies;
 
-#if IPRW_SPINLOCKS
-  Spinlock _spinlock;
-#endif
-#if IPRW_RWLOCKS
-  ReadWriteLock _rwlock;
-#endif
-
   int _nmapping_failures;
 
+  int nshards_total() const	{ return _nshards > 1 ? _nshards + 1 : 1; }
+  int home_shard(const IPFlowID &flow) const {
+    return _nshards > 1 ? flow_shard(flow, _nshards) : 0;
+  }
+  int pair_shard(const Mapping *) const;
+  Shard *lookup(int ip_p, const IPFlowID &, Mapping *&);
+
   static void tcp_gc_hook(Timer *, void *);
   static void udp_gc_hook(Timer *, void *);
   static void tcp_done_gc_hook(Timer *, void *);
 
   static String dump_mappings_handler(Element *, void *);
   static String dump_tcp_done_mappings_handler(Element *, void *);
+  static String dump_shard_mappings_handler(Element *, void *);
   static String dump_nmappings_handler(Element *, void *);
   static String dump_patterns_handler(Element *, void *);
 
@@ -239,12 +277,12 @@ class IPRewriter : public IPRw { public:
 inline IPRw::Mapping *
 IPRewriter::get_mapping(int ip_p, const IPFlowID &in) const
 {
-  if (ip_p == IP_PROTO_TCP)
-    return _tcp_map[in];
-  else if (ip_p == IP_PROTO_UDP)
-    return _udp_map[in];
-  else
+  if (ip_p != IP_PROTO_TCP && ip_p != IP_PROTO_UDP)
     return 0;
+  Mapping *m = _shards[home_shard(in)].map(ip_p)[in];
+  if (!m && _nshards > 1)
+    m = _shards[_nshards].map(ip_p)[in];
+  return m;
 }
 
 CLICK_ENDDECLS
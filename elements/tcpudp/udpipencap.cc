@@ -106,11 +106,11 @@ UDPIPEncap::simple_action(Packet *p_in)
   if (_aligned)
     ip->ip_sum = ip_fast_csum((unsigned char *)ip, sizeof(click_ip) >> 2);
   else
-    ip->ip_sum = click_in_cksum((unsigned char *)ip, sizeof(click_ip));
+    ip->ip_sum = click_in_cksum_iphdr(ip);
 #elif HAVE_FAST_CHECKSUM
   ip->ip_sum = ip_fast_csum((unsigned char *)ip, sizeof(click_ip) >> 2);
 #else
-  ip->ip_sum = click_in_cksum((unsigned char *)ip, sizeof(click_ip));
+  ip->ip_sum = click_in_cksum_iphdr(ip);
 #endif
 
   p->set_ip_header(ip, sizeof(click_ip));
@@ -20,6 +20,7 @@
 #include "bhmtest.hh"
 #include <click/bighashmap.hh>
 #include <click/hashmap.hh>
+#include <click/vector.hh>
 #include <click/error.hh>
 #if CLICK_USERLEVEL
 # include <sys/time.h>
@@ -72,6 +73,115 @@ check1(HashMap<String, int> &h, ErrorHandler *errh)
     return 0;
 }
 
+// every key in [0, n) but the multiples of skip, if any, once with value key + 1
+static int
+check_contents(const HashMap<int, int> &h, int n, int skip, ErrorHandler *errh)
+{
+    Vector<int> seen(n, 0);
+    size_t count = 0;
+    for (HashMap<int, int>::const_iterator i = h.begin(); i.live(); i++) {
+	CHECK(i.key() >= 0 && i.key() < n);
+	CHECK(!skip || i.key() % skip != 0);
+	CHECK(i.value() == i.key() + 1);
+	CHECK(seen[i.key()] == 0);
+	seen[i.key()] = 1;
+	count++;
+    }
+    CHECK(count == h.size());
+    for (int k = 0; k < n; k++) {
+	if (skip && k % skip == 0) {
+	    CHECK(h.find(k) == -1 && !h.findp(k));
+	} else {
+	    CHECK(seen[k] && h.find(k) == k + 1);
+	}
+    }
+    return 0;
+}
+
+// fills h until a resize begins; no bucket has been migrated yet
+static int
+fill_until_resize(HashMap<int, int> &h)
+{
+    size_t nbuckets = h.nbuckets();
+    int n = 0;
+    while (h.nbuckets() == nbuckets) {
+	h.insert(n, n + 1);
+	n++;
+    }
+    return n;
+}
+
+static int
+check_incremental(ErrorHandler *errh)
+{
+    HashMap<int, int> h(-1);
+    h.set_incremental_resizing(true);
+    CHECK(h.incremental_resizing());
+    size_t nbuckets = h.nbuckets();
+    int n = fill_until_resize(h);
+    CHECK(h.nbuckets() > nbuckets);
+    CHECK(h.size() == (size_t) n);
+
+    // lookups and iteration see the old buckets and the new ones
+    CHECK(check_contents(h, n, 0, errh) == 0);
+
+    // inserting moves a few buckets at a time
+    for (int k = n; k < n + 4; k++)
+	CHECK(h.insert(k, k + 1));
+    CHECK(!h.insert(0, 1));
+    n += 4;
+    CHECK(check_contents(h, n, 0, errh) == 0);
+
+    // erasing finds keys in both tables
+    for (int k = 0; k < n; k += 3)
+	CHECK(h.erase(k));
+    CHECK(!h.erase(0));
+    CHECK(h.size() == (size_t) (n - (n + 2) / 3));
+    CHECK(check_contents(h, n, 3, errh) == 0);
+
+    // copies get what is yet to move, too
+    {
+	HashMap<int, int> hh(h);
+	CHECK(check_contents(hh, n, 3, errh) == 0);
+	hh.insert(n, n + 1);
+	CHECK(check_contents(hh, n + 1, 3, errh) == 0);
+	CHECK(check_contents(h, n, 3, errh) == 0);
+	HashMap<int, int> ha(-1);
+	ha.insert(-5, 7);
+	ha = h;
+	CHECK(check_contents(ha, n, 3, errh) == 0);
+    }
+
+    // the resize completes as insertions go on
+    for (int k = n; k < n + 2 * (int) nbuckets; k++)
+	h.insert(k, k + 1);
+    n += 2 * nbuckets;
+    for (int k = 0; k < n; k++)
+	if (k % 3 == 0)
+	    h.insert(k, k + 1);
+    CHECK(check_contents(h, n, 0, errh) == 0);
+
+    // clearing in the middle of a resize empties both tables
+    HashMap<int, int> c(-1);
+    c.set_incremental_resizing(true);
+    n = fill_until_resize(c);
+    c.clear();
+    CHECK(c.size() == 0 && c.empty());
+    CHECK(!c.begin().live());
+    CHECK(c.find(0) == -1 && c.find(n - 1) == -1);
+    for (int k = 0; k < n; k++)
+	c.insert(k, k + 1);
+    CHECK(check_contents(c, n, 0, errh) == 0);
+
+    // so does swapping
+    HashMap<int, int> s(-1);
+    n = fill_until_resize(c);
+    s.swap(c);
+    CHECK(c.size() == 0);
+    CHECK(check_contents(s, n, 0, errh) == 0);
+    return 0;
+}
+
 #if CLICK_USERLEVEL
 static const char * const classes[] = {
 "ARPFaker",
@@ -433,6 +543,8 @@ BigHashMapTest::initialize(ErrorHandler *errh)
 
     CHECK(check1(h, errh) == 0);
 
+    CHECK(check_incremental(errh) == 0);
+
 #if CLICK_USERLEVEL
     HashMap<String, int> map(-1);
 
@@ -0,0 +1,132 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * bitvectortest.{cc,hh} -- regression test element for Bitvector
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "bitvectortest.hh"
+#include <click/bitvector.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+BitvectorTest::BitvectorTest()
+{
+}
+
+BitvectorTest::~BitvectorTest()
+{
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test `%s' failed", __FILE__, __LINE__, #x);
+
+// compare count() and find_first() against a bit-at-a-time scan
+static int
+check_bits(const Bitvector &v, ErrorHandler *errh)
+{
+    int n = 0;
+    for (int i = 0; i < v.size(); i++)
+	if (v[i])
+	    n++;
+    CHECK(v.count() == n);
+
+    int next = -1;
+    for (int i = v.size() - 1; i >= -1; i--) {
+	if (i >= 0 && v[i])
+	    next = i;
+	CHECK(v.find_first(i) == next);
+    }
+    CHECK(v.find_first(v.size()) == -1);
+    CHECK(v.find_first(v.size() + 40) == -1);
+
+    int visited = 0, last = -1;
+    for (int i = v.find_first(); i >= 0; i = v.find_first(i + 1)) {
+	CHECK(i > last && i < v.size() && v[i]);
+	last = i;
+	visited++;
+    }
+    CHECK(visited == n);
+    return 0;
+}
+
+static int
+check_size(int size, ErrorHandler *errh)
+{
+    // all zero, including the bits past size() in the last word
+    Bitvector v(size);
+    CHECK(v.size() == size && v.count() == 0 && v.find_first() == -1);
+    CHECK(check_bits(v, errh) == 0);
+
+    // all one; operator~ must not count bits past size()
+    Bitvector ones(size, true);
+    CHECK(ones.count() == size);
+    CHECK(check_bits(ones, errh) == 0);
+    Bitvector inv = ~v;
+    CHECK(inv.count() == size);
+    CHECK(check_bits(inv, errh) == 0);
+    inv.negate();
+    CHECK(inv.count() == 0 && inv.find_first() == -1);
+    if (size == 0)
+	return 0;
+
+    // word boundaries and the ends
+    v[0] = true;
+    v[size - 1] = true;
+    if (size > 32)
+	v[32] = true;
+    if (size > 31)
+	v[31] = true;
+    CHECK(check_bits(v, errh) == 0);
+
+    // single bits
+    for (int b = 0; b < size; b++) {
+	Bitvector s(size);
+	s[b] = true;
+	CHECK(s.count() == 1 && s.find_first() == b);
+	CHECK(s.find_first(b) == b && s.find_first(b + 1) == -1);
+    }
+
+    // every third bit
+    Bitvector t(size);
+    for (int i = 0; i < size; i += 3)
+	t[i] = true;
+    CHECK(t.count() == (size + 2) / 3);
+    CHECK(check_bits(t, errh) == 0);
+    CHECK(t.intersection_count(ones) == t.count());
+    CHECK(t.difference_count(ones) == 0);
+    CHECK(ones.difference_count(t) == size - t.count());
+
+    // growing past a word keeps the new bits false
+    t.resize(size + 33);
+    CHECK(t.count() == (size + 2) / 3);
+    CHECK(check_bits(t, errh) == 0);
+    return 0;
+}
+
+int
+BitvectorTest::initialize(ErrorHandler *errh)
+{
+    static const int sizes[] = { 0, 1, 31, 32, 33, 63, 64, 65, 100 };
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	if (check_size(sizes[i], errh) < 0)
+	    return -1;
+
+    Bitvector empty;
+    CHECK(empty.size() == 0 && empty.count() == 0);
+    CHECK(empty.find_first() == -1 && empty.find_first(-5) == -1);
+
+    errh->message("All tests pass!");
+    return 0;
+}
+
+EXPORT_ELEMENT(BitvectorTest)
+CLICK_ENDDECLS
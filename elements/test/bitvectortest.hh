@@ -0,0 +1,35 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_BITVECTORTEST_HH
+#define CLICK_BITVECTORTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+BitvectorTest()
+
+=s test
+
+runs regression tests for Bitvector
+
+=d
+
+BitvectorTest runs Bitvector regression tests at initialization time. It
+does not route packets.
+
+*/
+
+class BitvectorTest : public Element { public:
+
+    BitvectorTest();
+    ~BitvectorTest();
+
+    const char *class_name() const		{ return "BitvectorTest"; }
+
+    int initialize(ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,190 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * flathashmaptest.{cc,hh} -- regression test element for FlatHashMap
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "flathashmaptest.hh"
+#include <click/flathashmap.hh>
+#include <click/vector.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+FlatHashMapTest::FlatHashMapTest()
+{
+}
+
+FlatHashMapTest::~FlatHashMapTest()
+{
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test `%s' failed", __FILE__, __LINE__, #x);
+
+namespace {
+
+// keys with the same hashcode() all have the same home slot, so they form
+// one probe run that erase() has to shift back
+struct CollidingKey {
+    int k;
+    int group;
+    CollidingKey(int k_, int group_) : k(k_), group(group_) { }
+    hashcode_t hashcode() const	{ return group; }
+    bool operator==(const CollidingKey &o) const { return k == o.k; }
+};
+
+}
+
+// every key in [0, n) for which present[key] is set, once, with value key + 1
+static int
+check_contents(const FlatHashMap<int, int> &h, const Vector<int> &present, ErrorHandler *errh)
+{
+    Vector<int> seen(present.size(), 0);
+    size_t count = 0;
+    for (FlatHashMap<int, int>::const_iterator i = h.begin(); i != h.end(); i++) {
+	CHECK(i.key() >= 0 && i.key() < present.size());
+	CHECK(present[i.key()]);
+	CHECK(i.value() == i.key() + 1);
+	CHECK(!seen[i.key()]);
+	seen[i.key()] = 1;
+	count++;
+    }
+    CHECK(count == h.size());
+    for (int k = 0; k < present.size(); k++) {
+	if (present[k]) {
+	    CHECK(h.find(k) == k + 1 && h.findp(k) && *h.findp(k) == k + 1);
+	} else {
+	    CHECK(h.find(k) == -1 && !h.findp(k) && !h.find_pair(k));
+	}
+    }
+    return 0;
+}
+
+static int
+check_colliding(int nbuckets, int ngroups, ErrorHandler *errh)
+{
+    FlatHashMap<CollidingKey, int> h(-1);
+    h.set_dynamic_resizing(false);
+    h.resize(nbuckets);
+    CHECK(h.nbuckets() == (size_t) nbuckets);
+    // as full as the fixed size allows, so the runs wrap around the end
+    int n = nbuckets - 2;
+    for (int k = 0; k < n; k++)
+	CHECK(h.insert(CollidingKey(k, k % ngroups), k + 1));
+    CHECK(h.size() == (size_t) n && h.nbuckets() == (size_t) nbuckets);
+
+    // erase from the front, the middle and the back of the runs; the pairs
+    // behind each one move back and stay reachable
+    Vector<int> present(n, 1);
+    static const int order[] = { 0, 5, 1, 9, 2, 13, 7, 3 };
+    for (size_t o = 0; o < sizeof(order) / sizeof(order[0]); o++) {
+	int e = order[o] % n;
+	CHECK(h.erase(CollidingKey(e, e % ngroups)));
+	CHECK(!h.erase(CollidingKey(e, e % ngroups)));
+	present[e] = 0;
+	for (int k = 0; k < n; k++)
+	    CHECK(h.find(CollidingKey(k, k % ngroups)) == (present[k] ? k + 1 : -1));
+    }
+    for (int k = n - 1; k >= 0; k--)
+	if (present[k]) {
+	    CHECK(h.erase(CollidingKey(k, k % ngroups)));
+	    present[k] = 0;
+	    for (int j = 0; j < n; j++)
+		CHECK(h.find(CollidingKey(j, j % ngroups)) == (present[j] ? j + 1 : -1));
+	}
+    CHECK(h.empty() && !h.begin().live());
+    return 0;
+}
+
+int
+FlatHashMapTest::initialize(ErrorHandler *errh)
+{
+    // insertion, lookup, the default value
+    FlatHashMap<int, int> h(-1);
+    CHECK(h.empty() && h.size() == 0);
+    CHECK(h.find(3) == -1 && h[3] == -1 && !h.findp(3));
+    CHECK(h.insert(3, 4));
+    CHECK(!h.insert(3, 4));
+    CHECK(h.size() == 1 && h.find(3) == 4);
+    h.find_force(5) = 6;
+    CHECK(h.find(5) == 6 && h.size() == 2);
+    CHECK(h.find_force(5) == 6 && h.size() == 2);
+    CHECK(h.find(7, 8) == 8);
+
+    // erase with backward shift, within and across the end of the table
+    CHECK(check_colliding(16, 1, errh) == 0);
+    CHECK(check_colliding(16, 3, errh) == 0);
+    CHECK(check_colliding(64, 5, errh) == 0);
+
+    // growing rehashes everything into a larger power of two
+    const int n = 1000;
+    Vector<int> present(n, 0);
+    h.clear();
+    CHECK(h.empty() && !h.begin().live());
+    size_t nbuckets = h.nbuckets();
+    for (int k = 0; k < n; k++) {
+	CHECK(h.insert(k, k + 1));
+	present[k] = 1;
+	CHECK(h.size() <= h.nbuckets() - h.nbuckets() / 8);
+    }
+    CHECK(h.nbuckets() > nbuckets);
+    CHECK((h.nbuckets() & (h.nbuckets() - 1)) == 0);
+    CHECK(check_contents(h, present, errh) == 0);
+
+    // erasing a third keeps the others
+    for (int k = 0; k < n; k += 3) {
+	CHECK(h.erase(k));
+	present[k] = 0;
+    }
+    CHECK(check_contents(h, present, errh) == 0);
+
+    // explicit resizes never drop below what the pairs need
+    nbuckets = h.nbuckets();
+    h.resize(4 * nbuckets);
+    CHECK(h.nbuckets() == 4 * nbuckets);
+    CHECK(check_contents(h, present, errh) == 0);
+    h.resize(1);
+    CHECK(h.nbuckets() >= h.size() + 1);
+    CHECK(check_contents(h, present, errh) == 0);
+
+    // iterators write values in place
+    for (FlatHashMap<int, int>::iterator i = h.begin(); i.live(); i++)
+	i.value() = -i.value();
+    for (FlatHashMap<int, int>::iterator i = h.begin(); i.live(); i++) {
+	CHECK(i.value() == -(i.key() + 1));
+	i.value() = -i.value();
+    }
+    CHECK(check_contents(h, present, errh) == 0);
+
+    // copies, assignment and swap
+    {
+	FlatHashMap<int, int> hh(h);
+	CHECK(check_contents(hh, present, errh) == 0);
+	hh.erase(1);
+	CHECK(h.find(1) == 2);
+	FlatHashMap<int, int> ha(-1);
+	ha.insert(-5, 7);
+	ha = h;
+	CHECK(ha.find(-5) == -1);
+	CHECK(check_contents(ha, present, errh) == 0);
+	FlatHashMap<int, int> hs(-1);
+	hs.swap(ha);
+	CHECK(ha.empty());
+	CHECK(check_contents(hs, present, errh) == 0);
+    }
+
+    errh->message("All tests pass!");
+    return 0;
+}
+
+EXPORT_ELEMENT(FlatHashMapTest)
+CLICK_ENDDECLS
@@ -0,0 +1,35 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_FLATHASHMAPTEST_HH
+#define CLICK_FLATHASHMAPTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+FlatHashMapTest()
+
+=s test
+
+runs regression tests for FlatHashMap
+
+=d
+
+FlatHashMapTest runs FlatHashMap regression tests at initialization time. It
+does not route packets.
+
+*/
+
+class FlatHashMapTest : public Element { public:
+
+    FlatHashMapTest();
+    ~FlatHashMapTest();
+
+    const char *class_name() const		{ return "FlatHashMapTest"; }
+
+    int initialize(ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,201 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ip6tabletest.{cc,hh} -- regression test element for IP6Table
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "ip6tabletest.hh"
+#include <click/ip6table.hh>
+#include <click/vector.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+IP6TableTest::IP6TableTest()
+{
+}
+
+IP6TableTest::~IP6TableTest()
+{
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test %<%s%> failed", __FILE__, __LINE__, #x);
+
+namespace {
+
+void
+add(IP6Table &t, const char *dst, int len, int index)
+{
+    t.add(IP6Address(String(dst)), IP6Address::make_prefix(len),
+	  IP6Address(), index);
+}
+
+void
+del(IP6Table &t, const char *dst, int len)
+{
+    t.del(IP6Address(String(dst)), IP6Address::make_prefix(len));
+}
+
+// the index of the route for dst, or -1 if there is none
+int
+lookup(const IP6Table &t, const IP6Address &dst)
+{
+    IP6Address gw;
+    int index;
+    return t.lookup(dst, gw, index) ? index : -1;
+}
+
+int
+lookup(const IP6Table &t, const char *dst)
+{
+    return lookup(t, IP6Address(String(dst)));
+}
+
+// bytes 4-15 of random addresses take one of four values, so that random
+// routes nest and diverge at bits 0 and 7 of each byte
+IP6Address
+random_address()
+{
+    static const unsigned char values[] = { 0x00, 0x01, 0x80, 0x81 };
+    unsigned char x[16] = { 0x20, 0x01, 0x0d, 0xb8 };
+    for (int i = 4; i < 16; ++i)
+	x[i] = values[click_random(0, 3)];
+    return IP6Address(x);
+}
+
+struct Route {
+    IP6Address dst;
+    int len;
+    int index;
+};
+
+int
+linear_lookup(const Vector<Route> &routes, const IP6Address &dst)
+{
+    int best = -1;
+    for (int i = 0; i < routes.size(); ++i)
+	if (dst.matches_prefix(routes[i].dst, IP6Address::make_prefix(routes[i].len))
+	    && (best < 0 || routes[i].len > routes[best].len))
+	    best = i;
+    return best < 0 ? -1 : routes[best].index;
+}
+
+}
+
+int
+IP6TableTest::initialize(ErrorHandler *errh)
+{
+    IP6Table t;
+    CHECK(lookup(t, "2001:db8::1") == -1);
+
+    // nested prefixes, longest wins
+    add(t, "::", 0, 0);
+    add(t, "2001:db8::", 32, 1);
+    add(t, "2001:db8:1::", 48, 2);
+    add(t, "2001:db8:1:2::", 64, 3);
+    add(t, "2001:db8:1:2::5", 128, 4);
+    CHECK(lookup(t, "2001:db8:1:2::5") == 4);
+    CHECK(lookup(t, "2001:db8:1:2::6") == 3);
+    CHECK(lookup(t, "2001:db8:1:3::5") == 2);
+    CHECK(lookup(t, "2001:db8:2::5") == 1);
+    CHECK(lookup(t, "2001:dead::5") == 0);
+    CHECK(lookup(t, "::") == 0);
+
+    // prefixes that leave the path in the middle of a byte
+    add(t, "fe80::", 10, 5);
+    add(t, "fec0::", 10, 6);
+    add(t, "2001:db8:8000::", 33, 7);
+    CHECK(lookup(t, "fe80::1") == 5);
+    CHECK(lookup(t, "febf:ffff::1") == 5);
+    CHECK(lookup(t, "fec0::1") == 6);
+    CHECK(lookup(t, "ff00::1") == 0);
+    CHECK(lookup(t, "2001:db8:8000::1") == 7);
+    CHECK(lookup(t, "2001:db8:7fff::1") == 1);
+
+    // the gateway comes back with the index
+    t.add(IP6Address(String("2001:db8:1:2:3::")), IP6Address::make_prefix(80),
+	  IP6Address(String("fe80::2")), 8);
+    IP6Address gw;
+    int index = -1;
+    CHECK(t.lookup(IP6Address(String("2001:db8:1:2:3::1")), gw, index));
+    CHECK(index == 8 && gw == IP6Address(String("fe80::2")));
+
+    // a route for the same prefix replaces the old one
+    add(t, "2001:db8:1::", 48, 9);
+    CHECK(lookup(t, "2001:db8:1:3::5") == 9);
+
+    // deletion falls back to the next shorter prefix
+    del(t, "2001:db8:1:2::", 64);
+    CHECK(lookup(t, "2001:db8:1:2::6") == 9);
+    CHECK(lookup(t, "2001:db8:1:2::5") == 4);
+    CHECK(lookup(t, "2001:db8:1:2:3::1") == 8);
+    del(t, "2001:db8:1::", 48);
+    CHECK(lookup(t, "2001:db8:1:2::6") == 1);
+    CHECK(lookup(t, "2001:db8:1:2::5") == 4);
+    // deleting a route that is not there changes nothing
+    del(t, "2001:db8:1:2::", 64);
+    del(t, "2001:db8::", 40);
+    CHECK(lookup(t, "2001:db8:1:2::6") == 1);
+    del(t, "2001:db8:1:2::5", 128);
+    CHECK(lookup(t, "2001:db8:1:2::5") == 1);
+    del(t, "::", 0);
+    CHECK(lookup(t, "2001:dead::5") == -1);
+    CHECK(lookup(t, "2001:db8::5") == 1);
+
+    // a mask that is not a prefix
+    t.add(IP6Address(String("2001:0:1::")), IP6Address(String("ffff:0:ffff::")),
+	  IP6Address(), 10);
+    CHECK(lookup(t, "2001:abcd:1::1") == 10);
+    CHECK(lookup(t, "2001:abcd:2::1") == -1);
+    t.del(IP6Address(String("2001:0:1::")), IP6Address(String("ffff:0:ffff::")));
+    CHECK(lookup(t, "2001:abcd:1::1") == -1);
+
+    t.clear();
+    CHECK(lookup(t, "2001:db8::5") == -1);
+
+    // random routes against a linear search
+    Vector<Route> routes;
+    for (int i = 0; i < 300; ++i) {
+	Route r;
+	r.len = click_random(0, 96) + 32;
+	r.dst = random_address() & IP6Address::make_prefix(r.len);
+	r.index = i;
+	int j = 0;
+	while (j < routes.size()
+	       && (routes[j].len != r.len || routes[j].dst != r.dst))
+	    ++j;
+	if (j == routes.size())
+	    routes.push_back(r);
+	else
+	    routes[j] = r;
+	t.add(r.dst, IP6Address::make_prefix(r.len), IP6Address(), r.index);
+    }
+    for (int round = 0; round < 2; ++round) {
+	for (int i = 0; i < 2000; ++i) {
+	    IP6Address a = random_address();
+	    if (lookup(t, a) != linear_lookup(routes, a))
+		return errh->error("%s:%d: lookup of %s gave %d, expected %d", __FILE__, __LINE__, a.unparse().c_str(), lookup(t, a), linear_lookup(routes, a));
+	}
+	// delete every other route and check again
+	for (int i = routes.size() - 1; i >= 0; i -= 2) {
+	    t.del(routes[i].dst, IP6Address::make_prefix(routes[i].len));
+	    routes.erase(routes.begin() + i);
+	}
+    }
+
+    errh->message("All tests pass!");
+    return 0;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(ip6)
+EXPORT_ELEMENT(IP6TableTest)
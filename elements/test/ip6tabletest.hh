@@ -0,0 +1,38 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_IP6TABLETEST_HH
+#define CLICK_IP6TABLETEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+IP6TableTest()
+
+=s test
+
+runs regression tests for IP6Table
+
+=d
+
+IP6TableTest runs regression tests for IP6Table's longest-prefix-match
+lookup at initialization time: nested prefixes, default and host routes,
+prefixes that diverge in the middle of a byte, replacement, deletion, and
+masks that are not prefixes.  It also checks the table against a linear
+search over random routes.  It does not route packets.
+
+*/
+
+class IP6TableTest : public Element { public:
+
+    IP6TableTest();
+    ~IP6TableTest();
+
+    const char *class_name() const		{ return "IP6TableTest"; }
+
+    int initialize(ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
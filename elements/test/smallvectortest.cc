@@ -0,0 +1,161 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * smallvectortest.{cc,hh} -- regression test element for SmallVector
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "smallvectortest.hh"
+#include <click/smallvector.hh>
+#include <click/string.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+SmallVectorTest::SmallVectorTest()
+{
+}
+
+SmallVectorTest::~SmallVectorTest()
+{
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test `%s' failed", __FILE__, __LINE__, #x);
+
+// Strings, so that elements copied to the wrong place or not constructed
+// show; v must hold String(first), String(first + 1), ... String(last)
+typedef SmallVector<String, 4> SV;
+
+static int
+check_range(const SV &v, int first, int last, ErrorHandler *errh)
+{
+    CHECK(v.size() == last - first + 1);
+    CHECK(v.size() <= v.capacity());
+    CHECK(v.is_inline() == (v.capacity() == SV::INLINE_CAPACITY));
+    for (int i = 0; i < v.size(); i++)
+	CHECK(v[i] == String(first + i));
+    int n = 0;
+    for (SV::const_iterator i = v.begin(); i != v.end(); ++i, ++n)
+	CHECK(*i == String(first + n));
+    CHECK(n == v.size());
+    return 0;
+}
+
+static void
+fill(SV &v, int first, int last)
+{
+    v.clear();
+    for (int i = first; i <= last; i++)
+	v.push_back(String(i));
+}
+
+int
+SmallVectorTest::initialize(ErrorHandler *errh)
+{
+    // inline up to INLINE_CAPACITY elements, then on the heap
+    SV v;
+    CHECK(v.empty() && v.is_inline() && v.capacity() == 4);
+    for (int i = 0; i < 4; i++) {
+	v.push_back(String(i));
+	CHECK(v.is_inline());
+    }
+    CHECK(check_range(v, 0, 3, errh) == 0);
+    v.push_back(String(4));
+    CHECK(!v.is_inline() && v.capacity() > 4);
+    CHECK(check_range(v, 0, 4, errh) == 0);
+    for (int i = 5; i < 40; i++)
+	v.push_back(String(i));
+    CHECK(check_range(v, 0, 39, errh) == 0);
+
+    // copies, in both directions across the boundary
+    SV small, big;
+    fill(small, 0, 2);
+    fill(big, 10, 19);
+    {
+	SV c(small);
+	CHECK(c.is_inline());
+	CHECK(check_range(c, 0, 2, errh) == 0);
+	SV d(big);
+	CHECK(!d.is_inline());
+	CHECK(check_range(d, 10, 19, errh) == 0);
+	c = big;		// inline to heap
+	CHECK(!c.is_inline());
+	CHECK(check_range(c, 10, 19, errh) == 0);
+	d = small;		// heap to fewer than INLINE_CAPACITY
+	CHECK(check_range(d, 0, 2, errh) == 0);
+	d = d;
+	CHECK(check_range(d, 0, 2, errh) == 0);
+	c.assign(3, String("x"));
+	CHECK(c.size() == 3 && c[0] == "x" && c[2] == "x");
+	c.resize(6, String("y"));
+	CHECK(c.size() == 6 && c[2] == "x" && c[3] == "y" && c[5] == "y");
+	c.resize(1);
+	CHECK(c.size() == 1 && c[0] == "x");
+    }
+    CHECK(check_range(small, 0, 2, errh) == 0);
+    CHECK(check_range(big, 10, 19, errh) == 0);
+
+    // swap, inline with heap and inline with inline
+    small.swap(big);
+    CHECK(check_range(small, 10, 19, errh) == 0);
+    CHECK(check_range(big, 0, 2, errh) == 0);
+    SV other;
+    fill(other, 7, 8);
+    big.swap(other);
+    CHECK(check_range(big, 7, 8, errh) == 0);
+    CHECK(check_range(other, 0, 2, errh) == 0);
+
+    // insert and erase at both ends, crossing INLINE_CAPACITY (clear()
+    // keeps the heap buffer, so start from fresh vectors)
+    {
+	SV f;
+	fill(f, 1, 4);
+	CHECK(f.is_inline());
+	SV::iterator it = f.insert(f.begin(), String(0));
+	CHECK(it == f.begin() && !f.is_inline());
+	CHECK(check_range(f, 0, 4, errh) == 0);
+	SV b;
+	fill(b, 0, 3);
+	it = b.insert(b.end(), String(4));
+	CHECK(it == b.end() - 1 && !b.is_inline());
+	CHECK(check_range(b, 0, 4, errh) == 0);
+	SV p;
+	fill(p, 1, 4);
+	p.push_front(String(0));
+	CHECK(!p.is_inline());
+	CHECK(check_range(p, 0, 4, errh) == 0);
+    }
+    fill(v, 0, 4);
+    SV::iterator it;
+    v.push_front(String(-1));
+    CHECK(check_range(v, -1, 4, errh) == 0);
+    v.pop_front();
+    CHECK(check_range(v, 0, 4, errh) == 0);
+    it = v.erase(v.begin());
+    CHECK(it == v.begin());
+    CHECK(check_range(v, 1, 4, errh) == 0);
+    it = v.erase(v.end() - 1);
+    CHECK(it == v.end());
+    CHECK(check_range(v, 1, 3, errh) == 0);
+    v.pop_back();
+    CHECK(check_range(v, 1, 2, errh) == 0);
+    it = v.erase(v.begin(), v.end());
+    CHECK(it == v.end() && v.empty());
+    fill(v, 0, 2);
+    it = v.insert(v.begin() + 1, String("z"));
+    CHECK(*it == "z" && v.size() == 4 && v[0] == "0" && v[2] == "1" && v[3] == "2");
+
+    errh->message("All tests pass!");
+    return 0;
+}
+
+EXPORT_ELEMENT(SmallVectorTest)
+CLICK_ENDDECLS
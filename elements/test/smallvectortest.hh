@@ -0,0 +1,35 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SMALLVECTORTEST_HH
+#define CLICK_SMALLVECTORTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+SmallVectorTest()
+
+=s test
+
+runs regression tests for SmallVector
+
+=d
+
+SmallVectorTest runs SmallVector regression tests at initialization time. It
+does not route packets.
+
+*/
+
+class SmallVectorTest : public Element { public:
+
+    SmallVectorTest();
+    ~SmallVectorTest();
+
+    const char *class_name() const		{ return "SmallVectorTest"; }
+
+    int initialize(ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
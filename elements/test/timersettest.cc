@@ -0,0 +1,104 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * timersettest.{cc,hh} -- regression test element for timer scheduling order
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "timersettest.hh"
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+CLICK_DECLS
+
+TimerSetTest::TimerSetTest()
+    : _watchdog(this), _early(false)
+{
+    for (int i = 0; i < ntimers; ++i)
+	_timers[i].assign(this);
+}
+
+TimerSetTest::~TimerSetTest()
+{
+}
+
+int
+TimerSetTest::initialize(ErrorHandler *)
+{
+    for (int i = 0; i < ntimers; ++i)
+	_timers[i].initialize(this);
+    _watchdog.initialize(this);
+
+    // Offsets in milliseconds; those past 256 land in a higher level of the
+    // timer wheel, if there is one.
+    Timestamp now = Timestamp::now();
+    _timers[0].schedule_at(now + Timestamp::make_msec(40));
+    _timers[1].schedule_at(now + Timestamp::make_msec(10));
+    _timers[2].schedule_at(now + Timestamp::make_msec(300));
+    _timers[3].schedule_at(now - Timestamp::make_msec(5));
+    // 4 is unscheduled here, and scheduled again by 7's callback
+    _timers[4].schedule_at(now + Timestamp::make_msec(270));
+    _timers[4].unschedule();
+    // 5 moves earlier, 6 later
+    _timers[5].schedule_at(now + Timestamp::make_msec(400));
+    _timers[5].schedule_at(now + Timestamp::make_msec(20));
+    _timers[6].schedule_at(now + Timestamp::make_msec(15));
+    _timers[6].schedule_at(now + Timestamp::make_msec(280));
+    _timers[7].schedule_at(now + Timestamp::make_msec(120));
+    // 8 never fires
+    _timers[8].schedule_at(now + Timestamp::make_msec(50));
+    _timers[8].unschedule();
+
+    _watchdog.schedule_at(now + Timestamp(2, 0));
+    return 0;
+}
+
+void
+TimerSetTest::run_timer(Timer *t)
+{
+    if (t != &_watchdog) {
+	if (Timestamp::now() < t->expiry())
+	    _early = true;
+	_order.push_back(t - _timers);
+	if (t == &_timers[7])
+	    _timers[4].schedule_now();
+	if (_order.size() < nfired)
+	    return;
+    }
+    finish();
+}
+
+void
+TimerSetTest::finish()
+{
+    static const int expected[] = { 3, 1, 5, 0, 7, 4, 6, 2 };
+    ErrorHandler *errh = ErrorHandler::default_handler();
+
+    bool ok = _order.size() == nfired;
+    for (int i = 0; ok && i < nfired; ++i)
+	ok = _order[i] == expected[i];
+    if (!ok) {
+	StringAccum sa;
+	for (int i = 0; i < _order.size(); ++i)
+	    sa << (i ? " " : "") << _order[i];
+	errh->error("%s: timers fired in order %<%s%>", declaration().c_str(), sa.c_str());
+    } else if (_early)
+	errh->error("%s: timer fired before its expiry", declaration().c_str());
+    else
+	errh->message("All tests pass!");
+
+    _watchdog.unschedule();
+    router()->please_stop_driver();
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(TimerSetTest)
@@ -0,0 +1,51 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_TIMERSETTEST_HH
+#define CLICK_TIMERSETTEST_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+
+/*
+=c
+
+TimerSetTest()
+
+=s test
+
+runs regression tests for timer scheduling order
+
+=d
+
+TimerSetTest schedules a handful of timers out of order at initialization
+time, including timers due in the past, unscheduled and rescheduled timers,
+and a timer scheduled from another timer's callback.  As they fire it checks
+that they run in order of expiry and never before it.  When the last one has
+fired it reports the result and stops the driver.  It does not route packets.
+
+*/
+
+class TimerSetTest : public Element { public:
+
+    TimerSetTest();
+    ~TimerSetTest();
+
+    const char *class_name() const		{ return "TimerSetTest"; }
+
+    int initialize(ErrorHandler *);
+    void run_timer(Timer *);
+
+  private:
+
+    enum { ntimers = 9, nfired = ntimers - 1 };
+    Timer _timers[ntimers];
+    Timer _watchdog;
+    Vector<int> _order;
+    bool _early;
+
+    void finish();
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,80 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * stealingthreadsched.{cc,hh} -- work stealing between threads (SMP Click)
+ */
+
+#include <click/config.h>
+#include "stealingthreadsched.hh"
+#include <click/task.hh>
+#include <click/routerthread.hh>
+#include <click/master.hh>
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+StealingThreadSched::StealingThreadSched()
+{
+}
+
+StealingThreadSched::~StealingThreadSched()
+{
+}
+
+int
+StealingThreadSched::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _active = true;
+    if (cp_va_kparse(conf, this, errh,
+		     "ACTIVE", cpkP, cpBool, &_active,
+		     cpEnd) < 0)
+	return -1;
+    return 0;
+}
+
+int
+StealingThreadSched::initialize(ErrorHandler *)
+{
+    master()->set_task_stealing(_active);
+    return 0;
+}
+
+void
+StealingThreadSched::cleanup(CleanupStage)
+{
+    master()->set_task_stealing(false);
+}
+
+String
+StealingThreadSched::read_handler(Element *e, void *thunk)
+{
+    Master *m = e->master();
+    if (thunk)
+	return cp_unparse_bool(m->task_stealing());
+    StringAccum sa;
+    for (int tid = 0; tid < m->nthreads(); tid++)
+	sa << tid << ' ' << m->thread(tid)->tasks_given() << '\n';
+    return sa.take_string();
+}
+
+int
+StealingThreadSched::write_handler(const String &str, Element *e, void *, ErrorHandler *errh)
+{
+    StealingThreadSched *ts = static_cast<StealingThreadSched *>(e);
+    if (!cp_bool(cp_uncomment(str), &ts->_active))
+	return errh->error("expected boolean");
+    ts->master()->set_task_stealing(ts->_active);
+    return 0;
+}
+
+void
+StealingThreadSched::add_handlers()
+{
+    add_read_handler("active", read_handler, (void *) 1);
+    add_write_handler("active", write_handler, 0);
+    add_read_handler("given", read_handler, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(multithread)
+EXPORT_ELEMENT(StealingThreadSched)
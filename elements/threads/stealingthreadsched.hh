@@ -0,0 +1,57 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_STEALINGTHREADSCHED_HH
+#define CLICK_STEALINGTHREADSCHED_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+ * =c
+ * StealingThreadSched([ACTIVE])
+ * =s threads
+ * lets idle threads take tasks from busy ones
+ * =d
+ *
+ * Turns on work stealing between the threads of the Master. A thread that
+ * runs out of scheduled tasks asks for work, and the next busy thread to
+ * finish a round of tasks moves one of its runnable tasks, the one due to
+ * run last, to it. A busy thread always keeps the task it runs next. Tasks
+ * whose thread was set by a thread preference, such as StaticThreadSched,
+ * never move, nor do tasks already moving to another thread. A moved task
+ * stays on its new home thread, as with BalancedThreadSched.
+ *
+ * Unlike BalancedThreadSched, which rebalances by cycle counts at fixed
+ * intervals, work moves as soon as a thread is idle. Only threads 0 to 31
+ * take part. If ACTIVE is false, work stealing starts off. Default is true.
+ *
+ * =h active read/write
+ * Whether work stealing is on.
+ *
+ * =h given read-only
+ * For each thread, the number of tasks it has handed to idle threads.
+ *
+ * =a BalancedThreadSched, StaticThreadSched
+ */
+
+class StealingThreadSched : public Element { public:
+
+    StealingThreadSched();
+    ~StealingThreadSched();
+
+    const char *class_name() const	{ return "StealingThreadSched"; }
+    int configure(Vector<String> &, ErrorHandler *);
+
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+  private:
+
+    bool _active;
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,325 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * asyncchatter.{cc,hh} -- element writes chatter from a background thread
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding. */
+
+#include <click/config.h>
+#include "asyncchatter.hh"
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/percpu.hh>
+#include <unistd.h>
+CLICK_DECLS
+
+// orders loads and stores among themselves, but not a store before a load
+static inline void
+order_fence()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    asm volatile("" : : : "memory");
+#else
+    __sync_synchronize();
+#endif
+}
+
+class AsyncChatterErrorHandler : public ErrorVeneer { public:
+
+    AsyncChatterErrorHandler(AsyncChatter *ac, ErrorHandler *base)
+	: ErrorVeneer(base), _ac(ac) {
+    }
+
+    void *emit(const String &str, void *user_data, bool more);
+
+  private:
+
+    AsyncChatter *_ac;
+
+};
+
+void *
+AsyncChatterErrorHandler::emit(const String &str, void *user_data, bool)
+{
+    // Only the first line of a message carries its level; a non-null
+    // user_data marks the rest of a message written at once.
+    int level = el_info;
+    parse_anno(str, str.begin(), str.end(), "#<>", &level, (const char *) 0);
+    if (user_data || level <= el_error) {
+	// write it now, after what the rings already hold
+	_ac->empty();
+	_ac->base_errh()->emit(str, 0, false);
+	return this;
+    }
+    _ac->emit(str);
+    return 0;
+}
+
+
+static AsyncChatter *the_async_chatter;
+
+AsyncChatter::AsyncChatter()
+    : _errh(0), _base_errh(0), _buffer(0), _nrings(0), _messages(0),
+#if HAVE_MULTITHREAD
+      _stopping(false), _running(false),
+#endif
+      _timer(this)
+{
+}
+
+AsyncChatter::~AsyncChatter()
+{
+}
+
+int
+AsyncChatter::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t capacity = 65536;
+    _interval = Timestamp::make_msec(100);
+    _repeat_interval = Timestamp();
+    if (cp_va_kparse(conf, this, errh,
+		     "CAPACITY", 0, cpUnsigned, &capacity,
+		     "INTERVAL", 0, cpTimestamp, &_interval,
+		     "REPEAT_INTERVAL", 0, cpTimestamp, &_repeat_interval,
+		     cpEnd) < 0)
+	return -1;
+    if (capacity < 256 || capacity > 0x1000000)
+	return errh->error("CAPACITY must be between 256 and 16777216");
+    if (!_interval)
+	return errh->error("INTERVAL must be positive");
+    for (_capacity = 256; _capacity < capacity; _capacity *= 2)
+	/* nada */;
+    return 0;
+}
+
+int
+AsyncChatter::initialize(ErrorHandler *errh)
+{
+    if (the_async_chatter)
+	return errh->error("only one AsyncChatter may be configured");
+
+#if HAVE_MULTITHREAD
+    _nrings = NRINGS;
+#else
+    _nrings = 1;
+#endif
+    if (!(_buffer = new char[_nrings * _capacity]))
+	return errh->error("out of memory!");
+    for (int r = 0; r < NRINGS; r++)
+	_rings[r].head = _rings[r].tail = _rings[r].drops = _rings[r].repeats
+	    = _rings[r].last_repeats = 0;
+
+    the_async_chatter = this;
+    _base_errh = ErrorHandler::default_handler();
+    _errh = new AsyncChatterErrorHandler(this, _base_errh);
+    ErrorHandler::set_default_handler(_errh);
+
+#if HAVE_MULTITHREAD
+    _stopping = false;
+    if (pthread_create(&_thread, 0, thread_main, this) == 0)
+	_running = true;
+    else
+	errh->warning("cannot start thread, writing chatter from a timer");
+    if (!_running)
+#endif
+    {
+	_timer.initialize(this);
+	_timer.schedule_after(_interval);
+    }
+    return 0;
+}
+
+void
+AsyncChatter::cleanup(CleanupStage)
+{
+    if (the_async_chatter != this)
+	return;
+    if (ErrorHandler::default_handler() == _errh)
+	ErrorHandler::set_default_handler(_base_errh);
+#if HAVE_MULTITHREAD
+    if (_running) {
+	_stopping = true;
+	pthread_join(_thread, 0);
+	_running = false;
+    }
+#endif
+    empty();
+    delete _errh;
+    delete[] _buffer;
+    _errh = 0;
+    _buffer = 0;
+    the_async_chatter = 0;
+}
+
+#if HAVE_MULTITHREAD
+void *
+AsyncChatter::thread_main(void *arg)
+{
+    AsyncChatter *ac = static_cast<AsyncChatter *>(arg);
+    useconds_t usec = ac->_interval.usecval();
+    while (!ac->_stopping) {
+	usleep(usec);
+	ac->empty();
+    }
+    return 0;
+}
+#endif
+
+void
+AsyncChatter::run_timer(Timer *)
+{
+    empty();
+    _timer.reschedule_after(_interval);
+}
+
+inline int
+AsyncChatter::ring_index() const
+{
+#if HAVE_MULTITHREAD
+    unsigned n = click_percpu_thread();
+    return n < NRINGS - 1 ? n : NRINGS - 1;
+#else
+    return 0;
+#endif
+}
+
+bool
+AsyncChatter::fill(Ring &ring, char *buf, const String &line)
+{
+    // records are a 4-byte length followed by the line, padded to 4 bytes
+    uint32_t need = 4 + ((line.length() + 3) & ~3U);
+    uint32_t head = ring.head;
+    uint32_t used = head - ring.tail;
+    uint32_t offset = head & (_capacity - 1);
+    uint32_t skip = (_capacity - offset < need ? _capacity - offset : 0);
+    if (used + skip + need > _capacity) {
+	ring.drops++;
+	return false;
+    }
+    if (skip) {
+	*reinterpret_cast<uint32_t *>(buf + offset) = WRAP;
+	offset = 0;
+    }
+    *reinterpret_cast<uint32_t *>(buf + offset) = line.length();
+    memcpy(buf + offset + 4, line.data(), line.length());
+    order_fence();		// fill the record before publishing it
+    ring.head = head + skip + need;
+    return true;
+}
+
+void
+AsyncChatter::emit(const String &line)
+{
+    int r = ring_index();
+    Ring &ring = _rings[r];
+    char *buf = _buffer + r * _capacity;
+    bool shared = (r == NRINGS - 1);
+    if (shared)
+	ring.fill_lock.acquire();
+
+    Timestamp now;
+    if (_repeat_interval) {
+	now = Timestamp::now();
+	if (line == ring.last && now - ring.last_time < _repeat_interval) {
+	    ring.repeats++;
+	    ring.last_repeats++;
+	    goto out;
+	}
+	if (ring.last_repeats) {
+	    StringAccum sa;
+	    sa << "last message repeated " << ring.last_repeats << " times";
+	    fill(ring, buf, sa.take_string());
+	    ring.last_repeats = 0;
+	}
+    }
+    if (fill(ring, buf, line) && _repeat_interval) {
+	ring.last = line;
+	ring.last_time = now;
+    }
+
+  out:
+    if (shared)
+	ring.fill_lock.release();
+}
+
+void
+AsyncChatter::empty()
+{
+    Vector<String> lines;
+    _empty_lock.acquire();
+    for (int r = 0; r < _nrings; r++) {
+	Ring &ring = _rings[r];
+	char *buf = _buffer + r * _capacity;
+	uint32_t tail = ring.tail, head = ring.head;
+	order_fence();		// read the head before the records it covers
+	while (tail != head) {
+	    uint32_t offset = tail & (_capacity - 1);
+	    uint32_t len = *reinterpret_cast<uint32_t *>(buf + offset);
+	    if (len == WRAP)
+		tail += _capacity - offset;
+	    else {
+		lines.push_back(String(buf + offset + 4, len));
+		tail += 4 + ((len + 3) & ~3U);
+	    }
+	}
+	order_fence();		// copy the records out before freeing them
+	ring.tail = tail;
+    }
+    for (String *l = lines.begin(); l != lines.end(); ++l)
+	_base_errh->emit(*l, 0, false);
+    _messages += lines.size();
+    _empty_lock.release();
+}
+
+enum { H_MESSAGES, H_DROPS, H_REPEATS, H_FLUSH };
+
+String
+AsyncChatter::read_handler(Element *e, void *thunk)
+{
+    AsyncChatter *ac = static_cast<AsyncChatter *>(e);
+    uint32_t n = 0;
+    switch ((intptr_t) thunk) {
+      case H_MESSAGES:
+	n = ac->_messages;
+	break;
+      case H_DROPS:
+	for (int r = 0; r < NRINGS; r++)
+	    n += ac->_rings[r].drops;
+	break;
+      case H_REPEATS:
+	for (int r = 0; r < NRINGS; r++)
+	    n += ac->_rings[r].repeats;
+	break;
+    }
+    return String(n);
+}
+
+int
+AsyncChatter::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    AsyncChatter *ac = static_cast<AsyncChatter *>(e);
+    if (ac->_buffer)
+	ac->empty();
+    return 0;
+}
+
+void
+AsyncChatter::add_handlers()
+{
+    add_read_handler("messages", read_handler, (void *) H_MESSAGES);
+    add_read_handler("drops", read_handler, (void *) H_DROPS);
+    add_read_handler("repeats", read_handler, (void *) H_REPEATS);
+    add_write_handler("flush", write_handler, (void *) H_FLUSH);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(AsyncChatter)
@@ -0,0 +1,155 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_ASYNCCHATTER_HH
+#define CLICK_ASYNCCHATTER_HH
+#include <click/element.hh>
+#include <click/error.hh>
+#include <click/timer.hh>
+#include <click/sync.hh>
+#if HAVE_MULTITHREAD
+# include <pthread.h>
+#endif
+CLICK_DECLS
+
+/*
+=c
+
+AsyncChatter([I<keywords> CAPACITY, INTERVAL, REPEAT_INTERVAL])
+
+=s debugging
+
+writes chatter without stalling the router threads
+
+=d
+
+Takes over the default ErrorHandler, through which C<click_chatter> and most
+element messages go, so that the threads producing messages no longer write
+them to standard error themselves. Each thread copies its messages into a
+ring of its own, which only it fills, without locks; a background thread
+empties the rings every INTERVAL and writes the messages, in order for each
+thread, through the ErrorHandler it took over. A message that does not fit
+in its thread's ring is dropped and counted. Beyond 15 threads, the
+remaining threads share one ring, under a lock.
+
+Errors, and worse, are not deferred: they flush the rings and are written at
+once, so that the message of a fatal error is out before the exit it
+causes.
+
+With REPEAT_INTERVAL, a thread drops a message identical to its previous
+one when it comes within REPEAT_INTERVAL of the last copy written, and
+counts it; the next message that gets through is preceded by "last message
+repeated I<N> times".
+
+Without multithreading support there is no background thread: a timer
+empties the ring every INTERVAL, so writing still stalls the router thread,
+but once per INTERVAL rather than once per message.
+
+Only one AsyncChatter may be configured. The ErrorHandler it took over is
+called from the background thread, so a ChatterSocket should not be
+configured with it.
+
+Keyword arguments are:
+
+=over 8
+
+=item CAPACITY
+
+Unsigned. Bytes of each thread's ring, rounded up to a power of two. Default
+is 65536.
+
+=item INTERVAL
+
+Time. How often the rings are emptied. Default is 100 milliseconds.
+
+=item REPEAT_INTERVAL
+
+Time. Drop repeats of a message within this time of its last copy written.
+Default is 0, which never drops repeats.
+
+=back
+
+=h messages read-only
+
+Returns the number of messages written.
+
+=h drops read-only
+
+Returns the number of messages dropped because a ring was full.
+
+=h repeats read-only
+
+Returns the number of repeated messages dropped.
+
+=h flush write-only
+
+Writes out whatever the rings hold now.
+
+=a ChatterSocket */
+
+class AsyncChatter : public Element { public:
+
+    AsyncChatter();
+    ~AsyncChatter();
+
+    const char *class_name() const	{ return "AsyncChatter"; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+    int initialize(ErrorHandler *);
+    void cleanup(CleanupStage);
+    void add_handlers();
+
+    void run_timer(Timer *);
+
+    // called by the installed ErrorHandler
+    void emit(const String &line);
+    void empty();
+    ErrorHandler *base_errh() const	{ return _base_errh; }
+
+  private:
+
+    enum { NRINGS = 16, CACHE_LINE = 64 };
+    enum { WRAP = 0xFFFFFFFFU };	// record length: the rest of the ring is unused
+
+    struct Ring {
+	// filler side
+	volatile uint32_t head;		// bytes ever written
+	uint32_t drops;
+	uint32_t repeats;
+	uint32_t last_repeats;		// repeats of last since it was written
+	String last;			// last message written
+	Timestamp last_time;
+	Spinlock fill_lock;		// taken only on the shared ring
+	char pad0[CACHE_LINE];
+	// emptier side
+	volatile uint32_t tail;		// bytes ever emptied
+	char pad1[CACHE_LINE];
+    };
+
+    ErrorHandler *_errh;		// installed as the default handler
+    ErrorHandler *_base_errh;		// the default handler it replaced
+    char *_buffer;			// _nrings rings of _capacity bytes
+    int _nrings;
+    uint32_t _capacity;
+    Timestamp _interval;
+    Timestamp _repeat_interval;
+    Ring _rings[NRINGS];
+    Spinlock _empty_lock;		// held while emptying rings
+    uint32_t _messages;
+
+#if HAVE_MULTITHREAD
+    pthread_t _thread;
+    volatile bool _stopping;
+    bool _running;
+    static void *thread_main(void *);
+#endif
+    Timer _timer;
+
+    inline int ring_index() const;
+    bool fill(Ring &ring, char *buf, const String &line);
+
+    static String read_handler(Element *, void *);
+    static int write_handler(const String &, Element *, void *, ErrorHandler *);
+
+};
+
+CLICK_ENDDECLS
+#endif
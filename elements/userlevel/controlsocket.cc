@@ -33,7 +33,7 @@
 #include <fcntl.h>
 CLICK_DECLS
 
-const char ControlSocket::protocol_version[] = "1.3";
+const char ControlSocket::protocol_version[] = "1.4";
 
 struct ControlSocketErrorHandler : public ErrorHandler { public:
 
@@ -595,6 +595,37 @@ ControlSocket::llrpc_command(int fd, const String &llrpcname, String data)
   return 0;
 }
 
+int
+ControlSocket::batch_command(int fd, const Vector<String> &requests, bool write)
+{
+  // Run each request as its own command, then send back their responses,
+  // in order, as the data of one response.  The handlers are all called
+  // from this one call, so no other command runs between them.
+  String out = _out_texts[fd];
+  StringAccum sa;
+  for (int i = 0; i < requests.size(); i++) {
+    _out_texts[fd] = String();
+    if (write) {
+      const String &req = requests[i];
+      const char *s = req.begin();
+      while (s != req.end() && !isspace((unsigned char) *s))
+	s++;
+      String hname = req.substring(req.begin(), s);
+      while (s != req.end() && isspace((unsigned char) *s))
+	s++;
+      write_command(fd, hname, req.substring(s, req.end()));
+    } else
+      read_command(fd, requests[i], String());
+    sa << _out_texts[fd];
+  }
+  _out_texts[fd] = out;
+
+  message(fd, CSERR_OK, String(write ? "Write" : "Read") + " batch of " + String(requests.size()) + " handlers OK");
+  _out_texts[fd] += "DATA " + String(sa.length()) + "\r\n";
+  _out_texts[fd] += sa.take_string();
+  return 0;
+}
+
 int
 ControlSocket::parse_command(int fd, const String &line)
 {
@@ -680,6 +711,43 @@ ControlSocket::parse_command(int fd, const String &line)
       else
 	  return write_command(fd, words[1], data);
 
+  } else if (command == "READMANY") {
+      if (words.size() < 2)
+	  return message(fd, CSERR_SYNTAX, "Wrong number of arguments");
+      words.pop_front();
+      return batch_command(fd, words, false);
+
+  } else if (command == "WRITEMANYDATA") {
+      if (words.size() != 2)
+	  return message(fd, CSERR_SYNTAX, "Wrong number of arguments");
+      int datalen;
+      if (!cp_integer(words[1], &datalen) || datalen < 0)
+	  return message(fd, CSERR_SYNTAX, "Syntax error in '%s'", command.c_str());
+      if (_in_texts[fd].length() < datalen) {
+	  if (_flags[fd] & READ_CLOSED)
+	      return message(fd, CSERR_SYNTAX, "Not enough data");
+	  else			// retry
+	      return 1;
+      }
+      String data = _in_texts[fd].substring(0, datalen);
+      _in_texts[fd] = _in_texts[fd].substring(datalen);
+      // one write per nonblank line, without trailing spaces
+      Vector<String> requests;
+      const char *s = data.begin();
+      while (s != data.end()) {
+	  const char *linebegin = s, *lineend = s;
+	  for (; s != data.end() && *s != '\n' && *s != '\r'; ++s)
+	      if (!isspace((unsigned char) *s))
+		  lineend = s + 1;
+	  while (linebegin != lineend && isspace((unsigned char) *linebegin))
+	      ++linebegin;
+	  if (linebegin != lineend)
+	      requests.push_back(data.substring(linebegin, lineend));
+	  if (s != data.end())
+	      ++s;
+      }
+      return batch_command(fd, requests, true);
+
   } else if (command == "CHECKREAD" || command == "CHECKWRITE") {
     if (words.size() != 2)
       return message(fd, CSERR_SYNTAX, "Wrong number of arguments");
@@ -717,6 +785,8 @@ ControlSocket::parse_command(int fd, const String &line)
     message(fd, CSERR_OK, "WRITE handler [arg...]  call write handler", true);
     message(fd, CSERR_OK, "WRITEDATA handler len   call write handler, pass len data bytes", true);
     message(fd, CSERR_OK, "WRITEUNTIL handler term call write handler, take data until term", true);
+    message(fd, CSERR_OK, "READMANY handler...     call read handlers, return their responses as DATA", true);
+    message(fd, CSERR_OK, "WRITEMANYDATA len       call write handlers, one 'handler value' per line of len data bytes", true);
     message(fd, CSERR_OK, "CHECKREAD handler       check if read handler is valid", true);
     message(fd, CSERR_OK, "CHECKWRITE handler      check if write handler is valid", true);
     message(fd, CSERR_OK, "LLRPC elt#number [len]  call LLRPC, pass len data bytes, return DATA", true);
@@ -38,8 +38,8 @@ The server will accept lines terminated by CR, LF, or CRLF. Its response
 lines are always terminated by CRLF.
 
 When a connection is opened, the server responds by stating its protocol
-version number with a line like "Click::ControlSocket/1.3". The current
-version number is 1.3. Changes in minor version number will only add commands
+version number with a line like "Click::ControlSocket/1.4". The current
+version number is 1.4. Changes in minor version number will only add commands
 and functionality to this specification, not change existing functionality.
 
 ControlSocket supports hot-swapping, meaning you can change configurations
@@ -149,6 +149,26 @@ following (the CRLF that terminates) the WRITEDATA line.
 Call a write I<handler>. The arguments to pass are the read from the input
 stream, stopping at the first line that equals I<terminator>.
 
+=item READMANY I<handler...>
+
+Call each read I<handler>, in order and without parameters, in one go, so
+that no other command runs between them. Responds with a "success" message
+followed by a line "DATA I<n>", as in the READ command. The I<n> bytes that
+follow are the responses the READ command would have sent for each
+I<handler>, one after the other, each with its own message line and, on
+success, its own "DATA" line. A handler that fails thus reports its error in
+its response without failing the others. Introduced in version 1.4 of the
+ControlSocket protocol.
+
+=item WRITEMANYDATA I<n>
+
+Call several write handlers in one go. The I<n> bytes immediately following
+(the CRLF that terminates) the WRITEMANYDATA line hold one write per line,
+each a I<handler> name followed by the arguments to pass; blank lines are
+skipped, and trailing spaces removed. Responds as READMANY does, with the
+responses the WRITE command would have sent for each write. Introduced in
+version 1.4 of the ControlSocket protocol.
+
 =item CHECKREAD I<handler>
 
 Checks whether a I<handler> exists and is readable. The return status is 200
@@ -292,6 +312,7 @@ class ControlSocket : public Element { public:
     int write_command(int fd, const String &, String);
     int check_command(int fd, const String &, bool write);
     int llrpc_command(int fd, const String &, String);
+    int batch_command(int fd, const Vector<String> &, bool write);
     int parse_command(int fd, const String &);
     void flush_write(int fd, bool read_needs_processing);
 
@@ -42,13 +42,16 @@
 # include <net/if.h>
 # include <features.h>
 # if __GLIBC__ >= 2 && __GLIBC_MINOR__ >= 1
-#  include <netpacket/packet.h>
+// <linux/if_packet.h>, unlike <netpacket/packet.h>, defines the receive
+// ring; the two conflict
+#  include <linux/if_packet.h>
 #  include <net/ethernet.h>
 # else
 #  include <net/if_packet.h>
 #  include <linux/if_packet.h>
 #  include <linux/if_ether.h>
 # endif
+# include <sys/mman.h>
 #endif
 
 CLICK_DECLS
@@ -56,7 +59,7 @@ CLICK_DECLS
 FromDevice::FromDevice()
     :
 #if FROMDEVICE_LINUX
-      _linux_fd(-1),
+      _linux_fd(-1), _ring(0), _ring_frames(0), _burst(1),
 #endif
 #if FROMDEVICE_PCAP
       _pcap(0), _pcap_task(this), _pcap_complaints(0),
@@ -78,6 +81,7 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     _headroom += (4 - (_headroom + 2) % 4) % 4; // default 4/2 alignment
     _force_ip = false;
     String bpf_filter, capture;
+    unsigned ring = 0, burst = 0;
     if (cp_va_kparse(conf, this, errh,
 		     "DEVNAME", cpkP+cpkM, cpString, &_ifname,
 		     "PROMISC", cpkP, cpBool, &promisc,
@@ -88,6 +92,8 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 		     "BPF_FILTER", 0, cpString, &bpf_filter,
 		     "OUTBOUND", 0, cpBool, &outbound,
 		     "HEADROOM", 0, cpUnsigned, &_headroom,
+		     "RING", 0, cpUnsigned, &ring,
+		     "BURST", 0, cpUnsigned, &burst,
 		     cpEnd) < 0)
 	return -1;
     if (_snaplen > 8190 || _snaplen < 14)
@@ -124,6 +130,14 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 
     if (bpf_filter && _capture != CAPTURE_PCAP)
 	errh->warning("not using PCAP capture method, BPF filter ignored");
+#if FROMDEVICE_LINUX
+    if (_capture == CAPTURE_LINUX) {
+	_ring_frames = ring;
+	_burst = (burst ? burst : (ring ? 32 : 1));
+    } else
+#endif
+    if (ring || burst)
+	errh->warning("not using LINUX capture method, RING and BURST ignored");
 
     _sniffer = sniffer;
     _promisc = promisc;
@@ -201,6 +215,41 @@ FromDevice::set_promiscuous(int fd, String ifname, bool promisc)
 
     return was_promisc;
 }
+
+int
+FromDevice::setup_ring(ErrorHandler *errh)
+{
+#if defined(PACKET_RX_RING) && defined(TPACKET_HDRLEN)
+    // A frame holds the tpacket_hdr and the sockaddr_ll, then the packet,
+    // whose network header the kernel aligns to 16 bytes.  Frames don't
+    // cross blocks, whose size must be a power-of-two number of pages.
+    _ring_frame_size = TPACKET_ALIGN(TPACKET_HDRLEN + 16 + _snaplen);
+    _ring_block_size = getpagesize();
+    while (_ring_block_size < _ring_frame_size)
+	_ring_block_size *= 2;
+    _ring_block_frames = _ring_block_size / _ring_frame_size;
+    unsigned blocks = (_ring_frames + _ring_block_frames - 1) / _ring_block_frames;
+    _ring_frames = blocks * _ring_block_frames;
+
+    struct tpacket_req req;
+    req.tp_block_size = _ring_block_size;
+    req.tp_block_nr = blocks;
+    req.tp_frame_size = _ring_frame_size;
+    req.tp_frame_nr = _ring_frames;
+    if (setsockopt(_linux_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+	return errh->error("%s: PACKET_RX_RING: %s", _ifname.c_str(), strerror(errno));
+
+    _ring_size = (size_t) blocks * _ring_block_size;
+    void *ring = mmap(0, _ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, _linux_fd, 0);
+    if (ring == MAP_FAILED)
+	return errh->error("%s: mmap: %s", _ifname.c_str(), strerror(errno));
+    _ring = (unsigned char *) ring;
+    _ring_pos = 0;
+    return 0;
+#else
+    return errh->error("%s: this platform does not support RING", _ifname.c_str());
+#endif
+}
 #endif /* FROMDEVICE_LINUX */
 
 int
@@ -291,6 +340,9 @@ FromDevice::initialize(ErrorHandler *errh)
 	} else
 	    _was_promisc = promisc_ok;
 
+	if (_ring_frames && setup_ring(errh) < 0)
+	    return -1;
+
 	add_select(_linux_fd, SELECT_READ);
 
 	_datalink = FAKE_DLT_EN10MB;
@@ -310,6 +362,10 @@ FromDevice::cleanup(CleanupStage stage)
     if (stage >= CLEANUP_INITIALIZED && !_sniffer)
 	KernelFilter::device_filter(_ifname, false, ErrorHandler::default_handler());
 #if FROMDEVICE_LINUX
+    if (_ring) {
+	munmap(_ring, _ring_size);
+	_ring = 0;
+    }
     if (_linux_fd >= 0) {
 	if (_was_promisc >= 0)
 	    set_promiscuous(_linux_fd, _ifname, _was_promisc);
@@ -352,6 +408,7 @@ FromDevice_get_packet(u_char* clientdata,
     p->set_mac_header(p->data());
     SET_EXTRA_LENGTH_ANNO(p, pkthdr->len - length);
 
+    fd->_count++;
     if (!fd->_force_ip || fake_pcap_force_ip(p, fd->_datalink))
 	fd->output(0).push(p);
     else
@@ -376,6 +433,19 @@ FromDevice::selected(int)
 #endif
 #if FROMDEVICE_LINUX
     if (_capture == CAPTURE_LINUX) {
+	if (_ring)
+	    read_ring();
+	else
+	    read_socket();
+    }
+#endif
+}
+
+#if FROMDEVICE_LINUX
+void
+FromDevice::read_socket()
+{
+    for (unsigned n = 0; n < _burst; n++) {
 	struct sockaddr_ll sa;
 	socklen_t fromlen = sizeof(sa);
 	WritablePacket *p = Packet::make(_headroom, 0, _snaplen, 0);
@@ -389,19 +459,66 @@ FromDevice::selected(int)
 	    p->set_packet_type_anno((Packet::PacketType)sa.sll_pkttype);
 	    p->timestamp_anno().set_timeval_ioctl(_linux_fd, SIOCGSTAMP);
 	    p->set_mac_header(p->data());
+	    _count++;
 	    if (!_force_ip || fake_pcap_force_ip(p, _datalink))
 		output(0).push(p);
 	    else
 		checked_output_push(1, p);
 	} else {
 	    p->kill();
-	    if (len <= 0 && errno != EAGAIN)
-		click_chatter("FromDevice(%s): recvfrom: %s", _ifname.c_str(), strerror(errno));
+	    if (len <= 0) {
+		if (errno != EAGAIN)
+		    click_chatter("FromDevice(%s): recvfrom: %s", _ifname.c_str(), strerror(errno));
+		break;
+	    }
 	}
     }
-#endif
 }
 
+void
+FromDevice::read_ring()
+{
+# if defined(PACKET_RX_RING) && defined(TPACKET_HDRLEN)
+    // Copy up to _burst packets out of the frames the kernel has filled,
+    // then hand those frames back all at once.
+    unsigned first = _ring_pos, n;
+    for (n = 0; n < _burst; n++) {
+	unsigned char *frame = ring_frame((first + n) % _ring_frames);
+	struct tpacket_hdr *h = reinterpret_cast<struct tpacket_hdr *>(frame);
+	if (!(h->tp_status & TP_STATUS_USER))
+	    break;
+	// read the frame only after its status
+	__sync_synchronize();
+
+	const sockaddr_ll *sa = reinterpret_cast<const sockaddr_ll *>(frame + TPACKET_ALIGN(sizeof(struct tpacket_hdr)));
+	if (sa->sll_pkttype == PACKET_OUTGOING && !_outbound)
+	    continue;
+	// the kernel only truncates to the frame, which can hold a little more
+	uint32_t len = (h->tp_snaplen > (uint32_t) _snaplen ? _snaplen : h->tp_snaplen);
+	WritablePacket *p = Packet::make(_headroom, frame + h->tp_mac, len, 0);
+	if (!p)
+	    continue;
+	if (h->tp_len > len)
+	    SET_EXTRA_LENGTH_ANNO(p, h->tp_len - len);
+	p->set_packet_type_anno((Packet::PacketType)sa->sll_pkttype);
+	p->set_timestamp_anno(Timestamp::make_usec(h->tp_sec, h->tp_usec));
+	p->set_mac_header(p->data());
+	_count++;
+	if (!_force_ip || fake_pcap_force_ip(p, _datalink))
+	    output(0).push(p);
+	else
+	    checked_output_push(1, p);
+    }
+
+    // the copies are done before the kernel may write the frames again
+    __sync_synchronize();
+    for (unsigned i = 0; i < n; i++)
+	reinterpret_cast<struct tpacket_hdr *>(ring_frame((first + i) % _ring_frames))->tp_status = TP_STATUS_KERNEL;
+    _ring_pos = (first + n) % _ring_frames;
+# endif
+}
+#endif
+
 #if FROMDEVICE_PCAP
 bool
 FromDevice::run_task(Task *)
@@ -449,6 +566,13 @@ FromDevice::read_handler(Element* e, void *thunk)
 	    return "??";
     } else if (thunk == (void *) 1)
 	return String(fake_pcap_unparse_dlt(fd->_datalink));
+#if FROMDEVICE_LINUX
+    else if (thunk == (void *) 3) {
+	if (!fd->_ring)
+	    return "0";
+	return String(fd->_ring_frames) + " " + String(fd->_ring_frame_size);
+    }
+#endif
     else
 	return String(fd->_count);
 }
@@ -467,6 +591,9 @@ FromDevice::add_handlers()
     add_read_handler("kernel_drops", read_handler, (void *) 0);
     add_read_handler("encap", read_handler, (void *) 1);
     add_read_handler("count", read_handler, (void *) 2);
+#if FROMDEVICE_LINUX
+    add_read_handler("ring", read_handler, (void *) 3);
+#endif
     add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
 }
 
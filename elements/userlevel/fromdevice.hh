@@ -24,7 +24,7 @@ CLICK_DECLS
 
 =c
 
-FromDevice(DEVNAME [, I<keywords> SNIFFER, PROMISC, SNAPLEN, FORCE_IP, CAPTURE, BPF_FILTER, OUTBOUND, HEADROOM])
+FromDevice(DEVNAME [, I<keywords> SNIFFER, PROMISC, SNAPLEN, FORCE_IP, CAPTURE, BPF_FILTER, OUTBOUND, HEADROOM, RING, BURST])
 
 =s netdevices
 
@@ -103,6 +103,20 @@ false.
 Integer. Amount of bytes of headroom to leave before the packet data. Defaults
 to roughly 28.
 
+=item RING
+
+Unsigned.  With the LINUX capture method, the number of SNAPLEN-sized frames
+in a memory-mapped receive ring (PACKET_RX_RING) shared with the kernel.  The
+kernel writes packets into the ring without a system call per packet;
+FromDevice copies each one into a new packet and hands the frames back to the
+kernel after every burst.  The ring is rounded up to whole pages.  Default is
+0, which reads every packet with its own recvfrom call.
+
+=item BURST
+
+Unsigned.  With the LINUX capture method, the maximum number of packets read
+each time the device becomes readable.  Default is 1, or 32 with a RING.
+
 =back
 
 =e
@@ -117,6 +131,11 @@ FromDevice sets packets' extra length annotations as appropriate.
 
 Returns the number of packets read by the device.
 
+=h ring read-only
+
+Returns the number of frames in the receive ring and their size, or 0 if
+there is no ring.
+
 =h reset_counts write-only
 
 Resets "count" to zero.
@@ -170,6 +189,19 @@ class FromDevice : public Element { public:
 #if FROMDEVICE_LINUX
     int _linux_fd;
     unsigned char *_linux_packetbuf;
+    unsigned char *_ring;
+    size_t _ring_size;
+    unsigned _ring_frames;
+    unsigned _ring_frame_size;
+    unsigned _ring_block_frames;	// frames per block
+    unsigned _ring_block_size;
+    unsigned _ring_pos;		// next frame to read
+    unsigned _burst;
+
+    int setup_ring(ErrorHandler *);
+    inline unsigned char *ring_frame(unsigned pos) const;
+    void read_ring();
+    void read_socket();
 #endif
 #if FROMDEVICE_PCAP
     pcap_t* _pcap;
@@ -221,5 +253,14 @@ FromDevice::fd() const
     return -1;
 }
 
+#if FROMDEVICE_LINUX
+inline unsigned char *
+FromDevice::ring_frame(unsigned pos) const
+{
+    return _ring + (pos / _ring_block_frames) * _ring_block_size
+	+ (pos % _ring_block_frames) * _ring_frame_size;
+}
+#endif
+
 CLICK_ENDDECLS
 #endif
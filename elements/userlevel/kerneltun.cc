@@ -27,6 +27,9 @@
 #include <click/glue.hh>
 #include <clicknet/ether.h>
 #include <click/standard/scheduleinfo.hh>
+#include <click/percpu.hh>
+#include <click/master.hh>
+#include <clicknet/ip.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -66,8 +69,20 @@
 
 CLICK_DECLS
 
+// struct virtio_net_hdr, in host byte order
+struct click_vnet_hdr {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;	// checksum the packet from here on...
+    uint16_t csum_offset;	// ...and store the result here, past csum_start
+};
+enum { VNET_HDR_F_NEEDS_CSUM = 1, VNET_HDR_GSO_NONE = 0 };
+
 KernelTun::KernelTun()
-    : _fd(-1), _tap(false), _task(this), _ignore_q_errs(false),
+    : _fd(-1), _nqueues(1), _burst(1), _vnet_hdr(false),
+      _tap(false), _task(this), _ignore_q_errs(false),
       _printed_write_err(false), _printed_read_err(false)
 {
 }
@@ -104,7 +119,10 @@ KernelTun::configure(Vector<String> &conf, ErrorHandler *errh)
 #if KERNELTUN_LINUX
 		     "DEV_NAME", cpkD, cpString, &_dev_name, // deprecated
 		     "DEVNAME", 0, cpString, &_dev_name,
+		     "QUEUES", 0, cpUnsigned, &_nqueues,
+		     "VNET_HDR", 0, cpBool, &_vnet_hdr,
 #endif
+		     "BURST", 0, cpUnsigned, &_burst,
 		    cpEnd) < 0)
 	return -1;
 
@@ -125,6 +143,23 @@ KernelTun::configure(Vector<String> &conf, ErrorHandler *errh)
 	return errh->error("HEADROOM too big");
     else
 	_adjust_headroom = !_adjust_headroom;
+    if (_burst < 1)
+	return errh->error("BURST must be positive");
+    if (_nqueues < 1 || _nqueues > MAX_QUEUES)
+	return errh->error("QUEUES must be between 1 and %d", MAX_QUEUES);
+#if KERNELTUN_LINUX && !defined(IFF_MULTI_QUEUE)
+    if (_nqueues > 1)
+	return errh->error("QUEUES not supported by this system's tun driver");
+#endif
+#if KERNELTUN_LINUX && !defined(IFF_VNET_HDR)
+    if (_vnet_hdr)
+	return errh->error("VNET_HDR not supported by this system's tun driver");
+#endif
+
+    // tasks exist before add_handlers() so they have handlers
+    if (_nqueues > 1)
+	for (int q = 0; q < _nqueues; q++)
+	    _queue_tasks.push_back(new Task(this));
     return 0;
 }
 
@@ -132,25 +167,53 @@ KernelTun::configure(Vector<String> &conf, ErrorHandler *errh)
 int
 KernelTun::try_linux_universal(ErrorHandler *errh)
 {
-    int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
-    if (fd < 0)
-	return -errno;
+    // each queue of a multi-queue device is a TUNSETIFF on a file of its own
+    String dev_name = _dev_name;
+    Vector<int> fds;
+    for (int q = 0; q < _nqueues; q++) {
+	int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+	if (fd < 0) {
+	    int error = -errno;
+	    for (int i = 0; i < fds.size(); i++)
+		close(fds[i]);
+	    return error;
+	}
+	fds.push_back(fd);
 
-    struct ifreq ifr;
-    memset(&ifr, 0, sizeof(ifr));
-    ifr.ifr_flags = (_tap ? IFF_TAP : IFF_TUN);
-    if (_dev_name)
-	// Setting ifr_name allows us to select an arbitrary interface name.
-	strncpy(ifr.ifr_name, _dev_name.c_str(), sizeof(ifr.ifr_name));
-    int err = ioctl(fd, TUNSETIFF, (void *)&ifr);
-    if (err < 0) {
-	errh->warning("Linux universal tun failed: %s", strerror(errno));
-	close(fd);
-	return -errno;
+	struct ifreq ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = (_tap ? IFF_TAP : IFF_TUN);
+#ifdef IFF_MULTI_QUEUE
+	if (_nqueues > 1)
+	    ifr.ifr_flags |= IFF_MULTI_QUEUE;
+#endif
+#ifdef IFF_VNET_HDR
+	if (_vnet_hdr)
+	    ifr.ifr_flags |= IFF_VNET_HDR;
+#endif
+	if (dev_name)
+	    // Setting ifr_name allows us to select an arbitrary interface name.
+	    strncpy(ifr.ifr_name, dev_name.c_str(), sizeof(ifr.ifr_name));
+	int err = ioctl(fd, TUNSETIFF, (void *)&ifr);
+	if (err < 0) {
+	    int error = -errno;
+	    errh->warning("Linux universal tun failed: %s", strerror(errno));
+	    for (int i = 0; i < fds.size(); i++)
+		close(fds[i]);
+	    return error;
+	}
+	dev_name = ifr.ifr_name;
+
+#if defined(IFF_VNET_HDR) && defined(TUNSETOFFLOAD)
+	// we complete checksums the kernel leaves to us
+	if (_vnet_hdr && q == 0 && ioctl(fd, TUNSETOFFLOAD, TUN_F_CSUM) < 0)
+	    errh->warning("TUNSETOFFLOAD failed: %s", strerror(errno));
+#endif
     }
 
-    _dev_name = ifr.ifr_name;
-    _fd = fd;
+    _dev_name = dev_name;
+    _fds.swap(fds);
+    _fd = _fds[0];
     _type = LINUX_UNIVERSAL;
     return 0;
 }
@@ -166,6 +229,8 @@ KernelTun::try_tun(const String &dev_name, ErrorHandler *)
 
     _dev_name = dev_name;
     _fd = fd;
+    _fds.clear();
+    _fds.push_back(fd);
     return 0;
 }
 
@@ -401,23 +466,27 @@ KernelTun::setup_tun(ErrorHandler *errh)
 
     // calculate maximum packet size needed to receive data from
     // tun/tap.
+    if (_type == LINUX_UNIVERSAL && _vnet_hdr)
+	_mtu_in = VNET_HDR_LEN;
+    else
+	_mtu_in = 0;
     if (_tap) {
 	if (_type == LINUX_UNIVERSAL)
-	    _mtu_in = _mtu_out + 18;
+	    _mtu_in += _mtu_out + 18;
 	else if (_type == LINUX_ETHERTAP)
-	    _mtu_in = _mtu_out + 16;
+	    _mtu_in += _mtu_out + 16;
 	else
-	    _mtu_in = _mtu_out + 14;
+	    _mtu_in += _mtu_out + 14;
     } else if (_type == LINUX_UNIVERSAL)
-	_mtu_in = _mtu_out + 4;
+	_mtu_in += _mtu_out + 4;
     else if (_type == BSD_TUN)
-	_mtu_in = _mtu_out + 4;
+	_mtu_in += _mtu_out + 4;
     else if (_type == BSD_TAP || _type == NETBSD_TAP || _type == NETBSD_TUN)
-	_mtu_in = _mtu_out;
+	_mtu_in += _mtu_out;
     else if (_type == OSX_TUN)
-	_mtu_in = _mtu_out + 4; // + 0?
+	_mtu_in += _mtu_out + 4; // + 0?
     else /* _type == LINUX_ETHERTAP */
-	_mtu_in = _mtu_out + 16;
+	_mtu_in += _mtu_out + 16;
 
     return 0;
 }
@@ -427,6 +496,8 @@ KernelTun::initialize(ErrorHandler *errh)
 {
     if (alloc_tun(errh) < 0)
 	return -1;
+    if ((_nqueues > 1 || _vnet_hdr) && _type != LINUX_UNIVERSAL)
+	return errh->error("QUEUES and VNET_HDR require the Linux universal tun driver");
     if (setup_tun(errh) < 0)
 	return -1;
     if (input_is_pull(0)) {
@@ -434,54 +505,119 @@ KernelTun::initialize(ErrorHandler *errh)
 	_signal = Notifier::upstream_empty_signal(this, 0, &_task);
     }
     if (_adjust_headroom) {
+	// align the IP header past the virtio_net and Ethernet headers
+	unsigned skip = (_type == LINUX_UNIVERSAL && _vnet_hdr ? VNET_HDR_LEN : 0);
 	if (_tap && _type == LINUX_UNIVERSAL)
-	    _headroom += (4 - (_headroom + 2) % 4) % 4; // default 4/2 alignment
-	else
-	    _headroom += (4 - _headroom % 4) % 4; // default 4/0 alignment
+	    skip += 2;		// default 4/2 alignment
+	_headroom += (4 - (_headroom + skip) % 4) % 4;
     }
-    add_select(_fd, SELECT_READ);
+    for (int q = 0; q < _queue_tasks.size(); q++) {
+	_queue_tasks[q]->initialize(this, false);
+	_queue_tasks[q]->move_thread(q % master()->nthreads());
+    }
+    for (int q = 0; q < _fds.size(); q++)
+	add_select(_fds[q], SELECT_READ);
     return 0;
 }
 
 void
 KernelTun::cleanup(CleanupStage)
 {
+    for (int q = 0; q < _queue_tasks.size(); q++)
+	delete _queue_tasks[q];
+    _queue_tasks.clear();
     if (_fd >= 0) {
 	if (_type != LINUX_UNIVERSAL && _type != NETBSD_TAP)
 	    updown(0, ~0, ErrorHandler::default_handler());
-	close(_fd);
-	remove_select(_fd, SELECT_READ);
+	for (int q = 0; q < _fds.size(); q++) {
+	    close(_fds[q]);
+	    remove_select(_fds[q], SELECT_READ);
+	}
+	_fds.clear();
+	_fd = -1;
     }
 }
 
 void
 KernelTun::selected(int fd)
 {
+    if (_queue_tasks.size()) {
+	// hand the queue to its task, which reads it on its home thread
+	for (int q = 0; q < _fds.size(); q++)
+	    if (_fds[q] == fd) {
+		remove_select(fd, SELECT_READ);
+		_queue_tasks[q]->reschedule();
+	    }
+	return;
+    }
     if (fd != _fd)
 	return;
+    for (int n = 0; n < _burst && read_packet(fd); n++)
+	/* nada */;
+}
+
+/*
+ * Strips the virtio_net header off p, and completes the checksum the kernel
+ * may have left to us.
+ */
+bool
+KernelTun::vnet_input(WritablePacket *p)
+{
+    if (p->length() < VNET_HDR_LEN)
+	return false;
+    click_vnet_hdr vh;
+    memcpy(&vh, p->data(), VNET_HDR_LEN);
+    p->pull(VNET_HDR_LEN);
+    if (vh.gso_type != VNET_HDR_GSO_NONE)
+	return false;
+    if (vh.flags & VNET_HDR_F_NEEDS_CSUM) {
+	// the checksum field holds the pseudo-header sum
+	if ((uint32_t) vh.csum_start + vh.csum_offset + 2 > p->length())
+	    return false;
+	uint16_t sum = click_in_cksum(p->data() + vh.csum_start, p->length() - vh.csum_start);
+	memcpy(p->data() + vh.csum_start + vh.csum_offset, &sum, 2);
+    }
+    return true;
+}
+
+/*
+ * Reads one packet from fd and emits it. Returns false if there was nothing
+ * to read.
+ */
+bool
+KernelTun::read_packet(int fd)
+{
     WritablePacket *p = Packet::make(_headroom, 0, _mtu_in, 0);
     if (!p) {
 	click_chatter("out of memory!");
-	return;
+	return false;
     }
 
-    int cc = read(_fd, p->data(), _mtu_in);
+    int cc = read(fd, p->data(), _mtu_in);
     if (cc > 0) {
 	p->take(_mtu_in - cc);
 	bool ok = false;
 
+	// with VNET_HDR, the virtio_net header follows the 4-byte packet info
+	uint16_t etype = 0;
+	if (_type == LINUX_UNIVERSAL) {
+	    etype = *(uint16_t *)(p->data() + 2);
+	    p->pull(4);
+	    if (_vnet_hdr && !vnet_input(p)) {
+		checked_output_push(1, p);
+		return true;
+	    }
+	}
+
 	if (_tap) {
-	    if (_type == LINUX_UNIVERSAL)
-		// 2-byte padding, 2-byte Ethernet type, then Ethernet header
-		p->pull(4);
-	    else if (_type == LINUX_ETHERTAP)
+	    // LINUX_UNIVERSAL: 2-byte padding, 2-byte Ethernet type, then
+	    // Ethernet header, already pulled
+	    if (_type == LINUX_ETHERTAP)
 		// 2-byte padding, then Ethernet header
 		p->pull(2);
 	    ok = true;
 	} else if (_type == LINUX_UNIVERSAL) {
-	    // 2-byte padding followed by an Ethernet type
-	    uint16_t etype = *(uint16_t *)(p->data() + 2);
-	    p->pull(4);
+	    // 2-byte padding followed by an Ethernet type, already pulled
 	    if (etype != htons(ETHERTYPE_IP) && etype != htons(ETHERTYPE_IP6))
 		checked_output_push(1, p->clone());
 	    else
@@ -512,25 +648,49 @@ KernelTun::selected(int fd)
 	    output(0).push(p);
 	} else
 	    checked_output_push(1, p);
+	return true;
 
     } else {
-	if (!_ignore_q_errs || !_printed_read_err || (errno != ENOBUFS)) {
+	if ((cc == 0 || errno != EAGAIN)
+	    && (!_ignore_q_errs || !_printed_read_err || (errno != ENOBUFS))) {
 	    _printed_read_err = true;
 	    perror("KernelTun read");
 	}
+	p->kill();
+	return false;
     }
 }
 
 bool
-KernelTun::run_task(Task *)
+KernelTun::run_task(Task *task)
 {
-    Packet *p = input(0).pull();
-    if (p)
+    if (task != &_task) {
+	// read a queue of a multi-queue device
+	int q = 0;
+	while (_queue_tasks[q] != task)
+	    q++;
+	int n = 0;
+	while (n < _burst && read_packet(_fds[q]))
+	    n++;
+	if (n == _burst)
+	    task->fast_reschedule();
+	else
+	    add_select(_fds[q], SELECT_READ);
+	return n > 0;
+    }
+
+    int n = 0;
+    while (n < _burst) {
+	Packet *p = input(0).pull();
+	if (!p)
+	    break;
 	push(0, p);
-    else if (!_signal)
+	n++;
+    }
+    if (!n && !_signal)
 	return false;
     _task.fast_reschedule();
-    return p != 0;
+    return n > 0;
 }
 
 void
@@ -572,13 +732,17 @@ KernelTun::push(int, Packet *p)
 	goto kill;
     }
 
+    // with VNET_HDR, an empty virtio_net header follows the packet info
     WritablePacket *q;
+    int vnet_len = (_vnet_hdr ? VNET_HDR_LEN : 0);
     if (_tap) {
 	if (_type == LINUX_UNIVERSAL) {
 	    // 2-byte padding, 2-byte Ethernet type, then Ethernet header
 	    uint16_t ethertype = ((const click_ether *) p->data())->ether_type;
-	    if ((q = p->push(4)))
+	    if ((q = p->push(4 + vnet_len))) {
 		((uint16_t *) q->data())[1] = ethertype;
+		memset(q->data() + 4, 0, vnet_len);
+	    }
 	    p = q;
 	} else if (_type == LINUX_ETHERTAP) {
 	    // 2-byte padding, then Ethernet header
@@ -589,8 +753,10 @@ KernelTun::push(int, Packet *p)
     } else if (_type == LINUX_UNIVERSAL) {
 	// 2-byte padding followed by an Ethernet type
 	uint32_t ethertype = (iph->ip_v == 4 ? htonl(ETHERTYPE_IP) : htonl(ETHERTYPE_IP6));
-	if ((q = p->push(4)))
+	if ((q = p->push(4 + vnet_len))) {
 	    *(uint32_t *)(q->data()) = ethertype;
+	    memset(q->data() + 4, 0, vnet_len);
+	}
 	p = q;
     } else if (_type == BSD_TUN) {
 	uint32_t af = (iph->ip_v == 4 ? htonl(AF_INET) : htonl(AF_INET6));
@@ -613,7 +779,13 @@ KernelTun::push(int, Packet *p)
     }
 
     if (p) {
-	int w = write(_fd, p->data(), p->length());
+	// each thread writes to a queue of its own, if there are enough
+	int fd = _fd;
+#if HAVE_MULTITHREAD
+	if (_fds.size() > 1)
+	    fd = _fds[click_percpu_thread() % _fds.size()];
+#endif
+	int w = write(fd, p->data(), p->length());
 	if (w != (int) p->length() && (errno != ENOBUFS || !_ignore_q_errs || !_printed_write_err)) {
 	    _printed_write_err = true;
 	    click_chatter("%s(%s): write failed: %s", class_name(), _dev_name.c_str(), strerror(errno));
@@ -636,6 +808,8 @@ KernelTun::add_handlers()
     if (input_is_pull(0))
 	add_task_handlers(&_task);
     add_read_handler("dev_name", print_dev_name, 0);
+    for (int q = 0; q < _queue_tasks.size(); q++)
+	add_task_handlers(_queue_tasks[q], "queue" + String(q) + "_");
 }
 
 CLICK_ENDDECLS
@@ -10,7 +10,7 @@ CLICK_DECLS
 /*
 =c
 
-KernelTun(ADDR/MASK [, GATEWAY, I<keywords> HEADROOM, ETHER, MTU, IGNORE_QUEUE_OVERFLOWS])
+KernelTun(ADDR/MASK [, GATEWAY, I<keywords> HEADROOM, ETHER, MTU, IGNORE_QUEUE_OVERFLOWS, QUEUES, BURST, VNET_HDR])
 
 =s comm
 
@@ -69,8 +69,41 @@ String. If specified, try to alloc a tun device with name DEVNAME.
 Otherwise, we'll just take the first virtual device we find. This option
 only works with the Linux Universal TUN/TAP driver.
 
+=item BURST
+
+Unsigned integer. The number of packets to read from the device each time
+it is readable, and to pull from the input each time the task runs. Default
+is 1.
+
+=item QUEUES
+
+Unsigned integer. The number of queues to open on the device, at most 64.
+With more than one, the device is multi-queue (IFF_MULTI_QUEUE): the kernel
+spreads the packets it sends to Click over the queues by flow, and each queue
+is read by a task of its own, whose home thread is the queue number modulo
+the number of threads. KernelTun may therefore push to its outputs from
+several threads at once. Packets are written to a queue chosen by the
+writing thread. This option only works with the Linux Universal TUN/TAP
+driver. Default is 1.
+
+=item VNET_HDR
+
+Boolean. If true, exchange packets with the kernel behind a virtio_net header
+(IFF_VNET_HDR), and let the kernel send packets whose checksums are left
+for Click to complete, which KernelTun does as it reads them. Segmentation
+offload is not enabled, so packets never exceed the MTU. This option only
+works with the Linux Universal TUN/TAP driver. Default is false.
+
 =back
 
+=h dev_name read-only
+
+Returns the name of the device.
+
+=h queueI<N>_home_thread read/write
+
+With more than one queue, the home thread of the task reading queue I<N>.
+
 =n
 
 Make sure that your kernel has tun support enabled before running
@@ -124,11 +157,16 @@ class KernelTun : public Element { public:
 
   private:
 
-    enum { DEFAULT_MTU = 1500 };
+    enum { DEFAULT_MTU = 1500, MAX_QUEUES = 64, VNET_HDR_LEN = 10 };
     enum Type { LINUX_UNIVERSAL, LINUX_ETHERTAP, BSD_TUN, BSD_TAP, OSX_TUN,
 		NETBSD_TUN, NETBSD_TAP };
 
     int _fd;
+    Vector<int> _fds;		// all queues, _fd first
+    Vector<Task *> _queue_tasks;	// read each queue if more than one
+    int _nqueues;
+    int _burst;
+    bool _vnet_hdr;
     int _mtu_in;
     int _mtu_out;
     Type _type;
@@ -156,6 +194,8 @@ class KernelTun : public Element { public:
     int alloc_tun(ErrorHandler *);
     int setup_tun(ErrorHandler *);
     int updown(IPAddress, IPAddress, ErrorHandler *);
+    bool read_packet(int fd);
+    bool vnet_input(WritablePacket *);
 
     friend class KernelTap;
 
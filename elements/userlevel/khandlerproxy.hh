@@ -54,7 +54,7 @@ Interaction example:
   Trying 127.0.0.1...
   Connected to localhost.
   Escape character is '^]'.
-  Click::ControlSocket/1.3
+  Click::ControlSocket/1.4
   READ list
   200 Read handler 'list' OK
   DATA 4
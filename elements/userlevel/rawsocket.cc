@@ -43,12 +43,18 @@
 
 #include "fakepcap.hh"
 
+// recvmmsg() and sendmmsg(), as of Linux 2.6.33 and 3.0 and glibc 2.14
+#if defined(MSG_WAITFORONE) && defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14))
+# define HAVE_RAWSOCKET_MMSG 1
+#endif
+
 CLICK_DECLS
 
 RawSocket::RawSocket()
   : _task(this), _timer(this),
     _fd(-1), _port(0), _proper(false), _snaplen(2048),
-    _headroom(Packet::default_headroom), _rq(0), _wq(0)
+    _headroom(Packet::default_headroom), _rq(0), _wq(0), _burst(1)
 {
 }
 
@@ -72,10 +78,20 @@ RawSocket::configure(Vector<String> &conf, ErrorHandler *errh)
 		   "SNAPLEN", 0, cpUnsigned, &_snaplen,
 		   "HEADROOM", 0, cpUnsigned, &_headroom,
 		   "PROPER", 0, cpBool, &_proper,
+		   "BURST", 0, cpUnsigned, &_burst,
 		   cpEnd) < 0)
     return -1;
   socktype = socktype.upper();
 
+  if (_burst < 1 || _burst > MAX_BURST)
+    return errh->error("BURST must be between 1 and %d", MAX_BURST);
+#if !HAVE_RAWSOCKET_MMSG
+  if (_burst > 1) {
+    errh->warning("BURST not supported on this platform");
+    _burst = 1;
+  }
+#endif
+
   if (socktype == "TCP")
     _protocol = IPPROTO_TCP;
   else if (socktype == "UDP")
@@ -162,6 +178,13 @@ RawSocket::cleanup(CleanupStage)
     _rq->kill();
   if (_wq)
     _wq->kill();
+  for (int i = 0; i < _rqs.size(); i++)
+    if (_rqs[i])
+      _rqs[i]->kill();
+  _rqs.clear();
+  for (int i = 0; i < _wqs.size(); i++)
+    _wqs[i]->kill();
+  _wqs.clear();
   if (_fd >= 0) {
     close(_fd);
     remove_select(_fd, SELECT_READ | SELECT_WRITE);
@@ -176,8 +199,12 @@ RawSocket::selected(int fd)
   int len;
 
   if (noutputs()) {
+    // read a burst of packets
+    if (_burst > 1)
+      receive_burst(errh);
+
     // read data from socket
-    if (!_rq)
+    if (!_rq && _burst == 1)
       _rq = Packet::make(_headroom, (const unsigned char *)0, _snaplen, 0);
     if (_rq) {
       len = recv(_fd, _rq->data(), _rq->length(), MSG_TRUNC);
@@ -204,7 +231,10 @@ RawSocket::selected(int fd)
     }
   }
 
-  if (ninputs()) {
+  if (ninputs() && _burst > 1)
+    send_burst(errh);
+
+  else if (ninputs()) {
     // write data to socket
     Packet *p;
     if (_wq) {
@@ -235,10 +265,7 @@ RawSocket::selected(int fd)
 	    if (errno == ENOBUFS || errno == EAGAIN) {
 	      // socket queue full, try again later
 	      _wq = p;
-	      remove_select(_fd, SELECT_WRITE);
-	      _events &= ~SELECT_WRITE;
-	      _backoff = (!_backoff) ? 1 : _backoff*2;
-	      _timer.schedule_after(Timestamp::make_usec(_backoff));
+	      back_off();
 	      return;
 	    } else if (errno == EINTR) {
 	      // interrupted by signal, try again immediately
@@ -265,10 +292,147 @@ RawSocket::selected(int fd)
   }
 }
 
+void
+RawSocket::back_off()
+{
+  remove_select(_fd, SELECT_WRITE);
+  _events &= ~SELECT_WRITE;
+  _backoff = (!_backoff) ? 1 : _backoff*2;
+  _timer.schedule_after(Timestamp::make_usec(_backoff));
+}
+
+/*
+ * Receives up to _burst packets with one recvmmsg() and emits them.
+ */
+void
+RawSocket::receive_burst(ErrorHandler *errh)
+{
+#if HAVE_RAWSOCKET_MMSG
+  struct mmsghdr msgs[MAX_BURST];
+  struct iovec iov[MAX_BURST];
+
+  // buffers not used by the last burst are still there
+  _rqs.resize(_burst, 0);
+  int n;
+  for (n = 0; n < _burst; n++) {
+    if (!_rqs[n] && !(_rqs[n] = Packet::make(_headroom, (const unsigned char *)0, _snaplen, 0)))
+      break;
+    iov[n].iov_base = _rqs[n]->data();
+    iov[n].iov_len = _rqs[n]->length();
+    memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+    msgs[n].msg_hdr.msg_iov = &iov[n];
+    msgs[n].msg_hdr.msg_iovlen = 1;
+  }
+  if (n == 0)
+    return;
+
+  n = recvmmsg(_fd, msgs, n, MSG_TRUNC, 0);
+  if (n < 0) {
+    if (errno != EAGAIN)
+      errh->error("recvmmsg: %s", strerror(errno));
+    return;
+  }
+
+  Timestamp stamp;
+  if (n > 0)
+    (void) ioctl(_fd, SIOCGSTAMP, &stamp);
+  for (int i = 0; i < n; i++) {
+    int len = msgs[i].msg_len;
+    if (len <= 0)
+      continue;			// keep the buffer
+    WritablePacket *p = _rqs[i];
+    _rqs[i] = 0;
+    if (len > _snaplen) {
+      assert(p->length() == (uint32_t)_snaplen);
+      SET_EXTRA_LENGTH_ANNO(p, len - _snaplen);
+    } else
+      p->take(_snaplen - len);
+    p->timestamp_anno() = stamp;
+    // set IP annotations
+    if (fake_pcap_force_ip(p, FAKE_DLT_RAW))
+      output(0).push(p);
+    else
+      p->kill();
+  }
+#else
+  (void) errh;
+#endif
+}
+
+/*
+ * Pulls packets up to _burst and sends them with one sendmmsg(); those the
+ * socket did not take wait for the next call.
+ */
+void
+RawSocket::send_burst(ErrorHandler *errh)
+{
+#if HAVE_RAWSOCKET_MMSG
+  while (_wqs.size() < _burst) {
+    Packet *p = input(0).pull();
+    if (!p)
+      break;
+    // cast to int so very large plen is interpreted as negative
+    if ((int)p->length() < (int)sizeof(click_ip)) {
+      errh->error("runt IP packet (%d bytes)", p->length());
+      p->kill();
+    } else
+      _wqs.push_back(p);
+  }
+
+  if (_wqs.empty()) {
+    // nothing to write, wait for upstream signal
+    if (!_signal && (_events & SELECT_WRITE)) {
+      remove_select(_fd, SELECT_WRITE);
+      _events &= ~SELECT_WRITE;
+    }
+    return;
+  }
+
+  struct mmsghdr msgs[MAX_BURST];
+  struct iovec iov[MAX_BURST];
+  struct sockaddr_in sin[MAX_BURST];
+  for (int i = 0; i < _wqs.size(); i++) {
+    // set up destination
+    memset(&sin[i], 0, sizeof(sin[i]));
+    sin[i].sin_family = PF_INET;
+    sin[i].sin_addr = ((const click_ip *) _wqs[i]->data())->ip_dst;
+    iov[i].iov_base = const_cast<unsigned char *>(_wqs[i]->data());
+    iov[i].iov_len = _wqs[i]->length();
+    memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+    msgs[i].msg_hdr.msg_name = &sin[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(sin[i]);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int n;
+  do {
+    n = sendmmsg(_fd, msgs, _wqs.size(), 0);
+  } while (n < 0 && errno == EINTR);
+
+  if (n < 0 && errno != ENOBUFS && errno != EAGAIN) {
+    // unexpected error: drop the first packet
+    errh->error("sendmmsg: %s", strerror(errno));
+    n = 1;
+  }
+  if (n > 0) {
+    for (int i = 0; i < n; i++)
+      _wqs[i]->kill();
+    _wqs.erase(_wqs.begin(), _wqs.begin() + n);
+    _backoff = 0;
+  }
+  if (_wqs.size())
+    // socket queue full, try again later
+    back_off();
+#else
+  (void) errh;
+#endif
+}
+
 void
 RawSocket::run_timer(Timer *)
 {
-  if ((_wq || _signal) && !(_events & SELECT_WRITE) && _fd >= 0) {
+  if ((_wq || _wqs.size() || _signal) && !(_events & SELECT_WRITE) && _fd >= 0) {
     add_select(_fd, SELECT_WRITE);
     _events |= SELECT_WRITE;
     selected(_fd);
@@ -278,7 +442,7 @@ RawSocket::run_timer(Timer *)
 bool
 RawSocket::run_task(Task *)
 {
-  if (!_wq && !(_events & SELECT_WRITE) && _fd >= 0) {
+  if (!_wq && !_wqs.size() && !(_events & SELECT_WRITE) && _fd >= 0) {
     add_select(_fd, SELECT_WRITE);
     _events |= SELECT_WRITE;
     selected(_fd);
@@ -51,6 +51,14 @@ by this element. This could be useful for encapsulation protocols
 which add headers to the packet, and can avoid expensive push
 operations later in the packet's life.
 
+=item BURST
+
+Unsigned integer, at most 64. Number of packets to receive with one
+recvmmsg() call, and to send with one sendmmsg() call. Buffers left
+unused by a burst are kept for the next one. Packets received in one burst
+share the timestamp of the last of them. Default is 1, which uses recv()
+and sendto().
+
 =back
 
 =e
@@ -96,7 +104,15 @@ private:
   Packet *_wq;			// queue to store pulled packet for when sendto() blocks
   int _events;			// keeps track of the events for which select() is waiting
 
+  enum { MAX_BURST = 64 };
+  int _burst;			// packets per recvmmsg() and sendmmsg()
+  Vector<WritablePacket *> _rqs; // buffers to receive a burst into
+  Vector<Packet *> _wqs;	// pulled packets not sent yet
+
   int initialize_socket_error(ErrorHandler *, const char *);
+  void receive_burst(ErrorHandler *);
+  void send_burst(ErrorHandler *);
+  void back_off();
 
 };
 
@@ -37,6 +37,12 @@
 #include <proper/prop.h>
 #endif
 
+// recvmmsg() and sendmmsg(), as of Linux 2.6.33 and 3.0 and glibc 2.14
+#if defined(__linux__) && defined(MSG_WAITFORONE) && defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14))
+# define HAVE_SOCKET_MMSG 1
+#endif
+
 CLICK_DECLS
 
 Socket::Socket()
@@ -45,7 +51,8 @@ Socket::Socket()
     _local_port(0), _local_pathname(""),
     _timestamp(true), _sndbuf(-1), _rcvbuf(-1),
     _snaplen(2048), _headroom(Packet::default_headroom), _nodelay(1),
-    _verbose(false), _client(false), _proper(false), _allow(0), _deny(0)
+    _verbose(false), _client(false), _proper(false), _allow(0), _deny(0),
+    _burst(1)
 {
 }
 
@@ -78,9 +85,13 @@ Socket::configure(Vector<String> &conf, ErrorHandler *errh)
 		"PROPER", 0, cpBool, &_proper,
 		"ALLOW", 0, cpElement, &allow,
 		"DENY", 0, cpElement, &deny,
+		"BURST", 0, cpUnsigned, &_burst,
 		cpEnd) < 0)
     return -1;
 
+  if (_burst < 1 || _burst > MAX_BURST)
+    return errh->error("BURST must be between 1 and %d", MAX_BURST);
+
   if (allow && !(_allow = (IPRouteTable *)allow->cast("IPRouteTable")))
     return errh->error("%s is not an IPRouteTable", allow->name().c_str());
 
@@ -126,6 +137,17 @@ Socket::configure(Vector<String> &conf, ErrorHandler *errh)
   else
     return errh->error("unknown socket type `%s'", socktype.c_str());
 
+  if (_burst > 1 && _socktype != SOCK_DGRAM) {
+    errh->warning("BURST applies to datagram sockets only");
+    _burst = 1;
+  }
+#if !HAVE_SOCKET_MMSG
+  if (_burst > 1) {
+    errh->warning("BURST not supported on this platform");
+    _burst = 1;
+  }
+#endif
+
   return 0;
 }
 
@@ -283,6 +305,13 @@ Socket::cleanup(CleanupStage)
     _rq->kill();
   if (_wq)
     _wq->kill();
+  for (int i = 0; i < _rqs.size(); i++)
+    if (_rqs[i])
+      _rqs[i]->kill();
+  _rqs.clear();
+  for (int i = 0; i < _wqs.size(); i++)
+    _wqs[i]->kill();
+  _wqs.clear();
   if (_fd >= 0) {
     // shut down the listening socket in case we forked
 #ifdef SHUT_RDWR
@@ -366,8 +395,16 @@ Socket::selected(int fd)
       _events = SELECT_READ | SELECT_WRITE;
     }
 
+    // read a burst of datagrams
+    if (_burst > 1 && receive_burst() < 0 && errno != EAGAIN) {
+      if (_verbose)
+	click_chatter("%s: %s", declaration().c_str(), strerror(errno));
+      close_active();
+      return;
+    }
+
     // read data from socket
-    if (!_rq)
+    if (!_rq && _burst == 1)
       _rq = Packet::make(_headroom, 0, _snaplen, 0);
     if (_rq) {
       if (_socktype == SOCK_STREAM)
@@ -471,6 +508,158 @@ Socket::write_packet(Packet *p)
   return 0;
 }
 
+/*
+ * Receives up to _burst datagrams with one recvmmsg() and emits them.
+ * Returns the number received, or -1 with errno set.
+ */
+int
+Socket::receive_burst()
+{
+#if HAVE_SOCKET_MMSG
+  struct mmsghdr msgs[MAX_BURST];
+  struct iovec iov[MAX_BURST];
+  union { struct sockaddr_in in; struct sockaddr_un un; } from[MAX_BURST];
+
+  // buffers not used by the last burst are still there
+  _rqs.resize(_burst, 0);
+  int n;
+  for (n = 0; n < _burst; n++) {
+    if (!_rqs[n] && !(_rqs[n] = Packet::make(_headroom, 0, _snaplen, 0)))
+      break;
+    iov[n].iov_base = _rqs[n]->data();
+    iov[n].iov_len = _rqs[n]->length();
+    memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+    msgs[n].msg_hdr.msg_iov = &iov[n];
+    msgs[n].msg_hdr.msg_iovlen = 1;
+    if (!_client) {
+      // datagram server, find out who we are talking to
+      msgs[n].msg_hdr.msg_name = &from[n];
+      msgs[n].msg_hdr.msg_namelen = sizeof(from[n]);
+    }
+  }
+  if (n == 0) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  n = recvmmsg(_active, msgs, n, MSG_TRUNC, 0);
+  if (n <= 0)
+    return n;
+
+  Timestamp now;
+  if (_timestamp)
+    now.set_now();
+
+  for (int i = 0; i < n; i++) {
+    int len = msgs[i].msg_len;
+    if (!_client) {
+      if (_family == AF_INET && !allowed(IPAddress(from[i].in.sin_addr))) {
+	if (_verbose)
+	  click_chatter("%s: dropped datagram from %s:%d", declaration().c_str(),
+			IPAddress(from[i].in.sin_addr).unparse().c_str(), ntohs(from[i].in.sin_port));
+	continue;		// keep the buffer
+      }
+      memcpy(&_remote, &from[i], msgs[i].msg_hdr.msg_namelen);
+      _remote_len = msgs[i].msg_hdr.msg_namelen;
+    }
+
+    WritablePacket *p = _rqs[i];
+    _rqs[i] = 0;
+    if (len > _snaplen) {
+      // truncate packet to max length (should never happen)
+      assert(p->length() == (uint32_t)_snaplen);
+      SET_EXTRA_LENGTH_ANNO(p, len - _snaplen);
+    } else
+      p->take(_snaplen - len);
+    if (_timestamp)
+      p->timestamp_anno() = now;
+    output(0).push(p);
+  }
+  return n;
+#else
+  errno = EOPNOTSUPP;
+  return -1;
+#endif
+}
+
+/*
+ * Pulls datagrams up to _burst, sends them with one sendmmsg(), and keeps
+ * those the socket did not take for the next call. Returns true if it
+ * sent any.
+ */
+bool
+Socket::send_burst()
+{
+#if HAVE_SOCKET_MMSG
+  while (_wqs.size() < _burst)
+    if (Packet *p = input(0).pull())
+      _wqs.push_back(p);
+    else
+      break;
+  if (_wqs.empty()) {
+    // wrote all we could and no more pending
+    remove_select(_active, SELECT_WRITE);
+    return false;
+  }
+
+  struct mmsghdr msgs[MAX_BURST];
+  struct iovec iov[MAX_BURST];
+  struct sockaddr_in to[MAX_BURST];
+  bool to_anno = !IPAddress(_remote_ip) && _client && _family == AF_INET;
+  for (int i = 0; i < _wqs.size(); i++) {
+    iov[i].iov_base = const_cast<unsigned char *>(_wqs[i]->data());
+    iov[i].iov_len = _wqs[i]->length();
+    memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (to_anno) {
+      // send each packet to its IP destination annotation address
+      to[i] = _remote.in;
+      to[i].sin_addr = _wqs[i]->dst_ip_anno();
+      msgs[i].msg_hdr.msg_name = &to[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(to[i]);
+    } else {
+      msgs[i].msg_hdr.msg_name = &_remote;
+      msgs[i].msg_hdr.msg_namelen = _remote_len;
+    }
+  }
+
+  int n;
+  do {
+    n = sendmmsg(_active, msgs, _wqs.size(), 0);
+  } while (n < 0 && errno == EINTR);
+
+  if (n < 0 && errno != ENOBUFS && errno != EAGAIN) {
+    // connection probably terminated or other fatal error
+    if (_verbose)
+      click_chatter("%s: %s", declaration().c_str(), strerror(errno));
+    for (int i = 0; i < _wqs.size(); i++)
+      _wqs[i]->kill();
+    _wqs.clear();
+    close_active();
+    return false;
+  }
+
+  if (n > 0) {
+    for (int i = 0; i < n; i++)
+      _wqs[i]->kill();
+    _wqs.erase(_wqs.begin(), _wqs.begin() + n);
+  }
+
+  if (_wqs.size())
+    // send the rest when the socket becomes available
+    add_select(_active, SELECT_WRITE);
+  else if (_signal)
+    // more pending
+    _task.fast_reschedule();
+  else
+    remove_select(_active, SELECT_WRITE);
+  return n > 0;
+#else
+  return false;
+#endif
+}
+
 void
 Socket::push(int, Packet *p)
 {
@@ -507,6 +696,9 @@ Socket::run_task(Task *)
   assert(ninputs() && input_is_pull(0));
   bool any = false;
 
+  if (_active >= 0 && _burst > 1)
+    return send_burst();
+
   if (_active >= 0) {
     Packet *p = 0;
     int err = 0;
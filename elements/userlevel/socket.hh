@@ -142,6 +142,17 @@ Boolean. PlanetLab specific. If true and Click has been configured
 
 Integer. Per-packet headroom. Defaults to 28.
 
+=item BURST
+
+Unsigned integer, at most 64. Applies to datagram sockets on Linux only.
+Number of datagrams to receive with one recvmmsg() call, and, if the input
+is pull, to send with one sendmmsg() call. Pushed packets are still sent
+one at a time. Buffers left unused by a burst are kept for the next one,
+so a burst only allocates as many packets as the previous one emitted;
+with SNAPLEN plus HEADROOM at most 2048, the packet pool supplies them.
+Datagrams received in one burst share one timestamp. Default is 1, which
+uses recv() and sendto().
+
 =back
 
 =e
@@ -193,6 +204,8 @@ class Socket : public Element { public:
   void close_active(void);
   int write_packet(Packet*);
 
+  enum { MAX_BURST = 64 };
+
 protected:
   Task _task;
   Timer _timer;
@@ -238,7 +251,13 @@ private:
   IPRouteTable *_allow;		// lookup table of good hosts
   IPRouteTable *_deny;		// lookup table of bad hosts
 
+  int _burst;			// datagrams per recvmmsg() and sendmmsg()
+  Vector<WritablePacket *> _rqs; // buffers to receive a burst into
+  Vector<Packet *> _wqs;	// pulled datagrams not sent yet
+
   int initialize_socket_error(ErrorHandler *, const char *);
+  int receive_burst();
+  bool send_burst();
 
 };
 
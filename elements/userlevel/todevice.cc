@@ -57,8 +57,11 @@ CLICK_DECLS
 
 ToDevice::ToDevice()
   : _task(this), _timer(&_task), _fd(-1), _my_fd(false),
-    _q(0),
-    _pulls(0)
+    _q(0), _burst(1),
+#if TODEVICE_SENDMMSG
+    _batch(0), _nbatch(0), _msgs(0), _iovs(0),
+#endif
+    _backoff(0), _pulls(0)
 {
 }
 
@@ -73,10 +76,19 @@ ToDevice::configure(Vector<String> &conf, ErrorHandler *errh)
   if (cp_va_kparse(conf, this, errh,
 		   "DEVNAME", cpkP+cpkM, cpString, &_ifname,
 		   "DEBUG", 0, cpBool, &_debug,
+		   "BURST", 0, cpUnsigned, &_burst,
 		   cpEnd) < 0)
     return -1;
   if (!_ifname)
     return errh->error("interface not set");
+  if (_burst < 1)
+    return errh->error("BURST must be positive");
+#if !TODEVICE_SENDMMSG
+  if (_burst > 1) {
+    errh->warning("BURST not supported on this platform, using 1");
+    _burst = 1;
+  }
+#endif
   return 0;
 }
 
@@ -143,6 +155,21 @@ ToDevice::initialize(ErrorHandler *errh)
     return errh->error("duplicate writer for device `%s'", _ifname.c_str());
   used = this;
 
+#if TODEVICE_SENDMMSG
+  if (_burst > 1) {
+    _batch = new Packet *[_burst];
+    _msgs = new struct mmsghdr[_burst];
+    _iovs = new struct iovec[_burst];
+    if (!_batch || !_msgs || !_iovs)
+      return errh->error("out of memory");
+    memset(_msgs, 0, sizeof(struct mmsghdr) * _burst);
+    for (unsigned i = 0; i < _burst; i++) {
+      _msgs[i].msg_hdr.msg_iov = &_iovs[i];
+      _msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+#endif
+
   ScheduleInfo::join_scheduler(this, &_task, errh);
   _signal = Notifier::upstream_empty_signal(this, 0, &_task);
   return 0;
@@ -154,6 +181,17 @@ ToDevice::cleanup(CleanupStage)
   if (_fd >= 0 && _my_fd)
     close(_fd);
   _fd = -1;
+#if TODEVICE_SENDMMSG
+  for (unsigned i = 0; i < _nbatch; i++)
+    _batch[i]->kill();
+  _nbatch = 0;
+  delete[] _batch;
+  delete[] _msgs;
+  delete[] _iovs;
+  _batch = 0;
+  _msgs = 0;
+  _iovs = 0;
+#endif
 }
 
 
@@ -167,9 +205,31 @@ ToDevice::cleanup(CleanupStage)
  * timer if buffers are not available.
  * --jbicket
  */
+void
+ToDevice::back_off()
+{
+    if (!_backoff) {
+	_backoff = 1;
+	add_select(_fd, SELECT_WRITE);
+    } else {
+	_timer.schedule_after(Timestamp::make_usec(_backoff));
+	if (_backoff < 32768)
+	    _backoff *= 2;
+	if (_debug) {
+	    Timestamp now = Timestamp::now();
+	    click_chatter("%{element} backing off for %d at %{timestamp}\n", this, _backoff, &now);
+	}
+    }
+}
+
 bool
 ToDevice::run_task(Task *)
 {
+#if TODEVICE_SENDMMSG
+    if (_burst > 1)
+	return run_burst();
+#endif
+
     Packet *p = _q;
     _q = 0;
     if (!p) {
@@ -198,20 +258,7 @@ ToDevice::run_task(Task *)
 	} else if (errno == ENOBUFS || errno == EAGAIN) {
 	    assert(!_q);
 	    _q = p;
-
-	    if (!_backoff) {
-		_backoff = 1;
-		add_select(_fd, SELECT_WRITE);
-	    } else {
-		_timer.schedule_after(Timestamp::make_usec(_backoff));
-		if (_backoff < 32768)
-		    _backoff *= 2;
-		if (_debug) {
-		    Timestamp now = Timestamp::now();
-		    click_chatter("%{element} backing off for %d at %{timestamp}\n", this, _backoff, &now);
-		}
-	    }
-
+	    back_off();
 	    return false;
 
 	} else {
@@ -226,6 +273,58 @@ ToDevice::run_task(Task *)
     return p != 0;
 }
 
+#if TODEVICE_SENDMMSG
+// Sends the held packets and as many newly pulled ones as fit in the burst
+// with one sendmmsg.  Those the kernel didn't take stay held, in order.
+bool
+ToDevice::run_burst()
+{
+    bool pulled = false;
+    while (_nbatch < _burst) {
+	Packet *p = input(0).pull();
+	_pulls++;
+	if (!p)
+	    break;
+	_batch[_nbatch++] = p;
+	pulled = true;
+    }
+    if (!_nbatch) {
+	if (_signal)
+	    _task.fast_reschedule();
+	return false;
+    }
+
+    for (unsigned i = 0; i < _nbatch; i++) {
+	_iovs[i].iov_base = const_cast<unsigned char *>(_batch[i]->data());
+	_iovs[i].iov_len = _batch[i]->length();
+    }
+    int sent = sendmmsg(_fd, _msgs, _nbatch, 0);
+
+    unsigned done = (sent > 0 ? sent : 0);
+    if (sent < 0) {
+	if (errno == ENOBUFS || errno == EAGAIN) {
+	    back_off();
+	    return pulled;
+	}
+	// the first packet failed; the kernel says nothing of the others
+	click_chatter("ToDevice(%s) sendmmsg: %s", _ifname.c_str(), strerror(errno));
+	checked_output_push(1, _batch[0]);
+	done = 1;
+    } else
+	for (unsigned i = 0; i < done; i++)
+	    checked_output_push(0, _batch[i]);
+    if (sent > 0)
+	_backoff = 0;
+
+    _nbatch -= done;
+    memmove(_batch, _batch + done, _nbatch * sizeof(Packet *));
+    // a short count means the next packet would fail or block: the next run
+    // finds out which
+    _task.fast_reschedule();
+    return true;
+}
+#endif
+
 void
 ToDevice::selected(int)
 {
@@ -248,6 +347,10 @@ ToDevice::read_param(Element *e, void *thunk)
   case H_PULLS:
       return String(td->_pulls);
   case H_Q:
+#if TODEVICE_SENDMMSG
+      if (td->_nbatch)
+	  return String(true);
+#endif
       return String((bool) td->_q);
   default:
       return String();
@@ -6,6 +6,9 @@
 #include <click/timer.hh>
 #include <click/notifier.hh>
 #include "elements/userlevel/fromdevice.hh"
+#if defined(__linux__)
+# include <sys/socket.h>
+#endif
 CLICK_DECLS
 
 /*
@@ -30,6 +33,15 @@ CLICK_DECLS
  *
  * Boolean.  If true, print out debug messages.
  *
+ * =item BURST
+ *
+ * Unsigned.  Maximum number of packets pulled per task run and sent together.
+ * Under Linux, a BURST above 1 hands each batch to the kernel with a single
+ * sendmmsg call; packets the kernel has no room for are held, in order, and
+ * retried first, so ToDevice still pulls no faster than the device sends.
+ * Default is 1, which sends every packet with its own call.  Other platforms
+ * only support 1.
+ *
  * =back
  *
  * This element is only available at user level.
@@ -56,6 +68,11 @@ CLICK_DECLS
 #if defined(__linux__)
 # define TODEVICE_LINUX 1
 # define TODEVICE_SEND 1
+# if defined(__GLIBC__)
+#  if __GLIBC_PREREQ(2, 14)
+#   define TODEVICE_SENDMMSG 1
+#  endif
+# endif
 #elif HAVE_PCAP
 extern "C" {
 # include <pcap.h>
@@ -97,6 +114,11 @@ protected:
   Timer _timer;
 private:
 
+  void back_off();
+#if TODEVICE_SENDMMSG
+  bool run_burst();
+#endif
+
   String _ifname;
   int _fd;
   bool _my_fd;
@@ -104,6 +126,13 @@ private:
 
 
   Packet *_q;
+  unsigned _burst;
+#if TODEVICE_SENDMMSG
+  Packet **_batch;		// pulled, not yet sent, in order
+  unsigned _nbatch;
+  struct mmsghdr *_msgs;
+  struct iovec *_iovs;
+#endif
 public:
   bool _debug;
   bool _backoff;
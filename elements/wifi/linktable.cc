@@ -23,10 +23,11 @@
 #include <click/glue.hh>
 #include <elements/wifi/path.hh>
 #include <click/straccum.hh>
+#include <click/algorithm.hh>
 CLICK_DECLS
 
 LinkTable::LinkTable()
-  : _timer(this)
+  : _generation(1), _computed_from_me(0), _computed_to_me(0), _timer(this)
 {
 }
 
@@ -88,6 +89,7 @@ LinkTable::take_state(Element *e, ErrorHandler *) {
 
   _hosts = q->_hosts;
   _links = q->_links;
+  _generation++;
   dijkstra(true);
   dijkstra(false);
 }
@@ -138,6 +140,7 @@ LinkTable::clear()
 {
   _hosts.clear();
   _links.clear();
+  _generation++;
 
 }
 bool
@@ -171,8 +174,13 @@ LinkTable::update_link(IPAddress from, IPAddress to,
   LinkInfo *lnfo = _links.findp(p);
   if (!lnfo) {
     _links.insert(p, LinkInfo(from, to, seq, age, metric));
+    _generation++;
   } else {
+    unsigned old_metric = lnfo->_metric;
     lnfo->update(seq, age, metric);
+    if (lnfo->_metric != old_metric) {
+      _generation++;
+    }
   }
   return true;
 }
@@ -367,12 +375,10 @@ LinkTable::best_route(IPAddress dst, bool from_me)
 
 
   if (from_me) {
-	  Vector<IPAddress> route;
-	  /* why isn't there just push? */
-	  for (int i=reverse_route.size() - 1; i >= 0; i--) {
-		  route.push_back(reverse_route[i]);
-	  }
-	  return route;
+    /* turn it around in place */
+    for (int i = 0, j = reverse_route.size() - 1; i < j; i++, j--) {
+      click_swap(reverse_route[i], reverse_route[j]);
+    }
   }
 
   return reverse_route;
@@ -477,6 +483,9 @@ LinkTable::clear_stale() {
       }
     }
   }
+  if (links.size() != _links.size()) {
+    _generation++;
+  }
   _links.clear();
 
   for (LTIter iter = links.begin(); iter.live(); iter++) {
@@ -512,29 +521,72 @@ LinkTable::get_neighbors(IPAddress ip)
 
   return neighbors;
 }
+namespace {
+struct DijkstraItem {
+  uint32_t _metric;
+  int _host;
+  DijkstraItem(uint32_t metric, int host) : _metric(metric), _host(host) { }
+};
+
+struct dijkstra_less {
+  bool operator()(const DijkstraItem &a, const DijkstraItem &b) const {
+    return a._metric < b._metric;
+  }
+};
+}
+
 void
 LinkTable::dijkstra(bool from_me)
 {
-  Timestamp start = Timestamp::now();
-  IPAddress src = _ip;
-
-  typedef HashMap<IPAddress, bool> IPMap;
-  IPMap ip_addrs;
-
-  for (HTIter iter = _hosts.begin(); iter.live(); iter++) {
-    ip_addrs.insert(iter.value()._ip, true);
+  /* nothing to do if no link changed since the last run */
+  unsigned &computed = from_me ? _computed_from_me : _computed_to_me;
+  if (computed == _generation) {
+    return;
   }
+  Timestamp start = Timestamp::now();
 
-  for (IPMap::const_iterator i = ip_addrs.begin(); i.live(); i++) {
-    /* clear them all initially */
-    HostInfo *n = _hosts.findp(i.key());
+  /* number the hosts and clear them all initially */
+  HashMap<IPAddress, int> index;
+  Vector<HostInfo *> hosts;
+  for (HTable::iterator iter = _hosts.begin(); iter.live(); iter++) {
+    HostInfo *n = &iter.value();
     n->clear(from_me);
+    index.insert(n->_ip, hosts.size());
+    hosts.push_back(n);
   }
-  HostInfo *root_info = _hosts.findp(src);
-
-
-  assert(root_info);
 
+  /* the links leaving each host in the direction we search, grouped by
+   * host: those of host i are edges [first[i], first[i+1]) */
+  Vector<int> first(hosts.size() + 1, 0);
+  Vector<int> edge_from, edge_to;
+  Vector<unsigned> edge_metric;
+  for (LTIter iter = _links.begin(); iter.live(); iter++) {
+    const LinkInfo &lnfo = iter.value();
+    int *a = index.findp(from_me ? lnfo._from : lnfo._to);
+    int *b = index.findp(from_me ? lnfo._to : lnfo._from);
+    if (!a || !b || !lnfo._metric) {
+      continue;
+    }
+    edge_from.push_back(*a);
+    edge_to.push_back(*b);
+    edge_metric.push_back(lnfo._metric);
+    first[*a + 1]++;
+  }
+  for (int i = 0; i < hosts.size(); i++) {
+    first[i + 1] += first[i];
+  }
+  Vector<int> next(first);
+  Vector<int> to(edge_to.size(), 0);
+  Vector<unsigned> metric(edge_to.size(), 0);
+  for (int e = 0; e < edge_to.size(); e++) {
+    int slot = next[edge_from[e]]++;
+    to[slot] = edge_to[e];
+    metric[slot] = edge_metric[e];
+  }
+
+  int *root = index.findp(_ip);
+  assert(root);
+  HostInfo *root_info = hosts[*root];
   if (from_me) {
     root_info->_prev_from_me = root_info->_ip;
     root_info->_metric_from_me = 0;
@@ -543,81 +595,44 @@ LinkTable::dijkstra(bool from_me)
     root_info->_metric_to_me = 0;
   }
 
-  IPAddress current_min_ip = root_info->_ip;
+  /* a host may be in the heap more than once; only its first, shortest
+   * entry counts, the others find it marked */
+  Vector<DijkstraItem> heap;
+  heap.push_back(DijkstraItem(0, *root));
+  while (!heap.empty()) {
+    pop_heap(heap.begin(), heap.end(), dijkstra_less());
+    DijkstraItem item = heap.back();
+    heap.pop_back();
 
-  while (current_min_ip) {
-    HostInfo *current_min = _hosts.findp(current_min_ip);
-    assert(current_min);
-    if (from_me) {
-      current_min->_marked_from_me = true;
-    } else {
-      current_min->_marked_to_me = true;
+    HostInfo *current_min = hosts[item._host];
+    bool &marked = from_me ? current_min->_marked_from_me : current_min->_marked_to_me;
+    if (marked) {
+      continue;
     }
+    marked = true;
 
-
-    for (IPMap::const_iterator i = ip_addrs.begin(); i.live(); i++) {
-      HostInfo *neighbor = _hosts.findp(i.key());
-      assert(neighbor);
-      bool marked = neighbor->_marked_to_me;
-      if (from_me) {
-	marked = neighbor->_marked_from_me;
-      }
-
-      if (marked) {
+    for (int e = first[item._host]; e < first[item._host + 1]; e++) {
+      HostInfo *neighbor = hosts[to[e]];
+      if (from_me ? neighbor->_marked_from_me : neighbor->_marked_to_me) {
 	continue;
       }
-
-      IPPair pair = IPPair(neighbor->_ip, current_min_ip);
-      if (from_me) {
-	pair = IPPair(current_min_ip, neighbor->_ip);
-      }
-      LinkInfo *lnfo = _links.findp(pair);
-      if (!lnfo || !lnfo->_metric) {
-	continue;
-      }
-      uint32_t neighbor_metric = neighbor->_metric_to_me;
-      uint32_t current_metric = current_min->_metric_to_me;
-
-      if (from_me) {
-	neighbor_metric = neighbor->_metric_from_me;
-	current_metric = current_min->_metric_from_me;
-      }
-
-
-      uint32_t adjusted_metric = current_metric + lnfo->_metric;
+      uint32_t &neighbor_metric = from_me ? neighbor->_metric_from_me : neighbor->_metric_to_me;
+      uint32_t adjusted_metric = item._metric + metric[e];
       if (!neighbor_metric ||
 	  adjusted_metric < neighbor_metric) {
+	neighbor_metric = adjusted_metric;
 	if (from_me) {
-	  neighbor->_metric_from_me = adjusted_metric;
-	  neighbor->_prev_from_me = current_min_ip;
+	  neighbor->_prev_from_me = current_min->_ip;
 	} else {
-	  neighbor->_metric_to_me = adjusted_metric;
-	  neighbor->_prev_to_me = current_min_ip;
+	  neighbor->_prev_to_me = current_min->_ip;
 	}
-
+	heap.push_back(DijkstraItem(adjusted_metric, to[e]));
+	push_heap(heap.begin(), heap.end(), dijkstra_less());
       }
     }
-
-    current_min_ip = IPAddress();
-    uint32_t  min_metric = ~0;
-    for (IPMap::const_iterator i = ip_addrs.begin(); i.live(); i++) {
-      HostInfo *nfo = _hosts.findp(i.key());
-      uint32_t metric = nfo->_metric_to_me;
-      bool marked = nfo->_marked_to_me;
-      if (from_me) {
-	metric = nfo->_metric_from_me;
-	marked = nfo->_marked_from_me;
-      }
-      if (!marked && metric &&
-	  metric < min_metric) {
-        current_min_ip = nfo->_ip;
-        min_metric = metric;
-      }
-    }
-
-
   }
 
+  computed = _generation;
   dijkstra_time = Timestamp::now() - start;
   //StringAccum sa;
   //sa << "dijstra took " << finish - start;
@@ -723,5 +738,10 @@ LinkTable::add_handlers() {
 
 }
 
+#include <click/vector.cc>
+#if EXPLICIT_TEMPLATE_INSTANCES
+template class Vector<DijkstraItem>;
+template class Vector<LinkTable::HostInfo *>;
+#endif
 EXPORT_ELEMENT(LinkTable)
 CLICK_ENDDECLS
@@ -16,7 +16,8 @@ CLICK_DECLS
  * Keeps a Link state database and calculates Weighted Shortest Path
  * for other elements
  * =d
- * Runs dijkstra's algorithm occasionally.
+ * Runs dijkstra's algorithm occasionally, with a heap, and only when a
+ * link was added, removed or changed its metric since the last run.
  * =a ARPTable
  *
  */
@@ -235,6 +236,12 @@ protected:
   HTable _hosts;
   LTable _links;
 
+  /* bumped whenever links change; dijkstra() is skipped while the
+     generation it last ran for is current */
+  unsigned _generation;
+  unsigned _computed_from_me;
+  unsigned _computed_to_me;
+
 
   IPAddress _ip;
   Timestamp _stale_timeout;
@@ -30,7 +30,8 @@
 CLICK_DECLS
 
 WifiDupeFilter::WifiDupeFilter()
-  : _debug(false),
+  : _table(0),
+    _debug(false),
     _dupes(0)
 {
 }
@@ -42,11 +43,70 @@ WifiDupeFilter::~WifiDupeFilter()
 int
 WifiDupeFilter::configure(Vector<String> &conf, ErrorHandler* errh)
 {
-  int ret;
-  ret = cp_va_kparse(conf, this, errh,
-		     "DEBUG", 0, cpBool, &_debug,
-		     cpEnd);
-  return ret;
+  _size = 256;
+  if (cp_va_kparse(conf, this, errh,
+		   "STATIONS", 0, cpInteger, &_size,
+		   "DEBUG", 0, cpBool, &_debug,
+		   cpEnd) < 0)
+    return -1;
+  if (_size < PROBES || _size > (1 << 20))
+    return errh->error("STATIONS must be between %d and %d", PROBES, 1 << 20);
+  return 0;
+}
+
+int
+WifiDupeFilter::initialize(ErrorHandler *errh)
+{
+  int size = PROBES;
+  while (size < _size)
+    size <<= 1;
+  _size = size;
+  _mask = size - 1;
+  if (!(_table = new DstInfo[size]))
+    return errh->error("out of memory");
+  clear();
+  return 0;
+}
+
+void
+WifiDupeFilter::cleanup(CleanupStage)
+{
+  delete[] _table;
+  _table = 0;
+}
+
+void
+WifiDupeFilter::clear()
+{
+  for (int i = 0; i < _size; i++)
+    _table[i].clear();
+  _ticks = 0;
+}
+
+/**
+ * returns the slot of src, taking a free slot or the least recently used
+ * of its PROBES slots for a new station
+ */
+WifiDupeFilter::DstInfo *
+WifiDupeFilter::lookup(const EtherAddress &src)
+{
+  const unsigned char *d = src.data();
+  uint32_t h = (d[2] << 24 | d[3] << 16 | d[4] << 8 | d[5]) ^ (d[0] << 8 | d[1]);
+  h ^= h >> 13;
+  DstInfo *victim = 0;
+  for (int i = 0; i < PROBES; i++) {
+    DstInfo *nfo = &_table[(h + i) & _mask];
+    if (!nfo->last_used) {
+      victim = nfo;
+      break;
+    } else if (nfo->_eth == src)
+      return nfo;
+    else if (!victim || (int32_t) (nfo->last_used - victim->last_used) < 0)
+      victim = nfo;
+  }
+  victim->clear();
+  victim->_eth = src;
+  return victim;
 }
 
 Packet *
@@ -58,27 +118,54 @@ WifiDupeFilter::simple_action(Packet *p_in)
     return p_in;
   }
 
-  EtherAddress src = EtherAddress(w->i_addr2);
   EtherAddress dst = EtherAddress(w->i_addr1);
+  if (w->i_fc[0] & WIFI_FC0_TYPE_CTL || dst.is_group()) {
+    return p_in;
+  }
+
+  EtherAddress src = EtherAddress(w->i_addr2);
   uint16_t seq = le16_to_cpu(*(uint16_t *) w->i_seq) >> WIFI_SEQ_SEQ_SHIFT;
   uint8_t frag = le16_to_cpu(*(u_int16_t *)w->i_seq) & WIFI_SEQ_FRAG_MASK;
   u_int8_t more_frag = w->i_fc[1] & WIFI_FC1_MORE_FRAG;
+  bool retry = w->i_fc[1] & WIFI_FC1_RETRY;
 
   bool is_frag = frag || more_frag;
 
-  DstInfo *nfo = _table.findp(src);
+  DstInfo *nfo = lookup(src);
+  bool fresh = !nfo->last_used;
+  if (!++_ticks)
+    _ticks = 1;
+  nfo->last_used = _ticks;
+  nfo->_packets++;
 
-  if (w->i_fc[0] & WIFI_FC0_TYPE_CTL || dst.is_group()) {
-    return p_in;
-  }
-  if (!nfo) {
-    _table.insert(src, DstInfo(src));
-    nfo = _table.findp(src);
-    nfo->clear();
+  // sequence numbers are 12 bits wide; behind is how far seq lags the
+  // highest one seen
+  unsigned behind = (nfo->seq - seq) & 0xFFF;
+  bool dup;
+  if (fresh) {
+    nfo->seq = seq;
+    nfo->frag = frag;
+    nfo->window = 1;
+    dup = false;
+  } else if (behind == 0) {
+    dup = retry && (!is_frag || frag <= nfo->frag);
+    if (!dup)
+      nfo->frag = frag;
+  } else if (behind < WINDOW) {
+    // a fragment of an older frame cannot be told apart, so let it pass
+    uint64_t bit = (uint64_t) 1 << behind;
+    dup = retry && !is_frag && (nfo->window & bit);
+    nfo->window |= bit;
+  } else {
+    // newer, or so much older that the transmitter must have restarted
+    unsigned ahead = (seq - nfo->seq) & 0xFFF;
+    nfo->window = (ahead < WINDOW ? nfo->window << ahead : 0) | 1;
+    nfo->seq = seq;
+    nfo->frag = frag;
+    dup = false;
   }
 
-  if (w->i_fc[1] & WIFI_FC1_RETRY && seq == nfo->seq &&
-      (!is_frag || frag <= nfo->frag)) {
+  if (dup) {
 	  /* duplicate detected */
 	  if (_debug) {
 		  click_chatter("%{element}: dup seq %d frag %d src %s\n",
@@ -93,8 +180,6 @@ WifiDupeFilter::simple_action(Packet *p_in)
 	  return 0;
   }
 
-  nfo->seq = seq;
-  nfo->frag = frag;
   return p_in;
 }
 
@@ -105,8 +190,10 @@ WifiDupeFilter::static_read_stats(Element *xf, void *)
   WifiDupeFilter *e = (WifiDupeFilter *) xf;
   StringAccum sa;
 
-  for(DstTable::const_iterator i = e->_table.begin(); i.live(); i++) {
-    DstInfo nfo = i.value();
+  for (int i = 0; i < e->_size; i++) {
+    const DstInfo &nfo = e->_table[i];
+    if (!nfo.last_used)
+      continue;
     sa << nfo._eth;
     sa << " packets " << nfo._packets;
     sa << " dupes " << nfo._dupes;
@@ -148,7 +235,7 @@ WifiDupeFilter_write_param(const String &in_s, Element *e, void *vparam,
     break;
   }
   case H_RESET: {
-    f->_table.clear();
+    f->clear();
     f->_dupes = 0;
   }
   }
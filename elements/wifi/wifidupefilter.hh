@@ -2,14 +2,13 @@
 #define CLICK_WIFIDUPEFILTER_HH
 #include <click/element.hh>
 #include <click/string.hh>
-#include <click/dequeue.hh>
-#include <click/hashmap.hh>
+#include <click/etheraddress.hh>
 CLICK_DECLS
 
 /*
 =c
 
-WifiDupeFilter([TAG] [, KEYWORDS])
+WifiDupeFilter([KEYWORDS])
 
 =s Wifi
 
@@ -17,6 +16,43 @@ Filters out duplicate 802.11 packets based on their sequence number.
 
 =d
 
+Drops retransmitted unicast frames whose sequence number (and fragment
+number) was already seen from the same transmitter. For every transmitter
+it remembers the highest sequence number seen and, as a bitmap, which of
+the 64 sequence numbers below it were seen, so a retry that arrives after
+later frames is still recognized. Control and group-addressed frames pass
+untouched.
+
+The transmitters are kept in a fixed-size open-addressed table, so checking
+a frame is a few probes and a new station costs no allocation. When all
+slots a station hashes to are taken, the least recently heard station among
+them is forgotten; the only cost is that a duplicate from it may slip
+through.
+
+Keyword arguments are:
+
+=over 8
+
+=item STATIONS
+
+Integer. Number of table slots, rounded up to a power of two. Default is
+256. Use about twice the number of stations in range.
+
+=item DEBUG
+
+Boolean. Print every duplicate dropped. Default is false.
+
+=back
+
+=h stats read-only
+Packets and duplicates per transmitter.
+
+=h dupes read-only
+Total duplicates dropped.
+
+=h reset write-only
+Forgets all transmitters.
+
 =a WifiEncap, WifiDecap
  */
 
@@ -32,6 +68,8 @@ class WifiDupeFilter : public Element {
   const char *processing() const		{ return AGNOSTIC; }
 
   int configure(Vector<String> &, ErrorHandler *);
+  int initialize(ErrorHandler *);
+  void cleanup(CleanupStage);
 
   Packet *simple_action(Packet *);
 
@@ -41,14 +79,19 @@ class WifiDupeFilter : public Element {
 				void *, ErrorHandler *errh);
   void add_handlers();
 
+  enum { WINDOW = 64,		// sequence numbers remembered below the highest
+	 PROBES = 8 };		// slots a station may occupy
+
   class DstInfo {
   public:
     EtherAddress _eth;
     int _dupes;
     int _packets;
 
-    uint16_t seq;
-    uint16_t frag;
+    uint16_t seq;		// highest sequence number seen
+    uint16_t frag;		// last fragment of seq
+    uint64_t window;		// bit i: seq - i seen
+    uint32_t last_used;		// _ticks when last heard, 0 if free
 
     DstInfo(EtherAddress eth) {
       _eth = eth;
@@ -59,17 +102,21 @@ class WifiDupeFilter : public Element {
       _packets = 0;
       seq = 0;
       frag = 0;
-
+      window = 0;
+      last_used = 0;
     }
   };
 
-  typedef HashMap <EtherAddress, DstInfo> DstTable;
-  typedef DstTable::const_iterator DstIter;
-
-  DstTable _table;
+  DstInfo *_table;
+  uint32_t _mask;		// number of slots - 1
+  int _size;
+  uint32_t _ticks;
   bool _debug;
 
   int _dupes;
+
+  DstInfo *lookup(const EtherAddress &src);
+  void clear();
 };
 
 CLICK_ENDDECLS
@@ -2,6 +2,7 @@
 #ifndef CLICK_BITVECTOR_HH
 #define CLICK_BITVECTOR_HH
 #include <click/glue.hh>
+#include <click/integers.hh>
 CLICK_DECLS
 
 /** @file <click/bitvector.hh>
@@ -193,6 +194,32 @@ class Bitvector { public:
     bool nonzero_intersection(const Bitvector &x) const;
 
 
+    /** @brief Return the number of true bits. */
+    int count() const;
+
+    /** @brief Return the number of true bits of (*this & @a x).
+     * @pre @a x.size() == size()
+     *
+     * Counts without building the intersection. */
+    int intersection_count(const Bitvector &x) const;
+
+    /** @brief Return the number of true bits of (*this - @a x).
+     * @pre @a x.size() == size()
+     *
+     * Counts without building the difference. */
+    int difference_count(const Bitvector &x) const;
+
+    /** @brief Return the position of the first true bit at or after @a i,
+     * or -1 if there is none.
+     *
+     * Skips false bits a word at a time.  To visit the true bits in order:
+     * @code
+     * for (int i = x.find_first(); i >= 0; i = x.find_first(i + 1))
+     *     ...
+     * @endcode */
+    int find_first(int i = 0) const;
+
+
     /** @brief Swap the contents of this bitvector and @a x. */
     void swap(Bitvector &x);
 
@@ -372,12 +399,6 @@ Bitvector::force_bit(int i)
     return Bit(_data[i>>5], i&31);
 }
 
-inline Bitvector &
-Bitvector::operator-=(const Bitvector &o)
-{
-    return *this &= ~o;
-}
-
 inline Bitvector
 Bitvector::operator~() const
 {
@@ -413,7 +434,9 @@ Bitvector::operator^(const Bitvector &o) const
 inline Bitvector
 Bitvector::operator-(const Bitvector &o) const
 {
-    return *this & ~o;
+    Bitvector m = *this;
+    m -= o;
+    return m;
 }
 
 inline void click_swap(Bitvector &a, Bitvector &b)
@@ -18,6 +18,7 @@ void click_static_cleanup();
 
 Lexer *click_lexer();
 Router *click_read_router(String filename, bool is_expr, ErrorHandler * = 0, bool initialize = true, Master * = 0);
+Router *click_clone_router(const Router *router, ErrorHandler * = 0, bool initialize = true, Master * = 0);
 
 String click_compile_archive_file(const Vector<ArchiveElement> &ar,
 		const ArchiveElement *ae,
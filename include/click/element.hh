@@ -5,7 +5,9 @@
 #include <click/vector.hh>
 #include <click/string.hh>
 #include <click/packet.hh>
+#include <click/packetbatch.hh>
 #include <click/handler.hh>
+#include <click/profiler.hh>
 CLICK_DECLS
 class Router;
 class Master;
@@ -34,6 +36,8 @@ class Element { public:
     virtual void push(int port, Packet *p);
     virtual Packet *pull(int port) CLICK_WARN_UNUSED_RESULT;
     virtual Packet *simple_action(Packet *p);
+    virtual void push_batch(int port, PacketBatch &batch);
+    virtual void pull_batch(int port, PacketBatch &batch, unsigned max);
 
     virtual bool run_task(Task *task);	// return true iff did useful work
     virtual void run_timer(Timer *timer);
@@ -196,6 +200,8 @@ class Element { public:
 
 	inline void push(Packet* p) const;
 	inline Packet* pull() const;
+	inline void push_batch(PacketBatch &batch) const;
+	inline void pull_batch(PacketBatch &batch, unsigned max) const;
 
 #if CLICK_STATS >= 1
 	unsigned npackets() const	{ return _packets; }
@@ -559,6 +565,9 @@ Element::Port::push(Packet* p) const
 #if CLICK_STATS >= 1
     ++_packets;
 #endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::Frame *frame = ElementProfiler::enter(_e, _port, ElementProfiler::PUSH);
+#endif
 #if CLICK_STATS >= 2
     ++_e->input(_port)._packets;
     click_cycles_t c0 = click_get_cycles();
@@ -570,6 +579,9 @@ Element::Port::push(Packet* p) const
 #else
     _e->push(_port, p);
 #endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::leave(frame, 1);
+#endif
 }
 
 /** @brief Pull a packet over this port and return it.
@@ -592,6 +604,9 @@ inline Packet*
 Element::Port::pull() const
 {
     assert(_e);
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::Frame *frame = ElementProfiler::enter(_e, _port, ElementProfiler::PULL);
+#endif
 #if CLICK_STATS >= 2
     click_cycles_t c0 = click_get_cycles();
     Packet *p = _e->pull(_port);
@@ -604,6 +619,9 @@ Element::Port::pull() const
 #else
     Packet *p = _e->pull(_port);
 #endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::leave(frame, p != 0);
+#endif
 #if CLICK_STATS >= 1
     if (p)
 	++_packets;
@@ -611,6 +629,86 @@ Element::Port::pull() const
     return p;
 }
 
+/** @brief Push the packets of @a batch downstream over this port.
+ *
+ * Passes every packet of @a batch to the next element with one call of its
+ * @link Element::push_batch() push_batch() @endlink function; elements that
+ * do not implement it receive the packets one push() at a time.  Like
+ * push(), this relinquishes control of the packets.  @a batch is empty on
+ * return.  Pushing an empty batch does nothing.
+ *
+ * This port must be an active() push output port.
+ */
+inline void
+Element::Port::push_batch(PacketBatch &batch) const
+{
+    assert(_e);
+    if (batch.empty())
+	return;
+#if CLICK_STATS >= 1
+    unsigned n = batch.count();
+    _packets += n;
+#endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::Frame *frame = ElementProfiler::enter(_e, _port, ElementProfiler::PUSH);
+    unsigned npushed = (frame ? batch.count() : 0);
+#endif
+#if CLICK_STATS >= 2
+    _e->input(_port)._packets += n;
+    click_cycles_t c0 = click_get_cycles();
+    _e->push_batch(_port, batch);
+    click_cycles_t x = click_get_cycles() - c0;
+    ++_e->_calls;
+    _e->_self_cycles += x;
+    _owner->_child_cycles += x;
+#else
+    _e->push_batch(_port, batch);
+#endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::leave(frame, npushed);
+#endif
+}
+
+/** @brief Pull up to @a max packets over this port into @a batch.
+ *
+ * Appends at most @a max packets from upstream to the end of @a batch, with
+ * one call of the previous element's @link Element::pull_batch()
+ * pull_batch() @endlink function; elements that do not implement it are
+ * pulled one packet at a time until they return null.  Fewer than @a max
+ * new packets means that upstream ran dry.
+ *
+ * This port must be an active() pull input port.
+ */
+inline void
+Element::Port::pull_batch(PacketBatch &batch, unsigned max) const
+{
+    assert(_e);
+#if CLICK_STATS >= 1
+    unsigned n = batch.count();
+#endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::Frame *frame = ElementProfiler::enter(_e, _port, ElementProfiler::PULL);
+    unsigned nbefore = (frame ? batch.count() : 0);
+#endif
+#if CLICK_STATS >= 2
+    click_cycles_t c0 = click_get_cycles();
+    _e->pull_batch(_port, batch, max);
+    click_cycles_t x = click_get_cycles() - c0;
+    ++_e->_calls;
+    _e->_self_cycles += x;
+    _owner->_child_cycles += x;
+    _e->output(_port)._packets += batch.count() - n;
+#else
+    _e->pull_batch(_port, batch, max);
+#endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::leave(frame, batch.count() - nbefore);
+#endif
+#if CLICK_STATS >= 1
+    _packets += batch.count() - n;
+#endif
+}
+
 /** @brief Push packet @a p to output @a port, or kill it if @a port is out of
  * range.
  *
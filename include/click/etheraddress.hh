@@ -108,6 +108,30 @@ class EtherAddress { public:
      * @sa unparse_colon */
     String unparse_dash() const;
 
+    enum {
+	unparse_buflen = 18	///< Buffer size for the unparse(char *) family.
+    };
+
+    /** @brief Unparse this address into a dash-separated hex string in @a buf.
+     * @param buf buffer of at least unparse_buflen characters
+     * @return @a buf
+     *
+     * Like unparse(), but writes a null-terminated string into @a buf
+     * without allocating memory. */
+    inline char *unparse(char *buf) const {
+	return unparse_dash(buf);
+    }
+
+    /** @brief Unparse this address into a colon-separated hex string in @a buf.
+     * @param buf buffer of at least unparse_buflen characters
+     * @return @a buf */
+    char *unparse_colon(char *buf) const;
+
+    /** @brief Unparse this address into a dash-separated hex string in @a buf.
+     * @param buf buffer of at least unparse_buflen characters
+     * @return @a buf */
+    char *unparse_dash(char *buf) const;
+
     /** @brief Unparse this address into a dash-separated hex String.
      * @deprecated The unparse() function should be preferred to s().
      * @sa unparse */
@@ -0,0 +1,243 @@
+/*
+ * flathashmap.{cc,hh} -- an open-addressing hash table template
+ */
+
+#ifndef CLICK_FLATHASHMAP_CC
+#define CLICK_FLATHASHMAP_CC
+#include <click/flathashmap.hh>
+CLICK_DECLS
+
+template <class K, class V>
+void
+FlatHashMap<K, V>::allocate(size_t nbuckets)
+{
+    _nbuckets = nbuckets;
+    _hash = (uint32_t *) CLICK_LALLOC(nbuckets * sizeof(uint32_t));
+    _slots = (Pair *) CLICK_LALLOC(nbuckets * sizeof(Pair));
+    memset(_hash, 0, nbuckets * sizeof(uint32_t));
+    _n = 0;
+}
+
+template <class K, class V>
+void
+FlatHashMap<K, V>::release()
+{
+    for (size_t i = 0; i < _nbuckets; i++)
+	if (_hash[i]) {
+	    _slots[i].key.~K();
+	    _slots[i].value.~V();
+	}
+    CLICK_LFREE(_hash, _nbuckets * sizeof(uint32_t));
+    CLICK_LFREE(_slots, _nbuckets * sizeof(Pair));
+}
+
+template <class K, class V>
+FlatHashMap<K, V>::FlatHashMap()
+    : _default_value(), _dynamic_resizing(true)
+{
+    allocate(DEFAULT_INITIAL_NBUCKETS);
+}
+
+template <class K, class V>
+FlatHashMap<K, V>::FlatHashMap(const V &def)
+    : _default_value(def), _dynamic_resizing(true)
+{
+    allocate(DEFAULT_INITIAL_NBUCKETS);
+}
+
+template <class K, class V>
+FlatHashMap<K, V>::FlatHashMap(const FlatHashMap<K, V> &o)
+    : _default_value(o._default_value), _dynamic_resizing(o._dynamic_resizing)
+{
+    allocate(o._nbuckets);
+    // same size, same hash: every pair keeps its slot
+    for (size_t i = 0; i < _nbuckets; i++)
+	if ((_hash[i] = o._hash[i])) {
+	    new(reinterpret_cast<void *>(&_slots[i].key)) K(o._slots[i].key);
+	    new(reinterpret_cast<void *>(&_slots[i].value)) V(o._slots[i].value);
+	}
+    _n = o._n;
+}
+
+template <class K, class V>
+FlatHashMap<K, V>::~FlatHashMap()
+{
+    release();
+}
+
+template <class K, class V>
+FlatHashMap<K, V> &
+FlatHashMap<K, V>::operator=(const FlatHashMap<K, V> &o)
+{
+    if (&o != this) {
+	FlatHashMap<K, V> copy(o);
+	swap(copy);
+    }
+    return *this;
+}
+
+template <class K, class V>
+size_t
+FlatHashMap<K, V>::find_slot(const K &key) const
+{
+    if (!_n)
+	return _nbuckets;
+    uint32_t h = mix(hashcode(key));
+    size_t mask = _nbuckets - 1, i = h & mask;
+    // a pair closer to its home than we are to ours ends the search: Robin
+    // Hood insertion would have put our key in its place
+    for (size_t d = 0; _hash[i] && distance(i) >= d; ++d, i = (i + 1) & mask)
+	if (_hash[i] == h && _slots[i].key == key)
+	    return i;
+    return _nbuckets;
+}
+
+template <class K, class V>
+inline void
+FlatHashMap<K, V>::move(size_t to, size_t from)
+{
+    new(reinterpret_cast<void *>(&_slots[to].key)) K(_slots[from].key);
+    new(reinterpret_cast<void *>(&_slots[to].value)) V(_slots[from].value);
+    _slots[from].key.~K();
+    _slots[from].value.~V();
+    _hash[to] = _hash[from];
+}
+
+template <class K, class V>
+size_t
+FlatHashMap<K, V>::place(uint32_t h, const K &key, const V &value)
+  // requires that key is not in the table and that a slot is free
+{
+    size_t mask = _nbuckets - 1, i = h & mask;
+    for (size_t d = 0; _hash[i] && distance(i) >= d; ++d)
+	i = (i + 1) & mask;
+
+    // Within a run of occupied slots, pairs are sorted by home slot.  Taking
+    // slot i from a richer pair is the same as shifting the rest of the run,
+    // up to the next free slot, one slot further from home.
+    size_t j = i;
+    while (_hash[j])
+	j = (j + 1) & mask;
+    for (; j != i; j = (j - 1) & mask)
+	move(j, (j - 1) & mask);
+
+    new(reinterpret_cast<void *>(&_slots[i].key)) K(key);
+    new(reinterpret_cast<void *>(&_slots[i].value)) V(value);
+    _hash[i] = h;
+    _n++;
+    return i;
+}
+
+template <class K, class V>
+typename FlatHashMap<K, V>::Pair *
+FlatHashMap<K, V>::find_pair_force(const K &key, const V &value)
+{
+    size_t i = find_slot(key);
+    if (i < _nbuckets)
+	return &_slots[i];
+    if (need_grow())
+	rehash(_nbuckets << 1);
+    return &_slots[place(mix(hashcode(key)), key, value)];
+}
+
+template <class K, class V>
+bool
+FlatHashMap<K, V>::insert(const K &key, const V &value)
+{
+    size_t i = find_slot(key);
+    if (i < _nbuckets) {
+	_slots[i].value = value;
+	return false;
+    }
+    if (need_grow())
+	rehash(_nbuckets << 1);
+    (void) place(mix(hashcode(key)), key, value);
+    return true;
+}
+
+template <class K, class V>
+bool
+FlatHashMap<K, V>::erase(const K &key)
+{
+    size_t i = find_slot(key);
+    if (i >= _nbuckets)
+	return false;
+    _slots[i].key.~K();
+    _slots[i].value.~V();
+
+    // shift the pairs behind it a slot closer to home, up to a free slot or
+    // a pair that is at home already
+    size_t mask = _nbuckets - 1;
+    for (size_t j = (i + 1) & mask; _hash[j] && distance(j); j = (j + 1) & mask) {
+	move(i, j);
+	i = j;
+    }
+    _hash[i] = 0;
+    _n--;
+    return true;
+}
+
+template <class K, class V>
+void
+FlatHashMap<K, V>::clear()
+{
+    for (size_t i = 0; i < _nbuckets; i++)
+	if (_hash[i]) {
+	    _slots[i].key.~K();
+	    _slots[i].value.~V();
+	    _hash[i] = 0;
+	}
+    _n = 0;
+}
+
+template <class K, class V>
+void
+FlatHashMap<K, V>::swap(FlatHashMap<K, V> &o)
+{
+    uint32_t *t_hash;
+    Pair *t_slots;
+    size_t t_size;
+    V t_v;
+    bool t_b;
+
+    t_hash = _hash; _hash = o._hash; o._hash = t_hash;
+    t_slots = _slots; _slots = o._slots; o._slots = t_slots;
+    t_size = _nbuckets; _nbuckets = o._nbuckets; o._nbuckets = t_size;
+    t_size = _n; _n = o._n; o._n = t_size;
+    t_v = _default_value; _default_value = o._default_value; o._default_value = t_v;
+    t_b = _dynamic_resizing; _dynamic_resizing = o._dynamic_resizing; o._dynamic_resizing = t_b;
+}
+
+template <class K, class V>
+void
+FlatHashMap<K, V>::rehash(size_t nbuckets)
+{
+    uint32_t *old_hash = _hash;
+    Pair *old_slots = _slots;
+    size_t old_nbuckets = _nbuckets;
+
+    allocate(nbuckets);
+    for (size_t i = 0; i < old_nbuckets; i++)
+	if (old_hash[i]) {
+	    (void) place(old_hash[i], old_slots[i].key, old_slots[i].value);
+	    old_slots[i].key.~K();
+	    old_slots[i].value.~V();
+	}
+    CLICK_LFREE(old_hash, old_nbuckets * sizeof(uint32_t));
+    CLICK_LFREE(old_slots, old_nbuckets * sizeof(Pair));
+}
+
+template <class K, class V>
+void
+FlatHashMap<K, V>::resize(size_t want_nbuckets)
+{
+    // never shrink below what the current pairs need
+    size_t nbuckets = DEFAULT_INITIAL_NBUCKETS;
+    while (nbuckets < want_nbuckets || nbuckets - (nbuckets >> 3) < _n + 1)
+	nbuckets <<= 1;
+    if (nbuckets != _nbuckets)
+	rehash(nbuckets);
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,305 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_FLATHASHMAP_HH
+#define CLICK_FLATHASHMAP_HH
+#include <click/hashcode.hh>
+#include <click/glue.hh>
+CLICK_DECLS
+
+/** @file <click/flathashmap.hh>
+ * @brief An open-addressing variant of HashMap.
+ */
+
+template <class K, class V> class FlatHashMap_const_iterator;
+template <class K, class V> class FlatHashMap_iterator;
+
+/** @class FlatHashMap
+  @brief Open-addressing hash table template with HashMap's interface.
+
+  FlatHashMap<K, V> maps keys K to values V, like HashMap<K, V>, with the
+  same find(), findp(), find_pair(), find_force(), insert(), remove() and
+  iterator methods, so code can switch between the two by changing a type.
+
+  Where HashMap keeps every pair in its own node on a bucket chain,
+  FlatHashMap keeps the pairs themselves in one array, next to an array of
+  their hash codes, from which it tells empty slots and how far each pair is
+  from its home slot.  It uses linear probing with Robin Hood
+  insertion: a new pair takes the place of any pair that is closer to its
+  home slot, so all keys stay within a few slots of home and a lookup stops
+  as soon as it meets a pair closer to home than the key it wants; keys are
+  only compared when the hash codes match.  Removal shifts the following
+  pairs back instead of leaving tombstones.  Lookups therefore touch one or
+  two cache lines, insertions never allocate except to grow the table, and
+  iteration is a walk over an array.
+
+  The price is stability.  Any insert() or find_force() of a new key, and
+  any remove(), may move other pairs: pointers returned by findp(),
+  find_pair() and friends, and iterators, are valid only until the table
+  next changes.  Code that keeps such pointers across changes, or removes
+  pairs while iterating, must stay with HashMap.  Pairs move by copy
+  construction, which is cheap for the small keys and values this suits.
+
+  The table size is a power of two, grown when it would be more than 7/8
+  full.  As the table is one allocation, FlatHashMap suits small and
+  medium tables; in the kernel, prefer HashMap for large ones.
+
+  K and V must meet HashMap's requirements; K's hashcode() need not be well
+  distributed, as FlatHashMap mixes it before use. */
+template <class K, class V>
+class FlatHashMap { public:
+
+    typedef K key_type;
+    typedef V mapped_type;
+    struct Pair {
+	K key;
+	V value;
+    };
+
+    FlatHashMap();
+    explicit FlatHashMap(const V &default_value);
+    FlatHashMap(const FlatHashMap<K, V> &);
+    ~FlatHashMap();
+
+    size_t size() const			{ return _n; }
+    bool empty() const			{ return _n == 0; }
+    size_t nbuckets() const		{ return _nbuckets; }
+
+    inline Pair *find_pair(const K &) const;
+    inline V *findp(const K &) const;
+    inline const V &find(const K &, const V &) const;
+    inline const V &find(const K &) const;
+    inline const V &operator[](const K &) const;
+
+    Pair *find_pair_force(const K &, const V &);
+    Pair *find_pair_force(const K &k) { return find_pair_force(k, _default_value); }
+    V *findp_force(const K &k, const V &v) { return &find_pair_force(k, v)->value; }
+    V &find_force(const K &k, const V &v) { return *findp_force(k, v); }
+    V *findp_force(const K &k)	{ return findp_force(k, _default_value); }
+    V &find_force(const K &k)	{ return *findp_force(k, _default_value); }
+
+    bool insert(const K &, const V &);
+    bool erase(const K &);
+    bool remove(const K &key) {
+	return erase(key);
+    }
+    void clear();
+
+    void swap(FlatHashMap<K, V> &);
+
+    // iteration
+    typedef FlatHashMap_const_iterator<K, V> const_iterator;
+    typedef FlatHashMap_iterator<K, V> iterator;
+    inline const_iterator begin() const;
+    inline iterator begin();
+    inline const_iterator end() const;
+    inline iterator end();
+
+    // resizing
+    void resize(size_t);
+    bool dynamic_resizing() const	{ return _dynamic_resizing; }
+    void set_dynamic_resizing(bool on)	{ _dynamic_resizing = on; }
+
+    FlatHashMap<K, V> &operator=(const FlatHashMap<K, V> &);
+
+    enum { DEFAULT_INITIAL_NBUCKETS = 16 };
+
+  private:
+
+    // _hash[i] is 0 for an empty slot, else the mixed hash code, with its
+    // top bit set, of the pair in _slots[i]
+    uint32_t *_hash;
+    Pair *_slots;
+    size_t _nbuckets;		// a power of two
+    size_t _n;
+    V _default_value;
+    bool _dynamic_resizing;
+
+    static inline uint32_t mix(hashcode_t);
+    inline size_t distance(size_t i) const;
+    size_t find_slot(const K &) const;
+    size_t place(uint32_t, const K &, const V &);
+    inline void move(size_t to, size_t from);
+    void allocate(size_t);
+    void release();
+    void rehash(size_t);
+    inline bool need_grow() const;
+
+    friend class FlatHashMap_const_iterator<K, V>;
+
+};
+
+template <class K, class V>
+class FlatHashMap_const_iterator { public:
+
+    bool live() const			{ return _i < _hm->_nbuckets; }
+    typedef bool (FlatHashMap_const_iterator::*unspecified_bool_type)() const;
+    operator unspecified_bool_type() const {
+	return live() ? &FlatHashMap_const_iterator::live : 0;
+    }
+    inline void operator++();
+    void operator++(int)		{ ++*this; }
+
+    typedef typename FlatHashMap<K, V>::Pair Pair;
+    const Pair *pair() const		{ return live() ? &_hm->_slots[_i] : 0; }
+
+    const K &key() const		{ return _hm->_slots[_i].key; }
+    const V &value() const		{ return _hm->_slots[_i].value; }
+
+  private:
+
+    const FlatHashMap<K, V> *_hm;
+    size_t _i;
+
+    inline FlatHashMap_const_iterator(const FlatHashMap<K, V> *hm, bool begin);
+    friend class FlatHashMap<K, V>;
+    friend class FlatHashMap_iterator<K, V>;
+
+};
+
+template <class K, class V>
+class FlatHashMap_iterator : public FlatHashMap_const_iterator<K, V> { public:
+
+    typedef FlatHashMap_const_iterator<K, V> inherited;
+
+    typedef typename FlatHashMap<K, V>::Pair Pair;
+    Pair *pair() const		{ return const_cast<Pair *>(inherited::pair()); }
+    V &value() const		{ return const_cast<V &>(inherited::value()); }
+
+  private:
+
+    FlatHashMap_iterator(FlatHashMap<K, V> *hm, bool begin) : inherited(hm, begin) { }
+    friend class FlatHashMap<K, V>;
+
+};
+
+template <class K, class V>
+inline uint32_t
+FlatHashMap<K, V>::mix(hashcode_t h)
+{
+    // many hashcode()s, IPAddress's among them, are weak in the low bits
+    uint32_t x = h;
+    x ^= x >> 16;
+    x *= 0x85EBCA6BU;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35U;
+    x ^= x >> 16;
+    return x | 0x80000000U;
+}
+
+template <class K, class V>
+inline size_t
+FlatHashMap<K, V>::distance(size_t i) const
+{
+    return (i - _hash[i]) & (_nbuckets - 1);
+}
+
+template <class K, class V>
+inline bool
+FlatHashMap<K, V>::need_grow() const
+{
+    if (_dynamic_resizing)
+	return _n + 1 > _nbuckets - (_nbuckets >> 3);
+    else
+	return _n + 1 >= _nbuckets;
+}
+
+template <class K, class V>
+inline typename FlatHashMap<K, V>::Pair *
+FlatHashMap<K, V>::find_pair(const K &key) const
+{
+    size_t i = find_slot(key);
+    return i < _nbuckets ? &_slots[i] : 0;
+}
+
+template <class K, class V>
+inline V *
+FlatHashMap<K, V>::findp(const K &key) const
+{
+    size_t i = find_slot(key);
+    return i < _nbuckets ? &_slots[i].value : 0;
+}
+
+template <class K, class V>
+inline const V &
+FlatHashMap<K, V>::find(const K &key, const V &default_value) const
+{
+    size_t i = find_slot(key);
+    return i < _nbuckets ? _slots[i].value : default_value;
+}
+
+template <class K, class V>
+inline const V &
+FlatHashMap<K, V>::find(const K &key) const
+{
+    return find(key, _default_value);
+}
+
+template <class K, class V>
+inline const V &
+FlatHashMap<K, V>::operator[](const K &key) const
+{
+    return find(key);
+}
+
+template <class K, class V>
+inline
+FlatHashMap_const_iterator<K, V>::FlatHashMap_const_iterator(const FlatHashMap<K, V> *hm, bool begin)
+    : _hm(hm), _i(hm->_nbuckets)
+{
+    if (begin && hm->_n)
+	for (_i = 0; !hm->_hash[_i]; ++_i)
+	    /* nada */;
+}
+
+template <class K, class V>
+inline void
+FlatHashMap_const_iterator<K, V>::operator++()
+{
+    while (++_i < _hm->_nbuckets && !_hm->_hash[_i])
+	/* nada */;
+}
+
+template <class K, class V>
+inline typename FlatHashMap<K, V>::const_iterator
+FlatHashMap<K, V>::begin() const
+{
+    return const_iterator(this, true);
+}
+
+template <class K, class V>
+inline typename FlatHashMap<K, V>::iterator
+FlatHashMap<K, V>::begin()
+{
+    return iterator(this, true);
+}
+
+template <class K, class V>
+inline typename FlatHashMap<K, V>::const_iterator
+FlatHashMap<K, V>::end() const
+{
+    return const_iterator(this, false);
+}
+
+template <class K, class V>
+inline typename FlatHashMap<K, V>::iterator
+FlatHashMap<K, V>::end()
+{
+    return iterator(this, false);
+}
+
+template <class K, class V>
+inline bool
+operator==(const FlatHashMap_const_iterator<K, V> &a, const FlatHashMap_const_iterator<K, V> &b)
+{
+    return a.pair() == b.pair();
+}
+
+template <class K, class V>
+inline bool
+operator!=(const FlatHashMap_const_iterator<K, V> &a, const FlatHashMap_const_iterator<K, V> &b)
+{
+    return a.pair() != b.pair();
+}
+
+CLICK_ENDDECLS
+#include <click/flathashmap.cc>
+#endif
@@ -106,6 +106,44 @@ void click_lfree(volatile void *p, size_t size);
 #endif
 
 
+// PREFETCH
+
+// Hints that the memory at p will soon be read.  Never faults, so p may be
+// any address.
+#if __GNUC__ >= 3
+# define CLICK_PREFETCH(p)	__builtin_prefetch((p), 0)
+#else
+# define CLICK_PREFETCH(p)	((void) (p))
+#endif
+
+
+// MEMORY ORDERING
+
+// click_compiler_fence() keeps the compiler from moving memory accesses
+// across it. click_fence() also orders them for other processors.
+// click_write_fence() orders the stores before it before the stores after
+// it, as when filling a structure before publishing a pointer to it;
+// click_read_fence() orders the loads before it before the loads after it,
+// as when reading such a pointer and then the structure. x86 processors keep
+// stores in order and loads in order, so there the last two only restrain
+// the compiler.
+#define click_compiler_fence()	asm volatile("" : : : "memory")
+#if CLICK_LINUXMODULE
+# define click_fence()		smp_mb()
+# define click_write_fence()	smp_wmb()
+# define click_read_fence()	smp_rmb()
+#else
+# define click_fence()		__sync_synchronize()
+# if defined(__i386__) || defined(__x86_64__)
+#  define click_write_fence()	click_compiler_fence()
+#  define click_read_fence()	click_compiler_fence()
+# else
+#  define click_write_fence()	click_fence()
+#  define click_read_fence()	click_fence()
+# endif
+#endif
+
+
 // RANDOMNESS
 
 CLICK_DECLS
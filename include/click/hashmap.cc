@@ -34,6 +34,9 @@ HashMap<K, V>::initialize(HashMap_ArenaFactory *factory, size_t initial_nbuckets
   for (size_t i = 0; i < _nbuckets; i++)
     _buckets[i] = 0;
   set_dynamic_resizing(true);
+  _old_buckets = 0;
+  _old_nbuckets = _migrated = 0;
+  _incremental = false;
 
   _n = 0;
 
@@ -72,6 +75,16 @@ HashMap<K, V>::copy_from(const HashMap<K, V> &o)
       pprev = &ee->next;
     }
   }
+  // what o has yet to move goes straight to its place here
+  for (size_t i = o._migrated; i < o._old_nbuckets; i++)
+    for (const Elt *e = o._old_buckets[i]; e; e = e->next) {
+      Elt *ee = reinterpret_cast<Elt *>(_arena->alloc());
+      new(reinterpret_cast<void *>(&ee->key)) K(e->key);
+      new(reinterpret_cast<void *>(&ee->value)) V(e->value);
+      size_t b = bucket(e->key);
+      ee->next = _buckets[b];
+      _buckets[b] = ee;
+    }
   _n = o._n;
 }
 
@@ -79,7 +92,8 @@ template <class K, class V>
 HashMap<K, V>::HashMap(const HashMap<K, V> &o)
     : _buckets((Elt **) CLICK_LALLOC(o._nbuckets * sizeof(Elt *))),
       _nbuckets(o._nbuckets), _default_value(o._default_value),
-      _capacity(o._capacity), _arena(o._arena)
+      _capacity(o._capacity), _arena(o._arena), _old_buckets(0),
+      _old_nbuckets(0), _migrated(0), _incremental(o._incremental)
 {
   _arena->use();
   copy_from(o);
@@ -104,6 +118,7 @@ HashMap<K, V>::operator=(const HashMap<K, V> &o)
 template <class K, class V>
 HashMap<K, V>::~HashMap()
 {
+  finish_resize();
   for (size_t i = 0; i < _nbuckets; i++)
     for (Elt *e = _buckets[i]; e; ) {
       Elt *next = e->next;
@@ -128,6 +143,15 @@ HashMap<K, V>::set_dynamic_resizing(bool on)
     _capacity = DEFAULT_RESIZE_THRESHOLD * _nbuckets;
 }
 
+template <class K, class V>
+void
+HashMap<K, V>::set_incremental_resizing(bool on)
+{
+  if (!on)
+    finish_resize();
+  _incremental = on;
+}
+
 template <class K, class V>
 void
 HashMap<K, V>::set_arena(HashMap_ArenaFactory *factory)
@@ -163,13 +187,31 @@ HashMap<K, V>::find_pair(const K &key) const
       }
       return e;
     }
-  return 0;
 #else
   for (Elt *e = _buckets[bucket(key)]; e; e = e->next)
     if (e->key == key)
       return e;
-  return 0;
 #endif
+  if (_old_buckets)
+    for (Elt *e = _old_buckets[((size_t) hashcode(key)) % _old_nbuckets]; e; e = e->next)
+      if (e->key == key)
+	return e;
+  return 0;
+}
+
+template <class K, class V>
+typename HashMap<K, V>::Elt **
+HashMap<K, V>::find_link(const K &key)
+{
+  Elt **pprev = &_buckets[bucket(key)];
+  for (; *pprev; pprev = &(*pprev)->next)
+    if ((*pprev)->key == key)
+      return pprev;
+  if (_old_buckets)
+    for (pprev = &_old_buckets[((size_t) hashcode(key)) % _old_nbuckets]; *pprev; pprev = &(*pprev)->next)
+      if ((*pprev)->key == key)
+	return pprev;
+  return 0;
 }
 
 
@@ -177,6 +219,7 @@ template <class K, class V>
 void
 HashMap<K, V>::resize0(size_t new_nbuckets)
 {
+    finish_resize();
     Elt **new_buckets = (Elt **) CLICK_LALLOC(new_nbuckets * sizeof(Elt *));
     for (size_t i = 0; i < new_nbuckets; i++)
 	new_buckets[i] = 0;
@@ -212,22 +255,67 @@ HashMap<K, V>::resize(size_t want_nbuckets)
     resize0(new_nbuckets);
 }
 
+// moves the next n buckets of the old table, if any, to the new one
 template <class K, class V>
-bool
-HashMap<K, V>::insert(const K &key, const V &value)
+void
+HashMap<K, V>::migrate(size_t n)
 {
-  size_t b = bucket(key);
-  for (Elt *e = _buckets[b]; e; e = e->next)
-    if (e->key == key) {
-      e->value = value;
-      return false;
+  for (; n > 0 && _migrated < _old_nbuckets; n--, _migrated++) {
+    for (Elt *e = _old_buckets[_migrated]; e; ) {
+      Elt *next = e->next;
+      size_t b = bucket(e->key);
+      e->next = _buckets[b];
+      _buckets[b] = e;
+      e = next;
     }
+    _old_buckets[_migrated] = 0;
+  }
+  if (_old_buckets && _migrated == _old_nbuckets) {
+    CLICK_LFREE(_old_buckets, _old_nbuckets * sizeof(Elt *));
+    _old_buckets = 0;
+    _old_nbuckets = _migrated = 0;
+  }
+}
 
-  if (_n >= _capacity) {
+// the table reached its capacity: resize it, at once or incrementally
+template <class K, class V>
+void
+HashMap<K, V>::grow()
+{
+  if (!_incremental) {
     resize(_nbuckets + 1);
-    b = bucket(key);
+    return;
+  }
+  finish_resize();
+  size_t new_nbuckets = ((_nbuckets + 1) << 1) - 1;
+  if (new_nbuckets > MAX_NBUCKETS)
+    new_nbuckets = MAX_NBUCKETS;
+  if (new_nbuckets == _nbuckets)
+    return;
+  _old_buckets = _buckets;
+  _old_nbuckets = _nbuckets;
+  _migrated = 0;
+  _buckets = (Elt **) CLICK_LALLOC(new_nbuckets * sizeof(Elt *));
+  for (size_t i = 0; i < new_nbuckets; i++)
+    _buckets[i] = 0;
+  _nbuckets = new_nbuckets;
+  set_dynamic_resizing(true);	// reset threshold
+}
+
+template <class K, class V>
+bool
+HashMap<K, V>::insert(const K &key, const V &value)
+{
+  if (Pair *p = find_pair(key)) {
+    p->value = value;
+    return false;
   }
 
+  migrate(INCREMENTAL_STEP);
+  if (_n >= _capacity)
+    grow();
+  size_t b = bucket(key);
+
   if (Elt *e = reinterpret_cast<Elt *>(_arena->alloc())) {
     new(reinterpret_cast<void *>(&e->key)) K(key);
     new(reinterpret_cast<void *>(&e->value)) V(value);
@@ -242,18 +330,9 @@ template <class K, class V>
 bool
 HashMap<K, V>::erase(const K &key)
 {
-  size_t b = bucket(key);
-  Elt *prev = 0;
-  Elt *e = _buckets[b];
-  while (e && !(e->key == key)) {
-    prev = e;
-    e = e->next;
-  }
-  if (e) {
-    if (prev)
-      prev->next = e->next;
-    else
-      _buckets[b] = e->next;
+  if (Elt **pprev = find_link(key)) {
+    Elt *e = *pprev;
+    *pprev = e->next;
     e->key.~K();
     e->value.~V();
     _arena->free(e);
@@ -267,14 +346,12 @@ template <class K, class V>
 typename HashMap<K, V>::Pair *
 HashMap<K, V>::find_pair_force(const K &key, const V &default_value)
 {
+  if (Pair *p = find_pair(key))
+    return p;
+  migrate(INCREMENTAL_STEP);
+  if (_n >= _capacity)
+    grow();
   size_t b = bucket(key);
-  for (Elt *e = _buckets[b]; e; e = e->next)
-    if (e->key == key)
-      return e;
-  if (_n >= _capacity) {
-    resize(_nbuckets + 1);
-    b = bucket(key);
-  }
   if (Elt *e = reinterpret_cast<Elt *>(_arena->alloc())) {
     new(reinterpret_cast<void *>(&e->key)) K(key);
     new(reinterpret_cast<void *>(&e->value)) V(default_value);
@@ -290,6 +367,7 @@ template <class K, class V>
 void
 HashMap<K, V>::clear()
 {
+  finish_resize();
   for (size_t i = 0; i < _nbuckets; i++) {
     for (Elt *e = _buckets[i]; e; ) {
       Elt *next = e->next;
@@ -320,17 +398,21 @@ HashMap<K, V>::swap(HashMap<K, V> &o)
   t_size = _capacity; _capacity = o._capacity; o._capacity = t_size;
 
   t_arena = _arena; _arena = o._arena; o._arena = t_arena;
+
+  t_elts = _old_buckets; _old_buckets = o._old_buckets; o._old_buckets = t_elts;
+  t_size = _old_nbuckets; _old_nbuckets = o._old_nbuckets; o._old_nbuckets = t_size;
+  t_size = _migrated; _migrated = o._migrated; o._migrated = t_size;
+  bool t_incremental = _incremental; _incremental = o._incremental; o._incremental = t_incremental;
 }
 
 template <class K, class V>
 _HashMap_const_iterator<K, V>::_HashMap_const_iterator(const HashMap<K, V> *hm, bool begin)
   : _hm(hm)
 {
-  size_t nb = _hm->_nbuckets;
-  typename HashMap<K, V>::Elt **b = _hm->_buckets;
+  size_t nb = _hm->_nbuckets + _hm->_old_nbuckets;
   for (_bucket = 0; _bucket < nb && begin; _bucket++)
-    if (b[_bucket]) {
-      _elt = b[_bucket];
+    if (typename HashMap<K, V>::Elt *e = _hm->bucket_head(_bucket)) {
+      _elt = e;
       return;
     }
   _elt = 0;
@@ -343,11 +425,10 @@ _HashMap_const_iterator<K, V>::operator++(int)
   if (_elt->next)
     _elt = _elt->next;
   else {
-    size_t nb = _hm->_nbuckets;
-    typename HashMap<K, V>::Elt **b = _hm->_buckets;
+    size_t nb = _hm->_nbuckets + _hm->_old_nbuckets;
     for (_bucket++; _bucket < nb; _bucket++)
-      if (b[_bucket]) {
-	_elt = b[_bucket];
+      if (typename HashMap<K, V>::Elt *e = _hm->bucket_head(_bucket)) {
+	_elt = e;
 	return;
       }
     _elt = 0;
@@ -74,6 +74,13 @@ class HashMap { public:
   bool dynamic_resizing() const		{ return _capacity < 0x7FFFFFFF; }
   void set_dynamic_resizing(bool);
 
+  // incremental resizing: a dynamic resize moves INCREMENTAL_STEP buckets
+  // to the new table at each insertion, rather than all of them at once, so
+  // no single insertion pays for the whole table. Lookups and erasures
+  // search both tables meanwhile; erasing while iterating stays safe
+  bool incremental_resizing() const	{ return _incremental; }
+  void set_incremental_resizing(bool);
+
   HashMap<K, V> &operator=(const HashMap<K, V> &);
 
   struct Pair {
@@ -83,7 +90,8 @@ class HashMap { public:
 
   enum { MAX_NBUCKETS = 4194303,
 	 DEFAULT_INITIAL_NBUCKETS = 127,
-	 DEFAULT_RESIZE_THRESHOLD = 2 };
+	 DEFAULT_RESIZE_THRESHOLD = 2,
+	 INCREMENTAL_STEP = 8 };
 
  private:
 
@@ -104,10 +112,25 @@ class HashMap { public:
 
   HashMap_Arena *_arena;
 
+  // while an incremental resize is under way, the buckets of the table
+  // before it; those below _migrated are empty
+  Elt **_old_buckets;
+  size_t _old_nbuckets;
+  size_t _migrated;
+  bool _incremental;
+
   void initialize(HashMap_ArenaFactory *, size_t);
   void copy_from(const HashMap<K, V> &);
   void resize0(size_t);
+  void grow();
+  void migrate(size_t);
+  void finish_resize()			{ if (_old_buckets) migrate(_old_nbuckets); }
   size_t bucket(const K &) const;
+  Elt **find_link(const K &);
+  // bucket i of the new table followed by the old one
+  Elt *bucket_head(size_t i) const {
+    return i < _nbuckets ? _buckets[i] : _old_buckets[i - _nbuckets];
+  }
 
   friend class _HashMap_iterator<K, V>;
   friend class _HashMap_const_iterator<K, V>;
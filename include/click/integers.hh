@@ -177,6 +177,25 @@ int ffs_lsb(uint64_t x);
 #endif
 
 
+/** @brief Return the number of bits set in @a x.
+ *
+ * Uses the processor's population count instruction where the compiler
+ * may emit it (x86 with -mpopcnt, ARM64); elsewhere __builtin_popcount
+ * would become a library call, so this counts in registers instead.
+ */
+#if (defined(__POPCNT__) || defined(__aarch64__)) && !HAVE_NO_INTEGER_BUILTINS
+inline int popcount(uint32_t x) {
+    return __builtin_popcount(x);
+}
+#else
+inline int popcount(uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555U);
+    x = (x & 0x33333333U) + ((x >> 2) & 0x33333333U);
+    return (((x + (x >> 4)) & 0x0F0F0F0FU) * 0x01010101U) >> 24;
+}
+#endif
+
+
 /** @brief Return the integer approximation of @a x's square root.
  * @return The integer @a y where @a y*@a y <= @a x, but
  * (@a y+1)*(@a y+1) > @a x.
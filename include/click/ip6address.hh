@@ -102,6 +102,11 @@ class IP6Address { public:
     String unparse() const;
     String unparse_expanded() const;
 
+    enum {
+	unparse_buflen = 48	///< Buffer size for unparse(char *).
+    };
+    char *unparse(char *buf) const;
+
     String s() const			{ return unparse(); }
     inline operator String() const CLICK_DEPRECATED;
 
@@ -269,7 +274,7 @@ IP6Address::operator=(const click_in6_addr &a)
 inline uint32_t
 IP6Address::hashcode() const
 {
-    return (data32()[3] << 1) + data32()[4];
+    return (data32()[2] << 1) + data32()[3];
 }
 
 #if !CLICK_TOOL
@@ -9,6 +9,15 @@ CLICK_DECLS
 // IP6 routing table.
 // Lookup by longest prefix.
 // Each entry contains a gateway and an output index.
+//
+// Routes whose mask is a prefix live in a path-compressed binary trie:
+// every node holds a prefix, at most one route for exactly that prefix and
+// the two subtries that continue it with a 0 and a 1 bit, and nodes with
+// neither a route nor two children are merged away. A lookup follows one
+// path from the root, comparing whole prefixes rather than single bits,
+// so it visits at most one node per route prefix of the address; add()
+// and del() change one path the same way. The few routes whose masks are
+// not prefixes are searched linearly as before.
 
 class IP6Table { public:
 
@@ -19,7 +28,7 @@ class IP6Table { public:
 
   void add(const IP6Address &dst, const IP6Address &mask, const IP6Address &gw, int index);
   void del(const IP6Address &dst, const IP6Address &mask);
-  void clear()				{ _v.clear(); }
+  void clear();
   String dump();
 
  private:
@@ -33,6 +42,30 @@ class IP6Table { public:
   };
   Vector<Entry> _v;
 
+  struct Node {
+    IP6Address _prefix;		// masked to _len bits
+    IP6Address _mask;		// of _len bits
+    int _len;
+    int _entry;			// in _v, or -1
+    int _child[2];		// in _nodes, or -1
+  };
+  Vector<Node> _nodes;
+  int _root;
+  int _free_node;		// list through _child[0]
+  int _free_entry;		// in _v, list through _index
+  Vector<int> _odd;		// entries whose mask is not a prefix
+
+  int new_node(const IP6Address &prefix, int len, int entry);
+  void set_child(int parent, int dir, int n);
+  bool merge_node(int parent, int dir, int n);
+  int new_entry(const Entry &e);
+  void free_entry(int i);
+
+  static int bit(const IP6Address &a, int i) {
+    return (a.data()[i >> 3] >> (7 - (i & 7))) & 1;
+  }
+  static int common_len(const IP6Address &a, const IP6Address &b, int max);
+
 };
 
 CLICK_ENDDECLS
@@ -112,6 +112,13 @@ class IPAddress { public:
     String unparse_mask() const;
     String unparse_with_mask(IPAddress) const;
 
+    enum {
+	unparse_buflen = 16,	///< Buffer size for unparse(char *).
+	unparse_with_mask_buflen = 32 ///< Buffer size for unparse_with_mask(char *, IPAddress).
+    };
+    char *unparse(char *buf) const;
+    char *unparse_with_mask(char *buf, IPAddress mask) const;
+
     inline String s() const;
     inline operator String() const CLICK_DEPRECATED;
 
@@ -43,6 +43,7 @@ class NameInfo { public:
 	T_SCRIPT_INSN = 0x00000003,	///< Script instruction names database
 	T_SIGNO = 0x00000004,		///< User-level signal names database
 	T_SPINLOCK = 0x00000005,	///< Spinlock names database
+	T_SCHEDULEINFO_DEADLINE = 0x00000006, ///< ScheduleInfo deadline database
 	T_ETHERNET_ADDR = 0x01000001,	///< Ethernet address names database
 	T_IP_ADDR = 0x04000001,		///< IP address names database
 	T_IP_PREFIX = 0x04000002,	///< IP prefix names database
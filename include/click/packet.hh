@@ -56,6 +56,10 @@ class Packet { public:
 #endif
 
     inline void kill();
+#if HAVE_CLICK_PACKET_POOL
+    static void pool_report(StringAccum &sa);
+    static void pool_arena(size_t node_size);
+#endif
 
     inline bool shared() const;
     Packet *clone() CLICK_WARN_UNUSED_RESULT;
@@ -676,6 +680,9 @@ class Packet { public:
     static WritablePacket *make(int, int, int);
     bool alloc_data(uint32_t, uint32_t, uint32_t);
 #endif
+#if HAVE_CLICK_PACKET_POOL
+    void recycle();
+#endif
 #if CLICK_BSDMODULE
     static void assimilate_mbuf(Packet *p);
     void assimilate_mbuf();
@@ -1234,8 +1241,8 @@ Packet::make(struct sk_buff *skb)
 /** @brief Delete this packet.
  *
  * The packet header (including annotations) is destroyed and its memory
- * returned to the system.  The packet's data is also freed if this is the
- * last clone. */
+ * returned to the system, or to the packet pool if HAVE_CLICK_PACKET_POOL is
+ * defined.  The packet's data is also freed if this is the last clone. */
 inline void
 Packet::kill()
 {
@@ -1248,7 +1255,11 @@ Packet::kill()
     skbmgr_recycle_skbs(b);
 #else
     if (_use_count.dec_and_test())
+# if HAVE_CLICK_PACKET_POOL
+	recycle();
+# else
 	delete this;
+# endif
 #endif
 }
 
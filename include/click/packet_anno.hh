@@ -28,6 +28,12 @@
 #define ICMP_PARAMPROB_ANNO(p)		((p)->anno_u8(ICMP_PARAMPROB_ANNO_OFFSET))
 #define SET_ICMP_PARAMPROB_ANNO(p, v)	((p)->set_anno_u8(ICMP_PARAMPROB_ANNO_OFFSET, (v)))
 
+// byte 18
+#define OLSR_DUPLICATE_ANNO_OFFSET	18
+#define OLSR_DUPLICATE_ANNO_SIZE	1
+#define OLSR_DUPLICATE_ANNO(p)		((p)->anno_u8(OLSR_DUPLICATE_ANNO_OFFSET))
+#define SET_OLSR_DUPLICATE_ANNO(p, v)	((p)->set_anno_u8(OLSR_DUPLICATE_ANNO_OFFSET, (v)))
+
 // byte 19
 #define FIX_IP_SRC_ANNO_OFFSET		19
 #define FIX_IP_SRC_ANNO_SIZE		1
@@ -35,6 +41,11 @@
 #define SET_FIX_IP_SRC_ANNO(p, v)	((p)->set_anno_u8(FIX_IP_SRC_ANNO_OFFSET, (v)))
 
 // bytes 20-23
+#define OLSR_DUPLICATE_GEN_ANNO_OFFSET	20
+#define OLSR_DUPLICATE_GEN_ANNO_SIZE	4
+#define OLSR_DUPLICATE_GEN_ANNO(p)	((p)->anno_u32(OLSR_DUPLICATE_GEN_ANNO_OFFSET))
+#define SET_OLSR_DUPLICATE_GEN_ANNO(p, v) ((p)->set_anno_u32(OLSR_DUPLICATE_GEN_ANNO_OFFSET, (v)))
+
 #define AGGREGATE_ANNO_OFFSET		20
 #define AGGREGATE_ANNO_SIZE		4
 #define AGGREGATE_ANNO(p)		((p)->anno_u32(AGGREGATE_ANNO_OFFSET))
@@ -50,6 +61,12 @@
 #define MISC_IP_ANNO(p)                 ((p)->anno_u32(MISC_IP_ANNO_OFFSET))
 #define SET_MISC_IP_ANNO(p, v)		((p)->set_anno_u32(MISC_IP_ANNO_OFFSET, (v).addr()))
 
+// bytes 24-27 or 24-31, a pointer
+#define OLSR_DUPLICATE_TUPLE_ANNO_OFFSET 24
+#define OLSR_DUPLICATE_TUPLE_ANNO_SIZE	SIZEOF_VOID_P
+#define OLSR_DUPLICATE_TUPLE_ANNO(p)	(*(reinterpret_cast<void * const *>((p)->anno_u8() + OLSR_DUPLICATE_TUPLE_ANNO_OFFSET)))
+#define SET_OLSR_DUPLICATE_TUPLE_ANNO(p, v) (*(reinterpret_cast<void **>((p)->anno_u8() + OLSR_DUPLICATE_TUPLE_ANNO_OFFSET)) = (v))
+
 // bytes 24-27
 #define EXTRA_PACKETS_ANNO_OFFSET	24
 #define EXTRA_PACKETS_ANNO_SIZE		4
@@ -0,0 +1,115 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_PACKETBATCH_HH
+#define CLICK_PACKETBATCH_HH
+#include <click/packet.hh>
+CLICK_DECLS
+
+/** @file <click/packetbatch.hh>
+ * @brief A list of packets passed between elements in one call.
+ */
+
+/** @class PacketBatch
+ * @brief A first-in-first-out list of packets.
+ *
+ * A PacketBatch links its packets through their next() annotations, so
+ * building and emptying one never allocates.  Elements pass batches with
+ * Element::Port::push_batch() and Element::Port::pull_batch(); see
+ * Element::push_batch() for the rules.
+ *
+ * A PacketBatch does not own its packets: destroying a batch that still
+ * holds some leaks them.  Push them on, or free them with kill().  The
+ * next() annotation of a packet in a batch belongs to the batch, and
+ * pop_front() clears it again. */
+class PacketBatch { public:
+
+    /** @brief Construct an empty batch. */
+    inline PacketBatch()
+	: _head(0), _tail(0), _count(0) {
+    }
+
+    /** @brief Return true iff the batch holds no packets. */
+    inline bool empty() const {
+	return !_head;
+    }
+
+    /** @brief Return the number of packets in the batch. */
+    inline unsigned count() const {
+	return _count;
+    }
+
+    /** @brief Return the first packet in the batch, or null. */
+    inline Packet *front() const {
+	return _head;
+    }
+
+    /** @brief Return the last packet in the batch, or null. */
+    inline Packet *back() const {
+	return _tail;
+    }
+
+    /** @brief Add @a p at the end of the batch. */
+    inline void push_back(Packet *p) {
+	p->next() = 0;
+	if (_tail)
+	    _tail->next() = p;
+	else
+	    _head = p;
+	_tail = p;
+	++_count;
+    }
+
+    /** @brief Move all of @a b's packets to the end of this batch.
+     *
+     * @a b is left empty. */
+    inline void append(PacketBatch &b) {
+	if (!b._head)
+	    return;
+	if (_tail)
+	    _tail->next() = b._head;
+	else
+	    _head = b._head;
+	_tail = b._tail;
+	_count += b._count;
+	b.clear();
+    }
+
+    /** @brief Remove the first packet from the batch and return it.
+     *
+     * Returns null if the batch is empty.  The returned packet's next()
+     * annotation is null. */
+    inline Packet *pop_front() {
+	Packet *p = _head;
+	if (p) {
+	    if (!(_head = p->next()))
+		_tail = 0;
+	    p->next() = 0;
+	    --_count;
+	}
+	return p;
+    }
+
+    /** @brief Forget the batch's packets without freeing them. */
+    inline void clear() {
+	_head = _tail = 0;
+	_count = 0;
+    }
+
+    /** @brief Free all of the batch's packets; the batch becomes empty. */
+    inline void kill() {
+	while (Packet *p = pop_front())
+	    p->kill();
+    }
+
+  private:
+
+    Packet *_head;
+    Packet *_tail;
+    unsigned _count;
+
+    PacketBatch(const PacketBatch &);
+    PacketBatch &operator=(const PacketBatch &);
+
+};
+
+CLICK_ENDDECLS
+#endif
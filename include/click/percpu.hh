@@ -0,0 +1,136 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_PERCPU_HH
+#define CLICK_PERCPU_HH
+#include <click/glue.hh>
+CLICK_DECLS
+
+/** @file <click/percpu.hh>
+ * @brief A statistics counter kept per processor.
+ */
+
+#if HAVE_MULTITHREAD && !CLICK_LINUXMODULE
+/** @brief Return a small number for the calling thread, 0 for the first
+ * thread that asks, 1 for the next, and so on. */
+inline unsigned
+click_percpu_thread()
+{
+    static __thread unsigned number;	// 0 until assigned
+    static unsigned next_number;
+    if (unlikely(!number))
+	number = __sync_add_and_fetch(&next_number, 1);
+    return number - 1;
+}
+#endif
+
+/** @class PerCPUCounter
+  @brief Counter that threads update without sharing a cache line.
+
+  A counter that several RouterThreads update on every packet, like
+  Counter's, bounces its cache line between their processors at every
+  update, whether or not the update is atomic.  PerCPUCounter<T> keeps one
+  slot per processor instead, each on a cache line of its own: add() only
+  touches the calling processor's slot, and value() sums all slots.  Reads
+  are therefore the expensive side, which suits statistics read by
+  handlers.
+
+  At user level, each thread takes a slot of its own the first time it
+  adds, and updates it with plain arithmetic; threads beyond the first
+  nslots - 1 share the last slot, and update it atomically.  In the Linux
+  kernel, slots are indexed by processor and updated atomically, as a
+  thread may change processors between reading and writing its slot.
+  Without multithreading there is a single slot, and a PerCPUCounter costs
+  what a T costs.
+
+  As with any counter updated without a lock, value() racing add() may
+  miss the latest additions, and clear() or set() racing add() may lose
+  them.  T should be an integer type the processor reads and writes in one
+  access. */
+template <typename T>
+class PerCPUCounter { public:
+
+#if HAVE_MULTITHREAD
+    enum { nslots = 16, line_size = 64 };
+#else
+    enum { nslots = 1 };
+#endif
+
+    /** @brief Construct a counter with value 0. */
+    PerCPUCounter() {
+	clear();
+    }
+
+    /** @brief Add @a delta to the counter. */
+    inline void add(T delta);
+
+    void operator++()				{ add(1); }
+    void operator++(int)			{ add(1); }
+    PerCPUCounter<T> &operator+=(T delta)	{ add(delta); return *this; }
+
+    /** @brief Return the counter's value, the sum of all slots. */
+    inline T value() const;
+    operator T() const				{ return value(); }
+
+    /** @brief Set the counter to 0. */
+    void clear() {
+	for (int i = 0; i < nslots; i++)
+	    slot(i) = 0;
+    }
+
+    /** @brief Set the counter to @a x. */
+    void set(T x) {
+	clear();
+	slot(0) = x;
+    }
+
+  private:
+
+#if HAVE_MULTITHREAD
+    // nslots lines, wherever the first line boundary in _mem falls
+    char _mem[(nslots + 1) * line_size];
+
+    T &slot(int i) const {
+	uintptr_t base = ((uintptr_t) _mem + line_size - 1) & ~(uintptr_t) (line_size - 1);
+	return *reinterpret_cast<T *>(base + i * line_size);
+    }
+#else
+    mutable T _value;
+
+    T &slot(int) const {
+	return _value;
+    }
+#endif
+
+    PerCPUCounter(const PerCPUCounter<T> &);
+    PerCPUCounter<T> &operator=(const PerCPUCounter<T> &);
+
+};
+
+template <typename T>
+inline void
+PerCPUCounter<T>::add(T delta)
+{
+#if HAVE_MULTITHREAD && CLICK_LINUXMODULE
+    __sync_fetch_and_add(&slot(click_current_processor() % nslots), delta);
+#elif HAVE_MULTITHREAD
+    unsigned n = click_percpu_thread();
+    if (likely(n < nslots - 1))
+	slot(n) += delta;
+    else
+	__sync_fetch_and_add(&slot(nslots - 1), delta);
+#else
+    slot(0) += delta;
+#endif
+}
+
+template <typename T>
+inline T
+PerCPUCounter<T>::value() const
+{
+    T sum = slot(0);
+    for (int i = 1; i < nslots; i++)
+	sum += slot(i);
+    return sum;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,97 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/profiler.cc" -*-
+#ifndef CLICK_PROFILER_HH
+#define CLICK_PROFILER_HH
+#include <click/glue.hh>
+CLICK_DECLS
+class Element;
+class String;
+class StringAccum;
+class ErrorHandler;
+
+/** @file <click/profiler.hh>
+ * @brief Router-wide profile of the cycles spent behind each element port.
+ */
+
+#if HAVE_ELEMENT_PROFILE
+
+/** @class ElementProfiler
+  @brief Cycles and packets by element port and call path.
+
+  A user-level driver configured with --enable-element-profile can measure,
+  at run time, where its router threads spend their cycles.
+  Element::Port::push(), pull() and their batch forms, Task::fire() and the
+  Master's timer loop call enter() before they pass control to an element
+  and leave() after.  While the profiler is off, enter() costs one load and
+  one predicted branch.
+
+  While it is on, each thread keeps a call tree of its own: one node per
+  path of calls from a task or timer down to an element port, with the
+  number of calls and packets through it, the cycles spent in it
+  (click_get_cycles) and the cycles spent in the calls it made, so that the
+  difference is the element's own.  Optionally a hardware event selected
+  with set_event(), such as instructions or cache misses, is counted the
+  same way through perf_event_open; reading it costs a system call per
+  enter() and leave(), so it perturbs what it measures far more than the
+  cycle counter does.
+
+  The profile is read through global handlers: "profile" sums the nodes by
+  element port into a table sorted by own cycles, and "profile_folded"
+  writes one line per call path, its frames separated by semicolons and
+  followed by the path's own cycles, as the flame graph scripts take them.
+  "profile_active" switches the profiler on and off, "profile_event"
+  selects the hardware event, and "profile_reset" discards the profile.
+  Each thread discards its own tree the next time it enters an element, so
+  that readers never see a tree freed under them; a router being deleted
+  resets the profile as well. */
+class ElementProfiler { public:
+
+    enum Kind { PUSH, PULL, TASK, TIMER };
+    enum { MAX_DEPTH = 64 };
+
+    struct Frame;
+
+    /** @brief Account the call of @a e's @a port that is about to start.
+     *
+     * Returns the frame to hand to leave(), or null while the profiler is
+     * off.  @a port is ignored for tasks and timers. */
+    static inline Frame *enter(Element *e, int port, int kind);
+
+    /** @brief End the call started with @a frame, which moved @a packets. */
+    static inline void leave(Frame *frame, unsigned packets);
+
+    static bool active()			{ return _active; }
+    static void set_active(bool active)	{ _active = active; }
+    static int set_event(const String &name, ErrorHandler *errh);
+    static void reset();
+
+    static void unparse_table(StringAccum &sa);
+    static void unparse_folded(StringAccum &sa);
+
+    static void add_handlers();
+
+  private:
+
+    static volatile bool _active;
+
+    static Frame *enter_slow(Element *e, int port, int kind);
+    static void leave_slow(Frame *frame, unsigned packets);
+
+};
+
+inline ElementProfiler::Frame *
+ElementProfiler::enter(Element *e, int port, int kind)
+{
+    return unlikely(_active) ? enter_slow(e, port, kind) : 0;
+}
+
+inline void
+ElementProfiler::leave(Frame *frame, unsigned packets)
+{
+    if (unlikely(frame != 0))
+	leave_slow(frame, packets);
+}
+
+#endif
+
+CLICK_ENDDECLS
+#endif
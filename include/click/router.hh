@@ -6,6 +6,7 @@
 #include <click/sync.hh>
 #include <click/task.hh>
 #include <click/standard/threadsched.hh>
+#include <click/hashtable.hh>
 #if CLICK_NS
 # include <click/simclick.h>
 #endif
@@ -122,6 +123,7 @@ class Router { public:
     void add_requirement(const String& requirement);
     int add_element(Element *e, const String &name, const String &conf, const String &filename, unsigned lineno);
     int add_connection(int from_idx, int from_port, int to_idx, int to_port);
+    Router *clone(const Vector<Element *> &elements, Master *master) const;
 #if CLICK_LINUXMODULE
     int add_module_ref(struct module* module);
 #endif
@@ -246,7 +248,8 @@ class Router { public:
     Vector<element_landmark_t> _element_landmarks;
     uint32_t _last_landmarkid;
 
-    mutable Vector<int> _element_name_sorter;
+    mutable HashTable<String, int> _element_name_map;
+    mutable int _element_name_map_size;	// elements entered in the map
     Vector<int> _element_gport_offset[2];
     Vector<int> _element_configure_order;
 
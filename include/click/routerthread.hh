@@ -3,6 +3,7 @@
 #define CLICK_ROUTERTHREAD_HH
 #include <click/sync.hh>
 #include <click/vector.hh>
+#include <click/timerset.hh>
 #if CLICK_LINUXMODULE
 # include <click/cxxprotect.h>
 CLICK_CXX_PROTECT
@@ -54,6 +55,8 @@ class RouterThread
     inline void unblock_tasks();
 
     inline Master* master() const;
+    TimerSet &timer_set()		{ return _timers; }
+    const TimerSet &timer_set() const	{ return _timers; }
     void driver();
     void driver_once();
 
@@ -75,11 +78,23 @@ class RouterThread
 
     inline void wake();
 
+    /** @brief Return the number of driver loop iterations so far.
+     *
+     * A thread whose driver epoch has changed since some point in time has
+     * finished every task and timer it was running then. */
+    uint32_t driver_epoch() const	{ return _driver_epoch; }
+
+#if HAVE_MULTITHREAD
+    /** @brief Return the number of tasks this thread has handed to idle
+     * threads asking for work.
+     * @sa Master::set_task_stealing() */
+    uint32_t tasks_given() const	{ return _tasks_given; }
+#endif
+
 #if CLICK_DEBUG_SCHEDULING
     enum { S_RUNNING, S_PAUSED, S_TIMER, S_BLOCKED };
     int thread_state() const		{ return _thread_state; }
     static String thread_state_name(int);
-    uint32_t driver_epoch() const	{ return _driver_epoch; }
     uint32_t driver_task_epoch() const	{ return _driver_task_epoch; }
     Timestamp task_epoch_time(uint32_t epoch) const;
 # if CLICK_LINUXMODULE
@@ -101,6 +116,8 @@ class RouterThread
     Master *_master;
     int _id;
 
+    TimerSet _timers;
+
 #if CLICK_LINUXMODULE
     struct task_struct *_linux_task;
 #elif HAVE_MULTITHREAD
@@ -111,6 +128,9 @@ class RouterThread
     atomic_uint32_t _task_blocker_waiting;
 
     uint32_t _any_pending;
+#if HAVE_MULTITHREAD
+    uint32_t _tasks_given;
+#endif
 
 #if CLICK_LINUXMODULE
     bool _greedy;
@@ -139,9 +159,9 @@ class RouterThread
     unsigned _cur_click_share;		// current Click share
 #endif
 
+    uint32_t _driver_epoch;
 #if CLICK_DEBUG_SCHEDULING
     int _thread_state;
-    uint32_t _driver_epoch;
     uint32_t _driver_task_epoch;
     enum { TASK_EPOCH_BUFSIZ = 32 };
     uint32_t _task_epoch_first;
@@ -160,6 +180,10 @@ class RouterThread
     inline void driver_unlock_tasks();
     inline void run_tasks(int ntasks);
     inline void run_os();
+#if HAVE_MULTITHREAD
+    inline void share_tasks();
+    void give_task(uint32_t requests);
+#endif
 #if HAVE_ADAPTIVE_SCHEDULER
     void client_set_tickets(int client, int tickets);
     inline void client_update_pass(int client, const Timestamp &before, const Timestamp &after);
@@ -171,6 +195,8 @@ class RouterThread
     inline bool current_thread_is_running() const;
 
     friend class Task;
+    friend class Timer;
+    friend class TimerSet;
     friend class Master;
 
 };
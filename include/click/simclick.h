@@ -56,6 +56,18 @@ int simclick_sim_send(simclick_node_t *sim,
 		      simclick_simpacketinfo*);
 
 void simclick_click_run(simclick_node_t *sim);
+/*
+ * simclick_click_run_parallel runs simclick_click_run for each of the
+ * nsims nodes, spread over the worker threads asked for with
+ * SIMCLICK_WORKER_THREADS, and returns when all are done. The nodes must
+ * be distinct and independent at this point of the simulation, typically
+ * those with events due at the same time, and simclick_sim_send and
+ * simclick_sim_command must be safe to call from several threads at once.
+ * Without workers, or in a Click built without --enable-user-multithread,
+ * the nodes run one after the other. As click_random() is shared by all
+ * nodes, a parallel run need not repeat a serial one exactly.
+ */
+void simclick_click_run_parallel(simclick_node_t **sims, int nsims);
 
 void simclick_click_kill(simclick_node_t *sim);
 
@@ -104,6 +116,8 @@ int simclick_gettimeofday(struct timeval* tv);
 #define SIMCLICK_GET_NODE_ID		9  // none
 #define SIMCLICK_GET_NEXT_PKT_ID	10 // none
 #define SIMCLICK_CHANGE_CHANNEL		11 // int ifid, int channelid
+#define SIMCLICK_SHARE_CONFIGURATION	12 // int enable
+#define SIMCLICK_WORKER_THREADS		13 // int nthreads
 
 int simclick_sim_command(simclick_node_t *sim, int cmd, ...);
 int simclick_click_command(simclick_node_t *sim, int cmd, ...);
@@ -0,0 +1,141 @@
+/*
+ * smallvector.{cc,hh} -- array template class with inline storage
+ */
+
+#ifndef CLICK_SMALLVECTOR_CC
+#define CLICK_SMALLVECTOR_CC
+#include <click/glue.hh>
+#include <click/smallvector.hh>
+CLICK_DECLS
+
+template <class T, int N>
+SmallVector<T, N>::~SmallVector()
+{
+    for (size_type i = 0; i < _n; i++)
+	_l[i].~T();
+    if (_l != inline_elts())
+	CLICK_LFREE(_l, sizeof(T) * _capacity);
+}
+
+template <class T, int N> SmallVector<T, N> &
+SmallVector<T, N>::operator=(const SmallVector<T, N> &o)
+{
+    if (&o != this) {
+	for (size_type i = 0; i < _n; i++)
+	    _l[i].~T();
+	_n = 0;
+	if (reserve(o._n)) {
+	    for (size_type i = 0; i < o._n; i++)
+		new((void *) (_l + i)) T(o._l[i]);
+	    _n = o._n;
+	}
+    }
+    return *this;
+}
+
+template <class T, int N> SmallVector<T, N> &
+SmallVector<T, N>::assign(size_type n, const T &e)
+{
+    resize(0, e);
+    resize(n, e);
+    return *this;
+}
+
+template <class T, int N> typename SmallVector<T, N>::iterator
+SmallVector<T, N>::insert(iterator i, const T &e)
+{
+    assert(i >= begin() && i <= end());
+    if (_n == _capacity) {
+	size_type pos = i - begin();
+	if (!reserve(RESERVE_GROW))
+	    return end();
+	i = begin() + pos;
+    }
+    for (iterator j = end(); j > i; ) {
+	--j;
+	new((void *) (j + 1)) T(*j);
+	j->~T();
+    }
+    new((void *) i) T(e);
+    _n++;
+    return i;
+}
+
+template <class T, int N> typename SmallVector<T, N>::iterator
+SmallVector<T, N>::erase(iterator a, iterator b)
+{
+    if (b > a) {
+	assert(a >= begin() && b <= end());
+	iterator i = a, j = b;
+	for (; j < end(); i++, j++) {
+	    i->~T();
+	    new((void *) i) T(*j);
+	}
+	for (; i < end(); i++)
+	    i->~T();
+	_n -= b - a;
+	return a;
+    } else
+	return b;
+}
+
+template <class T, int N> bool
+SmallVector<T, N>::reserve(size_type want)
+{
+    if (want < 0)
+	want = _capacity * 2;
+    if (want <= _capacity)
+	return true;
+
+    T *new_l = (T *) CLICK_LALLOC(sizeof(T) * want);
+    if (!new_l)
+	return false;
+    for (size_type i = 0; i < _n; i++) {
+	new((void *) (new_l + i)) T(_l[i]);
+	_l[i].~T();
+    }
+    if (_l != inline_elts())
+	CLICK_LFREE(_l, sizeof(T) * _capacity);
+
+    _l = new_l;
+    _capacity = want;
+    return true;
+}
+
+template <class T, int N> void
+SmallVector<T, N>::resize(size_type nn, const T &e)
+{
+    if (nn <= _capacity || reserve(nn)) {
+	for (size_type i = nn; i < _n; i++)
+	    _l[i].~T();
+	for (size_type i = _n; i < nn; i++)
+	    new((void *) (_l + i)) T(e);
+	_n = nn;
+    }
+}
+
+template <class T, int N> void
+SmallVector<T, N>::swap(SmallVector<T, N> &x)
+{
+    if (_l != inline_elts() && x._l != x.inline_elts()) {
+	// both on the heap: exchange the arrays
+	T *l = _l;
+	_l = x._l;
+	x._l = l;
+
+	size_type n = _n;
+	_n = x._n;
+	x._n = n;
+
+	size_type cap = _capacity;
+	_capacity = x._capacity;
+	x._capacity = cap;
+    } else {
+	SmallVector<T, N> t(*this);
+	*this = x;
+	x = t;
+    }
+}
+
+CLICK_ENDDECLS
+#endif
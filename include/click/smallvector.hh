@@ -0,0 +1,152 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SMALLVECTOR_HH
+#define CLICK_SMALLVECTOR_HH
+#include <click/glue.hh>
+CLICK_DECLS
+
+/** @file <click/smallvector.hh>
+ * @brief A Vector variant that keeps its first elements inline.
+ */
+
+/** @class SmallVector
+  @brief Array template with inline storage for N elements.
+
+  SmallVector<T, N> has Vector<T>'s interface, but holds up to N elements in
+  the object itself.  Only a SmallVector that grows past N elements
+  allocates, so short lists that are built and thrown away often, such as
+  the ones OLSR keeps per tuple or builds per message, cost no heap traffic.
+
+  Moving a SmallVector, as a HashMap or FlatHashMap that holds it by value
+  may do, copies its elements, inline ones included.  Keep N small: every
+  SmallVector, empty or not, takes the room of N elements. */
+template <class T, int N>
+class SmallVector { public:
+
+    typedef T value_type;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef const T &const_access_type;
+
+    typedef int size_type;
+    enum { RESERVE_GROW = (size_type) -1, INLINE_CAPACITY = N };
+
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    explicit SmallVector()
+	: _l(inline_elts()), _n(0), _capacity(N) {
+    }
+    explicit SmallVector(size_type n, const T &e)
+	: _l(inline_elts()), _n(0), _capacity(N) {
+	resize(n, e);
+    }
+    SmallVector(const SmallVector<T, N> &x)
+	: _l(inline_elts()), _n(0), _capacity(N) {
+	*this = x;
+    }
+    ~SmallVector();
+
+    SmallVector<T, N> &operator=(const SmallVector<T, N> &);
+    SmallVector<T, N> &assign(size_type n, const T &e = T());
+
+    // iterators
+    iterator begin()			{ return _l; }
+    const_iterator begin() const	{ return _l; }
+    iterator end()			{ return _l + _n; }
+    const_iterator end() const		{ return _l + _n; }
+
+    // capacity
+    size_type size() const		{ return _n; }
+    void resize(size_type nn, const T &e = T());
+    size_type capacity() const		{ return _capacity; }
+    bool empty() const			{ return _n == 0; }
+    bool reserve(size_type);
+    bool is_inline() const		{ return _l == inline_elts(); }
+
+    // element access
+    T &operator[](size_type i) {
+	assert((unsigned) i < (unsigned) _n);
+	return _l[i];
+    }
+    const T &operator[](size_type i) const {
+	assert((unsigned) i < (unsigned) _n);
+	return _l[i];
+    }
+    T &at(size_type i)			{ return operator[](i); }
+    const T &at(size_type i) const	{ return operator[](i); }
+    T &front()				{ return operator[](0); }
+    const T &front() const		{ return operator[](0); }
+    T &back()				{ return operator[](_n - 1); }
+    const T &back() const		{ return operator[](_n - 1); }
+    T &at_u(size_type i)		{ return _l[i]; }
+    const T &at_u(size_type i) const	{ return _l[i]; }
+
+    // modifiers
+    inline void push_back(const T &);
+    inline void pop_back();
+    inline void push_front(const T &);
+    inline void pop_front();
+    iterator insert(iterator, const T &);
+    inline iterator erase(iterator);
+    iterator erase(iterator, iterator);
+    void swap(SmallVector<T, N> &);
+    void clear()			{ erase(begin(), end()); }
+
+  private:
+
+    T *_l;
+    size_type _n;
+    size_type _capacity;
+    union {
+	char c[N * sizeof(T)];
+	double align_d;
+	void *align_p;
+	long align_l;
+    } _inline;
+
+    T *inline_elts() const {
+	return reinterpret_cast<T *>(const_cast<char *>(_inline.c));
+    }
+
+};
+
+template <class T, int N> inline void
+SmallVector<T, N>::push_back(const T &e)
+{
+    if (_n < _capacity || reserve(RESERVE_GROW)) {
+	new((void *) (_l + _n)) T(e);
+	++_n;
+    }
+}
+
+template <class T, int N> inline void
+SmallVector<T, N>::pop_back()
+{
+    assert(_n > 0);
+    --_n;
+    _l[_n].~T();
+}
+
+template <class T, int N> inline void
+SmallVector<T, N>::push_front(const T &e)
+{
+    insert(begin(), e);
+}
+
+template <class T, int N> inline void
+SmallVector<T, N>::pop_front()
+{
+    erase(begin());
+}
+
+template <class T, int N> inline typename SmallVector<T, N>::iterator
+SmallVector<T, N>::erase(iterator i)
+{
+    return (i < end() ? erase(i, i + 1) : i);
+}
+
+CLICK_ENDDECLS
+#include <click/smallvector.cc>
+#endif
@@ -7,7 +7,7 @@ CLICK_DECLS
 /*
 =c
 
-ScheduleInfo(ELEMENT PARAM, ...)
+ScheduleInfo(ELEMENT PARAM [DEADLINE], ...)
 
 =s information
 
@@ -65,6 +65,19 @@ For example, if the second ScheduleInfo element above was
    ScheduleInfo@4 :: ScheduleInfo(c 4, c/i 10.5)
 
 then the InfiniteSource's final scaling parameter would be 10.5.
+
+An argument may give a third word, a time such as `C<5ms>', which puts the
+element's Tasks in the deadline class: they are scheduled ahead of the
+other Tasks of their thread whenever they become runnable, whatever their
+scheduling parameters, and count how often they waited longer than
+DEADLINE to run (see Task::set_deadline).  The class is meant for
+short, latency-critical work, such as a routing protocol's timers and
+message processing, that must not queue behind busy data path Tasks.
+Their C<deadline_stats> handlers report how the deadlines were met.  As
+with the parameters, an outer ScheduleInfo overrides a deadline given
+inside a compound; a deadline of 0 takes the element out of the class.
+
+   ScheduleInfo(hello_generator 1 5ms, routing_table 1 20ms);
 */
 
 class ScheduleInfo : public Element { public:
@@ -82,6 +95,7 @@ class ScheduleInfo : public Element { public:
     bool query(const String&, int&) const;
     bool query_prefixes(const String&, int&, String&) const;
     static int query(Element*, ErrorHandler*);
+    static Timestamp query_deadline(Element*);
     static void initialize_task(Element*, Task*, bool sched, ErrorHandler*);
     static void initialize_task(Element*, Task*, ErrorHandler*);
     static void join_scheduler(Element*, Task*, ErrorHandler*);
@@ -25,6 +25,8 @@ typedef TaskCallback TaskHook CLICK_DEPRECATED;
 class RouterThread;
 class TaskList;
 class Master;
+class Timer;
+class Timestamp;
 
 class Task { public:
 
@@ -167,6 +169,12 @@ class Task { public:
     inline void fast_reschedule();
 #endif
 
+    void reschedule_at(const Timestamp &when);
+
+    void set_deadline(const Timestamp &deadline);
+    Timestamp deadline() const;
+    String unparse_deadline_stats() const;
+
     void move_thread(int thread_id);
 
 #if HAVE_STRIDE_SCHED
@@ -228,8 +236,14 @@ class Task { public:
 
     RouterThread *_thread;
     int _home_thread_id;
+#if HAVE_MULTITHREAD
+    bool _home_thread_pinned;	// set by a ThreadSched preference
+#endif
 
     Element *_owner;
+    Timer *_wakeup_timer;	// of reschedule_at(), made on first use
+    struct DeadlineInfo;
+    DeadlineInfo *_deadline;	// null unless in the deadline class
 
     volatile uintptr_t _pending_nextptr;
 
@@ -246,6 +260,9 @@ class Task { public:
 
     static bool error_hook(Task*, void*);
 
+    void deadline_woken();
+    void deadline_run();
+
     inline void fast_unschedule(bool should_be_scheduled);
 
     static inline Task *pending_to_task(uintptr_t);
@@ -282,7 +299,10 @@ Task::Task(TaskCallback f, void *user_data)
       _cycle_runs(0),
 #endif
       _thread(0), _home_thread_id(-1),
-      _owner(0), _pending_nextptr(0)
+#if HAVE_MULTITHREAD
+      _home_thread_pinned(false),
+#endif
+      _owner(0), _wakeup_timer(0), _deadline(0), _pending_nextptr(0)
 {
 }
 
@@ -305,7 +325,10 @@ Task::Task(Element* e)
       _cycle_runs(0),
 #endif
       _thread(0), _home_thread_id(-1),
-      _owner(0), _pending_nextptr(0)
+#if HAVE_MULTITHREAD
+      _home_thread_pinned(false),
+#endif
+      _owner(0), _wakeup_timer(0), _deadline(0), _pending_nextptr(0)
 {
 }
 
@@ -455,8 +478,13 @@ Task::fast_reschedule()
 #  endif
 
     if (!scheduled()) {
-	// increase pass
-	_pass += _stride;
+	// increase pass; the deadline class goes ahead of every task that
+	// has already run at the current pass
+	if (unlikely(_deadline)) {
+	    _pass = _thread->_pass;
+	    deadline_woken();
+	} else
+	    _pass += _stride;
 
 #  if 0
 	// look for 'n' immediately before where we should be scheduled
@@ -513,10 +541,19 @@ Task::fast_reschedule()
     GIANT_REQUIRED;
 #endif
     if (!scheduled()) {
-	_prev = _thread->_prev;
-	_next = _thread;
-	_thread->_prev = this;
-	_thread->_next = this;
+	if (unlikely(_deadline)) {
+	    // the deadline class goes first
+	    _prev = _thread;
+	    _next = _thread->_next;
+	    _thread->_next = this;
+	    _next->_prev = this;
+	    deadline_woken();
+	} else {
+	    _prev = _thread->_prev;
+	    _next = _thread;
+	    _thread->_prev = this;
+	    _thread->_next = this;
+	}
     }
 }
 
@@ -557,6 +594,9 @@ Task::fire()
 #if CLICK_STATS >= 2
     click_cycles_t start_cycles = click_get_cycles();
 #endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::Frame *frame = ElementProfiler::enter(_owner, -1, ElementProfiler::TASK);
+#endif
 #if HAVE_MULTITHREAD
     _cycle_runs++;
 #endif
@@ -572,6 +612,9 @@ Task::fire()
     else
 	(void) _hook(this, _thunk);
 #endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::leave(frame, 0);
+#endif
 #if CLICK_STATS >= 2
     ++_owner->_task_calls;
     _owner->_task_cycles += click_get_cycles() - start_cycles;
@@ -8,6 +8,7 @@
 CLICK_DECLS
 class Element;
 class Router;
+class RouterThread;
 class Timer;
 class Task;
 
@@ -36,8 +37,8 @@ class Timer { public:
 
     /** @brief Destroy a Timer, unscheduling it first if necessary. */
     inline ~Timer() {
-	if (scheduled())
-	    unschedule();
+	if (scheduled() || _inbox_pprev)
+	    clear();
     }
 
 
@@ -70,8 +71,13 @@ class Timer { public:
 	return _owner != 0;
     }
 
-    /** @brief Return true iff the Timer is currently scheduled. */
+    /** @brief Return true iff the Timer is currently scheduled.
+     *
+     * A request from another thread that is still waiting in the owning
+     * thread's TimerSet inbox counts as done. */
     inline bool scheduled() const {
+	if (_inbox_pprev)
+	    return _inbox_schedule;
 	return _schedpos1 != 0;
     }
 
@@ -81,7 +87,7 @@ class Timer { public:
      * scheduled to fire.  If the timer is not currently scheduled, then
      * expiry() returns the last assigned expiration time. */
     inline const Timestamp &expiry() const {
-	return _expiry;
+	return _inbox_pprev && _inbox_schedule ? _inbox_expiry : _expiry;
     }
 
     /** @brief Return the Timer's associated Router. */
@@ -99,11 +105,11 @@ class Timer { public:
      * on the same router.
      *
      * If Click is compiled with statistics support, time spent in this
-     * Timer will be charged to the @a owner element. */
-    inline void initialize(Element *owner) {
-	assert(!initialized() || _owner->router() == owner->router());
-	_owner = owner;
-    }
+     * Timer will be charged to the @a owner element.
+     *
+     * The timer runs on the thread that @a owner's tasks start on, as the
+     * router's ThreadSched says, or on thread 0. */
+    void initialize(Element *owner);
 
     /** @brief Initialize the timer.
      * @param router the owner router
@@ -173,7 +179,7 @@ class Timer { public:
      *
      * @sa schedule_after */
     inline void reschedule_after(const Timestamp &delta) {
-	schedule_at(_expiry + delta);
+	schedule_at(expiry() + delta);
     }
 
     /** @brief Schedule the timer to fire @a delta_sec seconds after its
@@ -182,7 +188,8 @@ class Timer { public:
      *
      * @sa schedule_after_sec, reschedule_after */
     inline void reschedule_after_sec(uint32_t delta_sec) {
-	schedule_at(Timestamp(_expiry.sec() + delta_sec, _expiry.subsec()));
+	const Timestamp &e = expiry();
+	schedule_at(Timestamp(e.sec() + delta_sec, e.subsec()));
     }
 
     /** @brief Schedule the timer to fire @a delta_msec milliseconds after its
@@ -191,7 +198,7 @@ class Timer { public:
      *
      * @sa schedule_after_msec, reschedule_after */
     inline void reschedule_after_msec(uint32_t delta_msec) {
-	schedule_at(_expiry + Timestamp::make_msec(delta_msec));
+	schedule_at(expiry() + Timestamp::make_msec(delta_msec));
     }
 
 
@@ -200,11 +207,11 @@ class Timer { public:
      * The timer's expiration time is not modified. */
     void unschedule();
 
-    /** @brief Unschedule the timer and reset its expiration time. */
-    inline void clear() {
-	unschedule();
-	_expiry = Timestamp();
-    }
+    /** @brief Unschedule the timer and reset its expiration time.
+     *
+     * Unlike unschedule(), waits for the owning thread's timers if they are
+     * running. */
+    void clear();
 
 
     /** @brief Return an adjustment interval useful for precise timers.
@@ -257,6 +264,21 @@ class Timer { public:
     } _hook;
     void *_thunk;
     Element *_owner;
+    RouterThread *_thread;
+    // a request from another thread waits in the inbox of _thread's TimerSet
+    // while _inbox_pprev is set: to schedule at _inbox_expiry if
+    // _inbox_schedule, to unschedule otherwise
+    Timer *_inbox_next;
+    Timer **_inbox_pprev;
+    Timestamp _inbox_expiry;
+    bool _inbox_schedule;
+#if HAVE_TIMER_WHEEL
+    // _schedpos1 == schedpos_wheel: in TimerSet::_timer_wheel[_wheel_slot]
+    enum { schedpos_wheel = 0x7FFFFFFF };
+    Timer *_wheel_next;
+    Timer **_wheel_pprev;
+    int _wheel_slot;
+#endif
 
     Timer(const Timer &x);
     Timer &operator=(const Timer &x);
@@ -265,7 +287,7 @@ class Timer { public:
     static void element_hook(Timer *t, void *user_data);
     static void task_hook(Timer *t, void *user_data);
 
-    friend class Master;
+    friend class TimerSet;
 
 };
 
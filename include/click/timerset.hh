@@ -0,0 +1,208 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/timerset.cc" -*-
+#ifndef CLICK_TIMERSET_HH
+#define CLICK_TIMERSET_HH
+#include <click/timer.hh>
+#include <click/sync.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+class Router;
+class RouterThread;
+class Master;
+
+/** @class TimerSet
+ * @brief The timers of one RouterThread.
+ *
+ * Every RouterThread keeps the timers of the elements it is home to, and runs
+ * them from its own driver loop, so that threads scheduling their own timers
+ * never share a lock.  A timer belongs to the thread its element's tasks
+ * start on, or to thread 0.
+ *
+ * The set is locked while its thread runs timers.  Another thread that finds
+ * it locked does not wait: its request to schedule or unschedule a timer goes
+ * to the set's inbox, which the owning thread drains before running its
+ * timers.  A thread running timers thus never waits on another thread's set,
+ * and cannot deadlock with it. */
+class TimerSet { public:
+
+    TimerSet(RouterThread *thread);
+
+    Timestamp next_timer_expiry() const		{ return _timer_expiry; }
+    inline Timestamp next_timer_expiry_adjusted() const;
+    const Timestamp &timer_check() const	{ return _timer_check; }
+    unsigned max_timer_stride() const		{ return _max_timer_stride; }
+    unsigned timer_stride() const		{ return _timer_stride; }
+    void set_max_timer_stride(unsigned timer_stride);
+
+    void run_timers(Master *master);
+
+    inline void lock_timers();
+    inline bool attempt_lock_timers();
+    inline void unlock_timers();
+
+  private:
+
+    // stick _timer_expiry here so it will most likely fit in a cache line,
+    // & we don't have to worry about its parts being updated separately
+    Timestamp _timer_expiry;
+
+    RouterThread *_thread;
+    unsigned _max_timer_stride;
+    unsigned _timer_stride;
+    unsigned _timer_count;
+    Vector<Timer *> _timer_heap;
+    Vector<Timer *> _timer_runchunk;
+#if CLICK_LINUXMODULE
+    spinlock_t _timer_lock;
+    struct task_struct *_timer_task;
+#elif HAVE_MULTITHREAD
+    Spinlock _timer_lock;
+#endif
+    Timestamp _timer_check;
+    uint32_t _timer_check_reports;
+
+    // requests from other threads, linked through Timer::_inbox_next
+    Timer *_timer_inbox;
+    Spinlock _inbox_lock;
+
+    inline void run_one_timer(Timer *);
+    void schedule(Timer *t, const Timestamp &when);
+    void unschedule(Timer *t);
+    void remove_timer(Timer *t);
+    void post(Timer *t, const Timestamp *when);
+    void cancel_post(Timer *t);
+    void run_inbox();
+    void kill_router(Router *router);
+
+#if HAVE_TIMER_WHEEL
+    // Timers due after the current tick (_timer_wheel_tick, in milliseconds)
+    // wait in a hierarchical wheel; _timer_heap holds only the timers due by
+    // then.  Level 0 has one slot per tick, level L > 0 one slot per
+    // 2^wheel_shift(L) ticks.  As the tick advances, slots of the higher
+    // levels are redistributed to the lower ones, and those of level 0
+    // moved into the heap.
+    enum { wheel_levels = 4, wheel_bits0 = 8, wheel_bits = 6,
+	   wheel_slots0 = 1 << wheel_bits0, wheel_slots = 1 << wheel_bits,
+	   wheel_nslots = wheel_slots0 + (wheel_levels - 1) * wheel_slots };
+    Timer *_timer_wheel[wheel_nslots];
+    uint32_t _timer_wheel_count[wheel_levels];
+    int64_t _timer_wheel_tick;
+    static inline int64_t wheel_tick(const Timestamp &ts) {
+	return ts.msecval();
+    }
+    static inline int wheel_shift(int level) {
+	return level ? wheel_bits0 + (level - 1) * wheel_bits : 0;
+    }
+    static inline int wheel_level(int slot) {
+	return slot < wheel_slots0 ? 0 : 1 + (slot - wheel_slots0) / wheel_slots;
+    }
+    inline uint32_t wheel_size() const {
+	return _timer_wheel_count[0] + _timer_wheel_count[1]
+	    + _timer_wheel_count[2] + _timer_wheel_count[3];
+    }
+    inline bool wheel_accepts(const Timer *t);
+    int64_t wheel_link(Timer *t);
+    void wheel_insert(Timer *t);
+    void wheel_remove(Timer *t);
+    inline void wheel_unload(int slot);
+    void wheel_advance(int64_t tick);
+    Timestamp wheel_expiry() const;
+#endif
+
+    void set_timer_expiry() {
+	if (_timer_heap.size())
+	    _timer_expiry = _timer_heap.at_u(0)->_expiry;
+	else
+#if HAVE_TIMER_WHEEL
+	    _timer_expiry = wheel_expiry();
+#else
+	    _timer_expiry = Timestamp();
+#endif
+    }
+    void check_timer_expiry(Timer *t);
+
+    struct timer_less {
+	bool operator()(Timer *a, Timer *b) {
+	    return a->_expiry < b->_expiry;
+	}
+    };
+    struct timer_place {
+	Timer **_begin;
+	timer_place(Timer **begin)
+	    : _begin(begin) {
+	}
+	void operator()(Timer **t) {
+	    (*t)->_schedpos1 = (t - _begin) + 1;
+	}
+    };
+
+    TimerSet(const TimerSet &);
+    TimerSet &operator=(const TimerSet &);
+
+    friend class Timer;
+    friend class Master;
+
+};
+
+inline Timestamp
+TimerSet::next_timer_expiry_adjusted() const
+{
+    // a pending request is due now
+    if (_timer_inbox)
+	return Timestamp(1, 0);
+    Timestamp e = _timer_expiry;
+    if (_timer_stride >= 8 || e.sec() == 0)
+	/* do nothing */;
+    else if (_timer_stride >= 4)
+	e -= Timer::adjustment();
+    else
+	e -= Timer::adjustment() + Timer::adjustment();
+    return e;
+}
+
+#if HAVE_TIMER_WHEEL
+inline bool
+TimerSet::wheel_accepts(const Timer *t)
+{
+    // an empty wheel can restart at the current tick
+    if (!wheel_size())
+	_timer_wheel_tick = wheel_tick(Timestamp::now());
+    return wheel_tick(t->_expiry) > _timer_wheel_tick;
+}
+#endif
+
+inline void
+TimerSet::lock_timers()
+{
+#if CLICK_LINUXMODULE
+    if (current != _timer_task)
+	spin_lock(&_timer_lock);
+#elif HAVE_MULTITHREAD
+    _timer_lock.acquire();
+#endif
+}
+
+inline bool
+TimerSet::attempt_lock_timers()
+{
+#if CLICK_LINUXMODULE
+    return spin_trylock(&_timer_lock);
+#elif HAVE_MULTITHREAD
+    return _timer_lock.attempt();
+#else
+    return true;
+#endif
+}
+
+inline void
+TimerSet::unlock_timers()
+{
+#if CLICK_LINUXMODULE
+    if (current != _timer_task)
+	spin_unlock(&_timer_lock);
+#elif HAVE_MULTITHREAD
+    _timer_lock.release();
+#endif
+}
+
+CLICK_ENDDECLS
+#endif
@@ -323,6 +323,8 @@ class Timestamp { public:
     }
 
     static inline Timestamp now();
+    static inline Timestamp recent();
+    static inline void refresh_recent();
     /** @brief Return the smallest nonzero timestamp, Timestamp(0, 1). */
     static inline Timestamp epsilon() {
 	return Timestamp(0, 1);
@@ -366,6 +368,11 @@ class Timestamp { public:
     String unparse() const;
     String unparse_interval() const;
 
+    enum {
+	unparse_buflen = 33	///< Buffer size for unparse(char *).
+    };
+    char *unparse(char *buf) const;
+
     /** @brief Convert milliseconds to subseconds.
      *
      * Subseconds are either microseconds or nanoseconds, depending on
@@ -431,6 +438,8 @@ class Timestamp { public:
 
     rep_t _t;
 
+    static Timestamp _recent;
+
     inline void add_fix() {
 #if TIMESTAMP_REP_FLAT64
 	/* no fix necessary */
@@ -595,6 +604,31 @@ Timestamp::now()
     return t;
 }
 
+/** @brief Return a recent reading of the current time.
+
+ The driver refreshes this timestamp before each batch of tasks, each run of
+ the timers, and each return from waiting for file descriptors, so it can lag
+ now() by as long as a batch takes to run.  It costs no system call: use it
+ for per-packet work such as expiry checks, and now() where the exact time
+ matters.
+ @sa now(), refresh_recent() */
+inline Timestamp
+Timestamp::recent()
+{
+    if (!_recent)
+	_recent.set_now();
+    return _recent;
+}
+
+/** @brief Set the recent() timestamp to the current time.
+
+ Called by the driver; elements need not call it. */
+inline void
+Timestamp::refresh_recent()
+{
+    _recent.set_now();
+}
+
 /** @brief Set this timestamp's seconds component.
 
     The subseconds component is left unchanged. */
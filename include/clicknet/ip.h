@@ -182,6 +182,56 @@ click_update_in_cksum(uint16_t *csum, uint16_t old_hw, uint16_t new_hw)
     *csum = ~(sum + (sum >> 16));
 }
 
+/** @brief Incrementally adjust an Internet checksum for a 32-bit field.
+ * @param[in, out] csum points to checksum
+ * @param old_w old word, as stored in the packet
+ * @param new_w new word, as stored in the packet
+ *
+ * As click_update_in_cksum(), for a change of a two-halfword field such as
+ * an IP address.  The words must start at an even offset of the data. */
+static inline void
+click_update_in_cksum32(uint16_t *csum, uint32_t old_w, uint32_t new_w)
+{
+    uint32_t sum = (~*csum & 0xFFFF) + (~old_w & 0xFFFF) + (~old_w >> 16)
+	+ (new_w & 0xFFFF) + (new_w >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    *csum = ~(sum + (sum >> 16));
+}
+
+/** @brief Decrement an IP header's TTL and adjust its checksum.
+ * @param iph IP header, whose TTL must be nonzero
+ *
+ * The checksum is updated incrementally according to RFC 1624, with the
+ * halfword change of the TTL folded into a constant. */
+static inline void
+click_ip_decrement_ttl(struct click_ip *iph)
+{
+    uint32_t sum;
+    --iph->ip_ttl;
+    /* new_sum = ~(~old_sum + ~old_halfword + (old_halfword - 0x0100))
+     *         = ~(~old_sum + 0xFEFF) */
+    sum = (~ntohs(iph->ip_sum) & 0xFFFF) + 0xFEFF;
+    iph->ip_sum = ~htons(sum + (sum >> 16));
+}
+
+/** @brief Calculate the checksum of an IP header.
+ * @param iph IP header, two-byte aligned
+ *
+ * Equivalent to click_in_cksum(iph, iph->ip_hl << 2), with the common
+ * option-less header summed without a loop.  As with click_in_cksum(), set
+ * ip_sum to zero first when computing a checksum to store. */
+static inline uint16_t
+click_in_cksum_iphdr(const struct click_ip *iph)
+{
+    const uint16_t *w = (const uint16_t *) iph;
+    uint32_t sum;
+    if (iph->ip_hl != 5)
+	return click_in_cksum((const unsigned char *) iph, iph->ip_hl << 2);
+    sum = w[0] + w[1] + w[2] + w[3] + w[4] + w[5] + w[6] + w[7] + w[8] + w[9];
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return ~(sum + (sum >> 16));
+}
+
 /** @brief Potentially fix a zero-valued Internet checksum.
  * @param[in, out] csum points to checksum
  * @param x data to checksum
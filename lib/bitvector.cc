@@ -159,6 +159,17 @@ Bitvector::operator^=(const Bitvector &o)
     return *this;
 }
 
+Bitvector &
+Bitvector::operator-=(const Bitvector &o)
+{
+    assert(o._max == _max);
+    int nn = max_word();
+    uint32_t *data = _data, *o_data = o._data;
+    for (int i = 0; i <= nn; i++)
+	data[i] &= ~o_data[i];
+    return *this;
+}
+
 void
 Bitvector::offset_or(const Bitvector &o, int offset)
 {
@@ -217,6 +228,54 @@ Bitvector::nonzero_intersection(const Bitvector &o) const
     return false;
 }
 
+int
+Bitvector::count() const
+{
+    int nn = max_word(), n = 0;
+    for (int i = 0; i <= nn; i++)
+	n += popcount(_data[i]);
+    return n;
+}
+
+int
+Bitvector::intersection_count(const Bitvector &o) const
+{
+    assert(o._max == _max);
+    int nn = max_word(), n = 0;
+    const uint32_t *data = _data, *o_data = o._data;
+    for (int i = 0; i <= nn; i++)
+	n += popcount(data[i] & o_data[i]);
+    return n;
+}
+
+int
+Bitvector::difference_count(const Bitvector &o) const
+{
+    assert(o._max == _max);
+    int nn = max_word(), n = 0;
+    const uint32_t *data = _data, *o_data = o._data;
+    for (int i = 0; i <= nn; i++)
+	n += popcount(data[i] & ~o_data[i]);
+    return n;
+}
+
+int
+Bitvector::find_first(int i) const
+{
+    if (i < 0)
+	i = 0;
+    if (i > _max)
+	return -1;
+    int w = i >> 5, nn = max_word();
+    uint32_t bits = _data[w] & (0xFFFFFFFFU << (i & 31));
+    while (!bits) {
+	if (++w > nn)
+	    return -1;
+	bits = _data[w];
+    }
+    return (w << 5) + ffs_lsb(bits) - 1;
+}
+
 void
 Bitvector::swap(Bitvector &x)
 {
@@ -525,6 +525,52 @@ click_read_router(String filename, bool is_expr, ErrorHandler *errh, bool initia
     return router;
 }
 
+Router *
+click_clone_router(const Router *router, ErrorHandler *errh, bool initialize, Master *master)
+{
+    if (!errh)
+	errh = ErrorHandler::silent_handler();
+
+    // create fresh elements of the same classes
+    Lexer *l = click_lexer();
+    Vector<Element *> elements;
+    for (int i = 0; i < router->nelements(); i++) {
+	const char *class_name = router->element(i)->class_name();
+	Element *e = l->create_element(l->element_type(class_name));
+	if (e && strcmp(e->class_name(), class_name) != 0) {
+	    delete e;
+	    e = 0;
+	}
+	if (!e) {
+	    errh->error("%s: cannot create another %<%s%>", router->ename(i).c_str(), class_name);
+	    for (int j = 0; j < elements.size(); j++)
+		delete elements[j];
+	    return 0;
+	}
+	elements.push_back(e);
+    }
+
+    Master *m = master ? master : new Master(1);
+    Router *copy = router->clone(elements, m);
+    if (!copy) {
+	errh->error("router has been initialized, cannot copy it");
+	for (int j = 0; j < elements.size(); j++)
+	    delete elements[j];
+	if (m != master)
+	    delete m;
+	return 0;
+    }
+
+    // initialize if requested
+    if (initialize)
+	if (copy->initialize(errh) < 0) {
+	    delete copy;
+	    return 0;
+	}
+
+    return copy;
+}
+
 CLICK_ENDDECLS
 #endif /* CLICK_USERLEVEL */
 
@@ -2061,6 +2061,31 @@ read_task_scheduled(Element *e, void *thunk)
   return String(task->scheduled());
 }
 
+static String
+read_task_deadline(Element *e, void *thunk)
+{
+  Task *task = (Task *)((uint8_t *)e + (intptr_t)thunk);
+  return task->deadline().unparse_interval();
+}
+
+static int
+write_task_deadline(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+  Task *task = (Task *)((uint8_t *)e + (intptr_t)thunk);
+  Timestamp deadline;
+  if (!cp_time(str, &deadline))
+    return errh->error("expected time");
+  task->set_deadline(deadline);
+  return 0;
+}
+
+static String
+read_task_deadline_stats(Element *e, void *thunk)
+{
+  Task *task = (Task *)((uint8_t *)e + (intptr_t)thunk);
+  return task->unparse_deadline_stats();
+}
+
 #if HAVE_MULTITHREAD
 static String
 read_task_home_thread(Element *e, void *thunk)
@@ -2094,6 +2119,12 @@ write_task_home_thread(const String &str, Element *e, void *thunk, ErrorHandler
  * @li A "tickets" read handler, which returns the task's tickets.
  * @li A "tickets" write handler to set the task's tickets.
  * @li A "home_thread" read handler, which returns the task's home thread ID.
+ * @li A "deadline" read handler, which returns the task's deadline, 0 if
+ * it is not in the deadline class (see Task::set_deadline()).
+ * @li A "deadline" write handler to set the task's deadline.  Better done
+ * while the task is idle.
+ * @li A "deadline_stats" read handler, which reports how the task met its
+ * deadline (see Task::unparse_deadline_stats()).
  *
  * Depending on Click's configuration options, some of these handlers might
  * not be available.
@@ -2117,6 +2148,9 @@ Element::add_task_handlers(Task *task, const String &prefix)
   add_read_handler(prefix + "home_thread", read_task_home_thread, thunk);
   add_write_handler(prefix + "home_thread", write_task_home_thread, thunk);
 #endif
+  add_read_handler(prefix + "deadline", read_task_deadline, thunk);
+  add_write_handler(prefix + "deadline", write_task_deadline, thunk);
+  add_read_handler(prefix + "deadline_stats", read_task_deadline_stats, thunk);
 }
 
 static String
@@ -2751,6 +2785,54 @@ Element::simple_action(Packet *p)
     return p;
 }
 
+/** @brief Push the packets of @a batch onto push input @a port.
+ *
+ * @param port the input port number on which the packets arrive
+ * @param batch the packets, in arrival order
+ *
+ * An upstream element transferred several packets at once with
+ * Port::push_batch().  push_batch() must account for every packet, as push()
+ * does for one, and leave @a batch empty.
+ *
+ * The default implementation hands the packets to push() one at a time, so
+ * elements need not know about batches.  Elements on busy paths override it
+ * to take the per-packet virtual call out of their inner loop, typically by
+ * collecting consecutive packets bound for the same output into one batch
+ * of their own.  Such an element must still handle each packet in order, and
+ * must push a collected batch before handling a packet whose treatment
+ * depends on what happens to the collected ones downstream.
+ */
+void
+Element::push_batch(int port, PacketBatch &batch)
+{
+    while (Packet *p = batch.pop_front())
+	push(port, p);
+}
+
+/** @brief Pull up to @a max packets from pull output @a port.
+ *
+ * @param port the output port number receiving the pull request
+ * @param batch batch to which packets are appended
+ * @param max maximum number of packets to append
+ *
+ * A downstream element requested several packets at once with
+ * Port::pull_batch().  pull_batch() should append at most @a max packets to
+ * @a batch, stopping early only when no more packets are available.
+ *
+ * The default implementation calls pull() until it has @a max packets or
+ * pull() returns null.
+ */
+void
+Element::pull_batch(int port, PacketBatch &batch, unsigned max)
+{
+    for (; max; --max) {
+	Packet *p = pull(port);
+	if (!p)
+	    break;
+	batch.push_back(p);
+    }
+}
+
 /** @brief Run the element's task.
  *
  * @return true if the task accomplished some meaningful work, false otherwise
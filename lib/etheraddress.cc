@@ -44,11 +44,8 @@ EtherAddress::unparse_dash() const
 
     String str = String::make_garbage(17);
     // NB: mutable_c_str() creates space for the terminating null character
-    if (char *x = str.mutable_c_str()) {
-	const unsigned char *p = this->data();
-	sprintf(x, "%02X-%02X-%02X-%02X-%02X-%02X",
-		p[0], p[1], p[2], p[3], p[4], p[5]);
-    }
+    if (char *x = str.mutable_c_str())
+	unparse_dash(x);
     return str;
 }
 
@@ -56,22 +53,34 @@ String
 EtherAddress::unparse_colon() const
 {
     String str = String::make_garbage(17);
-    if (char *x = str.mutable_c_str()) {
-	const unsigned char *p = this->data();
-	sprintf(x, "%02X:%02X:%02X:%02X:%02X:%02X",
-		p[0], p[1], p[2], p[3], p[4], p[5]);
-    }
+    if (char *x = str.mutable_c_str())
+	unparse_colon(x);
     return str;
 }
 
+char *
+EtherAddress::unparse_dash(char *buf) const
+{
+    const unsigned char *p = this->data();
+    sprintf(buf, "%02X-%02X-%02X-%02X-%02X-%02X",
+	    p[0], p[1], p[2], p[3], p[4], p[5]);
+    return buf;
+}
+
+char *
+EtherAddress::unparse_colon(char *buf) const
+{
+    const unsigned char *p = this->data();
+    sprintf(buf, "%02X:%02X:%02X:%02X:%02X:%02X",
+	    p[0], p[1], p[2], p[3], p[4], p[5]);
+    return buf;
+}
+
 StringAccum &
 operator<<(StringAccum &sa, const EtherAddress &ea)
 {
-    if (char *x = sa.extend(17, 1)) {
-	const unsigned char *p = ea.data();
-	sprintf(x, "%02X-%02X-%02X-%02X-%02X-%02X",
-		p[0], p[1], p[2], p[3], p[4], p[5]);
-    }
+    if (char *x = sa.extend(17, 1))
+	ea.unparse_dash(x);
     return sa;
 }
 
@@ -122,20 +122,35 @@ IP6Address::ip4_address(IPAddress &ip4) const
 String
 IP6Address::unparse() const
 {
-    char buf[48];
+    if (_addr.s6_addr32[0] == 0 && _addr.s6_addr32[1] == 0
+	&& _addr.s6_addr32[2] == 0 && _addr.s6_addr32[3] == 0)
+	return String::make_stable("::", 2); // empty address
+    char buf[unparse_buflen];
+    return String(unparse(buf));
+}
 
+/** @brief Unparse this address into @a buf.
+    @param buf buffer of at least unparse_buflen characters
+    @return @a buf
+
+    Like unparse(), but writes a null-terminated string into @a buf without
+    allocating memory. */
+char *
+IP6Address::unparse(char *buf) const
+{
     // do some work to print the address well
     if (_addr.s6_addr32[0] == 0 && _addr.s6_addr32[1] == 0) {
-	if (_addr.s6_addr32[2] == 0 && _addr.s6_addr32[3] == 0)
-	    return String::make_stable("::", 2); // empty address
-	else if (_addr.s6_addr32[2] == 0) {
+	if (_addr.s6_addr32[2] == 0 && _addr.s6_addr32[3] == 0) {
+	    strcpy(buf, "::"); // empty address
+	    return buf;
+	} else if (_addr.s6_addr32[2] == 0) {
 	    sprintf(buf, "::%d.%d.%d.%d", _addr.s6_addr[12], _addr.s6_addr[13],
 		    _addr.s6_addr[14], _addr.s6_addr[15]);
-	    return String(buf);
+	    return buf;
 	} else if (_addr.s6_addr32[2] == htonl(0x0000FFFFU)) {
 	    sprintf(buf, "::FFFF:%d.%d.%d.%d", _addr.s6_addr[12], _addr.s6_addr[13],
 		    _addr.s6_addr[14], _addr.s6_addr[15]);
-	    return String(buf);
+	    return buf;
 	}
     }
 
@@ -152,7 +167,8 @@ IP6Address::unparse() const
     }
     for (; word < 8; word++)
 	s += sprintf(s, ":%X", ntohs(_addr.s6_addr16[word]));
-    return String(buf, s - buf);
+    *s = 0;
+    return buf;
 }
 
 String
@@ -170,7 +186,9 @@ IP6Address::unparse_expanded() const
 StringAccum &
 operator<<(StringAccum &sa, const IP6Address &a)
 {
-    return (sa << a.unparse());
+    if (char *x = sa.reserve(IP6Address::unparse_buflen))
+	sa.adjust_length(strlen(a.unparse(x)));
+    return sa;
 }
 
 
@@ -1,6 +1,6 @@
 // -*- c-basic-offset: 2; related-file-name: "../include/click/ip6table.hh" -*-
 /*
- * ip6table.{cc,hh} -- a stupid IP6 routing table, best for small routing tables
+ * ip6table.{cc,hh} -- an IP6 routing table, a path-compressed binary trie
  * Peilei Fan, Robert Morris
  *
  * Copyright (c) 1999-2000 Massachusetts Institute of Technology
@@ -18,10 +18,12 @@
 
 #include <click/config.h>
 #include <click/ip6table.hh>
+#include <click/integers.hh>
 #include <click/straccum.hh>
 CLICK_DECLS
 
 IP6Table::IP6Table()
+  : _root(-1), _free_node(-1), _free_entry(-1)
 {
 }
 
@@ -29,16 +31,50 @@ IP6Table::~IP6Table()
 {
 }
 
+void
+IP6Table::clear()
+{
+  _v.clear();
+  _nodes.clear();
+  _odd.clear();
+  _root = _free_node = _free_entry = -1;
+}
+
+// length of the common prefix of a and b, at most max
+int
+IP6Table::common_len(const IP6Address &a, const IP6Address &b, int max)
+{
+  const uint32_t *ai = a.data32(), *bi = b.data32();
+  for (int w = 0; w < 4 && w * 32 < max; w++)
+    if (uint32_t x = ntohl(ai[w] ^ bi[w])) {
+      int len = w * 32 + ffs_msb(x) - 1;
+      return (len < max ? len : max);
+    }
+  return max;
+}
+
 bool
 IP6Table::lookup(const IP6Address &dst, IP6Address &gw, int &index) const
 {
   int best = -1;
 
-  for (int i = 0; i < _v.size(); i++)
-    if (_v[i]._valid && dst.matches_prefix(_v[i]._dst, _v[i]._mask)) {
-      if (best < 0 || _v[i]._mask.mask_as_specific(_v[best]._mask))
-        best = i;
-    }
+  for (int n = _root; n >= 0; ) {
+    const Node &node = _nodes[n];
+    if (!dst.matches_prefix(node._prefix, node._mask))
+      break;
+    if (node._entry >= 0)
+      best = node._entry;
+    if (node._len == 128)
+      break;
+    n = node._child[bit(dst, node._len)];
+  }
+
+  for (int i = 0; i < _odd.size(); i++) {
+    const Entry &e = _v[_odd[i]];
+    if (dst.matches_prefix(e._dst, e._mask)
+	&& (best < 0 || e._mask.mask_as_specific(_v[best]._mask)))
+      best = _odd[i];
+  }
 
   if (best < 0)
     return false;
@@ -49,6 +85,71 @@ IP6Table::lookup(const IP6Address &dst, IP6Address &gw, int &index) const
   }
 }
 
+int
+IP6Table::new_entry(const Entry &e)
+{
+  int i = _free_entry;
+  if (i >= 0) {
+    _free_entry = _v[i]._index;
+    _v[i] = e;
+  } else {
+    i = _v.size();
+    _v.push_back(e);
+  }
+  return i;
+}
+
+void
+IP6Table::free_entry(int i)
+{
+  _v[i]._valid = 0;
+  _v[i]._index = _free_entry;
+  _free_entry = i;
+}
+
+int
+IP6Table::new_node(const IP6Address &prefix, int len, int entry)
+{
+  Node node;
+  node._prefix = prefix;
+  node._mask = IP6Address::make_prefix(len);
+  node._len = len;
+  node._entry = entry;
+  node._child[0] = node._child[1] = -1;
+  int n = _free_node;
+  if (n >= 0) {
+    _free_node = _nodes[n]._child[0];
+    _nodes[n] = node;
+  } else {
+    n = _nodes.size();
+    _nodes.push_back(node);
+  }
+  return n;
+}
+
+void
+IP6Table::set_child(int parent, int dir, int n)
+{
+  if (parent < 0)
+    _root = n;
+  else
+    _nodes[parent]._child[dir] = n;
+}
+
+// removes node n, child dir of parent, if it has neither a route nor two
+// subtries, putting its only subtrie in its place
+bool
+IP6Table::merge_node(int parent, int dir, int n)
+{
+  Node &node = _nodes[n];
+  if (node._entry >= 0 || (node._child[0] >= 0 && node._child[1] >= 0))
+    return false;
+  set_child(parent, dir, node._child[0] >= 0 ? node._child[0] : node._child[1]);
+  node._child[0] = _free_node;
+  _free_node = n;
+  return true;
+}
+
 void
 IP6Table::add(const IP6Address &dst, const IP6Address &mask,
 	      const IP6Address &gw, int index)
@@ -61,15 +162,45 @@ IP6Table::add(const IP6Address &dst, const IP6Address &mask,
   e._index = index;
   e._valid = 1;
 
-  // Just in case, so we never encounter duplicate routes...
-  del(dst, mask);
+  int len = mask.mask_to_prefix_len();
+  if (len < 0) {
+    // Just in case, so we never encounter duplicate routes...
+    del(dst, mask);
+    _odd.push_back(new_entry(e));
+    return;
+  }
 
-  for (int i = 0; i < _v.size(); i++)
-    if (!_v[i]._valid) {
-      _v[i] = e;
+  int parent = -1, dir = 0;
+  for (int n = _root; n >= 0; n = _nodes[n]._child[dir]) {
+    int nlen = _nodes[n]._len;
+    int common = common_len(e._dst, _nodes[n]._prefix, len < nlen ? len : nlen);
+    if (common < nlen) {
+      // the route's prefix leaves the path to n at bit common: put a node
+      // there, holding the route itself if its prefix ends there
+      int m;
+      if (common == len)
+	m = new_node(e._dst, len, new_entry(e));
+      else {
+	int leaf = new_node(e._dst, len, new_entry(e));
+	m = new_node(e._dst & IP6Address::make_prefix(common), common, -1);
+	_nodes[m]._child[bit(e._dst, common)] = leaf;
+      }
+      _nodes[m]._child[bit(_nodes[n]._prefix, common)] = n;
+      set_child(parent, dir, m);
       return;
     }
-  _v.push_back(e);
+    if (nlen == len) {
+      // replaces the route for the same prefix, if any
+      if (_nodes[n]._entry >= 0)
+	_v[_nodes[n]._entry] = e;
+      else
+	_nodes[n]._entry = new_entry(e);
+      return;
+    }
+    parent = n;
+    dir = bit(e._dst, nlen);
+  }
+  set_child(parent, dir, new_node(e._dst, len, new_entry(e)));
 }
 
 void
@@ -77,9 +208,37 @@ IP6Table::del(const IP6Address &dst, const IP6Address &mask)
 {
   IP6Address dstnet = dst & mask;
 
-  for (int i = 0; i < _v.size(); i++)
-    if (_v[i]._valid && (_v[i]._dst == dstnet) && (_v[i]._mask == mask))
-      _v[i]._valid = 0;
+  int len = mask.mask_to_prefix_len();
+  if (len < 0) {
+    for (int i = 0; i < _odd.size(); i++)
+      if (_v[_odd[i]]._dst == dstnet && _v[_odd[i]]._mask == mask) {
+	free_entry(_odd[i]);
+	_odd.erase(_odd.begin() + i);
+	i--;
+      }
+    return;
+  }
+
+  int grandparent = -1, gdir = 0, parent = -1, dir = 0;
+  int n = _root;
+  while (n >= 0 && _nodes[n]._len < len) {
+    if (!dstnet.matches_prefix(_nodes[n]._prefix, _nodes[n]._mask))
+      return;
+    grandparent = parent;
+    gdir = dir;
+    parent = n;
+    dir = bit(dstnet, _nodes[n]._len);
+    n = _nodes[n]._child[dir];
+  }
+  if (n < 0 || _nodes[n]._len != len || _nodes[n]._prefix != dstnet
+      || _nodes[n]._entry < 0)
+    return;
+
+  free_entry(_nodes[n]._entry);
+  _nodes[n]._entry = -1;
+  // the parent may be left with one subtrie and no route of its own
+  if (merge_node(parent, dir, n) && parent >= 0)
+    merge_node(grandparent, gdir, parent);
 }
 
 String
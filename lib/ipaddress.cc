@@ -85,11 +85,23 @@ IPAddress::mask_to_prefix_len() const
     for an IPAddress @a a, IPAddress(@a a.unparse()) == @a a. */
 String
 IPAddress::unparse() const
+{
+    char buf[unparse_buflen];
+    return String(unparse(buf));
+}
+
+/** @brief Unparses this address into dotted-quad format in @a buf.
+    @param buf buffer of at least unparse_buflen characters
+    @return @a buf
+
+    Like unparse(), but writes a null-terminated string into @a buf without
+    allocating memory. */
+char *
+IPAddress::unparse(char *buf) const
 {
     const unsigned char *p = data();
-    char buf[20];
     sprintf(buf, "%d.%d.%d.%d", p[0], p[1], p[2], p[3]);
-    return String(buf);
+    return buf;
 }
 
 /** @brief Unparses this address into IP address mask format: either a prefix
@@ -116,17 +128,35 @@ IPAddress::unparse_mask() const
 String
 IPAddress::unparse_with_mask(IPAddress mask) const
 {
-    return unparse() + "/" + mask.unparse_mask();
+    char buf[unparse_with_mask_buflen];
+    return String(unparse_with_mask(buf, mask));
+}
+
+/** @brief Unparses an address prefix into "address/mask" format in @a buf.
+    @param buf buffer of at least unparse_with_mask_buflen characters
+    @param mask the address mask
+    @return @a buf
+
+    Like unparse_with_mask(IPAddress), but writes a null-terminated string
+    into @a buf without allocating memory. */
+char *
+IPAddress::unparse_with_mask(char *buf, IPAddress mask) const
+{
+    char *s = buf + strlen(unparse(buf));
+    *s++ = '/';
+    int prefix_len = mask.mask_to_prefix_len();
+    if (prefix_len >= 0)
+	sprintf(s, "%d", prefix_len);
+    else
+	mask.unparse(s);
+    return buf;
 }
 
 StringAccum &
 operator<<(StringAccum &sa, IPAddress ipa)
 {
-    const unsigned char *p = ipa.data();
-    char buf[20];
-    int amt;
-    amt = sprintf(buf, "%d.%d.%d.%d", p[0], p[1], p[2], p[3]);
-    sa.append(buf, amt);
+    if (char *x = sa.reserve(IPAddress::unparse_buflen))
+	sa.adjust_length(strlen(ipa.unparse(x)));
     return sa;
 }
 
@@ -905,6 +905,14 @@ Lexer::force_element_type(String name, bool report_error)
   return ADD_ELEMENT_TYPE(name, error_element_factory, 0, true);
 }
 
+Element *
+Lexer::create_element(int t) const
+{
+  if (t <= TUNNEL_TYPE || t >= _element_types.size() || !_element_types[t].factory)
+    return 0;
+  return (*_element_types[t].factory)(_element_types[t].thunk);
+}
+
 int
 Lexer::lexical_scoping_in() const
 {
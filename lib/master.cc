@@ -34,6 +34,9 @@
 #  define EV_SET_UDATA_CAST	/* nothing */
 # endif
 #endif
+#if CLICK_USERLEVEL && HAVE_USE_EPOLL
+# include <sys/epoll.h>
+#endif
 CLICK_DECLS
 
 #if CLICK_USERLEVEL && !HAVE_POLL_H
@@ -55,18 +58,11 @@ Master::Master(int nthreads)
     for (int tid = -2; tid < nthreads; tid++)
 	_threads.push_back(new RouterThread(this, tid));
 
-    // timer information
-#if CLICK_NS
-    _max_timer_stride = 1;
-#else
-    _max_timer_stride = 32;
-#endif
-    _timer_stride = _max_timer_stride;
-    _timer_count = 0;
-#if CLICK_LINUXMODULE
-    _timer_check_reports = 5;
-#else
-    _timer_check_reports = 0;
+    // timer information: each thread keeps its own timers
+    _max_timer_stride = _threads[0]->timer_set().max_timer_stride();
+#if HAVE_MULTITHREAD
+    _task_stealing = false;
+    _steal_requests = 0;
 #endif
 
 #if CLICK_USERLEVEL
@@ -75,6 +71,9 @@ Master::Master(int nthreads)
     _kqueue = kqueue();
     _selected_callno = 0;
 # endif
+# if HAVE_USE_EPOLL
+    _epoll = epoll_create(64);	// the size is only a hint
+# endif
 # if !HAVE_POLL_H
     FD_ZERO(&_read_select_fd_set);
     FD_ZERO(&_write_select_fd_set);
@@ -104,14 +103,11 @@ Master::Master(int nthreads)
     spin_lock_init(&_master_lock);
     _master_lock_task = 0;
     _master_lock_count = 0;
-    spin_lock_init(&_timer_lock);
-    _timer_task = 0;
 #endif
-    _timer_check = Timestamp::now();
-    _timer_check_reports = 0;
 
 #if CLICK_NS
     _simnode = 0;
+    _ns_pending = false;
 #endif
 }
 
@@ -139,6 +135,10 @@ Master::~Master()
     if (_kqueue >= 0)
 	close(_kqueue);
 #endif
+#if CLICK_USERLEVEL && HAVE_USE_EPOLL
+    if (_epoll >= 0)
+	close(_epoll);
+#endif
 }
 
 void
@@ -163,7 +163,9 @@ Master::unuse()
 void
 Master::pause()
 {
-    lock_timers();
+    // no thread is running timers once it holds their locks
+    for (RouterThread **tp = _threads.begin(); tp < _threads.end(); tp++)
+	(*tp)->timer_set().lock_timers();
 #if CLICK_USERLEVEL
     _select_lock.acquire();
 #endif
@@ -173,7 +175,8 @@ Master::pause()
 #if CLICK_USERLEVEL
     _select_lock.release();
 #endif
-    unlock_timers();
+    for (RouterThread **tp = _threads.end(); tp > _threads.begin(); )
+	(*--tp)->timer_set().unlock_timers();
 }
 
 
@@ -251,20 +254,8 @@ Master::kill_router(Router *router)
     // likely) when the pending list is processed.
 
     // Remove timers
-    {
-	lock_timers();
-	assert(!_timer_runchunk.size());
-	Timer* t;
-	for (Timer** tp = _timer_heap.end(); tp > _timer_heap.begin(); )
-	    if ((t = *--tp, t->router() == router)) {
-		remove_heap(_timer_heap.begin(), _timer_heap.end(), tp, timer_less(), timer_place(_timer_heap.begin()));
-		_timer_heap.pop_back();
-		t->_owner = 0;
-		t->_schedpos1 = 0;
-	    }
-	set_timer_expiry();
-	unlock_timers();
-    }
+    for (RouterThread **tp = _threads.begin(); tp < _threads.end(); tp++)
+	(*tp)->timer_set().kill_router(router);
 
 #if CLICK_USERLEVEL
     // Remove selects
@@ -399,122 +390,30 @@ Master::process_pending(RouterThread *thread)
     }
 }
 
-
-// TIMERS
-
-void
-Master::set_max_timer_stride(unsigned timer_stride)
-{
-    _max_timer_stride = timer_stride;
-    if (_timer_stride > _max_timer_stride)
-	_timer_stride = _max_timer_stride;
-}
-
+#if HAVE_MULTITHREAD
+/** @brief Turn work stealing between threads on or off.
+ *
+ * With work stealing on, a thread that runs out of scheduled tasks asks for
+ * work, and the next busy thread to finish a round of tasks moves one of its
+ * runnable tasks to it.  Only threads 0 to 31 take part. */
 void
-Master::check_timer_expiry(Timer *t)
+Master::set_task_stealing(bool stealing)
 {
-    // do not schedule timers for too far in the past
-    if (t->_expiry.sec() + Timer::behind_sec < _timer_check.sec()) {
-	if (_timer_check_reports > 0) {
-	    --_timer_check_reports;
-	    click_chatter("timer %p outdated expiry %{timestamp} updated to %{timestamp}", t, &t->_expiry, &_timer_check, &t->_expiry);
-	}
-	t->_expiry = _timer_check;
-    }
+    _task_stealing = stealing;
+    if (!stealing)
+	_steal_requests = 0;
 }
-
-inline void
-Master::run_one_timer(Timer *t)
-{
-#if CLICK_STATS >= 2
-    click_cycles_t start_cycles = click_get_cycles();
 #endif
 
-    t->_hook.callback(t, t->_thunk);
 
-#if CLICK_STATS >= 2
-    t->_owner->_timer_cycles += click_get_cycles() - start_cycles;
-    t->_owner->_timer_calls++;
-#endif
-}
+// TIMERS
 
 void
-Master::run_timers()
+Master::set_max_timer_stride(unsigned timer_stride)
 {
-    if (!attempt_lock_timers())
-	return;
-    if (_master_paused == 0 && _timer_heap.size() > 0 && !_stopper) {
-#if CLICK_LINUXMODULE
-	_timer_task = current;
-#endif
-	_timer_check = Timestamp::now();
-	Timer *t = _timer_heap.at_u(0);
-
-	if (t->_expiry <= _timer_check) {
-	    // potentially adjust timer stride
-	    Timestamp adj_expiry = t->_expiry + Timer::adjustment();
-	    if (adj_expiry <= _timer_check) {
-		_timer_count = 0;
-		if (_timer_stride > 1)
-		    _timer_stride = (_timer_stride * 4) / 5;
-	    } else if (++_timer_count >= 12) {
-		_timer_count = 0;
-		if (++_timer_stride >= _max_timer_stride)
-		    _timer_stride = _max_timer_stride;
-	    }
-
-	    // actually run timers
-	    int max_timers = 64;
-	    do {
-		pop_heap(_timer_heap.begin(), _timer_heap.end(), timer_less(), timer_place(_timer_heap.begin()));
-		_timer_heap.pop_back();
-		set_timer_expiry();
-		t->_schedpos1 = 0;
-
-		run_one_timer(t);
-	    } while (_timer_heap.size() > 0 && !_stopper
-		     && (t = _timer_heap.at_u(0), t->_expiry <= _timer_check)
-		     && --max_timers >= 0);
-
-	    // If we ran out of timers to run, then perhaps there's an
-	    // infinite timer loop or one timer is very far behind system
-	    // time.  Eventually the system would catch up and run all timers,
-	    // but in the meantime other timers could starve.  We detect this
-	    // case and run ALL expired timers, reducing possible damage.
-	    if (max_timers < 0 && !_stopper) {
-		_timer_runchunk.reserve(32);
-		do {
-		    pop_heap(_timer_heap.begin(), _timer_heap.end(), timer_less(), timer_place(_timer_heap.begin()));
-		    _timer_heap.pop_back();
-		    t->_schedpos1 = -_timer_runchunk.size() - 1;
-
-		    _timer_runchunk.push_back(t);
-		} while (_timer_heap.size() > 0
-			 && (t = _timer_heap.at_u(0), t->_expiry <= _timer_check));
-		set_timer_expiry();
-
-		Vector<Timer*>::iterator i = _timer_runchunk.begin();
-		for (; !_stopper && i != _timer_runchunk.end(); ++i)
-		    if (*i) {
-			(*i)->_schedpos1 = 0;
-			run_one_timer(*i);
-		    }
-
-		// reschedule unrun timers if stopped early
-		for (; i != _timer_runchunk.end(); ++i)
-		    if (*i) {
-			(*i)->_schedpos1 = 0;
-			(*i)->schedule_at((*i)->_expiry);
-		    }
-		_timer_runchunk.clear();
-	    }
-	}
-
-#if CLICK_LINUXMODULE
-	_timer_task = 0;
-#endif
-    }
-    unlock_timers();
+    _max_timer_stride = timer_stride;
+    for (RouterThread **tp = _threads.begin(); tp < _threads.end(); tp++)
+	(*tp)->timer_set().set_max_timer_stride(timer_stride);
 }
 
 
@@ -569,6 +468,9 @@ Master::add_select(int fd, Element *element, int mask)
 	_pollfds.back().events = 0;
     }
     int pi = _fd_to_pollfd[fd];
+#if HAVE_USE_EPOLL
+    int old_events = _pollfds[pi].events;
+#endif
 
     // add the elements
     if (add_read) {
@@ -609,6 +511,10 @@ Master::add_select(int fd, Element *element, int mask)
     }
 #endif
 
+#if HAVE_USE_EPOLL
+    update_epoll(fd, old_events, _pollfds[pi].events);
+#endif
+
 #if !HAVE_POLL_H
     // Add 'mask' to the fd_sets
     if (fd < FD_SETSIZE) {
@@ -664,6 +570,9 @@ Master::remove_pollfd(int pi, int event)
 	    click_chatter("Master::remove_pollfd(fd %d): kevent: %s", _pollfds[pi].fd, strerror(errno));
     }
 #endif
+#if HAVE_USE_EPOLL
+    update_epoll(fd, _pollfds[pi].events | event, _pollfds[pi].events);
+#endif
 #if !HAVE_POLL_H
     // remove event from select list
     if (fd < FD_SETSIZE) {
@@ -725,7 +634,7 @@ Master::remove_select(int fd, Element *element, int mask)
 
 #if HAVE_SYS_EVENT_H && HAVE_KQUEUE
 void
-Master::run_selects_kqueue(bool more_tasks)
+Master::run_selects_kqueue(RouterThread *thread, bool more_tasks)
 {
     // Decide how long to wait.
 # if CLICK_NS
@@ -739,7 +648,7 @@ Master::run_selects_kqueue(bool more_tasks)
     struct timespec wait, *wait_ptr = &wait;
     wait.tv_sec = wait.tv_nsec = 0;
     if (!more_tasks) {
-	Timestamp t = next_timer_expiry_adjusted();
+	Timestamp t = thread->timer_set().next_timer_expiry_adjusted();
 	if (t.sec() == 0)
 	    wait_ptr = 0;
 	else if ((t -= Timestamp::now(), t.sec() >= 0))
@@ -762,6 +671,7 @@ Master::run_selects_kqueue(bool more_tasks)
     struct kevent kev[64];
     int n = kevent(_kqueue, 0, 0, &kev[0], 64, wait_ptr);
     int was_errno = errno;
+    Timestamp::refresh_recent();
     run_signals();
 
 # if HAVE_MULTITHREAD
@@ -790,9 +700,99 @@ Master::run_selects_kqueue(bool more_tasks)
 }
 #endif /* HAVE_SYS_EVENT_H && HAVE_KQUEUE */
 
+#if HAVE_USE_EPOLL
+void
+Master::update_epoll(int fd, int old_events, int events)
+{
+    if (_epoll < 0 || old_events == events)
+	return;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = (events & POLLIN ? (uint32_t) EPOLLIN : 0U) | (events & POLLOUT ? (uint32_t) EPOLLOUT : 0U);
+    ev.data.fd = fd;
+    int op = (!old_events ? EPOLL_CTL_ADD : (events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL));
+    int r = epoll_ctl(_epoll, op, fd, &ev);
+    // closing a file descriptor takes it out of the epoll set, so one that
+    // was closed and reopened while selected must be added again
+    if (r < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+	r = epoll_ctl(_epoll, (op = EPOLL_CTL_ADD), fd, &ev);
+    if (r < 0) {
+	// Not all file descriptors are epollable (regular files, for
+	// example).  So if we encounter a problem, fall back to poll().
+	if (op != EPOLL_CTL_DEL)
+	    close(_epoll), _epoll = -1;
+	else if (errno != EBADF && errno != ENOENT)
+	    click_chatter("Master::remove_pollfd(fd %d): epoll_ctl: %s", fd, strerror(errno));
+    }
+}
+
+void
+Master::run_selects_epoll(RouterThread *thread, bool more_tasks)
+{
+    // Decide how long to wait.
+# if CLICK_NS
+    // Never block if we're running in the simulator.
+    int timeout = 0;
+    (void) more_tasks;
+# else
+    // Never wait if anything is scheduled; otherwise, if no timers, block
+    // indefinitely.
+    int timeout = 0;
+    if (!more_tasks) {
+	Timestamp t = thread->timer_set().next_timer_expiry_adjusted();
+	if (t.sec() == 0)
+	    timeout = -1;
+	else if ((t -= Timestamp::now(), t.sec() >= 0)) {
+	    if (t.sec() >= INT_MAX / 1000)
+		timeout = INT_MAX - 1000;
+	    else
+		timeout = t.msecval();
+	}
+    }
+# endif /* CLICK_NS */
+
+# if HAVE_MULTITHREAD
+    _selecting_processor = click_current_processor();
+    _select_lock.release();
+# endif
+
+    // Only the ready file descriptors come back, so a wakeup costs
+    // O(ready), not O(selected), and nothing is rebuilt between calls.
+    struct epoll_event ev[64];
+    int n = epoll_wait(_epoll, &ev[0], 64, timeout);
+    int was_errno = errno;
+    Timestamp::refresh_recent();
+    run_signals();
+
+# if HAVE_MULTITHREAD
+    _select_lock.acquire();
+    _selecting_processor = click_invalid_processor();
+# endif
+
+    if (n < 0 && was_errno != EINTR)
+	perror("epoll_wait");
+    else if (n > 0)
+	for (struct epoll_event *p = &ev[0]; p < &ev[n]; p++) {
+	    // Beware: calling 'selected()' might call remove_select(), so
+	    // look up the elements afresh for every event.
+	    int fd = p->data.fd;
+	    Element *read_elt = 0, *write_elt = 0;
+	    if ((p->events & ~EPOLLOUT) && fd < _read_elements.size())
+		read_elt = _read_elements[fd];
+	    if ((p->events & ~EPOLLIN) && fd < _write_elements.size())
+		write_elt = _write_elements[fd];
+
+	    if (read_elt)
+		read_elt->selected(fd);
+	    if (write_elt && write_elt != read_elt)
+		write_elt->selected(fd);
+	}
+}
+#endif /* HAVE_USE_EPOLL */
+
 #if HAVE_POLL_H
 void
-Master::run_selects_poll(bool more_tasks)
+Master::run_selects_poll(RouterThread *thread, bool more_tasks)
 {
     // Decide how long to wait.
 # if CLICK_NS
@@ -804,7 +804,7 @@ Master::run_selects_poll(bool more_tasks)
     // indefinitely.
     int timeout = 0;
     if (!more_tasks) {
-	Timestamp t = next_timer_expiry_adjusted();
+	Timestamp t = thread->timer_set().next_timer_expiry_adjusted();
 	if (t.sec() == 0)
 	    timeout = -1;
 	else if ((t -= Timestamp::now(), t.sec() >= 0)) {
@@ -828,6 +828,7 @@ Master::run_selects_poll(bool more_tasks)
 
     int n = poll(my_pollfds.begin(), my_pollfds.size(), timeout);
     int was_errno = errno;
+    Timestamp::refresh_recent();
     run_signals();
 
 # if HAVE_MULTITHREAD
@@ -865,7 +866,7 @@ Master::run_selects_poll(bool more_tasks)
 
 #else /* !HAVE_POLL_H */
 void
-Master::run_selects_select(bool more_tasks)
+Master::run_selects_select(RouterThread *thread, bool more_tasks)
 {
     // Decide how long to wait.
 # if CLICK_NS
@@ -879,7 +880,7 @@ Master::run_selects_select(bool more_tasks)
     struct timeval wait, *wait_ptr = &wait;
     timerclear(&wait);
     if (!more_tasks) {
-	Timestamp t = next_timer_expiry_adjusted();
+	Timestamp t = thread->timer_set().next_timer_expiry_adjusted();
 	if (t.sec() == 0)
 	    wait_ptr = 0;
 	else if ((t -= Timestamp::now(), t.sec() >= 0))
@@ -897,6 +898,7 @@ Master::run_selects_select(bool more_tasks)
 
     int n = select(_max_select_fd + 1, &read_mask, &write_mask, (fd_set*) 0, wait_ptr);
     int was_errno = errno;
+    Timestamp::refresh_recent();
     run_signals();
 
 # if HAVE_MULTITHREAD
@@ -934,7 +936,7 @@ Master::run_selects_select(bool more_tasks)
 #endif /* HAVE_POLL_H */
 
 void
-Master::run_selects(bool more_tasks)
+Master::run_selects(RouterThread *thread, bool more_tasks)
 {
     // Wait in select() for input or timer, and call relevant elements'
     // selected() methods.
@@ -952,7 +954,7 @@ Master::run_selects(bool more_tasks)
 	_select_lock.release();
 	if (!more_tasks) {
 	    struct timeval wait, *wait_ptr = &wait;
-	    Timestamp t = next_timer_expiry_adjusted();
+	    Timestamp t = thread->timer_set().next_timer_expiry_adjusted();
 	    if (t.sec() == 0)
 		wait_ptr = 0;
 	    else if ((t -= Timestamp::now(), t.sec() >= 0))
@@ -975,14 +977,20 @@ Master::run_selects(bool more_tasks)
     // Call the relevant selector implementation.
 #if HAVE_SYS_EVENT_H && HAVE_KQUEUE
     if (_kqueue >= 0) {
-	run_selects_kqueue(more_tasks);
+	run_selects_kqueue(thread, more_tasks);
+	goto unlock_select_exit;
+    }
+#endif
+#if HAVE_USE_EPOLL
+    if (_epoll >= 0) {
+	run_selects_epoll(thread, more_tasks);
 	goto unlock_select_exit;
     }
 #endif
 #if HAVE_POLL_H
-    run_selects_poll(more_tasks);
+    run_selects_poll(thread, more_tasks);
 #else
-    run_selects_select(more_tasks);
+    run_selects_select(thread, more_tasks);
 #endif
 
  unlock_select_exit:
@@ -1124,6 +1132,35 @@ Master::initialize_ns(simclick_node_t *simnode)
 {
     assert(!_simnode);
     _simnode = simnode;
+    _ns_scheduled = Timestamp();
+    _ns_pending = false;
+}
+
+void
+Master::ns_schedule(const Timestamp &when)
+{
+    // The simulator will run us at _ns_scheduled, and we will ask again
+    // then, so one event covers every timer due at or after it: a node
+    // whose timers all fire together costs one event per timestamp, not
+    // one per timer, however often they are rescheduled meanwhile, and
+    // however many packets arrive at the same instant. (Timers run on
+    // every pass under CLICK_NS, as the timer stride is 1.)
+    if (_ns_pending && _ns_scheduled <= when)
+	return;
+    struct timeval tv = when.timeval();
+    simclick_sim_command(_simnode, SIMCLICK_SCHEDULE, &tv);
+    _ns_scheduled = Timestamp(tv);	// as the simulator will see it
+    _ns_pending = true;
+}
+
+void
+Master::ns_event_due()
+{
+    // The simulator runs us for an event; if it may be the one we asked
+    // for, a request for this instant or later must reach it again. A
+    // superseded later event then merely gets requested twice.
+    if (_ns_pending && _ns_scheduled <= Timestamp::now())
+	_ns_pending = false;
 }
 
 #endif
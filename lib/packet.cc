@@ -25,8 +25,19 @@
 #if CLICK_USERLEVEL
 # include <unistd.h>
 #endif
+#if HAVE_CLICK_PACKET_POOL
+# include <click/straccum.hh>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+#endif
 CLICK_DECLS
 
+#if HAVE_CLICK_PACKET_POOL
+namespace {
+inline void pool_free_data(unsigned char *d, uint32_t n);
+}
+#endif
+
 /** @file packet.hh
  * @brief The Packet class models packets in Click.
  */
@@ -220,7 +231,11 @@ Packet::~Packet()
     else if (_head && _destructor)
 	_destructor(_head, _end - _head);
     else
+#  if HAVE_CLICK_PACKET_POOL
+	pool_free_data(_head, _end - _head);
+#  else
 	delete[] _head;
+#  endif
 # elif CLICK_BSDMODULE
     else
 	m_freem(_m);
@@ -229,12 +244,500 @@ Packet::~Packet()
 #endif
 }
 
+#if HAVE_CLICK_PACKET_POOL
+//
+// PACKET POOL
+//
+
+// Packet objects and the buffers of two size classes are kept on free lists
+// of the thread that freed them, and reused by the next Packet::make or
+// clone() on that thread.  A thread whose list is full collects what it frees
+// into batches on a global stack, from which a thread whose list is empty
+// takes a batch: that is how packets made by one thread and killed by
+// another find their way back.  The stack is only pushed and emptied as a
+// whole, which needs no lock and is safe from ABA.  Objects and buffers are
+// still allocated with new, so those that don't fit are simply deleted.
+//
+// After Packet::pool_arena, buffers instead come from an arena per NUMA
+// node, mapped on huge pages if the system has them reserved, so that
+// packet data costs few TLB entries and stays in the memory of the socket
+// that uses it.  Each thread belongs to the node it first allocated on, and
+// there is a stack of batches per node: a thread refills its lists from its
+// node's stack, then from its node's arena, then from other nodes' stacks.
+// Arena buffers are never deleted; one freed by a thread of another node is
+// a remote free, and is collected into a batch that goes back to the stack
+// of its own node.
+
+namespace {
+
+enum { POOL_PACKET, POOL_SMALL, POOL_LARGE, POOL_NKIND };
+
+const uint32_t pool_buffer_size[POOL_NKIND] = {
+    0,
+    512,			// control traffic, such as OLSR messages
+    2048			// default headroom plus an Ethernet frame
+};
+
+enum {
+    POOL_LIMIT = 1024,		// objects of each kind on a thread's list
+    POOL_BATCH = 128,		// objects in a batch between threads
+    POOL_NODES = 8		// NUMA nodes; threads of higher nodes use node 0
+};
+
+struct PacketPoolItem {
+    PacketPoolItem *next;
+    PacketPoolItem *batch_next;	// at the head of a batch
+};
+
+struct PacketPoolList {
+    PacketPoolItem *head;
+    uint32_t count;
+# if HAVE_MULTITHREAD
+    PacketPoolItem *batch;	// being collected for the global stack
+    uint32_t batch_count;
+    PacketPoolItem *remote[POOL_NODES];	// arena buffers of other nodes,
+    uint32_t remote_count[POOL_NODES];	// being collected for their stacks
+# endif
+    // statistics
+    uint64_t allocs;
+    uint64_t reuses;
+    uint64_t frees;
+    uint64_t deletes;
+    uint64_t carved;		// buffers taken from the arena
+    uint64_t remote_frees;	// arena buffers of another node freed
+};
+
+struct PacketPool {
+    PacketPoolList list[POOL_NKIND];
+    int node;			// 0 without arenas
+# if HAVE_MULTITHREAD
+    PacketPool *next_pool;
+# endif
+};
+
+struct PacketArena {
+    unsigned char *base;	// set before state becomes ARENA_MAPPED
+    size_t size;
+    size_t used;		// bytes carved, may overshoot size
+    bool hugepages;
+    int state;
+};
+
+enum { ARENA_UNMAPPED, ARENA_MAPPING, ARENA_MAPPED, ARENA_FAILED };
+
+size_t arena_size;		// bytes per node; 0 without arenas
+PacketArena arenas[POOL_NODES];
+
+// the NUMA node of the calling thread's CPU
+int
+current_node()
+{
+# ifdef SYS_getcpu
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, (void *) 0) == 0 && node < POOL_NODES)
+	return node;
+# endif
+    return 0;
+}
+
+# if HAVE_MULTITHREAD
+__thread PacketPool *thread_pool;
+PacketPool *all_pools;
+PacketPoolItem *global_batches[POOL_NODES][POOL_NKIND];
+uint32_t global_batches_pushed[POOL_NKIND];
+uint32_t global_batches_taken[POOL_NKIND];
+
+PacketPool *
+make_thread_pool()
+{
+    PacketPool *pool = new PacketPool;
+    memset(pool, 0, sizeof(PacketPool));
+    pool->node = (arena_size ? current_node() : 0);
+    do {
+	pool->next_pool = all_pools;
+    } while (!__sync_bool_compare_and_swap(&all_pools, pool->next_pool, pool));
+    return thread_pool = pool;
+}
+
+inline PacketPool *
+packet_pool()
+{
+    PacketPool *pool = thread_pool;
+    return likely(pool) ? pool : make_thread_pool();
+}
+
+void
+push_batches(int node, int kind, PacketPoolItem *first)
+{
+    PacketPoolItem *last = first;
+    while (last->batch_next)
+	last = last->batch_next;
+    do {
+	last->batch_next = global_batches[node][kind];
+    } while (!__sync_bool_compare_and_swap(&global_batches[node][kind], last->batch_next, first));
+}
+
+PacketPoolItem *
+take_batch(int node, int kind)
+{
+    PacketPoolItem *b = global_batches[node][kind];
+    if (!b || !(b = __sync_lock_test_and_set(&global_batches[node][kind], (PacketPoolItem *) 0)))
+	return 0;
+    if (PacketPoolItem *rest = b->batch_next)
+	push_batches(node, kind, rest);
+    __sync_fetch_and_add(&global_batches_taken[kind], 1);
+    return b;
+}
+# else
+PacketPool the_pool;
+
+inline PacketPool *
+packet_pool()
+{
+    return &the_pool;
+}
+# endif
+
+// the arena of node, mapped by the first thread that needs it; null if it
+// could not be mapped, or another thread is mapping it
+PacketArena *
+node_arena(int node)
+{
+    PacketArena &a = arenas[node];
+    if (likely(a.state == ARENA_MAPPED))
+	return &a;
+    if (a.state != ARENA_UNMAPPED
+	|| !__sync_bool_compare_and_swap(&a.state, ARENA_UNMAPPED, ARENA_MAPPING))
+	return 0;
+    void *m = MAP_FAILED;
+# ifdef MAP_HUGETLB
+    m = mmap(0, arena_size, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    a.hugepages = (m != MAP_FAILED);
+# endif
+    if (m == MAP_FAILED) {
+	m = mmap(0, arena_size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+# ifdef MADV_HUGEPAGE
+	if (m != MAP_FAILED)	// transparent huge pages, if enabled
+	    madvise(m, arena_size, MADV_HUGEPAGE);
+# endif
+    }
+    if (m == MAP_FAILED) {
+	a.state = ARENA_FAILED;
+	return 0;
+    }
+# ifdef SYS_mbind
+    // prefer the node's memory even for pages another node's thread touches
+    // first; without mbind, first touch by the carving thread places them
+    unsigned long nodemask = 1UL << node;
+    (void) syscall(SYS_mbind, m, arena_size, 1 /* MPOL_PREFERRED */,
+		   &nodemask, sizeof(nodemask) * 8, 0);
+# endif
+    a.base = reinterpret_cast<unsigned char *>(m);
+    a.size = arena_size;
+    __sync_synchronize();
+    a.state = ARENA_MAPPED;
+    return &a;
+}
+
+// puts up to POOL_BATCH new buffers of kind from the arena of pool's node
+// on its list; returns the first, or null if the arena is used up
+PacketPoolItem *
+arena_carve(PacketPool *pool, int kind)
+{
+    PacketArena *a = node_arena(pool->node);
+    if (!a)
+	return 0;
+    size_t n = pool_buffer_size[kind];
+    size_t offset = __sync_fetch_and_add(&a->used, n * POOL_BATCH);
+    PacketPoolList &l = pool->list[kind];
+    for (int i = 0; i < POOL_BATCH && offset + n <= a->size; i++, offset += n) {
+	PacketPoolItem *item = reinterpret_cast<PacketPoolItem *>(a->base + offset);
+	item->next = l.head;
+	l.head = item;
+	l.count++;
+	l.carved++;
+    }
+    return l.head;
+}
+
+// refills an empty list of pool from its node's arena, then from the
+// stacks of other nodes; returns the first object, or null
+PacketPoolItem *
+pool_refill(PacketPool *pool, int kind)
+{
+    PacketPoolItem *item = 0;
+    if (kind != POOL_PACKET)
+	item = arena_carve(pool, kind);
+# if HAVE_MULTITHREAD
+    for (int node = 0; node < POOL_NODES && !item; node++)
+	if (node != pool->node && (item = take_batch(node, kind)))
+	    pool->list[kind].count = POOL_BATCH;
+# endif
+    return item;
+}
+
+// the node of the arena d was carved from, or -1 if it came from new[]
+inline int
+arena_node(const unsigned char *d)
+{
+    for (int node = 0; node < POOL_NODES; node++)
+	if (d >= arenas[node].base && d < arenas[node].base + arenas[node].size)
+	    return node;
+    return -1;
+}
+
+inline void *
+pool_get(int kind)
+{
+    PacketPool *pool = packet_pool();
+    PacketPoolList &l = pool->list[kind];
+    l.allocs++;
+    PacketPoolItem *item = l.head;
+    if (unlikely(!item)) {
+# if HAVE_MULTITHREAD
+	if (l.batch) {
+	    item = l.batch;
+	    l.count = l.batch_count;
+	    l.batch = 0;
+	    l.batch_count = 0;
+	} else if ((item = take_batch(pool->node, kind)))
+	    l.count = POOL_BATCH;
+# endif
+	if (!item && arena_size)
+	    item = pool_refill(pool, kind);
+	if (!item)
+	    return 0;
+    }
+    l.head = item->next;
+    l.count--;
+    l.reuses++;
+    return item;
+}
+
+// returns false if the caller must delete the object, which it must not do
+// with arena memory
+inline bool
+pool_put(int kind, void *p, bool arena = false)
+{
+    PacketPool *pool = packet_pool();
+    PacketPoolList &l = pool->list[kind];
+    PacketPoolItem *item = reinterpret_cast<PacketPoolItem *>(p);
+    l.frees++;
+    if (likely(l.count < POOL_LIMIT)) {
+	item->next = l.head;
+	l.head = item;
+	l.count++;
+	return true;
+    }
+# if HAVE_MULTITHREAD
+    item->next = l.batch;
+    item->batch_next = 0;
+    l.batch = item;
+    if (++l.batch_count == POOL_BATCH) {
+	push_batches(pool->node, kind, l.batch);
+	__sync_fetch_and_add(&global_batches_pushed[kind], 1);
+	l.batch = 0;
+	l.batch_count = 0;
+    }
+    return true;
+# else
+    if (arena) {
+	item->next = l.head;
+	l.head = item;
+	l.count++;
+	return true;
+    }
+    l.deletes++;
+    return false;
+# endif
+}
+
+// frees a buffer carved from the arena of node
+void
+arena_put(int kind, void *p, int node)
+{
+# if HAVE_MULTITHREAD
+    PacketPool *pool = packet_pool();
+    if (node != pool->node) {
+	PacketPoolList &l = pool->list[kind];
+	PacketPoolItem *item = reinterpret_cast<PacketPoolItem *>(p);
+	l.frees++;
+	l.remote_frees++;
+	item->next = l.remote[node];
+	item->batch_next = 0;
+	l.remote[node] = item;
+	if (++l.remote_count[node] == POOL_BATCH) {
+	    push_batches(node, kind, l.remote[node]);
+	    __sync_fetch_and_add(&global_batches_pushed[kind], 1);
+	    l.remote[node] = 0;
+	    l.remote_count[node] = 0;
+	}
+	return;
+    }
+# else
+    (void) node;
+# endif
+    pool_put(kind, p, true);
+}
+
+inline void *
+pool_alloc_packet()
+{
+    if (void *p = pool_get(POOL_PACKET))
+	return p;
+    return ::operator new(sizeof(WritablePacket));
+}
+
+// rounds n up to the size of its class
+inline unsigned char *
+pool_alloc_data(uint32_t &n)
+{
+    for (int kind = POOL_SMALL; kind < POOL_NKIND; kind++)
+	if (n <= pool_buffer_size[kind]) {
+	    n = pool_buffer_size[kind];
+	    if (void *d = pool_get(kind))
+		return reinterpret_cast<unsigned char *>(d);
+	    break;
+	}
+    return new unsigned char[n];
+}
+
+// any buffer of a class size can join the pool: pooled buffers come from
+// new[] as well, or from an arena, which only they can
+inline void
+pool_free_data(unsigned char *d, uint32_t n)
+{
+    for (int kind = POOL_SMALL; d && kind < POOL_NKIND; kind++)
+	if (n == pool_buffer_size[kind]) {
+	    int node;
+	    if (unlikely(arena_size) && (node = arena_node(d)) >= 0) {
+		arena_put(kind, d, node);
+		return;
+	    }
+	    if (pool_put(kind, d))
+		return;
+	    break;
+	}
+    delete[] d;
+}
+
+}
+
+// kill() of the last reference: frees the data as ~Packet() does, but
+// returns the memory to the pool
+void
+Packet::recycle()
+{
+    if (_data_packet)
+	_data_packet->kill();
+    else if (_head && _destructor)
+	_destructor(_head, _end - _head);
+    else
+	pool_free_data(_head, _end - _head);
+    if (!pool_put(POOL_PACKET, this))
+	::operator delete(this);
+}
+
+/** @brief Report packet pool statistics.
+ * @param sa report destination
+ *
+ * For packet objects and each buffer size class, appends the number of
+ * allocations and how many of them reused pooled memory, the number of frees
+ * and how many of them deleted the memory because the pool was full, and the
+ * objects pooled now.  With pool_arena(), also the buffers carved from the
+ * arenas and the frees of buffers of another node's arena, and the size and
+ * use of each node's arena and whether it is on huge pages.  Counters are
+ * summed over threads, and read without synchronization from the threads
+ * that update them.  Implements the global "packet_pool" handler. */
+void
+Packet::pool_report(StringAccum &sa)
+{
+    for (int kind = 0; kind < POOL_NKIND; kind++) {
+	uint64_t allocs = 0, reuses = 0, frees = 0, deletes = 0;
+	uint64_t carved = 0, remote_frees = 0;
+	uint32_t pooled = 0;
+# if HAVE_MULTITHREAD
+	for (PacketPool *pool = all_pools; pool; pool = pool->next_pool) {
+	    const PacketPoolList &l = pool->list[kind];
+	    pooled += l.count + l.batch_count;
+	    for (int node = 0; node < POOL_NODES; node++)
+		pooled += l.remote_count[node];
+# else
+	{
+	    const PacketPoolList &l = the_pool.list[kind];
+	    pooled += l.count;
+# endif
+	    allocs += l.allocs;
+	    reuses += l.reuses;
+	    frees += l.frees;
+	    deletes += l.deletes;
+	    carved += l.carved;
+	    remote_frees += l.remote_frees;
+	}
+	String prefix;
+	if (kind == POOL_PACKET)
+	    prefix = "packet";
+	else
+	    prefix = "buffer" + String(pool_buffer_size[kind]);
+	sa << prefix << "_allocs " << allocs << '\n'
+	   << prefix << "_reuses " << reuses << '\n'
+	   << prefix << "_frees " << frees << '\n'
+	   << prefix << "_deletes " << deletes << '\n'
+	   << prefix << "_pooled " << pooled << '\n';
+# if HAVE_MULTITHREAD
+	sa << prefix << "_batches_pushed " << global_batches_pushed[kind] << '\n'
+	   << prefix << "_batches_taken " << global_batches_taken[kind] << '\n';
+# endif
+	if (arena_size && kind != POOL_PACKET)
+	    sa << prefix << "_carved " << carved << '\n'
+	       << prefix << "_remote_frees " << remote_frees << '\n';
+    }
+    for (int node = 0; node < POOL_NODES; node++)
+	if (arenas[node].state == ARENA_MAPPED) {
+	    const PacketArena &a = arenas[node];
+	    String prefix = "arena" + String(node);
+	    sa << prefix << "_size " << a.size << '\n'
+	       << prefix << "_used " << (a.used < a.size ? a.used : a.size) << '\n'
+	       << prefix << "_hugepages " << (a.hugepages ? "true" : "false") << '\n';
+	} else if (arenas[node].state == ARENA_FAILED)
+	    sa << "arena" << node << "_failed true\n";
+}
+
+/** @brief Carve packet buffers from per-NUMA-node arenas.
+ * @param node_size bytes of each node's arena
+ *
+ * Pooled buffers are then taken from an arena of @a node_size bytes, rounded
+ * up to 2MB, for each NUMA node that has a thread making packets.  A thread
+ * belongs to the node it runs on when it first makes a packet, so threads
+ * are best bound to CPUs before.  The arenas are mapped on huge pages if
+ * enough are reserved (vm.nr_hugepages), and otherwise on ordinary pages
+ * with transparent huge pages requested.  Once an arena is used up, its
+ * node allocates with new[] as before.  Arena memory is never unmapped.
+ *
+ * Must be called before the first packet is made; a @a node_size of 0 does
+ * nothing. */
+void
+Packet::pool_arena(size_t node_size)
+{
+    if (node_size) {
+	arena_size = (node_size + (2 << 20) - 1) & ~(size_t) ((2 << 20) - 1);
+	packet_pool()->node = current_node();
+    }
+}
+#endif
+
 #if !CLICK_LINUXMODULE
 
 inline WritablePacket *
 Packet::make(int, int, int)
 {
+#if HAVE_CLICK_PACKET_POOL
+    return static_cast<WritablePacket *>(new(pool_alloc_packet()) Packet(6, 6, 6));
+#else
     return static_cast<WritablePacket *>(new Packet(6, 6, 6));
+#endif
 }
 
 bool
@@ -246,7 +749,11 @@ Packet::alloc_data(uint32_t headroom, uint32_t len, uint32_t tailroom)
     n = min_buffer_length;
   }
 #if CLICK_USERLEVEL
+# if HAVE_CLICK_PACKET_POOL
+  unsigned char *d = pool_alloc_data(n);
+# else
   unsigned char *d = new unsigned char[n];
+# endif
   if (!d)
     return false;
   _head = d;
@@ -316,7 +823,11 @@ Packet::make(uint32_t headroom, const void *data,
     } else
 	return 0;
 #else
+# if HAVE_CLICK_PACKET_POOL
+    WritablePacket *p = new(pool_alloc_packet()) WritablePacket;
+# else
     WritablePacket *p = new WritablePacket;
+# endif
     if (!p)
 	return 0;
     if (!p->alloc_data(headroom, length, tailroom)) {
@@ -350,7 +861,11 @@ WritablePacket *
 Packet::make(unsigned char *data, uint32_t length,
 	     void (*destructor)(unsigned char *, size_t))
 {
+# if HAVE_CLICK_PACKET_POOL
+    WritablePacket *p = new(pool_alloc_packet()) WritablePacket;
+# else
     WritablePacket *p = new WritablePacket;
+# endif
     if (p) {
 	p->_head = p->_data = data;
 	p->_tail = p->_end = data + length;
@@ -508,7 +1023,11 @@ Packet::expensive_uniqueify(int32_t extra_headroom, int32_t extra_tailroom,
     else if (_destructor)
 	_destructor(old_head, old_end - old_head);
     else
+#  if HAVE_CLICK_PACKET_POOL
+	pool_free_data(old_head, old_end - old_head);
+#  else
 	delete[] old_head;
+#  endif
     _destructor = 0;
 # elif CLICK_BSDMODULE
     else
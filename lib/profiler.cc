@@ -0,0 +1,425 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/profiler.hh" -*-
+/*
+ * profiler.{cc,hh} -- profile cycles by element port and call path
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/profiler.hh>
+#if HAVE_ELEMENT_PROFILE
+#include <click/element.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/sync.hh>
+#include <click/hashmap.hh>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#if HAVE_LINUX_PERF_EVENT_H
+# include <linux/perf_event.h>
+# include <sys/syscall.h>
+#endif
+CLICK_DECLS
+
+volatile bool ElementProfiler::_active;
+
+namespace {
+
+// one path of calls, below the node of its caller
+struct Node {
+    Element *element;
+    int port;
+    int kind;
+    String label;		// the frame's name in folded stacks
+    Node *parent;
+    Vector<Node *> children;
+    uint64_t calls;
+    uint64_t packets;
+    click_cycles_t cycles;	// in the calls, including their callees
+    click_cycles_t child_cycles;
+    uint64_t events;		// of the hardware event, likewise
+    uint64_t child_events;
+
+    Node(Element *e, int p, int k, Node *par)
+	: element(e), port(p), kind(k), parent(par), calls(0), packets(0),
+	  cycles(0), child_cycles(0), events(0), child_events(0) {
+	make_label();
+    }
+    ~Node() {
+	for (Node **c = children.begin(); c != children.end(); ++c)
+	    delete *c;
+    }
+    void make_label();
+};
+
+void
+Node::make_label()
+{
+    StringAccum sa;
+    String name = (element ? element->name() : String("?"));
+    switch (kind) {
+      case ElementProfiler::PUSH:
+	sa << '[' << port << ']' << name;
+	break;
+      case ElementProfiler::PULL:
+	sa << name << '[' << port << ']';
+	break;
+      case ElementProfiler::TASK:
+	sa << name << ":task";
+	break;
+      case ElementProfiler::TIMER:
+	sa << name << ":timer";
+	break;
+    }
+    label = sa.take_string();
+}
+
+}
+
+struct ElementProfiler::Frame {
+    Node *node;
+    click_cycles_t start;
+    uint64_t events_start;
+};
+
+namespace {
+
+// the state of one thread, which only it changes; readers take lock
+struct ThreadProfile {
+    Node root;
+    ElementProfiler::Frame frames[ElementProfiler::MAX_DEPTH];
+    int depth;
+    unsigned generation;	// of the reset the tree was started after
+    int event;			// index into event_types the fd counts
+    int fd;
+    Spinlock lock;		// held while the tree changes shape
+    ThreadProfile *next;
+
+    ThreadProfile()
+	: root(0, -1, ElementProfiler::TASK, 0), depth(0), generation(0),
+	  event(0), fd(-1), next(0) {
+    }
+};
+
+struct EventType {
+    const char *name;
+    uint64_t config;
+};
+
+const EventType event_types[] = {
+    { "none", 0 },
+#if HAVE_LINUX_PERF_EVENT_H
+    { "instructions", PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses", PERF_COUNT_HW_CACHE_MISSES },
+    { "cache-references", PERF_COUNT_HW_CACHE_REFERENCES },
+    { "branch-misses", PERF_COUNT_HW_BRANCH_MISSES },
+    { "cpu-cycles", PERF_COUNT_HW_CPU_CYCLES },
+#endif
+};
+const int nevent_types = sizeof(event_types) / sizeof(event_types[0]);
+
+ThreadProfile *threads;		// all threads that ever profiled
+Spinlock threads_lock;
+volatile unsigned generation = 1;
+volatile int event;
+
+#if HAVE_MULTITHREAD
+__thread ThreadProfile *this_thread;
+#else
+ThreadProfile *this_thread;
+#endif
+
+void
+open_event(ThreadProfile *t)
+{
+    if (t->fd >= 0)
+	close(t->fd);
+    t->fd = -1;
+    t->event = event;
+#if HAVE_LINUX_PERF_EVENT_H
+    if (t->event) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = event_types[t->event].config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// this thread, on any processor
+	t->fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (t->fd < 0)
+	    click_chatter("profile: cannot count %s: %s", event_types[t->event].name, strerror(errno));
+    }
+#endif
+}
+
+inline uint64_t
+read_event(ThreadProfile *t)
+{
+    uint64_t value = 0;
+    if (t->fd >= 0 && read(t->fd, &value, sizeof(value)) != sizeof(value))
+	value = 0;
+    return value;
+}
+
+ThreadProfile *
+thread_profile()
+{
+    ThreadProfile *t = this_thread;
+    if (unlikely(!t)) {
+	t = this_thread = new ThreadProfile;
+	threads_lock.acquire();
+	t->next = threads;
+	threads = t;
+	threads_lock.release();
+    }
+    // start over after a reset, between calls only
+    if (t->depth == 0 && (t->generation != generation || t->event != event)) {
+	t->lock.acquire();
+	for (Node **c = t->root.children.begin(); c != t->root.children.end(); ++c)
+	    delete *c;
+	t->root.children.clear();
+	t->generation = generation;
+	t->lock.release();
+	if (t->event != event)
+	    open_event(t);
+    }
+    return t;
+}
+
+}
+
+ElementProfiler::Frame *
+ElementProfiler::enter_slow(Element *e, int port, int kind)
+{
+    ThreadProfile *t = thread_profile();
+    if (t->depth == MAX_DEPTH)
+	return 0;
+    Node *parent = (t->depth ? t->frames[t->depth - 1].node : &t->root);
+    Node *n = 0;
+    for (Node **c = parent->children.begin(); c != parent->children.end(); ++c)
+	if ((*c)->element == e && (*c)->port == port && (*c)->kind == kind) {
+	    n = *c;
+	    break;
+	}
+    if (!n) {
+	n = new Node(e, port, kind, parent);
+	t->lock.acquire();
+	parent->children.push_back(n);
+	t->lock.release();
+    }
+    Frame *f = &t->frames[t->depth++];
+    f->node = n;
+    f->events_start = (t->fd >= 0 ? read_event(t) : 0);
+    f->start = click_get_cycles();
+    return f;
+}
+
+void
+ElementProfiler::leave_slow(Frame *f, unsigned packets)
+{
+    click_cycles_t cycles = click_get_cycles() - f->start;
+    ThreadProfile *t = this_thread;
+    uint64_t events = (t->fd >= 0 ? read_event(t) - f->events_start : 0);
+    Node *n = f->node;
+    n->calls++;
+    n->packets += packets;
+    n->cycles += cycles;
+    n->events += events;
+    // frames above f that were never left are dropped with it
+    t->depth = f - t->frames;
+    n->parent->child_cycles += cycles;
+    n->parent->child_events += events;
+}
+
+int
+ElementProfiler::set_event(const String &name, ErrorHandler *errh)
+{
+    for (int i = 0; i < nevent_types; i++)
+	if (name == event_types[i].name) {
+	    event = i;
+	    return 0;
+	}
+    StringAccum sa;
+    for (int i = 0; i < nevent_types; i++)
+	sa << (i ? ", " : "") << event_types[i].name;
+    return errh->error("unknown event %<%s%>, expected one of %s", name.c_str(), sa.c_str());
+}
+
+void
+ElementProfiler::reset()
+{
+    generation++;
+}
+
+namespace {
+
+struct Row {
+    String label;
+    uint64_t calls;
+    uint64_t packets;
+    click_cycles_t cycles;
+    click_cycles_t self;
+    uint64_t events;
+    uint64_t self_events;
+};
+
+void
+sum_rows(const Node *n, HashMap<String, int> &index, Vector<Row> &rows)
+{
+    int &i = index.find_force(n->label, -1);
+    if (i < 0) {
+	i = rows.size();
+	Row r;
+	r.label = n->label;
+	r.calls = r.packets = r.events = r.self_events = 0;
+	r.cycles = r.self = 0;
+	rows.push_back(r);
+    }
+    Row &r = rows[i];
+    r.calls += n->calls;
+    r.packets += n->packets;
+    r.cycles += n->cycles;
+    r.self += n->cycles - n->child_cycles;
+    r.events += n->events;
+    r.self_events += n->events - n->child_events;
+    for (Node * const *c = n->children.begin(); c != n->children.end(); ++c)
+	sum_rows(*c, index, rows);
+}
+
+int
+row_compar(const void *a, const void *b, void *)
+{
+    const Row *ra = static_cast<const Row *>(a), *rb = static_cast<const Row *>(b);
+    if (ra->self != rb->self)
+	return ra->self > rb->self ? -1 : 1;
+    return String::compare(ra->label, rb->label);
+}
+
+void
+unparse_node(const Node *n, const String &path, StringAccum &sa)
+{
+    String here = (path ? path + ";" + n->label : n->label);
+    if (n->cycles > n->child_cycles)
+	sa << here << ' ' << (n->cycles - n->child_cycles) << '\n';
+    for (Node * const *c = n->children.begin(); c != n->children.end(); ++c)
+	unparse_node(*c, here, sa);
+}
+
+}
+
+void
+ElementProfiler::unparse_table(StringAccum &sa)
+{
+    HashMap<String, int> index(-1);
+    Vector<Row> rows;
+    threads_lock.acquire();
+    for (ThreadProfile *t = threads; t; t = t->next) {
+	t->lock.acquire();
+	if (t->generation == generation)
+	    for (Node **c = t->root.children.begin(); c != t->root.children.end(); ++c)
+		sum_rows(*c, index, rows);
+	t->lock.release();
+    }
+    threads_lock.release();
+    if (rows.size())
+	click_qsort(rows.begin(), rows.size(), sizeof(Row), row_compar);
+
+    bool events = (event != 0);
+    sa << "# port\tcalls\tpackets\tcycles\tself\tself/packet";
+    if (events)
+	sa << '\t' << event_types[event].name << "\tself";
+    sa << '\n';
+    for (Row *r = rows.begin(); r != rows.end(); ++r) {
+	sa << r->label << '\t' << r->calls << '\t' << r->packets << '\t'
+	   << r->cycles << '\t' << r->self << '\t';
+	if (r->packets)
+	    sa << (r->self / r->packets);
+	else
+	    sa << '-';
+	if (events)
+	    sa << '\t' << r->events << '\t' << r->self_events;
+	sa << '\n';
+    }
+}
+
+void
+ElementProfiler::unparse_folded(StringAccum &sa)
+{
+    threads_lock.acquire();
+    for (ThreadProfile *t = threads; t; t = t->next) {
+	t->lock.acquire();
+	if (t->generation == generation)
+	    for (Node **c = t->root.children.begin(); c != t->root.children.end(); ++c)
+		unparse_node(*c, String(), sa);
+	t->lock.release();
+    }
+    threads_lock.release();
+}
+
+enum { H_PROFILE, H_FOLDED, H_ACTIVE, H_EVENT, H_RESET };
+
+static String
+profile_read_handler(Element *, void *thunk)
+{
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+      case H_PROFILE:
+	ElementProfiler::unparse_table(sa);
+	break;
+      case H_FOLDED:
+	ElementProfiler::unparse_folded(sa);
+	break;
+      case H_ACTIVE:
+	return cp_unparse_bool(ElementProfiler::active());
+      case H_EVENT:
+	return event_types[event].name;
+    }
+    return sa.take_string();
+}
+
+static int
+profile_write_handler(const String &str, Element *, void *thunk, ErrorHandler *errh)
+{
+    switch ((intptr_t) thunk) {
+      case H_ACTIVE: {
+	  bool active;
+	  if (!cp_bool(cp_uncomment(str), &active))
+	      return errh->error("expected boolean");
+	  ElementProfiler::set_active(active);
+	  return 0;
+      }
+      case H_EVENT:
+	return ElementProfiler::set_event(cp_uncomment(str), errh);
+      case H_RESET:
+	ElementProfiler::reset();
+	return 0;
+    }
+    return -1;
+}
+
+void
+ElementProfiler::add_handlers()
+{
+    Router::add_read_handler(0, "profile", profile_read_handler, (void *) H_PROFILE);
+    Router::add_read_handler(0, "profile_folded", profile_read_handler, (void *) H_FOLDED);
+    Router::add_read_handler(0, "profile_active", profile_read_handler, (void *) H_ACTIVE);
+    Router::add_write_handler(0, "profile_active", profile_write_handler, (void *) H_ACTIVE);
+    Router::add_read_handler(0, "profile_event", profile_read_handler, (void *) H_EVENT);
+    Router::add_write_handler(0, "profile_event", profile_write_handler, (void *) H_EVENT);
+    Router::add_write_handler(0, "profile_reset", profile_write_handler, (void *) H_RESET);
+}
+
+CLICK_ENDDECLS
+#endif
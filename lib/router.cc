@@ -71,6 +71,7 @@ Router::Router(const String &configuration, Master *master)
     : _master(0), _state(ROUTER_NEW),
       _have_connections(false), _conn_sorted(true), _have_configuration(true),
       _running(RUNNING_INACTIVE), _last_landmarkid(0),
+      _element_name_map(-1), _element_name_map_size(0),
       _handler_bufs(0), _nhandlers_bufs(0), _free_handler(-1),
       _root_element(0),
       _configuration(configuration),
@@ -102,6 +103,11 @@ Router::~Router()
     // Delete the ArenaFactory, which detaches the Arenas
     delete _arena_factory;
 
+#if HAVE_ELEMENT_PROFILE
+    // the profile names this router's elements
+    ElementProfiler::reset();
+#endif
+
     // Clean up elements in reverse configuration order
     if (_state == ROUTER_LIVE) {
 	// Unschedule tasks and timers
@@ -161,15 +167,6 @@ Router::unuse()
 
 // ACCESS
 
-static int
-element_name_sorter_compar(const void *ap, const void *bp, void *user_data)
-{
-    int a = *reinterpret_cast<const int *>(ap);
-    int b = *reinterpret_cast<const int *>(bp);
-    const Vector<String> &element_names = *reinterpret_cast<Vector<String> *>(user_data);
-    return String::compare(element_names[a], element_names[b]);
-}
-
 /** @brief  Finds an element named @a name.
  *  @param  name     element name
  *  @param  context  compound element context
@@ -189,28 +186,14 @@ element_name_sorter_compar(const void *ap, const void *bp, void *user_data)
 Element *
 Router::find(const String &name, String context, ErrorHandler *errh) const
 {
-    if (_element_name_sorter.size() != _element_names.size()) {
-	while (_element_name_sorter.size() != _element_names.size())
-	    _element_name_sorter.push_back(_element_name_sorter.size());
-	click_qsort(_element_name_sorter.begin(), _element_name_sorter.size(),
-		    sizeof(_element_name_sorter[0]),
-		    element_name_sorter_compar, (void *) &_element_names);
-    }
+    // elements are only ever added, so enter the new ones
+    for (; _element_name_map_size < _element_names.size(); ++_element_name_map_size)
+	_element_name_map.find_insert(_element_names[_element_name_map_size], _element_name_map_size);
 
     while (1) {
-	String n = context + name;
-	int *l = _element_name_sorter.begin();
-	int *r = _element_name_sorter.end();
-	while (l < r) {
-	    int *m = l + (r - l) / 2;
-	    int cmp = String::compare(n, _element_names[*m]);
-	    if (cmp < 0)
-		r = m;
-	    else if (cmp > 0)
-		l = m + 1;
-	    else
-		return _elements[*m];
-	}
+	int eindex = _element_name_map.get(context + name);
+	if (eindex >= 0)
+	    return _elements[eindex];
 
 	if (!context)
 	    break;
@@ -412,21 +395,54 @@ Router::add_connection(int from_idx, int from_port, int to_idx, int to_port)
     if (_conn_sorted && _conn.size() && c < _conn.back())
 	_conn_sorted = false;
 
-    // check for duplicate connections, which are not errors
-    // (but which, if included in _conn, would cause errors later)
-    if (!_conn_sorted) {
-	for (int i = 0; i < _conn.size(); i++)
-	    if (_conn[i] == c)
-		return 0;
-    } else {
-	if (_conn.size() && _conn.back() == c)
-	    return 0;
-    }
+    // check for duplicate connections, which are not errors (but which, if
+    // left in _conn, would cause errors later); sort_connections() removes
+    // the ones added out of order
+    if (_conn_sorted && _conn.size() && _conn.back() == c)
+	return 0;
 
     _conn.push_back(c);
     return 0;
 }
 
+/** @brief  Create an uninitialized copy of this router.
+ *  @param  elements  new elements, one per element of this router
+ *  @param  master    Master object
+ *
+ *  The copy has this router's configuration string, element names,
+ *  configurations, landmarks, connections and requirements, which share
+ *  their storage with this router's, and @a elements in place of its
+ *  elements: @a elements[i] should have the class of element(i).  Drivers
+ *  use this to run many routers from one parsed configuration.  Returns
+ *  null if this router is no longer new, if the number of elements differs,
+ *  or if one of @a elements already belongs to a router. */
+Router *
+Router::clone(const Vector<Element *> &elements, Master *master) const
+{
+    if (_state != ROUTER_NEW || elements.size() != _elements.size())
+	return 0;
+    for (int i = 0; i < elements.size(); i++)
+	if (!elements[i] || elements[i]->router())
+	    return 0;
+
+    Router *r = new Router(_configuration, master);
+    r->_element_names = _element_names;
+    r->_element_configurations = _element_configurations;
+    r->_element_landmarkids = _element_landmarkids;
+    r->_element_landmarks = _element_landmarks;
+    r->_last_landmarkid = _last_landmarkid;
+    r->_flow_code_override_eindex = _flow_code_override_eindex;
+    r->_flow_code_override = _flow_code_override;
+    r->_conn = _conn;
+    r->_conn_sorted = _conn_sorted;
+    r->_requirements = _requirements;
+    for (int i = 0; i < elements.size(); i++) {
+	r->_elements.push_back(elements[i]);
+	elements[i]->attach_router(r, i);
+    }
+    return r;
+}
+
 void
 Router::add_requirement(const String &r)
 {
@@ -470,6 +486,7 @@ Router::check_hookup_elements(ErrorHandler *errh)
     if (!errh)
 	errh = ErrorHandler::default_handler();
     int before = errh->nerrors();
+    sort_connections();
 
     // Check each hookup to ensure it connects valid elements
     for (Connection *cp = _conn.begin(); cp != _conn.end(); ) {
@@ -591,6 +608,15 @@ Router::sort_connections() const
 {
     if (!_conn_sorted) {
 	click_qsort(_conn.begin(), _conn.size());
+	// remove duplicates, now adjacent
+	if (_conn.size()) {
+	    Connection *o = _conn.begin() + 1;
+	    for (Connection *cp = o; cp != _conn.end(); ++cp)
+		if (!(*cp == o[-1]))
+		    *o++ = *cp;
+	    while (_conn.end() != o)
+		_conn.pop_back();
+	}
 	_conn_output_sorter.clear();
 	_conn_sorted = true;
     }
@@ -686,44 +712,71 @@ Router::check_push_and_pull(ErrorHandler *errh)
     int before = errh->nerrors();
     Connection *first_agnostic = conn.begin() + _conn.size();
 
-    // spread personalities
-    while (true) {
-
-	bool changed = false;
-	for (Connection *cp = conn.begin(); cp != conn.end(); ++cp) {
-	    if ((*cp)[1].idx < 0)
-		continue;
+    // index the connections by port, so that a personality change revisits
+    // only the connections of the port that changed
+    int nconn = conn.size();
+    Vector<int> first[2], conn_at[2];
+    for (int isoutput = 0; isoutput < 2; ++isoutput) {
+	first[isoutput].assign(ngports(isoutput) + 1, 0);
+	for (Connection *cp = conn.begin(); cp != conn.end(); ++cp)
+	    ++first[isoutput][gport(isoutput, (*cp)[isoutput]) + 1];
+	for (int g = 0; g < ngports(isoutput); ++g)
+	    first[isoutput][g + 1] += first[isoutput][g];
+	Vector<int> next(first[isoutput]);
+	conn_at[isoutput].assign(nconn, 0);
+	for (int ci = 0; ci < nconn; ++ci)
+	    conn_at[isoutput][next[gport(isoutput, conn[ci][isoutput])]++] = ci;
+    }
 
-	    int gf = gport(true, (*cp)[1]);
-	    int gt = gport(false, (*cp)[0]);
-	    int pf = output_pers[gf];
-	    int pt = input_pers[gt];
+    // spread personalities, starting from every connection in order
+    Vector<int> work;
+    Vector<char> queued(nconn, 1);
+    for (int ci = nconn - 1; ci >= 0; --ci)
+	work.push_back(ci);
+    while (work.size()) {
+	int ci = work.back();
+	work.pop_back();
+	queued[ci] = 0;
+	Connection *cp = &conn[ci];
+	if ((*cp)[1].idx < 0)
+	    continue;
+
+	int gf = gport(true, (*cp)[1]);
+	int gt = gport(false, (*cp)[0]);
+	int pf = output_pers[gf];
+	int pt = input_pers[gt];
+	int changed = -1, g = 0;
+
+	switch (pt) {
+
+	  case Element::VAGNOSTIC:
+	    if (pf != Element::VAGNOSTIC) {
+		input_pers[gt] = pf;
+		changed = 0, g = gt;
+	    }
+	    break;
 
-	    switch (pt) {
+	  case Element::VPUSH:
+	  case Element::VPULL:
+	    if (pf == Element::VAGNOSTIC) {
+		output_pers[gf] = pt;
+		changed = 1, g = gf;
+	    } else if (pf != pt) {
+		processing_error(*cp, cp >= first_agnostic, pf, errh);
+		(*cp)[1].idx = -1;
+	    }
+	    break;
 
-	      case Element::VAGNOSTIC:
-		if (pf != Element::VAGNOSTIC) {
-		    input_pers[gt] = pf;
-		    changed = true;
-		}
-		break;
+	}
 
-	      case Element::VPUSH:
-	      case Element::VPULL:
-		if (pf == Element::VAGNOSTIC) {
-		    output_pers[gf] = pt;
-		    changed = true;
-		} else if (pf != pt) {
-		    processing_error(*cp, cp >= first_agnostic, pf, errh);
-		    (*cp)[1].idx = -1;
+	if (changed >= 0)
+	    for (int i = first[changed][g]; i < first[changed][g + 1]; ++i) {
+		int cj = conn_at[changed][i];
+		if (!queued[cj]) {
+		    queued[cj] = 1;
+		    work.push_back(cj);
 		}
-		break;
-
 	    }
-	}
-
-	if (!changed)
-	    break;
     }
 
     if (errh->nerrors() != before)
@@ -2101,7 +2154,7 @@ Router::configuration_string() const
 
 enum { GH_VERSION, GH_CONFIG, GH_FLATCONFIG, GH_LIST, GH_REQUIREMENTS,
        GH_DRIVER, GH_ACTIVE_PORTS, GH_ACTIVE_PORT_STATS, GH_STRING_PROFILE,
-       GH_STRING_PROFILE_LONG };
+       GH_STRING_PROFILE_LONG, GH_PACKET_POOL };
 
 String
 Router::router_read_handler(Element *e, void *thunk)
@@ -2188,6 +2241,12 @@ Router::router_read_handler(Element *e, void *thunk)
 	break;
 #endif
 
+#if HAVE_CLICK_PACKET_POOL
+    case GH_PACKET_POOL:
+	Packet::pool_report(sa);
+	break;
+#endif
+
     }
     return sa.take_string();
 }
@@ -2226,6 +2285,12 @@ Router::static_initialize()
 # if HAVE_STRING_PROFILING > 1
 	add_read_handler(0, "string_profile_long", router_read_handler, (void *) GH_STRING_PROFILE_LONG);
 # endif
+#endif
+#if HAVE_CLICK_PACKET_POOL
+	add_read_handler(0, "packet_pool", router_read_handler, (void *) GH_PACKET_POOL);
+#endif
+#if HAVE_ELEMENT_PROFILE
+	ElementProfiler::add_handlers();
 #endif
     }
 }
@@ -24,6 +24,7 @@
 #include <click/router.hh>
 #include <click/routerthread.hh>
 #include <click/master.hh>
+#include <click/integers.hh>
 #if CLICK_LINUXMODULE
 # include <click/cxxprotect.h>
 CLICK_CXX_PROTECT
@@ -71,9 +72,9 @@ static unsigned long greedy_schedule_jiffies;
 
 RouterThread::RouterThread(Master *m, int id)
 #if HAVE_TASK_HEAP
-    : _task_heap_hole(0), _master(m), _id(id)
+    : _task_heap_hole(0), _master(m), _id(id), _timers(this)
 #else
-    : Task(Task::error_hook, 0), _master(m), _id(id)
+    : Task(Task::error_hook, 0), _master(m), _id(id), _timers(this)
 #endif
 {
 #if HAVE_TASK_HEAP
@@ -86,6 +87,9 @@ RouterThread::RouterThread(Master *m, int id)
     _linux_task = 0;
 #elif HAVE_MULTITHREAD
     _running_processor = click_invalid_processor();
+#endif
+#if HAVE_MULTITHREAD
+    _tasks_given = 0;
 #endif
     _task_blocker = 0;
     _task_blocker_waiting = 0;
@@ -119,9 +123,9 @@ RouterThread::RouterThread(Master *m, int id)
     greedy_schedule_jiffies = jiffies;
 #endif
 
+    _driver_epoch = 0;
 #if CLICK_DEBUG_SCHEDULING
     _thread_state = S_BLOCKED;
-    _driver_epoch = 0;
     _driver_task_epoch = 0;
     _task_epoch_first = 0;
 #endif
@@ -339,6 +343,9 @@ RouterThread::run_tasks(int ntasks)
 	_task_epoch_first = _driver_task_epoch;
 #endif
 
+    // one clock reading for the whole batch, see Timestamp::recent()
+    Timestamp::refresh_recent();
+
     // never run more than 32768 tasks
     if (ntasks > 32768)
 	ntasks = 32768;
@@ -381,6 +388,8 @@ RouterThread::run_tasks(int ntasks)
 	_pass = t->_pass;
 #endif
 
+	if (unlikely(t->_deadline))
+	    t->deadline_run();
 	t->fire();
 
 #if HAVE_TASK_HEAP
@@ -407,6 +416,52 @@ RouterThread::run_tasks(int ntasks)
     }
 }
 
+#if HAVE_MULTITHREAD
+void
+RouterThread::give_task(uint32_t requests)
+{
+    // Hand the last runnable task to the first thread asking for work.  Keep
+    // the next task to run, and leave alone tasks with a thread preference
+    // or already on their way to another thread.
+    Task *end = task_end(), *donor = 0;
+    for (Task *t = task_next(task_begin()); t != end; t = task_next(t))
+	if (!t->_home_thread_pinned && t->_home_thread_id == _id
+	    && !t->_pending_nextptr && !t->_should_be_strong_unscheduled)
+	    donor = t;
+    if (!donor)
+	return;
+
+    // claim the request: another busy thread may have answered it first
+    int thief = ffs_lsb(requests) - 1;
+    uint32_t bit = 1U << thief, old;
+    do {
+	old = _master->_steal_requests;
+	if (!(old & bit))
+	    return;
+    } while (!_master->_steal_requests.compare_and_swap(old, old & ~bit));
+
+    donor->move_thread(thief);
+    _tasks_given++;
+}
+
+inline void
+RouterThread::share_tasks()
+{
+    // An idle thread posts a request; it cannot take tasks itself, since a
+    // running thread holds its task list until run_os().  A busy thread
+    // answers requests between rounds of tasks.
+    uint32_t bit = 1U << _id;
+    uint32_t requests = _master->_steal_requests;
+    if (active()) {
+	if (requests & bit)
+	    _master->_steal_requests &= ~bit;
+	if ((requests & ~bit) && task_begin() != task_end())
+	    give_task(requests & ~bit);
+    } else if (!(requests & bit))
+	_master->_steal_requests |= bit;
+}
+#endif
+
 inline void
 RouterThread::run_os()
 {
@@ -417,7 +472,7 @@ RouterThread::run_os()
     driver_unlock_tasks();
 
 #if CLICK_USERLEVEL
-    _master->run_selects(active());
+    _master->run_selects(this, active());
 #elif CLICK_LINUXMODULE		/* Linux kernel module */
     if (_greedy) {
 	if (time_after(jiffies, greedy_schedule_jiffies + 5 * CLICK_HZ)) {
@@ -429,11 +484,7 @@ RouterThread::run_os()
 	SET_STATE(S_PAUSED);
 	set_current_state(TASK_RUNNING);
 	schedule();
-    } else if (_id != 0) {
-      block:
-	SET_STATE(S_BLOCKED);
-	schedule();
-    } else if (Timestamp wait = _master->next_timer_expiry_adjusted()) {
+    } else if (Timestamp wait = _timers.next_timer_expiry_adjusted()) {
 	wait -= Timestamp::now();
 	if (!(wait > Timestamp(0, Timestamp::subsec_per_sec / CLICK_HZ)))
 	    goto short_pause;
@@ -442,8 +493,10 @@ RouterThread::run_os()
 	    (void) schedule_timeout(LONG_MAX - CLICK_HZ - 1);
 	else
 	    (void) schedule_timeout(wait.jiffies() - 1);
-    } else
-	goto block;
+    } else {
+	SET_STATE(S_BLOCKED);
+	schedule();
+    }
     SET_STATE(S_RUNNING);
 #elif defined(CLICK_BSDMODULE)
     if (_greedy)
@@ -493,9 +546,8 @@ RouterThread::driver()
   driver_loop:
 #endif
 
-#if CLICK_DEBUG_SCHEDULING
+    // driver_epoch() also marks quiescent points for deferred frees
     _driver_epoch++;
-#endif
 
     if (*stopper == 0) {
 	// run occasional tasks: timers, select, etc.
@@ -511,23 +563,21 @@ RouterThread::driver()
 #endif
 
 #if BSD_NETISRSCHED
-	bool run_timers = (iter % _master->timer_stride()) == 0
+	bool run_timers = (iter % _timers.timer_stride()) == 0
 	    || _oticks != ticks;
 #else
-	bool run_timers = (iter % _master->timer_stride()) == 0;
+	bool run_timers = (iter % _timers.timer_stride()) == 0;
 #endif
 	if (run_timers) {
 #if BSD_NETISRSCHED
 	    _oticks = ticks;
 #endif
-	    _master->run_timers();
+	    _timers.run_timers(_master);
 #if CLICK_NS
 	    // If there's another timer, tell the simulator to make us
 	    // run when it's due to go off.
-	    if (Timestamp next_expiry = _master->next_timer_expiry()) {
-		struct timeval nexttime = next_expiry.timeval();
-		simclick_sim_command(_master->simnode(), SIMCLICK_SCHEDULE, &nexttime);
-	    }
+	    if (Timestamp next_expiry = _timers.next_timer_expiry())
+		_master->ns_schedule(next_expiry);
 #endif
 	}
     }
@@ -545,6 +595,10 @@ RouterThread::driver()
 # if CLICK_BSDMODULE && !BSD_NETISRSCHED
     splx(s);
 # endif
+# if HAVE_MULTITHREAD
+    if (_master->_task_stealing && _id < 32)
+	share_tasks();
+# endif
 #else /* HAVE_ADAPTIVE_SCHEDULER */
     t_before.set_now();
     int client;
@@ -24,6 +24,8 @@
 #include <click/router.hh>
 #include <click/routerthread.hh>
 #include <click/master.hh>
+#include <click/timer.hh>
+#include <click/straccum.hh>
 CLICK_DECLS
 
 /** @file task.hh
@@ -92,6 +94,18 @@ CLICK_DECLS
 // - Changes to _home_thread_id are protected by
 //   router()->master()->task_lock.
 
+struct Task::DeadlineInfo {
+    Timestamp deadline;
+    Timestamp woken;		// when last scheduled, 0 once it has run
+    uint32_t runs;
+    uint32_t misses;
+    Timestamp total_latency;
+    Timestamp max_latency;
+    DeadlineInfo()
+	: runs(0), misses(0) {
+    }
+};
+
 bool
 Task::error_hook(Task *, void *)
 {
@@ -108,6 +122,8 @@ Task::~Task()
     if ((scheduled() || _pending_nextptr) && _thread != this)
 	cleanup();
 #endif
+    delete _wakeup_timer;
+    delete _deadline;
 }
 
 Master *
@@ -124,6 +140,10 @@ Task::initialize(Element *owner, bool schedule)
 
     Router *router = owner->router();
     _home_thread_id = router->initial_home_thread_id(owner, this, schedule);
+#if HAVE_MULTITHREAD
+    // work stealing never moves a task away from its preferred thread
+    _home_thread_pinned = (_home_thread_id != ThreadSched::THREAD_UNKNOWN);
+#endif
     if (_home_thread_id == ThreadSched::THREAD_UNKNOWN)
 	_home_thread_id = 0;
     // Master::thread() returns the quiescent thread if its argument is out of
@@ -160,6 +180,8 @@ Task::cleanup()
 #endif
     if (initialized()) {
 	strong_unschedule();
+	if (_wakeup_timer)
+	    _wakeup_timer->unschedule();
 
 	if (_pending_nextptr) {
 	    // Perhaps the task is enqueued on the current pending collection.
@@ -292,8 +314,13 @@ Task::fast_reschedule()
 #endif
 
     if (!scheduled()) {
-	// increase pass
-	_pass += _stride;
+	// increase pass; the deadline class goes ahead of every task that
+	// has already run at the current pass
+	if (unlikely(_deadline)) {
+	    _pass = _thread->_pass;
+	    deadline_woken();
+	} else
+	    _pass += _stride;
 
 	if (_thread->_task_heap_hole) {
 	    _schedpos = 0;
@@ -311,6 +338,8 @@ void
 Task::true_reschedule()
 {
     bool done = false;
+    if (unlikely(_deadline))
+	deadline_woken();
     _should_be_scheduled = true;
     if (unlikely(_thread == 0))
 	done = true;
@@ -425,6 +454,124 @@ Task::strong_reschedule()
 	add_pending();
 }
 
+/** @brief Reschedule the Task once the time is @a when.
+ * @param when time to run the task
+ *
+ * Arranges for the task to be rescheduled, as by reschedule(), at @a when.
+ * A task's callback calls reschedule_at() in place of fast_reschedule() when
+ * it has nothing to do before a known time, such as the next departure of a
+ * rate limiter: the task leaves the run queue meanwhile, so a thread with
+ * nothing else to run sleeps until the next timer instead of running the
+ * task over and over to check the clock.
+ *
+ * The wakeup uses a Timer that the task makes on first use and owns.  A
+ * later call replaces the wakeup time.  The wakeup does not cancel an
+ * earlier reschedule(), nor does reschedule() cancel the wakeup, so a task
+ * woken both by a notifier and by the time may run once more than needed.
+ * Like timers, the wakeup may come somewhat after @a when; callers that need
+ * precision should ask for @a when minus Timer::adjustment() and check the
+ * time again. @a when may be in the past, in which case the task runs after
+ * the next timer check.
+ *
+ * Must be called from the thread that runs the task, once the task is
+ * initialized.
+ *
+ * @sa reschedule, fast_reschedule
+ */
+void
+Task::reschedule_at(const Timestamp &when)
+{
+    assert(initialized());
+    if (!_wakeup_timer) {
+	_wakeup_timer = new Timer(this);
+	_wakeup_timer->initialize(_owner);
+    }
+    _wakeup_timer->schedule_at(when);
+}
+
+/** @brief Put the Task in the deadline class, or take it out.
+ * @param deadline scheduling latency the task should meet; 0 takes the task
+ * out of the deadline class
+ *
+ * A task in the deadline class is scheduled ahead of the tasks that share
+ * the stride scheduler by their tickets: whenever it is rescheduled, it is
+ * placed before every task that has not yet run at the thread's current
+ * pass, so it runs after at most the tasks already due, regardless of its
+ * tickets.  The class is meant for short, latency-critical work, such as
+ * routing protocol timers and message processing, that must not wait
+ * behind busy data path tasks; a deadline task that never stops rescheduling
+ * itself starves the others.
+ *
+ * The task counts how long it waits between being rescheduled and running,
+ * and how often that exceeds @a deadline; see unparse_deadline_stats().
+ * The counts are not locked, and a reschedule() from another thread racing
+ * with a run may be missed.  ScheduleInfo sets deadlines from the
+ * configuration.  Should be called while the task is not scheduled.
+ */
+void
+Task::set_deadline(const Timestamp &deadline)
+{
+    if (deadline) {
+	if (!_deadline)
+	    _deadline = new DeadlineInfo;
+	if (_deadline)
+	    _deadline->deadline = deadline;
+    } else {
+	delete _deadline;
+	_deadline = 0;
+    }
+}
+
+/** @brief Return the Task's deadline, or 0 if it is not in the deadline
+ * class. */
+Timestamp
+Task::deadline() const
+{
+    return _deadline ? _deadline->deadline : Timestamp();
+}
+
+/** @brief Return how the Task met its deadline.
+ *
+ * One line: the deadline, the number of runs, the number that waited longer
+ * than the deadline, and the mean and maximum wait in microseconds, as
+ * "deadline 5ms runs 100 late 1 mean_usec 40 max_usec 6200".  Empty if the
+ * task is not in the deadline class. */
+String
+Task::unparse_deadline_stats() const
+{
+    if (!_deadline)
+	return String();
+    const DeadlineInfo &d = *_deadline;
+    StringAccum sa;
+    sa << "deadline " << d.deadline.unparse_interval() << " runs " << d.runs << " late " << d.misses
+       << " mean_usec " << (d.runs ? d.total_latency.usecval() / d.runs : 0)
+       << " max_usec " << d.max_latency.usecval() << '\n';
+    return sa.take_string();
+}
+
+void
+Task::deadline_woken()
+{
+    if (!_deadline->woken)
+	_deadline->woken = Timestamp::now();
+}
+
+void
+Task::deadline_run()
+{
+    DeadlineInfo &d = *_deadline;
+    if (d.woken) {
+	Timestamp latency = Timestamp::now() - d.woken;
+	d.woken = Timestamp();
+	d.runs++;
+	d.total_latency += latency;
+	if (latency > d.max_latency)
+	    d.max_latency = latency;
+	if (latency > d.deadline)
+	    d.misses++;
+    }
+}
+
 /** @brief Move the Task to a new home thread.
  *
  * The home thread ID is set to @a thread_id.  The task, if it is currently
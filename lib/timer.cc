@@ -23,6 +23,7 @@
 #include <click/router.hh>
 #include <click/master.hh>
 #include <click/routerthread.hh>
+#include <click/timerset.hh>
 #include <click/task.hh>
 CLICK_DECLS
 
@@ -162,7 +163,10 @@ CLICK_DECLS
 
  The Click core stores timers in a heap, so most timer operations (including
  scheduling and unscheduling) take @e O(log @e n) time and Click can handle
- very large numbers of timers.
+ very large numbers of timers.  Configured with --enable-timer-wheel, Click
+ keeps only the timers due within the current millisecond in the heap, and
+ the others in a hierarchical timer wheel, where scheduling and
+ unscheduling take @e O(1) time.
 
  Timers generally run in increasing order by expiration time.  That is, if
  timer @a a's expiry() is less than timer @a b's expiry(), then @a a will
@@ -192,29 +196,44 @@ Timer::task_hook(Timer *, void *thunk)
 
 
 Timer::Timer()
-    : _schedpos1(0), _thunk(0), _owner(0)
+    : _schedpos1(0), _thunk(0), _owner(0), _thread(0), _inbox_pprev(0)
 {
     _hook.callback = empty_hook;
 }
 
 Timer::Timer(TimerCallback f, void *user_data)
-    : _schedpos1(0), _thunk(user_data), _owner(0)
+    : _schedpos1(0), _thunk(user_data), _owner(0), _thread(0), _inbox_pprev(0)
 {
     _hook.callback = f;
 }
 
 Timer::Timer(Element* element)
-    : _schedpos1(0), _thunk(element), _owner(0)
+    : _schedpos1(0), _thunk(element), _owner(0), _thread(0), _inbox_pprev(0)
 {
     _hook.callback = element_hook;
 }
 
 Timer::Timer(Task* task)
-    : _schedpos1(0), _thunk(task), _owner(0)
+    : _schedpos1(0), _thunk(task), _owner(0), _thread(0), _inbox_pprev(0)
 {
     _hook.callback = task_hook;
 }
 
+void
+Timer::initialize(Element *owner)
+{
+    assert(!initialized() || _owner->router() == owner->router());
+    if (!_thread) {
+	Router *router = owner->router();
+	int tid = router->initial_home_thread_id(owner, 0, false);
+	// the quiescent thread never runs timers
+	if (tid < 0 || tid >= router->master()->nthreads())
+	    tid = 0;
+	_thread = router->master()->thread(tid);
+    }
+    _owner = owner;
+}
+
 void
 Timer::initialize(Router *router)
 {
@@ -224,37 +243,20 @@ Timer::initialize(Router *router)
 void
 Timer::schedule_at(const Timestamp& when)
 {
-    // acquire lock, unschedule
     assert(_owner && initialized());
-    Master* master = _owner->master();
-    master->lock_timers();
-
-    // set expiration timer
-    _expiry = when;
-
-    // manipulate list; this is essentially a "decrease-key" operation
-    // any reschedule removes a timer from the runchunk (XXX -- even backwards
-    // reschedulings)
-    int old_schedpos1 = _schedpos1;
-    if (_schedpos1 <= 0) {
-	if (_schedpos1 < 0)
-	    master->_timer_runchunk[-_schedpos1 - 1] = 0;
-	_schedpos1 = master->_timer_heap.size() + 1;
-	master->_timer_heap.push_back(this);
+    TimerSet &ts = _thread->timer_set();
+
+    // the owning thread waits for its own lock; another thread leaves its
+    // request in the inbox rather than wait while the owner runs timers
+    if (_thread->current_thread_is_running())
+	ts.lock_timers();
+    else if (!ts.attempt_lock_timers()) {
+	ts.post(this, &when);
+	return;
     }
-    master->check_timer_expiry(this);
-    change_heap(master->_timer_heap.begin(), master->_timer_heap.end(),
-		master->_timer_heap.begin() + _schedpos1 - 1,
-		Master::timer_less(), Master::timer_place(master->_timer_heap.begin()));
-    if (old_schedpos1 == 1 || _schedpos1 == 1)
-	master->set_timer_expiry();
-
-    // if we changed the timeout, wake up the first thread
-    if (_schedpos1 == 1)
-	master->_threads[2]->wake();
-
-    // done
-    master->unlock_timers();
+
+    ts.schedule(this, when);
+    ts.unlock_timers();
 }
 
 void
@@ -266,24 +268,32 @@ Timer::schedule_after(const Timestamp &delta)
 void
 Timer::unschedule()
 {
-    if (!scheduled())
+    if (_schedpos1 == 0 && !_inbox_pprev)
 	return;
-    Master* master = _owner->master();
-    master->lock_timers();
-    int old_schedpos1 = _schedpos1;
-    if (_schedpos1 > 0) {
-	remove_heap(master->_timer_heap.begin(), master->_timer_heap.end(),
-		    master->_timer_heap.begin() + _schedpos1 - 1,
-		    Master::timer_less(), Master::timer_place(master->_timer_heap.begin()));
-	master->_timer_heap.pop_back();
-	if (old_schedpos1 == 1)
-	    master->set_timer_expiry();
-    } else if (_schedpos1 < 0)
-	master->_timer_runchunk[-_schedpos1 - 1] = 0;
-    _schedpos1 = 0;
-    master->unlock_timers();
+    TimerSet &ts = _thread->timer_set();
+    if (_thread->current_thread_is_running())
+	ts.lock_timers();
+    else if (!ts.attempt_lock_timers()) {
+	ts.post(this, 0);
+	return;
+    }
+    ts.unschedule(this);
+    ts.unlock_timers();
+}
+
+void
+Timer::clear()
+{
+    if (_thread) {
+	TimerSet &ts = _thread->timer_set();
+	ts.lock_timers();
+	ts.unschedule(this);
+	_expiry = Timestamp();
+	ts.unlock_timers();
+    } else
+	_expiry = Timestamp();
 }
 
-// list-related functions in master.cc
+// list-related functions in timerset.cc
 
 CLICK_ENDDECLS
@@ -0,0 +1,495 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/timerset.hh" -*-
+/*
+ * timerset.{cc,hh} -- the timers of a RouterThread
+ * Eddie Kohler
+ *
+ * Copyright (c) 2003-7 The Regents of the University of California
+ * Copyright (c) 2008 Meraki, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/timerset.hh>
+#include <click/master.hh>
+#include <click/routerthread.hh>
+#include <click/element.hh>
+#include <click/router.hh>
+CLICK_DECLS
+
+TimerSet::TimerSet(RouterThread *thread)
+    : _thread(thread), _timer_inbox(0)
+{
+#if CLICK_NS
+    _max_timer_stride = 1;
+#else
+    _max_timer_stride = 32;
+#endif
+    _timer_stride = _max_timer_stride;
+    _timer_count = 0;
+#if CLICK_LINUXMODULE
+    _timer_check_reports = 5;
+#else
+    _timer_check_reports = 0;
+#endif
+#if HAVE_TIMER_WHEEL
+    memset(_timer_wheel, 0, sizeof(_timer_wheel));
+    memset(_timer_wheel_count, 0, sizeof(_timer_wheel_count));
+    _timer_wheel_tick = 0;
+#endif
+#if CLICK_LINUXMODULE
+    spin_lock_init(&_timer_lock);
+    _timer_task = 0;
+#endif
+    _timer_check = Timestamp::now();
+    _timer_check_reports = 0;
+}
+
+void
+TimerSet::set_max_timer_stride(unsigned timer_stride)
+{
+    _max_timer_stride = timer_stride;
+    if (_timer_stride > _max_timer_stride)
+	_timer_stride = _max_timer_stride;
+}
+
+
+void
+TimerSet::check_timer_expiry(Timer *t)
+{
+    // do not schedule timers for too far in the past
+    if (t->_expiry.sec() + Timer::behind_sec < _timer_check.sec()) {
+	if (_timer_check_reports > 0) {
+	    --_timer_check_reports;
+	    click_chatter("timer %p outdated expiry %{timestamp} updated to %{timestamp}", t, &t->_expiry, &_timer_check, &t->_expiry);
+	}
+	t->_expiry = _timer_check;
+    }
+}
+
+void
+TimerSet::remove_timer(Timer *t)
+{
+    // called with the timer lock held
+    int old_schedpos1 = t->_schedpos1;
+#if HAVE_TIMER_WHEEL
+    if (old_schedpos1 == Timer::schedpos_wheel) {
+	wheel_remove(t);
+	return;
+    }
+#endif
+    if (old_schedpos1 > 0) {
+	remove_heap(_timer_heap.begin(), _timer_heap.end(),
+		    _timer_heap.begin() + old_schedpos1 - 1,
+		    timer_less(), timer_place(_timer_heap.begin()));
+	_timer_heap.pop_back();
+	if (old_schedpos1 == 1)
+	    set_timer_expiry();
+    } else if (old_schedpos1 < 0)
+	_timer_runchunk[-old_schedpos1 - 1] = 0;
+    t->_schedpos1 = 0;
+}
+
+void
+TimerSet::schedule(Timer *t, const Timestamp &when)
+{
+    // called with the timer lock held; a direct request supersedes any
+    // earlier one still in the inbox
+    if (t->_inbox_pprev)
+	cancel_post(t);
+
+    // set expiration timer
+    t->_expiry = when;
+
+#if HAVE_TIMER_WHEEL
+    // a timer not due by the current tick goes to the wheel, in O(1)
+    check_timer_expiry(t);
+    if (wheel_accepts(t)) {
+	if (t->_schedpos1 != 0)
+	    remove_timer(t);
+	wheel_insert(t);
+	return;
+    } else if (t->_schedpos1 == Timer::schedpos_wheel)
+	wheel_remove(t);
+#endif
+
+    // manipulate list; this is essentially a "decrease-key" operation
+    // any reschedule removes a timer from the runchunk (XXX -- even backwards
+    // reschedulings)
+    int old_schedpos1 = t->_schedpos1;
+    if (t->_schedpos1 <= 0) {
+	if (t->_schedpos1 < 0)
+	    _timer_runchunk[-t->_schedpos1 - 1] = 0;
+	t->_schedpos1 = _timer_heap.size() + 1;
+	_timer_heap.push_back(t);
+    }
+    check_timer_expiry(t);
+    change_heap(_timer_heap.begin(), _timer_heap.end(),
+		_timer_heap.begin() + t->_schedpos1 - 1,
+		timer_less(), timer_place(_timer_heap.begin()));
+    if (old_schedpos1 == 1 || t->_schedpos1 == 1)
+	set_timer_expiry();
+
+    // if we changed the timeout, wake up the thread
+    if (t->_schedpos1 == 1)
+	_thread->wake();
+}
+
+void
+TimerSet::unschedule(Timer *t)
+{
+    // called with the timer lock held
+    if (t->_inbox_pprev)
+	cancel_post(t);
+    if (t->_schedpos1 != 0)
+	remove_timer(t);
+}
+
+void
+TimerSet::post(Timer *t, const Timestamp *when)
+{
+    // another thread holds the timer lock: leave the request, to schedule
+    // at *when or, if when is null, to unschedule, for the owning thread
+    _inbox_lock.acquire();
+    if (!t->_inbox_pprev) {
+	if ((t->_inbox_next = _timer_inbox))
+	    t->_inbox_next->_inbox_pprev = &t->_inbox_next;
+	_timer_inbox = t;
+	t->_inbox_pprev = &_timer_inbox;
+    }
+    t->_inbox_schedule = (when != 0);
+    if (when)
+	t->_inbox_expiry = *when;
+    _inbox_lock.release();
+    _thread->wake();
+}
+
+void
+TimerSet::cancel_post(Timer *t)
+{
+    _inbox_lock.acquire();
+    if (t->_inbox_pprev) {
+	if ((*t->_inbox_pprev = t->_inbox_next))
+	    t->_inbox_next->_inbox_pprev = t->_inbox_pprev;
+	t->_inbox_pprev = 0;
+    }
+    _inbox_lock.release();
+}
+
+void
+TimerSet::run_inbox()
+{
+    // called with the timer lock held
+    _inbox_lock.acquire();
+    while (Timer *t = _timer_inbox) {
+	if ((_timer_inbox = t->_inbox_next))
+	    _timer_inbox->_inbox_pprev = &_timer_inbox;
+	t->_inbox_pprev = 0;
+	if (t->_inbox_schedule) {
+	    Timestamp when = t->_inbox_expiry;
+	    schedule(t, when);
+	} else if (t->_schedpos1 != 0)
+	    remove_timer(t);
+    }
+    _inbox_lock.release();
+}
+
+void
+TimerSet::kill_router(Router *router)
+{
+    lock_timers();
+    assert(!_timer_runchunk.size());
+    Timer* t;
+    for (Timer** tp = _timer_heap.end(); tp > _timer_heap.begin(); )
+	if ((t = *--tp, t->router() == router)) {
+	    remove_heap(_timer_heap.begin(), _timer_heap.end(), tp, timer_less(), timer_place(_timer_heap.begin()));
+	    _timer_heap.pop_back();
+	    t->_owner = 0;
+	    t->_schedpos1 = 0;
+	}
+#if HAVE_TIMER_WHEEL
+    for (int slot = 0; slot < wheel_nslots; slot++)
+	for (Timer *next = _timer_wheel[slot]; (t = next); ) {
+	    next = t->_wheel_next;
+	    if (t->router() == router) {
+		wheel_remove(t);
+		t->_owner = 0;
+	    }
+	}
+#endif
+    _inbox_lock.acquire();
+    for (Timer *next = _timer_inbox; (t = next); ) {
+	next = t->_inbox_next;
+	if (t->router() == router) {
+	    if ((*t->_inbox_pprev = t->_inbox_next))
+		t->_inbox_next->_inbox_pprev = t->_inbox_pprev;
+	    t->_inbox_pprev = 0;
+	    t->_owner = 0;
+	}
+    }
+    _inbox_lock.release();
+    set_timer_expiry();
+    unlock_timers();
+}
+
+#if HAVE_TIMER_WHEEL
+int64_t
+TimerSet::wheel_link(Timer *t)
+{
+    // the timer must not be due by _timer_wheel_tick; returns the tick at
+    // which its slot comes up
+    int64_t tick = wheel_tick(t->_expiry);
+    int64_t delta = tick - _timer_wheel_tick;
+    int level = 0;
+    while (level < wheel_levels - 1
+	   && delta >= ((int64_t) 1 << wheel_shift(level + 1)))
+	level++;
+    int shift = wheel_shift(level);
+    int64_t span = (int64_t) 1 << (shift + (level ? wheel_bits : wheel_bits0));
+    if (delta >= span)		// beyond the wheel: park at its far end
+	tick = _timer_wheel_tick + span - 1;
+
+    int slot;
+    if (level)
+	slot = wheel_slots0 + (level - 1) * wheel_slots
+	    + ((tick >> shift) & (wheel_slots - 1));
+    else
+	slot = tick & (wheel_slots0 - 1);
+    Timer **head = &_timer_wheel[slot];
+    if ((t->_wheel_next = *head))
+	t->_wheel_next->_wheel_pprev = &t->_wheel_next;
+    *head = t;
+    t->_wheel_pprev = head;
+    t->_wheel_slot = slot;
+    t->_schedpos1 = Timer::schedpos_wheel;
+    _timer_wheel_count[level]++;
+    return (tick >> shift) << shift;
+}
+
+void
+TimerSet::wheel_insert(Timer *t)
+{
+    int64_t tick = wheel_link(t);
+    // with an empty heap, the first slot to come up sets the timeout
+    if (!_timer_heap.size()) {
+	Timestamp when = Timestamp::make_msec(tick);
+	if (_timer_expiry.sec() == 0 || when < _timer_expiry) {
+	    _timer_expiry = when;
+	    _thread->wake();
+	}
+    }
+}
+
+void
+TimerSet::wheel_remove(Timer *t)
+{
+    // leaves _timer_expiry alone: at worst, run_timers() runs early
+    if ((*t->_wheel_pprev = t->_wheel_next))
+	t->_wheel_next->_wheel_pprev = t->_wheel_pprev;
+    _timer_wheel_count[wheel_level(t->_wheel_slot)]--;
+    t->_schedpos1 = 0;
+}
+
+inline void
+TimerSet::wheel_unload(int slot)
+{
+    // relink the timers of a slot relative to the current tick, moving
+    // those now due into the heap
+    Timer *t = _timer_wheel[slot], *next;
+    _timer_wheel[slot] = 0;
+    for (int level = wheel_level(slot); t; t = next) {
+	next = t->_wheel_next;
+	_timer_wheel_count[level]--;
+	if (wheel_tick(t->_expiry) > _timer_wheel_tick)
+	    wheel_link(t);
+	else {
+	    t->_schedpos1 = _timer_heap.size() + 1;
+	    _timer_heap.push_back(t);
+	    push_heap(_timer_heap.begin(), _timer_heap.end(), timer_less(), timer_place(_timer_heap.begin()));
+	}
+    }
+}
+
+void
+TimerSet::wheel_advance(int64_t now)
+{
+    while (_timer_wheel_tick < now) {
+	// nothing happens before the next cascade of the lowest occupied
+	// level, so skip to it
+	int level = 0;
+	while (level < wheel_levels && !_timer_wheel_count[level])
+	    level++;
+	if (level == wheel_levels) {
+	    _timer_wheel_tick = now;
+	    break;
+	} else if (level > 0) {
+	    int64_t next = ((_timer_wheel_tick >> wheel_shift(level)) + 1) << wheel_shift(level);
+	    if (next > now) {
+		_timer_wheel_tick = now;
+		break;
+	    }
+	    _timer_wheel_tick = next - 1;
+	}
+
+	int64_t tick = ++_timer_wheel_tick;
+	if (!(tick & (wheel_slots0 - 1)))
+	    for (level = 1; level < wheel_levels; level++) {
+		int index = (tick >> wheel_shift(level)) & (wheel_slots - 1);
+		wheel_unload(wheel_slots0 + (level - 1) * wheel_slots + index);
+		if (index)
+		    break;
+	    }
+	wheel_unload(tick & (wheel_slots0 - 1));
+    }
+}
+
+Timestamp
+TimerSet::wheel_expiry() const
+{
+    // the first tick at which a slot comes up, or 0 if the wheel is empty
+    int64_t first = -1;
+    if (_timer_wheel_count[0])
+	for (int64_t tick = _timer_wheel_tick + 1; tick < _timer_wheel_tick + wheel_slots0; tick++)
+	    if (_timer_wheel[tick & (wheel_slots0 - 1)]) {
+		first = tick;
+		break;
+	    }
+    for (int level = 1; level < wheel_levels; level++)
+	if (_timer_wheel_count[level]) {
+	    int shift = wheel_shift(level);
+	    Timer * const *slots = _timer_wheel + wheel_slots0 + (level - 1) * wheel_slots;
+	    for (int64_t index = (_timer_wheel_tick >> shift) + 1;
+		 index <= (_timer_wheel_tick >> shift) + wheel_slots; index++)
+		if (slots[index & (wheel_slots - 1)]) {
+		    if (first < 0 || (index << shift) < first)
+			first = index << shift;
+		    break;
+		}
+	}
+    return first < 0 ? Timestamp() : Timestamp::make_msec(first);
+}
+#endif
+
+inline void
+TimerSet::run_one_timer(Timer *t)
+{
+#if CLICK_STATS >= 2
+    click_cycles_t start_cycles = click_get_cycles();
+#endif
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::Frame *frame = ElementProfiler::enter(t->_owner, -1, ElementProfiler::TIMER);
+#endif
+
+    t->_hook.callback(t, t->_thunk);
+
+#if HAVE_ELEMENT_PROFILE
+    ElementProfiler::leave(frame, 0);
+#endif
+
+#if CLICK_STATS >= 2
+    t->_owner->_timer_cycles += click_get_cycles() - start_cycles;
+    t->_owner->_timer_calls++;
+#endif
+}
+
+void
+TimerSet::run_timers(Master *master)
+{
+    if (!attempt_lock_timers())
+	return;
+    if (_timer_inbox)
+	run_inbox();
+#if HAVE_TIMER_WHEEL
+    // move the timers whose slots came up into the heap
+    if (master->_master_paused == 0 && wheel_size() > 0 && !master->_stopper) {
+	Timestamp now = Timestamp::now();
+	if (_timer_expiry <= now) {
+	    wheel_advance(wheel_tick(now));
+	    set_timer_expiry();
+	}
+    }
+#endif
+    if (master->_master_paused == 0 && _timer_heap.size() > 0 && !master->_stopper) {
+#if CLICK_LINUXMODULE
+	_timer_task = current;
+#endif
+	Timestamp::refresh_recent();
+	_timer_check = Timestamp::recent();
+	Timer *t = _timer_heap.at_u(0);
+
+	if (t->_expiry <= _timer_check) {
+	    // potentially adjust timer stride
+	    Timestamp adj_expiry = t->_expiry + Timer::adjustment();
+	    if (adj_expiry <= _timer_check) {
+		_timer_count = 0;
+		if (_timer_stride > 1)
+		    _timer_stride = (_timer_stride * 4) / 5;
+	    } else if (++_timer_count >= 12) {
+		_timer_count = 0;
+		if (++_timer_stride >= _max_timer_stride)
+		    _timer_stride = _max_timer_stride;
+	    }
+
+	    // actually run timers
+	    int max_timers = 64;
+	    do {
+		pop_heap(_timer_heap.begin(), _timer_heap.end(), timer_less(), timer_place(_timer_heap.begin()));
+		_timer_heap.pop_back();
+		set_timer_expiry();
+		t->_schedpos1 = 0;
+
+		run_one_timer(t);
+	    } while (_timer_heap.size() > 0 && !master->_stopper
+		     && (t = _timer_heap.at_u(0), t->_expiry <= _timer_check)
+		     && --max_timers >= 0);
+
+	    // If we ran out of timers to run, then perhaps there's an
+	    // infinite timer loop or one timer is very far behind system
+	    // time.  Eventually the system would catch up and run all timers,
+	    // but in the meantime other timers could starve.  We detect this
+	    // case and run ALL expired timers, reducing possible damage.
+	    if (max_timers < 0 && !master->_stopper) {
+		_timer_runchunk.reserve(32);
+		do {
+		    pop_heap(_timer_heap.begin(), _timer_heap.end(), timer_less(), timer_place(_timer_heap.begin()));
+		    _timer_heap.pop_back();
+		    t->_schedpos1 = -_timer_runchunk.size() - 1;
+
+		    _timer_runchunk.push_back(t);
+		} while (_timer_heap.size() > 0
+			 && (t = _timer_heap.at_u(0), t->_expiry <= _timer_check));
+		set_timer_expiry();
+
+		Vector<Timer*>::iterator i = _timer_runchunk.begin();
+		for (; !master->_stopper && i != _timer_runchunk.end(); ++i)
+		    if (*i) {
+			(*i)->_schedpos1 = 0;
+			run_one_timer(*i);
+		    }
+
+		// reschedule unrun timers if stopped early
+		for (; i != _timer_runchunk.end(); ++i)
+		    if (*i) {
+			(*i)->_schedpos1 = 0;
+			schedule(*i, (*i)->_expiry);
+		    }
+		_timer_runchunk.clear();
+	    }
+	}
+
+#if CLICK_LINUXMODULE
+	_timer_task = 0;
+#endif
+    }
+    unlock_timers();
+}
+
+CLICK_ENDDECLS
@@ -55,6 +55,8 @@ CLICK_DECLS
  -1, usec() == +900000.
  */
 
+Timestamp Timestamp::_recent;
+
 #if !CLICK_LINUXMODULE && !CLICK_BSDMODULE
 /** @brief Set this timestamp to a timeval obtained by calling ioctl.
     @param fd file descriptor
@@ -106,33 +108,43 @@ operator<<(StringAccum &sa, const struct timeval &tv)
 StringAccum &
 operator<<(StringAccum &sa, const Timestamp& ts)
 {
-    if (char *x = sa.reserve(33)) {
-	Timestamp::seconds_type sec;
-	uint32_t subsec;
-	if (ts.sec() >= 0)
-	    sec = ts.sec(), subsec = ts.subsec();
-	else {
-	    *x++ = '-';
-	    sa.adjust_length(1);
-	    if (ts.subsec() == 0)
-		sec = -ts.sec(), subsec = 0;
-	    else
-		sec = -ts.sec() - 1, subsec = Timestamp::subsec_per_sec - ts.subsec();
-	}
+    if (char *x = sa.reserve(Timestamp::unparse_buflen))
+	sa.adjust_length(strlen(ts.unparse(x)));
+    return sa;
+}
 
-	int len;
-#if TIMESTAMP_NANOSEC
-	uint32_t usec = subsec / Timestamp::nsec_per_usec;
-	if (usec * Timestamp::nsec_per_usec == subsec)
-	    len = sprintf(x, "%ld.%06u", (long) sec, usec);
+/** @brief Unparse this timestamp into @a buf.
+    @param buf buffer of at least unparse_buflen characters
+    @return @a buf
+
+    Like unparse(), but writes a null-terminated string into @a buf without
+    allocating memory. */
+char *
+Timestamp::unparse(char *buf) const
+{
+    char *x = buf;
+    seconds_type s;
+    uint32_t ss;
+    if (sec() >= 0)
+	s = sec(), ss = subsec();
+    else {
+	*x++ = '-';
+	if (subsec() == 0)
+	    s = -sec(), ss = 0;
 	else
-	    len = sprintf(x, "%ld.%09u", (long) sec, subsec);
+	    s = -sec() - 1, ss = subsec_per_sec - subsec();
+    }
+
+#if TIMESTAMP_NANOSEC
+    uint32_t usec = ss / nsec_per_usec;
+    if (usec * nsec_per_usec == ss)
+	sprintf(x, "%ld.%06u", (long) s, usec);
+    else
+	sprintf(x, "%ld.%09u", (long) s, ss);
 #else
-	len = sprintf(x, "%ld.%06u", (long) sec, subsec);
+    sprintf(x, "%ld.%06u", (long) s, ss);
 #endif
-	sa.adjust_length(len);
-    }
-    return sa;
+    return buf;
 }
 
 /** @brief Unparse this timestamp into a String.
@@ -30,6 +30,9 @@
 #include <sys/stat.h>
 #include <sys/resource.h>
 #include <fcntl.h>
+#if HAVE_MULTITHREAD
+# include <pthread.h>
+#endif
 
 #include <click/lexer.hh>
 #include <click/routerthread.hh>
@@ -67,18 +70,109 @@ CLICK_USING_DECLS
 #define EXPRESSION_OPT		313
 
 
-static simclick_node_t *cursimnode = NULL;
-
 //
-// XXX
-// OK, this bit of code here should work fine as long as your simulator
-// isn't multithreaded. If it is, there could be multiple threads stomping
-// on each other and potentially causing subtle or unsubtle problems.
+// The node being run is per thread, so that simclick_click_run_parallel
+// can run several nodes at once. Building with --enable-user-multithread
+// also makes the reference counts and locks of the Click library atomic,
+// which that needs. Creating and killing nodes, and the handler calls,
+// must still come from one thread at a time.
 //
+#if HAVE_MULTITHREAD
+static __thread simclick_node_t *cursimnode = NULL;
+#else
+static simclick_node_t *cursimnode = NULL;
+#endif
+
 static void setsimstate(simclick_node_t *newstate) {
     cursimnode = newstate;
 }
 
+//
+// With SIMCLICK_SHARE_CONFIGURATION on, each router file is read, parsed
+// and its compound elements and connections expanded only once, into a
+// router that is never initialized. Every node created from the file gets
+// a copy of that router: new elements, but the configuration strings,
+// names, landmarks and connections shared with it. The parsed routers live
+// until the simulator exits. A simulator generating one router file per
+// node gains nothing from this.
+//
+static bool share_configuration = false;
+static Vector<String> shared_files;
+static Vector<Router *> shared_routers;
+
+static Router *shared_router(const char *router_file, ErrorHandler *errh) {
+    String filename(router_file);
+    int i = 0;
+    while (i < shared_files.size() && shared_files[i] != filename)
+	i++;
+    if (i == shared_files.size()) {
+	int before = errh->nerrors();
+	Router *r = click_read_router(filename, false, errh, false);
+	if (r && errh->nerrors() != before) {
+	    delete r;
+	    r = 0;
+	}
+	if (!r)
+	    return 0;
+	shared_files.push_back(filename);
+	shared_routers.push_back(r);
+    }
+    return click_clone_router(shared_routers[i], errh, false);
+}
+
+#if HAVE_MULTITHREAD
+//
+// Worker pool of simclick_click_run_parallel. The caller runs nodes too,
+// so SIMCLICK_WORKER_THREADS N starts N - 1 workers, which live until the
+// simulator exits. Nodes are handed out one at a time under pool_lock.
+//
+static int nworkers = 0;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static unsigned pool_generation = 0;
+static simclick_node_t **pool_nodes;
+static int pool_nnodes = 0;
+static int pool_next = 0;
+static int pool_running = 0;
+
+// called and returns with pool_lock held
+static void run_pool_nodes() {
+    while (pool_next < pool_nnodes) {
+	simclick_node_t *simnode = pool_nodes[pool_next++];
+	pool_running++;
+	pthread_mutex_unlock(&pool_lock);
+	simclick_click_run(simnode);
+	pthread_mutex_lock(&pool_lock);
+	if (--pool_running == 0 && pool_next == pool_nnodes)
+	    pthread_cond_broadcast(&pool_done);
+    }
+}
+
+static void *pool_worker(void *) {
+    pthread_mutex_lock(&pool_lock);
+    unsigned generation = pool_generation;
+    while (1) {
+	while (pool_generation == generation)
+	    pthread_cond_wait(&pool_work, &pool_lock);
+	generation = pool_generation;
+	run_pool_nodes();
+    }
+    return 0;
+}
+
+static int start_workers(int nthreads) {
+    while (nworkers < nthreads - 1) {
+	pthread_t thread;
+	if (pthread_create(&thread, 0, pool_worker, 0) != 0)
+	    return -1;
+	pthread_detach(thread);
+	nworkers++;
+    }
+    return 0;
+}
+#endif
+
 // functions for packages
 
 
@@ -100,7 +194,11 @@ int simclick_click_create(simclick_node_t *simnode, const char* router_file) {
     ErrorHandler *errh = ErrorHandler::default_handler();
     int before = errh->nerrors();
 
-    Router *r = click_read_router(router_file, false, errh, false);
+    Router *r;
+    if (share_configuration)
+	r = shared_router(router_file, errh);
+    else
+	r = click_read_router(router_file, false, errh, false);
     simnode->clickinfo = r;
     if (!r)
 	return errh->fatal("%s: not a valid router", router_file);
@@ -123,12 +221,34 @@ void simclick_click_run(simclick_node_t *simnode) {
   // not right - mostly smoke testing for now...
   Router* r = (Router *) simnode->clickinfo;
   if (r) {
+    r->master()->ns_event_due();
     r->master()->thread(0)->driver();
   } else {
     click_chatter("simclick_click_run: call with null router");
   }
 }
 
+void simclick_click_run_parallel(simclick_node_t **simnodes, int nsimnodes) {
+#if HAVE_MULTITHREAD
+  if (nworkers > 0 && nsimnodes > 1) {
+    pthread_mutex_lock(&pool_lock);
+    pool_nodes = simnodes;
+    pool_nnodes = nsimnodes;
+    pool_next = pool_running = 0;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_work);
+    run_pool_nodes();
+    while (pool_next < pool_nnodes || pool_running)
+      pthread_cond_wait(&pool_done, &pool_lock);
+    pool_nnodes = 0;
+    pthread_mutex_unlock(&pool_lock);
+    return;
+  }
+#endif
+  for (int i = 0; i < nsimnodes; i++)
+    simclick_click_run(simnodes[i]);
+}
+
 void simclick_click_kill(simclick_node_t *simnode) {
   //fprintf(stderr,"Hey! Need to implement simclick_click_kill!\n");
   setsimstate(simnode);
@@ -223,7 +343,21 @@ int simclick_click_command(simclick_node_t *, int cmd, ...)
 	r = 0;
     else if (cmd == SIMCLICK_SUPPORTS) {
 	int othercmd = va_arg(val, int);
-	r = othercmd >= SIMCLICK_VERSION && othercmd <= SIMCLICK_SUPPORTS;
+	r = (othercmd >= SIMCLICK_VERSION && othercmd <= SIMCLICK_SUPPORTS)
+	    || othercmd == SIMCLICK_SHARE_CONFIGURATION;
+#if HAVE_MULTITHREAD
+	r = r || othercmd == SIMCLICK_WORKER_THREADS;
+#endif
+    } else if (cmd == SIMCLICK_SHARE_CONFIGURATION) {
+	share_configuration = va_arg(val, int);
+	r = 0;
+    } else if (cmd == SIMCLICK_WORKER_THREADS) {
+	int nthreads = va_arg(val, int);
+#if HAVE_MULTITHREAD
+	r = start_workers(nthreads);
+#else
+	r = (nthreads <= 1 ? 0 : -1);
+#endif
     } else
 	r = 1;
 
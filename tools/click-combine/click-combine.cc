@@ -27,6 +27,7 @@
 #include <click/straccum.hh>
 #include <click/variableenv.hh>
 #include <click/driver.hh>
+#include <click/ipaddress.hh>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,6 +37,8 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <stdarg.h>
+#include <math.h>
+#include <arpa/inet.h>
 
 #define HELP_OPT		300
 #define VERSION_OPT		301
@@ -45,6 +48,11 @@
 #define LINK_OPT		305
 #define EXPRESSION_OPT		306
 #define CONFIG_OPT		307
+#define OLSR_OPT		308
+#define OLSR_LAYOUT_OPT		309
+#define OLSR_SPACING_OPT	310
+#define OLSR_LOSS_OPT		311
+#define OLSR_STOP_OPT		312
 
 static const Clp_Option options[] = {
   { "config", 'c', CONFIG_OPT, 0, 0 },
@@ -53,6 +61,11 @@ static const Clp_Option options[] = {
   { "help", 0, HELP_OPT, 0, 0 },
   { "link", 'l', LINK_OPT, Clp_ValString, 0 },
   { "name", 'n', NAME_OPT, Clp_ValString, 0 },
+  { "olsr", 0, OLSR_OPT, Clp_ValUnsigned, 0 },
+  { "olsr-layout", 0, OLSR_LAYOUT_OPT, Clp_ValString, 0 },
+  { "olsr-loss", 0, OLSR_LOSS_OPT, Clp_ValDouble, 0 },
+  { "olsr-spacing", 0, OLSR_SPACING_OPT, Clp_ValUnsigned, 0 },
+  { "olsr-stop", 0, OLSR_STOP_OPT, 0, Clp_Negate },
   { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
   { "version", 'v', VERSION_OPT, 0, 0 },
 };
@@ -89,6 +102,16 @@ Options:\n\
                          component name. Each COMP is either an element name or\n\
                          a device name (for linking at From/To/PollDevices).\n\
   -c, --config           Output config only (not an archive).\n\
+\n\
+OLSR emulation options:\n\
+      --olsr N           Combine N copies of a single user-level router made by\n\
+                         make-olsr-config.pl, with the nodes' interfaces joined\n\
+                         by RadioSim elements.\n\
+      --olsr-layout L    Place the nodes on a 'grid' or a 'line' [grid].\n\
+      --olsr-spacing M   Space neighboring nodes M meters apart [200].\n\
+      --olsr-loss P      Drop received packets with probability P [0].\n\
+      --olsr-stop        Stop the router once every node has a route to every\n\
+                         other.\n\
       --help             Print this message and exit.\n\
   -v, --version          Print version number and exit.\n\
 \n\
@@ -97,6 +120,11 @@ Report bugs to <click@pdos.lcs.mit.edu>.\n", program_name);
 
 static Vector<String> router_names;
 static Vector<RouterT *> routers;
+static int olsr_nodes = 0;
+static String olsr_layout = "grid";
+static unsigned olsr_spacing = 200;
+static double olsr_loss = 0;
+static bool olsr_stop = false;
 typedef PortT RouterPortT;	// except that 'port' is the router index
 static Vector<RouterPortT> links_from;
 static Vector<RouterPortT> links_to;
@@ -343,6 +371,144 @@ add_links(RouterT *r)
     }
 }
 
+// OLSR emulation: the nodes' devices are ports of one RadioSim per device
+// name, and each node gets addresses of its own
+struct OLSRDevices {
+  Vector<ElementT *> from;	// by node
+  Vector<ElementT *> to;
+};
+
+static String
+olsr_rewrite_address(const String &arg, int node, Vector<IPAddress> &main_addrs)
+{
+  Vector<String> words;
+  cp_spacevec(arg, words);
+  if (words.size() != 2)
+    return arg;
+  IPAddress a;
+  if (words[0].starts_with("my_ip") && cp_ip_address(words[1], &a)) {
+    // consecutive host addresses from the router's own
+    a = IPAddress(htonl(ntohl(a.addr()) + node));
+    if (words[0] == "my_ip0")
+      main_addrs[node] = a;
+    return words[0] + " " + a.unparse();
+  } else if (words[0].starts_with("my_ether")) {
+    int i = atoi(words[0].c_str() + 8);
+    char buf[24];
+    sprintf(buf, "02:00:00:%02x:%02x:%02x", i & 255, (node >> 8) & 255, node & 255);
+    return words[0] + " " + buf;
+  } else
+    return arg;
+}
+
+static void
+olsr_emulate(RouterT *combined, ErrorHandler *errh)
+{
+  ElementClassT *idle_type = ElementClassT::base_type("Idle");
+  ElementClassT *discard_type = ElementClassT::base_type("Discard");
+  VariableEnvironment empty_ve(0);
+  LandmarkT landmark("<click-combine>");
+
+  Vector<String> node_names;
+  for (int k = 0; k < olsr_nodes; k++) {
+    node_names.push_back("node" + String(k + 1));
+    routers[0]->expand_into(combined, node_names[k] + "/", empty_ve, errh);
+  }
+
+  // find each node's devices, routing table and addresses
+  Vector<String> devnames;
+  Vector<OLSRDevices> devices;
+  Vector<String> rtables(olsr_nodes, String());
+  Vector<IPAddress> main_addrs(olsr_nodes, IPAddress());
+  for (int i = 0; i < combined->nelements(); i++) {
+    ElementT *e = combined->element(i);
+    if (!e->live())
+      continue;
+    String name = e->name();
+    int slash = find(name, '/') - name.begin();
+    int k = atoi(name.substring(4, slash - 4).c_str()) - 1;
+    String type = e->type_name();
+
+    if (type == "AddressInfo") {
+      Vector<String> args;
+      cp_argvec(e->configuration(), args);
+      for (int a = 0; a < args.size(); a++)
+	args[a] = olsr_rewrite_address(args[a], k, main_addrs);
+      e->set_configuration(cp_unargvec(args));
+    } else if (type == "FromHost") {
+      // the host side would need a tun device per node
+      e->set_type(idle_type);
+      e->set_configuration(String());
+    } else if (type == "ToHost") {
+      e->set_type(discard_type);
+      e->set_configuration(String());
+    } else if (type == "OLSRRoutingTable")
+      rtables[k] = name;
+    else if (type == "FromDevice" || type == "ToDevice") {
+      Vector<String> args;
+      cp_argvec(e->configuration(), args);
+      String dev = (args.size() ? args[0] : String());
+      int d;
+      for (d = 0; d < devnames.size() && devnames[d] != dev; d++)
+	/* nada */;
+      if (d == devnames.size()) {
+	devnames.push_back(dev);
+	devices.push_back(OLSRDevices());
+	devices[d].from.resize(olsr_nodes, 0);
+	devices[d].to.resize(olsr_nodes, 0);
+      }
+      (type == "FromDevice" ? devices[d].from : devices[d].to)[k] = e;
+    }
+  }
+
+  // node positions
+  Vector<String> locs;
+  int columns = (olsr_layout == "line" ? olsr_nodes : (int) ceil(sqrt((double) olsr_nodes)));
+  for (int k = 0; k < olsr_nodes; k++)
+    locs.push_back(String((k % columns) * olsr_spacing) + " " + String((k / columns) * olsr_spacing));
+
+  ElementClassT *radio_type = ElementClassT::base_type("RadioSim");
+  ElementClassT *sample_type = ElementClassT::base_type("RandomSample");
+  for (int d = 0; d < devnames.size(); d++) {
+    ElementT *radio = combined->get_element
+      ("olsr_medium" + String(d), radio_type, "USE_XY true, " + cp_unargvec(locs), landmark);
+    for (int k = 0; k < olsr_nodes; k++) {
+      ElementT *from = devices[d].from[k], *to = devices[d].to[k];
+      if (!from || !to) {
+	errh->error("node '%s' lacks FromDevice(%s) or ToDevice(%s)", node_names[k].c_str(), devnames[d].c_str(), devnames[d].c_str());
+	continue;
+      }
+      combined->insert_before(PortT(radio, k), PortT(to, 0));
+      combined->free_element(to);
+      if (olsr_loss > 0) {
+	ElementT *loss = combined->get_element
+	  (node_names[k] + "/olsr_loss" + String(d), sample_type,
+	   "DROP " + String(olsr_loss), landmark);
+	combined->insert_after(PortT(loss, 0), PortT(from, 0));
+	combined->add_connection(radio, k, loss, 0);
+      } else
+	combined->insert_after(PortT(radio, k), PortT(from, 0));
+      combined->free_element(from);
+    }
+  }
+  if (!devnames.size())
+    errh->error("no FromDevice or ToDevice elements to join");
+
+  // convergence monitor
+  Vector<String> args;
+  for (int k = 0; k < olsr_nodes; k++) {
+    if (!rtables[k] || !main_addrs[k]) {
+      errh->error("node '%s' lacks an OLSRRoutingTable or a my_ip0 address", node_names[k].c_str());
+      return;
+    }
+    args.push_back(rtables[k] + " " + main_addrs[k].unparse());
+  }
+  if (olsr_stop)
+    args.push_back("STOP true");
+  combined->get_element("olsr_convergence", ElementClassT::base_type("OLSRConvergence"),
+			cp_unargvec(args), landmark);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -411,6 +577,38 @@ particular purpose.\n");
       config_only = true;
       break;
 
+     case OLSR_OPT:
+      if (clp->val.u < 2) {
+	p_errh->error("--olsr needs at least 2 nodes");
+	goto bad_option;
+      }
+      olsr_nodes = clp->val.u;
+      break;
+
+     case OLSR_LAYOUT_OPT:
+      olsr_layout = clp->vstr;
+      if (olsr_layout != "grid" && olsr_layout != "line") {
+	p_errh->error("--olsr-layout must be 'grid' or 'line'");
+	goto bad_option;
+      }
+      break;
+
+     case OLSR_SPACING_OPT:
+      olsr_spacing = clp->val.u;
+      break;
+
+     case OLSR_LOSS_OPT:
+      if (clp->val.d < 0 || clp->val.d >= 1) {
+	p_errh->error("--olsr-loss must be at least 0 and less than 1");
+	goto bad_option;
+      }
+      olsr_loss = clp->val.d;
+      break;
+
+     case OLSR_STOP_OPT:
+      olsr_stop = !clp->negated;
+      break;
+
      case Clp_NotOption:
       if (const char *s = strchr(clp->vstr, ':'))
 	cc_read_router(String(clp->vstr, s - clp->vstr), next_name, next_number, s + 1, false, errh);
@@ -466,6 +664,19 @@ particular purpose.\n");
       errh->fatal("%s: %s", output_file, strerror(errno));
   }
 
+  // OLSR emulation: copies of one router, no links
+  if (olsr_nodes) {
+    if (routers.size() != 1 || link_texts.size())
+      p_errh->fatal("--olsr takes one router and no links");
+    RouterT *combined = new RouterT;
+    olsr_emulate(combined, p_errh);
+    if (errh->nerrors() != 0)
+      exit(1);
+    combined->remove_tunnels();
+    write_router_file(combined, outf, errh);
+    exit(0);
+  }
+
   // combine routers
   RouterT *combined = new RouterT;
   VariableEnvironment empty_ve(0);
@@ -68,6 +68,7 @@ CLICK_USING_DECLS
 #define ALLOW_RECONFIG_OPT	314
 #define EXIT_HANDLER_OPT	315
 #define THREADS_OPT		316
+#define PACKET_ARENA_OPT	317
 
 static const Clp_Option options[] = {
   { "allow-reconfigure", 'R', ALLOW_RECONFIG_OPT, 0, Clp_Negate },
@@ -77,6 +78,9 @@ static const Clp_Option options[] = {
   { "handler", 'h', HANDLER_OPT, Clp_ValString, 0 },
   { "help", 0, HELP_OPT, 0, 0 },
   { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
+#if HAVE_CLICK_PACKET_POOL
+  { "packet-arena", 0, PACKET_ARENA_OPT, Clp_ValUnsigned, 0 },
+#endif
   { "port", 'p', PORT_OPT, Clp_ValString, 0 },
   { "quit", 'q', QUIT_OPT, 0, 0 },
 #if HAVE_MULTITHREAD
@@ -116,6 +120,10 @@ Options:\n\
 #if HAVE_MULTITHREAD
 "      --threads N               Start N threads (default 1).\n"
 #endif
+#if HAVE_CLICK_PACKET_POOL
+"      --packet-arena MB         Take packet buffers from an MB-megabyte arena\n\
+                                per NUMA node, on huge pages if reserved.\n"
+#endif
 "  -p, --port PORT               Listen for control connections on TCP port.\n\
   -u, --unix-socket FILE        Listen for control connections on Unix socket.\n\
   -R, --allow-reconfigure       Provide a writable 'hotconfig' handler.\n\
@@ -477,6 +485,12 @@ main(int argc, char **argv)
       break;
 #endif
 
+#if HAVE_CLICK_PACKET_POOL
+     case PACKET_ARENA_OPT:
+      Packet::pool_arena((size_t) clp->val.u << 20);
+      break;
+#endif
+
      case CLICKPATH_OPT:
       set_clickpath(clp->vstr);
       break;